@@ -19,7 +19,7 @@ compares the results to a baseline
 #include "vtkMath.h"
 #include "vtkMatrix4x4.h"
 #include "vtkPlusProbeCalibrationAlgo.h"
-#include "vtkIGSIOSequenceIO.h"
+#include "vtkPlusSequenceIO.h"
 #include "vtkSmartPointer.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkTransform.h"
@@ -123,7 +123,7 @@ int main(int argc, char* argv[])
   // Load and segment calibration image
   LOG_INFO("Read calibration sequence file...");
   vtkSmartPointer<vtkIGSIOTrackedFrameList> calibrationTrackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-  if (vtkIGSIOSequenceIO::Read(inputCalibrationSeqMetafile, calibrationTrackedFrameList) != PLUS_SUCCESS)
+  if (vtkPlusSequenceIO::Read(inputCalibrationSeqMetafile, calibrationTrackedFrameList) != PLUS_SUCCESS)
   {
     LOG_ERROR("Reading calibration images from '" << inputCalibrationSeqMetafile << "' failed!");
     return EXIT_FAILURE;
@@ -144,7 +144,7 @@ int main(int argc, char* argv[])
     // Load and segment validation image
     LOG_INFO("Read validation sequence file...");
     vtkSmartPointer<vtkIGSIOTrackedFrameList> validationTrackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-    if (vtkIGSIOSequenceIO::Read(inputValidationSeqMetafile, validationTrackedFrameList) != PLUS_SUCCESS)
+    if (vtkPlusSequenceIO::Read(inputValidationSeqMetafile, validationTrackedFrameList) != PLUS_SUCCESS)
     {
       LOG_ERROR("Reading validation images from '" << inputValidationSeqMetafile << "' failed!");
       return EXIT_FAILURE;
@@ -20,7 +20,7 @@ See License.txt for details.
 // Local includes
 #include "PlusConfigure.h"
 #include "igsioTrackedFrame.h"
-#include "vtkIGSIOSequenceIO.h"
+#include "vtkPlusSequenceIO.h"
 #include "vtkPlusTemporalCalibrationAlgo.h"
 #include "vtkIGSIOTrackedFrameList.h"
 
@@ -291,7 +291,7 @@ int main(int argc, char** argv)
 
   //  Read fixed frames
   LOG_DEBUG("Read fixed data from " << inputFixedSequenceMetafile);
-  if (vtkIGSIOSequenceIO::Read(inputFixedSequenceMetafile, fixedFrames) != PLUS_SUCCESS)
+  if (vtkPlusSequenceIO::Read(inputFixedSequenceMetafile, fixedFrames) != PLUS_SUCCESS)
   {
     LOG_ERROR("Failed to read fixed data from sequence metafile: " << inputFixedSequenceMetafile << ". Exiting...");
     exit(EXIT_FAILURE);
@@ -300,7 +300,7 @@ int main(int argc, char** argv)
 
   //  Read moving frames
   LOG_DEBUG("Read moving data from " << inputMovingSequenceMetafile);
-  if (vtkIGSIOSequenceIO::Read(inputMovingSequenceMetafile, movingFrames) != PLUS_SUCCESS)
+  if (vtkPlusSequenceIO::Read(inputMovingSequenceMetafile, movingFrames) != PLUS_SUCCESS)
   {
     LOG_ERROR("Failed to read moving data from sequence metafile: " << inputMovingSequenceMetafile << ". Exiting...");
     exit(EXIT_FAILURE);
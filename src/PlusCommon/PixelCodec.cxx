@@ -0,0 +1,805 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PixelCodec.h"
+
+#include <algorithm>
+#include <atomic>
+
+// SIMD kernels are compiled for x86 regardless of the compiler flags and selected at runtime based on the CPU features.
+// GCC and Clang need a target attribute on each function that uses the intrinsics, MSVC does not.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #include <intrin.h>
+  #include <immintrin.h>
+  #define PIXELCODEC_X86_SIMD
+  #define PIXELCODEC_TARGET_SSE41
+  #define PIXELCODEC_TARGET_AVX2
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #include <immintrin.h>
+  #define PIXELCODEC_X86_SIMD
+  #define PIXELCODEC_TARGET_SSE41 __attribute__((target("sse4.1")))
+  #define PIXELCODEC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace
+{
+  // Frames are only split into bands of rows if each band gets at least this many pixels
+  const int MIN_NUMBER_OF_PIXELS_PER_BAND = 64 * 1024;
+
+  // Fixed-point factors of the exact integer divisions used in the conversions.
+  // The SIMD kernels compute floor(a*256/219) as a+((a*LUMINANCE_SCALE_REMAINDER)>>16) for 0<=a<=239,
+  // floor(a*256/224) as a+((a*CHROMINANCE_SCALE_REMAINDER)>>16) for 0<=a<=128 and floor(s/3) as (s*DIVIDE_BY_3)>>16 for 0<=s<=765.
+  const int LUMINANCE_SCALE_REMAINDER = 11073;
+  const int CHROMINANCE_SCALE_REMAINDER = 9363;
+  const int DIVIDE_BY_3 = 21846;
+
+  // -1 means that the instruction set has not been selected yet
+  std::atomic<int> ActiveInstructionSet(-1);
+
+  //----------------------------------------------------------------------------
+  /*!
+    Call bandFunction(firstItem, lastItem) for bands of whole rows that together cover numberOfRows*itemsPerRow items.
+    The frame is processed on the calling thread if it is too small to benefit from multiple threads.
+  */
+  template<class BandFunctionType>
+  void ForEachRowBand(int numberOfRows, int itemsPerRow, unsigned int numberOfThreads, const BandFunctionType& bandFunction)
+  {
+    int numberOfItems = numberOfRows * itemsPerRow;
+    if (numberOfItems <= 0)
+    {
+      return;
+    }
+    int numberOfBands = 1;
+    if (numberOfThreads != 1)
+    {
+      int minimumNumberOfRowsPerBand = std::max(1, MIN_NUMBER_OF_PIXELS_PER_BAND / itemsPerRow);
+      numberOfBands = std::min<int>(PlusCommon::GetNumberOfWorkerThreads(numberOfThreads), numberOfRows / minimumNumberOfRowsPerBand);
+    }
+    if (numberOfBands <= 1)
+    {
+      bandFunction(0, numberOfItems);
+      return;
+    }
+    PlusCommon::ParallelFor(numberOfBands, [&](unsigned int bandIndex)
+    {
+      int firstRow = static_cast<int>(static_cast<long long>(numberOfRows) * bandIndex / numberOfBands);
+      int lastRow = static_cast<int>(static_cast<long long>(numberOfRows) * (bandIndex + 1) / numberOfBands);
+      bandFunction(firstRow * itemsPerRow, lastRow * itemsPerRow);
+    }, numberOfBands);
+  }
+
+  //----------------------------------------------------------------------------
+  // Scalar kernels. They process pixels [firstPixel, lastPixel), YUY2 kernels process pixel pairs.
+  // These are the reference implementations, the SIMD kernels must produce identical output.
+
+  //----------------------------------------------------------------------------
+  void RgbBgrSwapScalar(const unsigned char* s, unsigned char* d, int firstPixel, int lastPixel)
+  {
+    for (size_t i = firstPixel; i < static_cast<size_t>(lastPixel); i++)
+    {
+      d[3 * i] = s[3 * i + 2];
+      d[3 * i + 1] = s[3 * i + 1];
+      d[3 * i + 2] = s[3 * i];
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void Rgba32ToBmp24Scalar(bool bgrOrder, const unsigned char* s, unsigned char* d, int firstPixel, int lastPixel)
+  {
+    const int firstComponent = bgrOrder ? 2 : 0;
+    for (size_t i = firstPixel; i < static_cast<size_t>(lastPixel); i++)
+    {
+      // ignore alpha channel
+      d[3 * i] = s[4 * i + firstComponent];
+      d[3 * i + 1] = s[4 * i + 1];
+      d[3 * i + 2] = s[4 * i + 2 - firstComponent];
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  template<int numberOfComponents>
+  void RgbToGrayScalar(const unsigned char* s, unsigned char* d, int firstPixel, int lastPixel)
+  {
+    for (size_t i = firstPixel; i < static_cast<size_t>(lastPixel); i++)
+    {
+      const unsigned char* rgb = s + numberOfComponents * i;
+      d[i] = ((unsigned short)(rgb[0]) + rgb[1] + rgb[2]) / 3;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void Yuv422pToBmp24Scalar(bool bgrOrder, const unsigned char* s, unsigned char* d, int firstPair, int lastPair)
+  {
+    const int rIndex = bgrOrder ? 2 : 0;
+    const int bIndex = 2 - rIndex;
+    for (size_t i = firstPair; i < static_cast<size_t>(lastPair); i++)
+    {
+      const unsigned char* yuyv = s + 4 * i;
+      unsigned char* rgb = d + 6 * i;
+
+      int Y1 = ICCIRY(yuyv[0]);
+      int U = ICCIRUV(yuyv[1] - 128);
+      int Y2 = ICCIRY(yuyv[2]);
+      int V = ICCIRUV(yuyv[3] - 128);
+
+      rgb[rIndex] = CLIP(GET_R_FROM_YUV(Y1, U, V));
+      rgb[1] = CLIP(GET_G_FROM_YUV(Y1, U, V));
+      rgb[bIndex] = CLIP(GET_B_FROM_YUV(Y1, U, V));
+
+      rgb[3 + rIndex] = CLIP(GET_R_FROM_YUV(Y2, U, V));
+      rgb[3 + 1] = CLIP(GET_G_FROM_YUV(Y2, U, V));
+      rgb[3 + bIndex] = CLIP(GET_B_FROM_YUV(Y2, U, V));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void Yuv422pToGrayScalar(const unsigned char* s, unsigned char* d, int firstPair, int lastPair)
+  {
+    for (size_t i = firstPair; i < static_cast<size_t>(lastPair); i++)
+    {
+      const unsigned char* yuyv = s + 4 * i;
+
+      int Y1 = ICCIRY(yuyv[0]);
+      int U = ICCIRUV(yuyv[1] - 128);
+      int Y2 = ICCIRY(yuyv[2]);
+      int V = ICCIRUV(yuyv[3] - 128);
+
+      unsigned char r = CLIP(GET_R_FROM_YUV(Y1, U, V));
+      unsigned char g = CLIP(GET_G_FROM_YUV(Y1, U, V));
+      unsigned char b = CLIP(GET_B_FROM_YUV(Y1, U, V));
+      d[2 * i] = (int(b) + g + r) / 3;
+
+      r = CLIP(GET_R_FROM_YUV(Y2, U, V));
+      g = CLIP(GET_G_FROM_YUV(Y2, U, V));
+      b = CLIP(GET_B_FROM_YUV(Y2, U, V));
+      d[2 * i + 1] = (int(b) + g + r) / 3;
+    }
+  }
+
+#ifdef PIXELCODEC_X86_SIMD
+
+  //----------------------------------------------------------------------------
+  bool IsInstructionSetSupportedByCpu(PixelCodec::InstructionSet instructionSet)
+  {
+    switch (instructionSet)
+    {
+      case PixelCodec::InstructionSet_Scalar:
+        return true;
+#if defined(_MSC_VER)
+      case PixelCodec::InstructionSet_SSE41:
+      {
+        int cpuInfo[4] = { 0 };
+        __cpuid(cpuInfo, 1);
+        return (cpuInfo[2] & (1 << 19)) != 0;
+      }
+      case PixelCodec::InstructionSet_AVX2:
+      {
+        int cpuInfo[4] = { 0 };
+        __cpuid(cpuInfo, 0);
+        if (cpuInfo[0] < 7)
+        {
+          return false;
+        }
+        __cpuid(cpuInfo, 1);
+        bool osSavesAvxRegisters = (cpuInfo[2] & (1 << 27)) != 0 && (cpuInfo[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(cpuInfo, 7, 0);
+        return osSavesAvxRegisters && (cpuInfo[1] & (1 << 5)) != 0;
+      }
+#else
+      case PixelCodec::InstructionSet_SSE41:
+        return __builtin_cpu_supports("sse4.1") != 0;
+      case PixelCodec::InstructionSet_AVX2:
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+      default:
+        return false;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Byte shuffle masks for converting between 16 pixels of 3 interleaved components (48 bytes) and 3 planes of 16 bytes */
+  struct ShuffleMasks
+  {
+    ShuffleMasks()
+    {
+      for (int reg = 0; reg < 3; reg++)
+      {
+        for (int component = 0; component < 3; component++)
+        {
+          for (int k = 0; k < 16; k++)
+          {
+            // Byte k of the interleaved register comes from pixel (16*reg+k)/3 of the component plane
+            int interleavedIndex = 16 * reg + k;
+            Interleave[reg][component][k] = (interleavedIndex % 3 == component) ? static_cast<signed char>(interleavedIndex / 3) : -128;
+            // Pixel k of the component plane comes from byte 3*k+component of the interleaved data
+            int planeIndex = 3 * k + component - 16 * reg;
+            Deinterleave[reg][component][k] = (planeIndex >= 0 && planeIndex < 16) ? static_cast<signed char>(planeIndex) : -128;
+          }
+        }
+      }
+    }
+    signed char Interleave[3][3][16];
+    signed char Deinterleave[3][3][16];
+  };
+
+  //----------------------------------------------------------------------------
+  const ShuffleMasks& GetShuffleMasks()
+  {
+    static const ShuffleMasks masks;
+    return masks;
+  }
+
+  //----------------------------------------------------------------------------
+  // SSE4.1 kernels
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_SSE41 inline __m128i LoadMask_SSE41(const signed char* mask)
+  {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Store 16 pixels given as R, G, B planes as 48 bytes of interleaved components */
+  PIXELCODEC_TARGET_SSE41 inline void StoreInterleaved_SSE41(const __m128i interleaveMasks[3][3], __m128i c0, __m128i c1, __m128i c2, unsigned char* d)
+  {
+    for (int reg = 0; reg < 3; reg++)
+    {
+      __m128i packed = _mm_or_si128(_mm_or_si128(
+                                      _mm_shuffle_epi8(c0, interleaveMasks[reg][0]),
+                                      _mm_shuffle_epi8(c1, interleaveMasks[reg][1])),
+                                    _mm_shuffle_epi8(c2, interleaveMasks[reg][2]));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 16 * reg), packed);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Average of the R, G, B planes of 16 pixels, rounded down */
+  PIXELCODEC_TARGET_SSE41 inline __m128i AverageOfPlanes_SSE41(__m128i r, __m128i g, __m128i b)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i divideBy3 = _mm_set1_epi16(DIVIDE_BY_3);
+    __m128i sumLow = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero)), _mm_unpacklo_epi8(b, zero));
+    __m128i sumHigh = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero)), _mm_unpackhi_epi8(b, zero));
+    return _mm_packus_epi16(_mm_mulhi_epu16(sumLow, divideBy3), _mm_mulhi_epu16(sumHigh, divideBy3));
+  }
+
+  //----------------------------------------------------------------------------
+  /*! ICCIRY of 8 luminance values, exact integer division (rounded towards zero) */
+  PIXELCODEC_TARGET_SSE41 inline __m128i ScaleLuminance_SSE41(__m128i y)
+  {
+    __m128i offset = _mm_sub_epi16(y, _mm_set1_epi16(16));
+    __m128i a = _mm_abs_epi16(offset);
+    __m128i scaled = _mm_add_epi16(a, _mm_mulhi_epu16(a, _mm_set1_epi16(LUMINANCE_SCALE_REMAINDER)));
+    return _mm_sign_epi16(scaled, offset);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! ICCIRUV(c-128) of 8 chrominance values, exact integer division (rounded towards zero) */
+  PIXELCODEC_TARGET_SSE41 inline __m128i ScaleChrominance_SSE41(__m128i c)
+  {
+    __m128i offset = _mm_sub_epi16(c, _mm_set1_epi16(128));
+    __m128i a = _mm_abs_epi16(offset);
+    __m128i scaled = _mm_add_epi16(a, _mm_mulhi_epu16(a, _mm_set1_epi16(CHROMINANCE_SCALE_REMAINDER)));
+    return _mm_sign_epi16(scaled, offset);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! UNFIX(term, FIXNUM) of 4 32-bit values, copied into both 16-bit halves (one for each pixel of the pair) */
+  PIXELCODEC_TARGET_SSE41 inline __m128i UnfixForPixelPair_SSE41(__m128i term)
+  {
+    __m128i value = _mm_srai_epi32(_mm_add_epi32(term, _mm_set1_epi32(1 << (FIXNUM - 1))), FIXNUM);
+    return _mm_or_si128(_mm_and_si128(value, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(value, 16));
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Convert 8 YUY2 pixel pairs to clipped 8-bit R, G, B planes.
+    GET_x_FROM_YUV(Y, U, V) is split into Y + UNFIX(chrominance term), which is exact because FIX(1.0, FIXNUM)*Y is a multiple of 1<<FIXNUM.
+  */
+  PIXELCODEC_TARGET_SSE41 inline void Yuv422pToPlanes_SSE41(const unsigned char* s, __m128i& r, __m128i& g, __m128i& b)
+  {
+    const __m128i yuyv0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+    const __m128i yuyv1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+    const __m128i lowByteMask = _mm_set1_epi16(0x00FF);
+
+    __m128i y0 = ScaleLuminance_SSE41(_mm_and_si128(yuyv0, lowByteMask));
+    __m128i y1 = ScaleLuminance_SSE41(_mm_and_si128(yuyv1, lowByteMask));
+
+    // One pixel pair in each 32-bit lane: U in the low, V in the high 16 bits
+    __m128i uv[2] = { ScaleChrominance_SSE41(_mm_srli_epi16(yuyv0, 8)), ScaleChrominance_SSE41(_mm_srli_epi16(yuyv1, 8)) };
+    __m128i rTerm[2], gTerm[2], bTerm[2];
+    for (int i = 0; i < 2; i++)
+    {
+      __m128i u = _mm_srai_epi32(_mm_slli_epi32(uv[i], 16), 16);
+      __m128i v = _mm_srai_epi32(uv[i], 16);
+      rTerm[i] = UnfixForPixelPair_SSE41(_mm_mullo_epi32(v, _mm_set1_epi32(FIX(1.402, FIXNUM))));
+      gTerm[i] = UnfixForPixelPair_SSE41(_mm_add_epi32(_mm_mullo_epi32(u, _mm_set1_epi32(FIX(-0.344, FIXNUM))), _mm_mullo_epi32(v, _mm_set1_epi32(FIX(-0.714, FIXNUM)))));
+      bTerm[i] = UnfixForPixelPair_SSE41(_mm_mullo_epi32(u, _mm_set1_epi32(FIX(1.772, FIXNUM))));
+    }
+
+    r = _mm_packus_epi16(_mm_add_epi16(y0, rTerm[0]), _mm_add_epi16(y1, rTerm[1]));
+    g = _mm_packus_epi16(_mm_add_epi16(y0, gTerm[0]), _mm_add_epi16(y1, gTerm[1]));
+    b = _mm_packus_epi16(_mm_add_epi16(y0, bTerm[0]), _mm_add_epi16(y1, bTerm[1]));
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_SSE41 void RgbBgrSwap_SSE41(const unsigned char* s, unsigned char* d, int firstPixel, int lastPixel)
+  {
+    // 5 pixels are swapped in each 16-byte register. The 16th byte written is overwritten by the next iteration,
+    // therefore at least 6 pixels must remain to stay within the band.
+    const __m128i swapMask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    int i = firstPixel;
+    for (; lastPixel - i >= 6; i += 5)
+    {
+      __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 3 * static_cast<size_t>(i)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 3 * static_cast<size_t>(i)), _mm_shuffle_epi8(rgb, swapMask));
+    }
+    RgbBgrSwapScalar(s, d, i, lastPixel);
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_SSE41 void Rgba32ToBmp24_SSE41(bool bgrOrder, const unsigned char* s, unsigned char* d, int firstPixel, int lastPixel)
+  {
+    // 4 pixels are converted in each iteration. 16 bytes are written, of which the last 4 are overwritten by the next iteration.
+    const __m128i shuffleMask = bgrOrder
+                                ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -128, -128, -128, -128)
+                                : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128);
+    int i = firstPixel;
+    for (; lastPixel - i >= 6; i += 4)
+    {
+      __m128i rgba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 4 * static_cast<size_t>(i)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 3 * static_cast<size_t>(i)), _mm_shuffle_epi8(rgba, shuffleMask));
+    }
+    Rgba32ToBmp24Scalar(bgrOrder, s, d, i, lastPixel);
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_SSE41 void Rgb24ToGray_SSE41(const unsigned char* s, unsigned char* d, int firstPixel, int lastPixel)
+  {
+    const ShuffleMasks& masks = GetShuffleMasks();
+    __m128i deinterleaveMasks[3][3];
+    for (int reg = 0; reg < 3; reg++)
+    {
+      for (int component = 0; component < 3; component++)
+      {
+        deinterleaveMasks[reg][component] = LoadMask_SSE41(masks.Deinterleave[reg][component]);
+      }
+    }
+
+    int i = firstPixel;
+    for (; i + 16 <= lastPixel; i += 16)
+    {
+      const unsigned char* rgb = s + 3 * static_cast<size_t>(i);
+      __m128i packed[3];
+      for (int reg = 0; reg < 3; reg++)
+      {
+        packed[reg] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 16 * reg));
+      }
+      __m128i planes[3];
+      for (int component = 0; component < 3; component++)
+      {
+        planes[component] = _mm_or_si128(_mm_or_si128(
+                                           _mm_shuffle_epi8(packed[0], deinterleaveMasks[0][component]),
+                                           _mm_shuffle_epi8(packed[1], deinterleaveMasks[1][component])),
+                                         _mm_shuffle_epi8(packed[2], deinterleaveMasks[2][component]));
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), AverageOfPlanes_SSE41(planes[0], planes[1], planes[2]));
+    }
+    RgbToGrayScalar<3>(s, d, i, lastPixel);
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_SSE41 void Rgba32ToGray_SSE41(const unsigned char* s, unsigned char* d, int firstPixel, int lastPixel)
+  {
+    // Sum of R+G and B+0 in 16-bit lanes, then horizontal add gives the R+G+B sum of each pixel
+    const __m128i componentWeights = _mm_set1_epi32(0x00010101);
+    const __m128i divideBy3 = _mm_set1_epi16(DIVIDE_BY_3);
+    int i = firstPixel;
+    for (; i + 16 <= lastPixel; i += 16)
+    {
+      const unsigned char* rgba = s + 4 * static_cast<size_t>(i);
+      __m128i partialSums[4];
+      for (int reg = 0; reg < 4; reg++)
+      {
+        partialSums[reg] = _mm_maddubs_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + 16 * reg)), componentWeights);
+      }
+      __m128i sumLow = _mm_hadd_epi16(partialSums[0], partialSums[1]);
+      __m128i sumHigh = _mm_hadd_epi16(partialSums[2], partialSums[3]);
+      __m128i gray = _mm_packus_epi16(_mm_mulhi_epu16(sumLow, divideBy3), _mm_mulhi_epu16(sumHigh, divideBy3));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), gray);
+    }
+    RgbToGrayScalar<4>(s, d, i, lastPixel);
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_SSE41 void Yuv422pToBmp24_SSE41(bool bgrOrder, const unsigned char* s, unsigned char* d, int firstPair, int lastPair)
+  {
+    const ShuffleMasks& masks = GetShuffleMasks();
+    __m128i interleaveMasks[3][3];
+    for (int reg = 0; reg < 3; reg++)
+    {
+      for (int component = 0; component < 3; component++)
+      {
+        interleaveMasks[reg][component] = LoadMask_SSE41(masks.Interleave[reg][component]);
+      }
+    }
+
+    int i = firstPair;
+    for (; i + 8 <= lastPair; i += 8)
+    {
+      __m128i r, g, b;
+      Yuv422pToPlanes_SSE41(s + 4 * static_cast<size_t>(i), r, g, b);
+      unsigned char* rgb = d + 6 * static_cast<size_t>(i);
+      if (bgrOrder)
+      {
+        StoreInterleaved_SSE41(interleaveMasks, b, g, r, rgb);
+      }
+      else
+      {
+        StoreInterleaved_SSE41(interleaveMasks, r, g, b, rgb);
+      }
+    }
+    Yuv422pToBmp24Scalar(bgrOrder, s, d, i, lastPair);
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_SSE41 void Yuv422pToGray_SSE41(const unsigned char* s, unsigned char* d, int firstPair, int lastPair)
+  {
+    int i = firstPair;
+    for (; i + 8 <= lastPair; i += 8)
+    {
+      __m128i r, g, b;
+      Yuv422pToPlanes_SSE41(s + 4 * static_cast<size_t>(i), r, g, b);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 2 * static_cast<size_t>(i)), AverageOfPlanes_SSE41(r, g, b));
+    }
+    Yuv422pToGrayScalar(s, d, i, lastPair);
+  }
+
+  //----------------------------------------------------------------------------
+  // AVX2 kernels. Pack instructions operate on the two 128-bit lanes separately, results are reordered by permuting 64-bit quarters.
+  // Conversions that only shuffle bytes are memory bound and use the SSE4.1 kernels.
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_AVX2 inline __m256i PackUnsignedSaturate_AVX2(__m256i a, __m256i b)
+  {
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_AVX2 inline __m256i AverageOfPlanes_AVX2(__m256i r, __m256i g, __m256i b)
+  {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i divideBy3 = _mm256_set1_epi16(DIVIDE_BY_3);
+    // Unpacking within lanes and packing within lanes restores the original pixel order
+    __m256i sumLow = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpacklo_epi8(r, zero), _mm256_unpacklo_epi8(g, zero)), _mm256_unpacklo_epi8(b, zero));
+    __m256i sumHigh = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpackhi_epi8(r, zero), _mm256_unpackhi_epi8(g, zero)), _mm256_unpackhi_epi8(b, zero));
+    return _mm256_packus_epi16(_mm256_mulhi_epu16(sumLow, divideBy3), _mm256_mulhi_epu16(sumHigh, divideBy3));
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_AVX2 inline __m256i ScaleLuminance_AVX2(__m256i y)
+  {
+    __m256i offset = _mm256_sub_epi16(y, _mm256_set1_epi16(16));
+    __m256i a = _mm256_abs_epi16(offset);
+    __m256i scaled = _mm256_add_epi16(a, _mm256_mulhi_epu16(a, _mm256_set1_epi16(LUMINANCE_SCALE_REMAINDER)));
+    return _mm256_sign_epi16(scaled, offset);
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_AVX2 inline __m256i ScaleChrominance_AVX2(__m256i c)
+  {
+    __m256i offset = _mm256_sub_epi16(c, _mm256_set1_epi16(128));
+    __m256i a = _mm256_abs_epi16(offset);
+    __m256i scaled = _mm256_add_epi16(a, _mm256_mulhi_epu16(a, _mm256_set1_epi16(CHROMINANCE_SCALE_REMAINDER)));
+    return _mm256_sign_epi16(scaled, offset);
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_AVX2 inline __m256i UnfixForPixelPair_AVX2(__m256i term)
+  {
+    __m256i value = _mm256_srai_epi32(_mm256_add_epi32(term, _mm256_set1_epi32(1 << (FIXNUM - 1))), FIXNUM);
+    return _mm256_or_si256(_mm256_and_si256(value, _mm256_set1_epi32(0xFFFF)), _mm256_slli_epi32(value, 16));
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Convert 16 YUY2 pixel pairs to clipped 8-bit R, G, B planes, see Yuv422pToPlanes_SSE41 */
+  PIXELCODEC_TARGET_AVX2 inline void Yuv422pToPlanes_AVX2(const unsigned char* s, __m256i& r, __m256i& g, __m256i& b)
+  {
+    const __m256i yuyv0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+    const __m256i yuyv1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 32));
+    const __m256i lowByteMask = _mm256_set1_epi16(0x00FF);
+
+    __m256i y0 = ScaleLuminance_AVX2(_mm256_and_si256(yuyv0, lowByteMask));
+    __m256i y1 = ScaleLuminance_AVX2(_mm256_and_si256(yuyv1, lowByteMask));
+
+    __m256i uv[2] = { ScaleChrominance_AVX2(_mm256_srli_epi16(yuyv0, 8)), ScaleChrominance_AVX2(_mm256_srli_epi16(yuyv1, 8)) };
+    __m256i rTerm[2], gTerm[2], bTerm[2];
+    for (int i = 0; i < 2; i++)
+    {
+      __m256i u = _mm256_srai_epi32(_mm256_slli_epi32(uv[i], 16), 16);
+      __m256i v = _mm256_srai_epi32(uv[i], 16);
+      rTerm[i] = UnfixForPixelPair_AVX2(_mm256_mullo_epi32(v, _mm256_set1_epi32(FIX(1.402, FIXNUM))));
+      gTerm[i] = UnfixForPixelPair_AVX2(_mm256_add_epi32(_mm256_mullo_epi32(u, _mm256_set1_epi32(FIX(-0.344, FIXNUM))), _mm256_mullo_epi32(v, _mm256_set1_epi32(FIX(-0.714, FIXNUM)))));
+      bTerm[i] = UnfixForPixelPair_AVX2(_mm256_mullo_epi32(u, _mm256_set1_epi32(FIX(1.772, FIXNUM))));
+    }
+
+    r = PackUnsignedSaturate_AVX2(_mm256_add_epi16(y0, rTerm[0]), _mm256_add_epi16(y1, rTerm[1]));
+    g = PackUnsignedSaturate_AVX2(_mm256_add_epi16(y0, gTerm[0]), _mm256_add_epi16(y1, gTerm[1]));
+    b = PackUnsignedSaturate_AVX2(_mm256_add_epi16(y0, bTerm[0]), _mm256_add_epi16(y1, bTerm[1]));
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_AVX2 void Rgba32ToGray_AVX2(const unsigned char* s, unsigned char* d, int firstPixel, int lastPixel)
+  {
+    const __m256i componentWeights = _mm256_set1_epi32(0x00010101);
+    const __m256i divideBy3 = _mm256_set1_epi16(DIVIDE_BY_3);
+    int i = firstPixel;
+    for (; i + 32 <= lastPixel; i += 32)
+    {
+      const unsigned char* rgba = s + 4 * static_cast<size_t>(i);
+      __m256i partialSums[4];
+      for (int reg = 0; reg < 4; reg++)
+      {
+        partialSums[reg] = _mm256_maddubs_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgba + 32 * reg)), componentWeights);
+      }
+      __m256i sumLow = _mm256_permute4x64_epi64(_mm256_hadd_epi16(partialSums[0], partialSums[1]), 0xD8);
+      __m256i sumHigh = _mm256_permute4x64_epi64(_mm256_hadd_epi16(partialSums[2], partialSums[3]), 0xD8);
+      __m256i gray = PackUnsignedSaturate_AVX2(_mm256_mulhi_epu16(sumLow, divideBy3), _mm256_mulhi_epu16(sumHigh, divideBy3));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), gray);
+    }
+    Rgba32ToGray_SSE41(s, d, i, lastPixel);
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_AVX2 void Yuv422pToBmp24_AVX2(bool bgrOrder, const unsigned char* s, unsigned char* d, int firstPair, int lastPair)
+  {
+    const ShuffleMasks& masks = GetShuffleMasks();
+    __m128i interleaveMasks[3][3];
+    for (int reg = 0; reg < 3; reg++)
+    {
+      for (int component = 0; component < 3; component++)
+      {
+        interleaveMasks[reg][component] = LoadMask_SSE41(masks.Interleave[reg][component]);
+      }
+    }
+
+    int i = firstPair;
+    for (; i + 16 <= lastPair; i += 16)
+    {
+      __m256i r, g, b;
+      Yuv422pToPlanes_AVX2(s + 4 * static_cast<size_t>(i), r, g, b);
+      __m256i first = bgrOrder ? b : r;
+      __m256i last = bgrOrder ? r : b;
+      unsigned char* rgb = d + 6 * static_cast<size_t>(i);
+      StoreInterleaved_SSE41(interleaveMasks, _mm256_castsi256_si128(first), _mm256_castsi256_si128(g), _mm256_castsi256_si128(last), rgb);
+      StoreInterleaved_SSE41(interleaveMasks, _mm256_extracti128_si256(first, 1), _mm256_extracti128_si256(g, 1), _mm256_extracti128_si256(last, 1), rgb + 48);
+    }
+    Yuv422pToBmp24_SSE41(bgrOrder, s, d, i, lastPair);
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_TARGET_AVX2 void Yuv422pToGray_AVX2(const unsigned char* s, unsigned char* d, int firstPair, int lastPair)
+  {
+    int i = firstPair;
+    for (; i + 16 <= lastPair; i += 16)
+    {
+      __m256i r, g, b;
+      Yuv422pToPlanes_AVX2(s + 4 * static_cast<size_t>(i), r, g, b);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + 2 * static_cast<size_t>(i)), AverageOfPlanes_AVX2(r, g, b));
+    }
+    Yuv422pToGray_SSE41(s, d, i, lastPair);
+  }
+
+#else
+
+  //----------------------------------------------------------------------------
+  bool IsInstructionSetSupportedByCpu(PixelCodec::InstructionSet instructionSet)
+  {
+    return instructionSet == PixelCodec::InstructionSet_Scalar;
+  }
+
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool PixelCodec::IsInstructionSetAvailable(InstructionSet instructionSet)
+{
+  return IsInstructionSetSupportedByCpu(instructionSet);
+}
+
+//----------------------------------------------------------------------------
+PixelCodec::InstructionSet PixelCodec::GetBestAvailableInstructionSet()
+{
+  if (IsInstructionSetAvailable(InstructionSet_AVX2))
+  {
+    return InstructionSet_AVX2;
+  }
+  if (IsInstructionSetAvailable(InstructionSet_SSE41))
+  {
+    return InstructionSet_SSE41;
+  }
+  return InstructionSet_Scalar;
+}
+
+//----------------------------------------------------------------------------
+PixelCodec::InstructionSet PixelCodec::GetInstructionSet()
+{
+  int instructionSet = ActiveInstructionSet.load();
+  if (instructionSet < 0)
+  {
+    // Concurrent first calls may all detect the CPU features, they store the same value
+    instructionSet = GetBestAvailableInstructionSet();
+    ActiveInstructionSet.store(instructionSet);
+  }
+  return static_cast<InstructionSet>(instructionSet);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PixelCodec::SetInstructionSet(InstructionSet instructionSet)
+{
+  if (!IsInstructionSetAvailable(instructionSet))
+  {
+    LOG_ERROR("Instruction set " << GetInstructionSetAsString(instructionSet) << " is not available on this computer");
+    return PLUS_FAIL;
+  }
+  ActiveInstructionSet.store(instructionSet);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+std::string PixelCodec::GetInstructionSetAsString(InstructionSet instructionSet)
+{
+  switch (instructionSet)
+  {
+    case InstructionSet_Scalar:
+      return "Scalar";
+    case InstructionSet_SSE41:
+      return "SSE4.1";
+    case InstructionSet_AVX2:
+      return "AVX2";
+    default:
+      return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+void PixelCodec::RgbBgrSwap(int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads /*=1*/)
+{
+  InstructionSet instructionSet = GetInstructionSet();
+  ForEachRowBand(height, width, numberOfThreads, [instructionSet, s, d](int firstPixel, int lastPixel)
+  {
+#ifdef PIXELCODEC_X86_SIMD
+    if (instructionSet != InstructionSet_Scalar)
+    {
+      RgbBgrSwap_SSE41(s, d, firstPixel, lastPixel);
+      return;
+    }
+#endif
+    RgbBgrSwapScalar(s, d, firstPixel, lastPixel);
+  });
+}
+
+//----------------------------------------------------------------------------
+void PixelCodec::Rgba32ToBgr24(int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads /*=1*/)
+{
+  InstructionSet instructionSet = GetInstructionSet();
+  ForEachRowBand(height, width, numberOfThreads, [instructionSet, s, d](int firstPixel, int lastPixel)
+  {
+#ifdef PIXELCODEC_X86_SIMD
+    if (instructionSet != InstructionSet_Scalar)
+    {
+      Rgba32ToBmp24_SSE41(true, s, d, firstPixel, lastPixel);
+      return;
+    }
+#endif
+    Rgba32ToBmp24Scalar(true, s, d, firstPixel, lastPixel);
+  });
+}
+
+//----------------------------------------------------------------------------
+void PixelCodec::Rgba32ToRgb24(int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads /*=1*/)
+{
+  InstructionSet instructionSet = GetInstructionSet();
+  ForEachRowBand(height, width, numberOfThreads, [instructionSet, s, d](int firstPixel, int lastPixel)
+  {
+#ifdef PIXELCODEC_X86_SIMD
+    if (instructionSet != InstructionSet_Scalar)
+    {
+      Rgba32ToBmp24_SSE41(false, s, d, firstPixel, lastPixel);
+      return;
+    }
+#endif
+    Rgba32ToBmp24Scalar(false, s, d, firstPixel, lastPixel);
+  });
+}
+
+//----------------------------------------------------------------------------
+void PixelCodec::Rgb24ToGray(int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads /*=1*/)
+{
+  InstructionSet instructionSet = GetInstructionSet();
+  ForEachRowBand(height, width, numberOfThreads, [instructionSet, s, d](int firstPixel, int lastPixel)
+  {
+#ifdef PIXELCODEC_X86_SIMD
+    if (instructionSet != InstructionSet_Scalar)
+    {
+      Rgb24ToGray_SSE41(s, d, firstPixel, lastPixel);
+      return;
+    }
+#endif
+    RgbToGrayScalar<3>(s, d, firstPixel, lastPixel);
+  });
+}
+
+//----------------------------------------------------------------------------
+void PixelCodec::Rgba32ToGray(int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads /*=1*/)
+{
+  InstructionSet instructionSet = GetInstructionSet();
+  ForEachRowBand(height, width, numberOfThreads, [instructionSet, s, d](int firstPixel, int lastPixel)
+  {
+#ifdef PIXELCODEC_X86_SIMD
+    switch (instructionSet)
+    {
+      case InstructionSet_AVX2:
+        Rgba32ToGray_AVX2(s, d, firstPixel, lastPixel);
+        return;
+      case InstructionSet_SSE41:
+        Rgba32ToGray_SSE41(s, d, firstPixel, lastPixel);
+        return;
+      default:
+        break;
+    }
+#endif
+    RgbToGrayScalar<4>(s, d, firstPixel, lastPixel);
+  });
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PixelCodec::Yuv422pToBmp24(ComponentOrdering outputOrdering, int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads /*=1*/)
+{
+  InstructionSet instructionSet = GetInstructionSet();
+  bool bgrOrder = (outputOrdering == ComponentOrder_BGR);
+  ForEachRowBand(height, width / 2, numberOfThreads, [instructionSet, bgrOrder, s, d](int firstPair, int lastPair)
+  {
+#ifdef PIXELCODEC_X86_SIMD
+    switch (instructionSet)
+    {
+      case InstructionSet_AVX2:
+        Yuv422pToBmp24_AVX2(bgrOrder, s, d, firstPair, lastPair);
+        return;
+      case InstructionSet_SSE41:
+        Yuv422pToBmp24_SSE41(bgrOrder, s, d, firstPair, lastPair);
+        return;
+      default:
+        break;
+    }
+#endif
+    Yuv422pToBmp24Scalar(bgrOrder, s, d, firstPair, lastPair);
+  });
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PixelCodec::Yuv422pToGray(int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads /*=1*/)
+{
+  InstructionSet instructionSet = GetInstructionSet();
+  ForEachRowBand(height, width / 2, numberOfThreads, [instructionSet, s, d](int firstPair, int lastPair)
+  {
+#ifdef PIXELCODEC_X86_SIMD
+    switch (instructionSet)
+    {
+      case InstructionSet_AVX2:
+        Yuv422pToGray_AVX2(s, d, firstPair, lastPair);
+        return;
+      case InstructionSet_SSE41:
+        Yuv422pToGray_SSE41(s, d, firstPair, lastPair);
+        return;
+      default:
+        break;
+    }
+#endif
+    Yuv422pToGrayScalar(s, d, firstPair, lastPair);
+  });
+}
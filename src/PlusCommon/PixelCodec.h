@@ -8,6 +8,7 @@ See License.txt for details.
 #define __PixelCodec_h
 
 #include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
 
 #include <iomanip>
 
@@ -41,11 +42,23 @@ static const long VTK_BI_YUY2 = 0x32595559;
 /*!
 \class PixelCodec
 \brief A utility class that contains static functions for converting between various pixel encodings
+
+Conversions use SSE4.1 or AVX2 instructions if the processor supports them (selected at runtime, see SetInstructionSet).
+All instruction sets produce bit-identical output. Large frames can be converted on multiple threads
+by specifying numberOfThreads (0 = one per processor core), the frame is then split into bands of rows.
+
 \ingroup PlusLibCommon
 */
-class PixelCodec
+class vtkPlusCommonExport PixelCodec
 {
 public:
+  enum InstructionSet
+  {
+    InstructionSet_Scalar,
+    InstructionSet_SSE41,
+    InstructionSet_AVX2
+  };
+
   enum ComponentOrdering
   {
     ComponentOrder_RGB,
@@ -63,6 +76,20 @@ public:
     PixelEncoding_MJPG
   };
 
+  /*! Returns true if the instruction set is supported by this build and by the processor */
+  static bool IsInstructionSetAvailable(InstructionSet instructionSet);
+
+  /*! Returns the fastest instruction set that is available on this computer */
+  static InstructionSet GetBestAvailableInstructionSet();
+
+  /*! Instruction set used by the conversions. By default the best available instruction set is used. */
+  static InstructionSet GetInstructionSet();
+
+  /*! Force an instruction set for all conversions (e.g., for testing or benchmarking). Fails if it is not available. */
+  static PlusStatus SetInstructionSet(InstructionSet instructionSet);
+
+  static std::string GetInstructionSetAsString(InstructionSet instructionSet);
+
   //----------------------------------------------------------------------------
   static bool IsConvertToGraySupported(int inputCompression)
   {
@@ -143,17 +170,17 @@ public:
   }
 
   //----------------------------------------------------------------------------
-  static inline PlusStatus ConvertToGray(int inputCompression, int width, int height, unsigned char* s, unsigned char* d)
+  static inline PlusStatus ConvertToGray(int inputCompression, int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads = 1)
   {
     switch (inputCompression)
     {
       case BI_RGB:
         // decode the grabbed image to the requested output image type
-        Rgb24ToGray(width, height, s, d);
+        Rgb24ToGray(width, height, s, d, numberOfThreads);
         break;
       case VTK_BI_YUY2:
         // decode the grabbed image to the requested output image type
-        Yuv422pToGray(width, height, s, d);
+        Yuv422pToGray(width, height, s, d, numberOfThreads);
         break;
       case BI_JPEG:
         // TODO
@@ -166,22 +193,22 @@ public:
   }
 
   //----------------------------------------------------------------------------
-  static inline PlusStatus ConvertToGray(PixelEncoding inputCompression, int width, int height, unsigned char* s, unsigned char* d)
+  static inline PlusStatus ConvertToGray(PixelEncoding inputCompression, int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads = 1)
   {
     switch (inputCompression)
     {
       case PixelEncoding_RGB24:
       case PixelEncoding_BGR24:
         // decode the grabbed image to the requested output image type
-        Rgb24ToGray(width, height, s, d);
+        Rgb24ToGray(width, height, s, d, numberOfThreads);
         break;
       case PixelEncoding_RGBA32:
         // decode the grabbed image to the requested output image type
-        Rgba32ToGray(width, height, s, d);
+        Rgba32ToGray(width, height, s, d, numberOfThreads);
         break;
       case PixelEncoding_YUY2:
         // decode the grabbed image to the requested output image type
-        Yuv422pToGray(width, height, s, d);
+        Yuv422pToGray(width, height, s, d, numberOfThreads);
         break;
       case PixelEncoding_MJPG:
         LOG_ERROR("MJPG to grayscale conversion is not yet supported");
@@ -194,7 +221,7 @@ public:
   }
 
   //----------------------------------------------------------------------------
-  static inline PlusStatus ConvertToBmp24(ComponentOrdering outputOrdering, PixelEncoding inputCompression, int width, int height, unsigned char* s, unsigned char* d)
+  static inline PlusStatus ConvertToBmp24(ComponentOrdering outputOrdering, PixelEncoding inputCompression, int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads = 1)
   {
     switch (inputCompression)
     {
@@ -206,7 +233,7 @@ public:
         }
         else
         {
-          RgbBgrSwap(width, height, s, d);
+          RgbBgrSwap(width, height, s, d, numberOfThreads);
         }
         break;
       case PixelEncoding_BGR24:
@@ -217,22 +244,22 @@ public:
         }
         else
         {
-          RgbBgrSwap(width, height, s, d);
+          RgbBgrSwap(width, height, s, d, numberOfThreads);
         }
         break;
       case PixelEncoding_RGBA32:
         if (outputOrdering == ComponentOrder_RGBA)
         {
-          Rgba32ToRgb24(width, height, s, d);
+          Rgba32ToRgb24(width, height, s, d, numberOfThreads);
         }
         else
         {
-          Rgba32ToBgr24(width, height, s, d);
+          Rgba32ToBgr24(width, height, s, d, numberOfThreads);
         }
         break;
       case PixelEncoding_YUY2:
         // decode the grabbed image to the requested output image type
-        return Yuv422pToBmp24(outputOrdering, width, height, s, d);
+        return Yuv422pToBmp24(outputOrdering, width, height, s, d, numberOfThreads);
         break;
       case PixelEncoding_MJPG:
         return MjpgToRgb24(outputOrdering, width, height, s, d);
@@ -245,43 +272,16 @@ public:
   }
 
   //----------------------------------------------------------------------------
-  static inline void RgbBgrSwap(int width, int height, unsigned char* s, unsigned char* d)
-  {
-    int totalLen = width * height;
-    for (int i = 0; i < totalLen; i++)
-    {
-      *(d++) = s[2];
-      *(d++) = s[1];
-      *(d++) = s[0];
-      s += 3;
-    }
-  }
+  /*! Swap the first and third component of each pixel (RGB24 to BGR24 or BGR24 to RGB24) */
+  static void RgbBgrSwap(int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads = 1);
 
   //----------------------------------------------------------------------------
-  static inline void Rgba32ToBgr24(int width, int height, unsigned char* s, unsigned char* d)
-  {
-    int totalLen = width * height;
-    for (int i = 0; i < totalLen; i++)
-    {
-      *(d++) = s[2];
-      *(d++) = s[1];
-      *(d++) = s[0];
-      s += 4; // ignore alpha channel
-    }
-  }
+  /*! Convert from RGBA32 to BGR24, ignoring the alpha channel */
+  static void Rgba32ToBgr24(int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads = 1);
 
   //----------------------------------------------------------------------------
-  static inline void Rgba32ToRgb24(int width, int height, unsigned char* s, unsigned char* d)
-  {
-    int totalLen = width * height;
-    for (int i = 0; i < totalLen; i++)
-    {
-      *(d++) = *(s++);
-      *(d++) = *(s++);
-      *(d++) = *(s++);
-      s++; // ignore alpha channel
-    }
-  }
+  /*! Convert from RGBA32 to RGB24, ignoring the alpha channel */
+  static void Rgba32ToRgb24(int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads = 1);
 
   //----------------------------------------------------------------------------
   /*!
@@ -289,16 +289,7 @@ public:
   Note that this method computes the intensity (simple averaging of the RGB components).
   This is not equivalent with the perceived luminance of color images (e.g., 0.21R + 0.72G + 0.07B or 0.30R + 0.59G + 0.11B)
   */
-  static inline void Rgb24ToGray(int width, int height, unsigned char* s, unsigned char* d)
-  {
-    int totalLen = width * height;
-    for (int i = 0; i < totalLen; i++)
-    {
-      *d = ((unsigned short)(s[0]) + s[1] + s[2]) / 3;
-      d++;
-      s += 3;
-    }
-  }
+  static void Rgb24ToGray(int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads = 1);
 
   //----------------------------------------------------------------------------
   /*!
@@ -306,16 +297,7 @@ public:
   Note that this method computes the intensity (simple averaging of the RGB components).
   This is not equivalent with the perceived luminance of color images (e.g., 0.21R + 0.72G + 0.07B or 0.30R + 0.59G + 0.11B)
   */
-  static inline void Rgba32ToGray(int width, int height, unsigned char* s, unsigned char* d)
-  {
-    int totalLen = width * height;
-    for (int i = 0; i < totalLen; i++)
-    {
-      *d = ((unsigned short)(s[0]) + s[1] + s[2]) / 3;
-      d++;
-      s += 4;
-    }
-  }
+  static void Rgba32ToGray(int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads = 1);
 
   //----------------------------------------------------------------------------
   /*! Conversion from YUV to RGB space
@@ -377,94 +359,7 @@ public:
   YUY2 coding is typically used for webcams
   source: http://sundararajana.blogspot.ca/2007/12/yuy2-to-rgb24-conversion.html
   */
-  static PlusStatus Yuv422pToBmp24(ComponentOrdering outputOrdering, int width, int height, unsigned char* s, unsigned char* d)
-  {
-    unsigned char* p_dest;
-    unsigned char y1, u, y2, v;
-    int Y1, Y2, U, V;
-    unsigned char r, g, b;
-
-    p_dest = d;
-
-    int size = height * (width / 2);
-    unsigned long srcIndex = 0;
-    unsigned long dstIndex = 0;
-
-    if (outputOrdering == ComponentOrder_BGR)
-    {
-      for (int i = 0 ; i < size ; i++)
-      {
-        y1 = s[srcIndex];
-        u = s[srcIndex + 1];
-        y2 = s[srcIndex + 2];
-        v = s[srcIndex + 3];
-
-        Y1 = ICCIRY(y1);
-        U = ICCIRUV(u - 128);
-        Y2 = ICCIRY(y2);
-        V = ICCIRUV(v - 128);
-
-        r = CLIP(GET_R_FROM_YUV(Y1, U, V));
-        g = CLIP(GET_G_FROM_YUV(Y1, U, V));
-        b = CLIP(GET_B_FROM_YUV(Y1, U, V));
-
-        p_dest[dstIndex] = b;
-        p_dest[dstIndex + 1] = g;
-        p_dest[dstIndex + 2] = r;
-
-        dstIndex += 3;
-
-        r = CLIP(GET_R_FROM_YUV(Y2, U, V));
-        g = CLIP(GET_G_FROM_YUV(Y2, U, V));
-        b = CLIP(GET_B_FROM_YUV(Y2, U, V));
-
-        p_dest[dstIndex] = b;
-        p_dest[dstIndex + 1] = g;
-        p_dest[dstIndex + 2] = r;
-
-        dstIndex += 3;
-        srcIndex += 4;
-      }
-    }
-    else
-    {
-      for (int i = 0 ; i < size ; i++)
-      {
-        y1 = s[srcIndex];
-        u = s[srcIndex + 1];
-        y2 = s[srcIndex + 2];
-        v = s[srcIndex + 3];
-
-        Y1 = ICCIRY(y1);
-        U = ICCIRUV(u - 128);
-        Y2 = ICCIRY(y2);
-        V = ICCIRUV(v - 128);
-
-        r = CLIP(GET_R_FROM_YUV(Y1, U, V));
-        g = CLIP(GET_G_FROM_YUV(Y1, U, V));
-        b = CLIP(GET_B_FROM_YUV(Y1, U, V));
-
-        p_dest[dstIndex] = r;
-        p_dest[dstIndex + 1] = g;
-        p_dest[dstIndex + 2] = b;
-
-        dstIndex += 3;
-
-        r = CLIP(GET_R_FROM_YUV(Y2, U, V));
-        g = CLIP(GET_G_FROM_YUV(Y2, U, V));
-        b = CLIP(GET_B_FROM_YUV(Y2, U, V));
-
-        p_dest[dstIndex] = r;
-        p_dest[dstIndex + 1] = g;
-        p_dest[dstIndex + 2] = b;
-
-        dstIndex += 3;
-        srcIndex += 4;
-      }
-    }
-
-    return PLUS_SUCCESS;
-  }
+  static PlusStatus Yuv422pToBmp24(ComponentOrdering outputOrdering, int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads = 1);
 
   //----------------------------------------------------------------------------
   /*!
@@ -472,49 +367,7 @@ public:
   YUY2 coding is typically used for webcams
   source: http://sundararajana.blogspot.ca/2007/12/yuy2-to-rgb24-conversion.html
   */
-  static void Yuv422pToGray(int width, int height, unsigned char* s, unsigned char* d)
-  {
-    int i;
-    unsigned char* p_dest;
-    unsigned char y1, u, y2, v;
-    int Y1, Y2, U, V;
-    unsigned char r, g, b;
-
-    p_dest = d;
-
-    int size = height * (width / 2);
-    unsigned long srcIndex = 0;
-    unsigned long dstIndex = 0;
-
-    for (i = 0 ; i < size ; i++)
-    {
-      y1 = s[srcIndex];
-      u = s[srcIndex + 1];
-      y2 = s[srcIndex + 2];
-      v = s[srcIndex + 3];
-
-      Y1 = ICCIRY(y1);
-      U = ICCIRUV(u - 128);
-      Y2 = ICCIRY(y2);
-      V = ICCIRUV(v - 128);
-
-      r = CLIP(GET_R_FROM_YUV(Y1, U, V));
-      g = CLIP(GET_G_FROM_YUV(Y1, U, V));
-      b = CLIP(GET_B_FROM_YUV(Y1, U, V));
-
-      p_dest[dstIndex] = (int(b) + g + r) / 3;
-      dstIndex ++;
-
-      r = CLIP(GET_R_FROM_YUV(Y2, U, V));
-      g = CLIP(GET_G_FROM_YUV(Y2, U, V));
-      b = CLIP(GET_B_FROM_YUV(Y2, U, V));
-
-      p_dest[dstIndex] = (int(b) + g + r) / 3;
-
-      dstIndex ++;
-      srcIndex += 4;
-    }
-  }
+  static void Yuv422pToGray(int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads = 1);
 
 private:
   PixelCodec(); // prevent instantiation
@@ -19,13 +19,189 @@ See License.txt for details.
 
 // STL includes
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iomanip>
 #include <string>
+#include <thread>
 
 #ifdef PLUS_USE_OpenIGTLink
 // IGTL includes
 #include <igtlImageMessage.h>
 #endif
 
+//----------------------------------------------------------------------------
+unsigned int PlusCommon::GetNumberOfWorkerThreads(unsigned int requestedNumberOfThreads)
+{
+  if (requestedNumberOfThreads > 0)
+  {
+    return requestedNumberOfThreads;
+  }
+  unsigned int numberOfCores = std::thread::hardware_concurrency();
+  return (numberOfCores > 0 ? numberOfCores : 1);
+}
+
+//----------------------------------------------------------------------------
+void PlusCommon::ParallelFor(unsigned int numberOfItems, const std::function<void(unsigned int)>& itemFunction, unsigned int numberOfThreads /*=0*/)
+{
+  unsigned int numberOfWorkers = std::min(GetNumberOfWorkerThreads(numberOfThreads), numberOfItems);
+  if (numberOfWorkers <= 1)
+  {
+    for (unsigned int itemIndex = 0; itemIndex < numberOfItems; ++itemIndex)
+    {
+      itemFunction(itemIndex);
+    }
+    return;
+  }
+
+  std::atomic<unsigned int> nextItemIndex(0);
+  auto worker = [&nextItemIndex, &itemFunction, numberOfItems]()
+  {
+    for (unsigned int itemIndex = nextItemIndex++; itemIndex < numberOfItems; itemIndex = nextItemIndex++)
+    {
+      itemFunction(itemIndex);
+    }
+  };
+
+  // The calling thread is one of the workers
+  std::vector<std::thread> threads;
+  threads.reserve(numberOfWorkers - 1);
+  for (unsigned int i = 0; i + 1 < numberOfWorkers; ++i)
+  {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it)
+  {
+    it->join();
+  }
+}
+
+//----------------------------------------------------------------------------
+namespace
+{
+  const vtkTypeUInt64 XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+  const vtkTypeUInt64 XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+  const vtkTypeUInt64 XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+  const vtkTypeUInt64 XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+  const vtkTypeUInt64 XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+  inline vtkTypeUInt64 XxhRotateLeft(vtkTypeUInt64 value, int bits)
+  {
+    return (value << bits) | (value >> (64 - bits));
+  }
+
+  inline vtkTypeUInt64 XxhRead64(const unsigned char* ptr)
+  {
+    vtkTypeUInt64 value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+  }
+
+  inline vtkTypeUInt64 XxhRead32(const unsigned char* ptr)
+  {
+    vtkTypeUInt32 value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+  }
+
+  inline vtkTypeUInt64 XxhRound(vtkTypeUInt64 accumulator, vtkTypeUInt64 input)
+  {
+    accumulator += input * XXH_PRIME64_2;
+    accumulator = XxhRotateLeft(accumulator, 31);
+    return accumulator * XXH_PRIME64_1;
+  }
+
+  inline vtkTypeUInt64 XxhMergeRound(vtkTypeUInt64 accumulator, vtkTypeUInt64 value)
+  {
+    accumulator ^= XxhRound(0, value);
+    return accumulator * XXH_PRIME64_1 + XXH_PRIME64_4;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 PlusCommon::ComputeHash64(const void* data, size_t numberOfBytes, vtkTypeUInt64 seed /*=0*/)
+{
+  const unsigned char* ptr = static_cast<const unsigned char*>(data);
+  const unsigned char* const end = ptr + numberOfBytes;
+  vtkTypeUInt64 hash = 0;
+
+  if (numberOfBytes >= 32)
+  {
+    // Four independent lanes, processing 32 bytes per iteration
+    const unsigned char* const limit = end - 32;
+    vtkTypeUInt64 v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+    vtkTypeUInt64 v2 = seed + XXH_PRIME64_2;
+    vtkTypeUInt64 v3 = seed;
+    vtkTypeUInt64 v4 = seed - XXH_PRIME64_1;
+    do
+    {
+      v1 = XxhRound(v1, XxhRead64(ptr));
+      v2 = XxhRound(v2, XxhRead64(ptr + 8));
+      v3 = XxhRound(v3, XxhRead64(ptr + 16));
+      v4 = XxhRound(v4, XxhRead64(ptr + 24));
+      ptr += 32;
+    }
+    while (ptr <= limit);
+
+    hash = XxhRotateLeft(v1, 1) + XxhRotateLeft(v2, 7) + XxhRotateLeft(v3, 12) + XxhRotateLeft(v4, 18);
+    hash = XxhMergeRound(hash, v1);
+    hash = XxhMergeRound(hash, v2);
+    hash = XxhMergeRound(hash, v3);
+    hash = XxhMergeRound(hash, v4);
+  }
+  else
+  {
+    hash = seed + XXH_PRIME64_5;
+  }
+
+  hash += static_cast<vtkTypeUInt64>(numberOfBytes);
+
+  // Remaining bytes
+  for (; ptr + 8 <= end; ptr += 8)
+  {
+    hash ^= XxhRound(0, XxhRead64(ptr));
+    hash = XxhRotateLeft(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+  }
+  if (ptr + 4 <= end)
+  {
+    hash ^= XxhRead32(ptr) * XXH_PRIME64_1;
+    hash = XxhRotateLeft(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+    ptr += 4;
+  }
+  for (; ptr < end; ++ptr)
+  {
+    hash ^= (*ptr) * XXH_PRIME64_5;
+    hash = XxhRotateLeft(hash, 11) * XXH_PRIME64_1;
+  }
+
+  // Avalanche
+  hash ^= hash >> 33;
+  hash *= XXH_PRIME64_2;
+  hash ^= hash >> 29;
+  hash *= XXH_PRIME64_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+//----------------------------------------------------------------------------
+std::string PlusCommon::GetHashString(const void* data, size_t numberOfBytes)
+{
+  std::ostringstream hashString;
+  hashString << std::hex << std::setfill('0') << std::setw(16) << ComputeHash64(data, numberOfBytes);
+  return hashString.str();
+}
+
+//----------------------------------------------------------------------------
+std::string PlusCommon::GetFrameHashString(igsioVideoFrame& frame)
+{
+  if (!frame.IsImageValid() || frame.GetImage()->GetScalarPointer() == NULL)
+  {
+    return "";
+  }
+  return GetHashString(frame.GetImage()->GetScalarPointer(), frame.GetFrameSizeInBytes());
+}
+
 //----------------------------------------------------------------------------
 std::string PlusCommon::GetPlusLibVersionString()
 {
@@ -26,6 +26,7 @@
 
 // STL includes
 #include <array>
+#include <functional>
 #include <list>
 #include <locale>
 #include <sstream>
@@ -59,6 +60,28 @@ namespace PlusCommon
 
   vtkPlusCommonExport PlusStatus WriteToFile(igsioTrackedFrame* frame, const std::string& filename, vtkMatrix4x4* imageToTracker);
 
+  /*! Number of worker threads to use for the requested thread count (0 means one thread per processor core) */
+  vtkPlusCommonExport unsigned int GetNumberOfWorkerThreads(unsigned int requestedNumberOfThreads);
+
+  /*!
+    Call itemFunction(itemIndex) for each item index in [0, numberOfItems) on a pool of worker threads.
+    Items are handed out to the threads one by one, so items with uneven processing time are balanced.
+    The function returns when all items are processed. itemFunction must be thread-safe.
+  */
+  vtkPlusCommonExport void ParallelFor(unsigned int numberOfItems, const std::function<void(unsigned int)>& itemFunction, unsigned int numberOfThreads = 0);
+
+  /*!
+    Compute a fast non-cryptographic 64-bit hash (XXH64) of a memory block.
+    Words are read in native byte order, so the hash of the same data differs on big-endian systems.
+  */
+  vtkPlusCommonExport vtkTypeUInt64 ComputeHash64(const void* data, size_t numberOfBytes, vtkTypeUInt64 seed = 0);
+
+  /*! ComputeHash64 of a memory block as a 16-digit hexadecimal string */
+  vtkPlusCommonExport std::string GetHashString(const void* data, size_t numberOfBytes);
+
+  /*! Hash of the pixel data of a frame as a 16-digit hexadecimal string. Returns an empty string if the frame has no valid image. */
+  vtkPlusCommonExport std::string GetFrameHashString(igsioVideoFrame& frame);
+
 #ifdef PLUS_USE_OpenIGTLink
   /*! Convert between ITK and IGTL scalar pixel types */
   vtkPlusCommonExport IGTLScalarPixelType GetIGTLScalarPixelTypeFromVTK(igsioCommon::VTKScalarPixelType vtkScalarPixelType);
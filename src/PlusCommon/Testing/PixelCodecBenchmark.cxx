@@ -0,0 +1,143 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file PixelCodecBenchmark.cxx
+Measures the throughput of the PixelCodec conversions with each available instruction set and with multiple threads.
+*/
+
+#include "PlusConfigure.h"
+#include "PixelCodec.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// IGSIO includes
+#include <vtkIGSIOAccurateTimer.h>
+
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void FillRandom(std::vector<unsigned char>& pixels)
+  {
+    // Simple linear congruential generator to get the same image on all platforms
+    unsigned int state = 12345;
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+      state = state * 1103515245 + 12345;
+      pixels[i] = static_cast<unsigned char>(state >> 16);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void Convert(int conversion, int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads)
+  {
+    switch (conversion)
+    {
+      case 0: PixelCodec::RgbBgrSwap(width, height, s, d, numberOfThreads); break;
+      case 1: PixelCodec::Rgba32ToRgb24(width, height, s, d, numberOfThreads); break;
+      case 2: PixelCodec::Rgb24ToGray(width, height, s, d, numberOfThreads); break;
+      case 3: PixelCodec::Rgba32ToGray(width, height, s, d, numberOfThreads); break;
+      case 4: PixelCodec::Yuv422pToBmp24(PixelCodec::ComponentOrder_RGB, width, height, s, d, numberOfThreads); break;
+      case 5: PixelCodec::Yuv422pToGray(width, height, s, d, numberOfThreads); break;
+      default: break;
+    }
+  }
+  const char* CONVERSION_NAMES[] = { "RgbBgrSwap", "Rgba32ToRgb24", "Rgb24ToGray", "Rgba32ToGray", "Yuv422pToBmp24", "Yuv422pToGray" };
+  const int NUMBER_OF_CONVERSIONS = sizeof(CONVERSION_NAMES) / sizeof(CONVERSION_NAMES[0]);
+
+  //----------------------------------------------------------------------------
+  // Returns the average computation time of one conversion, in seconds
+  double MeasureConversionTimeSec(int conversion, int width, int height, std::vector<unsigned char>& input, std::vector<unsigned char>& output,
+                                  unsigned int numberOfThreads, int numberOfIterations)
+  {
+    // First conversion warms up the caches, it is not included in the measurement
+    Convert(conversion, width, height, &input[0], &output[0], numberOfThreads);
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfIterations; i++)
+    {
+      Convert(conversion, width, height, &input[0], &output[0], numberOfThreads);
+    }
+    return (vtkIGSIOAccurateTimer::GetSystemTime() - startTime) / numberOfIterations;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  vtksys::CommandLineArguments args;
+
+  int width = 1920;
+  int height = 1080;
+  int numberOfIterations = 20;
+  int numberOfThreads = 0;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--width", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &width, "Width of the generated frame (default: 1920).");
+  args.AddArgument("--height", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &height, "Height of the generated frame (default: 1080).");
+  args.AddArgument("--iterations", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfIterations, "Number of conversions to average the computation time over (default: 20).");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads used in the multi-threaded measurement (default: 0 = one per processor core).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (width < 2 || height < 1 || numberOfIterations < 1 || numberOfThreads < 0)
+  {
+    LOG_ERROR("Invalid frame size, number of iterations or number of threads");
+    return EXIT_FAILURE;
+  }
+
+  size_t numberOfPixels = static_cast<size_t>(width) * height;
+  std::vector<unsigned char> input(numberOfPixels * 4);
+  std::vector<unsigned char> output(numberOfPixels * 3);
+  FillRandom(input);
+
+  const PixelCodec::InstructionSet defaultInstructionSet = PixelCodec::GetInstructionSet();
+  for (int conversion = 0; conversion < NUMBER_OF_CONVERSIONS; conversion++)
+  {
+    LOG_INFO(CONVERSION_NAMES[conversion] << " " << width << "x" << height);
+    double scalarTimeSec = 0;
+    for (int instructionSet = PixelCodec::InstructionSet_Scalar; instructionSet <= PixelCodec::InstructionSet_AVX2; instructionSet++)
+    {
+      if (!PixelCodec::IsInstructionSetAvailable(static_cast<PixelCodec::InstructionSet>(instructionSet)))
+      {
+        continue;
+      }
+      PixelCodec::SetInstructionSet(static_cast<PixelCodec::InstructionSet>(instructionSet));
+      double timeSec = MeasureConversionTimeSec(conversion, width, height, input, output, 1, numberOfIterations);
+      if (instructionSet == PixelCodec::InstructionSet_Scalar)
+      {
+        scalarTimeSec = timeSec;
+      }
+      LOG_INFO("  " << PixelCodec::GetInstructionSetAsString(static_cast<PixelCodec::InstructionSet>(instructionSet)) << ": "
+               << timeSec * 1000.0 << " ms/frame, " << numberOfPixels / timeSec / 1e6 << " Mpixel/s, speedup: " << scalarTimeSec / timeSec);
+    }
+    PixelCodec::SetInstructionSet(defaultInstructionSet);
+    double multiThreadedTimeSec = MeasureConversionTimeSec(conversion, width, height, input, output, numberOfThreads, numberOfIterations);
+    LOG_INFO("  " << PixelCodec::GetInstructionSetAsString(defaultInstructionSet) << ", " << PlusCommon::GetNumberOfWorkerThreads(numberOfThreads) << " threads: "
+             << multiThreadedTimeSec * 1000.0 << " ms/frame, " << numberOfPixels / multiThreadedTimeSec / 1e6 << " Mpixel/s, speedup: " << scalarTimeSec / multiThreadedTimeSec);
+  }
+
+  return EXIT_SUCCESS;
+}
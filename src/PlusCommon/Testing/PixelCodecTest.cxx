@@ -0,0 +1,370 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file PixelCodecTest.cxx
+Verifies that all PixelCodec conversions produce bit-identical output with each available instruction set and with
+multiple threads, compared to the original scalar implementation. Also verifies that nothing is written past the output buffer.
+*/
+
+#include "PlusConfigure.h"
+#include "PixelCodec.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+#include <vector>
+
+namespace
+{
+  // Original scalar implementation of the conversions, the results must be identical to these
+  namespace Reference
+  {
+    //----------------------------------------------------------------------------
+    void RgbBgrSwap(int width, int height, const unsigned char* s, unsigned char* d)
+    {
+      int totalLen = width * height;
+      for (int i = 0; i < totalLen; i++)
+      {
+        *(d++) = s[2];
+        *(d++) = s[1];
+        *(d++) = s[0];
+        s += 3;
+      }
+    }
+
+    //----------------------------------------------------------------------------
+    void Rgba32ToBgr24(int width, int height, const unsigned char* s, unsigned char* d)
+    {
+      int totalLen = width * height;
+      for (int i = 0; i < totalLen; i++)
+      {
+        *(d++) = s[2];
+        *(d++) = s[1];
+        *(d++) = s[0];
+        s += 4;
+      }
+    }
+
+    //----------------------------------------------------------------------------
+    void Rgba32ToRgb24(int width, int height, const unsigned char* s, unsigned char* d)
+    {
+      int totalLen = width * height;
+      for (int i = 0; i < totalLen; i++)
+      {
+        *(d++) = *(s++);
+        *(d++) = *(s++);
+        *(d++) = *(s++);
+        s++;
+      }
+    }
+
+    //----------------------------------------------------------------------------
+    void Rgb24ToGray(int width, int height, const unsigned char* s, unsigned char* d)
+    {
+      int totalLen = width * height;
+      for (int i = 0; i < totalLen; i++)
+      {
+        *d = ((unsigned short)(s[0]) + s[1] + s[2]) / 3;
+        d++;
+        s += 3;
+      }
+    }
+
+    //----------------------------------------------------------------------------
+    void Rgba32ToGray(int width, int height, const unsigned char* s, unsigned char* d)
+    {
+      int totalLen = width * height;
+      for (int i = 0; i < totalLen; i++)
+      {
+        *d = ((unsigned short)(s[0]) + s[1] + s[2]) / 3;
+        d++;
+        s += 4;
+      }
+    }
+
+    //----------------------------------------------------------------------------
+    void Yuv422pToBmp24(PixelCodec::ComponentOrdering outputOrdering, int width, int height, const unsigned char* s, unsigned char* d)
+    {
+      int size = height * (width / 2);
+      for (int i = 0 ; i < size ; i++)
+      {
+        int Y1 = ICCIRY(s[0]);
+        int U = ICCIRUV(s[1] - 128);
+        int Y2 = ICCIRY(s[2]);
+        int V = ICCIRUV(s[3] - 128);
+        unsigned char pixels[2][3] =
+        {
+          { (unsigned char)CLIP(GET_R_FROM_YUV(Y1, U, V)), (unsigned char)CLIP(GET_G_FROM_YUV(Y1, U, V)), (unsigned char)CLIP(GET_B_FROM_YUV(Y1, U, V)) },
+          { (unsigned char)CLIP(GET_R_FROM_YUV(Y2, U, V)), (unsigned char)CLIP(GET_G_FROM_YUV(Y2, U, V)), (unsigned char)CLIP(GET_B_FROM_YUV(Y2, U, V)) }
+        };
+        for (int p = 0; p < 2; p++)
+        {
+          *(d++) = (outputOrdering == PixelCodec::ComponentOrder_BGR ? pixels[p][2] : pixels[p][0]);
+          *(d++) = pixels[p][1];
+          *(d++) = (outputOrdering == PixelCodec::ComponentOrder_BGR ? pixels[p][0] : pixels[p][2]);
+        }
+        s += 4;
+      }
+    }
+
+    //----------------------------------------------------------------------------
+    void Yuv422pToGray(int width, int height, const unsigned char* s, unsigned char* d)
+    {
+      int size = height * (width / 2);
+      for (int i = 0 ; i < size ; i++)
+      {
+        int Y1 = ICCIRY(s[0]);
+        int U = ICCIRUV(s[1] - 128);
+        int Y2 = ICCIRY(s[2]);
+        int V = ICCIRUV(s[3] - 128);
+
+        unsigned char r = CLIP(GET_R_FROM_YUV(Y1, U, V));
+        unsigned char g = CLIP(GET_G_FROM_YUV(Y1, U, V));
+        unsigned char b = CLIP(GET_B_FROM_YUV(Y1, U, V));
+        *(d++) = (int(b) + g + r) / 3;
+
+        r = CLIP(GET_R_FROM_YUV(Y2, U, V));
+        g = CLIP(GET_G_FROM_YUV(Y2, U, V));
+        b = CLIP(GET_B_FROM_YUV(Y2, U, V));
+        *(d++) = (int(b) + g + r) / 3;
+        s += 4;
+      }
+    }
+  }
+
+  // Bytes after the end of the output buffer that must not be modified
+  const int GUARD_SIZE = 64;
+  const unsigned char GUARD_VALUE = 0xA5;
+
+  //----------------------------------------------------------------------------
+  void FillRandom(std::vector<unsigned char>& pixels, unsigned int seed)
+  {
+    // Simple linear congruential generator to get the same image on all platforms
+    unsigned int state = seed;
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+      state = state * 1103515245 + 12345;
+      pixels[i] = static_cast<unsigned char>(state >> 16);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! YUY2 frame that contains all U,V combinations and all Y values (width=512, height=256) */
+  void FillAllYuvCombinations(std::vector<unsigned char>& yuy2)
+  {
+    yuy2.resize(512 * 256 * 2);
+    for (int u = 0; u < 256; u++)
+    {
+      for (int pair = 0; pair < 256; pair++)
+      {
+        unsigned char* yuyv = &yuy2[(u * 256 + pair) * 4];
+        yuyv[0] = static_cast<unsigned char>(pair);
+        yuyv[1] = static_cast<unsigned char>(u);
+        yuyv[2] = static_cast<unsigned char>(255 - pair);
+        yuyv[3] = static_cast<unsigned char>(pair);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  enum ConversionType
+  {
+    Conversion_RgbBgrSwap,
+    Conversion_Rgba32ToBgr24,
+    Conversion_Rgba32ToRgb24,
+    Conversion_Rgb24ToGray,
+    Conversion_Rgba32ToGray,
+    Conversion_Yuv422pToRgb24,
+    Conversion_Yuv422pToBgr24,
+    Conversion_Yuv422pToGray,
+    Conversion_Last
+  };
+
+  //----------------------------------------------------------------------------
+  std::string GetConversionName(ConversionType conversion)
+  {
+    switch (conversion)
+    {
+      case Conversion_RgbBgrSwap: return "RgbBgrSwap";
+      case Conversion_Rgba32ToBgr24: return "Rgba32ToBgr24";
+      case Conversion_Rgba32ToRgb24: return "Rgba32ToRgb24";
+      case Conversion_Rgb24ToGray: return "Rgb24ToGray";
+      case Conversion_Rgba32ToGray: return "Rgba32ToGray";
+      case Conversion_Yuv422pToRgb24: return "Yuv422pToRgb24";
+      case Conversion_Yuv422pToBgr24: return "Yuv422pToBgr24";
+      case Conversion_Yuv422pToGray: return "Yuv422pToGray";
+      default: return "Unknown";
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void GetBytesPerPixel(ConversionType conversion, int& inputBytesPerPixel, int& outputBytesPerPixel)
+  {
+    switch (conversion)
+    {
+      case Conversion_RgbBgrSwap: inputBytesPerPixel = 3; outputBytesPerPixel = 3; break;
+      case Conversion_Rgba32ToBgr24: inputBytesPerPixel = 4; outputBytesPerPixel = 3; break;
+      case Conversion_Rgba32ToRgb24: inputBytesPerPixel = 4; outputBytesPerPixel = 3; break;
+      case Conversion_Rgb24ToGray: inputBytesPerPixel = 3; outputBytesPerPixel = 1; break;
+      case Conversion_Rgba32ToGray: inputBytesPerPixel = 4; outputBytesPerPixel = 1; break;
+      case Conversion_Yuv422pToRgb24: inputBytesPerPixel = 2; outputBytesPerPixel = 3; break;
+      case Conversion_Yuv422pToBgr24: inputBytesPerPixel = 2; outputBytesPerPixel = 3; break;
+      case Conversion_Yuv422pToGray: inputBytesPerPixel = 2; outputBytesPerPixel = 1; break;
+      default: inputBytesPerPixel = 0; outputBytesPerPixel = 0;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void ConvertReference(ConversionType conversion, int width, int height, const unsigned char* s, unsigned char* d)
+  {
+    switch (conversion)
+    {
+      case Conversion_RgbBgrSwap: Reference::RgbBgrSwap(width, height, s, d); break;
+      case Conversion_Rgba32ToBgr24: Reference::Rgba32ToBgr24(width, height, s, d); break;
+      case Conversion_Rgba32ToRgb24: Reference::Rgba32ToRgb24(width, height, s, d); break;
+      case Conversion_Rgb24ToGray: Reference::Rgb24ToGray(width, height, s, d); break;
+      case Conversion_Rgba32ToGray: Reference::Rgba32ToGray(width, height, s, d); break;
+      case Conversion_Yuv422pToRgb24: Reference::Yuv422pToBmp24(PixelCodec::ComponentOrder_RGB, width, height, s, d); break;
+      case Conversion_Yuv422pToBgr24: Reference::Yuv422pToBmp24(PixelCodec::ComponentOrder_BGR, width, height, s, d); break;
+      case Conversion_Yuv422pToGray: Reference::Yuv422pToGray(width, height, s, d); break;
+      default: break;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void Convert(ConversionType conversion, int width, int height, unsigned char* s, unsigned char* d, unsigned int numberOfThreads)
+  {
+    switch (conversion)
+    {
+      case Conversion_RgbBgrSwap: PixelCodec::RgbBgrSwap(width, height, s, d, numberOfThreads); break;
+      case Conversion_Rgba32ToBgr24: PixelCodec::Rgba32ToBgr24(width, height, s, d, numberOfThreads); break;
+      case Conversion_Rgba32ToRgb24: PixelCodec::Rgba32ToRgb24(width, height, s, d, numberOfThreads); break;
+      case Conversion_Rgb24ToGray: PixelCodec::Rgb24ToGray(width, height, s, d, numberOfThreads); break;
+      case Conversion_Rgba32ToGray: PixelCodec::Rgba32ToGray(width, height, s, d, numberOfThreads); break;
+      case Conversion_Yuv422pToRgb24: PixelCodec::Yuv422pToBmp24(PixelCodec::ComponentOrder_RGB, width, height, s, d, numberOfThreads); break;
+      case Conversion_Yuv422pToBgr24: PixelCodec::Yuv422pToBmp24(PixelCodec::ComponentOrder_BGR, width, height, s, d, numberOfThreads); break;
+      case Conversion_Yuv422pToGray: PixelCodec::Yuv422pToGray(width, height, s, d, numberOfThreads); break;
+      default: break;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Convert the input with the current instruction set and compare the result to the reference implementation */
+  PlusStatus TestConversion(ConversionType conversion, int width, int height, std::vector<unsigned char>& input, unsigned int numberOfThreads)
+  {
+    int inputBytesPerPixel = 0;
+    int outputBytesPerPixel = 0;
+    GetBytesPerPixel(conversion, inputBytesPerPixel, outputBytesPerPixel);
+    size_t numberOfPixels = static_cast<size_t>(width) * height;
+    if (input.size() < numberOfPixels * inputBytesPerPixel)
+    {
+      LOG_ERROR("Input buffer is too small for " << width << "x" << height << " frame");
+      return PLUS_FAIL;
+    }
+
+    // Output bytes that are not written by the conversion (e.g., last column of odd-width YUY2 frames) keep the guard value
+    std::vector<unsigned char> expectedOutput(numberOfPixels * outputBytesPerPixel + GUARD_SIZE, GUARD_VALUE);
+    std::vector<unsigned char> output(expectedOutput.size(), GUARD_VALUE);
+    ConvertReference(conversion, width, height, &input[0], &expectedOutput[0]);
+    Convert(conversion, width, height, &input[0], &output[0], numberOfThreads);
+
+    for (size_t i = 0; i < output.size(); i++)
+    {
+      if (output[i] != expectedOutput[i])
+      {
+        LOG_ERROR(GetConversionName(conversion) << " (" << PixelCodec::GetInstructionSetAsString(PixelCodec::GetInstructionSet())
+                  << ", " << numberOfThreads << " threads) of " << width << "x" << height << " frame differs from the reference at byte " << i
+                  << ": " << int(output[i]) << " (expected " << int(expectedOutput[i]) << ")");
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  vtksys::CommandLineArguments args;
+
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  // Frame sizes include sizes that are not multiples of the SIMD block sizes and a frame that is split into multiple bands
+  const int frameSizes[][2] = { { 1, 1 }, { 2, 1 }, { 7, 3 }, { 33, 17 }, { 95, 5 }, { 640, 480 }, { 1921, 1081 } };
+  const int numberOfFrameSizes = sizeof(frameSizes) / sizeof(frameSizes[0]);
+  const unsigned int threadCounts[] = { 1, 4 };
+
+  std::vector<unsigned char> randomInput(static_cast<size_t>(frameSizes[numberOfFrameSizes - 1][0]) * frameSizes[numberOfFrameSizes - 1][1] * 4);
+  FillRandom(randomInput, 12345);
+  std::vector<unsigned char> allYuvCombinations;
+  FillAllYuvCombinations(allYuvCombinations);
+
+  const PixelCodec::InstructionSet instructionSets[] = { PixelCodec::InstructionSet_Scalar, PixelCodec::InstructionSet_SSE41, PixelCodec::InstructionSet_AVX2 };
+  const PixelCodec::InstructionSet defaultInstructionSet = PixelCodec::GetInstructionSet();
+  int numberOfFailures = 0;
+  for (int instructionSetIndex = 0; instructionSetIndex < 3; instructionSetIndex++)
+  {
+    PixelCodec::InstructionSet instructionSet = instructionSets[instructionSetIndex];
+    if (!PixelCodec::IsInstructionSetAvailable(instructionSet))
+    {
+      LOG_INFO("Instruction set " << PixelCodec::GetInstructionSetAsString(instructionSet) << " is not available, skipped");
+      continue;
+    }
+    PixelCodec::SetInstructionSet(instructionSet);
+    LOG_INFO("Testing instruction set " << PixelCodec::GetInstructionSetAsString(instructionSet));
+
+    for (int conversion = 0; conversion < Conversion_Last; conversion++)
+    {
+      for (int threadIndex = 0; threadIndex < 2; threadIndex++)
+      {
+        for (int frameSizeIndex = 0; frameSizeIndex < numberOfFrameSizes; frameSizeIndex++)
+        {
+          if (TestConversion(static_cast<ConversionType>(conversion), frameSizes[frameSizeIndex][0], frameSizes[frameSizeIndex][1], randomInput, threadCounts[threadIndex]) != PLUS_SUCCESS)
+          {
+            numberOfFailures++;
+          }
+        }
+        if (conversion == Conversion_Yuv422pToRgb24 || conversion == Conversion_Yuv422pToBgr24 || conversion == Conversion_Yuv422pToGray)
+        {
+          if (TestConversion(static_cast<ConversionType>(conversion), 512, 256, allYuvCombinations, threadCounts[threadIndex]) != PLUS_SUCCESS)
+          {
+            numberOfFailures++;
+          }
+        }
+      }
+    }
+  }
+  PixelCodec::SetInstructionSet(defaultInstructionSet);
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR(numberOfFailures << " conversion tests failed");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("All conversion results are identical to the reference implementation");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file PlusCommonHashTest.cxx
+Verifies PlusCommon::ComputeHash64 against the XXH64 reference values of the xxHash sanity check
+and checks that the hash of a buffer does not depend on its alignment.
+*/
+
+#include "PlusConfigure.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+namespace
+{
+  struct HashReference
+  {
+    size_t NumberOfBytes;
+    vtkTypeUInt64 Seed;
+    vtkTypeUInt64 Hash;
+  };
+
+  const vtkTypeUInt64 PRIME32 = 2654435761U;
+  const vtkTypeUInt64 PRIME64 = 11400714785074694797ULL;
+
+  //----------------------------------------------------------------------------
+  /*! Fill the buffer the same way as the xxHash sanity check */
+  void FillSanityBuffer(std::vector<unsigned char>& buffer)
+  {
+    vtkTypeUInt64 byteGen = PRIME32;
+    for (size_t i = 0; i < buffer.size(); ++i)
+    {
+      buffer[i] = static_cast<unsigned char>(byteGen >> 56);
+      byteGen *= PRIME64;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  vtksys::CommandLineArguments args;
+
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  // Lengths cover the short input path (< 32 bytes) with 1-byte, 4-byte and 8-byte tails and the 4-lane path
+  const HashReference references[] =
+  {
+    { 0, 0, 0xEF46DB3751D8E999ULL },
+    { 0, PRIME32, 0xAC75FDA2929B17EFULL },
+    { 1, 0, 0xE934A84ADB052768ULL },
+    { 1, PRIME32, 0x5014607643A9B4C3ULL },
+    { 4, 0, 0x9136A0DCA57457EEULL },
+    { 4, PRIME32, 0xCAAB286BD8E9FDB5ULL },
+    { 14, 0, 0x8282DCC4994E35C8ULL },
+    { 14, PRIME32, 0xC3BD6BF63DEB6DF0ULL },
+    { 222, 0, 0xB641AE8CB691C174ULL },
+    { 222, PRIME32, 0x20CB8AB7AE10C14AULL }
+  };
+  const int numberOfReferences = sizeof(references) / sizeof(references[0]);
+
+  std::vector<unsigned char> buffer(256);
+  FillSanityBuffer(buffer);
+
+  int numberOfFailures = 0;
+  for (int referenceIndex = 0; referenceIndex < numberOfReferences; referenceIndex++)
+  {
+    const HashReference& reference = references[referenceIndex];
+    vtkTypeUInt64 hash = PlusCommon::ComputeHash64(&buffer[0], reference.NumberOfBytes, reference.Seed);
+    if (hash != reference.Hash)
+    {
+      LOG_ERROR("XXH64 mismatch for " << reference.NumberOfBytes << " bytes with seed " << reference.Seed << ": 0x"
+                << std::hex << std::uppercase << hash << " (expected 0x" << reference.Hash << ")");
+      numberOfFailures++;
+    }
+
+    // Unaligned input must give the same hash
+    std::vector<unsigned char> unalignedBuffer(reference.NumberOfBytes + 3);
+    std::copy(buffer.begin(), buffer.begin() + reference.NumberOfBytes, unalignedBuffer.begin() + 3);
+    if (PlusCommon::ComputeHash64(unalignedBuffer.data() + 3, reference.NumberOfBytes, reference.Seed) != reference.Hash)
+    {
+      LOG_ERROR("XXH64 of unaligned input differs for " << reference.NumberOfBytes << " bytes with seed " << reference.Seed);
+      numberOfFailures++;
+    }
+  }
+
+  // The hash string is the zero-padded hexadecimal hash with the default seed
+  std::string hashString = PlusCommon::GetHashString(&buffer[0], 1);
+  if (hashString != "e934a84adb052768")
+  {
+    LOG_ERROR("Unexpected hash string: " << hashString << " (expected e934a84adb052768)");
+    numberOfFailures++;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR(numberOfFailures << " hash checks failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("PlusCommonHashTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,229 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusImageSequenceReaderTest.cxx
+  \brief Verifies that vtkPlusImageSequenceReader reads the same frames as vtkIGSIOSequenceIO from MetaImage and NRRD files,
+  compressed and uncompressed, on one thread and on multiple threads with one frame per chunk.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusImageSequenceReader.h"
+#include "vtkPlusSequenceIO.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOSequenceIO.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  bool IsFrameEqual(igsioTrackedFrame* frame1, igsioTrackedFrame* frame2)
+  {
+    if (frame1->GetTimestamp() != frame2->GetTimestamp() || frame1->GetFrameFields() != frame2->GetFrameFields())
+    {
+      return false;
+    }
+    igsioVideoFrame* image1 = frame1->GetImageData();
+    igsioVideoFrame* image2 = frame2->GetImageData();
+    if (image1->IsImageValid() != image2->IsImageValid())
+    {
+      return false;
+    }
+    if (!image1->IsImageValid())
+    {
+      return true;
+    }
+    return image1->GetFrameSize() == image2->GetFrameSize()
+           && image1->GetVTKScalarPixelType() == image2->GetVTKScalarPixelType()
+           && image1->GetNumberOfScalarComponents() == image2->GetNumberOfScalarComponents()
+           && image1->GetImageType() == image2->GetImageType()
+           && image1->GetImageOrientation() == image2->GetImageOrientation()
+           && image1->GetFrameSizeInBytes() == image2->GetFrameSizeInBytes()
+           && memcmp(image1->GetScalarPointer(), image2->GetScalarPointer(), image1->GetFrameSizeInBytes()) == 0;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus CompareFrameLists(vtkIGSIOTrackedFrameList* expected, vtkIGSIOTrackedFrameList* actual, const std::string& description)
+  {
+    if (expected->GetNumberOfTrackedFrames() != actual->GetNumberOfTrackedFrames())
+    {
+      LOG_ERROR(description << ": number of frames mismatch: " << actual->GetNumberOfTrackedFrames() << " (expected " << expected->GetNumberOfTrackedFrames() << ")");
+      return PLUS_FAIL;
+    }
+    for (unsigned int frameIndex = 0; frameIndex < expected->GetNumberOfTrackedFrames(); ++frameIndex)
+    {
+      if (!IsFrameEqual(expected->GetTrackedFrame(frameIndex), actual->GetTrackedFrame(frameIndex)))
+      {
+        LOG_ERROR(description << ": frame " << frameIndex << " is different");
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Read the file with vtkIGSIOSequenceIO and with vtkPlusImageSequenceReader in several configurations and compare the frames */
+  PlusStatus TestFile(const std::string& fileName, bool requireParallelReader)
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> expectedFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (vtkIGSIOSequenceIO::Read(fileName, expectedFrames) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read reference frames from " << fileName);
+      return PLUS_FAIL;
+    }
+
+    vtkSmartPointer<vtkPlusImageSequenceReader> reader = vtkSmartPointer<vtkPlusImageSequenceReader>::New();
+    reader->SetFileName(fileName);
+    if (reader->ReadHeader() != PLUS_SUCCESS)
+    {
+      if (requireParallelReader)
+      {
+        LOG_ERROR("vtkPlusImageSequenceReader does not support file written by vtkIGSIOSequenceIO: " << fileName);
+        return PLUS_FAIL;
+      }
+      LOG_INFO("Data layout of " << fileName << " is not supported by vtkPlusImageSequenceReader, skipped");
+      return PLUS_SUCCESS;
+    }
+
+    PlusStatus status = PLUS_SUCCESS;
+    const unsigned int threadCounts[] = { 1, 4 };
+    const unsigned long long chunkSizes[] = { reader->GetChunkSizeBytes(), 1 };
+    for (int configIndex = 0; configIndex < 2; ++configIndex)
+    {
+      std::vector<double> progress;
+      reader->SetNumberOfThreads(threadCounts[configIndex]);
+      reader->SetChunkSizeBytes(chunkSizes[configIndex]);
+      reader->SetProgressCallback([&progress](double fraction) { progress.push_back(fraction); });
+
+      std::ostringstream description;
+      description << fileName << " (" << threadCounts[configIndex] << " threads, chunk size " << chunkSizes[configIndex] << " bytes)";
+      vtkSmartPointer<vtkIGSIOTrackedFrameList> actualFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+      if (reader->Read(actualFrames) != PLUS_SUCCESS)
+      {
+        LOG_ERROR(description.str() << ": read failed");
+        status = PLUS_FAIL;
+        continue;
+      }
+      if (CompareFrameLists(expectedFrames, actualFrames, description.str()) != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+
+      // With one frame per chunk progress is reported after each frame
+      bool progressValid = !progress.empty() && progress.back() == 1.0 && std::is_sorted(progress.begin(), progress.end());
+      if (!progressValid || (configIndex == 1 && progress.size() != actualFrames->GetNumberOfTrackedFrames()))
+      {
+        LOG_ERROR(description.str() << ": unexpected progress reports (" << progress.size() << " reports for " << actualFrames->GetNumberOfTrackedFrames() << " frames)");
+        status = PLUS_FAIL;
+      }
+    }
+
+    // Reading through vtkPlusSequenceIO uses the same reader
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> sequenceIOFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (vtkPlusSequenceIO::Read(fileName, sequenceIOFrames) != PLUS_SUCCESS
+        || CompareFrameLists(expectedFrames, sequenceIOFrames, fileName + " (vtkPlusSequenceIO)") != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+
+    LOG_INFO("Compared " << expectedFrames->GetNumberOfTrackedFrames() << " frames of " << fileName);
+    return status;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  std::vector<std::string> inputFileNames;
+  vtksys::CommandLineArguments args;
+
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--seq-files", vtksys::CommandLineArguments::MULTI_ARGUMENT, &inputFileNames, "Image sequence files to read");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputFileNames.empty())
+  {
+    LOG_ERROR("No --seq-files specified");
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfFailures = 0;
+  for (std::vector<std::string>::iterator inputFileName = inputFileNames.begin(); inputFileName != inputFileNames.end(); ++inputFileName)
+  {
+    // Files in the test data directory may have been written by any version, test them as they are
+    if (TestFile(*inputFileName, false) != PLUS_SUCCESS)
+    {
+      ++numberOfFailures;
+    }
+
+    // Write the frames in each layout that the IGSIO writers produce. These must be read by the parallel reader.
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> frames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (vtkIGSIOSequenceIO::Read(*inputFileName, frames) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read " << *inputFileName);
+      ++numberOfFailures;
+      continue;
+    }
+    std::string baseName = vtksys::SystemTools::GetFilenameWithoutExtension(*inputFileName);
+    const char* extensions[] = { ".mha", ".nrrd" };
+    for (int extensionIndex = 0; extensionIndex < 2; ++extensionIndex)
+    {
+      for (int compressed = 0; compressed < 2; ++compressed)
+      {
+        std::string outputFileName = vtkPlusConfig::GetInstance()->GetOutputPath(baseName + (compressed ? "_Compressed" : "_Raw") + extensions[extensionIndex]);
+        if (vtkPlusSequenceIO::Write(outputFileName, frames, US_IMG_ORIENT_MF, compressed != 0) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to write " << outputFileName);
+          ++numberOfFailures;
+          continue;
+        }
+        if (TestFile(outputFileName, true) != PLUS_SUCCESS)
+        {
+          ++numberOfFailures;
+        }
+      }
+    }
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR(numberOfFailures << " file comparisons failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkPlusImageSequenceReaderTest completed successfully");
+  return EXIT_SUCCESS;
+}
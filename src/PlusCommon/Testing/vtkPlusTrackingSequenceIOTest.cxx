@@ -0,0 +1,276 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusTrackingSequenceIOTest.cxx
+  \brief Writes tracking frames into .igs.trk files (compressed, uncompressed and in multiple blocks), reads them back
+  and compares the timestamps, frame numbers, transforms and transform statuses value by value.
+  Also verifies that the numbers in the file are stored in little-endian byte order.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusTrackingSequenceIO.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+  const unsigned int NUMBER_OF_FRAMES = 250;
+
+  //----------------------------------------------------------------------------
+  /*! Frames with two transforms, the second one is missing from every 7th frame and its status changes over time */
+  void CreateFrames(vtkIGSIOTrackedFrameList* frameList)
+  {
+    const igsioTransformName probeToTracker("Probe", "Tracker");
+    const igsioTransformName stylusToTracker("Stylus", "Tracker");
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (unsigned int frameIndex = 0; frameIndex < NUMBER_OF_FRAMES; ++frameIndex)
+    {
+      igsioTrackedFrame frame;
+      frame.SetTimestamp(1234.5 + frameIndex * 0.0167 + 1e-9 * frameIndex);
+
+      std::ostringstream unfilteredTimestamp;
+      unfilteredTimestamp << std::fixed << 1234.5 + frameIndex * 0.0171;
+      frame.SetFrameField("UnfilteredTimestamp", unfilteredTimestamp.str());
+      std::ostringstream frameNumber;
+      frameNumber << 5000000000ULL + frameIndex * 3;
+      frame.SetFrameField("FrameNumber", frameNumber.str());
+
+      matrix->Identity();
+      for (int row = 0; row < 3; ++row)
+      {
+        for (int column = 0; column < 4; ++column)
+        {
+          matrix->SetElement(row, column, (column == 3 ? 100.0 : 1.0) * sin(0.37 * (row * 4 + column) + 0.01 * frameIndex));
+        }
+      }
+      frame.SetFrameTransform(probeToTracker, matrix);
+      frame.SetFrameTransformStatus(probeToTracker, TOOL_OK);
+
+      if (frameIndex % 7 != 0)
+      {
+        matrix->SetElement(0, 3, -25.0 - frameIndex);
+        frame.SetFrameTransform(stylusToTracker, matrix);
+        frame.SetFrameTransformStatus(stylusToTracker, (frameIndex / 10) % 2 == 0 ? TOOL_OK : TOOL_OUT_OF_VIEW);
+      }
+
+      frameList->AddTrackedFrame(&frame);
+    }
+    frameList->SetCustomString("TestField", "TestValue");
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus CompareFrames(igsioTrackedFrame* expected, igsioTrackedFrame* actual, const std::string& description)
+  {
+    if (expected->GetTimestamp() != actual->GetTimestamp())
+    {
+      LOG_ERROR(description << ": timestamp " << std::fixed << actual->GetTimestamp() << " (expected " << expected->GetTimestamp() << ")");
+      return PLUS_FAIL;
+    }
+    const char* fieldNames[] = { "UnfilteredTimestamp", "FrameNumber" };
+    for (int fieldIndex = 0; fieldIndex < 2; ++fieldIndex)
+    {
+      if (expected->GetFrameField(fieldNames[fieldIndex]) != actual->GetFrameField(fieldNames[fieldIndex]))
+      {
+        LOG_ERROR(description << ": " << fieldNames[fieldIndex] << " " << actual->GetFrameField(fieldNames[fieldIndex])
+                  << " (expected " << expected->GetFrameField(fieldNames[fieldIndex]) << ")");
+        return PLUS_FAIL;
+      }
+    }
+
+    std::vector<igsioTransformName> expectedNames;
+    expected->GetFrameTransformNameList(expectedNames);
+    std::vector<igsioTransformName> actualNames;
+    actual->GetFrameTransformNameList(actualNames);
+    if (expectedNames.size() != actualNames.size())
+    {
+      LOG_ERROR(description << ": " << actualNames.size() << " transforms (expected " << expectedNames.size() << ")");
+      return PLUS_FAIL;
+    }
+    vtkSmartPointer<vtkMatrix4x4> expectedMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkSmartPointer<vtkMatrix4x4> actualMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (std::vector<igsioTransformName>::iterator name = expectedNames.begin(); name != expectedNames.end(); ++name)
+    {
+      ToolStatus expectedStatus(TOOL_INVALID);
+      ToolStatus actualStatus(TOOL_INVALID);
+      if (expected->GetFrameTransform(*name, expectedMatrix) != PLUS_SUCCESS || actual->GetFrameTransform(*name, actualMatrix) != PLUS_SUCCESS
+          || expected->GetFrameTransformStatus(*name, expectedStatus) != PLUS_SUCCESS || actual->GetFrameTransformStatus(*name, actualStatus) != PLUS_SUCCESS)
+      {
+        LOG_ERROR(description << ": " << name->GetTransformName() << " transform is missing");
+        return PLUS_FAIL;
+      }
+      if (expectedStatus != actualStatus)
+      {
+        LOG_ERROR(description << ": " << name->GetTransformName() << " status " << actualStatus << " (expected " << expectedStatus << ")");
+        return PLUS_FAIL;
+      }
+      for (int row = 0; row < 4; ++row)
+      {
+        for (int column = 0; column < 4; ++column)
+        {
+          // Poses are stored as float
+          const double expectedValue = expectedMatrix->GetElement(row, column);
+          const double actualValue = actualMatrix->GetElement(row, column);
+          if (static_cast<float>(expectedValue) != actualValue)
+          {
+            LOG_ERROR(description << ": " << name->GetTransformName() << " element (" << row << ", " << column << ") is " << actualValue
+                      << " (expected " << expectedValue << ")");
+            return PLUS_FAIL;
+          }
+        }
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus ReadAndCompare(const std::string& fileName, vtkIGSIOTrackedFrameList* expectedFrames)
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> actualFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (vtkPlusTrackingSequenceIO::Read(fileName, actualFrames) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read " << fileName);
+      return PLUS_FAIL;
+    }
+    if (actualFrames->GetNumberOfTrackedFrames() != expectedFrames->GetNumberOfTrackedFrames())
+    {
+      LOG_ERROR(fileName << ": " << actualFrames->GetNumberOfTrackedFrames() << " frames (expected " << expectedFrames->GetNumberOfTrackedFrames() << ")");
+      return PLUS_FAIL;
+    }
+    const char* customString = actualFrames->GetCustomString("TestField");
+    if (customString == NULL || std::string(customString) != "TestValue")
+    {
+      LOG_ERROR(fileName << ": custom string is not read back");
+      return PLUS_FAIL;
+    }
+    for (unsigned int frameIndex = 0; frameIndex < expectedFrames->GetNumberOfTrackedFrames(); ++frameIndex)
+    {
+      std::ostringstream description;
+      description << fileName << " frame " << frameIndex;
+      if (CompareFrames(expectedFrames->GetTrackedFrame(frameIndex), actualFrames->GetTrackedFrame(frameIndex), description.str()) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! The file format version and the first block signature must be little-endian regardless of the host byte order */
+  PlusStatus CheckByteOrder(const std::string& fileName)
+  {
+    std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+    unsigned char header[16] = { 0 };
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)))
+    {
+      LOG_ERROR("Failed to read header of " << fileName);
+      return PLUS_FAIL;
+    }
+    const unsigned char expectedVersionAndBlockSignature[8] = { 1, 0, 0, 0, 'T', 'B', 'L', 'K' };
+    if (memcmp(header + 8, expectedVersionAndBlockSignature, sizeof(expectedVersionAndBlockSignature)) != 0)
+    {
+      LOG_ERROR(fileName << ": header is not stored in little-endian byte order");
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  vtksys::CommandLineArguments args;
+
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> frames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  CreateFrames(frames);
+
+  int numberOfFailures = 0;
+  for (int compressed = 0; compressed < 2; ++compressed)
+  {
+    std::string fileName = vtkPlusConfig::GetInstance()->GetOutputPath(compressed ? "TrackingSequenceIOTest_Compressed.igs.trk" : "TrackingSequenceIOTest_Raw.igs.trk");
+    if (vtkPlusTrackingSequenceIO::Write(fileName, frames, compressed != 0) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to write " << fileName);
+      ++numberOfFailures;
+      continue;
+    }
+    if (CheckByteOrder(fileName) != PLUS_SUCCESS || ReadAndCompare(fileName, frames) != PLUS_SUCCESS)
+    {
+      ++numberOfFailures;
+    }
+  }
+
+  // Frames appended in several blocks, as while recording
+  std::string blocksFileName = vtkPlusConfig::GetInstance()->GetOutputPath("TrackingSequenceIOTest_Blocks.igs.trk");
+  vtkSmartPointer<vtkPlusTrackingSequenceIO> writer = vtkSmartPointer<vtkPlusTrackingSequenceIO>::New();
+  writer->SetFileName(blocksFileName);
+  writer->SetCustomString("TestField", "TestValue");
+  PlusStatus writeStatus = writer->OpenForWriting();
+  const unsigned int framesPerBlock = 64;
+  for (unsigned int firstFrameIndex = 0; firstFrameIndex < NUMBER_OF_FRAMES && writeStatus == PLUS_SUCCESS; firstFrameIndex += framesPerBlock)
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> block = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    for (unsigned int frameIndex = firstFrameIndex; frameIndex < std::min(firstFrameIndex + framesPerBlock, NUMBER_OF_FRAMES); ++frameIndex)
+    {
+      block->AddTrackedFrame(frames->GetTrackedFrame(frameIndex));
+    }
+    writeStatus = writer->AppendFrames(block);
+  }
+  if (writer->Close() != PLUS_SUCCESS || writeStatus != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to write " << blocksFileName);
+    ++numberOfFailures;
+  }
+  else if (ReadAndCompare(blocksFileName, frames) != PLUS_SUCCESS)
+  {
+    ++numberOfFailures;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR(numberOfFailures << " tracking sequence file checks failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkPlusTrackingSequenceIOTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,513 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusImageSequenceReader.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <igsioVideoFrame.h>
+#include <vtkIGSIOMetaImageSequenceIO.h>
+#include <vtkIGSIONrrdSequenceIO.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtk_zlib.h>
+#include <vtksys/SystemTools.hxx>
+
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPlusImageSequenceReader);
+
+//----------------------------------------------------------------------------
+namespace
+{
+  const char IMAGE_STATUS_FIELD_NAME[] = "ImageStatus";
+
+  /*! Size of the compressed data blocks that are fed to the inflater */
+  const size_t COMPRESSED_READ_BLOCK_SIZE = 1024 * 1024;
+
+  //----------------------------------------------------------------------------
+  /*! Pixel data layout of an image sequence file, as found by the IGSIO header parser */
+  struct PixelDataLayout
+  {
+    FrameSizeType FrameSize;
+    int ScalarType;
+    unsigned int NumberOfScalarComponents;
+    US_IMAGE_TYPE ImageType;
+    US_IMAGE_ORIENTATION ImageOrientationInFile;
+    std::string DataFileName;
+    unsigned long long DataOffset;
+  };
+
+  //----------------------------------------------------------------------------
+  /*! Gives access to the header parsing of vtkIGSIOMetaImageSequenceIO or vtkIGSIONrrdSequenceIO */
+  template <class SequenceIOType>
+  class HeaderParser : public SequenceIOType
+  {
+  public:
+    static HeaderParser* New()
+    {
+      VTK_STANDARD_NEW_BODY(HeaderParser);
+    }
+
+    /*! Parse the header of the file into custom strings and frames with fields (without images) of frameList */
+    PlusStatus ReadHeader(const std::string& fileName, vtkIGSIOTrackedFrameList* frameList, PixelDataLayout& layout)
+    {
+      this->SetFileName(fileName);
+      this->SetTrackedFrameList(frameList);
+      if (this->ReadImageHeader() != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      layout.FrameSize = { static_cast<unsigned int>(this->Dimensions[0]), static_cast<unsigned int>(this->Dimensions[1]), static_cast<unsigned int>(this->Dimensions[2]) };
+      layout.ScalarType = this->PixelType;
+      layout.NumberOfScalarComponents = this->NumberOfScalarComponents;
+      layout.ImageType = this->ImageType;
+      layout.ImageOrientationInFile = this->ImageOrientationInFile;
+      layout.DataFileName = this->GetPixelDataFilePath();
+      layout.DataOffset = static_cast<unsigned long long>(this->PixelDataFileOffset);
+      return PLUS_SUCCESS;
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  /*! Returns the value of a custom string with case insensitive name matching, or an empty string if it is not found */
+  std::string GetCustomStringNoCase(vtkIGSIOTrackedFrameList* frameList, const std::string& name)
+  {
+    std::vector<std::string> fieldNames;
+    frameList->GetCustomFieldNameList(fieldNames);
+    for (std::vector<std::string>::iterator it = fieldNames.begin(); it != fieldNames.end(); ++it)
+    {
+      const char* fieldValue = frameList->GetCustomString(it->c_str());
+      if (fieldValue != NULL && STRCASECMP(it->c_str(), name.c_str()) == 0)
+      {
+        return vtksys::SystemTools::TrimWhitespace(fieldValue);
+      }
+    }
+    return std::string();
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Delivers the pixel data stream of the file in consecutive pieces, inflating it if needed */
+  class PixelDataSource
+  {
+  public:
+    PixelDataSource() : Compressed(false), InflaterInitialized(false)
+    {
+      memset(&this->Inflater, 0, sizeof(this->Inflater));
+    }
+
+    ~PixelDataSource()
+    {
+      if (this->InflaterInitialized)
+      {
+        inflateEnd(&this->Inflater);
+      }
+    }
+
+    bool Open(const std::string& fileName, unsigned long long offset, bool compressed)
+    {
+      this->Stream.open(fileName.c_str(), std::ios::in | std::ios::binary);
+      if (!this->Stream.is_open() || !this->Stream.seekg(static_cast<std::streamoff>(offset), std::ios::beg))
+      {
+        return false;
+      }
+      this->Compressed = compressed;
+      if (this->Compressed)
+      {
+        // Window bits +32 accepts both zlib (MetaImage) and gzip (NRRD) streams
+        if (inflateInit2(&this->Inflater, MAX_WBITS + 32) != Z_OK)
+        {
+          return false;
+        }
+        this->InflaterInitialized = true;
+        this->InputBlock.resize(COMPRESSED_READ_BLOCK_SIZE);
+      }
+      return true;
+    }
+
+    bool Read(char* buffer, unsigned long long numberOfBytes)
+    {
+      if (!this->Compressed)
+      {
+        return static_cast<bool>(this->Stream.read(buffer, static_cast<std::streamsize>(numberOfBytes)));
+      }
+      unsigned long long remainingBytes = numberOfBytes;
+      while (remainingBytes > 0)
+      {
+        if (this->Inflater.avail_in == 0)
+        {
+          this->Stream.read(&this->InputBlock[0], this->InputBlock.size());
+          if (this->Stream.gcount() <= 0)
+          {
+            // pixel data is truncated
+            return false;
+          }
+          this->Inflater.next_in = reinterpret_cast<Bytef*>(&this->InputBlock[0]);
+          this->Inflater.avail_in = static_cast<uInt>(this->Stream.gcount());
+        }
+        uInt outputSize = static_cast<uInt>(std::min<unsigned long long>(remainingBytes, 1 << 30));
+        this->Inflater.next_out = reinterpret_cast<Bytef*>(buffer + (numberOfBytes - remainingBytes));
+        this->Inflater.avail_out = outputSize;
+        int result = inflate(&this->Inflater, Z_NO_FLUSH);
+        remainingBytes -= outputSize - this->Inflater.avail_out;
+        if (result == Z_STREAM_END)
+        {
+          if (remainingBytes > 0 && inflateReset(&this->Inflater) != Z_OK)
+          {
+            return false;
+          }
+          // concatenated gzip members continue the same stream
+        }
+        else if (result != Z_OK)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+  protected:
+    std::ifstream Stream;
+    bool Compressed;
+    z_stream Inflater;
+    bool InflaterInitialized;
+    std::vector<char> InputBlock;
+  };
+}
+
+
+//----------------------------------------------------------------------------
+vtkPlusImageSequenceReader::vtkPlusImageSequenceReader()
+  : NumberOfThreads(0)
+  , ChunkSizeBytes(64 * 1024 * 1024)
+  , HeaderRead(false)
+  , HeaderFrameList(vtkIGSIOTrackedFrameList::New())
+  , NumberOfFrames(0)
+  , NumberOfScalarComponents(1)
+  , ScalarType(-1)
+  , ImageType(US_IMG_TYPE_XX)
+  , ImageOrientationInFile(US_IMG_ORIENT_XX)
+  , Compressed(false)
+  , DataOffset(0)
+{
+  this->FrameSize.fill(0);
+}
+
+//----------------------------------------------------------------------------
+vtkPlusImageSequenceReader::~vtkPlusImageSequenceReader()
+{
+  this->HeaderFrameList->Delete();
+  this->HeaderFrameList = NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImageSequenceReader::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << this->FileName << std::endl;
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+  os << indent << "ChunkSizeBytes: " << this->ChunkSizeBytes << std::endl;
+  os << indent << "NumberOfFrames: " << this->NumberOfFrames << std::endl;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusImageSequenceReader::CanReadFile(const std::string& filename)
+{
+  std::string extension = vtksys::SystemTools::LowerCase(vtksys::SystemTools::GetFilenameLastExtension(filename));
+  return extension == ".mha" || extension == ".mhd" || extension == ".nrrd" || extension == ".nhdr";
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageSequenceReader::ReadHeader()
+{
+  this->HeaderRead = false;
+  this->HeaderFrameList->Clear();
+  this->NumberOfFrames = 0;
+
+  PixelDataLayout layout;
+  std::string extension = vtksys::SystemTools::LowerCase(vtksys::SystemTools::GetFilenameLastExtension(this->FileName));
+  PlusStatus status = PLUS_FAIL;
+  if (extension == ".nrrd" || extension == ".nhdr")
+  {
+    vtkSmartPointer<HeaderParser<vtkIGSIONrrdSequenceIO> > parser = vtkSmartPointer<HeaderParser<vtkIGSIONrrdSequenceIO> >::New();
+    status = parser->ReadHeader(this->FileName, this->HeaderFrameList, layout);
+  }
+  else
+  {
+    vtkSmartPointer<HeaderParser<vtkIGSIOMetaImageSequenceIO> > parser = vtkSmartPointer<HeaderParser<vtkIGSIOMetaImageSequenceIO> >::New();
+    status = parser->ReadHeader(this->FileName, this->HeaderFrameList, layout);
+  }
+  if (status != PLUS_SUCCESS)
+  {
+    LOG_DEBUG("Unable to parse the header of image sequence file: " << this->FileName);
+    return PLUS_FAIL;
+  }
+
+  this->FrameSize = layout.FrameSize;
+  this->NumberOfFrames = this->HeaderFrameList->GetNumberOfTrackedFrames();
+  this->NumberOfScalarComponents = layout.NumberOfScalarComponents;
+  this->ScalarType = layout.ScalarType;
+  this->ImageType = layout.ImageType;
+  this->ImageOrientationInFile = layout.ImageOrientationInFile;
+  this->DataFileName = layout.DataFileName;
+  this->DataOffset = layout.DataOffset;
+  if (this->CheckDataLayout() != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  this->HeaderRead = true;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageSequenceReader::CheckDataLayout()
+{
+  vtkIGSIOTrackedFrameList* header = this->HeaderFrameList;
+
+  // MetaImage fields
+  std::string compressedData = vtksys::SystemTools::LowerCase(GetCustomStringNoCase(header, "CompressedData"));
+  std::string headerSize = GetCustomStringNoCase(header, "HeaderSize");
+  if (vtksys::SystemTools::LowerCase(GetCustomStringNoCase(header, "BinaryDataByteOrderMSB")) == "true"
+      || vtksys::SystemTools::LowerCase(GetCustomStringNoCase(header, "ElementByteOrderMSB")) == "true"
+      || vtksys::SystemTools::LowerCase(GetCustomStringNoCase(header, "BinaryData")) == "false"
+      || GetCustomStringNoCase(header, "ElementDataFile") == "LIST"
+      || (!headerSize.empty() && headerSize != "0"))
+  {
+    LOG_DEBUG("Image sequence file " << this->FileName << " has an unsupported MetaImage data layout");
+    return PLUS_FAIL;
+  }
+
+  // NRRD fields
+  std::string encoding = vtksys::SystemTools::LowerCase(GetCustomStringNoCase(header, "encoding"));
+  std::string dataFile = GetCustomStringNoCase(header, "data file") + GetCustomStringNoCase(header, "datafile");
+  const char* skipFieldNames[] = { "line skip", "lineskip", "byte skip", "byteskip" };
+  for (unsigned int i = 0; i < sizeof(skipFieldNames) / sizeof(skipFieldNames[0]); ++i)
+  {
+    std::string skip = GetCustomStringNoCase(header, skipFieldNames[i]);
+    if (!skip.empty() && skip != "0")
+    {
+      LOG_DEBUG("Image sequence file " << this->FileName << " has an unsupported data layout (" << skipFieldNames[i] << ": " << skip << ")");
+      return PLUS_FAIL;
+    }
+  }
+  if ((!encoding.empty() && encoding != "raw" && encoding != "gzip" && encoding != "gz")
+      || dataFile.find(' ') != std::string::npos || dataFile.find('%') != std::string::npos)
+  {
+    LOG_DEBUG("Image sequence file " << this->FileName << " has an unsupported NRRD data layout");
+    return PLUS_FAIL;
+  }
+
+  if (this->ScalarType < 0 || this->NumberOfScalarComponents < 1
+      || this->FrameSize[0] == 0 || this->FrameSize[1] == 0 || this->FrameSize[2] == 0 || this->NumberOfFrames == 0)
+  {
+    LOG_DEBUG("Image sequence file " << this->FileName << " has no image data or an unsupported pixel type");
+    return PLUS_FAIL;
+  }
+  if (vtksys::SystemTools::LowerCase(GetCustomStringNoCase(header, "endian")) == "big" && vtkDataArray::GetDataTypeSize(this->ScalarType) > 1)
+  {
+    LOG_DEBUG("Big endian image sequence files are not supported: " << this->FileName);
+    return PLUS_FAIL;
+  }
+  if (this->ImageOrientationInFile == US_IMG_ORIENT_XX || this->ImageType == US_IMG_TYPE_XX)
+  {
+    LOG_DEBUG("Image sequence file " << this->FileName << " has no valid image orientation or image type");
+    return PLUS_FAIL;
+  }
+  if (this->DataFileName.empty() || !vtksys::SystemTools::FileExists(this->DataFileName.c_str(), true))
+  {
+    LOG_DEBUG("Pixel data file of image sequence file " << this->FileName << " is not found: " << this->DataFileName);
+    return PLUS_FAIL;
+  }
+
+  this->Compressed = (compressedData == "true" || encoding == "gzip" || encoding == "gz");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageSequenceReader::Read(vtkIGSIOTrackedFrameList* frameList)
+{
+  if (frameList == NULL)
+  {
+    LOG_ERROR("vtkPlusImageSequenceReader::Read failed: invalid frame list");
+    return PLUS_FAIL;
+  }
+  if (!this->HeaderRead && this->ReadHeader() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to read image sequence file header: " << this->FileName);
+    return PLUS_FAIL;
+  }
+
+  igsioVideoFrame::FlipInfoType flipInfo;
+  if (igsioVideoFrame::GetFlipAxes(this->ImageOrientationInFile, this->ImageType, US_IMG_ORIENT_MF, flipInfo) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to convert image data from " << igsioCommon::GetStringFromUsImageOrientation(this->ImageOrientationInFile) << " to MF orientation: " << this->FileName);
+    return PLUS_FAIL;
+  }
+  FrameSizeType outputFrameSize = this->FrameSize;
+  if (flipInfo.tranpose == igsioVideoFrame::TRANSPOSE_IJKtoKIJ)
+  {
+    outputFrameSize = { this->FrameSize[2], this->FrameSize[0], this->FrameSize[1] };
+  }
+  const std::array<int, 3> noClipOrigin = { igsioCommon::NO_CLIP, igsioCommon::NO_CLIP, igsioCommon::NO_CLIP };
+  const std::array<int, 3> noClipSize = { igsioCommon::NO_CLIP, igsioCommon::NO_CLIP, igsioCommon::NO_CLIP };
+
+  PixelDataSource pixelData;
+  if (!pixelData.Open(this->DataFileName, this->DataOffset, this->Compressed))
+  {
+    LOG_ERROR("Unable to open pixel data of image sequence file: " << this->DataFileName);
+    return PLUS_FAIL;
+  }
+
+  // Copy the frames with their fields from the header. Frames that were not recorded with a valid image get no image.
+  std::vector<igsioTrackedFrame*> frames(this->NumberOfFrames);
+  std::vector<bool> imageValid(this->NumberOfFrames, true);
+  for (unsigned int frameIndex = 0; frameIndex < this->NumberOfFrames; ++frameIndex)
+  {
+    frames[frameIndex] = new igsioTrackedFrame(*this->HeaderFrameList->GetTrackedFrame(frameIndex));
+    std::string imageStatus = frames[frameIndex]->GetFrameField(IMAGE_STATUS_FIELD_NAME);
+    if (!imageStatus.empty())
+    {
+      // the status is generated again when the frame is written
+      imageValid[frameIndex] = (STRCASECMP(imageStatus.c_str(), "OK") == 0);
+      frames[frameIndex]->DeleteFrameField(IMAGE_STATUS_FIELD_NAME);
+    }
+  }
+
+  const unsigned long long frameSizeBytes = static_cast<unsigned long long>(this->FrameSize[0]) * this->FrameSize[1] * this->FrameSize[2]
+      * this->NumberOfScalarComponents * vtkDataArray::GetDataTypeSize(this->ScalarType);
+  const unsigned int framesPerChunk = static_cast<unsigned int>(std::max<unsigned long long>(1,
+                                      std::min<unsigned long long>(this->NumberOfFrames, this->ChunkSizeBytes / frameSizeBytes)));
+  const unsigned int numberOfChunks = (this->NumberOfFrames + framesPerChunk - 1) / framesPerChunk;
+
+  // A single reader thread reads (and inflates) the chunks into two alternating buffers
+  // while the calling thread converts the frames of the previous chunk.
+  std::vector<char> chunkBuffers[2];
+  bool chunkBufferFilled[2] = { false, false };
+  bool readFailed = false;
+  bool stopReading = false;
+  std::mutex chunkMutex;
+  std::condition_variable chunkBufferStateChanged;
+  std::thread chunkReader([&]()
+  {
+    for (unsigned int chunkIndex = 0; chunkIndex < numberOfChunks; ++chunkIndex)
+    {
+      const unsigned int bufferIndex = chunkIndex % 2;
+      {
+        std::unique_lock<std::mutex> lock(chunkMutex);
+        chunkBufferStateChanged.wait(lock, [&]() { return !chunkBufferFilled[bufferIndex] || stopReading; });
+        if (stopReading)
+        {
+          return;
+        }
+      }
+      std::vector<char>& chunk = chunkBuffers[bufferIndex];
+      chunk.resize(static_cast<size_t>(std::min(framesPerChunk, this->NumberOfFrames - chunkIndex * framesPerChunk) * frameSizeBytes));
+      bool success = pixelData.Read(&chunk[0], chunk.size());
+      {
+        std::lock_guard<std::mutex> lock(chunkMutex);
+        chunkBufferFilled[bufferIndex] = true;
+        readFailed = !success;
+      }
+      chunkBufferStateChanged.notify_all();
+      if (!success)
+      {
+        return;
+      }
+    }
+  });
+
+  // Reorient and copy the frames of each chunk on the worker threads
+  std::atomic<bool> conversionFailed(false);
+  for (unsigned int chunkIndex = 0; chunkIndex < numberOfChunks; ++chunkIndex)
+  {
+    const unsigned int bufferIndex = chunkIndex % 2;
+    {
+      std::unique_lock<std::mutex> lock(chunkMutex);
+      chunkBufferStateChanged.wait(lock, [&]() { return chunkBufferFilled[bufferIndex]; });
+      if (readFailed)
+      {
+        break;
+      }
+    }
+
+    std::vector<char>& chunk = chunkBuffers[bufferIndex];
+    const unsigned int firstFrameIndex = chunkIndex * framesPerChunk;
+    PlusCommon::ParallelFor(std::min(framesPerChunk, this->NumberOfFrames - firstFrameIndex), [&](unsigned int frameIndexInChunk)
+    {
+      unsigned int frameIndex = firstFrameIndex + frameIndexInChunk;
+      if (!imageValid[frameIndex])
+      {
+        return;
+      }
+      igsioVideoFrame* image = frames[frameIndex]->GetImageData();
+      unsigned char* framePixels = reinterpret_cast<unsigned char*>(&chunk[0]) + frameIndexInChunk * frameSizeBytes;
+      if (image->AllocateFrame(outputFrameSize, this->ScalarType, this->NumberOfScalarComponents) != PLUS_SUCCESS
+          || igsioVideoFrame::GetOrientedClippedImage(framePixels, flipInfo, this->ImageType, this->ScalarType, this->NumberOfScalarComponents,
+              this->FrameSize, *image, noClipOrigin, noClipSize) != PLUS_SUCCESS)
+      {
+        conversionFailed = true;
+        return;
+      }
+      image->SetImageOrientation(US_IMG_ORIENT_MF);
+      image->SetImageType(this->ImageType);
+    }, this->NumberOfThreads);
+
+    {
+      std::lock_guard<std::mutex> lock(chunkMutex);
+      chunkBufferFilled[bufferIndex] = false;
+      stopReading = conversionFailed;
+    }
+    chunkBufferStateChanged.notify_all();
+    if (conversionFailed)
+    {
+      break;
+    }
+    if (this->ProgressCallback)
+    {
+      this->ProgressCallback(static_cast<double>(chunkIndex + 1) / numberOfChunks);
+    }
+  }
+  chunkReader.join();
+
+  if (readFailed || conversionFailed)
+  {
+    LOG_ERROR((readFailed ? "Failed to read pixel data of image sequence file: " : "Failed to convert frames of image sequence file: ") << this->FileName);
+    for (std::vector<igsioTrackedFrame*>::iterator frame = frames.begin(); frame != frames.end(); ++frame)
+    {
+      delete *frame;
+    }
+    return PLUS_FAIL;
+  }
+
+  std::vector<std::string> fieldNames;
+  this->HeaderFrameList->GetCustomFieldNameList(fieldNames);
+  for (std::vector<std::string>::iterator it = fieldNames.begin(); it != fieldNames.end(); ++it)
+  {
+    const char* fieldValue = this->HeaderFrameList->GetCustomString(it->c_str());
+    if (fieldValue != NULL)
+    {
+      frameList->SetCustomString(it->c_str(), fieldValue);
+    }
+  }
+  for (std::vector<igsioTrackedFrame*>::iterator frame = frames.begin(); frame != frames.end(); ++frame)
+  {
+    frameList->TakeTrackedFrame(*frame);
+  }
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,108 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusImageSequenceReader_h
+#define __vtkPlusImageSequenceReader_h
+
+#include "vtkPlusCommonExport.h"
+
+#include "PlusCommon.h"
+
+#include <vtkObject.h>
+
+#include <functional>
+#include <string>
+
+class vtkIGSIOTrackedFrameList;
+
+/*!
+  \class vtkPlusImageSequenceReader
+  \brief Reads MetaImage (.mha/.mhd) and NRRD (.nrrd/.nhdr) image sequence files with parallel frame decoding
+
+  The header and the frame fields are parsed by vtkIGSIOMetaImageSequenceIO or vtkIGSIONrrdSequenceIO, only the pixel data
+  is decoded here. The pixel data is a single (possibly deflated) stream, which the IGSIO readers inflate and convert
+  frame by frame on one thread. This reader splits the stream into chunks of whole frames: one reader thread reads or inflates
+  the next chunk while the frames of the current chunk are reoriented and copied by PlusCommon::ParallelFor.
+
+  Only the layouts that the IGSIO writers produce are handled (binary little-endian data, raw or zlib/gzip encoding,
+  pixel data in the header file or in a single data file). ReadHeader fails for other files, these can be read by vtkIGSIOSequenceIO.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport vtkPlusImageSequenceReader : public vtkObject
+{
+public:
+  static vtkPlusImageSequenceReader* New();
+  vtkTypeMacro(vtkPlusImageSequenceReader, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Function that is called with the completed fraction (0.0-1.0) while reading */
+  typedef std::function<void(double)> ProgressCallbackType;
+
+  /*! Returns true if the file name has a MetaImage or NRRD file extension */
+  static bool CanReadFile(const std::string& filename);
+
+  /*!
+    Parse the file header. Returns PLUS_FAIL if the file cannot be opened, the header is invalid,
+    or the data layout is not supported by this reader.
+  */
+  virtual PlusStatus ReadHeader();
+
+  /*!
+    Read frame fields, custom strings and images into the frame list (ReadHeader is called if it has not been called yet).
+    Frames are added in file order.
+  */
+  virtual PlusStatus Read(vtkIGSIOTrackedFrameList* frameList);
+
+  vtkSetStdStringMacro(FileName);
+  vtkGetStdStringMacro(FileName);
+
+  /*! Number of threads that convert frames (0 = one per processor core) */
+  vtkSetMacro(NumberOfThreads, unsigned int);
+  vtkGetMacro(NumberOfThreads, unsigned int);
+
+  /*! Approximate size of the pixel data that is read or inflated at once. A chunk contains at least one frame. */
+  vtkSetMacro(ChunkSizeBytes, unsigned long long);
+  vtkGetMacro(ChunkSizeBytes, unsigned long long);
+
+  /*! Called from the calling thread after each converted chunk */
+  void SetProgressCallback(const ProgressCallbackType& progressCallback) { this->ProgressCallback = progressCallback; }
+
+protected:
+  vtkPlusImageSequenceReader();
+  virtual ~vtkPlusImageSequenceReader();
+
+  /*! Check that the pixel data layout described by the custom strings of the header is supported */
+  PlusStatus CheckDataLayout();
+
+protected:
+  std::string FileName;
+  unsigned int NumberOfThreads;
+  unsigned long long ChunkSizeBytes;
+  ProgressCallbackType ProgressCallback;
+
+  bool HeaderRead;
+
+  /*! Custom strings and frames with their fields (without images) parsed from the header */
+  vtkIGSIOTrackedFrameList* HeaderFrameList;
+
+  FrameSizeType FrameSize;
+  unsigned int NumberOfFrames;
+  unsigned int NumberOfScalarComponents;
+  int ScalarType;
+  US_IMAGE_TYPE ImageType;
+  US_IMAGE_ORIENTATION ImageOrientationInFile;
+
+  bool Compressed;
+  std::string DataFileName;
+  unsigned long long DataOffset;
+
+private:
+  vtkPlusImageSequenceReader(const vtkPlusImageSequenceReader&);  // Not implemented.
+  void operator=(const vtkPlusImageSequenceReader&);  // Not implemented.
+};
+
+#endif // __vtkPlusImageSequenceReader_h
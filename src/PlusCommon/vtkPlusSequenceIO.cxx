@@ -5,13 +5,21 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "vtkPlusImageSequenceReader.h"
 #include "vtkPlusSequenceIO.h"
+#include "vtkPlusSequenceManifest.h"
+#include "vtkPlusTrackingSequenceIO.h"
 
 #include <vtkIGSIOSequenceIO.h>
 
+#include <vtkIGSIOTrackedFrameList.h>
+
 /// VTK includes
 #include <vtkNew.h>
 
+const char* vtkPlusSequenceIO::FRAME_HASH_FIELD_NAME = "FrameHash";
+const char* vtkPlusSequenceIO::REFERENCED_FRAME_OFFSET_FIELD_NAME = "ReferencedFrameOffset";
+
 //----------------------------------------------------------------------------
 igsioStatus vtkPlusSequenceIO::Write(const std::string& filename, vtkIGSIOTrackedFrameList* frameList, US_IMAGE_ORIENTATION orientationInFile/*=US_IMG_ORIENT_MF*/, bool useCompression/*=true*/, bool enableImageDataWrite/*=true*/)
 {
@@ -20,6 +28,11 @@ igsioStatus vtkPlusSequenceIO::Write(const std::string& filename, vtkIGSIOTracke
   {
     outputDirectory = vtkPlusConfig::GetInstance()->GetOutputDirectory();
   }
+  if (vtkPlusTrackingSequenceIO::CanWriteFile(filename))
+  {
+    std::string outputPath = vtksys::SystemTools::CollapseFullPath(filename, vtkPlusConfig::GetInstance()->GetOutputDirectory());
+    return vtkPlusTrackingSequenceIO::Write(outputPath, frameList, useCompression);
+  }
   return vtkIGSIOSequenceIO::Write(filename, outputDirectory, frameList, orientationInFile, useCompression, enableImageDataWrite);
 }
 
@@ -31,11 +44,24 @@ igsioStatus vtkPlusSequenceIO::Write(const std::string& filename, igsioTrackedFr
   {
     outputDirectory = vtkPlusConfig::GetInstance()->GetOutputDirectory();
   }
+  if (vtkPlusTrackingSequenceIO::CanWriteFile(filename))
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> frameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    frameList->AddTrackedFrame(frame);
+    std::string outputPath = vtksys::SystemTools::CollapseFullPath(filename, vtkPlusConfig::GetInstance()->GetOutputDirectory());
+    return vtkPlusTrackingSequenceIO::Write(outputPath, frameList, useCompression);
+  }
   return vtkIGSIOSequenceIO::Write(filename, outputDirectory, frame, orientationInFile, useCompression, enableImageDataWrite);
 }
 
 //----------------------------------------------------------------------------
 igsioStatus vtkPlusSequenceIO::Read(const std::string& trackedSequenceDataFileName, vtkIGSIOTrackedFrameList* frameList)
+{
+  return Read(trackedSequenceDataFileName, frameList, ProgressCallbackType());
+}
+
+//----------------------------------------------------------------------------
+igsioStatus vtkPlusSequenceIO::Read(const std::string& trackedSequenceDataFileName, vtkIGSIOTrackedFrameList* frameList, const ProgressCallbackType& progressCallback, unsigned int numberOfThreads /*=0*/)
 {
   std::string trackedSequenceDataFilePath = trackedSequenceDataFileName;
 
@@ -48,5 +74,73 @@ igsioStatus vtkPlusSequenceIO::Read(const std::string& trackedSequenceDataFileNa
       return PLUS_FAIL;
     }
   }
-  return vtkIGSIOSequenceIO::Read(trackedSequenceDataFilePath, frameList);
+  if (vtkPlusSequenceManifest::CanReadFile(trackedSequenceDataFilePath))
+  {
+    return vtkPlusSequenceManifest::Read(trackedSequenceDataFilePath, frameList, progressCallback, numberOfThreads);
+  }
+  if (vtkPlusTrackingSequenceIO::CanReadFile(trackedSequenceDataFilePath))
+  {
+    return vtkPlusTrackingSequenceIO::Read(trackedSequenceDataFilePath, frameList, progressCallback, numberOfThreads);
+  }
+
+  igsioStatus status = PLUS_FAIL;
+  vtkSmartPointer<vtkPlusImageSequenceReader> imageSequenceReader = vtkSmartPointer<vtkPlusImageSequenceReader>::New();
+  imageSequenceReader->SetFileName(trackedSequenceDataFilePath);
+  bool parallelReaderSupported = vtkPlusImageSequenceReader::CanReadFile(trackedSequenceDataFilePath);
+  if (parallelReaderSupported && imageSequenceReader->ReadHeader() != PLUS_SUCCESS)
+  {
+    LOG_WARNING("Data layout of " << trackedSequenceDataFilePath << " is not supported by the parallel image sequence reader, frames are decoded on a single thread");
+    parallelReaderSupported = false;
+  }
+  if (parallelReaderSupported)
+  {
+    imageSequenceReader->SetNumberOfThreads(numberOfThreads);
+    imageSequenceReader->SetProgressCallback(progressCallback);
+    status = imageSequenceReader->Read(frameList);
+  }
+  else
+  {
+    status = vtkIGSIOSequenceIO::Read(trackedSequenceDataFilePath, frameList);
+    if (progressCallback)
+    {
+      progressCallback(1.0);
+    }
+  }
+  if (status == PLUS_SUCCESS)
+  {
+    status = ResolveFrameReferences(frameList);
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+igsioStatus vtkPlusSequenceIO::ResolveFrameReferences(vtkIGSIOTrackedFrameList* frameList)
+{
+  if (frameList == NULL)
+  {
+    LOG_ERROR("Unable to resolve frame references: frame list is invalid");
+    return PLUS_FAIL;
+  }
+
+  igsioStatus status = PLUS_SUCCESS;
+  for (unsigned int frameIndex = 0; frameIndex < frameList->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    igsioTrackedFrame* trackedFrame = frameList->GetTrackedFrame(frameIndex);
+    std::string offsetStr = trackedFrame->GetFrameField(REFERENCED_FRAME_OFFSET_FIELD_NAME);
+    if (offsetStr.empty())
+    {
+      continue;
+    }
+    unsigned int offset = 0;
+    if (igsioCommon::StringToInt<unsigned int>(offsetStr.c_str(), offset) != PLUS_SUCCESS || offset == 0 || offset > frameIndex)
+    {
+      LOG_ERROR("Invalid " << REFERENCED_FRAME_OFFSET_FIELD_NAME << " value in frame " << frameIndex << ": " << offsetStr);
+      status = PLUS_FAIL;
+      continue;
+    }
+    // Frames are processed in order, so the referenced frame already has its image
+    trackedFrame->SetImageData(*frameList->GetTrackedFrame(frameIndex - offset)->GetImageData());
+    trackedFrame->DeleteFrameField(REFERENCED_FRAME_OFFSET_FIELD_NAME);
+  }
+  return status;
 }
@@ -9,9 +9,16 @@
 
 #include "igsioCommon.h"
 
+#include <functional>
+
 /*!
   \class vtkPlusSequenceIO
   \brief Class to abstract away specific sequence file read/write details
+
+  Tracking-only sequence files (.igs.trk) are handled by vtkPlusTrackingSequenceIO,
+  segmented recordings (.igs.manifest) are read by vtkPlusSequenceManifest as one sequence,
+  MetaImage and NRRD image sequences are read by vtkPlusImageSequenceReader if it supports the data layout,
+  all other files are read and written by vtkIGSIOSequenceIO.
   \ingroup PlusLibCommon
 */
 class vtkPlusCommonExport vtkPlusSequenceIO : public vtkObject
@@ -23,9 +30,37 @@ public:
   /*! Write object contents into file */
   static igsioStatus Write(const std::string& filename, vtkIGSIOTrackedFrameList* frameList, US_IMAGE_ORIENTATION orientationInFile = US_IMG_ORIENT_MF, bool useCompression = true, bool EnableImageDataWrite = true);
 
+  /*! Function that is called with the completed fraction (0.0-1.0) while reading */
+  typedef std::function<void(double)> ProgressCallbackType;
+
   /*! Read file contents into the object */
   static igsioStatus Read(const std::string& filename, vtkIGSIOTrackedFrameList* frameList);
 
+  /*!
+    Read file contents into the object.
+    Frames are decoded in parallel on numberOfThreads threads (0 = one per processor core) and added in recording order.
+    progressCallback is called after each decoded segment, block or chunk of frames.
+    progressCallback may be called from worker threads, but never concurrently.
+  */
+  static igsioStatus Read(const std::string& filename, vtkIGSIOTrackedFrameList* frameList, const ProgressCallbackType& progressCallback, unsigned int numberOfThreads = 0);
+
+  /*!
+    Restore the image of frames that were recorded as a reference to an identical earlier frame
+    (see REFERENCED_FRAME_OFFSET_FIELD_NAME). The image is copied from the referenced frame and the field is removed.
+    Called automatically by Read.
+  */
+  static igsioStatus ResolveFrameReferences(vtkIGSIOTrackedFrameList* frameList);
+
+  /*! Name of the frame field that stores the hash of the frame pixel data */
+  static const char* FRAME_HASH_FIELD_NAME;
+
+  /*!
+    Name of the frame field that marks a frame whose image is identical to an earlier frame in the same file.
+    The value is the number of frames to go back to reach the frame that holds the image. The image of
+    the referencing frame is not meaningful in the file (it is blank).
+  */
+  static const char* REFERENCED_FRAME_OFFSET_FIELD_NAME;
+
 protected:
   vtkPlusSequenceIO();
   virtual ~vtkPlusSequenceIO();
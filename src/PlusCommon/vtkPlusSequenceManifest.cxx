@@ -0,0 +1,369 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusSequenceManifest.h"
+#include "vtkPlusTrackingSequenceIO.h"
+
+// IGSIO includes
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkXMLDataElement.h>
+#include <vtkXMLUtilities.h>
+#include <vtksys/SystemTools.hxx>
+
+// STL includes
+#include <algorithm>
+#include <mutex>
+
+#ifdef _WIN32
+  #include <fcntl.h>
+  #include <io.h>
+#else
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPlusSequenceManifest);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*!
+    Append the frames of source to destination. Each frame is removed from source as soon as it is copied,
+    so the frames of a segment are not held twice in memory.
+  */
+  PlusStatus MoveFrames(vtkIGSIOTrackedFrameList* source, vtkIGSIOTrackedFrameList* destination)
+  {
+    while (source->GetNumberOfTrackedFrames() > 0)
+    {
+      if (destination->AddTrackedFrame(source->GetTrackedFrame(0)) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      source->RemoveTrackedFrameRange(0, 0);
+    }
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkPlusSequenceManifest::vtkPlusSequenceManifest()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusSequenceManifest::~vtkPlusSequenceManifest()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSequenceManifest::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Segments: " << this->Segments.size() << std::endl;
+  for (std::vector<Segment>::const_iterator it = this->Segments.begin(); it != this->Segments.end(); ++it)
+  {
+    os << indent.GetNextIndent() << it->FileName << ": " << it->NumberOfFrames << " frames" << (it->Complete ? "" : " (incomplete)") << std::endl;
+  }
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusSequenceManifest::GetFileExtension()
+{
+  return ".igs.manifest";
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusSequenceManifest::CanReadFile(const std::string& filename)
+{
+  std::string lowerCaseFilename = vtksys::SystemTools::LowerCase(filename);
+  std::string extension = GetFileExtension();
+  return lowerCaseFilename.size() >= extension.size()
+         && lowerCaseFilename.compare(lowerCaseFilename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceManifest::SyncFileToDisk(const std::string& filename)
+{
+#ifdef _WIN32
+  int fileDescriptor = _open(filename.c_str(), _O_RDWR | _O_BINARY);
+  if (fileDescriptor < 0)
+  {
+    LOG_ERROR("Unable to open file for flushing to disk: " << filename);
+    return PLUS_FAIL;
+  }
+  bool success = (_commit(fileDescriptor) == 0);
+  _close(fileDescriptor);
+#else
+  int fileDescriptor = open(filename.c_str(), O_RDONLY);
+  if (fileDescriptor < 0)
+  {
+    LOG_ERROR("Unable to open file for flushing to disk: " << filename);
+    return PLUS_FAIL;
+  }
+  bool success = (fsync(fileDescriptor) == 0);
+  close(fileDescriptor);
+#endif
+  if (!success)
+  {
+    LOG_ERROR("Failed to flush file to disk: " << filename);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSequenceManifest::DeepCopy(vtkPlusSequenceManifest* source)
+{
+  if (source == NULL)
+  {
+    LOG_ERROR("vtkPlusSequenceManifest::DeepCopy failed: invalid source");
+    return;
+  }
+  this->Segments = source->Segments;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSequenceManifest::Clear()
+{
+  this->Segments.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSequenceManifest::SetSegment(const Segment& segment)
+{
+  for (std::vector<Segment>::iterator it = this->Segments.begin(); it != this->Segments.end(); ++it)
+  {
+    if (it->FileName == segment.FileName)
+    {
+      *it = segment;
+      this->Modified();
+      return;
+    }
+  }
+  this->Segments.push_back(segment);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSequenceManifest::RemoveSegment(const std::string& segmentFileName)
+{
+  for (std::vector<Segment>::iterator it = this->Segments.begin(); it != this->Segments.end(); ++it)
+  {
+    if (it->FileName == segmentFileName)
+    {
+      this->Segments.erase(it);
+      this->Modified();
+      return;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusSequenceManifest::GetNumberOfSegments() const
+{
+  return static_cast<int>(this->Segments.size());
+}
+
+//----------------------------------------------------------------------------
+const vtkPlusSequenceManifest::Segment& vtkPlusSequenceManifest::GetSegment(int index) const
+{
+  return this->Segments.at(index);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceManifest::ReadFile(const std::string& manifestFilename)
+{
+  vtkSmartPointer<vtkXMLDataElement> manifestElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromFile(manifestFilename.c_str()));
+  if (manifestElement == NULL || manifestElement->GetName() == NULL || std::string(manifestElement->GetName()) != "SequenceManifest")
+  {
+    LOG_ERROR("Unable to read sequence manifest file: " << manifestFilename);
+    return PLUS_FAIL;
+  }
+
+  this->Segments.clear();
+  for (int i = 0; i < manifestElement->GetNumberOfNestedElements(); ++i)
+  {
+    vtkXMLDataElement* segmentElement = manifestElement->GetNestedElement(i);
+    if (segmentElement == NULL || std::string(segmentElement->GetName()) != "Segment" || segmentElement->GetAttribute("FileName") == NULL)
+    {
+      continue;
+    }
+    Segment segment;
+    segment.FileName = segmentElement->GetAttribute("FileName");
+    int numberOfFrames(0);
+    if (segmentElement->GetScalarAttribute("NumberOfFrames", numberOfFrames))
+    {
+      segment.NumberOfFrames = numberOfFrames;
+    }
+    segmentElement->GetScalarAttribute("FirstTimestamp", segment.FirstTimestamp);
+    segmentElement->GetScalarAttribute("LastTimestamp", segment.LastTimestamp);
+    segment.Complete = (segmentElement->GetAttribute("Complete") != NULL && STRCASECMP(segmentElement->GetAttribute("Complete"), "TRUE") == 0);
+    this->Segments.push_back(segment);
+  }
+  this->Modified();
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceManifest::WriteFile(const std::string& manifestFilename)
+{
+  vtkSmartPointer<vtkXMLDataElement> manifestElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  manifestElement->SetName("SequenceManifest");
+  manifestElement->SetIntAttribute("Version", 1);
+  for (std::vector<Segment>::const_iterator it = this->Segments.begin(); it != this->Segments.end(); ++it)
+  {
+    vtkSmartPointer<vtkXMLDataElement> segmentElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    segmentElement->SetName("Segment");
+    segmentElement->SetAttribute("FileName", it->FileName.c_str());
+    segmentElement->SetIntAttribute("NumberOfFrames", static_cast<int>(it->NumberOfFrames));
+    if (it->NumberOfFrames > 0)
+    {
+      segmentElement->SetDoubleAttribute("FirstTimestamp", it->FirstTimestamp);
+      segmentElement->SetDoubleAttribute("LastTimestamp", it->LastTimestamp);
+    }
+    segmentElement->SetAttribute("Complete", it->Complete ? "TRUE" : "FALSE");
+    manifestElement->AddNestedElement(segmentElement);
+  }
+
+  std::string temporaryFilename = manifestFilename + ".tmp";
+  if (igsioCommon::XML::PrintXML(temporaryFilename.c_str(), manifestElement) != PLUS_SUCCESS
+      || SyncFileToDisk(temporaryFilename) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to write sequence manifest file: " << temporaryFilename);
+    return PLUS_FAIL;
+  }
+  if (!vtksys::SystemTools::RenameFile(temporaryFilename.c_str(), manifestFilename.c_str()))
+  {
+    LOG_ERROR("Unable to rename " << temporaryFilename << " to " << manifestFilename);
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceManifest::GetReadableSegments(const std::string& manifestFilename, std::vector<std::string>& segmentPaths, std::vector<Segment>* segments /*=NULL*/)
+{
+  segmentPaths.clear();
+  if (segments != NULL)
+  {
+    segments->clear();
+  }
+
+  vtkSmartPointer<vtkPlusSequenceManifest> manifest = vtkSmartPointer<vtkPlusSequenceManifest>::New();
+  if (manifest->ReadFile(manifestFilename) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  std::string manifestDirectory = vtksys::SystemTools::GetFilenamePath(manifestFilename);
+  for (int i = 0; i < manifest->GetNumberOfSegments(); ++i)
+  {
+    const Segment& segment = manifest->GetSegment(i);
+    std::string segmentPath = manifestDirectory.empty() ? segment.FileName : manifestDirectory + "/" + segment.FileName;
+    if (!segment.Complete && !vtkPlusTrackingSequenceIO::CanReadFile(segmentPath))
+    {
+      LOG_WARNING("Segment " << segmentPath << " of " << manifestFilename << " was not completely written, it is skipped.");
+      continue;
+    }
+    if (!vtksys::SystemTools::FileExists(segmentPath, true))
+    {
+      LOG_ERROR("Segment " << segmentPath << " of " << manifestFilename << " is not found.");
+      return PLUS_FAIL;
+    }
+    segmentPaths.push_back(segmentPath);
+    if (segments != NULL)
+    {
+      segments->push_back(segment);
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceManifest::Read(const std::string& manifestFilename, vtkIGSIOTrackedFrameList* frameList,
+    const ProgressCallbackType& progressCallback /*=ProgressCallbackType()*/, unsigned int numberOfThreads /*=0*/)
+{
+  if (frameList == NULL)
+  {
+    LOG_ERROR("vtkPlusSequenceManifest::Read failed: invalid frame list");
+    return PLUS_FAIL;
+  }
+
+  std::vector<std::string> segmentPaths;
+  std::vector<Segment> segments;
+  if (GetReadableSegments(manifestFilename, segmentPaths, &segments) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  std::vector<double> segmentWeights;
+  double totalWeight = 0.0;
+  for (size_t segmentIndex = 0; segmentIndex < segments.size(); ++segmentIndex)
+  {
+    // Progress is reported proportionally to the number of frames
+    segmentWeights.push_back(std::max(1.0, static_cast<double>(segments[segmentIndex].NumberOfFrames)));
+    totalWeight += segmentWeights.back();
+  }
+
+  // Segments are read in parallel in waves of one segment per thread, so besides the output list at most one wave
+  // of segments is held in memory. The first segment is read directly into the output list,
+  // as it defines the image orientation and custom fields of the whole sequence.
+  const unsigned int numberOfSegments = static_cast<unsigned int>(segmentPaths.size());
+  const unsigned int segmentsPerWave = PlusCommon::GetNumberOfWorkerThreads(numberOfThreads);
+  std::mutex progressMutex;
+  double completedWeight = 0.0;
+  for (unsigned int firstSegmentIndex = 0; firstSegmentIndex < numberOfSegments; firstSegmentIndex += segmentsPerWave)
+  {
+    const unsigned int numberOfWaveSegments = std::min(segmentsPerWave, numberOfSegments - firstSegmentIndex);
+    std::vector<vtkSmartPointer<vtkIGSIOTrackedFrameList> > segmentFrameLists(numberOfWaveSegments);
+    std::vector<PlusStatus> segmentStatus(numberOfWaveSegments, PLUS_FAIL);
+    PlusCommon::ParallelFor(numberOfWaveSegments, [&](unsigned int waveIndex)
+    {
+      const unsigned int segmentIndex = firstSegmentIndex + waveIndex;
+      vtkIGSIOTrackedFrameList* segmentFrameList = frameList;
+      if (segmentIndex > 0)
+      {
+        segmentFrameLists[waveIndex] = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+        segmentFrameList = segmentFrameLists[waveIndex];
+      }
+      // Segments are already processed in parallel, so each segment is read on a single thread
+      segmentStatus[waveIndex] = vtkPlusSequenceIO::Read(segmentPaths[segmentIndex], segmentFrameList, vtkPlusSequenceIO::ProgressCallbackType(), 1);
+      if (progressCallback)
+      {
+        std::lock_guard<std::mutex> progressLock(progressMutex);
+        completedWeight += segmentWeights[segmentIndex];
+        progressCallback(completedWeight / totalWeight);
+      }
+    }, numberOfThreads);
+
+    for (unsigned int waveIndex = 0; waveIndex < numberOfWaveSegments; ++waveIndex)
+    {
+      const unsigned int segmentIndex = firstSegmentIndex + waveIndex;
+      if (segmentStatus[waveIndex] != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to read segment " << segmentPaths[segmentIndex] << " of " << manifestFilename);
+        return PLUS_FAIL;
+      }
+      if (segmentIndex > 0 && MoveFrames(segmentFrameLists[waveIndex], frameList) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frames of segment " << segmentPaths[segmentIndex] << " of " << manifestFilename);
+        return PLUS_FAIL;
+      }
+      segmentFrameLists[waveIndex] = NULL;
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
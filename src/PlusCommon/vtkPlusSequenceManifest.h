@@ -0,0 +1,125 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusSequenceManifest_h
+#define __vtkPlusSequenceManifest_h
+
+#include "vtkPlusCommonExport.h"
+
+#include "PlusCommon.h"
+
+#include <vtkObject.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class vtkIGSIOTrackedFrameList;
+
+/*!
+  \class vtkPlusSequenceManifest
+  \brief List of sequence file segments that together form one logical sequence (.igs.manifest)
+
+  Segmented recordings (see vtkPlusVirtualCapture) are written into a series of self-contained sequence files.
+  The manifest is a small XML file that lists the segments in recording order, with their frame count, time range
+  and whether the segment was completely written. Segment file names are stored relative to the manifest file.
+
+  Example:
+  \code
+  <SequenceManifest Version="1">
+    <Segment FileName="Recording_20180101_120000_0000.nrrd" NumberOfFrames="900" FirstTimestamp="12.3" LastTimestamp="42.3" Complete="TRUE" />
+    <Segment FileName="Recording_20180101_120000_0001.nrrd" NumberOfFrames="0" Complete="FALSE" />
+  </SequenceManifest>
+  \endcode
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport vtkPlusSequenceManifest : public vtkObject
+{
+public:
+  struct Segment
+  {
+    Segment() : NumberOfFrames(0), FirstTimestamp(UNDEFINED_TIMESTAMP), LastTimestamp(UNDEFINED_TIMESTAMP), Complete(false) {}
+    /*! File name relative to the manifest file */
+    std::string FileName;
+    long NumberOfFrames;
+    double FirstTimestamp;
+    double LastTimestamp;
+    /*! True if the segment file is finalized and flushed to disk */
+    bool Complete;
+  };
+
+  static vtkPlusSequenceManifest* New();
+  vtkTypeMacro(vtkPlusSequenceManifest, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Returns true if the file name has the manifest file extension */
+  static bool CanReadFile(const std::string& filename);
+  /*! File extension of manifest files, including the leading dot */
+  static std::string GetFileExtension();
+
+  /*! Function that is called with the completed fraction (0.0-1.0) while reading */
+  typedef std::function<void(double)> ProgressCallbackType;
+
+  /*!
+    Read all segments listed in the manifest into the frame list, in recording order.
+    Incomplete segments are read if possible (the reader accepts partially written files), otherwise skipped with a warning.
+    Segments are read in parallel on numberOfThreads threads (0 = one per processor core). At most one segment per thread
+    is held in memory besides the frame list, and frames are moved into the frame list one by one.
+    progressCallback is called from the worker threads (one call at a time) after each segment.
+  */
+  static PlusStatus Read(const std::string& manifestFilename, vtkIGSIOTrackedFrameList* frameList,
+                         const ProgressCallbackType& progressCallback = ProgressCallbackType(), unsigned int numberOfThreads = 0);
+
+  /*!
+    Get the full paths of the segments that Read would read, in recording order.
+    Allows processing a long recording one segment at a time.
+    \param segments Optional output, manifest entries of the returned segments
+  */
+  static PlusStatus GetReadableSegments(const std::string& manifestFilename, std::vector<std::string>& segmentPaths, std::vector<Segment>* segments = NULL);
+
+  /*!
+    Flush the operating system buffers of a file to the disk. Used for making sure that
+    a segment is durable before it is referenced as complete in the manifest.
+  */
+  static PlusStatus SyncFileToDisk(const std::string& filename);
+
+  /*! Read the segment list from a manifest file */
+  virtual PlusStatus ReadFile(const std::string& manifestFilename);
+
+  /*!
+    Write the segment list into a manifest file. The file is written under a temporary name, flushed to disk
+    and then renamed, so a crash never leaves a partially written manifest behind.
+  */
+  virtual PlusStatus WriteFile(const std::string& manifestFilename);
+
+  /*! Copy the segment list of another manifest */
+  virtual void DeepCopy(vtkPlusSequenceManifest* source);
+
+  /*! Remove all segments */
+  virtual void Clear();
+
+  /*! Add a segment or replace it if a segment with the same file name already exists */
+  virtual void SetSegment(const Segment& segment);
+
+  /*! Remove the segment with the specified file name */
+  virtual void RemoveSegment(const std::string& segmentFileName);
+
+  virtual int GetNumberOfSegments() const;
+  virtual const Segment& GetSegment(int index) const;
+
+protected:
+  vtkPlusSequenceManifest();
+  virtual ~vtkPlusSequenceManifest();
+
+  std::vector<Segment> Segments;
+
+private:
+  vtkPlusSequenceManifest(const vtkPlusSequenceManifest&);  // Not implemented.
+  void operator=(const vtkPlusSequenceManifest&);  // Not implemented.
+};
+
+#endif // __vtkPlusSequenceManifest_h
@@ -0,0 +1,755 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusTrackingSequenceIO.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkByteSwap.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtk_zlib.h>
+#include <vtksys/SystemTools.hxx>
+
+// STL includes
+#include <cstring>
+#include <mutex>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPlusTrackingSequenceIO);
+
+//----------------------------------------------------------------------------
+namespace
+{
+  const char FILE_SIGNATURE[8] = { 'P', 'L', 'U', 'S', 'T', 'R', 'K', '\0' };
+  const vtkTypeUInt32 FILE_FORMAT_VERSION = 1;
+  const vtkTypeUInt32 BLOCK_SIGNATURE = 0x4B4C4254; // "TBLK"
+
+  const vtkTypeUInt8 COLUMN_ENCODING_RAW = 0;
+  const vtkTypeUInt8 COLUMN_ENCODING_SHUFFLE_DEFLATE = 1;
+
+  /*! Status value of a transform that is not present in a frame */
+  const vtkTypeUInt8 TRANSFORM_MISSING = 0xFF;
+
+  /*! Number of matrix elements stored per pose (first three rows) */
+  const int POSE_ELEMENT_COUNT = 12;
+
+  //----------------------------------------------------------------------------
+  template<typename T>
+  void AppendValue(std::string& buffer, T value)
+  {
+    vtkByteSwap::SwapLE(&value);
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  //----------------------------------------------------------------------------
+  void AppendString(std::string& buffer, const std::string& value)
+  {
+    AppendValue<vtkTypeUInt32>(buffer, static_cast<vtkTypeUInt32>(value.size()));
+    buffer.append(value);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Sequential reader over an in-memory copy of the file. All accessors fail instead of reading past the end. */
+  class ByteReader
+  {
+  public:
+    ByteReader(const std::vector<char>& data, size_t position = 0) : Data(data), Position(position) {}
+
+    template<typename T>
+    bool ReadValue(T& value)
+    {
+      if (this->Position + sizeof(T) > this->Data.size())
+      {
+        return false;
+      }
+      memcpy(&value, &this->Data[this->Position], sizeof(T));
+      vtkByteSwap::SwapLE(&value);
+      this->Position += sizeof(T);
+      return true;
+    }
+
+    bool ReadString(std::string& value)
+    {
+      vtkTypeUInt32 length(0);
+      if (!this->ReadValue(length) || this->Position + length > this->Data.size())
+      {
+        return false;
+      }
+      value.assign(this->Data.data() + this->Position, length);
+      this->Position += length;
+      return true;
+    }
+
+    bool ReadBytes(size_t numberOfBytes, const char*& bytes)
+    {
+      if (this->Position + numberOfBytes > this->Data.size())
+      {
+        return false;
+      }
+      bytes = this->Data.data() + this->Position;
+      this->Position += numberOfBytes;
+      return true;
+    }
+
+    bool AtEnd() const { return this->Position >= this->Data.size(); }
+
+    size_t GetPosition() const { return this->Position; }
+
+  protected:
+    const std::vector<char>& Data;
+    size_t Position;
+  };
+
+  //----------------------------------------------------------------------------
+  /*!
+    Read one column written by WriteColumn into the output array, which must be already allocated. If output is NULL then the column is skipped.
+    The elements are in little-endian byte order, the caller converts them to the native order.
+  */
+  bool ReadColumn(ByteReader& reader, void* output, size_t elementSize, size_t numberOfElements)
+  {
+    vtkTypeUInt8 encoding(0);
+    vtkTypeUInt32 storedElementSize(0);
+    vtkTypeUInt64 rawSize(0);
+    vtkTypeUInt64 storedSize(0);
+    if (!reader.ReadValue(encoding) || !reader.ReadValue(storedElementSize) || !reader.ReadValue(rawSize) || !reader.ReadValue(storedSize))
+    {
+      return false;
+    }
+    if (storedElementSize != elementSize || rawSize != elementSize * numberOfElements)
+    {
+      LOG_ERROR("Unexpected column size in tracking sequence file");
+      return false;
+    }
+    const char* storedBytes = NULL;
+    if (!reader.ReadBytes(storedSize, storedBytes))
+    {
+      return false;
+    }
+    if (output == NULL)
+    {
+      return true;
+    }
+
+    if (encoding == COLUMN_ENCODING_RAW)
+    {
+      if (storedSize != rawSize)
+      {
+        return false;
+      }
+      memcpy(output, storedBytes, rawSize);
+      return true;
+    }
+    else if (encoding == COLUMN_ENCODING_SHUFFLE_DEFLATE)
+    {
+      std::vector<unsigned char> shuffled(rawSize);
+      uLongf uncompressedSize = static_cast<uLongf>(rawSize);
+      if (rawSize > 0 && (uncompress(shuffled.data(), &uncompressedSize, reinterpret_cast<const Bytef*>(storedBytes), static_cast<uLong>(storedSize)) != Z_OK
+                          || uncompressedSize != rawSize))
+      {
+        LOG_ERROR("Failed to decompress column of tracking sequence file");
+        return false;
+      }
+      // Undo the byte shuffle: byte b of element i is stored at b * numberOfElements + i
+      unsigned char* outputBytes = static_cast<unsigned char*>(output);
+      for (size_t byteIndex = 0; byteIndex < elementSize; ++byteIndex)
+      {
+        const unsigned char* plane = shuffled.data() + byteIndex * numberOfElements;
+        for (size_t i = 0; i < numberOfElements; ++i)
+        {
+          outputBytes[i * elementSize + byteIndex] = plane[i];
+        }
+      }
+      return true;
+    }
+
+    LOG_ERROR("Unknown column encoding in tracking sequence file: " << static_cast<int>(encoding));
+    return false;
+  }
+
+  //----------------------------------------------------------------------------
+  struct DecodedBlock
+  {
+    DecodedBlock() : Valid(false) {}
+    std::map<std::string, std::string> CustomStrings;
+    std::vector<igsioTrackedFrame*> Frames;
+    bool Valid;
+  };
+
+  //----------------------------------------------------------------------------
+  /*!
+    Parse one block starting at the current reader position.
+    If block is NULL then only the block boundaries are checked and the columns are not decompressed.
+    Returns false if the block is incomplete or invalid.
+  */
+  bool ParseBlock(ByteReader& reader, DecodedBlock* block)
+  {
+    vtkTypeUInt32 blockSignature(0);
+    vtkTypeUInt32 numberOfFrames(0);
+    vtkTypeUInt32 numberOfCustomStrings(0);
+    if (!reader.ReadValue(blockSignature) || blockSignature != BLOCK_SIGNATURE
+        || !reader.ReadValue(numberOfFrames) || !reader.ReadValue(numberOfCustomStrings))
+    {
+      return false;
+    }
+
+    for (vtkTypeUInt32 i = 0; i < numberOfCustomStrings; ++i)
+    {
+      std::string fieldName;
+      std::string fieldValue;
+      if (!reader.ReadString(fieldName) || !reader.ReadString(fieldValue))
+      {
+        return false;
+      }
+      if (block != NULL)
+      {
+        block->CustomStrings[fieldName] = fieldValue;
+      }
+    }
+
+    vtkTypeUInt32 numberOfTransforms(0);
+    if (!reader.ReadValue(numberOfTransforms))
+    {
+      return false;
+    }
+    std::vector<igsioTransformName> transformNames(numberOfTransforms);
+    for (vtkTypeUInt32 i = 0; i < numberOfTransforms; ++i)
+    {
+      std::string transformName;
+      if (!reader.ReadString(transformName) || (block != NULL && transformNames[i].SetTransformName(transformName) != PLUS_SUCCESS))
+      {
+        return false;
+      }
+    }
+
+    if (block == NULL)
+    {
+      // Only skip the columns
+      if (!ReadColumn(reader, NULL, sizeof(double), numberOfFrames)
+          || !ReadColumn(reader, NULL, sizeof(double), numberOfFrames)
+          || !ReadColumn(reader, NULL, sizeof(vtkTypeUInt64), numberOfFrames))
+      {
+        return false;
+      }
+      for (vtkTypeUInt32 transformIndex = 0; transformIndex < numberOfTransforms; ++transformIndex)
+      {
+        if (!ReadColumn(reader, NULL, sizeof(float), numberOfFrames * POSE_ELEMENT_COUNT)
+            || !ReadColumn(reader, NULL, sizeof(vtkTypeUInt8), numberOfFrames))
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    std::vector<double> timestamps(numberOfFrames);
+    std::vector<double> unfilteredTimestamps(numberOfFrames);
+    std::vector<vtkTypeUInt64> frameNumbers(numberOfFrames);
+    if (!ReadColumn(reader, timestamps.data(), sizeof(double), numberOfFrames)
+        || !ReadColumn(reader, unfilteredTimestamps.data(), sizeof(double), numberOfFrames)
+        || !ReadColumn(reader, frameNumbers.data(), sizeof(vtkTypeUInt64), numberOfFrames))
+    {
+      return false;
+    }
+    std::vector<std::vector<float> > poses(numberOfTransforms, std::vector<float>(numberOfFrames * POSE_ELEMENT_COUNT));
+    std::vector<std::vector<vtkTypeUInt8> > statuses(numberOfTransforms, std::vector<vtkTypeUInt8>(numberOfFrames));
+    for (vtkTypeUInt32 transformIndex = 0; transformIndex < numberOfTransforms; ++transformIndex)
+    {
+      if (!ReadColumn(reader, poses[transformIndex].data(), sizeof(float), numberOfFrames * POSE_ELEMENT_COUNT)
+          || !ReadColumn(reader, statuses[transformIndex].data(), sizeof(vtkTypeUInt8), numberOfFrames))
+      {
+        return false;
+      }
+      vtkByteSwap::SwapLERange(poses[transformIndex].data(), poses[transformIndex].size());
+    }
+    vtkByteSwap::SwapLERange(timestamps.data(), timestamps.size());
+    vtkByteSwap::SwapLERange(unfilteredTimestamps.data(), unfilteredTimestamps.size());
+    vtkByteSwap::SwapLERange(frameNumbers.data(), frameNumbers.size());
+
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    block->Frames.reserve(numberOfFrames);
+    for (vtkTypeUInt32 frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+    {
+      igsioTrackedFrame* frame = new igsioTrackedFrame;
+      frame->SetTimestamp(timestamps[frameIndex]);
+
+      std::ostringstream unfilteredTimestampFieldValue;
+      unfilteredTimestampFieldValue << std::fixed << unfilteredTimestamps[frameIndex];
+      frame->SetFrameField("UnfilteredTimestamp", unfilteredTimestampFieldValue.str());
+
+      std::ostringstream frameNumberFieldValue;
+      frameNumberFieldValue << frameNumbers[frameIndex];
+      frame->SetFrameField("FrameNumber", frameNumberFieldValue.str());
+
+      for (vtkTypeUInt32 transformIndex = 0; transformIndex < numberOfTransforms; ++transformIndex)
+      {
+        vtkTypeUInt8 status = statuses[transformIndex][frameIndex];
+        if (status == TRANSFORM_MISSING)
+        {
+          continue;
+        }
+        const float* pose = &poses[transformIndex][frameIndex * POSE_ELEMENT_COUNT];
+        matrix->Identity();
+        for (int row = 0; row < 3; ++row)
+        {
+          for (int column = 0; column < 4; ++column)
+          {
+            matrix->SetElement(row, column, pose[row * 4 + column]);
+          }
+        }
+        frame->SetFrameTransform(transformNames[transformIndex], matrix);
+        frame->SetFrameTransformStatus(transformNames[transformIndex], static_cast<ToolStatus>(status));
+      }
+
+      block->Frames.push_back(frame);
+    }
+
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkPlusTrackingSequenceIO::vtkPlusTrackingSequenceIO()
+  : FileName("")
+  , UseCompression(true)
+  , NumberOfFramesWritten(0)
+  , NumberOfBytesWritten(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusTrackingSequenceIO::~vtkPlusTrackingSequenceIO()
+{
+  if (this->IsOpen())
+  {
+    this->Close();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTrackingSequenceIO::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << this->FileName << std::endl;
+  os << indent << "UseCompression: " << (this->UseCompression ? "TRUE" : "FALSE") << std::endl;
+  os << indent << "NumberOfFramesWritten: " << this->NumberOfFramesWritten << std::endl;
+  os << indent << "NumberOfBytesWritten: " << this->NumberOfBytesWritten << std::endl;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusTrackingSequenceIO::GetFileExtension()
+{
+  return ".igs.trk";
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusTrackingSequenceIO::CanReadFile(const std::string& filename)
+{
+  return CanWriteFile(filename);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusTrackingSequenceIO::CanWriteFile(const std::string& filename)
+{
+  std::string lowerCaseFilename = vtksys::SystemTools::LowerCase(filename);
+  std::string extension = GetFileExtension();
+  return lowerCaseFilename.size() >= extension.size()
+         && lowerCaseFilename.compare(lowerCaseFilename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTrackingSequenceIO::Write(const std::string& filename, vtkIGSIOTrackedFrameList* frameList, bool useCompression /*=true*/)
+{
+  if (frameList == NULL)
+  {
+    LOG_ERROR("vtkPlusTrackingSequenceIO::Write failed: invalid frame list");
+    return PLUS_FAIL;
+  }
+
+  vtkSmartPointer<vtkPlusTrackingSequenceIO> writer = vtkSmartPointer<vtkPlusTrackingSequenceIO>::New();
+  writer->SetFileName(filename);
+  writer->SetUseCompression(useCompression);
+
+  std::vector<std::string> fieldNames;
+  frameList->GetCustomFieldNameList(fieldNames);
+  for (std::vector<std::string>::iterator it = fieldNames.begin(); it != fieldNames.end(); ++it)
+  {
+    const char* fieldValue = frameList->GetCustomString(it->c_str());
+    if (fieldValue != NULL)
+    {
+      writer->SetCustomString(*it, fieldValue);
+    }
+  }
+
+  if (writer->OpenForWriting() != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  if (writer->AppendFrames(frameList) != PLUS_SUCCESS)
+  {
+    writer->Close();
+    return PLUS_FAIL;
+  }
+  return writer->Close();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTrackingSequenceIO::OpenForWriting()
+{
+  if (this->IsOpen())
+  {
+    this->Close();
+  }
+
+  this->OutputStream.open(this->FileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!this->OutputStream.is_open())
+  {
+    LOG_ERROR("Unable to open tracking sequence file for writing: " << this->FileName);
+    return PLUS_FAIL;
+  }
+
+  std::string header(FILE_SIGNATURE, sizeof(FILE_SIGNATURE));
+  AppendValue<vtkTypeUInt32>(header, FILE_FORMAT_VERSION);
+  this->OutputStream.write(header.data(), header.size());
+
+  this->NumberOfFramesWritten = 0;
+  this->NumberOfBytesWritten = header.size();
+
+  return this->OutputStream.good() ? PLUS_SUCCESS : PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusTrackingSequenceIO::IsOpen() const
+{
+  return this->OutputStream.is_open();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTrackingSequenceIO::Close()
+{
+  if (!this->IsOpen())
+  {
+    return PLUS_SUCCESS;
+  }
+  this->OutputStream.flush();
+  bool success = this->OutputStream.good();
+  this->OutputStream.close();
+  if (!success)
+  {
+    LOG_ERROR("Failed to write tracking sequence file: " << this->FileName);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTrackingSequenceIO::SetCustomString(const std::string& fieldName, const std::string& fieldValue)
+{
+  if (fieldValue.empty())
+  {
+    this->CustomStrings.erase(fieldName);
+  }
+  else
+  {
+    this->CustomStrings[fieldName] = fieldValue;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTrackingSequenceIO::WriteColumn(const void* data, size_t elementSize, size_t numberOfElements)
+{
+  const size_t rawSize = elementSize * numberOfElements;
+  vtkTypeUInt8 encoding = COLUMN_ENCODING_RAW;
+  const char* storedData = static_cast<const char*>(data);
+  size_t storedSize = rawSize;
+
+  std::vector<unsigned char> compressed;
+  if (this->UseCompression && rawSize > 0)
+  {
+    // Byte shuffle: slowly changing values (timestamps, poses) then have long runs of identical high-order bytes
+    const unsigned char* inputBytes = static_cast<const unsigned char*>(data);
+    std::vector<unsigned char> shuffled(rawSize);
+    for (size_t byteIndex = 0; byteIndex < elementSize; ++byteIndex)
+    {
+      unsigned char* plane = shuffled.data() + byteIndex * numberOfElements;
+      for (size_t i = 0; i < numberOfElements; ++i)
+      {
+        plane[i] = inputBytes[i * elementSize + byteIndex];
+      }
+    }
+
+    uLongf compressedSize = compressBound(static_cast<uLong>(rawSize));
+    compressed.resize(compressedSize);
+    if (compress2(compressed.data(), &compressedSize, shuffled.data(), static_cast<uLong>(rawSize), Z_DEFAULT_COMPRESSION) != Z_OK)
+    {
+      LOG_ERROR("Failed to compress column of tracking sequence file: " << this->FileName);
+      return PLUS_FAIL;
+    }
+    if (compressedSize < rawSize)
+    {
+      encoding = COLUMN_ENCODING_SHUFFLE_DEFLATE;
+      storedData = reinterpret_cast<const char*>(compressed.data());
+      storedSize = compressedSize;
+    }
+  }
+
+  std::string columnHeader;
+  AppendValue<vtkTypeUInt8>(columnHeader, encoding);
+  AppendValue<vtkTypeUInt32>(columnHeader, static_cast<vtkTypeUInt32>(elementSize));
+  AppendValue<vtkTypeUInt64>(columnHeader, static_cast<vtkTypeUInt64>(rawSize));
+  AppendValue<vtkTypeUInt64>(columnHeader, static_cast<vtkTypeUInt64>(storedSize));
+  this->OutputStream.write(columnHeader.data(), columnHeader.size());
+  this->OutputStream.write(storedData, storedSize);
+  this->NumberOfBytesWritten += columnHeader.size() + storedSize;
+
+  return this->OutputStream.good() ? PLUS_SUCCESS : PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTrackingSequenceIO::AppendFrames(vtkIGSIOTrackedFrameList* frameList)
+{
+  if (!this->IsOpen())
+  {
+    LOG_ERROR("Cannot append frames: tracking sequence file is not open");
+    return PLUS_FAIL;
+  }
+  if (frameList == NULL || frameList->GetNumberOfTrackedFrames() == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  const unsigned int numberOfFrames = frameList->GetNumberOfTrackedFrames();
+
+  // Collect the union of transform names in this block
+  std::vector<igsioTransformName> transformNames;
+  std::map<std::string, size_t> transformIndices;
+  bool imageDataIgnored = false;
+  for (unsigned int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+  {
+    igsioTrackedFrame* frame = frameList->GetTrackedFrame(frameIndex);
+    std::vector<igsioTransformName> frameTransformNames;
+    frame->GetFrameTransformNameList(frameTransformNames);
+    for (std::vector<igsioTransformName>::iterator it = frameTransformNames.begin(); it != frameTransformNames.end(); ++it)
+    {
+      if (transformIndices.insert(std::make_pair(it->GetTransformName(), transformNames.size())).second)
+      {
+        transformNames.push_back(*it);
+      }
+    }
+    if (!imageDataIgnored && frame->GetImageData()->IsImageValid())
+    {
+      imageDataIgnored = true;
+    }
+  }
+  if (imageDataIgnored)
+  {
+    LOG_INFO("Tracking sequence files do not store image data. Image data is not written to " << this->FileName);
+  }
+
+  // Fill the columns
+  std::vector<double> timestamps(numberOfFrames);
+  std::vector<double> unfilteredTimestamps(numberOfFrames);
+  std::vector<vtkTypeUInt64> frameNumbers(numberOfFrames);
+  std::vector<std::vector<float> > poses(transformNames.size(), std::vector<float>(numberOfFrames * POSE_ELEMENT_COUNT, 0.0f));
+  std::vector<std::vector<vtkTypeUInt8> > statuses(transformNames.size(), std::vector<vtkTypeUInt8>(numberOfFrames, TRANSFORM_MISSING));
+
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (unsigned int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+  {
+    igsioTrackedFrame* frame = frameList->GetTrackedFrame(frameIndex);
+    timestamps[frameIndex] = frame->GetTimestamp();
+
+    unfilteredTimestamps[frameIndex] = timestamps[frameIndex];
+    std::string unfilteredTimestampString = frame->GetFrameField("UnfilteredTimestamp");
+    if (!unfilteredTimestampString.empty())
+    {
+      unfilteredTimestamps[frameIndex] = atof(unfilteredTimestampString.c_str());
+    }
+
+    frameNumbers[frameIndex] = 0;
+    std::string frameNumberString = frame->GetFrameField("FrameNumber");
+    if (!frameNumberString.empty())
+    {
+      frameNumbers[frameIndex] = static_cast<vtkTypeUInt64>(strtoull(frameNumberString.c_str(), NULL, 10));
+    }
+
+    for (size_t transformIndex = 0; transformIndex < transformNames.size(); ++transformIndex)
+    {
+      ToolStatus status(TOOL_INVALID);
+      if (frame->GetFrameTransform(transformNames[transformIndex], matrix) != PLUS_SUCCESS)
+      {
+        // not present in this frame
+        continue;
+      }
+      frame->GetFrameTransformStatus(transformNames[transformIndex], status);
+      statuses[transformIndex][frameIndex] = static_cast<vtkTypeUInt8>(status);
+      float* pose = &poses[transformIndex][frameIndex * POSE_ELEMENT_COUNT];
+      for (int row = 0; row < 3; ++row)
+      {
+        for (int column = 0; column < 4; ++column)
+        {
+          pose[row * 4 + column] = static_cast<float>(matrix->GetElement(row, column));
+        }
+      }
+    }
+  }
+
+  // Block header
+  std::string blockHeader;
+  AppendValue<vtkTypeUInt32>(blockHeader, BLOCK_SIGNATURE);
+  AppendValue<vtkTypeUInt32>(blockHeader, numberOfFrames);
+  AppendValue<vtkTypeUInt32>(blockHeader, static_cast<vtkTypeUInt32>(this->CustomStrings.size()));
+  for (std::map<std::string, std::string>::iterator it = this->CustomStrings.begin(); it != this->CustomStrings.end(); ++it)
+  {
+    AppendString(blockHeader, it->first);
+    AppendString(blockHeader, it->second);
+  }
+  AppendValue<vtkTypeUInt32>(blockHeader, static_cast<vtkTypeUInt32>(transformNames.size()));
+  for (std::vector<igsioTransformName>::iterator it = transformNames.begin(); it != transformNames.end(); ++it)
+  {
+    AppendString(blockHeader, it->GetTransformName());
+  }
+  this->OutputStream.write(blockHeader.data(), blockHeader.size());
+  this->NumberOfBytesWritten += blockHeader.size();
+
+  // Columns are stored in little-endian byte order
+  vtkByteSwap::SwapLERange(timestamps.data(), timestamps.size());
+  vtkByteSwap::SwapLERange(unfilteredTimestamps.data(), unfilteredTimestamps.size());
+  vtkByteSwap::SwapLERange(frameNumbers.data(), frameNumbers.size());
+  for (size_t transformIndex = 0; transformIndex < transformNames.size(); ++transformIndex)
+  {
+    vtkByteSwap::SwapLERange(poses[transformIndex].data(), poses[transformIndex].size());
+  }
+  if (this->WriteColumn(timestamps.data(), sizeof(double), numberOfFrames) != PLUS_SUCCESS
+      || this->WriteColumn(unfilteredTimestamps.data(), sizeof(double), numberOfFrames) != PLUS_SUCCESS
+      || this->WriteColumn(frameNumbers.data(), sizeof(vtkTypeUInt64), numberOfFrames) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to write timestamps to tracking sequence file: " << this->FileName);
+    return PLUS_FAIL;
+  }
+  for (size_t transformIndex = 0; transformIndex < transformNames.size(); ++transformIndex)
+  {
+    // Poses are shuffled per float, which groups the exponents of all 12 matrix elements together
+    if (this->WriteColumn(poses[transformIndex].data(), sizeof(float), numberOfFrames * POSE_ELEMENT_COUNT) != PLUS_SUCCESS
+        || this->WriteColumn(statuses[transformIndex].data(), sizeof(vtkTypeUInt8), numberOfFrames) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to write " << transformNames[transformIndex].GetTransformName() << " transform to tracking sequence file: " << this->FileName);
+      return PLUS_FAIL;
+    }
+  }
+
+  this->NumberOfFramesWritten += numberOfFrames;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTrackingSequenceIO::Read(const std::string& filename, vtkIGSIOTrackedFrameList* frameList)
+{
+  return Read(filename, frameList, ProgressCallbackType());
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTrackingSequenceIO::Read(const std::string& filename, vtkIGSIOTrackedFrameList* frameList, const ProgressCallbackType& progressCallback, unsigned int numberOfThreads /*=0*/)
+{
+  if (frameList == NULL)
+  {
+    LOG_ERROR("vtkPlusTrackingSequenceIO::Read failed: invalid frame list");
+    return PLUS_FAIL;
+  }
+
+  std::ifstream inputStream(filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+  if (!inputStream.is_open())
+  {
+    LOG_ERROR("Unable to open tracking sequence file for reading: " << filename);
+    return PLUS_FAIL;
+  }
+  std::streamsize fileSize = inputStream.tellg();
+  inputStream.seekg(0, std::ios::beg);
+  std::vector<char> fileContent(static_cast<size_t>(fileSize));
+  if (fileSize > 0 && !inputStream.read(fileContent.data(), fileSize))
+  {
+    LOG_ERROR("Unable to read tracking sequence file: " << filename);
+    return PLUS_FAIL;
+  }
+
+  ByteReader reader(fileContent);
+  const char* signature = NULL;
+  vtkTypeUInt32 version(0);
+  if (!reader.ReadBytes(sizeof(FILE_SIGNATURE), signature) || memcmp(signature, FILE_SIGNATURE, sizeof(FILE_SIGNATURE)) != 0
+      || !reader.ReadValue(version))
+  {
+    LOG_ERROR("File is not a tracking sequence file: " << filename);
+    return PLUS_FAIL;
+  }
+  if (version > FILE_FORMAT_VERSION)
+  {
+    LOG_ERROR("Tracking sequence file " << filename << " has unsupported version " << version);
+    return PLUS_FAIL;
+  }
+
+  // Find block boundaries. This only reads block and column headers, so it is fast.
+  std::vector<size_t> blockOffsets;
+  while (!reader.AtEnd())
+  {
+    size_t blockOffset = reader.GetPosition();
+    if (!ParseBlock(reader, NULL))
+    {
+      LOG_WARNING("Tracking sequence file " << filename << " ends with an incomplete block. Only the first " << blockOffsets.size() << " blocks are read.");
+      break;
+    }
+    blockOffsets.push_back(blockOffset);
+  }
+
+  // Decompress blocks and create frames in parallel
+  std::vector<DecodedBlock> blocks(blockOffsets.size());
+  std::mutex progressMutex;
+  unsigned int numberOfDecodedBlocks = 0;
+  PlusCommon::ParallelFor(static_cast<unsigned int>(blockOffsets.size()), [&](unsigned int blockIndex)
+  {
+    ByteReader blockReader(fileContent, blockOffsets[blockIndex]);
+    blocks[blockIndex].Valid = ParseBlock(blockReader, &blocks[blockIndex]);
+    if (progressCallback)
+    {
+      std::lock_guard<std::mutex> progressLock(progressMutex);
+      ++numberOfDecodedBlocks;
+      progressCallback(static_cast<double>(numberOfDecodedBlocks) / blockOffsets.size());
+    }
+  }, numberOfThreads);
+
+  // Add frames in recording order
+  PlusStatus status = PLUS_SUCCESS;
+  for (std::vector<DecodedBlock>::iterator block = blocks.begin(); block != blocks.end(); ++block)
+  {
+    if (!block->Valid || status != PLUS_SUCCESS)
+    {
+      if (status == PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to decode block of tracking sequence file: " << filename);
+        status = PLUS_FAIL;
+      }
+      for (std::vector<igsioTrackedFrame*>::iterator frame = block->Frames.begin(); frame != block->Frames.end(); ++frame)
+      {
+        delete *frame;
+      }
+      continue;
+    }
+    for (std::map<std::string, std::string>::iterator it = block->CustomStrings.begin(); it != block->CustomStrings.end(); ++it)
+    {
+      frameList->SetCustomString(it->first.c_str(), it->second.c_str());
+    }
+    for (std::vector<igsioTrackedFrame*>::iterator frame = block->Frames.begin(); frame != block->Frames.end(); ++frame)
+    {
+      frameList->TakeTrackedFrame(*frame);
+    }
+  }
+
+  return status;
+}
@@ -0,0 +1,122 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusTrackingSequenceIO_h
+#define __vtkPlusTrackingSequenceIO_h
+
+#include "vtkPlusCommonExport.h"
+
+#include "PlusCommon.h"
+
+#include <vtkObject.h>
+
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+
+class vtkIGSIOTrackedFrameList;
+
+/*!
+  \class vtkPlusTrackingSequenceIO
+  \brief Reads and writes tracking-only sequences in a compact columnar binary format (.igs.trk)
+
+  Tracker recordings stored in MetaImage/NRRD sequence files carry every transform as a per-frame text
+  header field, which is slow to write and parse and very large for long high-rate recordings.
+  This format stores the same content column by column: filtered timestamps, unfiltered timestamps, frame numbers
+  and for each transform a 12-float pose array (first three rows of the matrix) and a status byte.
+  Each column may be compressed (byte-shuffled and deflated) independently.
+
+  The file consists of a short file header followed by any number of self-contained blocks. Each block
+  lists its own transform names and custom strings, therefore frames can be appended while recording and
+  a file that is truncated by a crash can still be read up to the last complete block.
+  Image data is not stored. Numbers are stored in little-endian byte order.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport vtkPlusTrackingSequenceIO : public vtkObject
+{
+public:
+  static vtkPlusTrackingSequenceIO* New();
+  vtkTypeMacro(vtkPlusTrackingSequenceIO, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Function that is called with the completed fraction (0.0-1.0) while reading */
+  typedef std::function<void(double)> ProgressCallbackType;
+
+  /*! Returns true if the file name has the tracking sequence file extension */
+  static bool CanReadFile(const std::string& filename);
+  /*! Returns true if the file name has the tracking sequence file extension */
+  static bool CanWriteFile(const std::string& filename);
+  /*! File extension of tracking sequence files, including the leading dot */
+  static std::string GetFileExtension();
+
+  /*! Write all frames of the list into a new file. Image data is ignored. */
+  static PlusStatus Write(const std::string& filename, vtkIGSIOTrackedFrameList* frameList, bool useCompression = true);
+
+  /*! Read file contents into the frame list. Frames of an incomplete trailing block are skipped with a warning. */
+  static PlusStatus Read(const std::string& filename, vtkIGSIOTrackedFrameList* frameList);
+
+  /*!
+    Read file contents into the frame list. Blocks are decompressed and converted to frames in parallel
+    on numberOfThreads threads (0 = one per processor core), frames are added in recording order.
+    progressCallback is called from the worker threads (one call at a time) after each decoded block.
+  */
+  static PlusStatus Read(const std::string& filename, vtkIGSIOTrackedFrameList* frameList, const ProgressCallbackType& progressCallback, unsigned int numberOfThreads = 0);
+
+  /*! Create the file and write the file header. Frames can be added by AppendFrames afterwards. */
+  virtual PlusStatus OpenForWriting();
+
+  /*! Write all frames of the list as a new block */
+  virtual PlusStatus AppendFrames(vtkIGSIOTrackedFrameList* frameList);
+
+  /*! Flush and close the file */
+  virtual PlusStatus Close();
+
+  /*! Returns true if the file is open for writing */
+  virtual bool IsOpen() const;
+
+  /*! Set a custom string that is stored in each subsequently written block (empty value removes the field) */
+  virtual void SetCustomString(const std::string& fieldName, const std::string& fieldValue);
+
+  vtkSetStdStringMacro(FileName);
+  vtkGetStdStringMacro(FileName);
+
+  /*! If enabled then each column is byte-shuffled and deflated before writing */
+  vtkSetMacro(UseCompression, bool);
+  vtkGetMacro(UseCompression, bool);
+  vtkBooleanMacro(UseCompression, bool);
+
+  /*! Number of frames written since the file was opened */
+  vtkGetMacro(NumberOfFramesWritten, unsigned long);
+
+  /*! Number of bytes written since the file was opened */
+  vtkGetMacro(NumberOfBytesWritten, unsigned long long);
+
+protected:
+  vtkPlusTrackingSequenceIO();
+  virtual ~vtkPlusTrackingSequenceIO();
+
+  /*! Write one column, compressed if UseCompression is enabled. The elements must be already in little-endian byte order. */
+  PlusStatus WriteColumn(const void* data, size_t elementSize, size_t numberOfElements);
+
+protected:
+  std::string FileName;
+  bool UseCompression;
+  unsigned long NumberOfFramesWritten;
+  unsigned long long NumberOfBytesWritten;
+
+  std::ofstream OutputStream;
+
+  /*! Custom strings that are written into each block */
+  std::map<std::string, std::string> CustomStrings;
+
+private:
+  vtkPlusTrackingSequenceIO(const vtkPlusTrackingSequenceIO&);  // Not implemented.
+  void operator=(const vtkPlusTrackingSequenceIO&);  // Not implemented.
+};
+
+#endif // __vtkPlusTrackingSequenceIO_h
@@ -17,6 +17,8 @@ See License.txt for details.
 #include "vtkIGSIOTransformRepository.h"
 #include "vtksys/SystemTools.hxx"
 
+#include <algorithm>
+
 //----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusImageProcessorVideoSource);
@@ -29,6 +31,17 @@ vtkPlusImageProcessorVideoSource::vtkPlusImageProcessorVideoSource()
   , ProcessingAlgorithmAccessMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
   , GracePeriodLogLevel(vtkPlusLogger::LOG_LEVEL_DEBUG)
   , ProcessorAlgorithm(NULL)
+  , ProcessingPolicy(PROCESS_LATEST_FRAME)
+  , NumberOfProcessingThreads(1)
+  , MaxNumberOfFramesToProcess(5)
+  , LastSubmittedInputUid(0)
+  , LastSubmittedInputUidValid(false)
+  , NumberOfSkippedFrames(0)
+  , NumberOfProcessedFrames(0)
+  , LastFrameProcessingTimeSec(0.0)
+  , LastFrameLatencySec(0.0)
+  , MaximumFrameLatencySec(0.0)
+  , ProcessingThreadsStopRequested(false)
 {
   this->MissingInputGracePeriodSec = 2.0;
 
@@ -42,6 +55,7 @@ vtkPlusImageProcessorVideoSource::vtkPlusImageProcessorVideoSource()
 //----------------------------------------------------------------------------
 vtkPlusImageProcessorVideoSource::~vtkPlusImageProcessorVideoSource()
 {
+  this->StopProcessingThreads();
   if (this->TransformRepository)
   {
     this->TransformRepository->Delete();
@@ -58,6 +72,14 @@ vtkPlusImageProcessorVideoSource::~vtkPlusImageProcessorVideoSource()
 void vtkPlusImageProcessorVideoSource::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "ProcessingPolicy: " << (this->ProcessingPolicy == PROCESS_ALL_FRAMES ? "ALL_FRAMES" : "LATEST_FRAME") << "\n";
+  os << indent << "NumberOfProcessingThreads: " << this->NumberOfProcessingThreads << "\n";
+  os << indent << "MaxNumberOfFramesToProcess: " << this->MaxNumberOfFramesToProcess << "\n";
+  os << indent << "NumberOfProcessedFrames: " << this->NumberOfProcessedFrames << "\n";
+  os << indent << "NumberOfSkippedFrames: " << this->NumberOfSkippedFrames << "\n";
+  os << indent << "LastFrameProcessingTimeSec: " << this->LastFrameProcessingTimeSec << "\n";
+  os << indent << "LastFrameLatencySec: " << this->LastFrameLatencySec << "\n";
+  os << indent << "MaximumFrameLatencySec: " << this->MaximumFrameLatencySec << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -65,6 +87,11 @@ PlusStatus vtkPlusImageProcessorVideoSource::ReadConfiguration(vtkXMLDataElement
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableProcessing, deviceConfig);
+  XML_READ_ENUM2_ATTRIBUTE_OPTIONAL(ProcessingPolicy, deviceConfig,
+    "LATEST_FRAME", PROCESS_LATEST_FRAME,
+    "ALL_FRAMES", PROCESS_ALL_FRAMES);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfProcessingThreads, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, MaxNumberOfFramesToProcess, deviceConfig);
 
   // Read transform repository configuration
   if (this->TransformRepository->ReadConfiguration(rootConfigElement) != PLUS_SUCCESS)
@@ -138,6 +165,18 @@ PlusStatus vtkPlusImageProcessorVideoSource::WriteConfiguration(vtkXMLDataElemen
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceElement, rootConfig);
   deviceElement->SetAttribute("EnableCapturing", this->EnableProcessing ? "TRUE" : "FALSE");
+  if (this->ProcessingPolicy != PROCESS_LATEST_FRAME || deviceElement->GetAttribute("ProcessingPolicy") != NULL)
+  {
+    deviceElement->SetAttribute("ProcessingPolicy", this->ProcessingPolicy == PROCESS_ALL_FRAMES ? "ALL_FRAMES" : "LATEST_FRAME");
+  }
+  if (this->NumberOfProcessingThreads != 1 || deviceElement->GetAttribute("NumberOfProcessingThreads") != NULL)
+  {
+    deviceElement->SetIntAttribute("NumberOfProcessingThreads", this->NumberOfProcessingThreads);
+  }
+  if (this->MaxNumberOfFramesToProcess != 5 || deviceElement->GetAttribute("MaxNumberOfFramesToProcess") != NULL)
+  {
+    deviceElement->SetIntAttribute("MaxNumberOfFramesToProcess", this->MaxNumberOfFramesToProcess);
+  }
 
   // Write processor elements
   if (this->ProcessorAlgorithm != NULL)
@@ -187,15 +226,43 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalConnect()
   }
 
   this->LastProcessedInputDataTimestamp = 0;
+  this->LastSubmittedInputUidValid = false;
+  this->NumberOfSkippedFrames = 0;
+  this->NumberOfProcessedFrames = 0;
+  this->LastFrameProcessingTimeSec = 0.0;
+  this->LastFrameLatencySec = 0.0;
+  this->MaximumFrameLatencySec = 0.0;
+
+  if (this->NumberOfProcessingThreads > 1 && this->GetNumberOfWorkerThreadsToUse() == 0)
+  {
+    LOG_INFO("Frames are processed one at a time, as the processor is not stateless. Device ID: " << this->GetDeviceId());
+  }
 
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+int vtkPlusImageProcessorVideoSource::GetNumberOfWorkerThreadsToUse()
+{
+  if (this->NumberOfProcessingThreads <= 1)
+  {
+    return 0;
+  }
+  // Frames have to be processed in order by a single processor if the result depends on the previous frames
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->ProcessingAlgorithmAccessMutex);
+  if (this->ProcessorAlgorithm != NULL && !this->ProcessorAlgorithm->IsStateless())
+  {
+    return 0;
+  }
+  return this->NumberOfProcessingThreads;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusImageProcessorVideoSource::InternalDisconnect()
 {
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->ProcessingAlgorithmAccessMutex);
   this->EnableProcessing = false;
+  this->StopProcessingThreads();
   return PLUS_SUCCESS;
 }
 
@@ -219,7 +286,6 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalUpdate()
     this->GracePeriodLogLevel = vtkPlusLogger::LOG_LEVEL_WARNING;
   }
 
-  // Get image to tracker transform from the tracker (only request 1 frame, the latest)
   if (!this->InputChannels[0]->GetVideoDataAvailable())
   {
     LOG_DYNAMIC("Processed data is not generated, as no video data is available yet. Device ID: " << this->GetDeviceId(), this->GracePeriodLogLevel);
@@ -235,57 +301,231 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalUpdate()
       this->LastProcessedInputDataTimestamp = oldestTrackingTimestamp;
     }
   }
-  igsioTrackedFrame trackedFrame;
-  if (this->InputChannels[0]->GetTrackedFrame(trackedFrame) != PLUS_SUCCESS)
+
+  if (this->OutputChannels.empty())
   {
-    LOG_ERROR("Error while getting latest tracked frame. Last recorded timestamp: " << std::fixed << this->LastProcessedInputDataTimestamp << ". Device ID: " << this->GetDeviceId());
-    this->LastProcessedInputDataTimestamp = vtkIGSIOAccurateTimer::GetSystemTime(); // forget about the past, try to add frames that are acquired from now on
+    LOG_ERROR("No output channels defined");
     return PLUS_FAIL;
   }
 
-  LOG_TRACE("Image to be processed: timestamp=" << trackedFrame.GetTimestamp());
+  PlusStatus status = PLUS_SUCCESS;
+  int numberOfWorkerThreads = this->GetNumberOfWorkerThreadsToUse();
+  if (numberOfWorkerThreads == 0)
+  {
+    if (!this->ProcessingThreads.empty())
+    {
+      // Processor is not stateless anymore, frames that are being processed by the worker threads are discarded
+      this->StopProcessingThreads();
+      this->LastSubmittedInputUidValid = false;
+    }
 
-  if (this->OutputChannels.empty())
+    // Process frames in this thread
+    std::vector<double> inputFrameTimestamps;
+    if (this->GetInputFrameTimestampsToProcess(std::max(this->MaxNumberOfFramesToProcess, 1), inputFrameTimestamps) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    for (std::vector<double>::iterator timestampIt = inputFrameTimestamps.begin(); timestampIt != inputFrameTimestamps.end(); ++timestampIt)
+    {
+      igsioTrackedFrame trackedFrame;
+      if (this->InputChannels[0]->GetTrackedFrame(*timestampIt, trackedFrame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Error while getting tracked frame at timestamp " << std::fixed << *timestampIt << ". Device ID: " << this->GetDeviceId());
+        status = PLUS_FAIL;
+        continue;
+      }
+      LOG_TRACE("Image to be processed: timestamp=" << trackedFrame.GetTimestamp());
+
+      double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+      igsioTrackedFrame* processedTrackedFrame = ProcessFrame(this->ProcessorAlgorithm, trackedFrame);
+      if (processedTrackedFrame == NULL)
+      {
+        status = PLUS_FAIL;
+        continue;
+      }
+      if (this->AddProcessedFrame(processedTrackedFrame, vtkIGSIOAccurateTimer::GetSystemTime() - startTime) != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+    }
+    return status;
+  }
+
+  // Pipelined processing in worker threads
+  if (this->ProcessingThreads.empty() && this->StartProcessingThreads() != PLUS_SUCCESS)
   {
-    LOG_ERROR("No output channels defined");
     return PLUS_FAIL;
   }
-  vtkPlusChannel* outputChannel = this->OutputChannels[0];
-  double latestFrameAlreadyAddedTimestamp = 0;
-  outputChannel->GetMostRecentTimestamp(latestFrameAlreadyAddedTimestamp);
 
-  double frameTimestamp = trackedFrame.GetTimestamp();
-  if (latestFrameAlreadyAddedTimestamp >= frameTimestamp)
+  // Collect processed frames, in the order they were submitted
+  std::vector< std::shared_ptr<ProcessingJob> > finishedJobs;
+  int numberOfJobsInProgress = 0;
   {
-    // processed data has been already generated for this timestamp
-    return PLUS_SUCCESS;
+    std::lock_guard<std::mutex> lock(this->ProcessingJobsMutex);
+    while (!this->SubmittedProcessingJobs.empty() && this->SubmittedProcessingJobs.front()->Done)
+    {
+      finishedJobs.push_back(this->SubmittedProcessingJobs.front());
+      this->SubmittedProcessingJobs.pop_front();
+    }
+    for (std::deque< std::shared_ptr<ProcessingJob> >::iterator jobIt = this->SubmittedProcessingJobs.begin(); jobIt != this->SubmittedProcessingJobs.end(); ++jobIt)
+    {
+      if (!(*jobIt)->Done)
+      {
+        numberOfJobsInProgress++;
+      }
+    }
+  }
+  for (std::vector< std::shared_ptr<ProcessingJob> >::iterator jobIt = finishedJobs.begin(); jobIt != finishedJobs.end(); ++jobIt)
+  {
+    if ((*jobIt)->Status != PLUS_SUCCESS || this->AddProcessedFrame(&(*jobIt)->OutputFrame, (*jobIt)->ProcessingTimeSec) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
   }
 
-  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackingFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-  trackingFrames->AddTrackedFrame(&trackedFrame);
-  this->ProcessorAlgorithm->SetInputFrames(trackingFrames);
-  if (this->ProcessorAlgorithm->Update() != PLUS_SUCCESS)
+  // Submit new frames if there are idle worker threads
+  int numberOfIdleThreads = numberOfWorkerThreads - numberOfJobsInProgress;
+  if (numberOfIdleThreads <= 0)
+  {
+    return status;
+  }
+  std::vector<double> inputFrameTimestamps;
+  if (this->GetInputFrameTimestampsToProcess(numberOfIdleThreads, inputFrameTimestamps) != PLUS_SUCCESS)
   {
     return PLUS_FAIL;
   }
+  for (std::vector<double>::iterator timestampIt = inputFrameTimestamps.begin(); timestampIt != inputFrameTimestamps.end(); ++timestampIt)
+  {
+    std::shared_ptr<ProcessingJob> job = std::make_shared<ProcessingJob>();
+    if (this->InputChannels[0]->GetTrackedFrame(*timestampIt, job->InputFrame) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Error while getting tracked frame at timestamp " << std::fixed << *timestampIt << ". Device ID: " << this->GetDeviceId());
+      status = PLUS_FAIL;
+      continue;
+    }
+    LOG_TRACE("Image to be processed: timestamp=" << job->InputFrame.GetTimestamp());
+    {
+      std::lock_guard<std::mutex> lock(this->ProcessingJobsMutex);
+      this->PendingProcessingJobs.push_back(job);
+      this->SubmittedProcessingJobs.push_back(job);
+    }
+    this->ProcessingJobSubmitted.notify_one();
+  }
 
-  vtkPlusDataSource* aSource(NULL);
-  if (outputChannel->GetVideoSource(aSource) != PLUS_SUCCESS)
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::GetInputFrameTimestampsToProcess(unsigned int maxNumberOfFrames, std::vector<double>& timestamps)
+{
+  timestamps.clear();
+
+  vtkPlusDataSource* videoSource(NULL);
+  if (this->InputChannels[0]->GetVideoSource(videoSource) != PLUS_SUCCESS)
   {
-    LOG_ERROR("Unable to retrieve the video source in the image processor device.");
+    LOG_ERROR("Unable to retrieve the input video source in the image processor device.");
     return PLUS_FAIL;
   }
+  if (videoSource->GetNumberOfItems() == 0)
+  {
+    return PLUS_SUCCESS;
+  }
 
-  PlusStatus status = PLUS_SUCCESS;
+  // Most recent frame that all input data is available for
+  double mostRecentTimestamp(0);
+  if (this->InputChannels[0]->GetMostRecentTimestamp(mostRecentTimestamp) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Error while getting latest tracked frame. Last recorded timestamp: " << std::fixed << this->LastProcessedInputDataTimestamp << ". Device ID: " << this->GetDeviceId());
+    this->LastProcessedInputDataTimestamp = vtkIGSIOAccurateTimer::GetSystemTime(); // forget about the past, try to add frames that are acquired from now on
+    return PLUS_FAIL;
+  }
+  BufferItemUidType mostRecentUid(0);
+  if (videoSource->GetItemUidFromTime(mostRecentTimestamp, mostRecentUid) != ITEM_OK)
+  {
+    LOG_ERROR("Failed to get input video buffer item by timestamp " << std::fixed << mostRecentTimestamp << ". Device ID: " << this->GetDeviceId());
+    return PLUS_FAIL;
+  }
 
-  vtkIGSIOTrackedFrameList* processedFrames = this->ProcessorAlgorithm->GetOutputFrames();
+  BufferItemUidType firstUid = mostRecentUid;
+  if (this->LastSubmittedInputUidValid)
+  {
+    if (mostRecentUid <= this->LastSubmittedInputUid)
+    {
+      // no new frame
+      return PLUS_SUCCESS;
+    }
+    if (this->ProcessingPolicy == PROCESS_ALL_FRAMES)
+    {
+      firstUid = std::max(this->LastSubmittedInputUid + 1, videoSource->GetOldestItemUidInBuffer());
+    }
+    // All frames between the previously submitted frame and the first frame to process now are skipped
+    this->NumberOfSkippedFrames += static_cast<unsigned long>(firstUid - this->LastSubmittedInputUid - 1);
+  }
+  BufferItemUidType lastUid = mostRecentUid;
+  if (maxNumberOfFrames > 0 && lastUid - firstUid + 1 > maxNumberOfFrames)
+  {
+    // The remaining frames will be processed later
+    lastUid = firstUid + maxNumberOfFrames - 1;
+  }
+
+  for (BufferItemUidType uid = firstUid; uid <= lastUid; ++uid)
+  {
+    double timestamp(0);
+    if (videoSource->GetTimeStamp(uid, timestamp) != ITEM_OK)
+    {
+      // removed from the buffer since the most recent item was queried
+      this->NumberOfSkippedFrames++;
+      continue;
+    }
+    timestamps.push_back(timestamp);
+  }
+
+  this->LastSubmittedInputUid = lastUid;
+  this->LastSubmittedInputUidValid = true;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+igsioTrackedFrame* vtkPlusImageProcessorVideoSource::ProcessFrame(vtkPlusTrackedFrameProcessor* processor, igsioTrackedFrame& inputFrame)
+{
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackingFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  trackingFrames->AddTrackedFrame(&inputFrame);
+  processor->SetInputFrames(trackingFrames);
+  if (processor->Update() != PLUS_SUCCESS)
+  {
+    return NULL;
+  }
+
+  vtkIGSIOTrackedFrameList* processedFrames = processor->GetOutputFrames();
   if (processedFrames == NULL || processedFrames->GetNumberOfTrackedFrames() < 1)
   {
     LOG_ERROR("Failed to retrieve processed frame");
+    return NULL;
+  }
+  return processedFrames->GetTrackedFrame(0);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::AddProcessedFrame(igsioTrackedFrame* processedTrackedFrame, double processingTimeSec)
+{
+  vtkPlusChannel* outputChannel = this->OutputChannels[0];
+  double latestFrameAlreadyAddedTimestamp = 0;
+  outputChannel->GetMostRecentTimestamp(latestFrameAlreadyAddedTimestamp);
+
+  double frameTimestamp = processedTrackedFrame->GetTimestamp();
+  if (latestFrameAlreadyAddedTimestamp >= frameTimestamp)
+  {
+    // processed data has been already generated for this timestamp
+    return PLUS_SUCCESS;
+  }
+
+  vtkPlusDataSource* aSource(NULL);
+  if (outputChannel->GetVideoSource(aSource) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to retrieve the video source in the image processor device.");
     return PLUS_FAIL;
   }
 
-  igsioTrackedFrame* processedTrackedFrame = processedFrames->GetTrackedFrame(0);
   // Generate unique frame number (not used for filtering, so the actual increment value does not matter)
   this->FrameNumber++;
 
@@ -310,16 +550,107 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalUpdate()
     aSource->SetInputFrameSize(processedTrackedFrame->GetFrameSize());
   }
 
+  PlusStatus status = PLUS_SUCCESS;
   igsioFieldMapType customFields = processedTrackedFrame->GetCustomFields();
   if (aSource->AddItem(processedTrackedFrame->GetImageData(), this->FrameNumber, frameTimestamp, frameTimestamp, &customFields) != PLUS_SUCCESS)
   {
     status = PLUS_FAIL;
   }
 
+  this->NumberOfProcessedFrames++;
+  this->LastFrameProcessingTimeSec = processingTimeSec;
+  this->LastFrameLatencySec = vtkIGSIOAccurateTimer::GetSystemTime() - frameTimestamp;
+  this->MaximumFrameLatencySec = std::max(this->MaximumFrameLatencySec, this->LastFrameLatencySec);
+  LOG_TRACE("Processed image added: timestamp=" << frameTimestamp << ", processing time: " << processingTimeSec * 1000.0 << " ms, latency: " << this->LastFrameLatencySec * 1000.0 << " ms");
+
   this->Modified();
   return status;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::StartProcessingThreads()
+{
+  if (this->ProcessorAlgorithm == NULL)
+  {
+    LOG_ERROR("No processor is defined for ImageProcessor");
+    return PLUS_FAIL;
+  }
+
+  // Each worker thread uses its own processor, as processing modifies internal buffers of the processor
+  std::vector< vtkSmartPointer<vtkPlusTrackedFrameProcessor> > processors;
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->ProcessingAlgorithmAccessMutex);
+    for (int threadIndex = 0; threadIndex < this->NumberOfProcessingThreads; ++threadIndex)
+    {
+      vtkSmartPointer<vtkPlusTrackedFrameProcessor> processor = vtkSmartPointer<vtkPlusTrackedFrameProcessor>::Take(this->ProcessorAlgorithm->Clone());
+      if (processor == NULL)
+      {
+        LOG_ERROR("Failed to create processor for processing thread. Device ID: " << this->GetDeviceId());
+        return PLUS_FAIL;
+      }
+      processors.push_back(processor);
+    }
+  }
+
+  this->ProcessingThreadsStopRequested = false;
+  for (std::vector< vtkSmartPointer<vtkPlusTrackedFrameProcessor> >::iterator processorIt = processors.begin(); processorIt != processors.end(); ++processorIt)
+  {
+    this->ProcessingThreads.push_back(std::thread(&vtkPlusImageProcessorVideoSource::ProcessingThreadFunction, this, *processorIt));
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImageProcessorVideoSource::StopProcessingThreads()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->ProcessingJobsMutex);
+    this->ProcessingThreadsStopRequested = true;
+  }
+  this->ProcessingJobSubmitted.notify_all();
+  for (std::vector<std::thread>::iterator threadIt = this->ProcessingThreads.begin(); threadIt != this->ProcessingThreads.end(); ++threadIt)
+  {
+    threadIt->join();
+  }
+  this->ProcessingThreads.clear();
+
+  std::lock_guard<std::mutex> lock(this->ProcessingJobsMutex);
+  this->PendingProcessingJobs.clear();
+  this->SubmittedProcessingJobs.clear();
+  this->ProcessingThreadsStopRequested = false;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImageProcessorVideoSource::ProcessingThreadFunction(vtkSmartPointer<vtkPlusTrackedFrameProcessor> processor)
+{
+  while (true)
+  {
+    std::shared_ptr<ProcessingJob> job;
+    {
+      std::unique_lock<std::mutex> lock(this->ProcessingJobsMutex);
+      this->ProcessingJobSubmitted.wait(lock, [this]() { return this->ProcessingThreadsStopRequested || !this->PendingProcessingJobs.empty(); });
+      if (this->ProcessingThreadsStopRequested)
+      {
+        return;
+      }
+      job = this->PendingProcessingJobs.front();
+      this->PendingProcessingJobs.pop_front();
+    }
+
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    igsioTrackedFrame* processedTrackedFrame = ProcessFrame(processor, job->InputFrame);
+    if (processedTrackedFrame != NULL)
+    {
+      job->OutputFrame = *processedTrackedFrame;
+      job->Status = PLUS_SUCCESS;
+    }
+    job->ProcessingTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+    std::lock_guard<std::mutex> lock(this->ProcessingJobsMutex);
+    job->Done = true;
+  }
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusImageProcessorVideoSource::NotifyConfigured()
 {
@@ -353,6 +684,7 @@ void vtkPlusImageProcessorVideoSource::SetEnableProcessing(bool aValue)
   if (processingStartsNow)
   {
     this->LastProcessedInputDataTimestamp = 0.0;
+    this->LastSubmittedInputUidValid = false; // frames acquired while processing was paused are not counted as skipped
     this->RecordingStartTime = vtkIGSIOAccurateTimer::GetSystemTime(); // reset the starting time for the grace period
   }
 }
@@ -10,7 +10,16 @@ See License.txt for details.
 #include "vtkPlusDataCollectionExport.h"
 
 #include "vtkPlusDevice.h"
+
+#include <igsioTrackedFrame.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 //class vtkIGSIOTransformRepository;
 class vtkPlusTrackedFrameProcessor;
@@ -19,6 +28,13 @@ class vtkPlusTrackedFrameProcessor;
 \class vtkPlusImageProcessorVideoSource 
 \brief Virtual device that performs real-time image processing on the input channel
 
+By default the latest input frame is processed in the internal update thread. If processing takes longer than
+the frame period then frames are skipped. With NumberOfProcessingThreads larger than 1, frames are processed
+concurrently by worker threads (each using its own copy of the processor) and the results are added to the output
+in timestamp order. ProcessingPolicy specifies if only the latest frame (LATEST_FRAME) or every frame (ALL_FRAMES)
+is processed. Processors that are not stateless (e.g., that collect intermediate results) always process frames in the
+internal update thread, one at a time.
+
 \ingroup PlusLibDataCollection
 */
 class vtkPlusDataCollectionExport vtkPlusImageProcessorVideoSource : public vtkPlusDevice
@@ -42,6 +58,38 @@ public:
   vtkGetMacro(EnableProcessing, bool);
   void SetEnableProcessing(bool aValue);
 
+  enum ProcessingPolicyType
+  {
+    PROCESS_LATEST_FRAME, /*!< Only the most recent input frame is processed, frames acquired while processing are skipped */
+    PROCESS_ALL_FRAMES    /*!< Every input frame is processed, frames are only skipped if they are removed from the input buffer before processing */
+  };
+
+  vtkSetMacro(ProcessingPolicy, ProcessingPolicyType);
+  vtkGetMacro(ProcessingPolicy, ProcessingPolicyType);
+
+  /*! Number of frames that are processed concurrently by worker threads. If 1 then frames are processed in the internal update thread. */
+  vtkSetMacro(NumberOfProcessingThreads, int);
+  vtkGetMacro(NumberOfProcessingThreads, int);
+
+  /*!
+    Maximum number of frames that are processed in the internal update thread in one update, if frames are not processed
+    by worker threads. Limits the time spent in one update when ALL_FRAMES processing falls behind, the remaining frames
+    are processed in the next updates.
+  */
+  vtkSetMacro(MaxNumberOfFramesToProcess, int);
+  vtkGetMacro(MaxNumberOfFramesToProcess, int);
+
+  /*! Number of input frames that were not processed since connect */
+  vtkGetMacro(NumberOfSkippedFrames, unsigned long);
+  /*! Number of frames that were processed and added to the output since connect */
+  vtkGetMacro(NumberOfProcessedFrames, unsigned long);
+  /*! Processing time of the last processed frame, in seconds */
+  vtkGetMacro(LastFrameProcessingTimeSec, double);
+  /*! Time between acquisition of the last processed frame and adding the result to the output, in seconds */
+  vtkGetMacro(LastFrameLatencySec, double);
+  /*! Maximum time between acquisition of a frame and adding the result to the output since connect, in seconds */
+  vtkGetMacro(MaximumFrameLatencySec, double);
+
   virtual bool IsTracker() const { return false; }
   virtual bool IsVirtual() const { return true; }
 
@@ -52,6 +100,41 @@ protected:
   vtkPlusImageProcessorVideoSource();
   virtual ~vtkPlusImageProcessorVideoSource();
 
+  /*! A frame that is submitted for processing by a worker thread */
+  struct ProcessingJob
+  {
+    ProcessingJob() : Status(PLUS_FAIL), ProcessingTimeSec(0.0), Done(false) {}
+    igsioTrackedFrame InputFrame;
+    igsioTrackedFrame OutputFrame;
+    PlusStatus Status;
+    double ProcessingTimeSec;
+    bool Done;
+  };
+
+  /*! Timestamps of the input frames that should be processed now, according to the processing policy */
+  PlusStatus GetInputFrameTimestampsToProcess(unsigned int maxNumberOfFrames, std::vector<double>& timestamps);
+
+  /*!
+    Process a single frame with the specified processor. Returns NULL if processing failed.
+    The returned frame belongs to the processor and it is valid until the processor is updated again.
+  */
+  static igsioTrackedFrame* ProcessFrame(vtkPlusTrackedFrameProcessor* processor, igsioTrackedFrame& inputFrame);
+
+  /*! Number of worker threads that are used for processing (0 if frames are processed in the internal update thread) */
+  int GetNumberOfWorkerThreadsToUse();
+
+  /*! Add a processed frame to the output channel */
+  PlusStatus AddProcessedFrame(igsioTrackedFrame* processedTrackedFrame, double processingTimeSec);
+
+  /*! Start worker threads, each with a copy of the processor */
+  PlusStatus StartProcessingThreads();
+
+  /*! Stop worker threads and discard frames that are being processed */
+  void StopProcessingThreads();
+
+  /*! Worker thread function: process submitted frames until stopped */
+  void ProcessingThreadFunction(vtkSmartPointer<vtkPlusTrackedFrameProcessor> processor);
+
   double LastProcessedInputDataTimestamp;
 
   bool EnableProcessing;
@@ -69,6 +152,30 @@ protected:
 
   vtkPlusTrackedFrameProcessor* ProcessorAlgorithm;
 
+  ProcessingPolicyType ProcessingPolicy;
+  int NumberOfProcessingThreads;
+  int MaxNumberOfFramesToProcess;
+
+  /*! UID of the most recent input video buffer item that has been processed or submitted for processing */
+  BufferItemUidType LastSubmittedInputUid;
+  bool LastSubmittedInputUidValid;
+
+  unsigned long NumberOfSkippedFrames;
+  unsigned long NumberOfProcessedFrames;
+  double LastFrameProcessingTimeSec;
+  double LastFrameLatencySec;
+  double MaximumFrameLatencySec;
+
+  std::vector<std::thread> ProcessingThreads;
+  /*! Protects the job queues and the Done flag of the jobs */
+  std::mutex ProcessingJobsMutex;
+  std::condition_variable ProcessingJobSubmitted;
+  bool ProcessingThreadsStopRequested;
+  /*! Submitted jobs that are not yet taken by a worker thread */
+  std::deque< std::shared_ptr<ProcessingJob> > PendingProcessingJobs;
+  /*! All submitted jobs that are not yet added to the output, in timestamp order */
+  std::deque< std::shared_ptr<ProcessingJob> > SubmittedProcessingJobs;
+
 private:
   vtkPlusImageProcessorVideoSource(const vtkPlusImageProcessorVideoSource&);  // Not implemented.
   void operator=(const vtkPlusImageProcessorVideoSource&);  // Not implemented. 
@@ -646,19 +646,23 @@ PlusStatus vtkPlusMmfVideoSource::AddFrame(unsigned char* bufferData, DWORD buff
     return PLUS_FAIL;
   }
 
-  if (videoSource->GetImageType() == US_IMG_RGB_COLOR)
+  if (encoding == PixelCodec::PixelEncoding_MJPG)
   {
-    decodingStatus = PixelCodec::ConvertToBmp24(PixelCodec::ComponentOrder_RGB, encoding, frameSize[0], frameSize[1], bufferData, (unsigned char*)this->UncompressedVideoFrame.GetScalarPointer());
-  }
-  else
-  {
-    decodingStatus = PixelCodec::ConvertToGray(encoding, frameSize[0], frameSize[1], bufferData, (unsigned char*)this->UncompressedVideoFrame.GetScalarPointer());
-  }
+    // MJPG frames are decoded here, other encodings are converted by the buffer directly into the buffer item
+    if (videoSource->GetImageType() == US_IMG_RGB_COLOR)
+    {
+      decodingStatus = PixelCodec::ConvertToBmp24(PixelCodec::ComponentOrder_RGB, encoding, frameSize[0], frameSize[1], bufferData, (unsigned char*)this->UncompressedVideoFrame.GetScalarPointer());
+    }
+    else
+    {
+      decodingStatus = PixelCodec::ConvertToGray(encoding, frameSize[0], frameSize[1], bufferData, (unsigned char*)this->UncompressedVideoFrame.GetScalarPointer());
+    }
 
-  if (decodingStatus != PLUS_SUCCESS)
-  {
-    LOG_ERROR("Error while decoding the grabbed image");
-    return PLUS_FAIL;
+    if (decodingStatus != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Error while decoding the grabbed image");
+      return PLUS_FAIL;
+    }
   }
 
   this->FrameIndex++;
@@ -690,7 +694,16 @@ PlusStatus vtkPlusMmfVideoSource::AddFrame(unsigned char* bufferData, DWORD buff
       return PLUS_SUCCESS;
     }
   }
-  PlusStatus status = aSource->AddItem(&this->UncompressedVideoFrame, this->FrameIndex, currentTime);
+  PlusStatus status(PLUS_SUCCESS);
+  if (encoding == PixelCodec::PixelEncoding_MJPG)
+  {
+    status = aSource->AddItem(&this->UncompressedVideoFrame, this->FrameIndex, currentTime);
+  }
+  else
+  {
+    // Pixel conversion, clipping and reorientation in a single pass, only for frames that are actually recorded
+    status = aSource->AddItem(bufferData, encoding, videoSource->GetInputImageOrientation(), frameSize, videoSource->GetImageType(), this->FrameIndex, currentTime);
+  }
 
   this->Modified();
   return status;
@@ -7,7 +7,7 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "vtkImageData.h"
 #include "vtkMatrix4x4.h"
-#include "vtkIGSIOSequenceIO.h"
+#include "vtkPlusSequenceIO.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
@@ -382,7 +382,7 @@ PlusStatus vtkPlusSavedDataSource::InternalConnect()
   vtkSmartPointer<vtkIGSIOTrackedFrameList> savedDataBuffer = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
 
   // Read sequence file into tracked frame list
-  vtkIGSIOSequenceIO::Read(foundAbsoluteImagePath, savedDataBuffer);
+  vtkPlusSequenceIO::Read(foundAbsoluteImagePath, savedDataBuffer);
 
   if (savedDataBuffer->GetNumberOfTrackedFrames() < 1)
   {
@@ -138,6 +138,18 @@ int main(int argc, char** argv)
     vtksys::SystemTools::Delay(1000);
   }
 
+  // Dump the buffers while acquisition is running
+  if (dataCollector->StartDumpBuffersToDirectory("") != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to start buffer dump");
+    numberOfFailures++;
+  }
+  else if (dataCollector->WaitForBufferDump() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to dump buffers");
+    numberOfFailures++;
+  }
+
   vtkSmartPointer<vtkPlusBuffer> videobuffer = vtkSmartPointer<vtkPlusBuffer>::New();
   vtkPlusChannel* aChannel(NULL);
   vtkPlusDataSource* aSource(NULL);
@@ -0,0 +1,206 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusBufferEncodedFrameTest.cxx
+  \brief Verifies that adding an encoded (YUY2, RGB24, BGR24, RGBA32) frame to a buffer, which converts, clips and reorients
+  the pixels in a single pass, gives the same buffer frame as decoding the whole frame first and adding the decoded frame.
+  Volumes in AMF orientation are transposed to MFA, which exercises the row block conversion of the encoded insertion.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PixelCodec.h"
+#include "vtkPlusBuffer.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void FillRandom(std::vector<unsigned char>& pixels)
+  {
+    // Simple linear congruential generator to get the same image on all platforms
+    unsigned int state = 12345;
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+      state = state * 1103515245 + 12345;
+      pixels[i] = static_cast<unsigned char>(state >> 16);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkPlusBuffer> CreateBuffer(const FrameSizeType& frameSize, unsigned int numberOfScalarComponents, US_IMAGE_TYPE imageType, US_IMAGE_ORIENTATION bufferOrientation)
+  {
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(5);
+    buffer->SetImageOrientation(bufferOrientation);
+    buffer->SetImageType(imageType);
+    buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+    buffer->SetNumberOfScalarComponents(numberOfScalarComponents);
+    buffer->SetFrameSize(frameSize);
+    return buffer;
+  }
+
+  //----------------------------------------------------------------------------
+  // Returns the number of differences between the encoded and the decoded insertion
+  int TestEncodedFrame(PixelCodec::PixelEncoding encoding, int inputBytesPerPixel, unsigned int numberOfScalarComponents, US_IMAGE_ORIENTATION inputOrientation,
+                       US_IMAGE_ORIENTATION bufferOrientation, const FrameSizeType& inputFrameSize, const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize)
+  {
+    const US_IMAGE_TYPE imageType = (numberOfScalarComponents == 3 ? US_IMG_RGB_COLOR : US_IMG_BRIGHTNESS);
+    FrameSizeType outputFrameSize = inputFrameSize;
+    if (igsioCommon::IsClippingRequested(clipRectangleOrigin, clipRectangleSize))
+    {
+      outputFrameSize[0] = clipRectangleSize[0];
+      outputFrameSize[1] = clipRectangleSize[1];
+      outputFrameSize[2] = clipRectangleSize[2];
+    }
+    igsioVideoFrame::FlipInfoType flipInfo;
+    if (igsioVideoFrame::GetFlipAxes(inputOrientation, imageType, bufferOrientation, flipInfo) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get flip axes from " << igsioCommon::GetStringFromUsImageOrientation(inputOrientation)
+                << " to " << igsioCommon::GetStringFromUsImageOrientation(bufferOrientation));
+      return 1;
+    }
+    if (flipInfo.tranpose == igsioVideoFrame::TRANSPOSE_IJKtoKIJ)
+    {
+      outputFrameSize = { outputFrameSize[2], outputFrameSize[0], outputFrameSize[1] };
+    }
+
+    const int numberOfInputPixels = inputFrameSize[0] * inputFrameSize[1] * inputFrameSize[2];
+    std::vector<unsigned char> encodedPixels(numberOfInputPixels * inputBytesPerPixel);
+    FillRandom(encodedPixels);
+    std::vector<unsigned char> decodedPixels(numberOfInputPixels * numberOfScalarComponents);
+    if (numberOfScalarComponents == 3)
+    {
+      PixelCodec::ConvertToBmp24(PixelCodec::ComponentOrder_RGB, encoding, numberOfInputPixels, 1, &encodedPixels[0], &decodedPixels[0]);
+    }
+    else
+    {
+      PixelCodec::ConvertToGray(encoding, numberOfInputPixels, 1, &encodedPixels[0], &decodedPixels[0]);
+    }
+
+    vtkSmartPointer<vtkPlusBuffer> encodedBuffer = CreateBuffer(outputFrameSize, numberOfScalarComponents, imageType, bufferOrientation);
+    vtkSmartPointer<vtkPlusBuffer> decodedBuffer = CreateBuffer(outputFrameSize, numberOfScalarComponents, imageType, bufferOrientation);
+    // Add two frames to make sure the cached pixel mapping is reused
+    for (int frameNumber = 0; frameNumber < 2; frameNumber++)
+    {
+      const double timestamp = frameNumber + 1.0;
+      if (encodedBuffer->AddItem(&encodedPixels[0], encoding, inputOrientation, inputFrameSize, imageType, frameNumber,
+                                 clipRectangleOrigin, clipRectangleSize, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add " << PixelCodec::GetCompressionModeAsString(encoding) << " frame to the buffer");
+        return 1;
+      }
+      if (decodedBuffer->AddItem(&decodedPixels[0], inputOrientation, inputFrameSize, VTK_UNSIGNED_CHAR, numberOfScalarComponents, imageType, 0, frameNumber,
+                                 clipRectangleOrigin, clipRectangleSize, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add decoded frame to the buffer");
+        return 1;
+      }
+    }
+
+    StreamBufferItem encodedItem;
+    StreamBufferItem decodedItem;
+    if (encodedBuffer->GetLatestStreamBufferItem(&encodedItem) != ITEM_OK || decodedBuffer->GetLatestStreamBufferItem(&decodedItem) != ITEM_OK)
+    {
+      LOG_ERROR("Failed to get the latest buffer items");
+      return 1;
+    }
+    if (encodedItem.GetFrame().GetFrameSizeInBytes() != decodedItem.GetFrame().GetFrameSizeInBytes()
+        || memcmp(encodedItem.GetFrame().GetScalarPointer(), decodedItem.GetFrame().GetScalarPointer(), decodedItem.GetFrame().GetFrameSizeInBytes()) != 0)
+    {
+      LOG_ERROR("Buffer frame mismatch for " << PixelCodec::GetCompressionModeAsString(encoding) << " input, " << numberOfScalarComponents << " output components, "
+                << igsioCommon::GetStringFromUsImageOrientation(inputOrientation) << " input orientation, "
+                << igsioCommon::GetStringFromUsImageOrientation(bufferOrientation) << " buffer orientation, "
+                << inputFrameSize[0] << "x" << inputFrameSize[1] << "x" << inputFrameSize[2] << " input size, clip rectangle size "
+                << clipRectangleSize[0] << "x" << clipRectangleSize[1] << "x" << clipRectangleSize[2]);
+      return 1;
+    }
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  const PixelCodec::PixelEncoding encodings[] = { PixelCodec::PixelEncoding_YUY2, PixelCodec::PixelEncoding_RGB24, PixelCodec::PixelEncoding_BGR24, PixelCodec::PixelEncoding_RGBA32 };
+  const int inputBytesPerPixel[] = { 2, 3, 3, 4 };
+  const US_IMAGE_ORIENTATION orientations[] = { US_IMG_ORIENT_MF, US_IMG_ORIENT_MN, US_IMG_ORIENT_UF, US_IMG_ORIENT_UN };
+  const FrameSizeType frameSizes[] = { { 64, 48, 1 }, { 38, 21, 3 } };
+  const std::array<int, 3> noClipOrigin = { igsioCommon::NO_CLIP, igsioCommon::NO_CLIP, igsioCommon::NO_CLIP };
+  const std::array<int, 3> noClipSize = { igsioCommon::NO_CLIP, igsioCommon::NO_CLIP, igsioCommon::NO_CLIP };
+  // Odd clip origin to test YUY2 pixel pairs that are split by the clip rectangle
+  const std::array<int, 3> clipOrigin = { 3, 5, 0 };
+  const std::array<int, 3> clipSize = { 17, 11, 1 };
+  // Transposed volumes: AMF input (x: azimuth, y: marked side, z: far) is stored as MFA
+  const FrameSizeType volumeFrameSize = { 6, 20, 14 };
+  const std::array<int, 3> volumeClipOrigin = { 1, 3, 2 };
+  const std::array<int, 3> volumeClipSize = { 4, 11, 9 };
+  // Long output rows, so that the rows are converted in several blocks and the last block is partial
+  const FrameSizeType multiBlockVolumeFrameSize = { 40, 2, 9000 };
+
+  int numberOfFailures = 0;
+  for (int encodingIndex = 0; encodingIndex < 4; encodingIndex++)
+  {
+    for (unsigned int numberOfScalarComponents = 1; numberOfScalarComponents <= 3; numberOfScalarComponents += 2)
+    {
+      for (int orientationIndex = 0; orientationIndex < 4; orientationIndex++)
+      {
+        for (int frameSizeIndex = 0; frameSizeIndex < 2; frameSizeIndex++)
+        {
+          numberOfFailures += TestEncodedFrame(encodings[encodingIndex], inputBytesPerPixel[encodingIndex], numberOfScalarComponents, orientations[orientationIndex],
+                                               US_IMG_ORIENT_MF, frameSizes[frameSizeIndex], noClipOrigin, noClipSize);
+          numberOfFailures += TestEncodedFrame(encodings[encodingIndex], inputBytesPerPixel[encodingIndex], numberOfScalarComponents, orientations[orientationIndex],
+                                               US_IMG_ORIENT_MF, frameSizes[frameSizeIndex], clipOrigin, clipSize);
+        }
+      }
+      numberOfFailures += TestEncodedFrame(encodings[encodingIndex], inputBytesPerPixel[encodingIndex], numberOfScalarComponents, US_IMG_ORIENT_AMF,
+                                           US_IMG_ORIENT_MFA, volumeFrameSize, noClipOrigin, noClipSize);
+      numberOfFailures += TestEncodedFrame(encodings[encodingIndex], inputBytesPerPixel[encodingIndex], numberOfScalarComponents, US_IMG_ORIENT_AMF,
+                                           US_IMG_ORIENT_MFA, volumeFrameSize, volumeClipOrigin, volumeClipSize);
+      numberOfFailures += TestEncodedFrame(encodings[encodingIndex], inputBytesPerPixel[encodingIndex], numberOfScalarComponents, US_IMG_ORIENT_AMF,
+                                           US_IMG_ORIENT_MFA, multiBlockVolumeFrameSize, noClipOrigin, noClipSize);
+    }
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("vtkPlusBufferEncodedFrameTest failed: " << numberOfFailures << " mismatches");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkPlusBufferEncodedFrameTest completed successfully");
+  return EXIT_SUCCESS;
+}
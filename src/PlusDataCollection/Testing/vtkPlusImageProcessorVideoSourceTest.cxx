@@ -0,0 +1,256 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusImageProcessorVideoSourceTest.cxx
+  \brief Processes a replayed sequence with an ImageProcessor device that uses multiple processing threads and verifies
+  that processed frames are added in timestamp order, no frames are skipped, and each processed frame is the same as
+  the result of processing the input frame with a single processor.
+*/
+
+#include "PlusConfigure.h"
+#include "igsioTrackedFrame.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkIGSIOTrackedFrameList.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusImageProcessorVideoSource.h"
+#include "vtkPlusTransverseProcessEnhancer.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtkXMLDataElement.h>
+#include <vtkXMLUtilities.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  std::string GetDeviceSetConfiguration(const std::string& sequenceFile, int numberOfThreads)
+  {
+    std::ostringstream config;
+    config << "<PlusConfiguration version=\"2.1\">"
+           << "  <DataCollection StartupDelaySec=\"1.0\">"
+           << "    <DeviceSet Name=\"Image processor test\" Description=\"Replayed video processed by multiple threads\" />"
+           << "    <Device Id=\"VideoDevice\" Type=\"SavedDataSource\" SequenceFile=\"" << sequenceFile << "\" UseData=\"IMAGE\""
+           << "      UseOriginalTimestamps=\"FALSE\" RepeatEnabled=\"TRUE\" AcquisitionRate=\"10\">"
+           << "      <DataSources><DataSource Type=\"Video\" Id=\"Video\" PortUsImageOrientation=\"MF\" /></DataSources>"
+           << "      <OutputChannels><OutputChannel Id=\"VideoStream\" VideoDataSourceId=\"Video\" /></OutputChannels>"
+           << "    </Device>"
+           << "    <Device Id=\"ImageProcessorDevice\" Type=\"ImageProcessor\" ProcessingPolicy=\"ALL_FRAMES\" NumberOfProcessingThreads=\"" << numberOfThreads << "\">"
+           << "      <InputChannels><InputChannel Id=\"VideoStream\" /></InputChannels>"
+           << "      <DataSources><DataSource Type=\"Video\" Id=\"ProcessedVideo\" PortUsImageOrientation=\"MF\" /></DataSources>"
+           << "      <OutputChannels><OutputChannel Id=\"ProcessedVideoStream\" VideoDataSourceId=\"ProcessedVideo\" /></OutputChannels>"
+           << "    </Device>"
+           << "  </DataCollection>"
+           << "</PlusConfiguration>";
+    return config.str();
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Get the processor element from a processor test configuration file, in the form used in the ImageProcessor device */
+  vtkSmartPointer<vtkXMLDataElement> ReadProcessorElement(const std::string& processorConfigFileName)
+  {
+    vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, processorConfigFileName.c_str()) == PLUS_FAIL)
+    {
+      LOG_ERROR("Unable to read configuration from file " << processorConfigFileName);
+      return NULL;
+    }
+
+    // Parameters are either in a Processor element or directly in the root element
+    vtkXMLDataElement* sourceElement = configRootElement;
+    if (configRootElement->FindNestedElementWithName("ScanConversion") == NULL)
+    {
+      sourceElement = configRootElement->LookupElementWithName("Processor");
+      if (sourceElement == NULL || sourceElement->FindNestedElementWithName("ScanConversion") == NULL)
+      {
+        LOG_ERROR("Cannot find Processor element with ScanConversion in " << processorConfigFileName);
+        return NULL;
+      }
+    }
+
+    vtkSmartPointer<vtkXMLDataElement> processorElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    processorElement->DeepCopy(sourceElement);
+    processorElement->SetName("Processor");
+    processorElement->SetAttribute("Type", "vtkPlusTransverseProcessEnhancer");
+    return processorElement;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  std::string inputSequenceFile;
+  std::string processorConfigFile;
+  int numberOfThreads = 4;
+  double processingTimeSec = 3.0;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputSequenceFile, "Ultrasound sequence file that is replayed and processed.");
+  args.AddArgument("--processor-config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &processorConfigFile, "Configuration file of the transverse process enhancer.");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of processing threads (default: 4).");
+  args.AddArgument("--processing-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &processingTimeSec, "Duration of the processing (default: 3).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputSequenceFile.empty() || processorConfigFile.empty())
+  {
+    LOG_ERROR("--seq-file and --processor-config-file are required");
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> processorElement = ReadProcessorElement(processorConfigFile);
+  if (processorElement == NULL)
+  {
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(
+        vtkXMLUtilities::ReadElementFromString(GetDeviceSetConfiguration(inputSequenceFile, numberOfThreads).c_str()));
+  if (configRootElement == NULL)
+  {
+    LOG_ERROR("Unable to parse the device set configuration");
+    exit(EXIT_FAILURE);
+  }
+  vtkXMLDataElement* dataCollectionElement = configRootElement->FindNestedElementWithName("DataCollection");
+  vtkXMLDataElement* imageProcessorElement = (dataCollectionElement == NULL ? NULL
+      : dataCollectionElement->FindNestedElementWithNameAndAttribute("Device", "Id", "ImageProcessorDevice"));
+  if (imageProcessorElement == NULL)
+  {
+    LOG_ERROR("Unable to find the image processor device element");
+    exit(EXIT_FAILURE);
+  }
+  imageProcessorElement->AddNestedElement(processorElement);
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+  if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to read the device set configuration");
+    exit(EXIT_FAILURE);
+  }
+  if (dataCollector->Connect() != PLUS_SUCCESS || dataCollector->Start() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to start data collection");
+    exit(EXIT_FAILURE);
+  }
+
+  vtkIGSIOAccurateTimer::Delay(processingTimeSec);
+  dataCollector->Stop();
+
+  vtkPlusDevice* device = NULL;
+  vtkPlusChannel* inputChannel = NULL;
+  vtkPlusChannel* outputChannel = NULL;
+  vtkPlusDataSource* outputSource = NULL;
+  if (dataCollector->GetDevice(device, "ImageProcessorDevice") != PLUS_SUCCESS || dynamic_cast<vtkPlusImageProcessorVideoSource*>(device) == NULL
+      || dataCollector->GetChannel(inputChannel, "VideoStream") != PLUS_SUCCESS
+      || dataCollector->GetChannel(outputChannel, "ProcessedVideoStream") != PLUS_SUCCESS
+      || outputChannel->GetVideoSource(outputSource) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to locate the image processor device and its channels");
+    exit(EXIT_FAILURE);
+  }
+  vtkPlusImageProcessorVideoSource* imageProcessor = dynamic_cast<vtkPlusImageProcessorVideoSource*>(device);
+
+  int numberOfFailures = 0;
+  if (outputSource->GetNumberOfItems() < 2)
+  {
+    LOG_ERROR("Expected multiple processed frames, got " << outputSource->GetNumberOfItems());
+    numberOfFailures++;
+  }
+  if (imageProcessor->GetNumberOfSkippedFrames() != 0)
+  {
+    LOG_ERROR(imageProcessor->GetNumberOfSkippedFrames() << " frames were skipped in ALL_FRAMES processing");
+    numberOfFailures++;
+  }
+
+  // Processed frames are in input order and each of them is the same as the frame processed by a single processor
+  vtkSmartPointer<vtkPlusTransverseProcessEnhancer> referenceProcessor = vtkSmartPointer<vtkPlusTransverseProcessEnhancer>::New();
+  if (referenceProcessor->ReadConfiguration(processorElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to configure the reference processor");
+    exit(EXIT_FAILURE);
+  }
+  double previousTimestamp = 0;
+  for (BufferItemUidType uid = outputSource->GetOldestItemUidInBuffer(); uid <= outputSource->GetLatestItemUidInBuffer(); ++uid)
+  {
+    double timestamp = 0;
+    if (outputSource->GetTimeStamp(uid, timestamp) != ITEM_OK)
+    {
+      LOG_ERROR("Unable to get the timestamp of processed frame " << uid);
+      numberOfFailures++;
+      continue;
+    }
+    if (uid > outputSource->GetOldestItemUidInBuffer() && timestamp <= previousTimestamp)
+    {
+      LOG_ERROR("Processed frame " << uid << " (timestamp " << std::fixed << timestamp << ") was added after a frame with timestamp " << previousTimestamp);
+      numberOfFailures++;
+    }
+    previousTimestamp = timestamp;
+
+    igsioTrackedFrame inputFrame;
+    igsioTrackedFrame outputFrame;
+    if (inputChannel->GetTrackedFrame(timestamp, inputFrame) != PLUS_SUCCESS || outputChannel->GetTrackedFrame(timestamp, outputFrame) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to get input and processed frame at timestamp " << std::fixed << timestamp);
+      numberOfFailures++;
+      continue;
+    }
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> referenceInput = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    referenceInput->AddTrackedFrame(&inputFrame);
+    referenceProcessor->SetInputFrames(referenceInput);
+    if (referenceProcessor->Update() != PLUS_SUCCESS || referenceProcessor->GetOutputFrames()->GetNumberOfTrackedFrames() != 1)
+    {
+      LOG_ERROR("Reference processing failed at timestamp " << std::fixed << timestamp);
+      numberOfFailures++;
+      continue;
+    }
+    igsioVideoFrame* expectedImage = referenceProcessor->GetOutputFrames()->GetTrackedFrame(0)->GetImageData();
+    igsioVideoFrame* actualImage = outputFrame.GetImageData();
+    if (expectedImage->GetFrameSizeInBytes() != actualImage->GetFrameSizeInBytes()
+        || memcmp(expectedImage->GetScalarPointer(), actualImage->GetScalarPointer(), expectedImage->GetFrameSizeInBytes()) != 0)
+    {
+      LOG_ERROR("Processed frame at timestamp " << std::fixed << timestamp << " is different from the frame processed by a single processor");
+      numberOfFailures++;
+    }
+  }
+  LOG_INFO("Compared " << outputSource->GetNumberOfItems() << " frames processed by " << numberOfThreads << " threads");
+
+  dataCollector->Disconnect();
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("vtkPlusImageProcessorVideoSourceTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkPlusImageProcessorVideoSourceTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,292 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkVirtualCaptureDeduplicationTest.cxx
+  \brief Records a replayed sequence that contains repeated images with frame deduplication enabled, then reads the file back
+  and verifies that the frames stored as references get the pixels of the frame that they refer to.
+*/
+
+#include "PlusConfigure.h"
+#include "igsioTrackedFrame.h"
+#include "igsioVideoFrame.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkIGSIOSequenceIO.h"
+#include "vtkIGSIOTrackedFrameList.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusVirtualCapture.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtkXMLDataElement.h>
+#include <vtkXMLUtilities.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <sstream>
+
+namespace
+{
+  const unsigned int IMAGE_WIDTH = 64;
+  const unsigned int IMAGE_HEIGHT = 48;
+
+  //----------------------------------------------------------------------------
+  std::string GetDeviceSetConfiguration(const std::string& sequenceFile)
+  {
+    std::ostringstream config;
+    config << "<PlusConfiguration version=\"2.1\">"
+           << "  <DataCollection StartupDelaySec=\"1.0\">"
+           << "    <DeviceSet Name=\"Deduplicated recording test\" Description=\"Replayed video with repeated images recorded with deduplication\" />"
+           << "    <Device Id=\"VideoDevice\" Type=\"SavedDataSource\" SequenceFile=\"" << sequenceFile << "\" UseData=\"IMAGE\""
+           << "      UseOriginalTimestamps=\"FALSE\" RepeatEnabled=\"TRUE\" AcquisitionRate=\"30\">"
+           << "      <DataSources><DataSource Type=\"Video\" Id=\"Video\" PortUsImageOrientation=\"MF\" /></DataSources>"
+           << "      <OutputChannels><OutputChannel Id=\"VideoStream\" VideoDataSourceId=\"Video\" /></OutputChannels>"
+           << "    </Device>"
+           << "    <Device Id=\"CaptureDevice\" Type=\"VirtualCapture\" BaseFilename=\"DeduplicationTest.igs.nrrd\" EnableCapturingOnStart=\"FALSE\""
+           << "      EnableFileCompression=\"TRUE\" EnableFrameDeduplication=\"TRUE\" RequestedFrameRate=\"30\" AcquisitionRate=\"10\">"
+           << "      <InputChannels><InputChannel Id=\"VideoStream\" /></InputChannels>"
+           << "    </Device>"
+           << "  </DataCollection>"
+           << "</PlusConfiguration>";
+    return config.str();
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Pixels of the distinct images of the replayed sequence, each image is repeated in consecutive frames */
+  std::vector<unsigned char> GetDistinctImagePixels(unsigned int imageIndex)
+  {
+    std::vector<unsigned char> pixels(IMAGE_WIDTH * IMAGE_HEIGHT);
+    for (unsigned int pixelIndex = 0; pixelIndex < pixels.size(); ++pixelIndex)
+    {
+      pixels[pixelIndex] = static_cast<unsigned char>(1 + (pixelIndex * (imageIndex + 3) + imageIndex * 37) % 250);
+    }
+    return pixels;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus WriteInputSequence(const std::string& fileName, unsigned int numberOfDistinctImages, unsigned int repeatCount)
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> frameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    const FrameSizeType frameSize = { IMAGE_WIDTH, IMAGE_HEIGHT, 1 };
+    for (unsigned int frameIndex = 0; frameIndex < numberOfDistinctImages * repeatCount; ++frameIndex)
+    {
+      igsioTrackedFrame frame;
+      frame.SetTimestamp(frameIndex / 30.0);
+      igsioVideoFrame* image = frame.GetImageData();
+      if (image->AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, 1) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to allocate input frame " << frameIndex);
+        return PLUS_FAIL;
+      }
+      image->SetImageType(US_IMG_BRIGHTNESS);
+      image->SetImageOrientation(US_IMG_ORIENT_MF);
+      std::vector<unsigned char> pixels = GetDistinctImagePixels(frameIndex / repeatCount);
+      memcpy(image->GetScalarPointer(), &pixels[0], pixels.size());
+      frameList->AddTrackedFrame(&frame);
+    }
+    return vtkPlusSequenceIO::Write(fileName, frameList, US_IMG_ORIENT_MF, true);
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsImageEqual(igsioVideoFrame* image, const unsigned char* expectedPixels, unsigned int expectedSizeBytes)
+  {
+    return image->IsImageValid() && image->GetFrameSizeInBytes() == expectedSizeBytes
+           && memcmp(image->GetScalarPointer(), expectedPixels, expectedSizeBytes) == 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfDistinctImages = 3;
+  int repeatCount = 4;
+  double recordingTimeSec = 2.0;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--distinct-images", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfDistinctImages, "Number of different images in the replayed sequence (default: 3).");
+  args.AddArgument("--repeat-count", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &repeatCount, "Number of consecutive frames that have the same image in the replayed sequence (default: 4).");
+  args.AddArgument("--recording-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &recordingTimeSec, "Duration of the recording (default: 2).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfDistinctImages < 2 || repeatCount < 2)
+  {
+    LOG_ERROR("--distinct-images and --repeat-count must be at least 2");
+    exit(EXIT_FAILURE);
+  }
+
+  const std::string inputSequenceFile = vtkPlusConfig::GetInstance()->GetOutputPath("DeduplicationTestInput.igs.nrrd");
+  if (WriteInputSequence(inputSequenceFile, numberOfDistinctImages, repeatCount) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to write the replayed sequence: " << inputSequenceFile);
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(
+        vtkXMLUtilities::ReadElementFromString(GetDeviceSetConfiguration(inputSequenceFile).c_str()));
+  if (configRootElement == NULL)
+  {
+    LOG_ERROR("Unable to parse the device set configuration");
+    exit(EXIT_FAILURE);
+  }
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+  if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to read the device set configuration");
+    exit(EXIT_FAILURE);
+  }
+  if (dataCollector->Connect() != PLUS_SUCCESS || dataCollector->Start() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to start data collection");
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusDevice* device = NULL;
+  if (dataCollector->GetDevice(device, "CaptureDevice") != PLUS_SUCCESS || dynamic_cast<vtkPlusVirtualCapture*>(device) == NULL)
+  {
+    LOG_ERROR("Unable to locate the capture device");
+    exit(EXIT_FAILURE);
+  }
+  vtkPlusVirtualCapture* captureDevice = dynamic_cast<vtkPlusVirtualCapture*>(device);
+
+  if (captureDevice->OpenFile("DeduplicationTest.igs.nrrd") != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to open the recording");
+    exit(EXIT_FAILURE);
+  }
+  captureDevice->SetEnableCapturing(true);
+  vtkIGSIOAccurateTimer::Delay(recordingTimeSec);
+  captureDevice->SetEnableCapturing(false);
+  const long numberOfDeduplicatedFrames = captureDevice->GetNumberOfDeduplicatedFrames();
+  std::string recordingFilename;
+  if (captureDevice->CloseFile(NULL, &recordingFilename) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to finalize the recording");
+    exit(EXIT_FAILURE);
+  }
+  dataCollector->Stop();
+  dataCollector->Disconnect();
+  LOG_INFO("Recorded " << recordingFilename << " with " << numberOfDeduplicatedFrames << " deduplicated frames");
+
+  int numberOfFailures = 0;
+
+  // The file as stored: references with blanked images
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> storedFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  // The file as read by Plus: references are resolved
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> resolvedFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkIGSIOSequenceIO::Read(recordingFilename, storedFrames) != PLUS_SUCCESS
+      || vtkPlusSequenceIO::Read(recordingFilename, resolvedFrames) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to read the recording: " << recordingFilename);
+    exit(EXIT_FAILURE);
+  }
+  if (storedFrames->GetNumberOfTrackedFrames() != resolvedFrames->GetNumberOfTrackedFrames() || storedFrames->GetNumberOfTrackedFrames() == 0)
+  {
+    LOG_ERROR("The recording has " << storedFrames->GetNumberOfTrackedFrames() << " stored and " << resolvedFrames->GetNumberOfTrackedFrames() << " resolved frames");
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<std::vector<unsigned char> > distinctImages;
+  for (int imageIndex = 0; imageIndex < numberOfDistinctImages; ++imageIndex)
+  {
+    distinctImages.push_back(GetDistinctImagePixels(imageIndex));
+  }
+  const unsigned int imageSizeBytes = IMAGE_WIDTH * IMAGE_HEIGHT;
+  const std::vector<unsigned char> blankImage(imageSizeBytes, 0);
+
+  long numberOfReferences = 0;
+  for (unsigned int frameIndex = 0; frameIndex < resolvedFrames->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    igsioTrackedFrame* storedFrame = storedFrames->GetTrackedFrame(frameIndex);
+    igsioTrackedFrame* resolvedFrame = resolvedFrames->GetTrackedFrame(frameIndex);
+    igsioVideoFrame* resolvedImage = resolvedFrame->GetImageData();
+
+    // Every frame has the pixels of one of the replayed images
+    bool isReplayedImage = false;
+    for (std::vector<std::vector<unsigned char> >::const_iterator it = distinctImages.begin(); it != distinctImages.end() && !isReplayedImage; ++it)
+    {
+      isReplayedImage = IsImageEqual(resolvedImage, &(*it)[0], imageSizeBytes);
+    }
+    if (!isReplayedImage)
+    {
+      LOG_ERROR("Frame " << frameIndex << " of the recording does not have the pixels of any of the replayed images");
+      numberOfFailures++;
+    }
+    if (!resolvedFrame->GetFrameField(vtkPlusSequenceIO::REFERENCED_FRAME_OFFSET_FIELD_NAME).empty())
+    {
+      LOG_ERROR("Reference of frame " << frameIndex << " was not resolved when the recording was read");
+      numberOfFailures++;
+    }
+
+    std::string offsetStr = storedFrame->GetFrameField(vtkPlusSequenceIO::REFERENCED_FRAME_OFFSET_FIELD_NAME);
+    if (offsetStr.empty())
+    {
+      continue;
+    }
+    numberOfReferences++;
+    unsigned int offset = 0;
+    if (igsioCommon::StringToInt<unsigned int>(offsetStr.c_str(), offset) != PLUS_SUCCESS || offset == 0 || offset > frameIndex)
+    {
+      LOG_ERROR("Frame " << frameIndex << " has an invalid reference: " << offsetStr);
+      numberOfFailures++;
+      continue;
+    }
+
+    // The referenced frame holds the image, the reference itself is stored blanked
+    igsioTrackedFrame* storedReferencedFrame = storedFrames->GetTrackedFrame(frameIndex - offset);
+    if (!storedReferencedFrame->GetFrameField(vtkPlusSequenceIO::REFERENCED_FRAME_OFFSET_FIELD_NAME).empty())
+    {
+      LOG_ERROR("Frame " << frameIndex << " refers to frame " << frameIndex - offset << ", which is a reference itself");
+      numberOfFailures++;
+    }
+    if (!IsImageEqual(storedFrame->GetImageData(), &blankImage[0], imageSizeBytes))
+    {
+      LOG_ERROR("Image of deduplicated frame " << frameIndex << " is not blanked in the file");
+      numberOfFailures++;
+    }
+    if (!IsImageEqual(resolvedImage, static_cast<unsigned char*>(storedReferencedFrame->GetImageData()->GetScalarPointer()), imageSizeBytes))
+    {
+      LOG_ERROR("Pixels of deduplicated frame " << frameIndex << " are different from the pixels of the referenced frame " << frameIndex - offset);
+      numberOfFailures++;
+    }
+  }
+
+  if (numberOfReferences == 0 || numberOfReferences != numberOfDeduplicatedFrames)
+  {
+    LOG_ERROR("The recording has " << numberOfReferences << " frame references, " << numberOfDeduplicatedFrames << " frames were deduplicated while recording");
+    numberOfFailures++;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("vtkVirtualCaptureDeduplicationTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkVirtualCaptureDeduplicationTest completed successfully");
+  return EXIT_SUCCESS;
+}
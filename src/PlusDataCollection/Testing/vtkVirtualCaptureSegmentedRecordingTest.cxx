@@ -0,0 +1,252 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkVirtualCaptureSegmentedRecordingTest.cxx
+  \brief Records a replayed sequence with a segmented vtkPlusVirtualCapture and verifies that the recording is split into
+  complete segments, that the manifest lists them, and that reading the manifest gives the same frames as reading the segments one by one.
+*/
+
+#include "PlusConfigure.h"
+#include "igsioTrackedFrame.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkIGSIOTrackedFrameList.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusSequenceManifest.h"
+#include "vtkPlusVirtualCapture.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtkXMLDataElement.h>
+#include <vtkXMLUtilities.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <sstream>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  std::string GetDeviceSetConfiguration(const std::string& sequenceFile, int segmentMaxFrames)
+  {
+    std::ostringstream config;
+    config << "<PlusConfiguration version=\"2.1\">"
+           << "  <DataCollection StartupDelaySec=\"1.0\">"
+           << "    <DeviceSet Name=\"Segmented recording test\" Description=\"Replayed video recorded into segments\" />"
+           << "    <Device Id=\"VideoDevice\" Type=\"SavedDataSource\" SequenceFile=\"" << sequenceFile << "\" UseData=\"IMAGE\""
+           << "      UseOriginalTimestamps=\"FALSE\" RepeatEnabled=\"TRUE\" AcquisitionRate=\"30\">"
+           << "      <DataSources><DataSource Type=\"Video\" Id=\"Video\" PortUsImageOrientation=\"MF\" /></DataSources>"
+           << "      <OutputChannels><OutputChannel Id=\"VideoStream\" VideoDataSourceId=\"Video\" /></OutputChannels>"
+           << "    </Device>"
+           << "    <Device Id=\"CaptureDevice\" Type=\"VirtualCapture\" BaseFilename=\"SegmentedRecordingTest.igs.nrrd\" EnableCapturingOnStart=\"FALSE\""
+           << "      RequestedFrameRate=\"30\" AcquisitionRate=\"10\" SegmentMaxFrames=\"" << segmentMaxFrames << "\">"
+           << "      <InputChannels><InputChannel Id=\"VideoStream\" /></InputChannels>"
+           << "    </Device>"
+           << "  </DataCollection>"
+           << "</PlusConfiguration>";
+    return config.str();
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsFrameEqual(igsioTrackedFrame* frame1, igsioTrackedFrame* frame2)
+  {
+    if (frame1->GetTimestamp() != frame2->GetTimestamp())
+    {
+      return false;
+    }
+    igsioVideoFrame* image1 = frame1->GetImageData();
+    igsioVideoFrame* image2 = frame2->GetImageData();
+    if (image1->IsImageValid() != image2->IsImageValid())
+    {
+      return false;
+    }
+    if (!image1->IsImageValid())
+    {
+      return true;
+    }
+    return image1->GetFrameSizeInBytes() == image2->GetFrameSizeInBytes()
+           && memcmp(image1->GetScalarPointer(), image2->GetScalarPointer(), image1->GetFrameSizeInBytes()) == 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  std::string inputSequenceFile;
+  int segmentMaxFrames = 10;
+  double recordingTimeSec = 3.0;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputSequenceFile, "Video sequence file that is replayed and recorded.");
+  args.AddArgument("--segment-max-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &segmentMaxFrames, "Number of frames after which a new segment is started (default: 10).");
+  args.AddArgument("--recording-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &recordingTimeSec, "Duration of the recording (default: 3).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputSequenceFile.empty() || segmentMaxFrames < 1)
+  {
+    LOG_ERROR("--seq-file and a positive --segment-max-frames are required");
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(
+        vtkXMLUtilities::ReadElementFromString(GetDeviceSetConfiguration(inputSequenceFile, segmentMaxFrames).c_str()));
+  if (configRootElement == NULL)
+  {
+    LOG_ERROR("Unable to parse the device set configuration");
+    exit(EXIT_FAILURE);
+  }
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+  if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to read the device set configuration");
+    exit(EXIT_FAILURE);
+  }
+  if (dataCollector->Connect() != PLUS_SUCCESS || dataCollector->Start() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to start data collection");
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusDevice* device = NULL;
+  if (dataCollector->GetDevice(device, "CaptureDevice") != PLUS_SUCCESS || dynamic_cast<vtkPlusVirtualCapture*>(device) == NULL)
+  {
+    LOG_ERROR("Unable to locate the capture device");
+    exit(EXIT_FAILURE);
+  }
+  vtkPlusVirtualCapture* captureDevice = dynamic_cast<vtkPlusVirtualCapture*>(device);
+
+  // Record, the segments are rolled over while recording
+  if (captureDevice->OpenFile("SegmentedRecordingTest.igs.nrrd") != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to open the recording");
+    exit(EXIT_FAILURE);
+  }
+  captureDevice->SetEnableCapturing(true);
+  vtkIGSIOAccurateTimer::Delay(recordingTimeSec);
+  captureDevice->SetEnableCapturing(false);
+  const long numberOfRecordedFrames = captureDevice->GetTotalFramesRecorded();
+  std::string manifestFilename;
+  if (captureDevice->CloseFile(NULL, &manifestFilename) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to finalize the recording");
+    exit(EXIT_FAILURE);
+  }
+  dataCollector->Stop();
+  dataCollector->Disconnect();
+  LOG_INFO("Recorded " << numberOfRecordedFrames << " frames into " << manifestFilename);
+
+  int numberOfFailures = 0;
+
+  // Manifest: all segments are complete, all but the last one are full
+  vtkSmartPointer<vtkPlusSequenceManifest> manifest = vtkSmartPointer<vtkPlusSequenceManifest>::New();
+  if (!vtkPlusSequenceManifest::CanReadFile(manifestFilename) || manifest->ReadFile(manifestFilename) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to read the manifest of the recording: " << manifestFilename);
+    exit(EXIT_FAILURE);
+  }
+  if (manifest->GetNumberOfSegments() < 2)
+  {
+    LOG_ERROR("Expected the recording to be split into multiple segments, got " << manifest->GetNumberOfSegments() << " segment(s) with " << numberOfRecordedFrames << " frames");
+    numberOfFailures++;
+  }
+  long numberOfFramesInSegments = 0;
+  for (int segmentIndex = 0; segmentIndex < manifest->GetNumberOfSegments(); segmentIndex++)
+  {
+    const vtkPlusSequenceManifest::Segment& segment = manifest->GetSegment(segmentIndex);
+    numberOfFramesInSegments += segment.NumberOfFrames;
+    if (!segment.Complete)
+    {
+      LOG_ERROR("Segment " << segment.FileName << " is not complete");
+      numberOfFailures++;
+    }
+    if (segmentIndex + 1 < manifest->GetNumberOfSegments() && segment.NumberOfFrames < segmentMaxFrames)
+    {
+      LOG_ERROR("Segment " << segment.FileName << " was closed with " << segment.NumberOfFrames << " frames, before reaching the limit of " << segmentMaxFrames << " frames");
+      numberOfFailures++;
+    }
+    if (segmentIndex > 0 && segment.FirstTimestamp <= manifest->GetSegment(segmentIndex - 1).LastTimestamp)
+    {
+      LOG_ERROR("Segment " << segment.FileName << " does not start after the previous segment");
+      numberOfFailures++;
+    }
+  }
+  if (numberOfFramesInSegments != numberOfRecordedFrames)
+  {
+    LOG_ERROR("Number of frames in the manifest (" << numberOfFramesInSegments << ") is different from the number of recorded frames (" << numberOfRecordedFrames << ")");
+    numberOfFailures++;
+  }
+
+  // Reading the manifest gives the frames of the segments, in recording order
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> recording = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkPlusSequenceIO::Read(manifestFilename, recording) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to read the recording as one sequence: " << manifestFilename);
+    exit(EXIT_FAILURE);
+  }
+  std::vector<std::string> segmentPaths;
+  if (vtkPlusSequenceManifest::GetReadableSegments(manifestFilename, segmentPaths) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to get the segments of the recording");
+    exit(EXIT_FAILURE);
+  }
+  unsigned int frameIndex = 0;
+  for (std::vector<std::string>::const_iterator segmentPathIt = segmentPaths.begin(); segmentPathIt != segmentPaths.end(); ++segmentPathIt)
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> segmentFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (vtkPlusSequenceIO::Read(*segmentPathIt, segmentFrames) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to read segment " << *segmentPathIt);
+      numberOfFailures++;
+      continue;
+    }
+    for (unsigned int segmentFrameIndex = 0; segmentFrameIndex < segmentFrames->GetNumberOfTrackedFrames(); segmentFrameIndex++, frameIndex++)
+    {
+      if (frameIndex >= recording->GetNumberOfTrackedFrames()
+          || !IsFrameEqual(recording->GetTrackedFrame(frameIndex), segmentFrames->GetTrackedFrame(segmentFrameIndex)))
+      {
+        LOG_ERROR("Frame " << segmentFrameIndex << " of segment " << *segmentPathIt << " is different from frame " << frameIndex << " of the recording");
+        numberOfFailures++;
+        break;
+      }
+    }
+  }
+  if (frameIndex != recording->GetNumberOfTrackedFrames() || static_cast<long>(recording->GetNumberOfTrackedFrames()) != numberOfRecordedFrames)
+  {
+    LOG_ERROR("The recording has " << recording->GetNumberOfTrackedFrames() << " frames, the segments have " << frameIndex << " frames, " << numberOfRecordedFrames << " frames were recorded");
+    numberOfFailures++;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("vtkVirtualCaptureSegmentedRecordingTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkVirtualCaptureSegmentedRecordingTest completed successfully");
+  return EXIT_SUCCESS;
+}
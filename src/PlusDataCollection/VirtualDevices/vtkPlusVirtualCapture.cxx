@@ -7,14 +7,20 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "igsioTrackedFrame.h"
 #include "vtkIGSIOMetaImageSequenceIO.h"
+#include "vtkImageData.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
 #include "vtkIGSIOSequenceIO.h"
 #include "vtkIGSIOTrackedFrameList.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusSequenceManifest.h"
+#include "vtkPlusTrackingSequenceIO.h"
 #include "vtkPlusVirtualCapture.h"
 #include "vtksys/SystemTools.hxx"
 
+#include <iomanip>
+
 #ifdef PLUS_USE_VTKVIDEOIO_MKV
 //  #include "vtkPlusMkvSequenceIO.h"
 #endif
@@ -30,6 +36,52 @@ namespace
   static const double WARNING_RECORDING_LAG_SEC = 1.0; // if the recording lags more than this then a warning message will be displayed
   static const double MAX_ALLOWED_RECORDING_LAG_SEC = 3.0; // if the recording lags more than this then it'll skip frames to catch up
   static const unsigned int DISABLE_FRAME_BUFFER = std::numeric_limits<unsigned int>::max();
+
+  //----------------------------------------------------------------------------
+  /*! Split sequence file name into root and extension. Handles the Plus-specific tracking sequence extension, too. */
+  void SplitSequenceFilename(const std::string& filename, std::string& filenameRoot, std::string& extension)
+  {
+    if (vtkPlusTrackingSequenceIO::CanWriteFile(filename))
+    {
+      extension = vtkPlusTrackingSequenceIO::GetFileExtension();
+      filenameRoot = filename.substr(0, filename.size() - extension.size());
+      return;
+    }
+    filenameRoot = igsioCommon::GetSequenceFilenameWithoutExtension(filename);
+    extension = igsioCommon::GetSequenceFilenameExtension(filename);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Get all files that belong to a sequence file (MetaImage headers may store pixel data in a separate file) */
+  std::vector<std::string> GetSequenceDataFiles(const std::string& filePath)
+  {
+    std::vector<std::string> files(1, filePath);
+    if (vtksys::SystemTools::LowerCase(vtksys::SystemTools::GetFilenameLastExtension(filePath)) == ".mhd")
+    {
+      std::string root = vtksys::SystemTools::GetFilenamePath(filePath) + "/" + vtksys::SystemTools::GetFilenameWithoutLastExtension(filePath);
+      const char* dataFileExtensions[] = { ".raw", ".zraw" };
+      for (int i = 0; i < 2; ++i)
+      {
+        if (vtksys::SystemTools::FileExists(root + dataFileExtensions[i], true))
+        {
+          files.push_back(root + dataFileExtensions[i]);
+        }
+      }
+    }
+    return files;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Returns true if the two images have the same format and pixel data */
+  bool IsImageDataEqual(igsioVideoFrame& image1, igsioVideoFrame& image2)
+  {
+    return image1.IsImageValid() && image2.IsImageValid()
+           && image1.GetFrameSize() == image2.GetFrameSize()
+           && image1.GetVTKScalarPixelType() == image2.GetVTKScalarPixelType()
+           && image1.GetNumberOfScalarComponents() == image2.GetNumberOfScalarComponents()
+           && image1.GetFrameSizeInBytes() == image2.GetFrameSizeInBytes()
+           && memcmp(image1.GetImage()->GetScalarPointer(), image2.GetImage()->GetScalarPointer(), image1.GetFrameSizeInBytes()) == 0;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -56,6 +108,19 @@ vtkPlusVirtualCapture::vtkPlusVirtualCapture()
   , WriterAccessMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
   , GracePeriodLogLevel(vtkPlusLogger::LOG_LEVEL_DEBUG)
   , EncodingFourCC("VP90")
+  , SegmentMaxFrames(0)
+  , SegmentMaxDurationSec(0.0)
+  , SegmentMaxSizeMB(0.0)
+  , Manifest(vtkSmartPointer<vtkPlusSequenceManifest>::New())
+  , IsManifestSaved(false)
+  , SegmentIndex(0)
+  , SegmentFramesRecorded(0)
+  , SegmentFirstTimestamp(UNDEFINED_TIMESTAMP)
+  , SegmentLastTimestamp(UNDEFINED_TIMESTAMP)
+  , SegmentSizeBytes(0.0)
+  , EnableFrameDeduplication(false)
+  , NumberOfDeduplicatedFrames(0)
+  , FramesSinceLastPayload(0)
 {
   this->AcquisitionRate = 30.0;
   this->MissingInputGracePeriodSec = 2.0;
@@ -68,10 +133,11 @@ vtkPlusVirtualCapture::vtkPlusVirtualCapture()
 //----------------------------------------------------------------------------
 vtkPlusVirtualCapture::~vtkPlusVirtualCapture()
 {
-  if (IsHeaderPrepared)
+  if (this->HasUnsavedData())
   {
     this->CloseFile();
   }
+  this->WaitForSegmentSync();
 
   if (RecordedFrames != NULL)
   {
@@ -109,6 +175,10 @@ PlusStatus vtkPlusVirtualCapture::ReadConfiguration(vtkXMLDataElement* rootConfi
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, RequestedFrameRate, deviceConfig);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, FrameBufferSize, deviceConfig);
   XML_READ_STRING_ATTRIBUTE_OPTIONAL(EncodingFourCC, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, SegmentMaxFrames, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, SegmentMaxDurationSec, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, SegmentMaxSizeMB, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableFrameDeduplication, deviceConfig);
 
   return PLUS_SUCCESS;
 }
@@ -121,6 +191,16 @@ PlusStatus vtkPlusVirtualCapture::WriteConfiguration(vtkXMLDataElement* rootConf
   deviceElement->SetAttribute("EnableFileCompression", this->EnableFileCompression ? "TRUE" : "FALSE");
   deviceElement->SetAttribute("EnableCaptureOnStart", this->EnableCapturingOnStart ? "TRUE" : "FALSE");
   deviceElement->SetDoubleAttribute("RequestedFrameRate", this->GetRequestedFrameRate());
+  if (this->IsSegmented())
+  {
+    deviceElement->SetIntAttribute("SegmentMaxFrames", this->SegmentMaxFrames);
+    deviceElement->SetDoubleAttribute("SegmentMaxDurationSec", this->SegmentMaxDurationSec);
+    deviceElement->SetDoubleAttribute("SegmentMaxSizeMB", this->SegmentMaxSizeMB);
+  }
+  if (this->EnableFrameDeduplication)
+  {
+    deviceElement->SetAttribute("EnableFrameDeduplication", "TRUE");
+  }
 
   return PLUS_SUCCESS;
 }
@@ -150,7 +230,8 @@ PlusStatus vtkPlusVirtualCapture::InternalDisconnect()
   this->EnableCapturing = false;
 
   // If outstanding frames to be written, deal with them
-  if (this->RecordedFrames->GetNumberOfTrackedFrames() != 0 && this->IsHeaderPrepared)
+  // (tracking-only files are written by CloseFile)
+  if (this->RecordedFrames->GetNumberOfTrackedFrames() != 0 && this->IsHeaderPrepared && this->TrackingWriter == NULL)
   {
     if (this->Writer->AppendImagesToHeader() != PLUS_SUCCESS)
     {
@@ -178,8 +259,9 @@ PlusStatus vtkPlusVirtualCapture::OpenFile(const char* aFilename)
 
   if (aFilename == NULL || strlen(aFilename) == 0)
   {
-    std::string filenameRoot = igsioCommon::GetSequenceFilenameWithoutExtension(this->BaseFilename);
-    std::string ext = igsioCommon::GetSequenceFilenameExtension(this->BaseFilename);
+    std::string filenameRoot;
+    std::string ext;
+    SplitSequenceFilename(this->BaseFilename, filenameRoot, ext);
     if (ext.empty())
     {
       // default to nrrd
@@ -205,16 +287,59 @@ PlusStatus vtkPlusVirtualCapture::OpenFile(const char* aFilename)
     this->CurrentFilename = aFilename;
   }
 
-  this->Writer = vtkIGSIOSequenceIO::CreateSequenceHandlerForFile(aFilename);
+  if (this->EnableFrameDeduplication && !this->EnableFileCompression && !vtkPlusTrackingSequenceIO::CanWriteFile(this->CurrentFilename))
+  {
+    // Blanked images take as much space as the original ones in uncompressed files
+    LOG_WARNING("Frame deduplication is enabled but file compression is disabled, frames are recorded without deduplication to " << this->CurrentFilename);
+  }
+
+  if (this->IsSegmented())
+  {
+    // Segments and the manifest are all named after the requested file
+    SplitSequenceFilename(vtkPlusConfig::GetInstance()->GetOutputPath(this->CurrentFilename), this->SegmentFilenameRoot, this->SegmentFilenameExtension);
+    this->ManifestFilename = this->SegmentFilenameRoot + vtkPlusSequenceManifest::GetFileExtension();
+    this->Manifest->Clear();
+    this->IsManifestSaved = false;
+    this->SegmentIndex = 0;
+    this->ResetSegmentStatistics();
+    return this->OpenWriter(this->GetSegmentFilename(this->SegmentIndex));
+  }
+
+  return this->OpenWriter(vtkPlusConfig::GetInstance()->GetOutputPath(aFilename));
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::OpenWriter(const std::string& filePath)
+{
+  if (this->Writer != NULL)
+  {
+    this->Writer->Delete();
+    this->Writer = NULL;
+  }
+
+  // Frame references are resolved within a file, the first frame of each file must hold its image
+  this->LastPayloadFrameHash.clear();
+  this->FramesSinceLastPayload = 0;
+
+  if (vtkPlusTrackingSequenceIO::CanWriteFile(filePath))
+  {
+    this->TrackingWriter = vtkSmartPointer<vtkPlusTrackingSequenceIO>::New();
+    this->TrackingWriter->SetUseCompression(this->EnableFileCompression);
+    this->TrackingWriter->SetFileName(filePath);
+    return PLUS_SUCCESS;
+  }
+  this->TrackingWriter = NULL;
+
+  this->Writer = vtkIGSIOSequenceIO::CreateSequenceHandlerForFile(filePath);
   if (!this->Writer)
   {
-    LOG_ERROR("Could not create writer for file: " << aFilename);
+    LOG_ERROR("Could not create writer for file: " << filePath);
     return PLUS_FAIL;
   }
   this->Writer->SetUseCompression(this->EnableFileCompression);
   this->Writer->SetTrackedFrameList(this->RecordedFrames);
   // Need to set the filename before finalizing header, because the pixel data file name depends on the file extension
-  this->Writer->SetFileName(vtkPlusConfig::GetInstance()->GetOutputPath(aFilename));
+  this->Writer->SetFileName(filePath);
 
   return PLUS_SUCCESS;
 }
@@ -225,12 +350,22 @@ PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */,
   // Fix the header to write the correct number of frames
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->WriterAccessMutex);
 
+  if (this->IsSegmented())
+  {
+    return this->CloseSegmentedFile(aFilename, resultFilename);
+  }
+
   if (!this->IsHeaderPrepared)
   {
     // nothing has been prepared, so nothing to finalize
     return PLUS_SUCCESS;
   }
 
+  if (this->TrackingWriter != NULL)
+  {
+    return this->CloseTrackingFile(aFilename, resultFilename);
+  }
+
   if (aFilename != NULL && strlen(aFilename) != 0)
   {
     // Need to set the filename before finalizing header, because the pixel data file name depends on the file extension
@@ -264,6 +399,65 @@ PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */,
 
   this->IsHeaderPrepared = false;
   this->TotalFramesRecorded = 0;
+  this->NumberOfDeduplicatedFrames = 0;
+  this->RecordedFrames->Clear();
+
+  if (this->OpenFile() != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::CloseTrackingFile(const char* aFilename, std::string* resultFilename)
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->WriterAccessMutex);
+
+  PlusStatus status = PLUS_SUCCESS;
+  if (this->RecordedFrames->GetNumberOfTrackedFrames() != 0)
+  {
+    status = this->WriteFrames(true);
+  }
+  if (this->TrackingWriter->Close() != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+
+  // Frames are appended while recording, so a different final name can only be applied by renaming the file
+  std::string writtenFilePath = this->TrackingWriter->GetFileName();
+  if (aFilename != NULL && strlen(aFilename) != 0)
+  {
+    std::string requestedFilePath = vtkPlusConfig::GetInstance()->GetOutputPath(aFilename);
+    if (requestedFilePath != writtenFilePath)
+    {
+      if (vtksys::SystemTools::RenameFile(writtenFilePath.c_str(), requestedFilePath.c_str()))
+      {
+        writtenFilePath = requestedFilePath;
+        this->CurrentFilename = aFilename;
+      }
+      else
+      {
+        LOG_ERROR("Unable to rename recorded file " << writtenFilePath << " to " << requestedFilePath);
+        status = PLUS_FAIL;
+      }
+    }
+  }
+
+  if (resultFilename != NULL)
+  {
+    (*resultFilename) = writtenFilePath;
+  }
+
+  std::string path = vtksys::SystemTools::GetFilenamePath(writtenFilePath);
+  std::string filename = igsioCommon::GetSequenceFilenameWithoutExtension(vtksys::SystemTools::GetFilenameName(writtenFilePath));
+  std::string configFileName = path + "/" + filename + "_config.xml";
+  igsioCommon::XML::PrintXML(configFileName.c_str(), vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationData());
+
+  this->IsHeaderPrepared = false;
+  this->TotalFramesRecorded = 0;
+  this->NumberOfDeduplicatedFrames = 0;
   this->RecordedFrames->Clear();
 
   if (this->OpenFile() != PLUS_SUCCESS)
@@ -271,9 +465,285 @@ PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */,
     return PLUS_FAIL;
   }
 
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualCapture::DeduplicateFrames(int firstNewFrameIndex)
+{
+  for (unsigned int frameIndex = firstNewFrameIndex; frameIndex < this->RecordedFrames->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    igsioTrackedFrame* frame = this->RecordedFrames->GetTrackedFrame(frameIndex);
+    igsioVideoFrame* image = frame->GetImageData();
+    if (!image->IsImageValid())
+    {
+      this->LastPayloadFrameHash.clear();
+      continue;
+    }
+
+    std::string frameHash = frame->GetFrameField(vtkPlusSequenceIO::FRAME_HASH_FIELD_NAME);
+    if (frameHash.empty())
+    {
+      frameHash = PlusCommon::GetFrameHashString(*image);
+    }
+
+    // The hash only rules out changed frames quickly, a frame is blanked only if its pixel data is identical
+    if (this->LastPayloadFrameHash.empty() || frameHash != this->LastPayloadFrameHash || !IsImageDataEqual(*image, this->LastPayloadFrame))
+    {
+      // New content, this frame is written with its image
+      this->LastPayloadFrameHash = frameHash;
+      this->LastPayloadFrame = *image;
+      this->FramesSinceLastPayload = 0;
+      continue;
+    }
+
+    ++this->FramesSinceLastPayload;
+    memset(image->GetImage()->GetScalarPointer(), 0, image->GetFrameSizeInBytes());
+    frame->SetFrameField(vtkPlusSequenceIO::REFERENCED_FRAME_OFFSET_FIELD_NAME, igsioCommon::ToString<unsigned int>(this->FramesSinceLastPayload));
+    ++this->NumberOfDeduplicatedFrames;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusVirtualCapture::IsSegmented() const
+{
+  return this->SegmentMaxFrames > 0 || this->SegmentMaxDurationSec > 0 || this->SegmentMaxSizeMB > 0;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusVirtualCapture::GetSegmentFilename(int segmentIndex) const
+{
+  std::ostringstream segmentFilename;
+  segmentFilename << this->SegmentFilenameRoot << "_" << std::setfill('0') << std::setw(4) << segmentIndex << this->SegmentFilenameExtension;
+  return segmentFilename.str();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualCapture::ResetSegmentStatistics()
+{
+  this->SegmentFramesRecorded = 0;
+  this->SegmentFirstTimestamp = UNDEFINED_TIMESTAMP;
+  this->SegmentLastTimestamp = UNDEFINED_TIMESTAMP;
+  this->SegmentSizeBytes = 0.0;
+
+  // List the segment as soon as it is started, so that after a crash it is known that the segment exists
+  vtkPlusSequenceManifest::Segment segment;
+  segment.FileName = vtksys::SystemTools::GetFilenameName(this->GetSegmentFilename(this->SegmentIndex));
+  this->Manifest->SetSegment(segment);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualCapture::AccumulateSegmentStatistics(int firstNewFrameIndex)
+{
+  for (unsigned int frameIndex = firstNewFrameIndex; frameIndex < this->RecordedFrames->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    igsioTrackedFrame* frame = this->RecordedFrames->GetTrackedFrame(frameIndex);
+    if (this->SegmentFramesRecorded == 0)
+    {
+      this->SegmentFirstTimestamp = frame->GetTimestamp();
+    }
+    this->SegmentLastTimestamp = frame->GetTimestamp();
+    if (frame->GetImageData()->IsImageValid())
+    {
+      vtkImageData* image = frame->GetImageData()->GetImage();
+      this->SegmentSizeBytes += static_cast<double>(image->GetScalarSize()) * image->GetNumberOfScalarComponents() * image->GetNumberOfPoints();
+    }
+    ++this->SegmentFramesRecorded;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusVirtualCapture::IsSegmentFull() const
+{
+  if (this->SegmentFramesRecorded == 0)
+  {
+    return false;
+  }
+  if (this->SegmentMaxFrames > 0 && this->SegmentFramesRecorded >= static_cast<long int>(this->SegmentMaxFrames))
+  {
+    return true;
+  }
+  if (this->SegmentMaxDurationSec > 0 && this->SegmentLastTimestamp - this->SegmentFirstTimestamp >= this->SegmentMaxDurationSec)
+  {
+    return true;
+  }
+  // Image writers do not report the written size, so it is estimated from the uncompressed image size
+  double segmentSizeBytes = (this->TrackingWriter != NULL ? static_cast<double>(this->TrackingWriter->GetNumberOfBytesWritten()) : this->SegmentSizeBytes);
+  if (this->SegmentMaxSizeMB > 0 && segmentSizeBytes >= this->SegmentMaxSizeMB * 1024.0 * 1024.0)
+  {
+    return true;
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::FinalizeSegment()
+{
+  PlusStatus status = PLUS_SUCCESS;
+  if (this->RecordedFrames->GetNumberOfTrackedFrames() != 0)
+  {
+    status = this->WriteFrames(true);
+  }
+
+  if (this->TrackingWriter != NULL)
+  {
+    if (this->TrackingWriter->Close() != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+  else
+  {
+    this->Writer->UpdateDimensionsCustomStrings(this->SegmentFramesRecorded, this->GetIsData3D());
+    this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionSizeString());
+    this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionKindsString());
+    this->Writer->FinalizeHeader();
+    this->Writer->Close();
+  }
+  this->IsHeaderPrepared = false;
+
+  vtkPlusSequenceManifest::Segment segment;
+  segment.FileName = vtksys::SystemTools::GetFilenameName(this->GetSegmentFilename(this->SegmentIndex));
+  segment.NumberOfFrames = this->SegmentFramesRecorded;
+  segment.FirstTimestamp = this->SegmentFirstTimestamp;
+  segment.LastTimestamp = this->SegmentLastTimestamp;
+  segment.Complete = (status == PLUS_SUCCESS);
+  this->Manifest->SetSegment(segment);
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::RollSegment()
+{
+  if (this->FinalizeSegment() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to finalize recording segment " << this->GetSegmentFilename(this->SegmentIndex));
+    this->StopRecording();
+    return PLUS_FAIL;
+  }
+  std::vector<std::string> finishedSegmentFiles = GetSequenceDataFiles(this->GetSegmentFilename(this->SegmentIndex));
+
+  ++this->SegmentIndex;
+  this->ResetSegmentStatistics();
+  if (this->OpenWriter(this->GetSegmentFilename(this->SegmentIndex)) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to start recording segment " << this->GetSegmentFilename(this->SegmentIndex));
+    this->StopRecording();
+    return PLUS_FAIL;
+  }
+  LOG_DEBUG("Recording continues in segment " << this->GetSegmentFilename(this->SegmentIndex));
+
+  this->StartSegmentSync(finishedSegmentFiles);
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusVirtualCapture::StartSegmentSync(const std::vector<std::string>& segmentFiles)
+{
+  this->WaitForSegmentSync();
+
+  // The manifest only references the finished segment as complete after the segment has reached the disk
+  vtkSmartPointer<vtkPlusSequenceManifest> manifestSnapshot = vtkSmartPointer<vtkPlusSequenceManifest>::New();
+  manifestSnapshot->DeepCopy(this->Manifest);
+  std::string manifestFilename = this->ManifestFilename;
+  this->SegmentSyncThread = std::thread([segmentFiles, manifestSnapshot, manifestFilename]()
+  {
+    for (std::vector<std::string>::const_iterator it = segmentFiles.begin(); it != segmentFiles.end(); ++it)
+    {
+      vtkPlusSequenceManifest::SyncFileToDisk(*it);
+    }
+    manifestSnapshot->WriteFile(manifestFilename);
+  });
+  this->IsManifestSaved = true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualCapture::WaitForSegmentSync()
+{
+  if (this->SegmentSyncThread.joinable())
+  {
+    this->SegmentSyncThread.join();
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::CloseSegmentedFile(const char* aFilename, std::string* resultFilename)
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->WriterAccessMutex);
+
+  PlusStatus status = PLUS_SUCCESS;
+  std::string currentSegmentFilename = this->GetSegmentFilename(this->SegmentIndex);
+  if (this->IsHeaderPrepared)
+  {
+    status = this->FinalizeSegment();
+    std::vector<std::string> segmentFiles = GetSequenceDataFiles(currentSegmentFilename);
+    for (std::vector<std::string>::iterator it = segmentFiles.begin(); it != segmentFiles.end(); ++it)
+    {
+      vtkPlusSequenceManifest::SyncFileToDisk(*it);
+    }
+  }
+  else
+  {
+    // The current segment has not received any frames
+    this->Manifest->RemoveSegment(vtksys::SystemTools::GetFilenameName(currentSegmentFilename));
+  }
+  this->WaitForSegmentSync();
+
+  if (this->Manifest->GetNumberOfSegments() == 0)
+  {
+    // nothing has been recorded, so nothing to finalize
+    return status;
+  }
+
+  std::string manifestFilename = this->ManifestFilename;
+  if (aFilename != NULL && strlen(aFilename) != 0)
+  {
+    std::string requestedRoot;
+    std::string requestedExtension;
+    SplitSequenceFilename(vtkPlusConfig::GetInstance()->GetOutputPath(aFilename), requestedRoot, requestedExtension);
+    std::string requestedManifestFilename = requestedRoot + vtkPlusSequenceManifest::GetFileExtension();
+    if (vtksys::SystemTools::GetFilenamePath(requestedManifestFilename) == vtksys::SystemTools::GetFilenamePath(manifestFilename))
+    {
+      manifestFilename = requestedManifestFilename;
+      this->CurrentFilename = aFilename;
+    }
+    else
+    {
+      LOG_WARNING("Segmented recording can only be renamed within the output directory. Manifest is saved as " << manifestFilename);
+    }
+  }
+
+  if (this->Manifest->WriteFile(manifestFilename) != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+  if (manifestFilename != this->ManifestFilename && vtksys::SystemTools::FileExists(this->ManifestFilename, true))
+  {
+    vtksys::SystemTools::RemoveFile(this->ManifestFilename);
+  }
+
+  if (resultFilename != NULL)
+  {
+    (*resultFilename) = manifestFilename;
+  }
+
+  std::string configFileName = manifestFilename.substr(0, manifestFilename.size() - vtkPlusSequenceManifest::GetFileExtension().size()) + "_config.xml";
+  igsioCommon::XML::PrintXML(configFileName.c_str(), vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationData());
+
+  this->IsHeaderPrepared = false;
+  this->TotalFramesRecorded = 0;
+  this->NumberOfDeduplicatedFrames = 0;
+  this->RecordedFrames->Clear();
+
+  if (this->OpenFile() != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  return status;
+}
+
 //----------------------------------------------------------------------------
 
 PlusStatus vtkPlusVirtualCapture::InternalUpdate()
@@ -343,6 +813,14 @@ PlusStatus vtkPlusVirtualCapture::InternalUpdate()
     LOG_ERROR("Error while getting tracked frame list from data collector during capturing. Last recorded timestamp: " << std::fixed << this->NextFrameToBeRecordedTimestamp);
   }
   int nbFramesAfter = this->RecordedFrames->GetNumberOfTrackedFrames();
+  if (this->EnableFrameDeduplication && this->EnableFileCompression && this->TrackingWriter == NULL)
+  {
+    this->DeduplicateFrames(nbFramesBefore);
+  }
+  if (this->IsSegmented())
+  {
+    this->AccumulateSegmentStatistics(nbFramesBefore);
+  }
 
   // Compute the average frame rate from the ratio of recently acquired frames
   int frame1Index = this->RecordedFrames->GetNumberOfTrackedFrames() - 1; // index of the latest frame
@@ -378,6 +856,22 @@ PlusStatus vtkPlusVirtualCapture::InternalUpdate()
 
   this->TotalFramesRecorded += nbFramesAfter - nbFramesBefore;
 
+  if (this->IsSegmented())
+  {
+    if (this->IsSegmentFull())
+    {
+      if (this->RollSegment() != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+    }
+    else if (!this->IsManifestSaved && this->IsHeaderPrepared)
+    {
+      // The first manifest is written in the background as well, so that file I/O does not delay the acquisition
+      this->StartSegmentSync(std::vector<std::string>());
+    }
+  }
+
   if (this->TotalFramesRecorded == 0)
   {
     // We haven't received any data so far
@@ -450,7 +944,7 @@ PlusStatus vtkPlusVirtualCapture::NotifyConfigured()
 //-----------------------------------------------------------------------------
 bool vtkPlusVirtualCapture::HasUnsavedData() const
 {
-  return this->IsHeaderPrepared;
+  return this->IsHeaderPrepared || (this->IsSegmented() && this->SegmentIndex > 0);
 }
 
 //-----------------------------------------------------------------------------
@@ -474,6 +968,10 @@ void vtkPlusVirtualCapture::SetEnableFileCompression(bool aFileCompression)
   {
     this->Writer->SetUseCompression(aFileCompression);
   }
+  if (this->TrackingWriter != NULL)
+  {
+    this->TrackingWriter->SetUseCompression(aFileCompression);
+  }
 
   this->EnableFileCompression = aFileCompression;
 }
@@ -502,15 +1000,47 @@ PlusStatus vtkPlusVirtualCapture::Reset()
 
     this->SetEnableCapturing(false);
 
-    if (this->IsHeaderPrepared)
+    if (this->TrackingWriter != NULL)
+    {
+      if (this->IsHeaderPrepared)
+      {
+        this->TrackingWriter->Close();
+        vtksys::SystemTools::RemoveFile(this->TrackingWriter->GetFileName());
+      }
+    }
+    else
     {
-      this->Writer->Discard();
+      if (this->IsHeaderPrepared)
+      {
+        this->Writer->Discard();
+      }
+      this->Writer->GetTrackedFrameList()->Clear();
     }
 
     this->ClearRecordedFrames();
-    this->Writer->GetTrackedFrameList()->Clear();
     this->IsHeaderPrepared = false;
     this->TotalFramesRecorded = 0;
+    this->NumberOfDeduplicatedFrames = 0;
+
+    if (this->IsSegmented())
+    {
+      // Discard the already finished segments, too
+      this->WaitForSegmentSync();
+      std::string manifestDirectory = vtksys::SystemTools::GetFilenamePath(this->ManifestFilename);
+      for (int i = 0; i < this->Manifest->GetNumberOfSegments(); ++i)
+      {
+        std::vector<std::string> segmentFiles = GetSequenceDataFiles(manifestDirectory + "/" + this->Manifest->GetSegment(i).FileName);
+        for (std::vector<std::string>::iterator it = segmentFiles.begin(); it != segmentFiles.end(); ++it)
+        {
+          vtksys::SystemTools::RemoveFile(*it);
+        }
+      }
+      if (vtksys::SystemTools::FileExists(this->ManifestFilename, true))
+      {
+        vtksys::SystemTools::RemoveFile(this->ManifestFilename);
+      }
+      this->Manifest->Clear();
+    }
   }
 
   if (this->OpenFile() != PLUS_SUCCESS)
@@ -584,6 +1114,11 @@ PlusStatus vtkPlusVirtualCapture::TakeSnapshot()
     return PLUS_FAIL;
   }
 
+  if (this->IsSegmented())
+  {
+    this->AccumulateSegmentStatistics(this->RecordedFrames->GetNumberOfTrackedFrames() - 1);
+  }
+
   if (this->WriteFrames() != PLUS_SUCCESS)
   {
     LOG_ERROR(this->GetDeviceId() << ": Failed to write snapshot frame");
@@ -598,12 +1133,22 @@ PlusStatus vtkPlusVirtualCapture::TakeSnapshot()
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualCapture::SetCustomHeaderField(const std::string& fieldName, const std::string& fieldValue)
 {
+  if (this->TrackingWriter != NULL)
+  {
+    this->TrackingWriter->SetCustomString(fieldName, fieldValue);
+    return PLUS_SUCCESS;
+  }
   return this->Writer->GetTrackedFrameList()->SetCustomString(fieldName, fieldValue);
 }
 
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualCapture::WriteFrames(bool force)
 {
+  if (this->TrackingWriter != NULL)
+  {
+    return this->WriteTrackingFrames(force);
+  }
+
   if (!this->IsHeaderPrepared && this->RecordedFrames->GetNumberOfTrackedFrames() != 0)
   {
     if (this->Writer->PrepareHeader() != PLUS_SUCCESS)
@@ -644,6 +1189,39 @@ PlusStatus vtkPlusVirtualCapture::WriteFrames(bool force)
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::WriteTrackingFrames(bool force)
+{
+  if (this->RecordedFrames->GetNumberOfTrackedFrames() == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  if (!this->IsHeaderPrepared)
+  {
+    if (this->TrackingWriter->OpenForWriting() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to open tracking sequence file " << this->TrackingWriter->GetFileName());
+      this->StopRecording();
+      return PLUS_FAIL;
+    }
+    this->IsHeaderPrepared = true;
+  }
+
+  if (force || !this->IsFrameBuffered() || this->RecordedFrames->GetNumberOfTrackedFrames() > this->GetFrameBufferSize())
+  {
+    if (this->TrackingWriter->AppendFrames(this->RecordedFrames) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to append frames. Stopping recording at timestamp: " << LastAlreadyRecordedFrameTimestamp);
+      this->StopRecording();
+      return PLUS_FAIL;
+    }
+    this->ClearRecordedFrames();
+  }
+
+  return PLUS_SUCCESS;
+}
+
 //-----------------------------------------------------------------------------
 int vtkPlusVirtualCapture::OutputChannelCount() const
 {
@@ -11,12 +11,22 @@ See License.txt for details.
 #include "vtkPlusDevice.h"
 #include "vtkIGSIOSequenceIOBase.h"
 #include <string>
+#include <thread>
+#include <vector>
 
 //class vtkIGSIOTrackedFrameList;
+class vtkPlusSequenceManifest;
+class vtkPlusTrackingSequenceIO;
 
 /*!
 \class vtkPlusVirtualCapture
-\brief
+\brief Records the data of its input channel into sequence files
+
+If any of SegmentMaxFrames, SegmentMaxDurationSec or SegmentMaxSizeMB is set then the recording is
+segmented: a new self-contained file is started whenever the current one reaches the limit.
+Finished segments are flushed to disk in a background thread and listed in a manifest file
+(see vtkPlusSequenceManifest), which can be opened as one sequence by vtkPlusSequenceIO::Read.
+A crash therefore only loses the segment that was being written.
 
 \ingroup PlusLibDataCollection
 */
@@ -89,12 +99,44 @@ public:
   vtkSetMacro(FrameBufferSize, unsigned int);
   vtkGetMacro(FrameBufferSize, unsigned int);
 
+  /*! Start a new segment after this many frames (0 = no limit) */
+  vtkSetMacro(SegmentMaxFrames, unsigned int);
+  vtkGetMacro(SegmentMaxFrames, unsigned int);
+
+  /*! Start a new segment after this much recording time (0 = no limit) */
+  vtkSetMacro(SegmentMaxDurationSec, double);
+  vtkGetMacro(SegmentMaxDurationSec, double);
+
+  /*! Start a new segment when the segment size reaches this limit (0 = no limit). The size of image data is estimated from the uncompressed size. */
+  vtkSetMacro(SegmentMaxSizeMB, double);
+  vtkGetMacro(SegmentMaxSizeMB, double);
+
+  /*! Returns true if any of the segment limits is set */
+  virtual bool IsSegmented() const;
+
+  /*!
+    If enabled then a frame whose image is identical to the previous recorded frame is stored as a reference:
+    its image is blanked (which deflates to almost nothing) and the ReferencedFrameOffset field points back
+    to the frame that holds the image. vtkPlusSequenceIO::Read restores the images when the file is read.
+    The FrameHash field of the frames is used for comparison if present (see vtkPlusBuffer::SetFrameHashing),
+    otherwise the hash is computed here; frames with matching hash are also compared byte by byte.
+    Deduplication is only performed if EnableFileCompression is enabled, because blanked images do not reduce
+    the size of uncompressed files; a warning is logged when a file is opened with deduplication but without compression.
+    Compression is not supported for MetaImage files (it is turned off when a MetaImage file is opened), use NRRD files instead.
+  */
+  vtkSetMacro(EnableFrameDeduplication, bool);
+  vtkGetMacro(EnableFrameDeduplication, bool);
+  vtkBooleanMacro(EnableFrameDeduplication, bool);
+
+  /*! Number of frames that were stored as a reference to an identical frame since the recording was started */
+  vtkGetMacro(NumberOfDeduplicatedFrames, long int);
+
   virtual vtkPlusDataCollector* GetDataCollector() { return this->DataCollector; }
 
   virtual bool IsTracker() const { return false; }
   virtual bool IsVirtual() const { return true; }
 
-  virtual std::string GetOutputFileName() { return vtkPlusConfig::GetInstance()->GetOutputPath(CurrentFilename); };
+  virtual std::string GetOutputFileName() { return this->IsSegmented() ? this->ManifestFilename : vtkPlusConfig::GetInstance()->GetOutputPath(CurrentFilename); };
 
 protected:
   vtkPlusVirtualCapture();
@@ -116,6 +158,45 @@ protected:
   */
   virtual PlusStatus WriteFrames(bool force = false);
 
+  /*! WriteFrames implementation for tracking-only (.igs.trk) files. Each write appends one block to the file. */
+  virtual PlusStatus WriteTrackingFrames(bool force);
+
+  /*! CloseFile implementation for tracking-only (.igs.trk) files */
+  virtual PlusStatus CloseTrackingFile(const char* aFilename, std::string* resultFilename);
+
+  /*! Create the sequence writer for the specified file (full path) */
+  virtual PlusStatus OpenWriter(const std::string& filePath);
+
+  /*! CloseFile implementation for segmented recording. Finalizes the current segment and writes the manifest. */
+  virtual PlusStatus CloseSegmentedFile(const char* aFilename, std::string* resultFilename);
+
+  /*! Write all pending frames into the current segment, finalize its file and mark it complete in the manifest */
+  virtual PlusStatus FinalizeSegment();
+
+  /*! Finalize the current segment and continue recording in a new one */
+  virtual PlusStatus RollSegment();
+
+  /*! Flush the files of a finished segment (if any) to disk and then update the manifest file, in a background thread */
+  void StartSegmentSync(const std::vector<std::string>& segmentFiles);
+
+  /*! Wait until the background segment flushing is completed */
+  void WaitForSegmentSync();
+
+  /*! Full path of the file of the specified segment */
+  std::string GetSegmentFilename(int segmentIndex) const;
+
+  /*! Reset frame count, time range and size of the current segment and add it to the manifest as incomplete */
+  void ResetSegmentStatistics();
+
+  /*! Update current segment frame count, time range and size with the recorded frames starting at the specified index */
+  void AccumulateSegmentStatistics(int firstNewFrameIndex);
+
+  /*! Returns true if the current segment has reached any of the segment limits */
+  bool IsSegmentFull() const;
+
+  /*! Replace the images of the recorded frames starting at the specified index that are identical to the previous frame by a reference */
+  void DeduplicateFrames(int firstNewFrameIndex);
+
 protected:
   /*! Recorded tracked frame list */
   vtkIGSIOTrackedFrameList* RecordedFrames;
@@ -155,6 +236,9 @@ protected:
   /*! Sequence writer to write to */
   vtkIGSIOSequenceIOBase* Writer;
 
+  /*! Writer for tracking-only (.igs.trk) files, used instead of Writer if the output file has that extension */
+  vtkSmartPointer<vtkPlusTrackingSequenceIO> TrackingWriter;
+
   /*! When closing the file, re-read the data from file, and write it compressed */
   bool EnableFileCompression;
 
@@ -182,6 +266,35 @@ protected:
 
   vtkPlusLogger::LogLevelType GracePeriodLogLevel;
 
+  unsigned int SegmentMaxFrames;
+  double SegmentMaxDurationSec;
+  double SegmentMaxSizeMB;
+
+  /*! List of segments of the current recording */
+  vtkSmartPointer<vtkPlusSequenceManifest> Manifest;
+  /*! Full path of the manifest file of the current recording */
+  std::string ManifestFilename;
+  bool IsManifestSaved;
+  /*! Full path and extension of the current recording, segment index is inserted between them */
+  std::string SegmentFilenameRoot;
+  std::string SegmentFilenameExtension;
+  int SegmentIndex;
+  long int SegmentFramesRecorded;
+  double SegmentFirstTimestamp;
+  double SegmentLastTimestamp;
+  double SegmentSizeBytes;
+  /*! Flushes finished segments to disk and updates the manifest while recording continues */
+  std::thread SegmentSyncThread;
+
+  bool EnableFrameDeduplication;
+  long int NumberOfDeduplicatedFrames;
+  /*! Hash of the last frame that was written with its image in the current file */
+  std::string LastPayloadFrameHash;
+  /*! Copy of the last frame image that was written in the current file, duplicates are verified against it */
+  igsioVideoFrame LastPayloadFrame;
+  /*! Number of frames recorded since the last frame that was written with its image in the current file */
+  unsigned int FramesSinceLastPayload;
+
   PlusStatus GetInputTrackedFrame(igsioTrackedFrame& aFrame);
   PlusStatus GetInputTrackedFrameListSampled(double& lastAlreadyRecordedFrameTimestamp, double& nextFrameToBeRecordedTimestamp, vtkIGSIOTrackedFrameList* recordedFrames, double requestedFramePeriodSec, double maxProcessingTimeSec);
   PlusStatus GetLatestInputItemTimestamp(double& timestamp);
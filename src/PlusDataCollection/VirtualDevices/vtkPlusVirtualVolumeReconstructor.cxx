@@ -6,6 +6,7 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "igsioTrackedFrame.h"
+#include "vtkImageData.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
@@ -15,12 +16,17 @@ See License.txt for details.
 #include "vtkPlusVirtualVolumeReconstructor.h"
 #include "vtkPlusVolumeReconstructor.h"
 #include "vtksys/SystemTools.hxx"
+#include "vtkXMLDataElement.h"
+
+#include <algorithm>
 
 //----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusVirtualVolumeReconstructor);
 
 static const int MAX_ALLOWED_RECONSTRUCTION_LAG_SEC = 3.0; // if the reconstruction lags more than this then it'll skip frames to catch up
+static const double MAX_HOLE_FILLING_REGION_VOLUME_RATIO = 0.5; // if the regions to fill are larger than this fraction of the volume then the whole volume is filled
+static const int MAX_HOLE_FILLING_REGIONS = 16; // if the modified bricks cannot be covered by this many boxes then their bounding box is filled
 
 //----------------------------------------------------------------------------
 vtkPlusVirtualVolumeReconstructor::vtkPlusVirtualVolumeReconstructor()
@@ -33,13 +39,26 @@ vtkPlusVirtualVolumeReconstructor::vtkPlusVirtualVolumeReconstructor()
   , m_LastUpdateTime(0.0)
   , TotalFramesRecorded(0)
   , EnableReconstruction(false)
+  , NumberOfFrameInsertionThreads(1)
+  , ReproducibleFrameInsertion(false)
+  , PreviewDownsamplingFactor(4)
   , VolumeReconstructorAccessMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
+  , SnapshotConfigurationModified(true)
+  , SnapshotFullCopyRequired(true)
+  , SnapshotAccessMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
+  , HoleFilledVolumeValid(false)
+  , HoleFillingKernelRadius(-1)
+  , PreviewVolumeValid(false)
 {
   // The data capture thread will be used to regularly read the frames and write to disk
   this->StartThreadForInternalUpdates = true;
 
   this->VolumeReconstructor = vtkSmartPointer<vtkPlusVolumeReconstructor>::New();
   this->TransformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  this->SnapshotVolumeReconstructor = vtkSmartPointer<vtkPlusVolumeReconstructor>::New();
+  this->HoleFilledVolume = vtkSmartPointer<vtkImageData>::New();
+  this->HoleFillingRegionReconstructor = vtkSmartPointer<vtkPlusVolumeReconstructor>::New();
+  this->PreviewVolume = vtkSmartPointer<vtkImageData>::New();
 }
 
 //----------------------------------------------------------------------------
@@ -61,9 +80,18 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::ReadConfiguration(vtkXMLDataElemen
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableReconstruction, deviceConfig);
   XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(OutputVolFilename, deviceConfig);
   XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(OutputVolDeviceName, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfFrameInsertionThreads, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(ReproducibleFrameInsertion, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, PreviewDownsamplingFactor, deviceConfig);
+  if (this->PreviewDownsamplingFactor < 1)
+  {
+    LOG_WARNING("PreviewDownsamplingFactor must be at least 1, it is changed from " << this->PreviewDownsamplingFactor << " to 1");
+    this->PreviewDownsamplingFactor = 1;
+  }
 
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
   this->VolumeReconstructor->ReadConfiguration(deviceConfig);
+  this->SnapshotConfigurationModified = true;
 
   return PLUS_SUCCESS;
 }
@@ -77,6 +105,9 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::WriteConfiguration(vtkXMLDataEleme
 
   deviceElement->SetAttribute("OutputVolFilename", this->OutputVolFilename.c_str());
   deviceElement->SetAttribute("OutputVolDeviceName", this->OutputVolDeviceName.c_str());
+  deviceElement->SetIntAttribute("NumberOfFrameInsertionThreads", this->NumberOfFrameInsertionThreads);
+  deviceElement->SetAttribute("ReproducibleFrameInsertion", this->ReproducibleFrameInsertion ? "TRUE" : "FALSE");
+  deviceElement->SetIntAttribute("PreviewDownsamplingFactor", this->PreviewDownsamplingFactor);
 
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
   this->VolumeReconstructor->WriteConfiguration(deviceElement);
@@ -269,6 +300,8 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::Reset()
 {
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
   this->VolumeReconstructor->Reset();
+  // Only the bricks that contained data have to be cleared in the snapshot
+  this->SnapshotModifiedBricks.MarkCleared();
   return PLUS_SUCCESS;
 }
 
@@ -321,6 +354,7 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolumeFromFile(con
 
   // Determine volume extents automatically
   std::string errorDetail;
+  this->SnapshotConfigurationModified = true;
   if (this->VolumeReconstructor->SetOutputExtentFromFrameList(trackedFrameList, this->TransformRepository, errorDetail) != PLUS_SUCCESS)
   {
     errorMessage = "vtkPlusReconstructVolumeCommand::Execute: failed, could not set up output volume - " + errorDetail;
@@ -335,7 +369,7 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolumeFromFile(con
     return PLUS_FAIL;
   }
   // Get output
-  if (GetReconstructedVolume(reconstructedVolume, errorMessage) != PLUS_SUCCESS)
+  if (this->ExtractGrayLevels(this->VolumeReconstructor, reconstructedVolume, errorMessage, true) != PLUS_SUCCESS)
   {
     LOG_INFO(errorMessage);
     return PLUS_FAIL;
@@ -347,16 +381,146 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolumeFromFile(con
 PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolume(vtkImageData* reconstructedVolume, std::string& outErrorMessage, bool applyHoleFilling/*=true*/)
 {
   outErrorMessage.clear();
-  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
-  bool oldFillHoles = this->VolumeReconstructor->GetFillHoles();
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> snapshotLock(this->SnapshotAccessMutex);
+  {
+    // Frame insertion is only blocked while the modified voxels are copied
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
+    if (this->UpdateSnapshot() != PLUS_SUCCESS)
+    {
+      outErrorMessage = "Failed to take snapshot of the reconstructed volume";
+      LOG_ERROR(outErrorMessage);
+      return PLUS_FAIL;
+    }
+  }
+  if (applyHoleFilling && this->SnapshotVolumeReconstructor->GetFillHoles())
+  {
+    return this->ExtractHoleFilledVolume(reconstructedVolume, outErrorMessage);
+  }
+  return this->ExtractGrayLevels(this->SnapshotVolumeReconstructor, reconstructedVolume, outErrorMessage, applyHoleFilling);
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolumePreview(vtkImageData* previewVolume, std::string& outErrorMessage)
+{
+  outErrorMessage.clear();
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> snapshotLock(this->SnapshotAccessMutex);
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
+    if (this->UpdateSnapshot() != PLUS_SUCCESS)
+    {
+      outErrorMessage = "Failed to take snapshot of the reconstructed volume";
+      LOG_ERROR(outErrorMessage);
+      return PLUS_FAIL;
+    }
+  }
+
+  int volumeExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  this->SnapshotVolumeReconstructor->GetPastedVolumeExtent(volumeExtent);
+  bool updateWholeVolume = !this->PreviewVolumeValid || !this->PreviewModifiedBricks.IsInitializedForExtent(volumeExtent);
+  std::vector<PlusVolumeBrickGrid::ExtentType> modifiedExtents;
+  if (!updateWholeVolume)
+  {
+    this->PreviewModifiedBricks.GetModifiedExtents(modifiedExtents);
+  }
+  this->PreviewVolumeValid = false;
+  if (this->SnapshotVolumeReconstructor->UpdateDownsampledVolume(this->PreviewVolume, this->PreviewDownsamplingFactor, updateWholeVolume ? NULL : &modifiedExtents) != PLUS_SUCCESS)
+  {
+    outErrorMessage = "Failed to downsample the reconstructed volume";
+    LOG_ERROR(outErrorMessage);
+    return PLUS_FAIL;
+  }
+  if (updateWholeVolume)
+  {
+    this->PreviewModifiedBricks.Initialize(volumeExtent, false);
+  }
+  this->PreviewModifiedBricks.ClearModified();
+  this->PreviewVolumeValid = true;
+
+  previewVolume->DeepCopy(this->PreviewVolume);
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualVolumeReconstructor::ExtractHoleFilledVolume(vtkImageData* reconstructedVolume, std::string& outErrorMessage)
+{
+  int volumeExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  this->SnapshotVolumeReconstructor->GetPastedVolumeExtent(volumeExtent);
+
+  bool fillWholeVolume = !this->HoleFilledVolumeValid || this->HoleFillingKernelRadius < 0 || !this->HoleFillingModifiedBricks.IsInitializedForExtent(volumeExtent);
+  if (!fillWholeVolume && this->HoleFillingModifiedBricks.GetNumberOfModifiedBricks() > 0)
+  {
+    // Boxes of modified bricks, hole filling results change within the kernel radius around them
+    std::vector<PlusVolumeBrickGrid::ExtentType> modifiedRegions;
+    this->HoleFillingModifiedBricks.GetModifiedRegions(modifiedRegions, MAX_HOLE_FILLING_REGIONS);
+    std::vector<PlusVolumeBrickGrid::ExtentType> updateRegions;
+    double regionVolumeRatio = 0.0;
+    for (std::vector<PlusVolumeBrickGrid::ExtentType>::const_iterator regionIt = modifiedRegions.begin(); regionIt != modifiedRegions.end(); ++regionIt)
+    {
+      PlusVolumeBrickGrid::ExtentType updateExtent;
+      double ratio = 1.0;
+      for (int i = 0; i < 3; i++)
+      {
+        updateExtent[2 * i] = std::max((*regionIt)[2 * i] - this->HoleFillingKernelRadius, volumeExtent[2 * i]);
+        updateExtent[2 * i + 1] = std::min((*regionIt)[2 * i + 1] + this->HoleFillingKernelRadius, volumeExtent[2 * i + 1]);
+        // the region that is read includes another kernel radius margin
+        int regionSize = std::min(updateExtent[2 * i + 1] + this->HoleFillingKernelRadius, volumeExtent[2 * i + 1])
+                         - std::max(updateExtent[2 * i] - this->HoleFillingKernelRadius, volumeExtent[2 * i]) + 1;
+        ratio *= static_cast<double>(regionSize) / (volumeExtent[2 * i + 1] - volumeExtent[2 * i] + 1);
+      }
+      regionVolumeRatio += ratio;
+      updateRegions.push_back(updateExtent);
+    }
+    if (regionVolumeRatio > MAX_HOLE_FILLING_REGION_VOLUME_RATIO)
+    {
+      fillWholeVolume = true;
+    }
+    else
+    {
+      // Regions may overlap within the kernel radius, each region is filled from the unfilled snapshot so the result does not depend on the order
+      for (std::vector<PlusVolumeBrickGrid::ExtentType>::const_iterator regionIt = updateRegions.begin(); regionIt != updateRegions.end(); ++regionIt)
+      {
+        if (this->SnapshotVolumeReconstructor->UpdateGrayLevelsInRegion(this->HoleFilledVolume, regionIt->data(), this->HoleFillingKernelRadius, this->HoleFillingRegionReconstructor) != PLUS_SUCCESS)
+        {
+          LOG_WARNING("Failed to fill holes in a modified region of the volume, fill holes in the whole volume");
+          fillWholeVolume = true;
+          break;
+        }
+      }
+      if (!fillWholeVolume)
+      {
+        LOG_DEBUG("Holes filled in " << updateRegions.size() << " regions, " << regionVolumeRatio * 100.0 << "% of the volume");
+      }
+    }
+  }
+
+  if (fillWholeVolume)
+  {
+    this->HoleFilledVolumeValid = false;
+    if (this->ExtractGrayLevels(this->SnapshotVolumeReconstructor, this->HoleFilledVolume, outErrorMessage, true) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    this->HoleFillingModifiedBricks.Initialize(volumeExtent, false);
+    this->HoleFilledVolumeValid = true;
+  }
+  this->HoleFillingModifiedBricks.ClearModified();
+
+  reconstructedVolume->DeepCopy(this->HoleFilledVolume);
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualVolumeReconstructor::ExtractGrayLevels(vtkPlusVolumeReconstructor* reconstructor, vtkImageData* reconstructedVolume, std::string& outErrorMessage, bool applyHoleFilling)
+{
+  bool oldFillHoles = reconstructor->GetFillHoles();
   if (!applyHoleFilling)
   {
-    this->VolumeReconstructor->SetFillHoles(false);
+    reconstructor->SetFillHoles(false);
   }
-  PlusStatus status = this->VolumeReconstructor->ExtractGrayLevels(reconstructedVolume);
+  PlusStatus status = reconstructor->ExtractGrayLevels(reconstructedVolume);
   if (!applyHoleFilling)
   {
-    this->VolumeReconstructor->SetFillHoles(oldFillHoles);
+    reconstructor->SetFillHoles(oldFillHoles);
   }
 
   if (status != PLUS_SUCCESS)
@@ -376,29 +540,53 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::AddFrames(vtkIGSIOTrackedFrameList
   PlusStatus status = PLUS_SUCCESS;
   const int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
   int numberOfFramesAddedToVolume = 0;
-  for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += this->VolumeReconstructor->GetSkipInterval())
+  if (this->NumberOfFrameInsertionThreads != 1 || this->ReproducibleFrameInsertion)
   {
-    LOG_TRACE("Adding frame to volume reconstructor: " << frameIndex);
-    igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
-    if (this->TransformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+    // Paste the frames in parallel
+    std::vector<igsioTrackedFrame*> frames;
+    for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += this->VolumeReconstructor->GetSkipInterval())
     {
-      LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
-      status = PLUS_FAIL;
-      continue;
+      frames.push_back(trackedFrameList->GetTrackedFrame(frameIndex));
     }
-    // Insert slice for reconstruction
-    bool insertedIntoVolume = false;
-    bool isFirst = frameIndex == 0;
-    bool isLast = frameIndex + this->VolumeReconstructor->GetSkipInterval() >= numberOfFrames;
-    if (this->VolumeReconstructor->AddTrackedFrame(frame, this->TransformRepository, isFirst, isLast, &insertedIntoVolume) != PLUS_SUCCESS)
+    std::vector<PlusVolumeBrickGrid::ExtentType> insertedFrameExtents;
+    status = this->VolumeReconstructor->AddTrackedFrames(frames, this->TransformRepository, static_cast<unsigned int>(std::max(this->NumberOfFrameInsertionThreads, 0)),
+             this->ReproducibleFrameInsertion, &insertedFrameExtents);
+    numberOfFramesAddedToVolume = static_cast<int>(insertedFrameExtents.size());
+    if (!this->SnapshotFullCopyRequired)
     {
-      LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
-      status = PLUS_FAIL;
-      continue;
+      for (std::vector<PlusVolumeBrickGrid::ExtentType>::const_iterator extentIt = insertedFrameExtents.begin(); extentIt != insertedFrameExtents.end(); ++extentIt)
+      {
+        this->SnapshotModifiedBricks.MarkModified(extentIt->data());
+      }
     }
-    if (insertedIntoVolume)
+  }
+  else
+  {
+    for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += this->VolumeReconstructor->GetSkipInterval())
     {
-      numberOfFramesAddedToVolume++;
+      LOG_TRACE("Adding frame to volume reconstructor: " << frameIndex);
+      igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
+      if (this->TransformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
+        status = PLUS_FAIL;
+        continue;
+      }
+      // Insert slice for reconstruction
+      bool insertedIntoVolume = false;
+      bool isFirst = frameIndex == 0;
+      bool isLast = frameIndex + this->VolumeReconstructor->GetSkipInterval() >= numberOfFrames;
+      if (this->VolumeReconstructor->AddTrackedFrame(frame, this->TransformRepository, isFirst, isLast, &insertedIntoVolume) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
+        status = PLUS_FAIL;
+        continue;
+      }
+      if (insertedIntoVolume)
+      {
+        numberOfFramesAddedToVolume++;
+        this->MarkSnapshotModifiedBricks(frame);
+      }
     }
   }
   trackedFrameList->Clear();
@@ -408,6 +596,95 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::AddFrames(vtkIGSIOTrackedFrameList
   return status;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualVolumeReconstructor::UpdateSnapshot()
+{
+  // Apply configuration changes (hole filling parameters, output geometry, ...) to the snapshot reconstructor.
+  // The configuration is only serialized if it may have changed, not at every snapshot.
+  if (this->SnapshotConfigurationModified)
+  {
+    vtkSmartPointer<vtkXMLDataElement> configElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    configElement->SetName("Device");
+    this->VolumeReconstructor->WriteConfiguration(configElement);
+    std::ostringstream configStream;
+    configElement->PrintXML(configStream, vtkIndent());
+    if (configStream.str() != this->SnapshotVolumeReconstructorConfiguration)
+    {
+      if (this->SnapshotVolumeReconstructor->ReadConfiguration(configElement) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to configure the snapshot volume reconstructor");
+        return PLUS_FAIL;
+      }
+      this->SnapshotVolumeReconstructorConfiguration = configStream.str();
+      this->SnapshotFullCopyRequired = true;
+      this->HoleFillingKernelRadius = this->SnapshotVolumeReconstructor->GetHoleFillingKernelRadius();
+    }
+    this->SnapshotConfigurationModified = false;
+  }
+
+  int volumeExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  this->VolumeReconstructor->GetPastedVolumeExtent(volumeExtent);
+  if (!this->SnapshotModifiedBricks.IsInitializedForExtent(volumeExtent))
+  {
+    this->SnapshotFullCopyRequired = true;
+  }
+
+  std::vector<PlusVolumeBrickGrid::ExtentType> regionExtents;
+  if (this->SnapshotFullCopyRequired)
+  {
+    PlusVolumeBrickGrid::ExtentType wholeExtent = { { VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX } };
+    regionExtents.push_back(wholeExtent);
+  }
+  else
+  {
+    this->SnapshotModifiedBricks.GetModifiedExtents(regionExtents);
+  }
+  bool fullCopyPerformed = false;
+  if (this->SnapshotVolumeReconstructor->CopyPastedVolume(this->VolumeReconstructor, regionExtents, &fullCopyPerformed) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  if (this->SnapshotFullCopyRequired || fullCopyPerformed)
+  {
+    LOG_DEBUG("Reconstructed volume snapshot updated, whole volume copied");
+    // Any part of the copied volume may contain data
+    this->SnapshotModifiedBricks.Initialize(volumeExtent, true);
+    this->SnapshotFullCopyRequired = false;
+    this->HoleFilledVolumeValid = false;
+    this->PreviewVolumeValid = false;
+  }
+  else
+  {
+    for (std::vector<PlusVolumeBrickGrid::ExtentType>::const_iterator regionIt = regionExtents.begin(); regionIt != regionExtents.end(); ++regionIt)
+    {
+      this->HoleFillingModifiedBricks.MarkModified(regionIt->data());
+      this->PreviewModifiedBricks.MarkModified(regionIt->data());
+    }
+    LOG_DEBUG("Reconstructed volume snapshot updated, " << this->SnapshotModifiedBricks.GetNumberOfModifiedBricks() << " modified bricks copied. "
+              << this->SnapshotModifiedBricks.GetNumberOfTouchedBricks() << " of " << this->SnapshotModifiedBricks.GetNumberOfBricks() << " bricks were touched.");
+    this->SnapshotModifiedBricks.ClearModified();
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualVolumeReconstructor::MarkSnapshotModifiedBricks(igsioTrackedFrame* frame)
+{
+  if (this->SnapshotFullCopyRequired)
+  {
+    // The whole volume will be copied anyway
+    return;
+  }
+  int frameExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  if (this->VolumeReconstructor->GetFrameExtentInVolume(frame, this->TransformRepository, frameExtent) != PLUS_SUCCESS)
+  {
+    this->SnapshotFullCopyRequired = true;
+    return;
+  }
+  this->SnapshotModifiedBricks.MarkModified(frameExtent);
+}
+
 //-----------------------------------------------------------------------------
 double vtkPlusVirtualVolumeReconstructor::GetSamplingPeriodSec()
 {
@@ -440,17 +717,23 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::UpdateTransformRepository(vtkIGSIO
 //----------------------------------------------------------------------------
 void vtkPlusVirtualVolumeReconstructor::SetOutputOrigin(double* origin)
 {
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
   this->VolumeReconstructor->SetOutputOrigin(origin);
+  this->SnapshotConfigurationModified = true;
 }
 
 //----------------------------------------------------------------------------
 void vtkPlusVirtualVolumeReconstructor::SetOutputSpacing(double* spacing)
 {
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
   this->VolumeReconstructor->SetOutputSpacing(spacing);
+  this->SnapshotConfigurationModified = true;
 }
 
 //----------------------------------------------------------------------------
 void vtkPlusVirtualVolumeReconstructor::SetOutputExtent(int* extent)
 {
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
   this->VolumeReconstructor->SetOutputExtent(extent);
+  this->SnapshotConfigurationModified = true;
 }
@@ -9,6 +9,7 @@ See License.txt for details.
 
 #include "vtkPlusDataCollectionExport.h"
 
+#include "PlusVolumeBrickGrid.h"
 #include "vtkPlusDevice.h"
 #include <string>
 
@@ -33,11 +34,24 @@ public:
   virtual PlusStatus GetReconstructedVolumeFromFile(const std::string& inputSeqFilename, vtkImageData* reconstructedVolume, std::string& errorMessage);
 
   /*!
+    Get the current state of the reconstruction.
+    The voxels that changed since the previous call are copied into a snapshot volume, then hole filling and
+    gray level extraction run on the snapshot, so frames can be inserted into the volume meanwhile.
+    The hole filled volume is cached and only the regions that changed since the previous request (plus the hole
+    filling kernel radius) are filled again.
     This method is safe to be called from any thread.
     \param applyHoleFilling If true (default) then hole filling will be applied (if enabled and fully specified), otherwise hole filling will be skipped
   */
   PlusStatus GetReconstructedVolume(vtkImageData* reconstructedVolume, std::string& outErrorMessage, bool applyHoleFilling = true);
 
+  /*!
+    Get a downsampled preview of the current state of the reconstruction (without hole filling).
+    The preview is kept alongside the snapshot and only the blocks that changed since the previous request are recomputed,
+    so it is much faster to get (and to send) than the full resolution volume.
+    This method is safe to be called from any thread.
+  */
+  PlusStatus GetReconstructedVolumePreview(vtkImageData* previewVolume, std::string& outErrorMessage);
+
   /*!
     Updated the transform repository contents within the volume reconstructor.
     It is advisable to call this before each volume reconstruction starting.
@@ -81,6 +95,22 @@ public:
 
   vtkGetMacro(TotalFramesRecorded, long int);
 
+  /*! Number of threads that paste the frames into the volume (0 = one per processor core, 1 = frames are pasted one by one) */
+  vtkSetMacro(NumberOfFrameInsertionThreads, int);
+  vtkGetMacro(NumberOfFrameInsertionThreads, int);
+
+  /*!
+    If enabled then frames are pasted in parallel so that the reconstructed volume is bit-identical
+    regardless of the number of threads (tiles of fixed number of frames are merged in frame order)
+  */
+  vtkSetMacro(ReproducibleFrameInsertion, bool);
+  vtkGetMacro(ReproducibleFrameInsertion, bool);
+  vtkBooleanMacro(ReproducibleFrameInsertion, bool);
+
+  /*! Number of voxels along each axis that are merged into one voxel of the preview volume */
+  vtkSetMacro(PreviewDownsamplingFactor, int);
+  vtkGetMacro(PreviewDownsamplingFactor, int);
+
 protected:
 
   /*! Read main configuration from xml data */
@@ -115,6 +145,25 @@ protected:
 
   PlusStatus AddFrames(vtkIGSIOTrackedFrameList* trackedFrameList);
 
+  /*! Extract gray levels from a reconstructor, with or without hole filling */
+  PlusStatus ExtractGrayLevels(vtkPlusVolumeReconstructor* reconstructor, vtkImageData* reconstructedVolume, std::string& outErrorMessage, bool applyHoleFilling);
+
+  /*!
+    Copy the voxels that changed since the previous snapshot from the live reconstructor to the snapshot reconstructor.
+    VolumeReconstructorAccessMutex must be locked when calling this method.
+  */
+  PlusStatus UpdateSnapshot();
+
+  /*! Mark the bricks that inserting the frame modified, they are copied at the next snapshot */
+  void MarkSnapshotModifiedBricks(igsioTrackedFrame* frame);
+
+  /*!
+    Extract gray levels with hole filling from the snapshot. Hole filling is repeated only in the bounding box
+    of the bricks that changed since the previous call, the rest of the volume is taken from the cached result.
+    SnapshotAccessMutex must be locked when calling this method.
+  */
+  PlusStatus ExtractHoleFilledVolume(vtkImageData* reconstructedVolume, std::string& outErrorMessage);
+
   /*! Get the sampling period length (in seconds). Frames are copied from the devices to the data collection buffer once in every sampling period. */
   double GetSamplingPeriodSec();
 
@@ -149,12 +198,61 @@ protected:
 
   bool EnableReconstruction;
 
+  int NumberOfFrameInsertionThreads;
+  bool ReproducibleFrameInsertion;
+  int PreviewDownsamplingFactor;
+
   std::string OutputVolFilename;
   std::string OutputVolDeviceName;
 
   /*! Mutex instance simultaneous access of writer (writer may be accessed from command processing thread and also the internal update thread) */
   vtkSmartPointer<vtkIGSIORecursiveCriticalSection> VolumeReconstructorAccessMutex;
 
+  /*! Copy of the live reconstruction, hole filling and gray level extraction run on this so that they do not block frame insertion */
+  vtkSmartPointer<vtkPlusVolumeReconstructor> SnapshotVolumeReconstructor;
+
+  /*! Configuration of the live reconstructor that the snapshot reconstructor is configured with */
+  std::string SnapshotVolumeReconstructorConfiguration;
+
+  /*!
+    If true then the configuration of the live reconstructor may have changed since the previous snapshot and it is
+    compared to SnapshotVolumeReconstructorConfiguration at the next snapshot. Set by all methods that configure the live reconstructor.
+  */
+  bool SnapshotConfigurationModified;
+
+  /*! Bricks of the volume that were modified by inserted frames since the last snapshot */
+  PlusVolumeBrickGrid SnapshotModifiedBricks;
+
+  /*! If true then the whole volume is copied at the next snapshot (e.g., after the volume was cleared) */
+  bool SnapshotFullCopyRequired;
+
+  /*! Serializes snapshot requests, locked while hole filling and extraction run on the snapshot */
+  vtkSmartPointer<vtkIGSIORecursiveCriticalSection> SnapshotAccessMutex;
+
+  /*! Gray levels with hole filling of the snapshot at the previous hole filled volume request */
+  vtkSmartPointer<vtkImageData> HoleFilledVolume;
+
+  /*! If false then the whole HoleFilledVolume has to be computed again */
+  bool HoleFilledVolumeValid;
+
+  /*! Bricks of the snapshot that were modified since HoleFilledVolume was updated */
+  PlusVolumeBrickGrid HoleFillingModifiedBricks;
+
+  /*! Radius of the neighborhood that hole filling reads around a voxel, -1 if not known (then the whole volume is filled) */
+  int HoleFillingKernelRadius;
+
+  /*! Reconstructor that hole filling of the modified regions runs in */
+  vtkSmartPointer<vtkPlusVolumeReconstructor> HoleFillingRegionReconstructor;
+
+  /*! Downsampled snapshot at the previous preview request */
+  vtkSmartPointer<vtkImageData> PreviewVolume;
+
+  /*! If false then the whole PreviewVolume has to be computed again */
+  bool PreviewVolumeValid;
+
+  /*! Bricks of the snapshot that were modified since PreviewVolume was updated */
+  PlusVolumeBrickGrid PreviewModifiedBricks;
+
 private:
   vtkPlusVirtualVolumeReconstructor(const vtkPlusVirtualVolumeReconstructor&);   // Not implemented.
   void operator=(const vtkPlusVirtualVolumeReconstructor&);   // Not implemented.
@@ -11,6 +11,9 @@ See License.txt for details.
 #include "vtkPlusBuffer.h"
 #include "vtkPlusDevice.h"
 #include "vtkPlusSequenceIO.h"
+#include "vtkPlusTrackingSequenceIO.h"
+#include "vtkIGSIOSequenceIO.h"
+#include "vtkIGSIOSequenceIOBase.h"
 #include "vtkIGSIOTrackedFrameList.h"
 
 // VTK includes
@@ -25,8 +28,49 @@ See License.txt for details.
 // vtkAddon includes
 #include <vtkStreamingVolumeCodec.h>
 
+// STL includes
+#include <algorithm>
+
 static const double NEGLIGIBLE_TIME_DIFFERENCE = 0.00001; // in seconds, used for comparing between exact timestamps
 static const double ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG = 10; // if the interpolated orientation differs from both the interpolated orientation by more than this threshold then display a warning
+static const unsigned int SNAPSHOT_WRITE_CHUNK_SIZE = 50; // number of frames that are copied out of the buffer before they are written to file
+static const int ENCODED_IMAGE_BLOCK_SIZE_BYTES = 128 * 1024; // size of the block of converted rows that is transposed at once when inserting encoded images, fits into the L2 cache
+static const int ENCODED_IMAGE_MIN_BLOCK_ROWS = 16; // minimum number of rows in a transposed block, to have long enough runs for the vectorized pixel conversion
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Returns 0 if the encoding cannot be converted by vtkPlusBuffer
+  int GetEncodedBytesPerPixel(PixelCodec::PixelEncoding encoding)
+  {
+    switch (encoding)
+    {
+      case PixelCodec::PixelEncoding_YUY2:
+        return 2;
+      case PixelCodec::PixelEncoding_RGB24:
+      case PixelCodec::PixelEncoding_BGR24:
+        return 3;
+      case PixelCodec::PixelEncoding_RGBA32:
+        return 4;
+      default:
+        return 0;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Converts pixels to grayscale (1 output component) or RGB (3 output components), same way as the video devices decode frames
+  void ConvertPixelRun(PixelCodec::PixelEncoding encoding, unsigned int outputComponents, const unsigned char* s, int numberOfPixels, unsigned char* d)
+  {
+    if (outputComponents == 1)
+    {
+      PixelCodec::ConvertToGray(encoding, numberOfPixels, 1, const_cast<unsigned char*>(s), d);
+    }
+    else
+    {
+      PixelCodec::ConvertToBmp24(PixelCodec::ComponentOrder_RGB, encoding, numberOfPixels, 1, const_cast<unsigned char*>(s), d);
+    }
+  }
+}
 
 vtkStandardNewMacro(vtkPlusBuffer);
 
@@ -84,11 +128,20 @@ vtkPlusBuffer::vtkPlusBuffer()
   , StreamBuffer(vtkPlusTimestampedCircularBuffer::New())
   , MaxAllowedTimeDifference(0.5)
   , DescriptiveName(NULL)
+  , FrameHashing(false)
+  , EncodedImageMappingIsAffine(false)
+  , EncodedImageMappingFirstPixelIndex(0)
 {
   this->FrameSize[0] = 0;
   this->FrameSize[1] = 0;
   this->FrameSize[2] = 1; // by default we assume we have a single-slice image
 
+  for (int axis = 0; axis < 3; axis++)
+  {
+    this->EncodedImageMappingAxisSize[axis] = 1;
+    this->EncodedImageMappingAxisStride[axis] = 0;
+  }
+
   // 150 is a reasonable default value, it means that we keep the last 5 secods of acquired data @30fps
   // (and last 2.5 seconds @60fps). It should be enough to have all the needed data available and
   // it does not consume too much memory, even for images.
@@ -113,6 +166,7 @@ void vtkPlusBuffer::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Scalar pixel type: " << vtkImageScalarTypeNameMacro(this->GetPixelType()) << std::endl;
   os << indent << "Image type: " << igsioCommon::GetStringFromUsImageType(this->GetImageType()) << std::endl;
   os << indent << "Image orientation: " << igsioCommon::GetStringFromUsImageOrientation(this->GetImageOrientation()) << std::endl;
+  os << indent << "Frame hashing: " << (this->FrameHashing ? "enabled" : "disabled") << std::endl;
 
   os << indent << "StreamBuffer: " << this->StreamBuffer << "\n";
   if (this->StreamBuffer)
@@ -398,6 +452,62 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
                                   double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/,
                                   const igsioFieldMapType* customFields /*= NULL */,
                                   vtkStreamingVolumeFrame* encodedFrame /*=NULL*/)
+{
+  return this->AddImageItem(imageDataPtr, false, PixelCodec::PixelEncoding_ERROR, usImageOrientation, inputFrameSizeInPx, pixelType, numberOfScalarComponents, imageType,
+                            numberOfBytesToSkip, frameNumber, clipRectangleOrigin, clipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields, encodedFrame);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
+                                  PixelCodec::PixelEncoding inputEncoding,
+                                  US_IMAGE_ORIENTATION usImageOrientation,
+                                  const FrameSizeType& inputFrameSizeInPx,
+                                  US_IMAGE_TYPE imageType,
+                                  long frameNumber,
+                                  const std::array<int, 3>& clipRectangleOrigin,
+                                  const std::array<int, 3>& clipRectangleSize,
+                                  double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/,
+                                  double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/,
+                                  const igsioFieldMapType* customFields /*= NULL */)
+{
+  if (GetEncodedBytesPerPixel(inputEncoding) == 0)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add frame to video buffer - " << PixelCodec::GetCompressionModeAsString(inputEncoding)
+                    << " pixel encoding is not supported (supported encodings: YUY2, RGB24, BGR24, RGBA32)");
+    return PLUS_FAIL;
+  }
+  if (this->PixelType != VTK_UNSIGNED_CHAR || (this->NumberOfScalarComponents != 1 && this->NumberOfScalarComponents != 3))
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add encoded frame to video buffer - buffer pixel format must be unsigned char with 1 (grayscale) or 3 (RGB) components");
+    return PLUS_FAIL;
+  }
+  if (inputEncoding == PixelCodec::PixelEncoding_YUY2 && inputFrameSizeInPx[0] % 2 != 0)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add frame to video buffer - width of YUY2 encoded frames must be even (width: " << inputFrameSizeInPx[0] << ")");
+    return PLUS_FAIL;
+  }
+
+  return this->AddImageItem(imageDataPtr, true, inputEncoding, usImageOrientation, inputFrameSizeInPx, VTK_UNSIGNED_CHAR, this->NumberOfScalarComponents, imageType,
+                            0, frameNumber, clipRectangleOrigin, clipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields, NULL);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::AddImageItem(void* imageDataPtr,
+                                       bool convertPixels,
+                                       PixelCodec::PixelEncoding inputEncoding,
+                                       US_IMAGE_ORIENTATION usImageOrientation,
+                                       const FrameSizeType& inputFrameSizeInPx,
+                                       igsioCommon::VTKScalarPixelType pixelType,
+                                       unsigned int numberOfScalarComponents,
+                                       US_IMAGE_TYPE imageType,
+                                       int numberOfBytesToSkip,
+                                       long frameNumber,
+                                       const std::array<int, 3>& clipRectangleOrigin,
+                                       const std::array<int, 3>& clipRectangleSize,
+                                       double unfilteredTimestamp,
+                                       double filteredTimestamp,
+                                       const igsioFieldMapType* customFields,
+                                       vtkStreamingVolumeFrame* encodedFrame)
 {
   if (unfilteredTimestamp == UNDEFINED_TIMESTAMP)
   {
@@ -500,7 +610,15 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
     unsigned char* byteImageDataPtr = reinterpret_cast<unsigned char*>(imageDataPtr);
     byteImageDataPtr += numberOfBytesToSkip;
 
-    if (igsioVideoFrame::GetOrientedClippedImage(byteImageDataPtr, flipInfo, imageType, pixelType, numberOfScalarComponents, inputFrameSizeInPx, newObjectInBuffer->GetFrame(), clipRectangleOrigin, clipRectangleSize) != PLUS_SUCCESS)
+    if (convertPixels)
+    {
+      if (this->CopyEncodedImage(byteImageDataPtr, inputEncoding, inputFrameSizeInPx, flipInfo, imageType, clipRectangleOrigin, clipRectangleSize, newObjectInBuffer->GetFrame()) != PLUS_SUCCESS)
+      {
+        LOCAL_LOG_ERROR("Failed to convert input " << PixelCodec::GetCompressionModeAsString(inputEncoding) << " image to the buffer pixel format and orientation!");
+        return PLUS_FAIL;
+      }
+    }
+    else if (igsioVideoFrame::GetOrientedClippedImage(byteImageDataPtr, flipInfo, imageType, pixelType, numberOfScalarComponents, inputFrameSizeInPx, newObjectInBuffer->GetFrame(), clipRectangleOrigin, clipRectangleSize) != PLUS_SUCCESS)
     {
       LOCAL_LOG_ERROR("Failed to convert input US image to the requested orientation!");
       return PLUS_FAIL;
@@ -531,9 +649,275 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
     }
   }
 
+  if (this->FrameHashing)
+  {
+    if (imageDataPtr != NULL)
+    {
+      // Hash the stored (clipped and reoriented) frame, that is what consumers of the buffer receive
+      newObjectInBuffer->SetFrameField(vtkPlusSequenceIO::FRAME_HASH_FIELD_NAME, PlusCommon::GetFrameHashString(newObjectInBuffer->GetFrame()));
+    }
+    else
+    {
+      // The buffer item is reused, do not keep the hash of a previous frame
+      newObjectInBuffer->DeleteFrameField(vtkPlusSequenceIO::FRAME_HASH_FIELD_NAME);
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::CopyEncodedImage(const unsigned char* inputPixels, PixelCodec::PixelEncoding inputEncoding, const FrameSizeType& inputFrameSizeInPx,
+    const igsioVideoFrame::FlipInfoType& flipInfo, US_IMAGE_TYPE imageType,
+    const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize, igsioVideoFrame& outputFrame)
+{
+  FrameSizeType outputFrameSizeInPx = { 0, 0, 0 };
+  outputFrame.GetFrameSize(outputFrameSizeInPx);
+  if (this->UpdateEncodedImageMapping(inputFrameSizeInPx, flipInfo, imageType, clipRectangleOrigin, clipRectangleSize, outputFrameSizeInPx) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  const int bytesPerPixel = this->NumberOfScalarComponents;
+  if (!this->EncodedImageMappingIsAffine)
+  {
+    // The reorientation cannot be done by strides, convert the whole frame and let igsioVideoFrame reorient it
+    vtkIdType numberOfInputPixels = static_cast<vtkIdType>(inputFrameSizeInPx[0]) * inputFrameSizeInPx[1] * inputFrameSizeInPx[2];
+    this->EncodedImageScratch.resize(numberOfInputPixels * bytesPerPixel);
+    this->ConvertEncodedPixels(inputPixels, inputEncoding, 0, static_cast<int>(numberOfInputPixels), &this->EncodedImageScratch[0]);
+    return igsioVideoFrame::GetOrientedClippedImage(&this->EncodedImageScratch[0], flipInfo, imageType, VTK_UNSIGNED_CHAR, this->NumberOfScalarComponents,
+           inputFrameSizeInPx, outputFrame, clipRectangleOrigin, clipRectangleSize);
+  }
+
+  const int* size = this->EncodedImageMappingAxisSize;
+  const vtkIdType* stride = this->EncodedImageMappingAxisStride;
+  const vtkIdType outputRowBytes = static_cast<vtkIdType>(size[0]) * bytesPerPixel;
+  unsigned char* outputPixels = static_cast<unsigned char*>(outputFrame.GetScalarPointer());
+
+  // Rows that are reversed or transposed in the input are converted into a scratch buffer first
+  const bool transposeRowBlocks = (stride[0] != 1 && stride[0] != -1 && (stride[1] == 1 || stride[1] == -1));
+  int rowsPerBlock = 1;
+  if (transposeRowBlocks)
+  {
+    rowsPerBlock = std::max<int>(ENCODED_IMAGE_MIN_BLOCK_ROWS, ENCODED_IMAGE_BLOCK_SIZE_BYTES / outputRowBytes);
+    rowsPerBlock = std::min<int>(rowsPerBlock, size[1]);
+  }
+  this->EncodedImageScratch.resize(outputRowBytes * rowsPerBlock);
+  unsigned char* scratch = &this->EncodedImageScratch[0];
+
+  for (int z = 0; z < size[2]; z++)
+  {
+    const vtkIdType sliceFirstPixelIndex = this->EncodedImageMappingFirstPixelIndex + z * stride[2];
+    unsigned char* sliceOutputPixels = outputPixels + z * outputRowBytes * size[1];
+    if (!transposeRowBlocks)
+    {
+      for (int y = 0; y < size[1]; y++)
+      {
+        const vtkIdType rowFirstPixelIndex = sliceFirstPixelIndex + y * stride[1];
+        unsigned char* rowOutputPixels = sliceOutputPixels + y * outputRowBytes;
+        if (stride[0] == 1)
+        {
+          this->ConvertEncodedPixels(inputPixels, inputEncoding, rowFirstPixelIndex, size[0], rowOutputPixels);
+        }
+        else if (stride[0] == -1)
+        {
+          // Horizontal flip: convert the contiguous input row then copy the pixels in reverse order
+          this->ConvertEncodedPixels(inputPixels, inputEncoding, rowFirstPixelIndex - (size[0] - 1), size[0], scratch);
+          for (int x = 0; x < size[0]; x++)
+          {
+            memcpy(rowOutputPixels + x * bytesPerPixel, scratch + (size[0] - 1 - x) * bytesPerPixel, bytesPerPixel);
+          }
+        }
+        else
+        {
+          for (int x = 0; x < size[0]; x++)
+          {
+            this->ConvertEncodedPixels(inputPixels, inputEncoding, rowFirstPixelIndex + x * stride[0], 1, rowOutputPixels + x * bytesPerPixel);
+          }
+        }
+      }
+      continue;
+    }
+
+    // Transpose: output columns are contiguous in the input. Convert a block of output rows column by column
+    // into the scratch buffer, then write the output rows sequentially.
+    for (int blockFirstRow = 0; blockFirstRow < size[1]; blockFirstRow += rowsPerBlock)
+    {
+      const int numberOfRows = std::min<int>(rowsPerBlock, size[1] - blockFirstRow);
+      for (int x = 0; x < size[0]; x++)
+      {
+        vtkIdType runFirstPixelIndex = sliceFirstPixelIndex + x * stride[0] + blockFirstRow * stride[1];
+        if (stride[1] < 0)
+        {
+          runFirstPixelIndex -= numberOfRows - 1;
+        }
+        this->ConvertEncodedPixels(inputPixels, inputEncoding, runFirstPixelIndex, numberOfRows, scratch + x * rowsPerBlock * bytesPerPixel);
+      }
+      for (int row = 0; row < numberOfRows; row++)
+      {
+        const int scratchRow = (stride[1] > 0 ? row : numberOfRows - 1 - row);
+        unsigned char* rowOutputPixels = sliceOutputPixels + (blockFirstRow + row) * outputRowBytes;
+        for (int x = 0; x < size[0]; x++)
+        {
+          memcpy(rowOutputPixels + x * bytesPerPixel, scratch + (x * rowsPerBlock + scratchRow) * bytesPerPixel, bytesPerPixel);
+        }
+      }
+    }
+  }
+
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::UpdateEncodedImageMapping(const FrameSizeType& inputFrameSizeInPx, const igsioVideoFrame::FlipInfoType& flipInfo, US_IMAGE_TYPE imageType,
+    const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize, const FrameSizeType& outputFrameSizeInPx)
+{
+  std::vector<double> parameters;
+  parameters.push_back(imageType);
+  parameters.push_back(flipInfo.hFlip);
+  parameters.push_back(flipInfo.vFlip);
+  parameters.push_back(flipInfo.eFlip);
+  parameters.push_back(flipInfo.tranpose);
+  parameters.push_back(flipInfo.doubleRow);
+  parameters.push_back(flipInfo.doubleColumn);
+  for (int axis = 0; axis < 3; axis++)
+  {
+    parameters.push_back(inputFrameSizeInPx[axis]);
+    parameters.push_back(outputFrameSizeInPx[axis]);
+    parameters.push_back(clipRectangleOrigin[axis]);
+    parameters.push_back(clipRectangleSize[axis]);
+  }
+  if (parameters == this->EncodedImageMappingParameters)
+  {
+    return PLUS_SUCCESS;
+  }
+  this->EncodedImageMappingParameters.clear();
+
+  // Reorient an image that contains the index of each input pixel
+  const vtkIdType numberOfInputPixels = static_cast<vtkIdType>(inputFrameSizeInPx[0]) * inputFrameSizeInPx[1] * inputFrameSizeInPx[2];
+  std::vector<vtkTypeUInt32> inputPixelIndices(numberOfInputPixels);
+  for (vtkIdType i = 0; i < numberOfInputPixels; i++)
+  {
+    inputPixelIndices[i] = static_cast<vtkTypeUInt32>(i);
+  }
+  igsioVideoFrame mappingFrame;
+  if (mappingFrame.AllocateFrame(outputFrameSizeInPx, VTK_UNSIGNED_INT, 1) != PLUS_SUCCESS
+      || igsioVideoFrame::GetOrientedClippedImage(reinterpret_cast<unsigned char*>(&inputPixelIndices[0]), flipInfo, imageType, VTK_UNSIGNED_INT, 1,
+          inputFrameSizeInPx, mappingFrame, clipRectangleOrigin, clipRectangleSize) != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_ERROR("Failed to compute pixel mapping for the requested orientation and clipping");
+    return PLUS_FAIL;
+  }
+  FrameSizeType mappingFrameSize = { 0, 0, 0 };
+  mappingFrame.GetFrameSize(mappingFrameSize);
+  if (mappingFrameSize[0] != outputFrameSizeInPx[0] || mappingFrameSize[1] != outputFrameSizeInPx[1] || mappingFrameSize[2] != outputFrameSizeInPx[2])
+  {
+    LOCAL_LOG_ERROR("Failed to compute pixel mapping: reoriented frame size is different from buffer frame size");
+    return PLUS_FAIL;
+  }
+  const vtkTypeUInt32* outputPixelIndices = static_cast<const vtkTypeUInt32*>(mappingFrame.GetScalarPointer());
+
+  // Get the stride of each output axis from the neighbors of the first output pixel
+  const int outputSize[3] = { static_cast<int>(outputFrameSizeInPx[0]), static_cast<int>(outputFrameSizeInPx[1]), static_cast<int>(outputFrameSizeInPx[2]) };
+  const vtkIdType outputIncrement[3] = { 1, outputSize[0], static_cast<vtkIdType>(outputSize[0]) * outputSize[1] };
+  const vtkIdType firstPixelIndex = outputPixelIndices[0];
+  vtkIdType outputStride[3] = { 0, 0, 0 };
+  for (int axis = 0; axis < 3; axis++)
+  {
+    if (outputSize[axis] > 1)
+    {
+      outputStride[axis] = static_cast<vtkIdType>(outputPixelIndices[outputIncrement[axis]]) - firstPixelIndex;
+    }
+  }
+
+  // Check that all the pixels follow the strides (flips, transposes and clipping do, interleaved RF lines do not)
+  this->EncodedImageMappingIsAffine = true;
+  const vtkTypeUInt32* outputPixelIndex = outputPixelIndices;
+  for (int z = 0; z < outputSize[2] && this->EncodedImageMappingIsAffine; z++)
+  {
+    for (int y = 0; y < outputSize[1] && this->EncodedImageMappingIsAffine; y++)
+    {
+      const vtkIdType rowFirstPixelIndex = firstPixelIndex + z * outputStride[2] + y * outputStride[1];
+      for (int x = 0; x < outputSize[0]; x++, outputPixelIndex++)
+      {
+        if (*outputPixelIndex != rowFirstPixelIndex + x * outputStride[0])
+        {
+          this->EncodedImageMappingIsAffine = false;
+          break;
+        }
+      }
+    }
+  }
+
+  // Drop single-pixel axes and merge axes that are contiguous in the input, to have rows that are as long as possible
+  this->EncodedImageMappingFirstPixelIndex = firstPixelIndex;
+  int numberOfAxes = 0;
+  for (int axis = 0; axis < 3; axis++)
+  {
+    if (outputSize[axis] == 1)
+    {
+      continue;
+    }
+    if (numberOfAxes > 0 && outputStride[axis] == this->EncodedImageMappingAxisStride[numberOfAxes - 1] * this->EncodedImageMappingAxisSize[numberOfAxes - 1])
+    {
+      this->EncodedImageMappingAxisSize[numberOfAxes - 1] *= outputSize[axis];
+      continue;
+    }
+    this->EncodedImageMappingAxisSize[numberOfAxes] = outputSize[axis];
+    this->EncodedImageMappingAxisStride[numberOfAxes] = outputStride[axis];
+    numberOfAxes++;
+  }
+  for (int axis = numberOfAxes; axis < 3; axis++)
+  {
+    this->EncodedImageMappingAxisSize[axis] = 1;
+    this->EncodedImageMappingAxisStride[axis] = 0;
+  }
+  if (numberOfAxes == 0)
+  {
+    // Single pixel
+    this->EncodedImageMappingAxisStride[0] = 1;
+  }
+
+  LOCAL_LOG_DEBUG("Encoded image pixel mapping updated: " << (this->EncodedImageMappingIsAffine ? "" : "not ") << "affine, size: "
+                  << this->EncodedImageMappingAxisSize[0] << "x" << this->EncodedImageMappingAxisSize[1] << "x" << this->EncodedImageMappingAxisSize[2]
+                  << ", strides: " << this->EncodedImageMappingAxisStride[0] << ", " << this->EncodedImageMappingAxisStride[1] << ", " << this->EncodedImageMappingAxisStride[2]);
+  this->EncodedImageMappingParameters = parameters;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::ConvertEncodedPixels(const unsigned char* inputPixels, PixelCodec::PixelEncoding inputEncoding, vtkIdType firstPixelIndex, int numberOfPixels, unsigned char* outputPixels)
+{
+  const int inputBytesPerPixel = GetEncodedBytesPerPixel(inputEncoding);
+  const int outputBytesPerPixel = this->NumberOfScalarComponents;
+  if (inputEncoding != PixelCodec::PixelEncoding_YUY2)
+  {
+    ConvertPixelRun(inputEncoding, this->NumberOfScalarComponents, inputPixels + firstPixelIndex * inputBytesPerPixel, numberOfPixels, outputPixels);
+    return;
+  }
+
+  // YUY2 stores the chrominance of pixel pairs, a pair that is split by the start or end of the run is converted separately
+  unsigned char pixelPair[2 * 3];
+  if (numberOfPixels > 0 && firstPixelIndex % 2 != 0)
+  {
+    ConvertPixelRun(inputEncoding, this->NumberOfScalarComponents, inputPixels + (firstPixelIndex - 1) * inputBytesPerPixel, 2, pixelPair);
+    memcpy(outputPixels, pixelPair + outputBytesPerPixel, outputBytesPerPixel);
+    firstPixelIndex++;
+    numberOfPixels--;
+    outputPixels += outputBytesPerPixel;
+  }
+  const int numberOfPairedPixels = numberOfPixels & ~1;
+  if (numberOfPairedPixels > 0)
+  {
+    ConvertPixelRun(inputEncoding, this->NumberOfScalarComponents, inputPixels + firstPixelIndex * inputBytesPerPixel, numberOfPairedPixels, outputPixels);
+  }
+  if (numberOfPixels > numberOfPairedPixels)
+  {
+    ConvertPixelRun(inputEncoding, this->NumberOfScalarComponents, inputPixels + (firstPixelIndex + numberOfPairedPixels) * inputBytesPerPixel, 2, pixelPair);
+    memcpy(outputPixels + numberOfPairedPixels * outputBytesPerPixel, pixelPair, outputBytesPerPixel);
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frameSize, unsigned int inputFrameSizeInBytes, US_IMAGE_TYPE imageType, long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
@@ -621,6 +1005,10 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frame
   }
 
   newObjectInBuffer->SetFrameField("FrameSizeInBytes", igsioCommon::ToString<unsigned int>(inputFrameSizeInBytes));
+  if (this->FrameHashing)
+  {
+    newObjectInBuffer->SetFrameField(vtkPlusSequenceIO::FRAME_HASH_FIELD_NAME, PlusCommon::GetHashString(imageDataPtr, inputFrameSizeInBytes));
+  }
 
   return PLUS_SUCCESS;
 }
@@ -802,6 +1190,7 @@ void vtkPlusBuffer::DeepCopy(vtkPlusBuffer* buffer)
   this->SetImageType(buffer->GetImageType());
   this->SetNumberOfScalarComponents(buffer->GetNumberOfScalarComponents());
   this->SetImageOrientation(buffer->GetImageOrientation());
+  this->SetFrameHashing(buffer->GetFrameHashing());
   this->SetBufferSize(buffer->GetBufferSize());
 }
 
@@ -1080,6 +1469,9 @@ PlusStatus vtkPlusBuffer::WriteToSequenceFile(const char* filename, bool useComp
 
   PlusStatus status = PLUS_SUCCESS;
 
+  // Tracking-only files do not store images, so do not copy them out of the buffer
+  bool trackingOnlyFile = vtkPlusTrackingSequenceIO::CanWriteFile(filename);
+
   for (BufferItemUidType frameUid = this->GetOldestItemUidInBuffer(); frameUid <= this->GetLatestItemUidInBuffer(); ++frameUid)
   {
     StreamBufferItem bufferItem;
@@ -1091,40 +1483,7 @@ PlusStatus vtkPlusBuffer::WriteToSequenceFile(const char* filename, bool useComp
     }
 
     igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
-
-    // Add image data
-    trackedFrame->SetImageData(bufferItem.GetFrame());
-
-    // Add tracking data
-    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
-    bufferItem.GetMatrix(matrix);
-    trackedFrame->SetFrameTransform(igsioTransformName("Tool", "Tracker"), matrix);
-    trackedFrame->SetFrameTransformStatus(igsioTransformName("Tool", "Tracker"), bufferItem.GetStatus());
-
-    // Add filtered timestamp
-    double filteredTimestamp = bufferItem.GetFilteredTimestamp(this->GetLocalTimeOffsetSec());
-    std::ostringstream timestampFieldValue;
-    timestampFieldValue << std::fixed << filteredTimestamp;
-    trackedFrame->SetFrameField("Timestamp", timestampFieldValue.str());
-
-    // Add unfiltered timestamp
-    double unfilteredTimestamp = bufferItem.GetUnfilteredTimestamp(this->GetLocalTimeOffsetSec());
-    std::ostringstream unfilteredtimestampFieldValue;
-    unfilteredtimestampFieldValue << std::fixed << unfilteredTimestamp;
-    trackedFrame->SetFrameField("UnfilteredTimestamp", unfilteredtimestampFieldValue.str());
-
-    // Add frame number
-    unsigned long frameNumber = bufferItem.GetIndex();
-    std::ostringstream frameNumberFieldValue;
-    frameNumberFieldValue << std::fixed << frameNumber;
-    trackedFrame->SetFrameField("FrameNumber", frameNumberFieldValue.str());
-
-    // Add custom fields
-    const igsioFieldMapType& customFields = bufferItem.GetFrameFieldMap();
-    for (igsioFieldMapType::const_iterator cf = customFields.begin(); cf != customFields.end(); ++cf)
-    {
-      trackedFrame->SetFrameField(cf->first, cf->second.second, cf->second.first);
-    }
+    this->CopyStreamBufferItemToTrackedFrame(bufferItem, *trackedFrame, !trackingOnlyFile);
 
     // Add tracked frame to the list
     trackedFrameList->TakeTrackedFrame(trackedFrame);
@@ -1140,6 +1499,198 @@ PlusStatus vtkPlusBuffer::WriteToSequenceFile(const char* filename, bool useComp
   return status;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::WriteToSequenceFile(const char* filename, BufferItemUidType firstUid, BufferItemUidType lastUid,
+    bool useCompression /*=false*/, std::vector<BufferItemUidType>* lostItemUids /*=NULL*/)
+{
+  LOG_TRACE("vtkPlusBuffer::WriteToSequenceFile(" << filename << ", " << firstUid << ", " << lastUid << ")");
+
+  if (filename == NULL)
+  {
+    LOCAL_LOG_ERROR("Unable to write buffer snapshot: file name is not specified");
+    return PLUS_FAIL;
+  }
+
+  // Tracking-only files do not store images, so do not copy them out of the buffer
+  bool trackingOnlyFile = vtkPlusTrackingSequenceIO::CanWriteFile(filename);
+
+  vtkSmartPointer<vtkPlusTrackingSequenceIO> trackingWriter;
+  vtkIGSIOSequenceIOBase* writer = NULL;
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (trackingOnlyFile)
+  {
+    trackingWriter = vtkSmartPointer<vtkPlusTrackingSequenceIO>::New();
+    trackingWriter->SetFileName(filename);
+    trackingWriter->SetUseCompression(useCompression);
+    if (trackingWriter->OpenForWriting() != PLUS_SUCCESS)
+    {
+      LOCAL_LOG_ERROR("Failed to open file for writing: " << filename);
+      return PLUS_FAIL;
+    }
+  }
+  else
+  {
+    writer = vtkIGSIOSequenceIO::CreateSequenceHandlerForFile(filename);
+    if (writer == NULL)
+    {
+      LOCAL_LOG_ERROR("Could not create writer for file: " << filename);
+      return PLUS_FAIL;
+    }
+    writer->SetUseCompression(useCompression);
+    writer->SetTrackedFrameList(trackedFrameList);
+    writer->SetFileName(filename);
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  bool headerPrepared = false;
+  bool isData3D = false;
+  unsigned int numberOfWrittenFrames = 0;
+  BufferItemUidType numberOfLostItems = 0;
+
+  // The buffer is only locked while a single item is copied, images are written without holding the lock.
+  // If acquisition is faster than writing then the oldest items of the range are overwritten before they are reached.
+  for (BufferItemUidType frameUid = firstUid; frameUid <= lastUid && status == PLUS_SUCCESS; ++frameUid)
+  {
+    StreamBufferItem bufferItem;
+    ItemStatus itemStatus = ITEM_NOT_AVAILABLE_ANYMORE;
+    if (frameUid >= this->GetOldestItemUidInBuffer())
+    {
+      itemStatus = this->GetStreamBufferItem(frameUid, &bufferItem);
+    }
+    if (itemStatus == ITEM_NOT_AVAILABLE_ANYMORE)
+    {
+      ++numberOfLostItems;
+      if (lostItemUids != NULL)
+      {
+        lostItemUids->push_back(frameUid);
+      }
+      continue;
+    }
+    else if (itemStatus != ITEM_OK)
+    {
+      LOCAL_LOG_ERROR("Unable to get frame from buffer with UID: " << frameUid);
+      continue;
+    }
+
+    igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
+    this->CopyStreamBufferItemToTrackedFrame(bufferItem, *trackedFrame, !trackingOnlyFile);
+    trackedFrameList->TakeTrackedFrame(trackedFrame);
+
+    if (trackedFrameList->GetNumberOfTrackedFrames() < SNAPSHOT_WRITE_CHUNK_SIZE && frameUid < lastUid)
+    {
+      continue;
+    }
+
+    // Write the chunk and release the copied frames
+    numberOfWrittenFrames += trackedFrameList->GetNumberOfTrackedFrames();
+    if (trackingWriter != NULL)
+    {
+      status = trackingWriter->AppendFrames(trackedFrameList);
+    }
+    else
+    {
+      if (!headerPrepared)
+      {
+        isData3D = (trackedFrameList->GetTrackedFrame(0)->GetFrameSize()[2] > 1);
+        status = writer->PrepareHeader();
+        headerPrepared = (status == PLUS_SUCCESS);
+      }
+      if (status == PLUS_SUCCESS)
+      {
+        status = writer->AppendImagesToHeader();
+      }
+      if (status == PLUS_SUCCESS)
+      {
+        status = writer->WriteImages();
+      }
+    }
+    trackedFrameList->Clear();
+  }
+
+  if (status != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_ERROR("Failed to write buffer snapshot to " << filename);
+  }
+
+  if (numberOfLostItems > 0)
+  {
+    LOCAL_LOG_WARNING(numberOfLostItems << " of " << lastUid - firstUid + 1 << " items were overwritten in the buffer before they could be written to " << filename);
+  }
+
+  if (trackingWriter != NULL)
+  {
+    if (trackingWriter->Close() != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+    return status;
+  }
+
+  if (!headerPrepared)
+  {
+    // Nothing could be written, the file has not been created
+    writer->Delete();
+    if (firstUid <= lastUid)
+    {
+      LOCAL_LOG_ERROR("No frames could be written to " << filename);
+      return PLUS_FAIL;
+    }
+    // Empty range, write an empty sequence as the list-based writer does
+    return vtkPlusSequenceIO::Write(filename, trackedFrameList, trackedFrameList->GetImageOrientation(), useCompression);
+  }
+
+  // Fix the header to contain the number of frames that were actually written
+  writer->UpdateDimensionsCustomStrings(numberOfWrittenFrames, isData3D);
+  writer->UpdateFieldInImageHeader(writer->GetDimensionSizeString());
+  writer->UpdateFieldInImageHeader(writer->GetDimensionKindsString());
+  writer->FinalizeHeader();
+  writer->Close();
+  writer->Delete();
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::CopyStreamBufferItemToTrackedFrame(StreamBufferItem& bufferItem, igsioTrackedFrame& trackedFrame, bool copyImageData)
+{
+  // Add image data
+  if (copyImageData)
+  {
+    trackedFrame.SetImageData(bufferItem.GetFrame());
+  }
+
+  // Add tracking data
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  bufferItem.GetMatrix(matrix);
+  trackedFrame.SetFrameTransform(igsioTransformName("Tool", "Tracker"), matrix);
+  trackedFrame.SetFrameTransformStatus(igsioTransformName("Tool", "Tracker"), bufferItem.GetStatus());
+
+  // Add filtered timestamp
+  double filteredTimestamp = bufferItem.GetFilteredTimestamp(this->GetLocalTimeOffsetSec());
+  std::ostringstream timestampFieldValue;
+  timestampFieldValue << std::fixed << filteredTimestamp;
+  trackedFrame.SetFrameField("Timestamp", timestampFieldValue.str());
+
+  // Add unfiltered timestamp
+  double unfilteredTimestamp = bufferItem.GetUnfilteredTimestamp(this->GetLocalTimeOffsetSec());
+  std::ostringstream unfilteredtimestampFieldValue;
+  unfilteredtimestampFieldValue << std::fixed << unfilteredTimestamp;
+  trackedFrame.SetFrameField("UnfilteredTimestamp", unfilteredtimestampFieldValue.str());
+
+  // Add frame number
+  unsigned long frameNumber = bufferItem.GetIndex();
+  std::ostringstream frameNumberFieldValue;
+  frameNumberFieldValue << std::fixed << frameNumber;
+  trackedFrame.SetFrameField("FrameNumber", frameNumberFieldValue.str());
+
+  // Add custom fields
+  const igsioFieldMapType& customFields = bufferItem.GetFrameFieldMap();
+  for (igsioFieldMapType::const_iterator cf = customFields.begin(); cf != customFields.end(); ++cf)
+  {
+    trackedFrame.SetFrameField(cf->first, cf->second.second, cf->second.first);
+  }
+}
+
 //-----------------------------------------------------------------------------
 void vtkPlusBuffer::SetTimeStampReporting(bool enable)
 {
@@ -16,6 +16,7 @@ See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
 
 // Local includes
 #include "igsioCommon.h"
+#include "PixelCodec.h"
 #include "PlusConfigure.h"
 #include "vtkPlusDataCollectionExport.h"
 #include "PlusStreamBufferItem.h"
@@ -26,6 +27,10 @@ See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
 // VTK includes
 #include <vtkObject.h>
 
+// STL includes
+#include <vector>
+
+class igsioTrackedFrame;
 class vtkPlusDevice;
 enum ToolStatus;
 
@@ -115,6 +120,28 @@ public:
                              const igsioFieldMapType* customFields = NULL,
                              vtkStreamingVolumeFrame* encodedFrame = NULL);
 
+  /*!
+    Add a frame that is stored in a camera pixel encoding (YUY2, RGB24, BGR24 or RGBA32) to the buffer.
+    The pixels are converted to the pixel format of the buffer (grayscale if the buffer has 1 scalar component,
+    RGB if it has 3), clipped and reoriented in a single pass, directly into the buffer item.
+    MJPG encoded frames have to be decoded by the caller.
+    If the timestamp is less than or equal to the previous timestamp,
+    or if the frame's format doesn't match the buffer's frame format,
+    then the frame is not added to the buffer. If a clip rectangle is defined
+    then only that portion of the image is extracted.
+  */
+  virtual PlusStatus AddItem(void* imageDataPtr,
+                             PixelCodec::PixelEncoding inputEncoding,
+                             US_IMAGE_ORIENTATION usImageOrientation,
+                             const FrameSizeType& inputFrameSizeInPx,
+                             US_IMAGE_TYPE imageType,
+                             long frameNumber,
+                             const std::array<int, 3>& clipRectangleOrigin,
+                             const std::array<int, 3>& clipRectangleSize,
+                             double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
+                             double filteredTimestamp = UNDEFINED_TIMESTAMP,
+                             const igsioFieldMapType* customFields = NULL);
+
   /*!
     Add a frame plus a timestamp to the buffer with frame index.
     Additionally an optional field name&value can be added,
@@ -314,9 +341,28 @@ public:
   /*! Dump the current state of the video buffer to metafile */
   virtual PlusStatus WriteToSequenceFile(const char* filename, bool useCompression = false);
 
+  /*!
+    Write the items in the [firstUid, lastUid] range to a sequence file while acquisition continues.
+    Items are copied out of the buffer one by one (the buffer is only locked while an item is copied)
+    and written in small chunks, so the device threads are not blocked while the file is written.
+    Items that are overwritten in the buffer before they could be copied are skipped and their UIDs
+    are appended to lostItemUids (if not NULL).
+  */
+  virtual PlusStatus WriteToSequenceFile(const char* filename, BufferItemUidType firstUid, BufferItemUidType lastUid,
+                                         bool useCompression = false, std::vector<BufferItemUidType>* lostItemUids = NULL);
+
   vtkGetStringMacro(DescriptiveName);
   vtkSetStringMacro(DescriptiveName);
 
+  /*!
+    If enabled then a hash of the pixel data is computed for each added image and stored in the
+    FrameHash frame field (see vtkPlusSequenceIO::FRAME_HASH_FIELD_NAME). Identical frames have identical hashes,
+    which allows recorders to detect and skip repeated frames.
+  */
+  vtkSetMacro(FrameHashing, bool);
+  vtkGetMacro(FrameHashing, bool);
+  vtkBooleanMacro(FrameHashing, bool);
+
 protected:
   vtkPlusBuffer();
   ~vtkPlusBuffer();
@@ -346,6 +392,50 @@ protected:
   /*! Get tracker buffer item from the closest timestamp */
   virtual ItemStatus GetStreamBufferItemFromClosestTime(double time, StreamBufferItem* bufferItem);
 
+  /*! Copy image (if copyImageData is true), transform, timestamps and frame fields of a buffer item into a tracked frame */
+  virtual void CopyStreamBufferItemToTrackedFrame(StreamBufferItem& bufferItem, igsioTrackedFrame& trackedFrame, bool copyImageData);
+
+  /*!
+    Common implementation of the AddItem methods that add an image from a memory pointer.
+    If convertPixels is true then the input pixels are stored in inputEncoding and they are converted to the buffer pixel format while copying.
+  */
+  PlusStatus AddImageItem(void* imageDataPtr,
+                          bool convertPixels,
+                          PixelCodec::PixelEncoding inputEncoding,
+                          US_IMAGE_ORIENTATION usImageOrientation,
+                          const FrameSizeType& inputFrameSizeInPx,
+                          igsioCommon::VTKScalarPixelType pixelType,
+                          unsigned int numberOfScalarComponents,
+                          US_IMAGE_TYPE imageType,
+                          int numberOfBytesToSkip,
+                          long frameNumber,
+                          const std::array<int, 3>& clipRectangleOrigin,
+                          const std::array<int, 3>& clipRectangleSize,
+                          double unfilteredTimestamp,
+                          double filteredTimestamp,
+                          const igsioFieldMapType* customFields,
+                          vtkStreamingVolumeFrame* encodedFrame);
+
+  /*!
+    Convert, clip and reorient an encoded input frame into a buffer frame in a single pass.
+    Rows are converted directly into the output if the reorientation keeps them contiguous,
+    otherwise small blocks of rows are converted into a scratch buffer and transposed from there.
+  */
+  PlusStatus CopyEncodedImage(const unsigned char* inputPixels, PixelCodec::PixelEncoding inputEncoding, const FrameSizeType& inputFrameSizeInPx,
+                              const igsioVideoFrame::FlipInfoType& flipInfo, US_IMAGE_TYPE imageType,
+                              const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize, igsioVideoFrame& outputFrame);
+
+  /*!
+    Compute the input pixel index of each output pixel for the specified reorientation and clipping.
+    The mapping is obtained by reorienting an image of pixel indices with igsioVideoFrame, so it always matches
+    the reorientation of GetOrientedClippedImage. The result is cached, it is only recomputed if the parameters change.
+  */
+  PlusStatus UpdateEncodedImageMapping(const FrameSizeType& inputFrameSizeInPx, const igsioVideoFrame::FlipInfoType& flipInfo, US_IMAGE_TYPE imageType,
+                                       const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize, const FrameSizeType& outputFrameSizeInPx);
+
+  /*! Convert numberOfPixels consecutive input pixels, starting at firstPixelIndex, to the buffer pixel format */
+  void ConvertEncodedPixels(const unsigned char* inputPixels, PixelCodec::PixelEncoding inputEncoding, vtkIdType firstPixelIndex, int numberOfPixels, unsigned char* outputPixels);
+
 protected:
   /*! Image frame size in pixel */
   FrameSizeType FrameSize;
@@ -371,6 +461,27 @@ protected:
 
   char* DescriptiveName;
 
+  /*! Compute the FrameHash field for each added image */
+  bool FrameHashing;
+
+  /*! Parameters (input size, flip, clipping) that the current encoded image mapping was computed for */
+  std::vector<double> EncodedImageMappingParameters;
+
+  /*! If false then the output pixel positions cannot be described by strides (e.g., interleaved RF lines) and the converted frame is reoriented by igsioVideoFrame */
+  bool EncodedImageMappingIsAffine;
+
+  /*! Input pixel index of the first output pixel */
+  vtkIdType EncodedImageMappingFirstPixelIndex;
+
+  /*! Output frame size along each axis, after merging axes that are contiguous in the input */
+  int EncodedImageMappingAxisSize[3];
+
+  /*! Input pixel index increment along each output axis */
+  vtkIdType EncodedImageMappingAxisStride[3];
+
+  /*! Temporary storage for reversed rows and transposed row blocks while copying encoded images */
+  std::vector<unsigned char> EncodedImageScratch;
+
 private:
   vtkPlusBuffer(const vtkPlusBuffer&);
   void operator=(const vtkPlusBuffer&);
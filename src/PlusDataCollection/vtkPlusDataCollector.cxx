@@ -13,6 +13,7 @@ See License.txt for details.
 #include "vtkPlusDevice.h"
 #include "vtkPlusDeviceFactory.h"
 #include "vtkPlusSavedDataSource.h"
+#include "vtkPlusTrackingSequenceIO.h"
 
 // vtkAddon includes
 #include <vtkStreamingVolumeCodecFactory.h>
@@ -43,6 +44,8 @@ vtkPlusDataCollector::vtkPlusDataCollector()
   , DeviceFactory(vtkSmartPointer<vtkPlusDeviceFactory>::New())
   , Connected(false)
   , Started(false)
+  , BufferDumpInProgress(false)
+  , BufferDumpStatus(PLUS_SUCCESS)
 {
   vtkStreamingVolumeCodecFactory* factory = vtkStreamingVolumeCodecFactory::GetInstance();
 #if defined PLUS_USE_VP9
@@ -55,6 +58,7 @@ vtkPlusDataCollector::vtkPlusDataCollector()
 vtkPlusDataCollector::~vtkPlusDataCollector()
 {
   LOG_TRACE("vtkPlusDataCollector::~vtkPlusDataCollector()");
+  this->WaitForBufferDump();
   if (this->Started)
   {
     this->Stop();
@@ -392,6 +396,9 @@ PlusStatus vtkPlusDataCollector::Disconnect()
 {
   LOG_TRACE("vtkPlusDataCollector::Disconnect()");
 
+  // Buffers are not available after disconnection, finish writing them first
+  this->WaitForBufferDump();
+
   PlusStatus status = PLUS_SUCCESS;
 
   for (DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it)
@@ -474,30 +481,120 @@ bool vtkPlusDataCollector::GetConnected() const
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataCollector::DumpBuffersToDirectory(const char* aDirectory)
 {
-  LOG_TRACE("vtkPlusDataCollector::DumpBuffersToDirectory(" << aDirectory << ")");
+  LOG_TRACE("vtkPlusDataCollector::DumpBuffersToDirectory(" << (aDirectory ? aDirectory : "") << ")");
+
+  if (this->StartDumpBuffersToDirectory(aDirectory) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  return this->WaitForBufferDump();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::StartDumpBuffersToDirectory(const char* aDirectory)
+{
+  LOG_TRACE("vtkPlusDataCollector::StartDumpBuffersToDirectory(" << (aDirectory ? aDirectory : "") << ")");
+
+  if (this->IsDumpingBuffers())
+  {
+    LOG_ERROR("Unable to start buffer dump: a previous buffer dump is still in progress");
+    return PLUS_FAIL;
+  }
+  // Join the thread of the previous (completed) dump
+  this->WaitForBufferDump();
 
   // Assemble file names
   std::string dateAndTime = vtksys::SystemTools::GetCurrentDateTime("%Y%m%d_%H%M%S");
 
+  // Freeze the item ranges now, the items are copied out of the buffers later by the dump thread
+  this->BufferDumpJobs.clear();
+  std::set<vtkPlusDataSource*> dumpedSources;
   for (DeviceCollectionIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
   {
     vtkPlusDevice* device = *it;
+    std::vector<vtkPlusDataSource*> sources = device->GetVideoSources();
+    for (DataSourceContainerConstIterator toolIt = device->GetToolIteratorBegin(); toolIt != device->GetToolIteratorEnd(); ++toolIt)
+    {
+      sources.push_back(toolIt->second);
+    }
 
-    std::string outputDeviceBufferSequenceFileName = vtkPlusConfig::GetInstance()->GetOutputPath(std::string("BufferDump_") + device->GetDeviceId() + "_" + dateAndTime + ".nrrd");
-
-    LOG_INFO("Write device buffer to " << outputDeviceBufferSequenceFileName);
-    vtkPlusDataSource* aSource(NULL);
-    for (ChannelContainerIterator chanIt = device->GetOutputChannelsStart(); chanIt != device->GetOutputChannelsEnd(); ++chanIt)
+    for (std::vector<vtkPlusDataSource*>::iterator sourceIt = sources.begin(); sourceIt != sources.end(); ++sourceIt)
     {
-      if ((*chanIt)->GetVideoSource(aSource) != PLUS_SUCCESS)
+      vtkPlusDataSource* source = *sourceIt;
+      // Virtual devices may share sources with other devices
+      if (source == NULL || !dumpedSources.insert(source).second || source->GetNumberOfItems() < 1)
       {
-        LOG_ERROR("Unable to retrieve the video source in the device.");
-        return PLUS_FAIL;
+        continue;
       }
-      aSource->WriteToSequenceFile(outputDeviceBufferSequenceFileName.c_str(), false);
+
+      std::string fileName = std::string("BufferDump_") + device->GetDeviceId() + "_" + source->GetSourceId() + "_" + dateAndTime
+                             + (source->GetType() == DATA_SOURCE_TYPE_TOOL ? vtkPlusTrackingSequenceIO::GetFileExtension() : std::string(".nrrd"));
+
+      BufferDumpJob job;
+      job.Source = source;
+      job.FileName = (aDirectory != NULL && strlen(aDirectory) > 0) ? std::string(aDirectory) + "/" + fileName : vtkPlusConfig::GetInstance()->GetOutputPath(fileName);
+      job.FirstUid = source->GetBuffer()->GetOldestItemUidInBuffer();
+      job.LastUid = source->GetBuffer()->GetLatestItemUidInBuffer();
+      this->BufferDumpJobs.push_back(job);
     }
   }
 
+  this->BufferDumpStatus = PLUS_SUCCESS;
+  this->BufferDumpInProgress = true;
+  this->BufferDumpThread = std::thread(&vtkPlusDataCollector::WriteBufferDumpJobs, this);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::WriteBufferDumpJobs()
+{
+  PlusStatus status = PLUS_SUCCESS;
+  for (std::vector<BufferDumpJob>::iterator job = this->BufferDumpJobs.begin(); job != this->BufferDumpJobs.end(); ++job)
+  {
+    LOG_INFO("Write buffer of " << job->Source->GetSourceId() << " to " << job->FileName);
+    if (job->Source->GetBuffer()->WriteToSequenceFile(job->FileName.c_str(), job->FirstUid, job->LastUid, false, &job->LostItemUids) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to write buffer of " << job->Source->GetSourceId() << " to " << job->FileName);
+      status = PLUS_FAIL;
+    }
+  }
+  this->BufferDumpStatus = status;
+  this->BufferDumpInProgress = false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDataCollector::IsDumpingBuffers() const
+{
+  return this->BufferDumpInProgress;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::WaitForBufferDump()
+{
+  if (this->BufferDumpThread.joinable())
+  {
+    this->BufferDumpThread.join();
+  }
+  return this->BufferDumpStatus;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::GetBufferDumpLostItemUids(std::map<std::string, std::vector<BufferItemUidType> >& lostItemUids)
+{
+  lostItemUids.clear();
+  if (this->IsDumpingBuffers())
+  {
+    LOG_ERROR("Lost items are not available until the buffer dump is completed");
+    return PLUS_FAIL;
+  }
+  for (std::vector<BufferDumpJob>::const_iterator job = this->BufferDumpJobs.begin(); job != this->BufferDumpJobs.end(); ++job)
+  {
+    if (!job->LostItemUids.empty())
+    {
+      lostItemUids[job->FileName] = job->LostItemUids;
+    }
+  }
   return PLUS_SUCCESS;
 }
 
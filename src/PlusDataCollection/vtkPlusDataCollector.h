@@ -15,6 +15,12 @@ See License.txt for details.
 // VTK includes
 #include <vtkObject.h>
 
+// STL includes
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
 //class igsioTrackedFrame; 
 class vtkPlusChannel;
 class vtkPlusDeviceFactory;
@@ -113,12 +119,34 @@ public:
   DeviceCollectionConstIterator GetDeviceConstIteratorEnd() const;
 
   /*!
-    Have each device dump their buffers to disk
-    \param aDirectory directory to dump to
-    \param maxTimeLimitSec Maximum time spent in the function (in sec)
+    Have each device dump their buffers to disk. Returns when all files are written.
+    \param aDirectory directory to dump to (the output directory is used if empty)
   */
   PlusStatus DumpBuffersToDirectory(const char* aDirectory);
 
+  /*!
+    Start dumping the buffers of each device to disk in a background thread and return immediately.
+    Only the items that are in the buffers at the time of the call are written. Items are copied
+    out of the buffers while they are written, therefore acquisition is not interrupted, but items
+    that are overwritten before they could be copied are missing from the files
+    (see GetBufferDumpLostItemUids).
+    Image sources are written to NRRD files, tool sources to tracking sequence files.
+    \param aDirectory directory to dump to (the output directory is used if empty)
+  */
+  PlusStatus StartDumpBuffersToDirectory(const char* aDirectory);
+
+  /*! Returns true while a buffer dump started by StartDumpBuffersToDirectory is in progress */
+  bool IsDumpingBuffers() const;
+
+  /*! Wait for the completion of the current buffer dump. Returns the status of the last buffer dump. */
+  PlusStatus WaitForBufferDump();
+
+  /*!
+    Get the UIDs of the items that were overwritten in the buffers before they could be written by the last completed buffer dump.
+    The map is indexed by the dump file names. Files without lost items are not listed.
+  */
+  PlusStatus GetBufferDumpLostItemUids(std::map<std::string, std::vector<BufferItemUidType> >& lostItemUids);
+
   /*!
     Get tracking data in a tracked frame list since time specified
     \param aTimestamp The oldest timestamp we search for in the buffer. If -1 get all frames in the time range since the most recent timestamp. Out parameter - changed to timestamp of last added frame
@@ -168,6 +196,24 @@ protected:
   bool Connected;
   bool Started;
 
+  /*! Buffer range frozen at the time the dump was started and the result of writing it */
+  struct BufferDumpJob
+  {
+    vtkSmartPointer<vtkPlusDataSource> Source;
+    std::string FileName;
+    BufferItemUidType FirstUid;
+    BufferItemUidType LastUid;
+    std::vector<BufferItemUidType> LostItemUids;
+  };
+
+  /*! Write the buffer ranges of BufferDumpJobs. Runs in BufferDumpThread. */
+  void WriteBufferDumpJobs();
+
+  std::vector<BufferDumpJob> BufferDumpJobs;
+  std::thread BufferDumpThread;
+  std::atomic<bool> BufferDumpInProgress;
+  PlusStatus BufferDumpStatus;
+
 private:
   vtkPlusDataCollector(const vtkPlusDataCollector&);
   void operator=(const vtkPlusDataCollector&);
@@ -334,6 +334,12 @@ PlusStatus vtkPlusDataSource::ReadConfiguration(vtkXMLDataElement* sourceElement
       }
     }
 
+    const char* frameHashing = sourceElement->GetAttribute("FrameHashing");
+    if (frameHashing != NULL)
+    {
+      this->GetBuffer()->SetFrameHashing(STRCASECMP(frameHashing, "TRUE") == 0);
+    }
+
     // Clipping parameters:
     // Users may forget that images are 3D and provide clipping coordinates and size in 2D only.
     // Detect this and set correct values in the third component.
@@ -462,6 +468,11 @@ PlusStatus vtkPlusDataSource::WriteConfiguration(vtkXMLDataElement* aSourceEleme
     aSourceElement->SetIntAttribute("AveragedItemsForFiltering", this->GetBuffer()->GetAveragedItemsForFiltering());
   }
 
+  if (this->GetBuffer()->GetFrameHashing() || aSourceElement->GetAttribute("FrameHashing") != NULL)
+  {
+    aSourceElement->SetAttribute("FrameHashing", this->GetBuffer()->GetFrameHashing() ? "TRUE" : "FALSE");
+  }
+
   // Write custom properties
   if (this->CustomProperties.size() > 0)
   {
@@ -573,6 +584,15 @@ PlusStatus vtkPlusDataSource::AddItem(void* imageDataPtr, US_IMAGE_ORIENTATION u
                                     this->ClipRectangleOrigin, this->ClipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields);
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::AddItem(void* imageDataPtr, PixelCodec::PixelEncoding inputEncoding, US_IMAGE_ORIENTATION usImageOrientation, const FrameSizeType& frameSizeInPx,
+                                      US_IMAGE_TYPE imageType, long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/,
+                                      const igsioFieldMapType* customFields /*= NULL*/)
+{
+  return this->GetBuffer()->AddItem(imageDataPtr, inputEncoding, usImageOrientation, frameSizeInPx, imageType, frameNumber,
+                                    this->ClipRectangleOrigin, this->ClipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::AddItem(void* imageDataPtr, const FrameSizeType& frameSize, unsigned int frameSizeInBytes, US_IMAGE_TYPE imageType, long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
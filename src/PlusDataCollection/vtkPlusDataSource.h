@@ -228,6 +228,23 @@ public:
                              double filteredTimestamp = UNDEFINED_TIMESTAMP,
                              const igsioFieldMapType* customFields = NULL);
 
+  /*!
+    Add a frame that is stored in a camera pixel encoding (YUY2, RGB24, BGR24 or RGBA32) to the buffer.
+    Pixel conversion, clipping and reorientation are performed in a single pass, directly into the buffer.
+    If the timestamp is  less than or equal to the previous timestamp,
+    or if the frame's format doesn't match the buffer's frame format,
+    then the frame is not added to the buffer.
+  */
+  virtual PlusStatus AddItem(void* imageDataPtr,
+                             PixelCodec::PixelEncoding inputEncoding,
+                             US_IMAGE_ORIENTATION usImageOrientation,
+                             const FrameSizeType& frameSizeInPx,
+                             US_IMAGE_TYPE imageType,
+                             long frameNumber,
+                             double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
+                             double filteredTimestamp = UNDEFINED_TIMESTAMP,
+                             const igsioFieldMapType* customFields = NULL);
+
   /*!
     Add a frame plus a timestamp to the buffer with frame index.
     Additionally an optional field name&value can be added,
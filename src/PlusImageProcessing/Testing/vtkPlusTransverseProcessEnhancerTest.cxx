@@ -35,6 +35,7 @@ int main(int argc, char** argv)
   std::string outputConfigFileName;
   std::string outputFileName;
   bool saveIntermediateResults = false;
+  bool useFusedProcessing = false;
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   //Get command line arguments
@@ -45,6 +46,7 @@ int main(int argc, char** argv)
   args.AddArgument("--output-config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputConfigFileName, "Optional filename for output config file. Creates new config file with paramaters used during this test");
   args.AddArgument("--output-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "The filename to write the processed sequence to.");
   args.AddArgument("--save-intermediate-images", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &saveIntermediateResults, "If intermediate images should be saved to output files");
+  args.AddArgument("--use-fused-processing", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &useFusedProcessing, "Process the frames with fused processing steps (overrides the configuration)");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
   if (!args.Parse())
@@ -143,6 +145,7 @@ int main(int argc, char** argv)
 
   // Process the frames for the input file
   enhancer->SetSaveIntermediateResults(saveIntermediateResults);
+  enhancer->SetUseFusedProcessing(useFusedProcessing);
   LOG_INFO("Processing frames...");
 
   if (enhancer->Update() == PLUS_FAIL)
@@ -0,0 +1,277 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkPlusUsScanConvertCurvilinearBenchmark.cxx
+Compares the floating-point and fixed-point interpolation of vtkPlusUsScanConvertCurvilinear.
+Measures the throughput of both methods on 8-bit and 16-bit images and verifies that the results are within the expected tolerance.
+The fixed-point interpolation is also run with each available instruction set (see PixelCodec::SetInstructionSet),
+the SIMD results must be identical to the scalar result.
+*/
+
+#include "PlusConfigure.h"
+#include "PixelCodec.h"
+#include "vtkPlusUsScanConvertCurvilinear.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+#include <vtkXMLDataElement.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// IGSIO includes
+#include <vtkIGSIOAccurateTimer.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  template <class T>
+  void FillRandom(T* pixels, vtkIdType numberOfPixels, unsigned int maxValue)
+  {
+    // Simple linear congruential generator to get the same image on all platforms
+    unsigned int state = 12345;
+    for (vtkIdType i = 0; i < numberOfPixels; i++)
+    {
+      state = state * 1103515245 + 12345;
+      pixels[i] = static_cast<T>((state >> 8) % (maxValue + 1));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  void CompareImages(const T* pixelsA, const T* pixelsB, vtkIdType numberOfPixels, int& maxDifference, vtkIdType& numberOfDifferentPixels)
+  {
+    maxDifference = 0;
+    numberOfDifferentPixels = 0;
+    for (vtkIdType i = 0; i < numberOfPixels; i++)
+    {
+      int difference = abs(static_cast<int>(pixelsA[i]) - static_cast<int>(pixelsB[i]));
+      if (difference > 0)
+      {
+        numberOfDifferentPixels++;
+      }
+      if (difference > maxDifference)
+      {
+        maxDifference = difference;
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Returns the average computation time of one scan conversion, in seconds
+  double MeasureScanConversionTimeSec(vtkPlusUsScanConvertCurvilinear* scanConverter, vtkImageData* inputImage, int numberOfIterations)
+  {
+    // First update computes the interpolation table, it is not included in the measurement
+    scanConverter->SetInputData(inputImage);
+    scanConverter->Update();
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfIterations; i++)
+    {
+      inputImage->Modified();
+      scanConverter->Update();
+    }
+    return (vtkIGSIOAccurateTimer::GetSystemTime() - startTime) / numberOfIterations;
+  }
+
+  //----------------------------------------------------------------------------
+  // Runs the fixed-point scan conversion with each available instruction set and compares the results to the scalar result
+  PlusStatus CompareInstructionSets(vtkXMLDataElement* scanConversionElement, vtkImageData* inputImage, int numberOfIterations)
+  {
+    const PixelCodec::InstructionSet defaultInstructionSet = PixelCodec::GetInstructionSet();
+    const PixelCodec::InstructionSet instructionSets[] = { PixelCodec::InstructionSet_Scalar, PixelCodec::InstructionSet_AVX2 };
+    vtkSmartPointer<vtkImageData> scalarOutput;
+    double scalarTimeSec = 0.0;
+    PlusStatus status = PLUS_SUCCESS;
+    for (int instructionSetIndex = 0; instructionSetIndex < 2; instructionSetIndex++)
+    {
+      PixelCodec::InstructionSet instructionSet = instructionSets[instructionSetIndex];
+      if (!PixelCodec::IsInstructionSetAvailable(instructionSet))
+      {
+        LOG_INFO("  Instruction set " << PixelCodec::GetInstructionSetAsString(instructionSet) << " is not available, skipped");
+        continue;
+      }
+      PixelCodec::SetInstructionSet(instructionSet);
+
+      vtkSmartPointer<vtkPlusUsScanConvertCurvilinear> scanConverter = vtkSmartPointer<vtkPlusUsScanConvertCurvilinear>::New();
+      scanConverter->ReadConfiguration(scanConversionElement);
+      scanConverter->SetUseFixedPointInterpolation(true);
+      double timeSec = MeasureScanConversionTimeSec(scanConverter, inputImage, numberOfIterations);
+      vtkImageData* output = scanConverter->GetOutput();
+
+      if (instructionSet == PixelCodec::InstructionSet_Scalar)
+      {
+        scalarOutput = vtkSmartPointer<vtkImageData>::New();
+        scalarOutput->DeepCopy(output);
+        scalarTimeSec = timeSec;
+        LOG_INFO("  Fixed-point " << PixelCodec::GetInstructionSetAsString(instructionSet) << ": " << timeSec * 1000.0 << " ms/frame");
+        continue;
+      }
+      LOG_INFO("  Fixed-point " << PixelCodec::GetInstructionSetAsString(instructionSet) << ": " << timeSec * 1000.0 << " ms/frame, speedup: " << scalarTimeSec / timeSec);
+
+      size_t outputSizeBytes = static_cast<size_t>(output->GetNumberOfPoints()) * output->GetScalarSize();
+      if (scalarOutput == NULL || scalarOutput->GetNumberOfPoints() != output->GetNumberOfPoints()
+          || memcmp(scalarOutput->GetScalarPointer(), output->GetScalarPointer(), outputSizeBytes) != 0)
+      {
+        LOG_ERROR("Fixed-point scan conversion result with " << PixelCodec::GetInstructionSetAsString(instructionSet) << " instructions differs from the scalar result");
+        status = PLUS_FAIL;
+      }
+    }
+    PixelCodec::SetInstructionSet(defaultInstructionSet);
+    return status;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus RunBenchmark(vtkXMLDataElement* scanConversionElement, int scalarType, int numberOfSamples, int numberOfLines, int numberOfIterations)
+  {
+    vtkSmartPointer<vtkImageData> inputImage = vtkSmartPointer<vtkImageData>::New();
+    inputImage->SetExtent(0, numberOfSamples - 1, 0, numberOfLines - 1, 0, 0);
+    inputImage->AllocateScalars(scalarType, 1);
+    vtkIdType numberOfInputPixels = static_cast<vtkIdType>(numberOfSamples) * numberOfLines;
+    unsigned int maxValue = 0;
+    switch (scalarType)
+    {
+    case VTK_UNSIGNED_CHAR:
+      maxValue = VTK_UNSIGNED_CHAR_MAX;
+      FillRandom(static_cast<unsigned char*>(inputImage->GetScalarPointer()), numberOfInputPixels, maxValue);
+      break;
+    case VTK_UNSIGNED_SHORT:
+      maxValue = VTK_UNSIGNED_SHORT_MAX;
+      FillRandom(static_cast<unsigned short*>(inputImage->GetScalarPointer()), numberOfInputPixels, maxValue);
+      break;
+    default:
+      LOG_ERROR("Unsupported scalar type: " << scalarType);
+      return PLUS_FAIL;
+    }
+
+    vtkSmartPointer<vtkPlusUsScanConvertCurvilinear> floatingPointScanConverter = vtkSmartPointer<vtkPlusUsScanConvertCurvilinear>::New();
+    vtkSmartPointer<vtkPlusUsScanConvertCurvilinear> fixedPointScanConverter = vtkSmartPointer<vtkPlusUsScanConvertCurvilinear>::New();
+    if (floatingPointScanConverter->ReadConfiguration(scanConversionElement) != PLUS_SUCCESS
+        || fixedPointScanConverter->ReadConfiguration(scanConversionElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read scan conversion configuration");
+      return PLUS_FAIL;
+    }
+    floatingPointScanConverter->SetUseFixedPointInterpolation(false);
+    fixedPointScanConverter->SetUseFixedPointInterpolation(true);
+
+    double floatingPointTimeSec = MeasureScanConversionTimeSec(floatingPointScanConverter, inputImage, numberOfIterations);
+    double fixedPointTimeSec = MeasureScanConversionTimeSec(fixedPointScanConverter, inputImage, numberOfIterations);
+
+    if (!fixedPointScanConverter->IsFixedPointInterpolationAvailable())
+    {
+      LOG_ERROR("Fixed-point interpolation table was not computed");
+      return PLUS_FAIL;
+    }
+
+    vtkImageData* floatingPointOutput = floatingPointScanConverter->GetOutput();
+    vtkImageData* fixedPointOutput = fixedPointScanConverter->GetOutput();
+    int* outputDimensions = floatingPointOutput->GetDimensions();
+    vtkIdType numberOfOutputPixels = static_cast<vtkIdType>(outputDimensions[0]) * outputDimensions[1] * outputDimensions[2];
+    int maxDifference = 0;
+    vtkIdType numberOfDifferentPixels = 0;
+    if (scalarType == VTK_UNSIGNED_CHAR)
+    {
+      CompareImages(static_cast<unsigned char*>(floatingPointOutput->GetScalarPointer()), static_cast<unsigned char*>(fixedPointOutput->GetScalarPointer()),
+                    numberOfOutputPixels, maxDifference, numberOfDifferentPixels);
+    }
+    else
+    {
+      CompareImages(static_cast<unsigned short*>(floatingPointOutput->GetScalarPointer()), static_cast<unsigned short*>(fixedPointOutput->GetScalarPointer()),
+                    numberOfOutputPixels, maxDifference, numberOfDifferentPixels);
+    }
+
+    double interpolatedPixelsPerFrame = static_cast<double>(fixedPointScanConverter->GetInterpolatedPointArray().size());
+    LOG_INFO(inputImage->GetScalarTypeAsString() << " " << numberOfSamples << "x" << numberOfLines << " -> " << outputDimensions[0] << "x" << outputDimensions[1]);
+    LOG_INFO("  Floating-point: " << floatingPointTimeSec * 1000.0 << " ms/frame, " << interpolatedPixelsPerFrame / floatingPointTimeSec / 1e6 << " Mpixel/s");
+    LOG_INFO("  Fixed-point:    " << fixedPointTimeSec * 1000.0 << " ms/frame, " << interpolatedPixelsPerFrame / fixedPointTimeSec / 1e6 << " Mpixel/s");
+    LOG_INFO("  Speedup: " << floatingPointTimeSec / fixedPointTimeSec);
+    LOG_INFO("  Different pixels: " << numberOfDifferentPixels << " of " << numberOfOutputPixels << ", max difference: " << maxDifference);
+
+    // Weights have FIXED_POINT_WEIGHT_BITS fractional bits, so the error is proportional to the intensity range
+    int maxAllowedDifference = std::max<int>(1, maxValue >> (vtkPlusUsScanConvertCurvilinear::FIXED_POINT_WEIGHT_BITS - 2));
+    if (maxDifference > maxAllowedDifference)
+    {
+      LOG_ERROR("Fixed-point interpolation result differs from the floating-point result by " << maxDifference << " (maximum allowed difference: " << maxAllowedDifference << ")");
+      return PLUS_FAIL;
+    }
+
+    return CompareInstructionSets(scanConversionElement, inputImage, numberOfIterations);
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  vtksys::CommandLineArguments args;
+
+  std::string inputConfigFileName;
+  int numberOfSamples = 2048;
+  int numberOfLines = 128;
+  int numberOfIterations = 20;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Configuration file name containing a curvilinear ScanConversion element.");
+  args.AddArgument("--number-of-samples", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfSamples, "Number of samples in a scanline of the generated input image (default: 2048).");
+  args.AddArgument("--number-of-lines", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfLines, "Number of scanlines of the generated input image (default: 128).");
+  args.AddArgument("--iterations", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfIterations, "Number of scan conversions to average the computation time over (default: 20).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputConfigFileName.empty())
+  {
+    LOG_ERROR("The argument --config-file is required");
+    return EXIT_FAILURE;
+  }
+  if (numberOfSamples < 2 || numberOfLines < 2 || numberOfIterations < 1)
+  {
+    LOG_ERROR("Invalid image size or number of iterations");
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, inputConfigFileName.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << inputConfigFileName);
+    return EXIT_FAILURE;
+  }
+  vtkXMLDataElement* scanConversionElement = configRootElement->FindNestedElementWithName("ScanConversion");
+  if (scanConversionElement == NULL)
+  {
+    LOG_ERROR("Cannot find ScanConversion element in configuration file " << inputConfigFileName);
+    return EXIT_FAILURE;
+  }
+
+  int exitStatus = EXIT_SUCCESS;
+  if (RunBenchmark(scanConversionElement, VTK_UNSIGNED_CHAR, numberOfSamples, numberOfLines, numberOfIterations) != PLUS_SUCCESS)
+  {
+    exitStatus = EXIT_FAILURE;
+  }
+  if (RunBenchmark(scanConversionElement, VTK_UNSIGNED_SHORT, numberOfSamples, numberOfLines, numberOfIterations) != PLUS_SUCCESS)
+  {
+    exitStatus = EXIT_FAILURE;
+  }
+  return exitStatus;
+}
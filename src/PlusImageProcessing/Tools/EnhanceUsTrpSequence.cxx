@@ -22,6 +22,7 @@ int main(int argc, char **argv)
   std::string outputFileName;
   std::string configFileName;
   bool saveIntermediateResults = false;
+  int numberOfThreads = -1;
   int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   args.Initialize(argc, argv);
@@ -30,6 +31,7 @@ int main(int argc, char **argv)
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &configFileName, "The filename for input config file.");
   args.AddArgument("--output-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "The filename to write the processed sequence to.");
   args.AddArgument("--save-intermediate-images", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &saveIntermediateResults, "If intermediate images should be saved to output files");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of frames to process in parallel (0 = one per processor core). If not specified then the processor configuration is used.");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
   if (!args.Parse())
@@ -120,6 +122,10 @@ int main(int argc, char **argv)
   
   boneFilter->SetInputFrames(trackedFrameList);
   boneFilter->ReadConfiguration(processorElement);
+  if (numberOfThreads >= 0)
+  {
+    boneFilter->SetNumberOfThreads(numberOfThreads);
+  }
 
   PlusStatus filterStatus = boneFilter->Update();
   if (filterStatus != PlusStatus::PLUS_SUCCESS)
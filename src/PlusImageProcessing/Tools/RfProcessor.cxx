@@ -28,6 +28,7 @@ int main(int argc, char **argv)
   std::string outputImgFile;
   std::string operation="BRIGHTNESS_SCAN_CONVERT";
   bool useCompression(true);
+  bool useFusedProcessing(false);
 
   int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
@@ -39,6 +40,7 @@ int main(int argc, char **argv)
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Config file containing processing parameters");
   args.AddArgument("--output-img-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputImgFile, "File name of the generated output brightness image");
   args.AddArgument("--use-compression", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &useCompression, "Use compression when outputting data");
+  args.AddArgument("--use-fused-processing", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &useFusedProcessing, "Compute brightness and scan conversion in one pass (overrides the UseFusedProcessing attribute in the configuration file)");
   args.AddArgument("--operation", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &operation, "Processing operation to be applied on the input file (BRIGHTNESS_CONVERT, BRIGHTNESS_SCAN_CONVERT, default: BRIGHTNESS_SCAN_CONVERT");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
@@ -138,6 +140,10 @@ int main(int argc, char **argv)
       LOG_ERROR("Failed to read conversion parameters from the configuration file"); 
       exit(EXIT_FAILURE); 
     }
+    if (useFusedProcessing)
+    {
+      rfProcessor->SetUseFusedProcessing(true);
+    }
 
     // Process the frames
     for (unsigned int j = 0; j < frameList->GetNumberOfTrackedFrames(); j++)
@@ -26,11 +26,51 @@ See License.txt for details.
 #include <vtkIGSIOTrackedFrameList.h>
 
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPlusBoneEnhancer);
 
+namespace
+{
+  // Number of scan lines that a worker thread processes at once in fused processing
+  const int FUSED_PROCESSING_BLOCK_SCAN_LINES = 16;
+
+  //----------------------------------------------------------------------------
+  // Same pixel value conversion as GetScalarComponentAsDouble followed by SetScalarComponentFromFloat in FillLinesImage
+  template <class T>
+  void FillScanLine(const T* inputPixels, const vtkIdType* sampleIndices, int numberOfSamples, unsigned char* scanLinePixels)
+  {
+    for (int sampleIndex = 0; sampleIndex < numberOfSamples; ++sampleIndex)
+    {
+      if (sampleIndices[sampleIndex] < 0)
+      {
+        scanLinePixels[sampleIndex] = 0;
+      }
+      else
+      {
+        scanLinePixels[sampleIndex] = static_cast<unsigned char>(static_cast<float>(static_cast<double>(inputPixels[sampleIndices[sampleIndex]])));
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Same edge magnitude computation as VectorImageToUchar, followed by a lookup in the binarization table
+  template <class T>
+  void BinarizeEdgeMagnitudeScanLine(const T* edgePixels, int numberOfComponents, int numberOfPixels, const unsigned char* binarizationTable, unsigned char* binaryPixels)
+  {
+    for (int x = 0; x < numberOfPixels; ++x)
+    {
+      unsigned char edgeDetectorOutput0 = static_cast<unsigned char>(static_cast<float>(static_cast<double>(edgePixels[x * numberOfComponents])));
+      unsigned char edgeDetectorOutput1 = static_cast<unsigned char>(static_cast<float>(static_cast<double>(edgePixels[x * numberOfComponents + 1])));
+      float output = (float)(edgeDetectorOutput0 + edgeDetectorOutput1) / (float)2;
+      binaryPixels[x] = binarizationTable[std::max(0, std::min(255, (int)output))];
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkPlusBoneEnhancer::vtkPlusBoneEnhancer()
 : ScanConverter(NULL),
@@ -104,6 +144,11 @@ vtkPlusBoneEnhancer::vtkPlusBoneEnhancer()
   this->LinesImage->SetExtent(0, 0, 0, 0, 0, 0);
   this->ProcessedLinesImage->SetExtent(0, 0, 0, 0, 0, 0);
 
+  this->UseFusedProcessing = false;
+  this->BinaryEdgeImage = vtkSmartPointer<vtkImageData>::New();
+  this->BinaryEdgeImage->SetExtent(0, 0, 0, 0, 0, 0);
+  this->FanImage = vtkSmartPointer<vtkImageData>::New();
+
   this->IntermediateImageMap.clear();
 }
 
@@ -119,12 +164,17 @@ vtkPlusBoneEnhancer::~vtkPlusBoneEnhancer()
 void vtkPlusBoneEnhancer::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "UseFusedProcessing: " << (this->UseFusedProcessing ? "true" : "false") << "\n";
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusBoneEnhancer::ReadConfiguration(vtkSmartPointer<vtkXMLDataElement> processingElement)
+PlusStatus vtkPlusBoneEnhancer::ReadConfiguration(vtkXMLDataElement* processingElement)
 {
   XML_VERIFY_ELEMENT(processingElement, this->GetTagName());
+  if (this->Superclass::ReadConfiguration(processingElement) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
 
   //Read things in the ScanConversion tag
   vtkSmartPointer<vtkXMLDataElement> scanConversionElement = processingElement->FindNestedElementWithName("ScanConversion");
@@ -239,6 +289,7 @@ PlusStatus vtkPlusBoneEnhancer::ReadConfiguration(vtkSmartPointer<vtkXMLDataElem
   // Read tags related to scan lines
   XML_READ_SCALAR_ATTRIBUTE_REQUIRED(int, NumberOfScanLines, processingElement);
   XML_READ_SCALAR_ATTRIBUTE_REQUIRED(int, NumberOfSamplesPerScanLine, processingElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(UseFusedProcessing, processingElement);
 
   int rfImageExtent[6] = { 0, this->NumberOfSamplesPerScanLine - 1, 0, this->NumberOfScanLines - 1, 0, 0 };
   this->ScanConverter->SetInputImageExtent(rfImageExtent);
@@ -248,14 +299,21 @@ PlusStatus vtkPlusBoneEnhancer::ReadConfiguration(vtkSmartPointer<vtkXMLDataElem
 
 //----------------------------------------------------------------------------
 // Writes the parameters that were used to a config file
-PlusStatus vtkPlusBoneEnhancer::WriteConfiguration(vtkSmartPointer<vtkXMLDataElement> processingElement)
+PlusStatus vtkPlusBoneEnhancer::WriteConfiguration(vtkXMLDataElement* processingElement)
 {
   XML_VERIFY_ELEMENT(processingElement, this->GetTagName());
+  if (this->Superclass::WriteConfiguration(processingElement) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
 
   //Write the parameters for filters to the scanner's properties to the output config file
-  processingElement->SetAttribute("Type", this->GetProcessorTypeName());
   processingElement->SetIntAttribute("NumberOfScanLines", NumberOfScanLines);
   processingElement->SetIntAttribute("NumberOfSamplesPerScanLine", NumberOfSamplesPerScanLine);
+  if (this->UseFusedProcessing || processingElement->GetAttribute("UseFusedProcessing") != NULL)
+  {
+    processingElement->SetAttribute("UseFusedProcessing", this->UseFusedProcessing ? "TRUE" : "FALSE");
+  }
 
   XML_FIND_NESTED_ELEMENT_CREATE_IF_MISSING(scanConversionElement, processingElement, "ScanConversion");
   this->ScanConverter->WriteConfiguration(scanConversionElement);
@@ -303,6 +361,9 @@ PlusStatus vtkPlusBoneEnhancer::ProcessImageExtents()
   this->LinesImage->SetExtent(linesImageExtent);
   this->LinesImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
 
+  this->BinaryEdgeImage->SetExtent(linesImageExtent);
+  this->BinaryEdgeImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
   //Set up variables related to image extents
   int dims[3] = { 0, 0, 0 };
   this->LinesImage->GetDimensions(dims);
@@ -529,63 +590,62 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
 //----------------------------------------------------------------------------
 //a way of threasholding based on the standard deviation of a row
 void vtkPlusBoneEnhancer::ThresholdViaStdDeviation(vtkSmartPointer<vtkImageData> inputImage)
+{
+  int dims[3] = { 0, 0, 0 };
+  inputImage->GetDimensions(dims);
+
+  for (int y = dims[1] - 1; y >= 0; --y)
+  {
+    ThresholdScanLineViaStdDeviation(static_cast<unsigned char*>(inputImage->GetScalarPointer(0, y, 0)), dims[0]);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBoneEnhancer::ThresholdScanLineViaStdDeviation(unsigned char* scanLinePixels, int numberOfPixels)
 {
   int fatLayerToCut = 20; //The area of fat too close to the transducer should not be considered
 
   float vInput = 0;
   unsigned char* vOutput = 0;
 
-  int dims[3] = { 0, 0, 0 };
-  inputImage->GetDimensions(dims);
-
-  int max;
+  int max = 0;
 
   //values used to calculate the standard deviation
-  int pixelSum;
-  int squearSum;
-  float pixelAverage;
+  int pixelSum = 0;
+  int squearSum = 0;
+  float pixelAverage = 0;
   float meanDiffSum;
   float meanDiffAverage;
   float thresholdValue;
 
-  for (int y = dims[1] - 1; y >= 0; --y)
+  //determine the average, sum, and max of the row
+  for (int x = numberOfPixels - 1; x >= fatLayerToCut; --x)
   {
-    max = 0;
+    vInput = scanLinePixels[x];
+    pixelSum += vInput;
+    squearSum += vInput * vInput;
 
-    pixelSum = 0;
-    squearSum = 0;
-    pixelAverage = 0;
-
-    //determine the average, sum, and max of the row
-    for (int x = dims[0] - 1; x >= fatLayerToCut; --x)
+    if (vInput > max)
     {
-      vInput = inputImage->GetScalarComponentAsFloat(x, y, 0, 0);
-      pixelSum += vInput;
-      squearSum += vInput * vInput;
-
-      if (vInput > max)
-      {
-        max = vInput;
-      }
+      max = vInput;
     }
-    pixelAverage = pixelSum / (dims[0] - fatLayerToCut);
-
-    //determine the standard deviation of the row
-    meanDiffSum = squearSum + (dims[0] - fatLayerToCut) * pixelAverage * pixelAverage + (-2 * pixelAverage * pixelSum);
-    meanDiffAverage = meanDiffSum / (dims[0] - fatLayerToCut);
-    thresholdValue = max - 3 * pow(meanDiffAverage, 0.5f);
+  }
+  pixelAverage = pixelSum / (numberOfPixels - fatLayerToCut);
 
+  //determine the standard deviation of the row
+  meanDiffSum = squearSum + (numberOfPixels - fatLayerToCut) * pixelAverage * pixelAverage + (-2 * pixelAverage * pixelSum);
+  meanDiffAverage = meanDiffSum / (numberOfPixels - fatLayerToCut);
+  thresholdValue = max - 3 * pow(meanDiffAverage, 0.5f);
 
-    //if a pixel's value is too low, remove it
-    if (pixelSum != 0)
+  //if a pixel's value is too low, remove it
+  if (pixelSum != 0)
+  {
+    for (int x = numberOfPixels - 1; x >= 0; --x)
     {
-      for (int x = dims[0] - 1; x >= 0; --x)
+      vOutput = scanLinePixels + x;
+      if (*vOutput < thresholdValue && *vOutput != 0)
       {
-        vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
-        if (*vOutput < thresholdValue && *vOutput != 0)
-        {
-          *vOutput = 0;
-        }
+        *vOutput = 0;
       }
     }
   }
@@ -625,6 +685,11 @@ void vtkPlusBoneEnhancer::ImageConjunction(vtkSmartPointer<vtkImageData> InputIm
 // Processes a given frame and marks potential bone areas.
 PlusStatus vtkPlusBoneEnhancer::ProcessFrame(igsioTrackedFrame* inputFrame, igsioTrackedFrame* outputFrame)
 {
+  if (this->UseFusedProcessing && !this->SaveIntermediateResults)
+  {
+    return this->ProcessFrameFused(inputFrame, outputFrame);
+  }
+
   //Process the input into a linear image
   vtkSmartPointer<vtkImageData> intermediateImage = this->UnprocessedFrameToLinearImage(inputFrame);
   //Remove noise and mark all possible bones
@@ -634,6 +699,259 @@ PlusStatus vtkPlusBoneEnhancer::ProcessFrame(igsioTrackedFrame* inputFrame, igsi
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+// Same processing steps as ProcessFrame, but pixelwise steps are fused and intermediate images are reused
+PlusStatus vtkPlusBoneEnhancer::ProcessFrameFused(igsioTrackedFrame* inputFrame, igsioTrackedFrame* outputFrame)
+{
+  if (this->RemoveNoiseFused(inputFrame, NULL) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  return this->LinearToFanImageFused(this->BinaryImageForMorphology, outputFrame);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBoneEnhancer::RemoveNoiseFused(igsioTrackedFrame* inputFrame, vtkImageData* unthresholdedLinesImage)
+{
+  int* linesImageExtent = this->ScanConverter->GetInputImageExtent();
+  if (this->FirstFrame || !std::equal(linesImageExtent, linesImageExtent + 6, this->LinesImage->GetExtent()))
+  {
+    this->ProcessImageExtents();
+    this->FirstFrame = false;
+  }
+  this->BoneAreasInfo.clear();
+
+  //Sample the input image along scan lines and threshold each scan line based on its standard deviation
+  if (this->FillAndThresholdLinesImage(inputFrame->GetImageData()->GetImage(), unthresholdedLinesImage) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  //Gaussian smoothing and edge detection
+  this->GaussianSmooth->SetInputData(this->LinesImage);
+  this->EdgeDetector->SetInputConnection(this->GaussianSmooth->GetOutputPort());
+  this->EdgeDetector->Update();
+
+  //Edge magnitude, binarized for the morphological operations
+  if (this->BinarizeEdgeMagnitude(this->EdgeDetector->GetOutput(), this->BinaryEdgeImage) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  //Remove small clusters of pixels, erode and dilate the image
+  this->IslandRemover->SetInputData(this->BinaryEdgeImage);
+  this->ImageEroder->SetKernelSize(this->ErosionKernelSize[0], this->ErosionKernelSize[1], 1);
+  this->ImageEroder->SetInputConnection(this->IslandRemover->GetOutputPort());
+  this->ImageDialator->SetKernelSize(this->DilationKernelSize[0], this->DilationKernelSize[1], 1);
+  this->ImageDialator->SetInputConnection(this->ImageEroder->GetOutputPort());
+  this->ImageDialator->Update();
+  this->BinaryImageForMorphology->DeepCopy(this->ImageDialator->GetOutput());
+
+  //Detect each possible bone area
+  this->MarkShadowOutline(this->BinaryImageForMorphology);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBoneEnhancer::LinearToFanImageFused(vtkImageData* linesImage, igsioTrackedFrame* outputFrame)
+{
+  this->ProcessedLinesImage->DeepCopy(linesImage);
+  this->ScanConverter->SetInputData(this->ProcessedLinesImage);
+  this->ScanConverter->SetOutput(this->FanImage);
+  this->ScanConverter->Update();
+  outputFrame->GetImageData()->DeepCopyFrom(this->FanImage);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBoneEnhancer::UpdateScanLineSampleIndices(vtkImageData* inputImage)
+{
+  int* linesImageExtent = this->ScanConverter->GetInputImageExtent();
+  int lineLengthPx = linesImageExtent[1] - linesImageExtent[0] + 1;
+  int numScanLines = linesImageExtent[3] - linesImageExtent[2] + 1;
+  if (lineLengthPx < 2 || numScanLines < 1)
+  {
+    LOG_ERROR("Invalid lines image extent: " << lineLengthPx << " samples per scan line, " << numScanLines << " scan lines");
+    return PLUS_FAIL;
+  }
+
+  // The sample indices only depend on the input image layout and the scan line geometry. The modification time of the
+  // scan converter cannot be used, as it changes with each SetInputData/SetOutput call.
+  int* inputExtent = inputImage->GetExtent();
+  std::vector<double> parameters(inputExtent, inputExtent + 6);
+  parameters.push_back(inputImage->GetNumberOfScalarComponents());
+  parameters.insert(parameters.end(), linesImageExtent, linesImageExtent + 6);
+  for (int scanLine = 0; scanLine < numScanLines; ++scanLine)
+  {
+    double start[4] = { 0, 0, 0, 0 };
+    double end[4] = { 0, 0, 0, 0 };
+    this->ScanConverter->GetScanLineEndPoints(scanLine, start, end);
+    parameters.insert(parameters.end(), start, start + 2);
+    parameters.insert(parameters.end(), end, end + 2);
+  }
+  if (parameters == this->ScanLineSampleIndicesParameters)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // Sample positions are computed the same way as in FillLinesImage
+  vtkIdType inputImageWidth = inputExtent[1] - inputExtent[0] + 1;
+  vtkIdType inputImageHeight = inputExtent[3] - inputExtent[2] + 1;
+  int numberOfComponents = inputImage->GetNumberOfScalarComponents();
+  this->ScanLineSampleIndices.resize(static_cast<size_t>(lineLengthPx) * numScanLines);
+  const size_t scanLineEndPointsOffset = 6 + 1 + 6;
+  for (int scanLine = 0; scanLine < numScanLines; ++scanLine)
+  {
+    const double* start = &parameters[scanLineEndPointsOffset + 4 * scanLine];
+    const double* end = start + 2;
+
+    double directionVectorX = static_cast<double>(end[0] - start[0]) / (lineLengthPx - 1);
+    double directionVectorY = static_cast<double>(end[1] - start[1]) / (lineLengthPx - 1);
+    vtkIdType* scanLineSampleIndices = &this->ScanLineSampleIndices[static_cast<size_t>(scanLine) * lineLengthPx];
+    for (int pointIndex = 0; pointIndex < lineLengthPx; ++pointIndex)
+    {
+      int pixelCoordX = start[0] + directionVectorX * pointIndex;
+      int pixelCoordY = start[1] + directionVectorY * pointIndex;
+      if (pixelCoordX < inputExtent[0] || pixelCoordX > inputExtent[1]
+          || pixelCoordY < inputExtent[2] || pixelCoordY > inputExtent[3])
+      {
+        scanLineSampleIndices[pointIndex] = -1;
+        continue; // outside of the specified extent
+      }
+      vtkIdType pointId = (pixelCoordX - inputExtent[0]) + (pixelCoordY - inputExtent[2]) * inputImageWidth
+                          - inputExtent[4] * inputImageWidth * inputImageHeight;
+      scanLineSampleIndices[pointIndex] = pointId * numberOfComponents;
+    }
+  }
+
+  this->ScanLineSampleIndicesParameters = parameters;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBoneEnhancer::FillAndThresholdLinesImage(vtkImageData* inputImage, vtkImageData* unthresholdedLinesImage)
+{
+  if (this->UpdateScanLineSampleIndices(inputImage) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  int dims[3] = { 0, 0, 0 };
+  this->LinesImage->GetDimensions(dims);
+  const int lineLengthPx = dims[0];
+  const int numScanLines = dims[1];
+  if (this->ScanLineSampleIndices.size() != static_cast<size_t>(lineLengthPx) * numScanLines)
+  {
+    LOG_ERROR("Lines image size does not match the scan converter input image extent");
+    return PLUS_FAIL;
+  }
+
+  unsigned char* linesImagePixels = static_cast<unsigned char*>(this->LinesImage->GetScalarPointer());
+  unsigned char* unthresholdedPixels = NULL;
+  if (unthresholdedLinesImage != NULL)
+  {
+    if (!std::equal(this->LinesImage->GetExtent(), this->LinesImage->GetExtent() + 6, unthresholdedLinesImage->GetExtent())
+        || unthresholdedLinesImage->GetScalarType() != VTK_UNSIGNED_CHAR || unthresholdedLinesImage->GetNumberOfScalarComponents() != 1)
+    {
+      unthresholdedLinesImage->SetExtent(this->LinesImage->GetExtent());
+      unthresholdedLinesImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    }
+    unthresholdedPixels = static_cast<unsigned char*>(unthresholdedLinesImage->GetScalarPointer());
+  }
+  const vtkIdType* sampleIndices = &this->ScanLineSampleIndices[0];
+  void* inputPixels = inputImage->GetScalarPointer();
+  int inputScalarType = inputImage->GetScalarType();
+
+  unsigned int numberOfBlocks = (numScanLines + FUSED_PROCESSING_BLOCK_SCAN_LINES - 1) / FUSED_PROCESSING_BLOCK_SCAN_LINES;
+  PlusCommon::ParallelFor(numberOfBlocks, [&](unsigned int blockIndex)
+  {
+    int firstScanLine = blockIndex * FUSED_PROCESSING_BLOCK_SCAN_LINES;
+    int lastScanLine = std::min(firstScanLine + FUSED_PROCESSING_BLOCK_SCAN_LINES, numScanLines) - 1;
+    for (int scanLine = firstScanLine; scanLine <= lastScanLine; ++scanLine)
+    {
+      // The scan line is thresholded right after it is filled, while it is still in the cache
+      unsigned char* scanLinePixels = linesImagePixels + static_cast<size_t>(scanLine) * lineLengthPx;
+      const vtkIdType* scanLineSampleIndices = sampleIndices + static_cast<size_t>(scanLine) * lineLengthPx;
+      switch (inputScalarType)
+      {
+        vtkTemplateMacro(FillScanLine(static_cast<const VTK_TT*>(inputPixels), scanLineSampleIndices, lineLengthPx, scanLinePixels));
+      }
+      if (unthresholdedPixels != NULL)
+      {
+        memcpy(unthresholdedPixels + static_cast<size_t>(scanLine) * lineLengthPx, scanLinePixels, lineLengthPx);
+      }
+      ThresholdScanLineViaStdDeviation(scanLinePixels, lineLengthPx);
+    }
+  });
+
+  this->LinesImage->Modified();
+  if (unthresholdedLinesImage != NULL)
+  {
+    unthresholdedLinesImage->Modified();
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBoneEnhancer::BinarizeEdgeMagnitude(vtkImageData* edgeImage, vtkImageData* binaryImage)
+{
+  int edgeImageDims[3] = { 0, 0, 0 };
+  edgeImage->GetDimensions(edgeImageDims);
+  int binaryImageDims[3] = { 0, 0, 0 };
+  binaryImage->GetDimensions(binaryImageDims);
+  int numberOfComponents = edgeImage->GetNumberOfScalarComponents();
+  if (edgeImageDims[0] != binaryImageDims[0] || edgeImageDims[1] != binaryImageDims[1] || numberOfComponents < 2
+      || binaryImage->GetScalarType() != VTK_UNSIGNED_CHAR)
+  {
+    LOG_ERROR("Edge detector output does not match the binary image");
+    return PLUS_FAIL;
+  }
+
+  // Output of ImageBinarizer for each edge magnitude value
+  unsigned char binarizationTable[256];
+  double lowerThreshold = std::max(0.0, this->ImageBinarizer->GetLowerThreshold());
+  double upperThreshold = std::min(255.0, this->ImageBinarizer->GetUpperThreshold());
+  for (int magnitude = 0; magnitude < 256; ++magnitude)
+  {
+    bool inRange = static_cast<unsigned char>(lowerThreshold) <= magnitude && magnitude <= static_cast<unsigned char>(upperThreshold);
+    if (inRange)
+    {
+      binarizationTable[magnitude] = this->ImageBinarizer->GetReplaceIn() ? static_cast<unsigned char>(std::max(0.0, std::min(255.0, this->ImageBinarizer->GetInValue()))) : magnitude;
+    }
+    else
+    {
+      binarizationTable[magnitude] = this->ImageBinarizer->GetReplaceOut() ? static_cast<unsigned char>(std::max(0.0, std::min(255.0, this->ImageBinarizer->GetOutValue()))) : magnitude;
+    }
+  }
+
+  const int width = edgeImageDims[0];
+  const int numScanLines = edgeImageDims[1];
+  void* edgePixels = edgeImage->GetScalarPointer();
+  int edgeScalarType = edgeImage->GetScalarType();
+  unsigned char* binaryPixels = static_cast<unsigned char*>(binaryImage->GetScalarPointer());
+
+  unsigned int numberOfBlocks = (numScanLines + FUSED_PROCESSING_BLOCK_SCAN_LINES - 1) / FUSED_PROCESSING_BLOCK_SCAN_LINES;
+  PlusCommon::ParallelFor(numberOfBlocks, [&](unsigned int blockIndex)
+  {
+    int firstScanLine = blockIndex * FUSED_PROCESSING_BLOCK_SCAN_LINES;
+    int lastScanLine = std::min(firstScanLine + FUSED_PROCESSING_BLOCK_SCAN_LINES, numScanLines) - 1;
+    for (int scanLine = firstScanLine; scanLine <= lastScanLine; ++scanLine)
+    {
+      size_t scanLineOffset = static_cast<size_t>(scanLine) * width;
+      switch (edgeScalarType)
+      {
+        vtkTemplateMacro(BinarizeEdgeMagnitudeScanLine(static_cast<const VTK_TT*>(edgePixels) + scanLineOffset * numberOfComponents, numberOfComponents, width,
+                         binarizationTable, binaryPixels + scanLineOffset));
+      }
+    }
+  });
+
+  binaryImage->Modified();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
 void vtkPlusBoneEnhancer::LinearToFanImage(vtkSmartPointer<vtkImageData> inputImage, igsioTrackedFrame* outputFrame)
 {
 
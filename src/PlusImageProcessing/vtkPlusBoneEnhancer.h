@@ -40,10 +40,13 @@ public:
   virtual PlusStatus ProcessFrame(igsioTrackedFrame* inputFrame, igsioTrackedFrame* outputFrame);
 
   /*! Read configuration from xml data */
-  virtual PlusStatus ReadConfiguration(vtkSmartPointer<vtkXMLDataElement> processingElement);
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* processingElement);
 
   /*! Write configuration to xml data */
-  virtual PlusStatus WriteConfiguration(vtkSmartPointer<vtkXMLDataElement> processingElement);
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement* processingElement);
+
+  /*! Frames are processed independently, unless intermediate images are collected */
+  virtual bool IsStateless() { return !this->SaveIntermediateResults; };
 
   /*! Get the Type attribute of the configuration element */
   virtual const char* GetProcessorTypeName() { return "vtkPlusBoneEnhancer"; };
@@ -52,6 +55,16 @@ public:
   vtkSetMacro(IntermediateImageFileName, std::string);
   vtkSetMacro(SaveIntermediateResults, bool);
   vtkGetMacro(SaveIntermediateResults, bool);
+
+  /*!
+    If enabled then scan line sampling is fused with the standard deviation based thresholding and edge magnitude computation
+    is fused with binarization. Each fused step is a single multi-threaded pass over blocks of scan lines and
+    intermediate images are only allocated when the frame size changes. The output is the same as with the separate steps.
+    Not used when intermediate results are saved, as intermediate images are not available in fused processing.
+  */
+  vtkSetMacro(UseFusedProcessing, bool);
+  vtkGetMacro(UseFusedProcessing, bool);
+  vtkBooleanMacro(UseFusedProcessing, bool);
   
   /*! Get and Set methods for variables related to the scanner used */
   vtkSetMacro(NumberOfScanLines, int);
@@ -117,6 +130,33 @@ protected:
 
   virtual PlusStatus ProcessImageExtents();
 
+  /*! Process a frame with fused processing steps (see UseFusedProcessing) */
+  PlusStatus ProcessFrameFused(igsioTrackedFrame* inputFrame, igsioTrackedFrame* outputFrame);
+
+  /*!
+    Fused equivalent of UnprocessedFrameToLinearImage followed by RemoveNoise. The result is in BinaryImageForMorphology.
+    If unthresholdedLinesImage is not NULL then it receives the lines image before thresholding (it is reallocated if its extent differs).
+  */
+  PlusStatus RemoveNoiseFused(igsioTrackedFrame* inputFrame, vtkImageData* unthresholdedLinesImage);
+
+  /*! Fused equivalent of LinearToFanImage, the scan converted image is reused between frames */
+  PlusStatus LinearToFanImageFused(vtkImageData* linesImage, igsioTrackedFrame* outputFrame);
+
+  /*! Compute the input image pixel index of each lines image pixel if the input image layout or the scan line geometry changed */
+  PlusStatus UpdateScanLineSampleIndices(vtkImageData* inputImage);
+
+  /*!
+    Same as FillLinesImage followed by ThresholdViaStdDeviation, in a single pass over blocks of scan lines.
+    If unthresholdedLinesImage is not NULL then the scan lines are copied into it before thresholding.
+  */
+  PlusStatus FillAndThresholdLinesImage(vtkImageData* inputImage, vtkImageData* unthresholdedLinesImage = NULL);
+
+  /*! Same as VectorImageToUchar followed by ImageBinarizer, in a single pass over blocks of scan lines */
+  PlusStatus BinarizeEdgeMagnitude(vtkImageData* edgeImage, vtkImageData* binaryImage);
+
+  /*! Remove pixels of a scan line that are darker than the maximum minus three times the standard deviation */
+  static void ThresholdScanLineViaStdDeviation(unsigned char* scanLinePixels, int numberOfPixels);
+
 protected:
   vtkSmartPointer<vtkPlusUsScanConvert>     ScanConverter;
   vtkSmartPointer<vtkImageGaussianSmooth>   GaussianSmooth; // Trying to incorporate existing GaussianSmooth vtkThreadedAlgorithm class
@@ -151,6 +191,7 @@ protected:
   int BonePushBackPx;
 
   bool SaveIntermediateResults;
+  bool UseFusedProcessing;
   std::string IntermediateImageFileName;
   std::vector<char*> IntermediatePostfixes;
 
@@ -165,6 +206,15 @@ protected:
   std::vector<std::map<std::string, int> > BoneAreasInfo;
   bool FirstFrame;
 
+  /*! Binarized edge magnitude image, used in fused processing */
+  vtkSmartPointer<vtkImageData> BinaryEdgeImage;
+  /*! Scan converted output image, reused between frames in fused processing */
+  vtkSmartPointer<vtkImageData> FanImage;
+  /*! Input image pixel index of each lines image pixel, -1 if the pixel is outside of the input image */
+  std::vector<vtkIdType> ScanLineSampleIndices;
+  /*! Input image extent and number of components, lines image extent and scan line end points that ScanLineSampleIndices were computed for */
+  std::vector<double> ScanLineSampleIndicesParameters;
+
 private:
   vtkPlusBoneEnhancer(const vtkPlusBoneEnhancer&);  // Not implemented.
   void operator=(const vtkPlusBoneEnhancer&);  // Not implemented.
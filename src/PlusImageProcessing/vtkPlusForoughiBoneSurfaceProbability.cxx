@@ -18,7 +18,9 @@ See License.txt for details.
 #include <vtkTimerLog.h>
 
 // STD includes
+#include <algorithm>
 #include <cassert>
+#include <string.h>
 
 // Other includes
 #include "mkl.h"
@@ -59,8 +61,17 @@ vtkPlusForoughiBoneSurfaceProbability::vtkPlusForoughiBoneSurfaceProbability()
   this->MklReflectionNumberBuffer = NULL;
   this->MklShadowValueBuffer = NULL;
   this->MklShadowModel = NULL;
+  this->MklShadowModelCumulativeSum = NULL;
+  this->MklColumnSuffixSumBuffer = NULL;
   this->MklGaussianKernel = NULL;
   this->MklLaplacianKernel = NULL;
+  this->ShadowModelFullWeightStart = 0;
+
+  this->GaussianFilteringTimeSec = 0.0;
+  this->LaplacianFilteringTimeSec = 0.0;
+  this->ReflectionAndShadowTimeSec = 0.0;
+  this->NormalizationTimeSec = 0.0;
+  this->BoneSurfaceProbabilityTimeSec = 0.0;
 }
 
 //----------------------------------------------------------------------------
@@ -97,17 +108,13 @@ void vtkPlusForoughiBoneSurfaceProbability::SimpleExecute(vtkImageData* input, v
     this->KernelUpdateRequested = false;
   }
 
-  int* dims = input->GetDimensions();
-  unsigned int nx = this->FrameSize[0];
-  unsigned int ny = this->FrameSize[1];
+  const int nx = static_cast<int>(this->FrameSize[0]);
+  const int ny = static_cast<int>(this->FrameSize[1]);
   unsigned int sliceSize = this->FrameSize[0] * this->FrameSize[1];
 
-  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
-
   // Loop through each slice
-  for (unsigned int sliceIdx = inputExtent[4]; sliceIdx <= inputExtent[5]; ++sliceIdx)
+  for (int sliceIdx = inputExtent[4]; sliceIdx <= inputExtent[5]; ++sliceIdx)
   {
-    LOG_INFO("---------------");
     // Index of slice in buffer
     double* inputSlicePtr = static_cast<double*>(input->GetScalarPointer(0, 0, sliceIdx));
     double* outputSlicePtr = static_cast<double*>(output->GetScalarPointer(0, 0, sliceIdx));
@@ -116,36 +123,55 @@ void vtkPlusForoughiBoneSurfaceProbability::SimpleExecute(vtkImageData* input, v
     //if (GetMaxPixelValue(inputSlicePtr, sliceSize) > 0) // this is expensive and always true (except error cases)
     {
       // Convolve with Gaussian kernel and normalize result between zero and one
-      timer->StartTimer();
-      Conv2(inputSlicePtr, this->MklGaussianKernel, this->MklGaussianBufferTemp, this->MklGaussianBuffer, static_cast<int>(this->FrameSize[0]), static_cast<int>(this->FrameSize[1]), this->GaussianKernelSize, this->GaussianKernelSize);
-      timer->StopTimer();
-      LOG_INFO("Conv2 1: " << timer->GetElapsedTime());
-
-      timer->StartTimer();
+      double stageStartTime = vtkTimerLog::GetUniversalTime();
+      Conv2(inputSlicePtr, this->MklGaussianKernel, this->MklGaussianBufferTemp, this->MklGaussianBuffer, nx, ny, this->GaussianKernelSize, this->GaussianKernelSize);
       Normalize(this->MklGaussianBuffer, sliceSize, false);
-      timer->StopTimer();
-      LOG_INFO("Normalize 1: " << timer->GetElapsedTime());
+      double stageEndTime = vtkTimerLog::GetUniversalTime();
+      this->GaussianFilteringTimeSec = stageEndTime - stageStartTime;
 
       // Convolve blurred image with Laplacian kernel
-      timer->StartTimer();
-      Conv2(this->MklGaussianBuffer, this->MklLaplacianKernel, this->MklLaplacianOfGaussianBufferTemp, this->MklLaplacianOfGaussianBuffer, static_cast<int>(this->FrameSize[0]), static_cast<int>(this->FrameSize[1]), 3, 3);
-      timer->StopTimer();
-      LOG_INFO("Conv2 2: " << timer->GetElapsedTime());
+      stageStartTime = stageEndTime;
+      Conv2(this->MklGaussianBuffer, this->MklLaplacianKernel, this->MklLaplacianOfGaussianBufferTemp, this->MklLaplacianOfGaussianBuffer, nx, ny, 3, 3);
+      stageEndTime = vtkTimerLog::GetUniversalTime();
+      this->LaplacianFilteringTimeSec = stageEndTime - stageStartTime;
 
       // Main loop calculating reflection number and shadow value
-      timer->StartTimer();
-      double sumG = 0;
-      double sumGI = 0;
-      double sumHist = 0;
-      int i, pixelIdx, x, y;
+      stageStartTime = stageEndTime;
+
+      // Shadow value of a pixel is the weighted average of the pixels below it in the same column:
+      // sum(ShadowModel[k]*I[y+k]) / sum(ShadowModel[k]) for k = 0..ny-1-y.
+      // The shadow model is exactly 1 for ShadowModelFullWeightStart <= k < ny-5 (and 0 above), so that part of the
+      // weighted sum is a plain sum of pixel values, which is computed from column-wise suffix sums.
+      // This makes the computation O(nx*ny) instead of O(nx*ny*ny).
+      double* columnSuffixSum = this->MklColumnSuffixSumBuffer;
+      memset(columnSuffixSum + static_cast<size_t>(ny) * nx, 0, nx * sizeof(double));
+      for (int y = ny - 1; y >= 0; --y)
+      {
+        const double* gaussianRow = this->MklGaussianBuffer + static_cast<size_t>(y) * nx;
+        const double* nextSuffixSumRow = columnSuffixSum + static_cast<size_t>(y + 1) * nx;
+        double* suffixSumRow = columnSuffixSum + static_cast<size_t>(y) * nx;
+        for (int x = 0; x < nx; ++x)
+        {
+          suffixSumRow[x] = nextSuffixSumRow[x] + gaussianRow[x];
+        }
+      }
+
+      const int shadowModelFullWeightStart = this->ShadowModelFullWeightStart;
+      int y;
 #ifdef NDEBUG
-      #pragma omp parallel for reduction(+:sumG,sumGI, sumHist), private(i, x, pixelIdx)
+      #pragma omp parallel for
 #endif
       for (y = 0; y < ny; ++y)
       {
-        for (x = 0; x < nx; ++x)
+        // Sum of the shadow model weights is the same for the whole row
+        const double sumG = this->MklShadowModelCumulativeSum[ny - y];
+        // Rows below y that are weighted with a shadow model value that is not 1
+        const int numberOfWeightedRows = std::min(shadowModelFullWeightStart, ny - y);
+        // Last row that is weighted with 1 (rows after ny-6 have zero weight)
+        const int lastFullWeightRow = y + std::min(ny - 1 - y, ny - 6);
+        for (int x = 0; x < nx; ++x)
         {
-          pixelIdx = x + y * nx;
+          int pixelIdx = x + y * nx;
 
           // Only include pixels with intensity value larger than a specified threshold
           if (this->MklGaussianBuffer[pixelIdx] >= this->BoneThreshold && pixelIdx > this->TransducerMargin * nx)
@@ -165,12 +191,14 @@ void vtkPlusForoughiBoneSurfaceProbability::SimpleExecute(vtkImageData* input, v
             this->MklReflectionNumberBuffer[pixelIdx] = pow(this->MklGaussianBuffer[pixelIdx], this->BlurredVSBLoG) + this->MklLaplacianOfGaussianBuffer[pixelIdx];
 
             // Calculate shadow value
-            sumG = 0;
-            sumGI = 0;
-            for (i = y; i < ny; ++i)
+            double sumGI = 0;
+            for (int k = 0; k < numberOfWeightedRows; ++k)
+            {
+              sumGI += this->MklShadowModel[k] * this->MklGaussianBuffer[x + (y + k) * nx];
+            }
+            if (y + shadowModelFullWeightStart <= lastFullWeightRow)
             {
-              sumG += this->MklShadowModel[i - y];
-              sumGI += this->MklShadowModel[i - y] * this->MklGaussianBuffer[x + i * nx];
+              sumGI += columnSuffixSum[x + (y + shadowModelFullWeightStart) * nx] - columnSuffixSum[x + (lastFullWeightRow + 1) * nx];
             }
             this->MklShadowValueBuffer[pixelIdx] = sumGI / sumG;
           }
@@ -182,28 +210,29 @@ void vtkPlusForoughiBoneSurfaceProbability::SimpleExecute(vtkImageData* input, v
         }
       }
 
-      timer->StopTimer();
-      LOG_INFO("Main processing: " << timer->GetElapsedTime());
+      stageEndTime = vtkTimerLog::GetUniversalTime();
+      this->ReflectionAndShadowTimeSec = stageEndTime - stageStartTime;
 
       // Normalize both reflection numbers and shadow values
-      timer->StartTimer();
+      stageStartTime = stageEndTime;
       Normalize(this->MklReflectionNumberBuffer, sliceSize, false);
       Normalize(this->MklShadowValueBuffer, sliceSize, true);
-      timer->StopTimer();
-      LOG_INFO("Normalize 2x: " << timer->GetElapsedTime());
+      stageEndTime = vtkTimerLog::GetUniversalTime();
+      this->NormalizationTimeSec = stageEndTime - stageStartTime;
 
-      // Calculate BSP
-      timer->StartTimer();
+      // Calculate BSP and normalize it
+      stageStartTime = stageEndTime;
       vdPowx(sliceSize, this->MklShadowValueBuffer, this->ShadowVSIntensity, this->MklShadowValueBuffer);
       vdMul(sliceSize, this->MklShadowValueBuffer, this->MklReflectionNumberBuffer, outputSlicePtr);
-      timer->StopTimer();
-      LOG_INFO("Non-linear transform: " << timer->GetElapsedTime());
-
-      // Normalize BSP
-      timer->StartTimer();
       Normalize(outputSlicePtr, sliceSize, false, 255);
-      timer->StopTimer();
-      LOG_INFO("Normalize 3: " << timer->GetElapsedTime());
+      stageEndTime = vtkTimerLog::GetUniversalTime();
+      this->BoneSurfaceProbabilityTimeSec = stageEndTime - stageStartTime;
+
+      LOG_DEBUG("Bone surface probability computation time (slice " << sliceIdx << "): Gaussian filtering: " << this->GaussianFilteringTimeSec * 1000.0 << " ms"
+                << ", Laplacian filtering: " << this->LaplacianFilteringTimeSec * 1000.0 << " ms"
+                << ", reflection and shadow: " << this->ReflectionAndShadowTimeSec * 1000.0 << " ms"
+                << ", normalization: " << this->NormalizationTimeSec * 1000.0 << " ms"
+                << ", bone surface probability: " << this->BoneSurfaceProbabilityTimeSec * 1000.0 << " ms");
     }
   }
 }
@@ -223,6 +252,8 @@ void vtkPlusForoughiBoneSurfaceProbability::UpdateKernels()
   this->MklReflectionNumberBuffer = (double*)mkl_malloc(this->FrameSize[0] * this->FrameSize[1] * sizeof(double), 64);
   this->MklShadowValueBuffer = (double*)mkl_malloc(this->FrameSize[0] * this->FrameSize[1] * sizeof(double), 64);
   this->MklShadowModel = (double*)mkl_malloc(this->FrameSize[1] * sizeof(double), 64);
+  this->MklShadowModelCumulativeSum = (double*)mkl_malloc((this->FrameSize[1] + 1) * sizeof(double), 64);
+  this->MklColumnSuffixSumBuffer = (double*)mkl_malloc(this->FrameSize[0] * (this->FrameSize[1] + 1) * sizeof(double), 64);
   this->MklGaussianKernel = (double*)mkl_malloc(GaussianKernelSize * GaussianKernelSize * sizeof(double), 64);
   this->MklLaplacianKernel = (double*)mkl_malloc(3 * 3 * sizeof(double), 64);
 
@@ -239,6 +270,23 @@ void vtkPlusForoughiBoneSurfaceProbability::UpdateKernels()
     }
   }
 
+  // Sum of the first n shadow model values, added in the same order as in a direct summation
+  this->MklShadowModelCumulativeSum[0] = 0.0;
+  for (int i = 0; i < this->FrameSize[1]; ++i)
+  {
+    this->MklShadowModelCumulativeSum[i + 1] = this->MklShadowModelCumulativeSum[i] + this->MklShadowModel[i];
+  }
+
+  // Shadow model values converge to 1, after a few times ShadowSigma they are exactly 1 in double precision
+  this->ShadowModelFullWeightStart = 0;
+  for (int i = 0; i < static_cast<int>(this->FrameSize[1]) - 5; ++i)
+  {
+    if (this->MklShadowModel[i] != 1.0)
+    {
+      this->ShadowModelFullWeightStart = i + 1;
+    }
+  }
+
   // Calculate Gaussian kernel
   int idx = 0;
   int intervall = (GaussianKernelSize - 1) / 2;
@@ -274,6 +322,8 @@ void vtkPlusForoughiBoneSurfaceProbability::DeleteKernels()
   MKL_FREE_IF_NULL(this->MklReflectionNumberBuffer);
   MKL_FREE_IF_NULL(this->MklShadowValueBuffer);
   MKL_FREE_IF_NULL(this->MklShadowModel);
+  MKL_FREE_IF_NULL(this->MklShadowModelCumulativeSum);
+  MKL_FREE_IF_NULL(this->MklColumnSuffixSumBuffer);
   MKL_FREE_IF_NULL(this->MklGaussianKernel);
   MKL_FREE_IF_NULL(this->MklLaplacianKernel);
 }
@@ -292,11 +342,7 @@ void vtkPlusForoughiBoneSurfaceProbability::Conv2(const double* inputBuffer, con
   status = vsldConvExec(task, inputBuffer, NULL, kernelBuffer, NULL, tempBuffer, NULL);
   vslConvDeleteTask(&task);
 
-  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
-  timer->StartTimer();
   ResizeMatrix(tempBuffer, outputBuffer, kx, ky, nx + kx - 1, ny + ky - 1);
-  timer->StopTimer();
-  LOG_INFO("Resizematrix: " << timer->GetElapsedTime());
 }
 
 //-----------------------------------------------------------------------------
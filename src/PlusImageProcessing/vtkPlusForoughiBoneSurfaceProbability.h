@@ -62,6 +62,17 @@ public:
   vtkSetMacro(TransducerMargin, int);
   vtkGetMacro(TransducerMargin, int);
 
+  /*! Time spent on Gaussian filtering of the last processed slice, in seconds */
+  vtkGetMacro(GaussianFilteringTimeSec, double);
+  /*! Time spent on Laplacian filtering of the last processed slice, in seconds */
+  vtkGetMacro(LaplacianFilteringTimeSec, double);
+  /*! Time spent on computing reflection numbers and shadow values of the last processed slice, in seconds */
+  vtkGetMacro(ReflectionAndShadowTimeSec, double);
+  /*! Time spent on normalization of reflection numbers and shadow values of the last processed slice, in seconds */
+  vtkGetMacro(NormalizationTimeSec, double);
+  /*! Time spent on computing the bone surface probability from reflection numbers and shadow values of the last processed slice, in seconds */
+  vtkGetMacro(BoneSurfaceProbabilityTimeSec, double);
+
 protected:
   vtkPlusForoughiBoneSurfaceProbability();
   virtual ~vtkPlusForoughiBoneSurfaceProbability();
@@ -96,9 +107,22 @@ protected:
   double* MklReflectionNumberBuffer;
   double* MklShadowValueBuffer;
   double* MklShadowModel;
+  /*! MklShadowModelCumulativeSum[n] is the sum of the first n values of the shadow model */
+  double* MklShadowModelCumulativeSum;
+  /*! Column-wise sum of the blurred image pixels from each row to the bottom of the image (with an extra zero row at the end) */
+  double* MklColumnSuffixSumBuffer;
   double* MklGaussianKernel;
   double* MklLaplacianKernel;
 
+  /*! Shadow model values from this index (until the last 5 values, which are 0) are exactly 1 */
+  int ShadowModelFullWeightStart;
+
+  double GaussianFilteringTimeSec;
+  double LaplacianFilteringTimeSec;
+  double ReflectionAndShadowTimeSec;
+  double NormalizationTimeSec;
+  double BoneSurfaceProbabilityTimeSec;
+
 private:
   vtkPlusForoughiBoneSurfaceProbability(const vtkPlusForoughiBoneSurfaceProbability&);  // Not implemented.
   void operator=(const vtkPlusForoughiBoneSurfaceProbability&);  // Not implemented.
@@ -12,6 +12,14 @@ See License.txt for details.
 #include "vtkPlusUsScanConvertLinear.h"
 #include "vtkPlusUsScanConvertCurvilinear.h"
 #include "vtkImageData.h"
+#include "vtkInformation.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <math.h>
+#include <string.h>
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPlusRfProcessor);
@@ -19,11 +27,35 @@ vtkStandardNewMacro(vtkPlusRfProcessor);
 const char* vtkPlusRfProcessor::RF_PROCESSOR_TAG_NAME = "RfProcessing";
 //----------------------------------------------------------------------------
 
+namespace
+{
+  // Number of output image rows in a fused processing tile. The brightness samples of a tile are
+  // small enough to remain in the cache until they are interpolated.
+  const int FUSED_PROCESSING_TILE_ROWS = 32;
+
+  // Rounding and clamping of interpolated values, same as in vtkPlusUsScanConvertLinear
+  inline unsigned char RoundAndClampBrightness(double value)
+  {
+    if (value <= 0.0)
+    {
+      return 0;
+    }
+    if (value >= static_cast<double>(std::numeric_limits<unsigned char>::max()))
+    {
+      return std::numeric_limits<unsigned char>::max();
+    }
+    return static_cast<unsigned char>(floor(value + 0.5));
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkPlusRfProcessor::vtkPlusRfProcessor()
 {
   this->RfToBrightnessConverter=vtkPlusRfToBrightnessConvert::New();
   this->ScanConverter=NULL;  
+  this->UseFusedProcessing=false;
+  this->FusedOutputImage=vtkImageData::New();
+  this->FusedProcessingFallbackReported=false;
 }
 
 //----------------------------------------------------------------------------
@@ -32,12 +64,16 @@ vtkPlusRfProcessor::~vtkPlusRfProcessor()
   SetScanConverter(NULL);
   this->RfToBrightnessConverter->Delete();
   this->RfToBrightnessConverter=NULL;  
+  this->FusedOutputImage->Delete();
+  this->FusedOutputImage=NULL;
 }
 
 //----------------------------------------------------------------------------
 void vtkPlusRfProcessor::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+  os << indent << "UseFusedProcessing: " << (this->UseFusedProcessing ? "true" : "false") << "\n";
+  os << indent << "NumberOfFusedProcessingTiles: " << this->FusedProcessingTiles.size() << "\n";
 }
 
 //-----------------------------------------------------------------------------
@@ -63,6 +99,18 @@ vtkImageData* vtkPlusRfProcessor::GetBrightnessScanConvertedImage()
     LOG_ERROR("Scan converter is not defined, skipping scan conversion");
     return GetBrightnessConvertedImage();
   }
+  if (this->UseFusedProcessing)
+  {
+    if (ComputeFusedBrightnessScanConvertedImage()==PLUS_SUCCESS)
+    {
+      return this->FusedOutputImage;
+    }
+    if (!this->FusedProcessingFallbackReported)
+    {
+      LOG_WARNING("Fused RF processing is not available for the current input image and scan converter, brightness and scan conversion are computed separately");
+      this->FusedProcessingFallbackReported=true;
+    }
+  }
   this->ScanConverter->Update();
   return this->ScanConverter->GetOutput();
 }
@@ -80,6 +128,8 @@ void vtkPlusRfProcessor::SetScanConverter(vtkPlusUsScanConvert* scanConverter)
     this->ScanConverter=NULL;
   }    
   this->ScanConverter=scanConverter;
+  this->FusedProcessingTiles.clear();
+  this->FusedProcessingTileParameters.clear();
   if (scanConverter!=NULL)
   {
     this->ScanConverter->Register(this);
@@ -94,6 +144,9 @@ PlusStatus vtkPlusRfProcessor::ReadConfiguration(vtkXMLDataElement* rfProcessing
 
   PlusStatus status=PLUS_SUCCESS;
 
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(UseFusedProcessing, rfProcessingElement);
+  this->FusedProcessingFallbackReported=false;
+
   vtkXMLDataElement* brightnessConversionElement = rfProcessingElement->FindNestedElementWithName("RfToBrightnessConversion"); 
   if (brightnessConversionElement)
   {
@@ -168,6 +221,11 @@ PlusStatus vtkPlusRfProcessor::WriteConfiguration(vtkXMLDataElement* rfElement)
 
   PlusStatus status(PLUS_SUCCESS);
 
+  if (this->UseFusedProcessing || rfElement->GetAttribute("UseFusedProcessing")!=NULL)
+  {
+    rfElement->SetAttribute("UseFusedProcessing", this->UseFusedProcessing ? "TRUE" : "FALSE");
+  }
+
   if ( this->RfToBrightnessConverter->WriteConfiguration(brightnessConversionElement) != PLUS_SUCCESS )
   {
     status = PLUS_FAIL;
@@ -195,3 +253,372 @@ const char* vtkPlusRfProcessor::GetRfProcessorTagName()
 {
   return vtkPlusRfProcessor::RF_PROCESSOR_TAG_NAME;
 }
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusRfProcessor::ComputeFusedBrightnessScanConvertedImage()
+{
+  vtkImageData* rfImage = vtkImageData::SafeDownCast(this->RfToBrightnessConverter->GetInput());
+  if (rfImage == NULL)
+  {
+    LOG_ERROR("Fused RF processing failed: RF frame is not set");
+    return PLUS_FAIL;
+  }
+
+  // Update the brightness image extent and the scan conversion interpolation tables (pixel data is not computed)
+  this->ScanConverter->UpdateInformation();
+  int brightnessImageExtent[6] = {0, -1, 0, -1, 0, -1};
+  this->RfToBrightnessConverter->GetOutputInformation(0)->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), brightnessImageExtent);
+  if (brightnessImageExtent[4] != brightnessImageExtent[5])
+  {
+    LOG_DEBUG("Fused RF processing is only available for single-slice images");
+    return PLUS_FAIL;
+  }
+  int* outputImageExtent = this->ScanConverter->GetOutputImageExtent();
+
+  // Recompute the tiles if the scan conversion parameters or the image size have changed
+  std::vector<double> tileParameters;
+  for (int i = 0; i < 6; i++)
+  {
+    tileParameters.push_back(brightnessImageExtent[i]);
+    tileParameters.push_back(outputImageExtent[i]);
+  }
+  tileParameters.push_back(this->ScanConverter->GetMTime());
+  bool tilesRecomputed = false;
+  if (tileParameters != this->FusedProcessingTileParameters)
+  {
+    this->FusedProcessingTileParameters.clear();
+    if (ComputeFusedProcessingTiles(brightnessImageExtent) != PLUS_SUCCESS)
+    {
+      this->FusedProcessingTiles.clear();
+      return PLUS_FAIL;
+    }
+    this->FusedProcessingTileParameters = tileParameters;
+    tilesRecomputed = true;
+  }
+
+  // Pixels that are not computed by the scan conversion are 0. Only the computed pixels are updated in each frame.
+  int* currentExtent = this->FusedOutputImage->GetExtent();
+  bool extentChanged = false;
+  for (int i = 0; i < 6; i++)
+  {
+    if (currentExtent[i] != outputImageExtent[i])
+    {
+      extentChanged = true;
+    }
+  }
+  if (extentChanged || this->FusedOutputImage->GetScalarPointer() == NULL || this->FusedOutputImage->GetScalarType() != VTK_UNSIGNED_CHAR)
+  {
+    this->FusedOutputImage->SetExtent(outputImageExtent);
+    // In Plus the convention is that the image coordinate system has always unit spacing and zero origin
+    this->FusedOutputImage->SetSpacing(1.0, 1.0, 1.0);
+    this->FusedOutputImage->SetOrigin(0.0, 0.0, 0.0);
+    this->FusedOutputImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    tilesRecomputed = true;
+  }
+  if (tilesRecomputed)
+  {
+    int* dimensions = this->FusedOutputImage->GetDimensions();
+    memset(this->FusedOutputImage->GetScalarPointer(), 0, static_cast<size_t>(dimensions[0]) * dimensions[1] * dimensions[2]);
+  }
+
+  unsigned int numberOfTiles = static_cast<unsigned int>(this->FusedProcessingTiles.size());
+  unsigned int numberOfWorkers = std::min(PlusCommon::GetNumberOfWorkerThreads(0), numberOfTiles);
+  if (numberOfWorkers == 0)
+  {
+    // empty output image
+    this->FusedOutputImage->Modified();
+    return PLUS_SUCCESS;
+  }
+  if (this->RfToBrightnessConverter->PrepareScanlineBrightnessComputation(rfImage, numberOfWorkers) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  if (this->FusedProcessingTileBuffers.size() < numberOfWorkers)
+  {
+    this->FusedProcessingTileBuffers.resize(numberOfWorkers);
+  }
+
+  // Each worker has its own brightness buffer and takes the next unprocessed tile until all tiles are done
+  std::atomic<unsigned int> nextTileIndex(0);
+  std::atomic<bool> tileFailed(false);
+  PlusCommon::ParallelFor(numberOfWorkers, [&](unsigned int workerIndex)
+  {
+    for (unsigned int tileIndex = nextTileIndex++; tileIndex < numberOfTiles; tileIndex = nextTileIndex++)
+    {
+      if (ComputeFusedProcessingTile(rfImage, this->FusedProcessingTiles[tileIndex], workerIndex) != PLUS_SUCCESS)
+      {
+        tileFailed = true;
+      }
+    }
+  }, numberOfWorkers);
+
+  this->FusedOutputImage->Modified();
+  return tileFailed ? PLUS_FAIL : PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusRfProcessor::ComputeFusedProcessingTiles(int brightnessImageExtent[6])
+{
+  this->FusedProcessingTiles.clear();
+
+  int numberOfSamples = brightnessImageExtent[1] - brightnessImageExtent[0] + 1;
+  int numberOfScanlines = brightnessImageExtent[3] - brightnessImageExtent[2] + 1;
+  int* outputImageExtent = this->ScanConverter->GetOutputImageExtent();
+  int outputImageWidth = outputImageExtent[1] - outputImageExtent[0] + 1;
+  int outputImageHeight = outputImageExtent[3] - outputImageExtent[2] + 1;
+  if (numberOfSamples <= 0 || numberOfScanlines <= 0 || outputImageWidth <= 0 || outputImageHeight <= 0)
+  {
+    LOG_DEBUG("Fused RF processing is not available for empty images");
+    return PLUS_FAIL;
+  }
+
+  int numberOfTiles = (outputImageHeight + FUSED_PROCESSING_TILE_ROWS - 1) / FUSED_PROCESSING_TILE_ROWS;
+  std::vector<FusedProcessingTile> tiles(numberOfTiles);
+  for (int tileIndex = 0; tileIndex < numberOfTiles; tileIndex++)
+  {
+    FusedProcessingTile& tile = tiles[tileIndex];
+    tile.FirstOutputRow = tileIndex * FUSED_PROCESSING_TILE_ROWS;
+    tile.LastOutputRow = std::min(tile.FirstOutputRow + FUSED_PROCESSING_TILE_ROWS, outputImageHeight) - 1;
+    tile.FirstSample.assign(numberOfScanlines, numberOfSamples);
+    tile.LastSample.assign(numberOfScanlines, -1);
+    tile.BufferSize = 0;
+    tile.FirstPoint = 0;
+    tile.NumberOfPoints = 0;
+  }
+
+  vtkPlusUsScanConvertCurvilinear* scanConvertCurvilinear = vtkPlusUsScanConvertCurvilinear::SafeDownCast(this->ScanConverter);
+  vtkPlusUsScanConvertLinear* scanConvertLinear = vtkPlusUsScanConvertLinear::SafeDownCast(this->ScanConverter);
+  if (scanConvertCurvilinear != NULL)
+  {
+    // Each point is interpolated from a 2x2 neighborhood: samples (s, s+1) of scanlines (l, l+1)
+    const std::vector<vtkPlusUsScanConvertCurvilinear::InterpolatedPoint>& points = scanConvertCurvilinear->GetInterpolatedPointArray();
+    for (int pointIndex = 0; pointIndex < static_cast<int>(points.size()); pointIndex++)
+    {
+      int outputRow = points[pointIndex].outputPixelIndex / outputImageWidth;
+      int sample = points[pointIndex].inputPixelIndex % numberOfSamples;
+      int scanline = points[pointIndex].inputPixelIndex / numberOfSamples;
+      if (outputRow >= outputImageHeight || sample + 1 >= numberOfSamples || scanline + 1 >= numberOfScanlines)
+      {
+        LOG_ERROR("Fused RF processing failed: scan conversion interpolation table does not match the image size");
+        return PLUS_FAIL;
+      }
+      // Points are ordered by output pixel index, so the points of a tile are contiguous in the table
+      FusedProcessingTile& tile = tiles[outputRow / FUSED_PROCESSING_TILE_ROWS];
+      if (tile.NumberOfPoints == 0)
+      {
+        tile.FirstPoint = pointIndex;
+      }
+      else if (tile.FirstPoint + tile.NumberOfPoints != pointIndex)
+      {
+        LOG_ERROR("Fused RF processing failed: scan conversion interpolation table is not ordered by output pixel index");
+        return PLUS_FAIL;
+      }
+      tile.NumberOfPoints++;
+      for (int neighborScanline = scanline; neighborScanline <= scanline + 1; neighborScanline++)
+      {
+        tile.FirstSample[neighborScanline] = std::min(tile.FirstSample[neighborScanline], sample);
+        tile.LastSample[neighborScanline] = std::max(tile.LastSample[neighborScanline], sample + 1);
+      }
+    }
+  }
+  else if (scanConvertLinear != NULL)
+  {
+    // Separable interpolation: rows select samples, columns select scanlines
+    const vtkPlusUsScanConvertLinear::AxisInterpolationTable& rowTable = scanConvertLinear->GetRowInterpolationTable();
+    const vtkPlusUsScanConvertLinear::AxisInterpolationTable& columnTable = scanConvertLinear->GetColumnInterpolationTable();
+    if (static_cast<int>(rowTable.FirstIndex.size()) != outputImageHeight || static_cast<int>(columnTable.FirstIndex.size()) != outputImageWidth)
+    {
+      LOG_ERROR("Fused RF processing failed: scan conversion interpolation table does not match the image size");
+      return PLUS_FAIL;
+    }
+    std::vector<bool> scanlineUsed(numberOfScanlines, false);
+    for (int column = 0; column < outputImageWidth; column++)
+    {
+      if (columnTable.FirstIndex[column] < 0)
+      {
+        continue;
+      }
+      if (columnTable.FirstIndex[column] >= numberOfScanlines || columnTable.SecondIndex[column] >= numberOfScanlines)
+      {
+        LOG_ERROR("Fused RF processing failed: scan conversion interpolation table does not match the image size");
+        return PLUS_FAIL;
+      }
+      scanlineUsed[columnTable.FirstIndex[column]] = true;
+      scanlineUsed[columnTable.SecondIndex[column]] = true;
+    }
+    for (int tileIndex = 0; tileIndex < numberOfTiles; tileIndex++)
+    {
+      FusedProcessingTile& tile = tiles[tileIndex];
+      int firstSample = numberOfSamples;
+      int lastSample = -1;
+      for (int row = tile.FirstOutputRow; row <= tile.LastOutputRow; row++)
+      {
+        if (rowTable.FirstIndex[row] < 0)
+        {
+          continue;
+        }
+        if (rowTable.FirstIndex[row] >= numberOfSamples || rowTable.SecondIndex[row] >= numberOfSamples)
+        {
+          LOG_ERROR("Fused RF processing failed: scan conversion interpolation table does not match the image size");
+          return PLUS_FAIL;
+        }
+        firstSample = std::min(firstSample, rowTable.FirstIndex[row]);
+        lastSample = std::max(lastSample, rowTable.SecondIndex[row]);
+      }
+      for (int scanline = 0; scanline < numberOfScanlines; scanline++)
+      {
+        if (scanlineUsed[scanline])
+        {
+          tile.FirstSample[scanline] = firstSample;
+          tile.LastSample[scanline] = lastSample;
+        }
+      }
+    }
+  }
+  else
+  {
+    LOG_DEBUG("Fused RF processing is not available for " << this->ScanConverter->GetTransducerGeometry() << " scan conversion");
+    return PLUS_FAIL;
+  }
+
+  // Samples of each scanline are stored one after the other in the tile buffer
+  for (int tileIndex = 0; tileIndex < numberOfTiles; tileIndex++)
+  {
+    FusedProcessingTile& tile = tiles[tileIndex];
+    tile.BufferOffset.resize(numberOfScanlines);
+    for (int scanline = 0; scanline < numberOfScanlines; scanline++)
+    {
+      tile.BufferOffset[scanline] = tile.BufferSize;
+      if (tile.FirstSample[scanline] <= tile.LastSample[scanline])
+      {
+        tile.BufferSize += tile.LastSample[scanline] - tile.FirstSample[scanline] + 1;
+      }
+    }
+    if (scanConvertCurvilinear != NULL)
+    {
+      const std::vector<vtkPlusUsScanConvertCurvilinear::InterpolatedPoint>& points = scanConvertCurvilinear->GetInterpolatedPointArray();
+      tile.PointBufferIndex.resize(2 * tile.NumberOfPoints);
+      for (int i = 0; i < tile.NumberOfPoints; i++)
+      {
+        int inputPixelIndex = points[tile.FirstPoint + i].inputPixelIndex;
+        int sample = inputPixelIndex % numberOfSamples;
+        int scanline = inputPixelIndex / numberOfSamples;
+        tile.PointBufferIndex[2 * i] = tile.BufferOffset[scanline] + sample - tile.FirstSample[scanline];
+        tile.PointBufferIndex[2 * i + 1] = tile.BufferOffset[scanline + 1] + sample - tile.FirstSample[scanline + 1];
+      }
+    }
+  }
+
+  this->FusedProcessingTiles.swap(tiles);
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusRfProcessor::ComputeFusedProcessingTile(vtkImageData* rfImage, const FusedProcessingTile& tile, int workerIndex)
+{
+  // Compute the brightness samples that the tile uses
+  std::vector<unsigned char>& tileBuffer = this->FusedProcessingTileBuffers[workerIndex];
+  if (static_cast<int>(tileBuffer.size()) < tile.BufferSize + 1)
+  {
+    tileBuffer.resize(tile.BufferSize + 1);
+  }
+  unsigned char* brightness = &tileBuffer[0];
+  int numberOfScanlines = static_cast<int>(tile.FirstSample.size());
+  for (int scanline = 0; scanline < numberOfScanlines; scanline++)
+  {
+    if (tile.FirstSample[scanline] > tile.LastSample[scanline])
+    {
+      continue;
+    }
+    if (this->RfToBrightnessConverter->ComputeScanlineBrightness(rfImage, scanline, tile.FirstSample[scanline], tile.LastSample[scanline],
+        brightness + tile.BufferOffset[scanline], workerIndex) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+
+  // Interpolate the output pixels, the same way as the scan converter filters do
+  unsigned char* outputPixels = static_cast<unsigned char*>(this->FusedOutputImage->GetScalarPointer());
+  vtkPlusUsScanConvertCurvilinear* scanConvertCurvilinear = vtkPlusUsScanConvertCurvilinear::SafeDownCast(this->ScanConverter);
+  vtkPlusUsScanConvertLinear* scanConvertLinear = vtkPlusUsScanConvertLinear::SafeDownCast(this->ScanConverter);
+  if (scanConvertCurvilinear != NULL)
+  {
+    const int* pointBufferIndex = tile.PointBufferIndex.empty() ? NULL : &tile.PointBufferIndex[0];
+    if (scanConvertCurvilinear->GetUseFixedPointInterpolation() && scanConvertCurvilinear->IsFixedPointInterpolationAvailable())
+    {
+      const vtkPlusUsScanConvertCurvilinear::FixedPointInterpolationTable& table = scanConvertCurvilinear->GetFixedPointInterpolationTable();
+      for (int i = 0; i < tile.NumberOfPoints; i++)
+      {
+        int pointIndex = tile.FirstPoint + i;
+        const unsigned char* scanlinePixels = brightness + pointBufferIndex[2 * i];
+        const unsigned char* nextScanlinePixels = brightness + pointBufferIndex[2 * i + 1];
+        vtkTypeUInt32 value =
+          static_cast<vtkTypeUInt32>(table.WeightCoefficients[0][pointIndex]) * scanlinePixels[0]
+          + static_cast<vtkTypeUInt32>(table.WeightCoefficients[1][pointIndex]) * scanlinePixels[1]
+          + static_cast<vtkTypeUInt32>(table.WeightCoefficients[2][pointIndex]) * nextScanlinePixels[0]
+          + static_cast<vtkTypeUInt32>(table.WeightCoefficients[3][pointIndex]) * nextScanlinePixels[1]
+          + (1 << (vtkPlusUsScanConvertCurvilinear::FIXED_POINT_WEIGHT_BITS - 1)); // for rounding
+        outputPixels[table.OutputPixelIndex[pointIndex]] = static_cast<unsigned char>(value >> vtkPlusUsScanConvertCurvilinear::FIXED_POINT_WEIGHT_BITS);
+      }
+    }
+    else
+    {
+      const vtkPlusUsScanConvertCurvilinear::InterpolatedPoint* points = tile.NumberOfPoints > 0 ? &scanConvertCurvilinear->GetInterpolatedPointArray()[tile.FirstPoint] : NULL;
+      for (int i = 0; i < tile.NumberOfPoints; i++)
+      {
+        const unsigned char* scanlinePixels = brightness + pointBufferIndex[2 * i];
+        const unsigned char* nextScanlinePixels = brightness + pointBufferIndex[2 * i + 1];
+        outputPixels[points[i].outputPixelIndex] =
+          points[i].weightCoefficients[0] * scanlinePixels[0] // (+0, +0)
+          + points[i].weightCoefficients[1] * scanlinePixels[1] // (+1, +0)
+          + points[i].weightCoefficients[2] * nextScanlinePixels[0] // (+0, +1)
+          + points[i].weightCoefficients[3] * nextScanlinePixels[1] // (+1, +1)
+          + 0.5; // for rounding
+      }
+    }
+  }
+  else if (scanConvertLinear != NULL)
+  {
+    const vtkPlusUsScanConvertLinear::AxisInterpolationTable& rowTable = scanConvertLinear->GetRowInterpolationTable();
+    const vtkPlusUsScanConvertLinear::AxisInterpolationTable& columnTable = scanConvertLinear->GetColumnInterpolationTable();
+    bool linearInterpolation = (scanConvertLinear->GetInterpolation() == vtkPlusUsScanConvertLinear::LINEAR_INTERPOLATION);
+    int rowLength = static_cast<int>(columnTable.FirstIndex.size());
+    for (int row = tile.FirstOutputRow; row <= tile.LastOutputRow; row++)
+    {
+      unsigned char* outRow = outputPixels + static_cast<vtkIdType>(row) * rowLength;
+      if (rowTable.FirstIndex[row] < 0)
+      {
+        // the whole row is outside the input image
+        memset(outRow, 0, rowLength);
+        continue;
+      }
+      int rowFirstSample = rowTable.FirstIndex[row];
+      int rowSecondSample = rowTable.SecondIndex[row];
+      double rowSecondWeight = rowTable.SecondWeight[row];
+      double rowFirstWeight = 1.0 - rowSecondWeight;
+      for (int i = 0; i < rowLength; i++)
+      {
+        int firstScanline = columnTable.FirstIndex[i];
+        if (firstScanline < 0)
+        {
+          outRow[i] = 0;
+          continue;
+        }
+        // Position of sample 0 of the scanline in the tile buffer (samples before the tile range are not stored)
+        int firstScanlineOffset = tile.BufferOffset[firstScanline] - tile.FirstSample[firstScanline];
+        if (!linearInterpolation)
+        {
+          outRow[i] = brightness[firstScanlineOffset + rowFirstSample];
+          continue;
+        }
+        // Linear interpolation: interpolate along the scanline first, then between the scanlines
+        int secondScanline = columnTable.SecondIndex[i];
+        int secondScanlineOffset = tile.BufferOffset[secondScanline] - tile.FirstSample[secondScanline];
+        double firstLineValue = rowFirstWeight * brightness[firstScanlineOffset + rowFirstSample] + rowSecondWeight * brightness[firstScanlineOffset + rowSecondSample];
+        double secondLineValue = rowFirstWeight * brightness[secondScanlineOffset + rowFirstSample] + rowSecondWeight * brightness[secondScanlineOffset + rowSecondSample];
+        outRow[i] = RoundAndClampBrightness(firstLineValue + columnTable.SecondWeight[i] * (secondLineValue - firstLineValue));
+      }
+    }
+  }
+  return PLUS_SUCCESS;
+}
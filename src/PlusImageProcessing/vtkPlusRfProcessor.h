@@ -9,6 +9,8 @@
 
 #include "vtkPlusImageProcessingExport.h"
 
+#include <vector>
+
 class vtkPlusRfToBrightnessConvert;
 class vtkPlusUsScanConvert;
 class vtkImageData;
@@ -16,6 +18,12 @@ class vtkImageData;
 /*!
   \class vtkPlusRfProcessor 
   \brief Convenience class to combine multiple algorithms to compute a displayable B-mode frame from RF data
+
+  By default the brightness conversion and the scan conversion are separate VTK filters: the complete brightness image
+  is computed and then it is scan converted. If fused processing is enabled then the scan converted image is computed
+  in one pass: the output image is processed in tiles of rows, for each tile only those brightness samples are computed
+  that the scan conversion uses and they are interpolated into the output image right away, while they are still in the cache.
+
   \ingroup PlusLibImageProcessingAlgo
 */ 
 class vtkPlusImageProcessingExport vtkPlusRfProcessor : public vtkObject
@@ -51,17 +59,66 @@ public:
   /*! Get the rf to brightness converter object */
   vtkGetMacro(RfToBrightnessConverter, vtkPlusRfToBrightnessConvert*);
 
+  /*!
+    If enabled then GetBrightnessScanConvertedImage computes the brightness and scan conversion in one pass (see class description).
+    The output is the same as with separate filters. If fused processing is not possible for the current input and scan converter
+    then the separate filters are used.
+  */
+  vtkSetMacro(UseFusedProcessing, bool);
+  vtkGetMacro(UseFusedProcessing, bool);
+  vtkBooleanMacro(UseFusedProcessing, bool);
+
   static const char* GetRfProcessorTagName();
 
 protected:
   vtkPlusRfProcessor();
   virtual ~vtkPlusRfProcessor(); 
 
+  /*! Output image rows that are computed together in fused processing and the brightness samples that they use */
+  struct FusedProcessingTile
+  {
+    int FirstOutputRow;
+    int LastOutputRow;
+    /*! For each scanline: first and last brightness sample used by the tile. If FirstSample>LastSample then the scanline is not used. */
+    std::vector<int> FirstSample;
+    std::vector<int> LastSample;
+    /*! For each scanline: position of the first used sample in the tile brightness buffer */
+    std::vector<int> BufferOffset;
+    /*! Number of brightness samples used by the tile */
+    int BufferSize;
+    /*! Curvilinear scan conversion: the tile computes NumberOfPoints points of the interpolation table, starting from FirstPoint */
+    int FirstPoint;
+    int NumberOfPoints;
+    /*! Curvilinear scan conversion: position of the first input pixel of each point and of the pixel in the next scanline in the tile buffer */
+    std::vector<int> PointBufferIndex;
+  };
+
+  /*! Compute the brightness and scan converted image in one pass (see UseFusedProcessing) */
+  virtual PlusStatus ComputeFusedBrightnessScanConvertedImage();
+
+  /*! Compute the FusedProcessingTiles for the current scan converter and brightness image extent */
+  virtual PlusStatus ComputeFusedProcessingTiles(int brightnessImageExtent[6]);
+
+  /*! Compute the output image pixels of a tile. The brightness samples are stored in the tile buffer of the worker. */
+  virtual PlusStatus ComputeFusedProcessingTile(vtkImageData* rfImage, const FusedProcessingTile& tile, int workerIndex);
+
   vtkPlusRfToBrightnessConvert* RfToBrightnessConverter;
 
   vtkPlusUsScanConvert* ScanConverter;  
   std::vector<vtkPlusUsScanConvert*> AvailableScanConverters;  
 
+  /*! Compute brightness and scan conversion in one pass */
+  bool UseFusedProcessing;
+  /*! Output image of fused processing */
+  vtkImageData* FusedOutputImage;
+  std::vector<FusedProcessingTile> FusedProcessingTiles;
+  /*! Parameters that were used for computing the tiles. Tiles are recomputed if any of them changes. */
+  std::vector<double> FusedProcessingTileParameters;
+  /*! Brightness buffer for each worker thread */
+  std::vector< std::vector<unsigned char> > FusedProcessingTileBuffers;
+  /*! The warning about falling back to separate filters is only logged once */
+  bool FusedProcessingFallbackReported;
+
   static const char* RF_PROCESSOR_TAG_NAME;
 }; 
 
@@ -15,19 +15,32 @@ See License.txt for details.
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkMath.h"
 
+#include <algorithm>
+#include <limits>
 #include <math.h>
+#include <string.h>
 
 vtkStandardNewMacro(vtkPlusRfToBrightnessConvert);
 
 const double MIN_BRIGHTNESS_VALUE = 0.0;
 const double MAX_BRIGHTNESS_VALUE = 255.0;
 
+// Number of output samples that are computed together in the Hilbert transform convolution (small enough to stay in the L1 cache)
+const int HILBERT_TRANSFORM_BLOCK_SIZE = 256;
+
+// Number of mantissa bits that are used for indexing the brightness lookup table. With 6 bits a bucket is 1.6% wide,
+// while two brightness levels are at least 3.2% apart (because brightness is the 8th root of the squared amplitude).
+const int BRIGHTNESS_LUT_MANTISSA_BITS = 6;
+// Squared amplitude range covered by the lookup table: [1, 2^BRIGHTNESS_LUT_NUMBER_OF_EXPONENTS)
+const int BRIGHTNESS_LUT_NUMBER_OF_EXPONENTS = 64;
+
 //----------------------------------------------------------------------------
 vtkPlusRfToBrightnessConvert::vtkPlusRfToBrightnessConvert()
 {
   this->ImageType = US_IMG_TYPE_XX;
   this->BrightnessScale = 10.0;
   this->NumberOfHilbertFilterCoeffs = 64;
+  this->BrightnessLookupTableScale = 0.0;
 }
 
 //----------------------------------------------------------------------------
@@ -101,6 +114,22 @@ int vtkPlusRfToBrightnessConvert::RequestInformation(vtkInformation*,
   return 1;
 }
 
+//----------------------------------------------------------------------------
+int vtkPlusRfToBrightnessConvert::RequestData(vtkInformation* request,
+    vtkInformationVector** inputVector,
+    vtkInformationVector* outputVector)
+{
+  // Shared data is updated here, before the threads are started
+  ComputeHilbertTransformCoeffs();
+  ComputeBrightnessLookupTable();
+  if (static_cast<int>(this->ThreadScratchBuffers.size()) < this->GetNumberOfThreads())
+  {
+    this->ThreadScratchBuffers.resize(this->GetNumberOfThreads());
+  }
+
+  return this->Superclass::RequestData(request, inputVector, outputVector);
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusRfToBrightnessConvert::ThreadedRequestData(
   vtkInformation* vtkNotUsed(request),
@@ -240,7 +269,16 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
     return;
   }
 
-  ScalarType* hilbertTransformBuffer = new ScalarType[numberOfRfSamplesInScanline + 1];
+  // Scratch buffers are reused between frames. If the filter is executed in more pieces than threads then
+  // the buffers cannot be shared, so temporary buffers are used.
+  ScanlineScratchBuffers temporaryScratchBuffers;
+  ScanlineScratchBuffers& scratchBuffers = (threadId >= 0 && threadId < static_cast<int>(this->ThreadScratchBuffers.size())) ?
+      this->ThreadScratchBuffers[threadId] : temporaryScratchBuffers;
+
+  // The Hilbert transform filter reads one sample after the scanline, which is the first sample of the next scanline
+  // (or zero after the last scanline)
+  int* inDataExt = inData[0][0]->GetExtent();
+
   for (int idx2 = outExt[4]; idx2 <= outExt[5]; ++idx2)
   {
     for (int idx1 = outExt[2]; !this->AbortExecute && idx1 <= outExt[3]; ++idx1)
@@ -273,8 +311,10 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
           {
             // e.g., Ultrasonix
             // RF data: IIIII..., IIIII...
-            ComputeHilbertTransform(hilbertTransformBuffer, inPtr, numberOfRfSamplesInScanline);
-            ComputeAmplitudeILineQLine(outPtr, inPtr, hilbertTransformBuffer, numberOfRfSamplesInScanline);
+            bool lastScanlineInMemory = (idx1 == inDataExt[3] && idx2 == inDataExt[5]);
+            ScalarType sampleAfterScanline = lastScanlineInMemory ? 0 : inPtr[numberOfRfSamplesInScanline];
+            ComputeHilbertTransform(scratchBuffers, inPtr, sampleAfterScanline, numberOfRfSamplesInScanline);
+            ComputeAmplitudeILineQLine(outPtr, inPtr, &scratchBuffers.HilbertTransformed[0], numberOfRfSamplesInScanline);
             inPtr += numberOfRfSamplesInScanline + inInc1;
             outPtr += numberOfBmodeSamplesInScanline + outInc1;
           }
@@ -298,9 +338,6 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
   {
     LOG_ERROR("Unsupported image type for brightness conversion: "<< igsioCommon::GetStringFromUsImageType(this->ImageType));
   }
-
-  delete[] hilbertTransformBuffer;
-  hilbertTransformBuffer = NULL;
 }
 
 void vtkPlusRfToBrightnessConvert::PrintSelf(ostream& os, vtkIndent indent)
@@ -346,6 +383,11 @@ void vtkPlusRfToBrightnessConvert::ComputeHilbertTransformCoeffs()
     // From http://www.vbforums.com/archive/index.php/t-639223.html
     this->HilbertTransformCoeffs[i] = 1 / ((i - this->NumberOfHilbertFilterCoeffs / 2) - 0.5) / vtkMath::Pi();
   }
+  this->ReversedHilbertTransformCoeffs.resize(this->NumberOfHilbertFilterCoeffs);
+  for (int i = 0; i < this->NumberOfHilbertFilterCoeffs; i++)
+  {
+    this->ReversedHilbertTransformCoeffs[i] = this->HilbertTransformCoeffs[this->NumberOfHilbertFilterCoeffs - i];
+  }
 
   bool debugOutput = false; // print Hilbert transform coefficients in Matlab format
   if (debugOutput)
@@ -367,40 +409,142 @@ void vtkPlusRfToBrightnessConvert::ComputeHilbertTransformCoeffs()
   }
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusRfToBrightnessConvert::ComputeBrightnessLookupTable()
+{
+  if (this->BrightnessLookupTableScale == this->BrightnessScale && !this->BrightnessLookupTable.empty())
+  {
+    // already computed for the current brightness scale
+    return;
+  }
+  this->BrightnessLookupTableScale = this->BrightnessScale;
+  this->BrightnessLookupTable.clear();
+  this->BrightnessLookupTableNextThreshold.clear();
+
+  // Smallest (integer) squared amplitude for each brightness level. Brightness is a monotonic function of
+  // the squared amplitude, so the thresholds can be found by binary search.
+  const double maxSquaredAmplitude = ldexp(1.0, BRIGHTNESS_LUT_NUMBER_OF_EXPONENTS) - 1;
+  const vtkTypeUInt64 maxSquaredAmplitudeInt = std::numeric_limits<vtkTypeUInt64>::max();
+  std::vector<double> brightnessThresholds(static_cast<int>(MAX_BRIGHTNESS_VALUE) + 3, std::numeric_limits<double>::infinity());
+  for (int brightness = 0; brightness <= MAX_BRIGHTNESS_VALUE; brightness++)
+  {
+    if (ComputeBrightness(maxSquaredAmplitude) < brightness)
+    {
+      // this brightness is never reached
+      continue;
+    }
+    vtkTypeUInt64 low = 0;
+    vtkTypeUInt64 high = maxSquaredAmplitudeInt;
+    while (low < high)
+    {
+      vtkTypeUInt64 middle = low + (high - low) / 2;
+      if (ComputeBrightness(static_cast<double>(middle)) >= brightness)
+      {
+        high = middle;
+      }
+      else
+      {
+        low = middle + 1;
+      }
+    }
+    brightnessThresholds[brightness] = static_cast<double>(low);
+  }
+
+  const int bucketsPerExponent = 1 << BRIGHTNESS_LUT_MANTISSA_BITS;
+  const int numberOfBuckets = BRIGHTNESS_LUT_NUMBER_OF_EXPONENTS * bucketsPerExponent;
+  std::vector<unsigned char> lookupTable(numberOfBuckets);
+  std::vector<double> nextThreshold(numberOfBuckets);
+  for (int bucketIndex = 0; bucketIndex < numberOfBuckets; bucketIndex++)
+  {
+    int exponent = bucketIndex / bucketsPerExponent;
+    int mantissa = bucketIndex % bucketsPerExponent;
+    double bucketStart = ldexp(1.0 + double(mantissa) / bucketsPerExponent, exponent);
+    double bucketEnd = ldexp(1.0 + double(mantissa + 1) / bucketsPerExponent, exponent);
+    unsigned char brightness = ComputeBrightness(bucketStart);
+    lookupTable[bucketIndex] = brightness;
+    nextThreshold[bucketIndex] = brightnessThresholds[brightness + 1];
+    if (brightnessThresholds[brightness + 2] < bucketEnd)
+    {
+      // more than two brightness levels in one bucket (should not happen), use the formula instead
+      LOG_WARNING("Brightness lookup table cannot be used, brightness is computed for each pixel");
+      return;
+    }
+  }
+  this->BrightnessLookupTable.swap(lookupTable);
+  this->BrightnessLookupTableNextThreshold.swap(nextThreshold);
+}
+
+//-----------------------------------------------------------------------------
+unsigned char vtkPlusRfToBrightnessConvert::ComputeBrightness(double squaredAmplitude) const
+{
+  double brightnessValue = sqrt(sqrt(sqrt(squaredAmplitude))) * this->BrightnessScale;
+  if (brightnessValue > MAX_BRIGHTNESS_VALUE) { brightnessValue = MAX_BRIGHTNESS_VALUE; }
+  if (brightnessValue < MIN_BRIGHTNESS_VALUE) { brightnessValue = MIN_BRIGHTNESS_VALUE; }
+  return static_cast<unsigned char>(brightnessValue);
+}
+
+//-----------------------------------------------------------------------------
+inline unsigned char vtkPlusRfToBrightnessConvert::GetBrightness(double squaredAmplitude) const
+{
+  if (squaredAmplitude < 1.0 || this->BrightnessLookupTable.empty())
+  {
+    return ComputeBrightness(squaredAmplitude);
+  }
+  // Bucket index is made of the exponent and the highest bits of the mantissa (IEEE 754 double precision format)
+  vtkTypeUInt64 bits = 0;
+  memcpy(&bits, &squaredAmplitude, sizeof(bits));
+  size_t bucketIndex = static_cast<size_t>(bits >> (52 - BRIGHTNESS_LUT_MANTISSA_BITS)) - (static_cast<size_t>(1023) << BRIGHTNESS_LUT_MANTISSA_BITS);
+  if (bucketIndex >= this->BrightnessLookupTable.size())
+  {
+    return ComputeBrightness(squaredAmplitude);
+  }
+  unsigned char brightness = this->BrightnessLookupTable[bucketIndex];
+  if (squaredAmplitude >= this->BrightnessLookupTableNextThreshold[bucketIndex])
+  {
+    brightness++;
+  }
+  return brightness;
+}
+
+//-----------------------------------------------------------------------------
 template<typename ScalarType>
-PlusStatus vtkPlusRfToBrightnessConvert::ComputeHilbertTransform(ScalarType* hilbertTransformOutput, ScalarType* input, int npt)
+PlusStatus vtkPlusRfToBrightnessConvert::ComputeHilbertTransform(ScanlineScratchBuffers& scratch, ScalarType* input, ScalarType sampleAfterInput, int npt)
 {
-  ComputeHilbertTransformCoeffs(); // update the transform coefficients if needed
+  std::vector<double>& hilbertTransformOutput = scratch.HilbertTransformed;
+  hilbertTransformOutput.resize(npt + 1);
 
   if (npt < this->NumberOfHilbertFilterCoeffs)
   {
     LOG_ERROR("Insufficient data for performing Hilbert transform");
+    std::fill(hilbertTransformOutput.begin(), hilbertTransformOutput.end(), 0.0);
     return PLUS_FAIL;
   }
 
-  // Compute Hilbert transform by convolution
-  for (int l = 1; l <= npt - this->NumberOfHilbertFilterCoeffs + 1; l++)
+  // Convert the input to floating-point once. Samples 1..npt are used by the filter (sample npt is after the input).
+  std::vector<double>& signal = scratch.Signal;
+  signal.resize(npt + 1);
+  for (int i = 0; i < npt; i++)
   {
-    double yt = 0.0;
-    for (int i = 1; i <= this->NumberOfHilbertFilterCoeffs; i++)
-    {
-      yt += input[l + i - 1] * this->HilbertTransformCoeffs[this->NumberOfHilbertFilterCoeffs + 1 - i];
-    }
-    hilbertTransformOutput[l] = yt;
+    signal[i] = input[i];
   }
+  signal[npt] = sampleAfterInput;
+
+  // Compute Hilbert transform by convolution
+  const int numberOfCoeffs = this->NumberOfHilbertFilterCoeffs;
+  ComputeHilbertFilterOutput<ScalarType>(&signal[1], &hilbertTransformOutput[1], npt - numberOfCoeffs + 1);
 
   // Shift this->NumberOfHilbertFilterCoeffs/1+1/2 points
-  for (int i = 1; i <= npt - this->NumberOfHilbertFilterCoeffs; i++)
+  for (int i = 1; i <= npt - numberOfCoeffs; i++)
   {
-    hilbertTransformOutput[i] = 0.5 * (hilbertTransformOutput[i] + hilbertTransformOutput[i + 1]);
+    hilbertTransformOutput[i] = static_cast<ScalarType>(0.5 * (hilbertTransformOutput[i] + hilbertTransformOutput[i + 1]));
   }
-  for (int i = npt - this->NumberOfHilbertFilterCoeffs; i >= 1; i--)
+  if (npt - numberOfCoeffs > 0)
   {
-    hilbertTransformOutput[i + this->NumberOfHilbertFilterCoeffs / 2] = hilbertTransformOutput[i];
+    memmove(&hilbertTransformOutput[1 + numberOfCoeffs / 2], &hilbertTransformOutput[1], (npt - numberOfCoeffs) * sizeof(double));
   }
 
   // Pad by zeros
-  for (int i = 1; i <= this->NumberOfHilbertFilterCoeffs / 2; i++)
+  for (int i = 1; i <= numberOfCoeffs / 2; i++)
   {
     hilbertTransformOutput[i] = 0.0;
     hilbertTransformOutput[npt + 1 - i] = 0.0;
@@ -409,8 +553,227 @@ PlusStatus vtkPlusRfToBrightnessConvert::ComputeHilbertTransform(ScalarType* hil
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
 template<typename ScalarType>
-void vtkPlusRfToBrightnessConvert::ComputeAmplitudeILineQLine(unsigned char* ampl, ScalarType* inputSignal, ScalarType* inputSignalHilbertTransformed, int npt)
+void vtkPlusRfToBrightnessConvert::ComputeHilbertFilterOutput(const double* signal, double* output, int numberOfOutputSamples)
+{
+  // For each output sample the products are added in the same order as in a direct convolution, but the loops
+  // are swapped (coefficients in the outer loop), so consecutive output samples can be computed in parallel.
+  const int numberOfCoeffs = this->NumberOfHilbertFilterCoeffs;
+  const double* coeffs = &this->ReversedHilbertTransformCoeffs[0];
+  for (int blockStart = 0; blockStart < numberOfOutputSamples; blockStart += HILBERT_TRANSFORM_BLOCK_SIZE)
+  {
+    const int blockLength = std::min(HILBERT_TRANSFORM_BLOCK_SIZE, numberOfOutputSamples - blockStart);
+    double* outputBlock = output + blockStart;
+    std::fill(outputBlock, outputBlock + blockLength, 0.0);
+    for (int i = 0; i < numberOfCoeffs; i++)
+    {
+      const double coeff = coeffs[i];
+      const double* inputBlock = signal + blockStart + i;
+      for (int l = 0; l < blockLength; l++)
+      {
+        outputBlock[l] += inputBlock[l] * coeff;
+      }
+    }
+    // The result is stored with the input pixel type
+    for (int l = 0; l < blockLength; l++)
+    {
+      outputBlock[l] = static_cast<ScalarType>(outputBlock[l]);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusRfToBrightnessConvert::PrepareScanlineBrightnessComputation(vtkImageData* rfImage, int numberOfThreads)
+{
+  if (rfImage == NULL || rfImage->GetScalarPointer() == NULL)
+  {
+    LOG_ERROR("Cannot compute scanline brightness: RF image is not available");
+    return PLUS_FAIL;
+  }
+  int* extent = rfImage->GetExtent();
+  if (extent[4] != extent[5] || rfImage->GetNumberOfScalarComponents() != 1)
+  {
+    LOG_DEBUG("Scanline brightness computation requires a single-slice, single-component RF image");
+    return PLUS_FAIL;
+  }
+  int scalarType = rfImage->GetScalarType();
+  switch (this->ImageType)
+  {
+    case US_IMG_BRIGHTNESS:
+      if (scalarType != VTK_UNSIGNED_CHAR)
+      {
+        LOG_DEBUG("Scanline brightness computation requires VTK_UNSIGNED_CHAR pixel type for brightness images");
+        return PLUS_FAIL;
+      }
+      break;
+    case US_IMG_RF_I_LINE_Q_LINE:
+    case US_IMG_RF_REAL:
+    case US_IMG_RF_IQ_LINE:
+      if (scalarType != VTK_SHORT && scalarType != VTK_INT)
+      {
+        LOG_DEBUG("Scanline brightness computation requires VTK_SHORT or VTK_INT pixel type for RF images");
+        return PLUS_FAIL;
+      }
+      break;
+    default:
+      LOG_DEBUG("Scanline brightness computation is not supported for image type: " << igsioCommon::GetStringFromUsImageType(this->ImageType));
+      return PLUS_FAIL;
+  }
+
+  ComputeHilbertTransformCoeffs();
+  ComputeBrightnessLookupTable();
+  if (static_cast<int>(this->ThreadScratchBuffers.size()) < numberOfThreads)
+  {
+    this->ThreadScratchBuffers.resize(numberOfThreads);
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusRfToBrightnessConvert::ComputeScanlineBrightness(vtkImageData* rfImage, int scanlineIndex, int firstSample, int lastSample, unsigned char* brightness, int threadId)
+{
+  if (threadId < 0 || threadId >= static_cast<int>(this->ThreadScratchBuffers.size()))
+  {
+    LOG_ERROR("Invalid thread index for scanline brightness computation: " << threadId);
+    return PLUS_FAIL;
+  }
+  switch (rfImage->GetScalarType())
+  {
+    case VTK_SHORT:
+      return ComputeScanlineBrightnessTemplated<short>(rfImage, scanlineIndex, firstSample, lastSample, brightness, threadId);
+    case VTK_INT:
+      return ComputeScanlineBrightnessTemplated<int>(rfImage, scanlineIndex, firstSample, lastSample, brightness, threadId);
+    case VTK_UNSIGNED_CHAR:
+      return ComputeScanlineBrightnessTemplated<unsigned char>(rfImage, scanlineIndex, firstSample, lastSample, brightness, threadId);
+    default:
+      LOG_ERROR("Unsupported pixel type for scanline brightness computation: " << rfImage->GetScalarTypeAsString());
+      return PLUS_FAIL;
+  }
+}
+
+//-----------------------------------------------------------------------------
+template<typename ScalarType>
+PlusStatus vtkPlusRfToBrightnessConvert::ComputeScanlineBrightnessTemplated(vtkImageData* rfImage, int scanlineIndex, int firstSample, int lastSample, unsigned char* brightness, int threadId)
+{
+  int* extent = rfImage->GetExtent();
+  const int numberOfRfSamplesInScanline = extent[1] - extent[0] + 1;
+  const int numberOfRfRows = extent[3] - extent[2] + 1;
+  int numberOfBmodeSamplesInScanline = numberOfRfSamplesInScanline;
+  int numberOfBmodeScanlines = numberOfRfRows;
+  if (this->ImageType == US_IMG_RF_I_LINE_Q_LINE)
+  {
+    numberOfBmodeScanlines = numberOfRfRows / 2;
+  }
+  else if (this->ImageType == US_IMG_RF_IQ_LINE)
+  {
+    numberOfBmodeSamplesInScanline = numberOfRfSamplesInScanline / 2;
+  }
+  if (scanlineIndex < 0 || scanlineIndex >= numberOfBmodeScanlines || firstSample < 0 || lastSample >= numberOfBmodeSamplesInScanline || firstSample > lastSample)
+  {
+    LOG_ERROR("Requested scanline segment is out of the brightness image: scanline " << scanlineIndex << ", samples " << firstSample << "-" << lastSample);
+    return PLUS_FAIL;
+  }
+
+  vtkIdType rowIncrement = rfImage->GetIncrements()[1];
+  ScalarType* rfData = static_cast<ScalarType*>(rfImage->GetScalarPointer());
+  const int numberOfSamples = lastSample - firstSample + 1;
+  const int halfNumberOfCoeffs = this->NumberOfHilbertFilterCoeffs / 2;
+
+  switch (this->ImageType)
+  {
+    case US_IMG_BRIGHTNESS:
+      {
+        memcpy(brightness, rfData + scanlineIndex * rowIncrement + firstSample, numberOfSamples);
+      }
+      break;
+    case US_IMG_RF_IQ_LINE:
+      {
+        // RF data: IQIQIQ....., IQIQIQIQ.....
+        ScalarType* inputSignal = rfData + scanlineIndex * rowIncrement;
+        for (int i = firstSample; i <= lastSample; i++)
+        {
+          double xt = inputSignal[2 * i];
+          double xht = inputSignal[2 * i + 1];
+          brightness[i - firstSample] = GetBrightness(xt * xt + xht * xht);
+        }
+      }
+      break;
+    case US_IMG_RF_I_LINE_Q_LINE:
+      {
+        // RF data: IIIIIII..., QQQQQQ...., IIIIIII..., QQQQQQ....
+        // Samples closer to the scanline ends than half of the filter length are set to 0 (same as in ComputeAmplitudeILineQLine)
+        ScalarType* originalSignal = rfData + 2 * scanlineIndex * rowIncrement;
+        ScalarType* phaseShiftedSignal = originalSignal + rowIncrement;
+        memset(brightness, 0, numberOfSamples);
+        int firstValidSample = std::max(firstSample, halfNumberOfCoeffs + 1);
+        int lastValidSample = std::min(lastSample, numberOfRfSamplesInScanline - halfNumberOfCoeffs);
+        for (int i = firstValidSample; i <= lastValidSample; i++)
+        {
+          double xt = originalSignal[i];
+          double xht = phaseShiftedSignal[i];
+          brightness[i - firstSample] = GetBrightness(xt * xt + xht * xht);
+        }
+      }
+      break;
+    case US_IMG_RF_REAL:
+      {
+        // RF data: IIIII..., IIIII...
+        ScalarType* inputSignal = rfData + scanlineIndex * rowIncrement;
+        const int npt = numberOfRfSamplesInScanline;
+        memset(brightness, 0, numberOfSamples);
+        int firstValidSample = std::max(firstSample, halfNumberOfCoeffs + 1);
+        int lastValidSample = std::min(lastSample, npt - halfNumberOfCoeffs);
+        if (npt < this->NumberOfHilbertFilterCoeffs || firstValidSample > lastValidSample)
+        {
+          // no samples with non-zero brightness in the requested range
+          break;
+        }
+
+        // Hilbert transformed sample i is the average of the filter outputs i-halfNumberOfCoeffs and i-halfNumberOfCoeffs+1
+        // (see ComputeHilbertTransform). Filter outputs are defined in [1, npt-NumberOfHilbertFilterCoeffs+1].
+        const int lastFilterOutputIndex = npt - this->NumberOfHilbertFilterCoeffs + 1;
+        const int firstRequiredFilterOutput = firstValidSample - halfNumberOfCoeffs;
+        const int lastRequiredFilterOutput = std::min(lastValidSample - halfNumberOfCoeffs + 1, lastFilterOutputIndex);
+        const int numberOfFilterOutputs = lastRequiredFilterOutput - firstRequiredFilterOutput + 1;
+
+        // The filter window of the last output sample contains one sample after the scanline (the first sample of the next scanline, or zero)
+        ScalarType sampleAfterScanline = (scanlineIndex == numberOfRfRows - 1) ? 0 : inputSignal[npt];
+        ScanlineScratchBuffers& scratch = this->ThreadScratchBuffers[threadId];
+        scratch.Signal.resize(numberOfFilterOutputs + this->NumberOfHilbertFilterCoeffs - 1);
+        for (int i = 0; i < static_cast<int>(scratch.Signal.size()); i++)
+        {
+          int inputIndex = firstRequiredFilterOutput + i;
+          scratch.Signal[i] = (inputIndex < npt) ? inputSignal[inputIndex] : sampleAfterScanline;
+        }
+        scratch.HilbertTransformed.resize(numberOfFilterOutputs);
+        ComputeHilbertFilterOutput<ScalarType>(&scratch.Signal[0], &scratch.HilbertTransformed[0], numberOfFilterOutputs);
+
+        const double* filterOutput = &scratch.HilbertTransformed[0];
+        for (int i = firstValidSample; i <= lastValidSample; i++)
+        {
+          int filterOutputIndex = i - halfNumberOfCoeffs - firstRequiredFilterOutput;
+          // After the last averaged filter output (only with odd number of coefficients) the Hilbert transform is 0
+          double xht = 0.0;
+          if (filterOutputIndex + firstRequiredFilterOutput < lastFilterOutputIndex)
+          {
+            xht = static_cast<ScalarType>(0.5 * (filterOutput[filterOutputIndex] + filterOutput[filterOutputIndex + 1]));
+          }
+          double xt = inputSignal[i];
+          brightness[i - firstSample] = GetBrightness(xt * xt + xht * xht);
+        }
+      }
+      break;
+    default:
+      LOG_ERROR("Unsupported image type for brightness conversion: " << igsioCommon::GetStringFromUsImageType(this->ImageType));
+      return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+template<typename ScalarType, typename HilbertTransformedScalarType>
+void vtkPlusRfToBrightnessConvert::ComputeAmplitudeILineQLine(unsigned char* ampl, ScalarType* inputSignal, HilbertTransformedScalarType* inputSignalHilbertTransformed, int npt)
 {
   for (int i = 0; i < this->NumberOfHilbertFilterCoeffs / 2 + 1; i++)
   {
@@ -420,10 +783,7 @@ void vtkPlusRfToBrightnessConvert::ComputeAmplitudeILineQLine(unsigned char* amp
   {
     double xt = inputSignal[i];
     double xht = inputSignalHilbertTransformed[i];
-    double brightnessValue = sqrt(sqrt(sqrt(xt * xt + xht * xht))) * this->BrightnessScale;
-    if (brightnessValue > MAX_BRIGHTNESS_VALUE) { brightnessValue = MAX_BRIGHTNESS_VALUE; }
-    if (brightnessValue < MIN_BRIGHTNESS_VALUE) { brightnessValue = MIN_BRIGHTNESS_VALUE; }
-    ampl[i] = brightnessValue;
+    ampl[i] = GetBrightness(xt * xt + xht * xht);
     /*
     If needed, the phase could be computed as follows:
     phase[i] = atan2(xht ,xt);
@@ -440,6 +800,7 @@ void vtkPlusRfToBrightnessConvert::ComputeAmplitudeILineQLine(unsigned char* amp
   }
 }
 
+//-----------------------------------------------------------------------------
 template<typename ScalarType>
 void vtkPlusRfToBrightnessConvert::ComputeAmplitudeIqLine(unsigned char* ampl, ScalarType* inputSignal, const int npt)
 {
@@ -450,9 +811,6 @@ void vtkPlusRfToBrightnessConvert::ComputeAmplitudeIqLine(unsigned char* ampl, S
   {
     double xt = inputSignal[inputIndex++];
     double xht = inputSignal[inputIndex++];
-    double outputValue = sqrt(sqrt(sqrt(xt * xt + xht * xht))) * this->BrightnessScale;
-    if (outputValue > MAX_BRIGHTNESS_VALUE) { outputValue = MAX_BRIGHTNESS_VALUE; }
-    if (outputValue < MIN_BRIGHTNESS_VALUE) { outputValue = MIN_BRIGHTNESS_VALUE; }
-    ampl[outputIndex++] = outputValue;
+    ampl[outputIndex++] = GetBrightness(xt * xt + xht * xht);
   }
 }
@@ -10,6 +10,8 @@
 #include "vtkPlusImageProcessingExport.h"
 #include "vtkThreadedImageAlgorithm.h"
 
+#include <vector>
+
 /*!
 \class vtkPlusRfToBrightnessConvert
 \brief This class converts ultrasound RF data to brightness values
@@ -31,6 +33,14 @@ range (16 bits).
 The input image type must be VTK_SHORT (signed 16-bit) and the output image type
 is always VTK_UNSIGNED_CHAR (unsigned 8-bit).
 
+The Hilbert transform filter is applied in blocks of samples, one filter coefficient at a time, which allows
+the compiler to vectorize the convolution while keeping the summation order (and so the result) of the
+direct convolution. Each thread keeps its own scratch buffers, which are reused between frames.
+Dynamic range compression uses a lookup table that gives exactly the same result as the formula above.
+
+Brightness of a segment of a scanline can also be computed without running the filter, by ComputeScanlineBrightness
+(used by vtkPlusRfProcessor for computing only those samples that are needed for scan conversion).
+
 \ingroup PlusLibImageProcessingAlgo
 */ 
 class vtkPlusImageProcessingExport vtkPlusRfToBrightnessConvert : public vtkThreadedImageAlgorithm
@@ -56,6 +66,26 @@ public:
   vtkSetMacro(BrightnessScale, double);
   vtkGetMacro(BrightnessScale, double);
 
+  /*!
+    Prepare computation of scanline segments by ComputeScanlineBrightness: compute the filter coefficients and the
+    lookup table and allocate scratch buffers for numberOfThreads threads.
+    Returns with failure if the image type or pixel type of rfImage is not supported.
+  */
+  virtual PlusStatus PrepareScanlineBrightnessComputation(vtkImageData* rfImage, int numberOfThreads);
+
+  /*!
+    Compute the brightness of samples [firstSample, lastSample] of one scanline of the brightness image directly from
+    the RF image, without computing the rest of the image. The values are the same as the corresponding pixels
+    of the filter output. The method may be called from multiple threads at the same time, with different threadId values
+    (0 <= threadId < numberOfThreads). PrepareScanlineBrightnessComputation must be called before.
+    \param rfImage Input RF image (single slice)
+    \param scanlineIndex Index of the scanline (row) in the brightness image
+    \param firstSample Index of the first sample (column) in the brightness image
+    \param lastSample Index of the last sample (column) in the brightness image
+    \param brightness Output buffer, at least lastSample-firstSample+1 long
+  */
+  virtual PlusStatus ComputeScanlineBrightness(vtkImageData* rfImage, int scanlineIndex, int firstSample, int lastSample, unsigned char* brightness, int threadId);
+
 protected:
   vtkPlusRfToBrightnessConvert();
   ~vtkPlusRfToBrightnessConvert();
@@ -64,26 +94,64 @@ protected:
                                  vtkInformationVector**,
                                  vtkInformationVector* outputVector);
 
+  /*! Prepares the filter coefficients, lookup table and scratch buffers and then executes the filter in multiple threads */
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+
   void ThreadedRequestData( vtkInformation *request,
                             vtkInformationVector **inputVector,
                             vtkInformationVector *outputVector,
                             vtkImageData ***inData, vtkImageData **outData,
                             int outExt[6], int id);
 
+  /*! Buffers that are used by a thread while processing a scanline */
+  struct ScanlineScratchBuffers
+  {
+    /*! Input signal converted to floating-point */
+    std::vector<double> Signal;
+    /*! Filter output, Hilbert transformed signal */
+    std::vector<double> HilbertTransformed;
+  };
+
   /*! Compute the Hilbert transform coefficients. Used by the ComputeHilbertTransform method. */
   virtual void ComputeHilbertTransformCoeffs();
 
+  /*! Compute the brightness lookup table for the current BrightnessScale. Used by the GetBrightness method. */
+  virtual void ComputeBrightnessLookupTable();
+
+  /*! Compute brightness from the squared amplitude using the formula (see class description) */
+  unsigned char ComputeBrightness(double squaredAmplitude) const;
+
+  /*! Get brightness for the squared amplitude. Uses the lookup table if available. */
+  inline unsigned char GetBrightness(double squaredAmplitude) const;
+
   /*! Essentialy, a templated version of ThreadedRequestData */
   template<typename ScalarType>
   void ThreadedLineByLineHilbertTransform(int inExt[6], int outExt[6], vtkImageData ***inData, vtkImageData **outData, int threadId);
 
-  /*! Compute the Hilbert transform (90 deg phase shift) of a signal */
+  /*!
+    Compute the Hilbert transform (90 deg phase shift) of a signal.
+    The filter window starts at the second sample, therefore it uses one sample after the end of the input (sampleAfterInput).
+    Output is written into scratch.HilbertTransformed[1..npt].
+  */
+  template<typename ScalarType>
+  PlusStatus ComputeHilbertTransform(ScanlineScratchBuffers& scratch, ScalarType *input, ScalarType sampleAfterInput, int npt);
+
+  /*!
+    Compute numberOfOutputSamples samples of the Hilbert transform filter output: output[i] is computed from signal[i..i+NumberOfHilbertFilterCoeffs-1].
+    The result is rounded to the input pixel type.
+  */
   template<typename ScalarType>
-  PlusStatus ComputeHilbertTransform(ScalarType *hilbertTransformOutput, ScalarType *input, int npt);
+  void ComputeHilbertFilterOutput(const double* signal, double* output, int numberOfOutputSamples);
+
+  /*! Templated version of ComputeScanlineBrightness */
+  template<typename ScalarType>
+  PlusStatus ComputeScanlineBrightnessTemplated(vtkImageData* rfImage, int scanlineIndex, int firstSample, int lastSample, unsigned char* brightness, int threadId);
   
   /*! Compute amplitude from the original and Hilbert transformed RF data. npt is the number of samples in the input signal */
-  template<typename ScalarType>
-  void ComputeAmplitudeILineQLine(unsigned char *ampl, ScalarType *inputSignal, ScalarType *inputSignalHilbertTransformed, int npt);
+  template<typename ScalarType, typename HilbertTransformedScalarType>
+  void ComputeAmplitudeILineQLine(unsigned char *ampl, ScalarType *inputSignal, HilbertTransformedScalarType *inputSignalHilbertTransformed, int npt);
   
   /*! Compute amplitude from IQ encoded RF data. npt is the number of IQ pairs * 2. */
   template<typename ScalarType>
@@ -98,6 +166,24 @@ protected:
   /*! Coefficients of the Hilbert transform, computed from the NumberOfHilbertFilterCoeffs */
   std::vector<double> HilbertTransformCoeffs;
 
+  /*! Coefficients of the Hilbert transform in reverse order and 0-based indexing, as they are applied in the convolution */
+  std::vector<double> ReversedHilbertTransformCoeffs;
+
+  /*!
+    Brightness lookup table. The squared amplitude range is divided into buckets by the exponent and the
+    high bits of the mantissa of its floating-point representation. A bucket is narrower than the distance
+    between two brightness levels, so the brightness in a bucket is either the value stored in the
+    table or one more (if the squared amplitude reaches the next threshold).
+  */
+  std::vector<unsigned char> BrightnessLookupTable;
+  /*! Smallest squared amplitude where brightness is larger than the lookup table value in the bucket */
+  std::vector<double> BrightnessLookupTableNextThreshold;
+  /*! BrightnessScale that was used for computing the lookup table. The lookup table is not used if it is empty. */
+  double BrightnessLookupTableScale;
+
+  /*! Scratch buffers for each thread */
+  std::vector<ScanlineScratchBuffers> ThreadScratchBuffers;
+
   /*! Image type (RF_IQ_LINE, RF_I_LINE_Q_LINE, ...) */
   US_IMAGE_TYPE ImageType;
 
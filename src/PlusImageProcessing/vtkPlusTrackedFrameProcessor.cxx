@@ -10,6 +10,10 @@ See License.txt for details.
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkIGSIOTransformRepository.h"
 #include "igsioCommon.h"
+#include "igsioTrackedFrame.h"
+
+#include <algorithm>
+#include <atomic>
 
 //----------------------------------------------------------------------------
 vtkCxxSetObjectMacro( vtkPlusTrackedFrameProcessor, InputFrames, vtkIGSIOTrackedFrameList );
@@ -19,6 +23,7 @@ vtkCxxSetObjectMacro( vtkPlusTrackedFrameProcessor, TransformRepository, vtkIGSI
 //----------------------------------------------------------------------------
 vtkPlusTrackedFrameProcessor::vtkPlusTrackedFrameProcessor()
 {
+  this->NumberOfThreads = 1;
   this->InputFrames = NULL;
   this->TransformRepository = NULL;
   this->OutputFrames = vtkIGSIOTrackedFrameList::New();
@@ -37,12 +42,14 @@ vtkPlusTrackedFrameProcessor::~vtkPlusTrackedFrameProcessor()
 void vtkPlusTrackedFrameProcessor::PrintSelf( ostream& os, vtkIndent indent )
 {
   this->Superclass::PrintSelf( os, indent );
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
 }
 
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusTrackedFrameProcessor::ReadConfiguration( vtkXMLDataElement* processingElement )
 {
   XML_VERIFY_ELEMENT( processingElement, this->GetTagName() );
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL( int, NumberOfThreads, processingElement );
   return PLUS_SUCCESS;
 }
 
@@ -51,9 +58,41 @@ PlusStatus vtkPlusTrackedFrameProcessor::WriteConfiguration( vtkXMLDataElement*
 {
   XML_VERIFY_ELEMENT( processingElement, this->GetTagName() );
   processingElement->SetAttribute( "Type", this->GetProcessorTypeName() );
+  if ( this->NumberOfThreads != 1 || processingElement->GetAttribute( "NumberOfThreads" ) != NULL )
+  {
+    processingElement->SetIntAttribute( "NumberOfThreads", this->NumberOfThreads );
+  }
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+vtkPlusTrackedFrameProcessor* vtkPlusTrackedFrameProcessor::Clone()
+{
+  vtkSmartPointer<vtkXMLDataElement> processingElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  processingElement->SetName( this->GetTagName() );
+  if ( this->WriteConfiguration( processingElement ) != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "Failed to write " << this->GetProcessorTypeName() << " configuration" );
+    return NULL;
+  }
+
+  vtkPlusTrackedFrameProcessor* clone = this->NewInstance();
+  if ( clone->ReadConfiguration( processingElement ) != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "Failed to read " << this->GetProcessorTypeName() << " configuration" );
+    clone->Delete();
+    return NULL;
+  }
+
+  if ( this->TransformRepository != NULL )
+  {
+    vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+    transformRepository->DeepCopy( this->TransformRepository, false );
+    clone->SetTransformRepository( transformRepository );
+  }
+  return clone;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusTrackedFrameProcessor::Update()
 {
@@ -63,6 +102,14 @@ PlusStatus vtkPlusTrackedFrameProcessor::Update()
     // nothing to do
     return PLUS_SUCCESS;
   }
+
+  unsigned int numberOfThreads = PlusCommon::GetNumberOfWorkerThreads( this->NumberOfThreads < 0 ? 1 : this->NumberOfThreads );
+  numberOfThreads = std::min( numberOfThreads, this->InputFrames->GetNumberOfTrackedFrames() );
+  if ( numberOfThreads > 1 && this->IsStateless() )
+  {
+    return this->UpdateFrameParallel( numberOfThreads );
+  }
+
   PlusStatus status = PLUS_SUCCESS;
   for ( unsigned int frameIndex = 0; frameIndex < this->InputFrames->GetNumberOfTrackedFrames(); frameIndex++ )
   {
@@ -90,4 +137,60 @@ PlusStatus vtkPlusTrackedFrameProcessor::Update()
   }
 
   return status;
-}
\ No newline at end of file
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusTrackedFrameProcessor::UpdateFrameParallel( unsigned int numberOfThreads )
+{
+  // Processing may modify internal buffers of the processor and the transform repository,
+  // therefore each thread uses its own processor. The first thread uses this processor.
+  std::vector< vtkSmartPointer<vtkPlusTrackedFrameProcessor> > threadProcessors;
+  threadProcessors.push_back( this );
+  for ( unsigned int threadIndex = 1; threadIndex < numberOfThreads; threadIndex++ )
+  {
+    vtkSmartPointer<vtkPlusTrackedFrameProcessor> threadProcessor = vtkSmartPointer<vtkPlusTrackedFrameProcessor>::Take( this->Clone() );
+    if ( threadProcessor == NULL )
+    {
+      LOG_ERROR( "Failed to create " << this->GetProcessorTypeName() << " for parallel processing" );
+      return PLUS_FAIL;
+    }
+    threadProcessors.push_back( threadProcessor );
+  }
+
+  // Each thread takes the next unprocessed frame until all frames are done
+  unsigned int numberOfFrames = this->InputFrames->GetNumberOfTrackedFrames();
+  std::vector<igsioTrackedFrame*> outputFrames( numberOfFrames, static_cast<igsioTrackedFrame*>( NULL ) );
+  std::atomic<unsigned int> nextFrameIndex( 0 );
+  std::atomic<bool> processingFailed( false );
+  PlusCommon::ParallelFor( numberOfThreads, [&]( unsigned int threadIndex )
+  {
+    vtkPlusTrackedFrameProcessor* processor = threadProcessors[threadIndex];
+    for ( unsigned int frameIndex = nextFrameIndex++; frameIndex < numberOfFrames; frameIndex = nextFrameIndex++ )
+    {
+      igsioTrackedFrame* inputFrame = this->InputFrames->GetTrackedFrame( frameIndex );
+      if ( processor->TransformRepository && processor->TransformRepository->SetTransforms( *inputFrame ) != PLUS_SUCCESS )
+      {
+        LOG_ERROR( "Failed to set repository transforms from tracked frame!" );
+        processingFailed = true;
+        continue;
+      }
+
+      outputFrames[frameIndex] = new igsioTrackedFrame( *inputFrame );
+      if ( processor->ProcessFrame( inputFrame, outputFrames[frameIndex] ) != PLUS_SUCCESS )
+      {
+        processingFailed = true;
+      }
+    }
+  }, numberOfThreads );
+
+  // Add output frames in the order of the input frames (frames with failed transform update are skipped, as in sequential processing)
+  for ( unsigned int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++ )
+  {
+    if ( outputFrames[frameIndex] != NULL )
+    {
+      this->OutputFrames->TakeTrackedFrame( outputFrames[frameIndex] );
+    }
+  }
+
+  return processingFailed ? PLUS_FAIL : PLUS_SUCCESS;
+}
@@ -37,8 +37,29 @@ public:
    /*!
      Perform processing. Results are saved to OutputFrames. It calls ProcessFrame for each input frame. The method can be overriden, for example if frames
      are not processed one by one.
+     If the processor is stateless and NumberOfThreads is not 1 then frames are processed in parallel by clones of the processor.
+     Output frames are in the same order as input frames.
    */
   virtual PlusStatus Update();
+
+  /*!
+    Number of threads that process frames in parallel in Update (0 = one thread per processor core, 1 = sequential processing).
+    Only used if the processor is stateless.
+  */
+  vtkSetMacro(NumberOfThreads, int);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /*!
+    Returns true if the result of ProcessFrame only depends on the input frame and the configuration, therefore
+    frames can be processed in any order, by separate instances of the processor.
+  */
+  virtual bool IsStateless() { return false; };
+
+  /*!
+    Create a new processor of the same type with the same configuration and a copy of the transform repository.
+    The default implementation copies the configuration by writing and reading it. The caller must delete the returned object.
+  */
+  virtual vtkPlusTrackedFrameProcessor* Clone();
  
   /*! Get the processed output data. Perform processing if needed. */
   vtkGetObjectMacro(OutputFrames, vtkIGSIOTrackedFrameList);
@@ -65,6 +86,10 @@ protected:
   */
   virtual PlusStatus ProcessFrame(igsioTrackedFrame* inputFrame, igsioTrackedFrame* outputFrame) = 0;
 
+  /*! Process all input frames in parallel on the specified number of threads, each thread using its own processor */
+  PlusStatus UpdateFrameParallel(unsigned int numberOfThreads);
+
+  int NumberOfThreads;
   vtkIGSIOTrackedFrameList* InputFrames;
   vtkIGSIOTransformRepository *TransformRepository;
   vtkIGSIOTrackedFrameList* OutputFrames;
@@ -31,6 +31,7 @@ vtkStandardNewMacro(vtkPlusTransverseProcessEnhancer);
 
 //----------------------------------------------------------------------------
 vtkPlusTransverseProcessEnhancer::vtkPlusTransverseProcessEnhancer() : vtkPlusBoneEnhancer()
+  , UnthresholdedLinesImage(vtkSmartPointer<vtkImageData>::New())
 {
 }
 
@@ -242,6 +243,10 @@ void vtkPlusTransverseProcessEnhancer::CompareShadowAreas(vtkSmartPointer<vtkIma
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusTransverseProcessEnhancer::ProcessFrame(igsioTrackedFrame* inputFrame, igsioTrackedFrame* outputFrame)
 {
+  if (this->UseFusedProcessing && !this->SaveIntermediateResults)
+  {
+    return this->ProcessFrameFused(inputFrame, outputFrame);
+  }
 
   this->BoneAreasInfo.clear();
 
@@ -268,3 +273,16 @@ PlusStatus vtkPlusTransverseProcessEnhancer::ProcessFrame(igsioTrackedFrame* inp
 
   return PLUS_SUCCESS;
 }
+
+//----------------------------------------------------------------------------
+// Same processing steps as ProcessFrame, but pixelwise steps are fused and intermediate images are reused
+PlusStatus vtkPlusTransverseProcessEnhancer::ProcessFrameFused(igsioTrackedFrame* inputFrame, igsioTrackedFrame* outputFrame)
+{
+  if (this->RemoveNoiseFused(inputFrame, this->UnthresholdedLinesImage) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  this->RemoveOffCameraBones(this->BinaryImageForMorphology);
+  this->CompareShadowAreas(this->UnthresholdedLinesImage, this->BinaryImageForMorphology);
+  return this->LinearToFanImageFused(this->BinaryImageForMorphology, outputFrame);
+}
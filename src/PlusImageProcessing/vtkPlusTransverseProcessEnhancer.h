@@ -42,6 +42,13 @@ protected:
   vtkPlusTransverseProcessEnhancer();
   virtual ~vtkPlusTransverseProcessEnhancer();
 
+  /*! Process a frame with fused processing steps (see UseFusedProcessing) */
+  PlusStatus ProcessFrameFused(igsioTrackedFrame* inputFrame, igsioTrackedFrame* outputFrame);
+
+protected:
+  /*! Lines image before thresholding, used for comparing shadow areas in fused processing */
+  vtkSmartPointer<vtkImageData> UnthresholdedLinesImage;
+
 private:
   vtkPlusTransverseProcessEnhancer(const vtkPlusTransverseProcessEnhancer&);  // Not implemented.
   void operator=(const vtkPlusTransverseProcessEnhancer&);  // Not implemented.
@@ -14,6 +14,7 @@ non-commercial terms in your toolbox and distribute it."
 
 #include "PlusConfigure.h"
 #include "igsioCommon.h"
+#include "PixelCodec.h"
 
 #include "vtkPlusUsScanConvertCurvilinear.h"
 
@@ -32,6 +33,22 @@ non-commercial terms in your toolbox and distribute it."
 #include <string.h>
 #include <ctype.h>
 
+// The AVX2 kernel is compiled regardless of the compiler flags and used if PixelCodec selected AVX2 at runtime.
+// GCC and Clang need a target attribute on each function that uses the intrinsics, MSVC does not.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #include <immintrin.h>
+  #define SCANCONVERT_X86_SIMD
+  #define SCANCONVERT_TARGET_AVX2
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #include <immintrin.h>
+  #define SCANCONVERT_X86_SIMD
+  #define SCANCONVERT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+// NEON is part of the baseline instruction set of 64-bit ARM, no runtime selection is needed
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 vtkStandardNewMacro( vtkPlusUsScanConvertCurvilinear );
 
 //----------------------------------------------------------------------------
@@ -43,6 +60,8 @@ vtkPlusUsScanConvertCurvilinear::vtkPlusUsScanConvertCurvilinear()
   this->ThetaStartDeg = -30.0;
   this->ThetaStopDeg = 30.0;
   this->OutputIntensityScaling = 1.0;
+  this->UseFixedPointInterpolation = false;
+  this->FixedPointTableValid = false;
 
   // Values that are used for computing the InterpolatedPointArray
   this->InterpInputImageExtent[0] = 0;
@@ -67,6 +86,7 @@ vtkPlusUsScanConvertCurvilinear::vtkPlusUsScanConvertCurvilinear()
   this->InterpTransducerCenterPixel[0] = 0.0;
   this->InterpTransducerCenterPixel[1] = 0.0;
   this->InterpIntensityScaling = 0.0;
+  this->InterpUseFixedPointInterpolation = false;
 }
 
 //----------------------------------------------------------------------------
@@ -107,7 +127,8 @@ void vtkPlusUsScanConvertCurvilinear::ComputeInterpolatedPointArray(
        || ( this->InterpThetaStopDeg != thetaStopDeg )
        || ( this->InterpTransducerCenterPixel[0] != transducerCenterPixel[0] )
        || ( this->InterpTransducerCenterPixel[1] != transducerCenterPixel[1] )
-       || ( this->InterpIntensityScaling != intensityScaling ) )
+       || ( this->InterpIntensityScaling != intensityScaling )
+       || ( this->InterpUseFixedPointInterpolation != this->UseFixedPointInterpolation ) )
   {
     modifiedScanConversionParams = true;
   }
@@ -136,10 +157,18 @@ void vtkPlusUsScanConvertCurvilinear::ComputeInterpolatedPointArray(
   this->InterpTransducerCenterPixel[0] = transducerCenterPixel[0];
   this->InterpTransducerCenterPixel[1] = transducerCenterPixel[1];
   this->InterpIntensityScaling = intensityScaling;
+  this->InterpUseFixedPointInterpolation = this->UseFixedPointInterpolation;
 
   // Compute the interpolated point array now
 
   this->InterpolatedPointArray.clear();
+  this->FixedPointTable.InputPixelIndex.clear();
+  this->FixedPointTable.OutputPixelIndex.clear();
+  for ( int k = 0; k < 4; k++ )
+  {
+    this->FixedPointTable.WeightCoefficients[k].clear();
+  }
+  this->FixedPointTableValid = false;
 
   int numberOfSamples = inputImageExtent[1] - inputImageExtent[0] + 1;
   int numberOfLines = inputImageExtent[3] - inputImageExtent[2] + 1;
@@ -199,6 +228,67 @@ void vtkPlusUsScanConvertCurvilinear::ComputeInterpolatedPointArray(
     z = z + dz;
   }
 
+  // Weights sum up to intensityScaling, so the fixed-point table can only be used if intensityScaling is in [0, 1]
+  // (otherwise the weights would not fit into 16 bits and the accumulator could overflow)
+  if ( this->UseFixedPointInterpolation && intensityScaling >= 0.0 && intensityScaling <= 1.0 )
+  {
+    ComputeFixedPointInterpolationTable( intensityScaling );
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusUsScanConvertCurvilinear::ComputeFixedPointInterpolationTable( double intensityScaling )
+{
+  const double weightScale = static_cast<double>( 1 << FIXED_POINT_WEIGHT_BITS );
+  const int weightSum = static_cast<int>( floor( intensityScaling * weightScale + 0.5 ) );
+
+  size_t numberOfPoints = this->InterpolatedPointArray.size();
+  this->FixedPointTable.InputPixelIndex.resize( numberOfPoints );
+  this->FixedPointTable.OutputPixelIndex.resize( numberOfPoints );
+  for ( int k = 0; k < 4; k++ )
+  {
+    this->FixedPointTable.WeightCoefficients[k].resize( numberOfPoints );
+  }
+
+  for ( size_t i = 0; i < numberOfPoints; i++ )
+  {
+    const InterpolatedPoint& ip = this->InterpolatedPointArray[i];
+    this->FixedPointTable.InputPixelIndex[i] = ip.inputPixelIndex;
+    this->FixedPointTable.OutputPixelIndex[i] = ip.outputPixelIndex;
+
+    // Round the weights so that they add up exactly to weightSum (largest remainder method).
+    // This way regions of constant intensity remain constant and each weight is within 1 unit of the exact value.
+    int weights[4] = {0};
+    double remainders[4] = {0};
+    int remainingWeight = weightSum;
+    for ( int k = 0; k < 4; k++ )
+    {
+      double scaledWeight = ip.weightCoefficients[k] * weightScale;
+      weights[k] = static_cast<int>( floor( scaledWeight ) );
+      remainders[k] = scaledWeight - weights[k];
+      remainingWeight -= weights[k];
+    }
+    while ( remainingWeight > 0 )
+    {
+      int largestRemainderIndex = 0;
+      for ( int k = 1; k < 4; k++ )
+      {
+        if ( remainders[k] > remainders[largestRemainderIndex] )
+        {
+          largestRemainderIndex = k;
+        }
+      }
+      weights[largestRemainderIndex]++;
+      remainders[largestRemainderIndex] = -1.0;
+      remainingWeight--;
+    }
+    for ( int k = 0; k < 4; k++ )
+    {
+      this->FixedPointTable.WeightCoefficients[k][i] = static_cast<vtkTypeUInt16>( weights[k] );
+    }
+  }
+
+  this->FixedPointTableValid = true;
 }
 
 //----------------------------------------------------------------------------
@@ -307,6 +397,209 @@ void vtkPlusUsScanConvertExecute( vtkPlusUsScanConvertCurvilinear* self,
   }
 }
 
+//----------------------------------------------------------------------------
+// Fixed-point interpolation of one output pixel. Accumulates in 32 bits: pixel values are at most 16 bits
+// and the weights add up to at most 2^FIXED_POINT_WEIGHT_BITS, so the sum cannot overflow.
+template <class T>
+inline void vtkPlusUsScanConvertFixedPointPixel( const T* envelope_data, int numberOfSamples, T* image,
+    const int* inputPixelIndex, const int* outputPixelIndex, const vtkTypeUInt16* const weights[4], int pointIndex )
+{
+  const T* env_pointer = envelope_data + inputPixelIndex[pointIndex];
+  vtkTypeUInt32 value =
+    static_cast<vtkTypeUInt32>( weights[0][pointIndex] ) * env_pointer[0] // (+0, +0)
+    + static_cast<vtkTypeUInt32>( weights[1][pointIndex] ) * env_pointer[1] // (+1, +0)
+    + static_cast<vtkTypeUInt32>( weights[2][pointIndex] ) * env_pointer[numberOfSamples] // (+0, +1)
+    + static_cast<vtkTypeUInt32>( weights[3][pointIndex] ) * env_pointer[numberOfSamples + 1] // (+1, +1)
+    + ( 1 << ( vtkPlusUsScanConvertCurvilinear::FIXED_POINT_WEIGHT_BITS - 1 ) ); // for rounding
+  image[outputPixelIndex[pointIndex]] = static_cast<T>( value >> vtkPlusUsScanConvertCurvilinear::FIXED_POINT_WEIGHT_BITS );
+}
+
+#ifdef SCANCONVERT_X86_SIMD
+//----------------------------------------------------------------------------
+// Gathers the 2x2 neighborhoods of 8 points. Each 32-bit gather loads two horizontally adjacent pixels.
+SCANCONVERT_TARGET_AVX2 inline void vtkPlusUsScanConvertGather( const unsigned char* envelope_data, int numberOfSamples, __m256i inputIndex,
+                                        __m256i& v00, __m256i& v10, __m256i& v01, __m256i& v11 )
+{
+  const __m256i mask = _mm256_set1_epi32( 0xFF );
+  __m256i top = _mm256_i32gather_epi32( reinterpret_cast<const int*>( envelope_data ), inputIndex, 1 );
+  __m256i bottom = _mm256_i32gather_epi32( reinterpret_cast<const int*>( envelope_data + numberOfSamples ), inputIndex, 1 );
+  v00 = _mm256_and_si256( top, mask );
+  v10 = _mm256_and_si256( _mm256_srli_epi32( top, 8 ), mask );
+  v01 = _mm256_and_si256( bottom, mask );
+  v11 = _mm256_and_si256( _mm256_srli_epi32( bottom, 8 ), mask );
+}
+
+SCANCONVERT_TARGET_AVX2 inline void vtkPlusUsScanConvertGather( const unsigned short* envelope_data, int numberOfSamples, __m256i inputIndex,
+                                        __m256i& v00, __m256i& v10, __m256i& v01, __m256i& v11 )
+{
+  const __m256i mask = _mm256_set1_epi32( 0xFFFF );
+  __m256i top = _mm256_i32gather_epi32( reinterpret_cast<const int*>( envelope_data ), inputIndex, 2 );
+  __m256i bottom = _mm256_i32gather_epi32( reinterpret_cast<const int*>( envelope_data + numberOfSamples ), inputIndex, 2 );
+  v00 = _mm256_and_si256( top, mask );
+  v10 = _mm256_srli_epi32( top, 16 );
+  v01 = _mm256_and_si256( bottom, mask );
+  v11 = _mm256_srli_epi32( bottom, 16 );
+}
+
+// Stores 8 results (that fit into T) into consecutive output pixels
+SCANCONVERT_TARGET_AVX2 inline void vtkPlusUsScanConvertStore( unsigned short* image, __m256i values )
+{
+  __m256i packed = _mm256_permute4x64_epi64( _mm256_packus_epi32( values, values ), 0xD8 );
+  _mm_storeu_si128( reinterpret_cast<__m128i*>( image ), _mm256_castsi256_si128( packed ) );
+}
+
+SCANCONVERT_TARGET_AVX2 inline void vtkPlusUsScanConvertStore( unsigned char* image, __m256i values )
+{
+  __m256i packed = _mm256_permute4x64_epi64( _mm256_packus_epi32( values, values ), 0xD8 );
+  __m128i packed8 = _mm_packus_epi16( _mm256_castsi256_si128( packed ), _mm256_castsi256_si128( packed ) );
+  _mm_storel_epi64( reinterpret_cast<__m128i*>( image ), packed8 );
+}
+
+SCANCONVERT_TARGET_AVX2 inline __m256i vtkPlusUsScanConvertLoadWeights( const vtkTypeUInt16* weights )
+{
+  return _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( weights ) ) );
+}
+
+//----------------------------------------------------------------------------
+// Interpolates 8 points at a time from pointIndex, returns the index of the first point that is not processed
+template <class T>
+SCANCONVERT_TARGET_AVX2 int vtkPlusUsScanConvertFixedPointExecuteAVX2( const T* envelope_data, int numberOfSamples, int numberOfInputPixels, T* image,
+    const int* inputPixelIndex, const int* outputPixelIndex, const vtkTypeUInt16* const weights[4], int pointIndex, int afterLastPointIndex )
+{
+  // A 32-bit gather reads 4 bytes starting at the addressed pixel. Near the end of the input buffer
+  // this would read past the last pixel, so these points are computed by the scalar code.
+  const __m256i maxGatherInputIndex = _mm256_set1_epi32( numberOfInputPixels - numberOfSamples - static_cast<int>( 4 / sizeof( T ) ) );
+  const __m256i rounding = _mm256_set1_epi32( 1 << ( vtkPlusUsScanConvertCurvilinear::FIXED_POINT_WEIGHT_BITS - 1 ) );
+  for ( ; pointIndex + 8 <= afterLastPointIndex; pointIndex += 8 )
+  {
+    __m256i inputIndex = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( inputPixelIndex + pointIndex ) );
+    if ( _mm256_movemask_epi8( _mm256_cmpgt_epi32( inputIndex, maxGatherInputIndex ) ) != 0 )
+    {
+      for ( int i = pointIndex; i < pointIndex + 8; i++ )
+      {
+        vtkPlusUsScanConvertFixedPointPixel( envelope_data, numberOfSamples, image, inputPixelIndex, outputPixelIndex, weights, i );
+      }
+      continue;
+    }
+    __m256i v00, v10, v01, v11;
+    vtkPlusUsScanConvertGather( envelope_data, numberOfSamples, inputIndex, v00, v10, v01, v11 );
+    __m256i sum = _mm256_add_epi32( rounding, _mm256_mullo_epi32( v00, vtkPlusUsScanConvertLoadWeights( weights[0] + pointIndex ) ) );
+    sum = _mm256_add_epi32( sum, _mm256_mullo_epi32( v10, vtkPlusUsScanConvertLoadWeights( weights[1] + pointIndex ) ) );
+    sum = _mm256_add_epi32( sum, _mm256_mullo_epi32( v01, vtkPlusUsScanConvertLoadWeights( weights[2] + pointIndex ) ) );
+    sum = _mm256_add_epi32( sum, _mm256_mullo_epi32( v11, vtkPlusUsScanConvertLoadWeights( weights[3] + pointIndex ) ) );
+    sum = _mm256_srli_epi32( sum, vtkPlusUsScanConvertCurvilinear::FIXED_POINT_WEIGHT_BITS );
+
+    if ( outputPixelIndex[pointIndex + 7] - outputPixelIndex[pointIndex] == 7 )
+    {
+      // Output indices are increasing, so the 8 points are consecutive pixels in a row
+      vtkPlusUsScanConvertStore( image + outputPixelIndex[pointIndex], sum );
+    }
+    else
+    {
+      int values[8];
+      _mm256_storeu_si256( reinterpret_cast<__m256i*>( values ), sum );
+      for ( int i = 0; i < 8; i++ )
+      {
+        image[outputPixelIndex[pointIndex + i]] = static_cast<T>( values[i] );
+      }
+    }
+  }
+  return pointIndex;
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+//----------------------------------------------------------------------------
+// Stores 8 results (that fit into T) into consecutive output pixels
+inline void vtkPlusUsScanConvertStore( unsigned short* image, uint16x8_t values )
+{
+  vst1q_u16( image, values );
+}
+
+inline void vtkPlusUsScanConvertStore( unsigned char* image, uint16x8_t values )
+{
+  vst1_u8( image, vmovn_u16( values ) );
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Fixed-point version of vtkPlusUsScanConvertExecute, for unsigned char and unsigned short pixels.
+// Processes 8 points at a time with AVX2 (if selected by PixelCodec::GetInstructionSet) or NEON.
+template <class T>
+void vtkPlusUsScanConvertFixedPointExecute( vtkPlusUsScanConvertCurvilinear* self,
+    vtkImageData* inData, T* inPtr, T* outPtr, int interpolationTableExt[6] )
+{
+  const T* envelope_data = inPtr; // The envelope detected and log-compressed data
+  int numberOfSamples = inData->GetExtent()[1] - inData->GetExtent()[0] + 1; // Number of samples in one envelope line
+  T* image = outPtr; // The resulting image
+
+  const vtkPlusUsScanConvertCurvilinear::FixedPointInterpolationTable& table = self->GetFixedPointInterpolationTable();
+  const int* inputPixelIndex = &table.InputPixelIndex[0];
+  const int* outputPixelIndex = &table.OutputPixelIndex[0];
+  const vtkTypeUInt16* const weights[4] =
+  {
+    &table.WeightCoefficients[0][0], &table.WeightCoefficients[1][0], &table.WeightCoefficients[2][0], &table.WeightCoefficients[3][0]
+  };
+
+  int pointIndex = interpolationTableExt[0];
+  const int afterLastPointIndex = interpolationTableExt[1] + 1;
+
+#if defined(SCANCONVERT_X86_SIMD)
+  if ( PixelCodec::GetInstructionSet() == PixelCodec::InstructionSet_AVX2 )
+  {
+    int numberOfInputPixels = numberOfSamples * ( inData->GetExtent()[3] - inData->GetExtent()[2] + 1 );
+    pointIndex = vtkPlusUsScanConvertFixedPointExecuteAVX2( envelope_data, numberOfSamples, numberOfInputPixels, image,
+                 inputPixelIndex, outputPixelIndex, weights, pointIndex, afterLastPointIndex );
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  // NEON has no gather instruction, so the neighborhoods are loaded by scalar code and only the arithmetic is vectorized
+  for ( ; pointIndex + 8 <= afterLastPointIndex; pointIndex += 8 )
+  {
+    vtkTypeUInt16 neighbors[4][8];
+    for ( int i = 0; i < 8; i++ )
+    {
+      const T* env_pointer = envelope_data + inputPixelIndex[pointIndex + i];
+      neighbors[0][i] = env_pointer[0];
+      neighbors[1][i] = env_pointer[1];
+      neighbors[2][i] = env_pointer[numberOfSamples];
+      neighbors[3][i] = env_pointer[numberOfSamples + 1];
+    }
+    uint32x4_t sumLow = vdupq_n_u32( 0 );
+    uint32x4_t sumHigh = vdupq_n_u32( 0 );
+    for ( int k = 0; k < 4; k++ )
+    {
+      uint16x8_t values = vld1q_u16( neighbors[k] );
+      uint16x8_t w = vld1q_u16( weights[k] + pointIndex );
+      sumLow = vmlal_u16( sumLow, vget_low_u16( values ), vget_low_u16( w ) );
+      sumHigh = vmlal_u16( sumHigh, vget_high_u16( values ), vget_high_u16( w ) );
+    }
+    // Rounding shift by FIXED_POINT_WEIGHT_BITS, same as adding 2^(FIXED_POINT_WEIGHT_BITS-1) before the shift
+    uint16x8_t result = vcombine_u16( vqrshrn_n_u32( sumLow, vtkPlusUsScanConvertCurvilinear::FIXED_POINT_WEIGHT_BITS ),
+                                      vqrshrn_n_u32( sumHigh, vtkPlusUsScanConvertCurvilinear::FIXED_POINT_WEIGHT_BITS ) );
+
+    if ( outputPixelIndex[pointIndex + 7] - outputPixelIndex[pointIndex] == 7 )
+    {
+      // Output indices are increasing, so the 8 points are consecutive pixels in a row
+      vtkPlusUsScanConvertStore( image + outputPixelIndex[pointIndex], result );
+    }
+    else
+    {
+      vtkTypeUInt16 values[8];
+      vst1q_u16( values, result );
+      for ( int i = 0; i < 8; i++ )
+      {
+        image[outputPixelIndex[pointIndex + i]] = static_cast<T>( values[i] );
+      }
+    }
+  }
+#endif
+
+  for ( ; pointIndex < afterLastPointIndex; pointIndex++ )
+  {
+    vtkPlusUsScanConvertFixedPointPixel( envelope_data, numberOfSamples, image, inputPixelIndex, outputPixelIndex, weights, pointIndex );
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusUsScanConvertCurvilinear::ThreadedRequestData(
   vtkInformation* vtkNotUsed( request ),
@@ -330,6 +623,22 @@ void vtkPlusUsScanConvertCurvilinear::ThreadedRequestData(
     return;
   }
 
+  if ( this->UseFixedPointInterpolation && this->FixedPointTableValid && !this->FixedPointTable.InputPixelIndex.empty() )
+  {
+    switch ( inData[0][0]->GetScalarType() )
+    {
+    case VTK_UNSIGNED_CHAR:
+      vtkPlusUsScanConvertFixedPointExecute( this, inData[0][0], static_cast<unsigned char*>( inPtr ), static_cast<unsigned char*>( outPtr ), outExt );
+      return;
+    case VTK_UNSIGNED_SHORT:
+      vtkPlusUsScanConvertFixedPointExecute( this, inData[0][0], static_cast<unsigned short*>( inPtr ), static_cast<unsigned short*>( outPtr ), outExt );
+      return;
+    default:
+      // other pixel types are interpolated in floating point
+      break;
+    }
+  }
+
   switch ( inData[0][0]->GetScalarType() )
   {
     vtkTemplateMacro(
@@ -355,6 +664,8 @@ void vtkPlusUsScanConvertCurvilinear::PrintSelf( ostream& os, vtkIndent indent )
   os << indent << "ThetaStopDeg: " << this->ThetaStopDeg << "\n";
   os << indent << "OutputIntensityScaling: " << this->OutputIntensityScaling << "\n";
   os << indent << "InterpolatedPointArraySize: " << this->InterpolatedPointArray.size() << "\n";
+  os << indent << "UseFixedPointInterpolation: " << ( this->UseFixedPointInterpolation ? "true" : "false" ) << "\n";
+  os << indent << "FixedPointInterpolationAvailable: " << ( this->FixedPointTableValid ? "true" : "false" ) << "\n";
 
 }
 
@@ -447,6 +758,8 @@ PlusStatus vtkPlusUsScanConvertCurvilinear::ReadConfiguration( vtkXMLDataElement
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL( double, ThetaStartDeg, scanConversionElement );
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL( double, ThetaStopDeg, scanConversionElement );
 
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL( UseFixedPointInterpolation, scanConversionElement );
+
   return PLUS_SUCCESS;
 }
 
@@ -465,6 +778,11 @@ PlusStatus vtkPlusUsScanConvertCurvilinear::WriteConfiguration( vtkXMLDataElemen
   scanConversionElement->SetDoubleAttribute( "ThetaStartDeg", this->ThetaStartDeg );
   scanConversionElement->SetDoubleAttribute( "ThetaStopDeg", this->ThetaStopDeg );
 
+  if ( this->UseFixedPointInterpolation || scanConversionElement->GetAttribute( "UseFixedPointInterpolation" ) != NULL )
+  {
+    scanConversionElement->SetAttribute( "UseFixedPointInterpolation", this->UseFixedPointInterpolation ? "TRUE" : "FALSE" );
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -52,6 +52,44 @@ public:
     return this->InterpolatedPointArray;
   };
 
+  /*! Number of fractional bits of the weights in the FixedPointInterpolationTable */
+  static const int FIXED_POINT_WEIGHT_BITS = 15;
+
+  /*!
+    Interpolation table with the same points as the InterpolatedPointArray, stored as struct of arrays
+    with 16-bit fixed-point weights (scaled by 2^FIXED_POINT_WEIGHT_BITS). It takes 16 bytes per point instead of 40,
+    and the arrays can be loaded directly into vector registers.
+  */
+  struct FixedPointInterpolationTable
+  {
+    std::vector<int> InputPixelIndex;
+    std::vector<int> OutputPixelIndex;
+    std::vector<vtkTypeUInt16> WeightCoefficients[4];
+  };
+
+  /*! Retrieve the FixedPointInterpolationTable (used internally by the thread function) */
+  const FixedPointInterpolationTable& GetFixedPointInterpolationTable()
+  {
+    return this->FixedPointTable;
+  };
+
+  /*!
+    If enabled then 8-bit and 16-bit unsigned images are interpolated using integer arithmetic with
+    fixed-point weights (vectorized with AVX2 if PixelCodec::GetInstructionSet selects it, or with NEON on ARM). This is several times faster
+    than the default floating-point interpolation, but due to the limited weight precision output pixel values may differ
+    from the floating-point result by 1 for 8-bit images and by up to 2^-13 of the intensity range for 16-bit images.
+    Fixed-point interpolation is only used if the output intensity scaling is between 0 and 1.
+  */
+  vtkSetMacro(UseFixedPointInterpolation, bool);
+  vtkGetMacro(UseFixedPointInterpolation, bool);
+  vtkBooleanMacro(UseFixedPointInterpolation, bool);
+
+  /*! Returns true if the FixedPointInterpolationTable is computed for the current scan conversion parameters */
+  bool IsFixedPointInterpolationAvailable()
+  {
+    return this->FixedPointTableValid;
+  };
+
   /*! Initialize the parameters used in reconstruction. These are for the cases when video source can obtain them from the hardware */
   vtkSetMacro(RadiusStartMm, double);
   vtkGetMacro(RadiusStartMm, double);
@@ -112,6 +150,13 @@ protected:
   /*! Each element of this array defines the computation of a pixel in the output (scan converted) image.  */
   std::vector<InterpolatedPoint> InterpolatedPointArray;
 
+  /*! Use integer interpolation for 8-bit and 16-bit images */
+  bool UseFixedPointInterpolation;
+
+  /*! Fixed-point version of the InterpolatedPointArray. Only computed if UseFixedPointInterpolation is enabled. */
+  FixedPointInterpolationTable FixedPointTable;
+  bool FixedPointTableValid;
+
   int InterpInputImageExtent[6];
   double InterpRadiusStartMm;
   double InterpRadiusStopMm;
@@ -121,16 +166,20 @@ protected:
   double InterpOutputImageSpacing[3];
   double InterpTransducerCenterPixel[2];
   double InterpIntensityScaling;
+  bool InterpUseFixedPointInterpolation;
 
   /*!
-    Computes the InterpolatedPointArray from the method arguments. The array is not recomputed if
-    the input arguments are the same as last time.
+    Computes the InterpolatedPointArray (and the FixedPointTable if UseFixedPointInterpolation is enabled) from the method arguments.
+    The array is not recomputed if the input arguments are the same as last time.
   */
   void ComputeInterpolatedPointArray(
     int* inputImageExtent, double radiusStartMm, double radiusStopMm, double thetaStartDeg, double thetaStopDeg,
     int* outputImageExtent, double* outputImageSpacing, double* transducerCenterPixel, double intensityScaling
   );
 
+  /*! Computes the FixedPointTable from the InterpolatedPointArray */
+  void ComputeFixedPointInterpolationTable(double intensityScaling);
+
 private:
   vtkPlusUsScanConvertCurvilinear(const vtkPlusUsScanConvertCurvilinear&);  // Not implemented.
   void operator=(const vtkPlusUsScanConvertCurvilinear&);  // Not implemented.
@@ -10,9 +10,14 @@ See License.txt for details.
 
 #include "vtkObjectFactory.h"
 #include "vtkXMLDataElement.h"
-#include "vtkImageReslice.h"
 #include "vtkImageData.h"
-#include "vtkAlgorithmOutput.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
 
 vtkStandardNewMacro(vtkPlusUsScanConvertLinear);
 
@@ -21,15 +26,12 @@ vtkPlusUsScanConvertLinear::vtkPlusUsScanConvertLinear()
 {
   this->ImagingDepthMm=50.0;
   this->TransducerWidthMm=38.0;
-
-  this->ImageReslice=vtkImageReslice::New();  
+  this->Interpolation=NEAREST_NEIGHBOR_INTERPOLATION;
 }
 
 //----------------------------------------------------------------------------
 vtkPlusUsScanConvertLinear::~vtkPlusUsScanConvertLinear()
 {
-  this->ImageReslice->Delete();
-  this->ImageReslice=NULL;  
 }
 
 void vtkPlusUsScanConvertLinear::PrintSelf(ostream& os, vtkIndent indent)
@@ -37,70 +39,289 @@ void vtkPlusUsScanConvertLinear::PrintSelf(ostream& os, vtkIndent indent)
   this->Superclass::PrintSelf(os,indent);
   os << indent << "ImagingDepthMm: "<< this->ImagingDepthMm << "\n";
   os << indent << "TransducerWidthMm: "<< this->TransducerWidthMm << "\n";
+  os << indent << "Interpolation: "<< (this->Interpolation==LINEAR_INTERPOLATION ? "LINEAR" : "NEAREST_NEIGHBOR") << "\n";
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusUsScanConvertLinear::SetInputConnection(vtkAlgorithmOutput* input)
+void vtkPlusUsScanConvertLinear::ComputeAxisInterpolationTable(AxisInterpolationTable& table, int numberOfOutputPixels, double inputPositionOffset, double inputPositionScale, int inputExtentMin, int inputExtentMax)
 {
-  this->ImageReslice->SetInputConnection(input);
+  table.FirstIndex.resize(numberOfOutputPixels);
+  table.SecondIndex.resize(numberOfOutputPixels);
+  table.SecondWeight.resize(numberOfOutputPixels);
+  for (int outputIndex=0; outputIndex<numberOfOutputPixels; outputIndex++)
+  {
+    double inputPosition=inputPositionOffset+outputIndex*inputPositionScale;
+    if (inputPosition<inputExtentMin-0.5 || inputPosition>inputExtentMax+0.5)
+    {
+      // outside the input image
+      table.FirstIndex[outputIndex]=-1;
+      table.SecondIndex[outputIndex]=-1;
+      table.SecondWeight[outputIndex]=0.0;
+      continue;
+    }
+    int firstIndex=0;
+    int secondIndex=0;
+    double secondWeight=0.0;
+    if (this->Interpolation==LINEAR_INTERPOLATION)
+    {
+      inputPosition=std::min(std::max(inputPosition, double(inputExtentMin)), double(inputExtentMax));
+      firstIndex=static_cast<int>(floor(inputPosition));
+      if (firstIndex<inputExtentMax)
+      {
+        secondIndex=firstIndex+1;
+        secondWeight=inputPosition-firstIndex;
+      }
+      else
+      {
+        firstIndex=inputExtentMax;
+        secondIndex=inputExtentMax;
+      }
+    }
+    else
+    {
+      firstIndex=static_cast<int>(floor(inputPosition+0.5));
+      firstIndex=std::min(std::max(firstIndex, inputExtentMin), inputExtentMax);
+      secondIndex=firstIndex;
+    }
+    // Store indices relative to the start of the input extent
+    table.FirstIndex[outputIndex]=firstIndex-inputExtentMin;
+    table.SecondIndex[outputIndex]=secondIndex-inputExtentMin;
+    table.SecondWeight[outputIndex]=secondWeight;
+  }
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusUsScanConvertLinear::SetInputData(vtkDataObject *input)
+void vtkPlusUsScanConvertLinear::ComputeInterpolationTables(int inputExtent[6], double inputOrigin[3], double inputSpacing[3])
 {
-  this->ImageReslice->SetInputData(input);
+  // Computing the tables is only needed if a parameter has changed
+  std::vector<double> parameters;
+  for (int i=0; i<6; i++)
+  {
+    parameters.push_back(inputExtent[i]);
+    parameters.push_back(this->OutputImageExtent[i]);
+  }
+  for (int i=0; i<2; i++)
+  {
+    parameters.push_back(inputOrigin[i]);
+    parameters.push_back(inputSpacing[i]);
+    parameters.push_back(this->OutputImageSpacing[i]);
+    parameters.push_back(this->TransducerCenterPixel[i]);
+  }
+  parameters.push_back(this->ImagingDepthMm);
+  parameters.push_back(this->TransducerWidthMm);
+  parameters.push_back(this->Interpolation);
+  if (parameters==this->InterpolationTableParameters)
+  {
+    return;
+  }
+  this->InterpolationTableParameters=parameters;
+
+  int scanLineLengthPixels=inputExtent[1]-inputExtent[0]+1;
+  int numberOfScanLines=inputExtent[3]-inputExtent[2]+1;
+
+  // Output x axis is along the input y axis (scanlines), output y axis is along the input x axis (samples).
+  // Scale: input pixel per output pixel. If larger then the image becomes narrower/shorter.
+  double inputWidthSpacing=this->TransducerWidthMm/static_cast<double>(numberOfScanLines);
+  double outputToInputScaleX=this->OutputImageSpacing[0]/inputWidthSpacing;
+  double inputDepthSpacing=this->ImagingDepthMm/static_cast<double>(scanLineLengthPixels);
+  double outputToInputScaleY=this->OutputImageSpacing[1]/inputDepthSpacing;
+
+  // Position of the first output pixel (default transducer center is horizontally centered, with 0 offset along y axis)
+  double halfImageWidthPixel=numberOfScanLines/2*inputWidthSpacing/this->OutputImageSpacing[0];
+  double outputStartX=-this->TransducerCenterPixel[0]+halfImageWidthPixel+this->OutputImageExtent[0];
+  double outputStartY=-this->TransducerCenterPixel[1]+this->OutputImageExtent[2];
+
+  ComputeAxisInterpolationTable(this->ColumnInterpolationTable, this->OutputImageExtent[1]-this->OutputImageExtent[0]+1,
+    (outputStartX*outputToInputScaleX-inputOrigin[1])/inputSpacing[1], outputToInputScaleX/inputSpacing[1], inputExtent[2], inputExtent[3]);
+  ComputeAxisInterpolationTable(this->RowInterpolationTable, this->OutputImageExtent[3]-this->OutputImageExtent[2]+1,
+    (outputStartY*outputToInputScaleY-inputOrigin[0])/inputSpacing[0], outputToInputScaleY/inputSpacing[0], inputExtent[0], inputExtent[1]);
 }
 
-//-----------------------------------------------------------------------------
-void vtkPlusUsScanConvertLinear::Update()
+//----------------------------------------------------------------------------
+int vtkPlusUsScanConvertLinear::RequestInformation(vtkInformation* vtkNotUsed(request), vtkInformationVector** inputVector, vtkInformationVector* outputVector)
 {
-  this->ImageReslice->SetOutputExtent(this->OutputImageExtent);
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), this->OutputImageExtent, 6);
+
   // In Plus the convention is that the image coordinate system has always unit spacing and zero origin
-  this->ImageReslice->SetOutputSpacing(1.0, 1.0, 1.0);
+  double spacing[3] = {1.0, 1.0, 1.0};
+  outInfo->Set(vtkDataObject::SPACING(), spacing, 3);
+  double origin[3] = {0, 0, 0};
+  outInfo->Set(vtkDataObject::ORIGIN(), origin, 3);
 
-  // The direction cosines give the x, y, and z axes for the output volume.
-  // Updating whole extent is needed when the requested extent is smaller than the producer's whole extent
-  this->ImageReslice->GetInputConnection(0,0)->GetProducer()->UpdateWholeExtent();
-  vtkImageData* inputImage=this->ImageReslice->GetImageDataInput(0);  
-  if (inputImage==NULL)
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), this->InputImageExtent);
+  double inputOrigin[3] = {0, 0, 0};
+  if (inInfo->Has(vtkDataObject::ORIGIN()))
   {
-    LOG_ERROR("vtkPlusUsScanConvertLinear::Update failed: no input image is specified");
-    return;
+    inInfo->Get(vtkDataObject::ORIGIN(), inputOrigin);
+  }
+  double inputSpacing[3] = {1.0, 1.0, 1.0};
+  if (inInfo->Has(vtkDataObject::SPACING()))
+  {
+    inInfo->Get(vtkDataObject::SPACING(), inputSpacing);
   }
 
-  inputImage->GetExtent(this->InputImageExtent);  
-  int scanLineLengthPixels=this->InputImageExtent[1]-this->InputImageExtent[0]+1;
-  int numberOfScanLines=this->InputImageExtent[3]-this->InputImageExtent[2]+1;
+  // Create the interpolation tables. They are recomputed only if the scan conversion parameters change.
+  ComputeInterpolationTables(this->InputImageExtent, inputOrigin, inputSpacing);
 
-  // xVec: controls the width of the output image, if larger then image becomes narrower
-  double inputWidthSpacing=this->TransducerWidthMm/static_cast<double>(numberOfScanLines);
-  double xVec[3]={0, (this->OutputImageSpacing[0]/inputWidthSpacing), 0};
-  
-  // yVec: controls the height of the output image, if larger then image becomes shorter
-  double inputDepthSpacing=this->ImagingDepthMm/static_cast<double>(scanLineLengthPixels);
-  double yVec[3]={this->OutputImageSpacing[1]/inputDepthSpacing, 0, 0};
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusUsScanConvertLinear::RequestUpdateExtent(vtkInformation* vtkNotUsed(request), vtkInformationVector** inputVector, vtkInformationVector* vtkNotUsed(outputVector))
+{
+  // Use the whole extent as the update extent (by default it would use the output extent, which would not be correct)
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  int extent[6] = {0, -1, 0, -1, 0, -1};
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent);
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), extent, 6);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+// Converts the interpolated value to the pixel type (rounded and clamped for integer types)
+template <class T>
+inline T vtkPlusUsScanConvertLinearCast(double value)
+{
+  if (std::numeric_limits<T>::is_integer)
+  {
+    if (value <= static_cast<double>(std::numeric_limits<T>::min()))
+    {
+      return std::numeric_limits<T>::min();
+    }
+    if (value >= static_cast<double>(std::numeric_limits<T>::max()))
+    {
+      return std::numeric_limits<T>::max();
+    }
+    return static_cast<T>(floor(value + 0.5));
+  }
+  return static_cast<T>(value);
+}
 
-  double zVec[3]={0,0,1.0};
-  this->ImageReslice->SetResliceAxesDirectionCosines(xVec, yVec, zVec);
+//----------------------------------------------------------------------------
+// The templated execute function handles all the data types.
+template <class T>
+void vtkPlusUsScanConvertLinearExecute(vtkPlusUsScanConvertLinear* self, bool linearInterpolation,
+                                       vtkImageData* inData, T* inPtr, vtkImageData* outData, int outExt[6])
+{
+  const vtkPlusUsScanConvertLinear::AxisInterpolationTable& columnTable = self->GetColumnInterpolationTable();
+  const vtkPlusUsScanConvertLinear::AxisInterpolationTable& rowTable = self->GetRowInterpolationTable();
+  int* outputWholeExtent = self->GetOutputImageExtent();
 
-  // Default transducer center is horizontally centered, with 0 offset along y axis
-  double halfImageWidthPixel=numberOfScanLines/2*inputWidthSpacing/this->OutputImageSpacing[0];
-  double transducerCenterPixel[2] = { halfImageWidthPixel, 0};
-  if (this->TransducerCenterPixelSpecified)
+  int numberOfComponents = inData->GetNumberOfScalarComponents();
+  vtkIdType inIncX = 0, inIncY = 0, inIncZ = 0;
+  inData->GetIncrements(inIncX, inIncY, inIncZ);
+
+  int rowLength = outExt[1] - outExt[0] + 1;
+  const int firstColumn = outExt[0] - outputWholeExtent[0];
+  const int* columnFirstIndex = &columnTable.FirstIndex[firstColumn];
+  const int* columnSecondIndex = &columnTable.SecondIndex[firstColumn];
+  const double* columnSecondWeight = &columnTable.SecondWeight[firstColumn];
+
+  for (int idxZ = outExt[4]; idxZ <= outExt[5]; idxZ++)
   {
-    transducerCenterPixel[0]=this->TransducerCenterPixel[0];
-    transducerCenterPixel[1]=this->TransducerCenterPixel[1];
+    for (int idxY = outExt[2]; idxY <= outExt[3]; idxY++)
+    {
+      T* outRow = static_cast<T*>(outData->GetScalarPointer(outExt[0], idxY, idxZ));
+      int row = idxY - outputWholeExtent[2];
+      if (rowTable.FirstIndex[row] < 0)
+      {
+        // the whole row is outside the input image
+        memset(outRow, 0, rowLength * numberOfComponents * sizeof(T));
+        continue;
+      }
+      const T* inFirstSample = inPtr + rowTable.FirstIndex[row] * inIncX;
+      if (!linearInterpolation)
+      {
+        if (numberOfComponents == 1)
+        {
+          for (int i = 0; i < rowLength; i++)
+          {
+            outRow[i] = (columnFirstIndex[i] < 0) ? 0 : inFirstSample[columnFirstIndex[i] * inIncY];
+          }
+        }
+        else
+        {
+          for (int i = 0; i < rowLength; i++)
+          {
+            for (int c = 0; c < numberOfComponents; c++)
+            {
+              outRow[i * numberOfComponents + c] = (columnFirstIndex[i] < 0) ? 0 : inFirstSample[columnFirstIndex[i] * inIncY + c];
+            }
+          }
+        }
+        continue;
+      }
+
+      // Linear interpolation: interpolate along the scanline first, then between the scanlines
+      const T* inSecondSample = inPtr + rowTable.SecondIndex[row] * inIncX;
+      double rowSecondWeight = rowTable.SecondWeight[row];
+      double rowFirstWeight = 1.0 - rowSecondWeight;
+      for (int i = 0; i < rowLength; i++)
+      {
+        if (columnFirstIndex[i] < 0)
+        {
+          for (int c = 0; c < numberOfComponents; c++)
+          {
+            outRow[i * numberOfComponents + c] = 0;
+          }
+          continue;
+        }
+        vtkIdType firstLineOffset = columnFirstIndex[i] * inIncY;
+        vtkIdType secondLineOffset = columnSecondIndex[i] * inIncY;
+        double columnSecondWeight_i = columnSecondWeight[i];
+        for (int c = 0; c < numberOfComponents; c++)
+        {
+          double firstLineValue = rowFirstWeight * inFirstSample[firstLineOffset + c] + rowSecondWeight * inSecondSample[firstLineOffset + c];
+          double secondLineValue = rowFirstWeight * inFirstSample[secondLineOffset + c] + rowSecondWeight * inSecondSample[secondLineOffset + c];
+          outRow[i * numberOfComponents + c] = vtkPlusUsScanConvertLinearCast<T>(firstLineValue + columnSecondWeight_i * (secondLineValue - firstLineValue));
+        }
+      }
+    }
   }
+}
 
-  this->ImageReslice->SetOutputOrigin(-this->TransducerCenterPixel[0]+halfImageWidthPixel,-this->TransducerCenterPixel[1],0);
+//----------------------------------------------------------------------------
+void vtkPlusUsScanConvertLinear::ThreadedRequestData(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* vtkNotUsed(outputVector),
+  vtkImageData*** inData,
+  vtkImageData** outData,
+  int outExt[6], int vtkNotUsed(id))
+{
+  // this filter expects that input is the same type as output.
+  if (inData[0][0]->GetScalarType() != outData[0]->GetScalarType())
+  {
+    vtkErrorMacro("Execute: input ScalarType, " << inData[0][0]->GetScalarType()
+                  << ", must match out ScalarType " << outData[0]->GetScalarType());
+    return;
+  }
+  if (this->ColumnInterpolationTable.FirstIndex.empty() || this->RowInterpolationTable.FirstIndex.empty())
+  {
+    // empty output image
+    return;
+  }
 
-  this->ImageReslice->Update();
+  void* inPtr = inData[0][0]->GetScalarPointer();
+  bool linearInterpolation = (this->Interpolation == LINEAR_INTERPOLATION);
+  switch (inData[0][0]->GetScalarType())
+  {
+    vtkTemplateMacro(
+      vtkPlusUsScanConvertLinearExecute(this, linearInterpolation, inData[0][0],
+                                        static_cast<VTK_TT*>(inPtr), outData[0], outExt));
+  default:
+    vtkErrorMacro(<< "Execute: Unknown ScalarType");
+    return;
+  }
 }
 
 //-----------------------------------------------------------------------------
 vtkImageData* vtkPlusUsScanConvertLinear::GetOutput()
 {
-  return this->ImageReslice->GetOutput();
+  return vtkImageAlgorithm::GetOutput();
 }
 
 //-----------------------------------------------------------------------------
@@ -115,6 +336,9 @@ PlusStatus vtkPlusUsScanConvertLinear::ReadConfiguration(vtkXMLDataElement* scan
 
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, ImagingDepthMm, scanConversionElement);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, TransducerWidthMm, scanConversionElement);
+  XML_READ_ENUM2_ATTRIBUTE_OPTIONAL(Interpolation, scanConversionElement,
+    "NEAREST_NEIGHBOR", NEAREST_NEIGHBOR_INTERPOLATION,
+    "LINEAR", LINEAR_INTERPOLATION);
  
   return PLUS_SUCCESS;
 }
@@ -131,6 +355,10 @@ PlusStatus vtkPlusUsScanConvertLinear::WriteConfiguration(vtkXMLDataElement* sca
 
   scanConversionElement->SetDoubleAttribute("ImagingDepthMm", this->ImagingDepthMm);
   scanConversionElement->SetDoubleAttribute("TransducerWidthMm", this->TransducerWidthMm);
+  if (this->Interpolation!=NEAREST_NEIGHBOR_INTERPOLATION || scanConversionElement->GetAttribute("Interpolation")!=NULL)
+  {
+    scanConversionElement->SetAttribute("Interpolation", this->Interpolation==LINEAR_INTERPOLATION ? "LINEAR" : "NEAREST_NEIGHBOR");
+  }
 
   return PLUS_SUCCESS;
 }
@@ -10,13 +10,19 @@ See License.txt for details.
 #include "vtkPlusImageProcessingExport.h"
 #include "vtkPlusUsScanConvert.h"
 
-class vtkAlgorithmOutput;
-class vtkImageReslice;
+#include <vector>
+
 class vtkImageData;
 
 /*!
 \class vtkPlusUsScanConvertLinear
-\brief This class performs scan conversion from scan lines for curvilinear probes
+\brief This class performs scan conversion from scan lines for linear probes
+
+  Scan conversion of a linear probe is a separable resampling: each output row depends only on one sample position
+  along the scanlines and each output column only on one scanline position. The input indices and weights are computed
+  for each output row and column when the geometry changes and the pixels are computed from these tables,
+  multi-threaded across output rows.
+
 \ingroup PlusLibImageProcessingAlgo
 */ 
 class vtkPlusImageProcessingExport vtkPlusUsScanConvertLinear : public vtkPlusUsScanConvert
@@ -27,18 +33,14 @@ public:
   virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
 
   virtual const char* GetTransducerGeometry() { return "LINEAR"; }
-  
-  /*! 
-    Set the connection for the input image containing the brightness lines.
-    The input image orientation must be FM.
-  */
-  virtual void SetInputConnection(vtkAlgorithmOutput* input);
-  virtual void SetInputData(vtkDataObject *input);
 
-  /*! Bring this algorithm's outputs up-to-date. */
-  virtual void Update();
+  enum InterpolationType
+  {
+    NEAREST_NEIGHBOR_INTERPOLATION,
+    LINEAR_INTERPOLATION
+  };
 
-  /*! Get the scan-converted output image. The output image orientation is MF. */
+  /*! Get the scan-converted output image. The input image orientation must be FM, the output image orientation is MF. */
   virtual vtkImageData* GetOutput();
 
   /*! Read configuration from xml data. The scanConversionElement is typically in DataCollction/ImageAcquisition/RfProcessing. */
@@ -51,6 +53,26 @@ public:
   vtkGetMacro(ImagingDepthMm,double);
   vtkSetMacro(TransducerWidthMm,double);
 
+  /*! Set the interpolation method. Default is nearest neighbor. */
+  vtkSetMacro(Interpolation,InterpolationType);
+  vtkGetMacro(Interpolation,InterpolationType);
+
+  /*! Interpolation along one image axis: for each output pixel index the two input pixel indices and the weight of the second one */
+  struct AxisInterpolationTable
+  {
+    /*! Index of the first input pixel, -1 if the output pixel is outside the input image */
+    std::vector<int> FirstIndex;
+    /*! Index of the second input pixel. Same as the first index for nearest neighbor interpolation or at the image border. */
+    std::vector<int> SecondIndex;
+    /*! Weight of the second input pixel (the first pixel has 1-weight) */
+    std::vector<double> SecondWeight;
+  };
+
+  /*! Interpolation table for output image columns (indices are scanline indices). Used internally by the thread function. */
+  const AxisInterpolationTable& GetColumnInterpolationTable() { return this->ColumnInterpolationTable; }
+  /*! Interpolation table for output image rows (indices are sample indices in a scanline). Used internally by the thread function. */
+  const AxisInterpolationTable& GetRowInterpolationTable() { return this->RowInterpolationTable; }
+
   /*! 
     Get the start and end point of the selected scanline
     transducer surface, the end point is far from the transducer surface.
@@ -67,13 +89,43 @@ protected:
   vtkPlusUsScanConvertLinear();
   virtual ~vtkPlusUsScanConvertLinear();
 
+  virtual int RequestInformation(vtkInformation*, vtkInformationVector**, vtkInformationVector*);
+
+  virtual int RequestUpdateExtent(vtkInformation*, vtkInformationVector**, vtkInformationVector*);
+
+  virtual void ThreadedRequestData(vtkInformation *request,
+                           vtkInformationVector **inputVector,
+                           vtkInformationVector *outputVector,
+                           vtkImageData ***inData,
+                           vtkImageData **outData,
+                           int outExt[6],
+                           int id);
+
+  /*!
+    Computes the row and column interpolation tables for the current geometry and the specified input image.
+    The tables are not recomputed if the parameters are the same as last time.
+  */
+  void ComputeInterpolationTables(int inputExtent[6], double inputOrigin[3], double inputSpacing[3]);
+
+  /*!
+    Computes the interpolation table of one axis. Input pixel position is inputPositionOffset+outputIndex*inputPositionScale (in pixels).
+    Positions within half a pixel outside the input extent are clamped to the border pixel (same as vtkImageReslice with border enabled).
+  */
+  void ComputeAxisInterpolationTable(AxisInterpolationTable& table, int numberOfOutputPixels, double inputPositionOffset, double inputPositionScale, int inputExtentMin, int inputExtentMax);
+
   /*! Image depth covered by an RF scanline, in mm */
   double ImagingDepthMm;
   /*! Image width covered by the transducer (distance between the first and last RF scanlines), in mm */
   double TransducerWidthMm;
 
-  /*! Reslice class that performs the necessary resampling */
-  vtkImageReslice* ImageReslice;
+  /*! Interpolation method */
+  InterpolationType Interpolation;
+
+  AxisInterpolationTable ColumnInterpolationTable;
+  AxisInterpolationTable RowInterpolationTable;
+
+  /*! Parameters that were used for computing the interpolation tables. Tables are recomputed if any of them changes. */
+  std::vector<double> InterpolationTableParameters;
 
 private:
   vtkPlusUsScanConvertLinear(const vtkPlusUsScanConvertLinear&);  // Not implemented.
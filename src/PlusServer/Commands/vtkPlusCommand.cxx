@@ -249,6 +249,17 @@ void vtkPlusCommand::PopCommandResponses(PlusCommandResponseList& responses)
   responses.splice(responses.end(), this->CommandResponseQueue, this->CommandResponseQueue.begin(), this->CommandResponseQueue.end());
 }
 
+//------------------------------------------------------------------------------
+void vtkPlusCommand::SendQueuedCommandResponses()
+{
+  if (this->CommandProcessor == NULL)
+  {
+    // responses are sent when the command is completed
+    return;
+  }
+  this->CommandProcessor->QueueCommandResponses(this);
+}
+
 //------------------------------------------------------------------------------
 void vtkPlusCommand::QueueCommandResponse(PlusStatus status, const std::string& message, const std::string& error, const igtl::MessageBase::MetaDataMap* replyMetaData)
 {
@@ -141,6 +141,9 @@ protected:
   /*! Helper method to add a command response to the response queue */
   void QueueCommandResponse(PlusStatus status, const std::string& message, const std::string& error = "", const igtl::MessageBase::MetaDataMap* metaData = nullptr);
 
+  /*! Pass the responses queued so far to the command processor, so that they are sent before the command execution is completed */
+  void SendQueuedCommandResponses();
+
   vtkPlusCommand();
   virtual ~vtkPlusCommand();
 
@@ -33,6 +33,7 @@ vtkStandardNewMacro(vtkPlusReconstructVolumeCommand);
 //----------------------------------------------------------------------------
 vtkPlusReconstructVolumeCommand::vtkPlusReconstructVolumeCommand()
   : ApplyHoleFilling(true)
+  , Progressive(false)
 {
   this->OutputOrigin[0] = UNDEFINED_VALUE;
   this->OutputOrigin[1] = UNDEFINED_VALUE;
@@ -124,12 +125,12 @@ std::string vtkPlusReconstructVolumeCommand::GetDescription(const std::string& c
   if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, STOP_LIVE_RECONSTRUCTION_CMD))
   {
     desc += STOP_LIVE_RECONSTRUCTION_CMD;
-    desc += ": Stop adding acquired frames to the volume, finalize reconstruction, and save/send the results. Attributes: VolumeReconstructorDeviceId: ID of the volume reconstructor device. OutputVolFilename: name of the output volume file name (optional). OutputVolDeviceName: name of the OpenIGTLink device for the IMAGE message (optional).";
+    desc += ": Stop adding acquired frames to the volume, finalize reconstruction, and save/send the results. Attributes: VolumeReconstructorDeviceId: ID of the volume reconstructor device. OutputVolFilename: name of the output volume file name (optional). OutputVolDeviceName: name of the OpenIGTLink device for the IMAGE message (optional). Progressive: if TRUE then a downsampled preview is sent before the full resolution volume (optional, default: FALSE).";
   }
   if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, GET_LIVE_RECONSTRUCTION_SNAPSHOT_CMD))
   {
     desc += GET_LIVE_RECONSTRUCTION_SNAPSHOT_CMD;
-    desc += ": Request a snapshot of the live reconstruction result. Attributes: VolumeReconstructorDeviceId: ID of the volume reconstructor device. OutputVolFilename: name of the output volume file name (optional). OutputVolDeviceName: name of the OpenIGTLink device for the IMAGE message (optional). ApplyHoleFilling: if FALSE then holes will not be filled (optional, default: TRUE).";
+    desc += ": Request a snapshot of the live reconstruction result. Attributes: VolumeReconstructorDeviceId: ID of the volume reconstructor device. OutputVolFilename: name of the output volume file name (optional). OutputVolDeviceName: name of the OpenIGTLink device for the IMAGE message (optional). ApplyHoleFilling: if FALSE then holes will not be filled (optional, default: TRUE). Progressive: if TRUE then a downsampled preview is sent before the full resolution volume (optional, default: FALSE).";
   }
 
   return desc;
@@ -154,6 +155,7 @@ PlusStatus vtkPlusReconstructVolumeCommand::ReadConfiguration(vtkXMLDataElement*
   XML_READ_VECTOR_ATTRIBUTE_OPTIONAL(int, 6, OutputExtent, aConfig);
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(ApplyHoleFilling, aConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(Progressive, aConfig);
   return PLUS_SUCCESS;
 }
 
@@ -192,6 +194,7 @@ PlusStatus vtkPlusReconstructVolumeCommand::WriteConfiguration(vtkXMLDataElement
   }
 
   XML_WRITE_BOOL_ATTRIBUTE(ApplyHoleFilling, aConfig);
+  XML_WRITE_BOOL_ATTRIBUTE(Progressive, aConfig);
 
   return PLUS_SUCCESS;
 }
@@ -306,6 +309,10 @@ PlusStatus vtkPlusReconstructVolumeCommand::Execute()
 
     LOG_INFO("Volume reconstruction from live frames stopping, device: " << reconstructorDeviceId);
     reconstructorDevice->SetEnableReconstruction(false);
+    if (this->Progressive && !outputVolDeviceName.empty())
+    {
+      this->SendVolumePreview(reconstructorDevice, outputVolDeviceName);
+    }
     vtkSmartPointer<vtkImageData> volumeToSend = vtkSmartPointer<vtkImageData>::New();
     std::string errorMessage;
     if (reconstructorDevice->GetReconstructedVolume(volumeToSend, errorMessage) != PLUS_SUCCESS)
@@ -322,6 +329,10 @@ PlusStatus vtkPlusReconstructVolumeCommand::Execute()
   else if (igsioCommon::IsEqualInsensitive(this->Name, GET_LIVE_RECONSTRUCTION_SNAPSHOT_CMD))
   {
     LOG_INFO("Volume reconstruction from live frames snapshot request, device: " << reconstructorDeviceId);
+    if (this->Progressive && !outputVolDeviceName.empty())
+    {
+      this->SendVolumePreview(reconstructorDevice, outputVolDeviceName);
+    }
     vtkSmartPointer<vtkImageData> volumeToSend = vtkSmartPointer<vtkImageData>::New();
     std::string errorMessage;
     if (reconstructorDevice->GetReconstructedVolume(volumeToSend, errorMessage, this->ApplyHoleFilling) != PLUS_SUCCESS)
@@ -385,25 +396,49 @@ PlusStatus vtkPlusReconstructVolumeCommand::ProcessImageReply(vtkImageData* volu
   if (!outputVolDeviceName.empty())
   {
     // send the reconstructed volume with the reply
-    LOG_DEBUG("Send image to client through OpenIGTLink");
-    vtkSmartPointer<vtkPlusCommandImageResponse> imageResponse = vtkSmartPointer<vtkPlusCommandImageResponse>::New();
-    imageResponse->SetClientId(this->ClientId);
-    imageResponse->SetImageName(outputVolDeviceName);
-    imageResponse->SetImageData(volumeToSend);
-    vtkSmartPointer<vtkMatrix4x4> volumeToReferenceTransform = vtkSmartPointer<vtkMatrix4x4>::New();
-    imageResponse->SetImageToReferenceTransform(volumeToReferenceTransform);
-    volumeToReferenceTransform->Identity(); // we leave it as identity, as the volume coordinate system is, the same as the reference coordinate system (we may extend this later so that the client can request the volume in any coordinate system)
     LOG_INFO("Send reconstructed volume to client through OpenIGTLink");
+    this->QueueImageResponse(volumeToSend, outputVolDeviceName);
     if (!resultMessage.empty())
     {
       resultMessage += ", ";
     }
     resultMessage += std::string("image sent as: ") + outputVolDeviceName;
-    this->CommandResponseQueue.push_back(imageResponse);
   }
   return status;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusReconstructVolumeCommand::QueueImageResponse(vtkImageData* volumeToSend, const std::string& outputVolDeviceName)
+{
+  LOG_DEBUG("Send image to client through OpenIGTLink");
+  vtkSmartPointer<vtkPlusCommandImageResponse> imageResponse = vtkSmartPointer<vtkPlusCommandImageResponse>::New();
+  imageResponse->SetClientId(this->ClientId);
+  imageResponse->SetImageName(outputVolDeviceName);
+  imageResponse->SetImageData(volumeToSend);
+  vtkSmartPointer<vtkMatrix4x4> volumeToReferenceTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+  imageResponse->SetImageToReferenceTransform(volumeToReferenceTransform);
+  volumeToReferenceTransform->Identity(); // we leave it as identity, as the volume coordinate system is, the same as the reference coordinate system (we may extend this later so that the client can request the volume in any coordinate system)
+  this->CommandResponseQueue.push_back(imageResponse);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusReconstructVolumeCommand::SendVolumePreview(vtkPlusVirtualVolumeReconstructor* reconstructorDevice, const std::string& outputVolDeviceName)
+{
+  vtkSmartPointer<vtkImageData> previewVolume = vtkSmartPointer<vtkImageData>::New();
+  std::string errorMessage;
+  if (reconstructorDevice->GetReconstructedVolumePreview(previewVolume, errorMessage) != PLUS_SUCCESS)
+  {
+    // the full resolution volume is still sent
+    LOG_WARNING("Reconstructed volume preview is not sent: " << errorMessage);
+    return PLUS_FAIL;
+  }
+  LOG_DEBUG("Send reconstructed volume preview to client through OpenIGTLink");
+  // The full resolution volume is sent with the same device name, so the client replaces the preview with it
+  this->QueueImageResponse(previewVolume, outputVolDeviceName);
+  this->SendQueuedCommandResponses();
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 vtkPlusVirtualVolumeReconstructor* vtkPlusReconstructVolumeCommand::GetVolumeReconstructorDevice()
 {
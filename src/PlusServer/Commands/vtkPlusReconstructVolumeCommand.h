@@ -87,6 +87,14 @@ public:
   vtkGetMacro(ApplyHoleFilling, bool);
   vtkSetMacro(ApplyHoleFilling, bool);
 
+  /*!
+    If enabled then a downsampled preview of the live reconstruction is sent to the client (using the OutputVolDeviceName)
+    before the full resolution volume is computed and sent
+  */
+  vtkGetMacro(Progressive, bool);
+  vtkSetMacro(Progressive, bool);
+  vtkBooleanMacro(Progressive, bool);
+
   void SetNameToReconstruct();
   void SetNameToStart();
   void SetNameToStop();
@@ -98,6 +106,12 @@ protected:
   /*! Saves image to disk (if requested) and prepare sending image as a response (if requested) */
   PlusStatus ProcessImageReply(vtkImageData* volumeToSend, const std::string& outputVolFilename, const std::string& outputVolDeviceName, std::string& resultMessage);
 
+  /*! Add an IMAGE message response with the volume in the Reference coordinate system */
+  void QueueImageResponse(vtkImageData* volumeToSend, const std::string& outputVolDeviceName);
+
+  /*! Send a downsampled preview of the live reconstruction to the client immediately */
+  PlusStatus SendVolumePreview(vtkPlusVirtualVolumeReconstructor* reconstructorDevice, const std::string& outputVolDeviceName);
+
   vtkPlusVirtualVolumeReconstructor* GetVolumeReconstructorDevice();
 
   vtkPlusReconstructVolumeCommand();
@@ -115,6 +129,7 @@ protected:
   int OutputExtent[6];
 
   bool ApplyHoleFilling;
+  bool Progressive;
 
   vtkPlusReconstructVolumeCommand(const vtkPlusReconstructVolumeCommand&);
   void operator=(const vtkPlusReconstructVolumeCommand&);
@@ -184,10 +184,7 @@ int vtkPlusCommandProcessor::ExecuteCommands()
     }
 
     // move the response objects from the command to the processor's queue
-    {
-      igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
-      cmd->PopCommandResponses(this->CommandResponseQueue);
-    }
+    this->QueueCommandResponses(cmd);
 
     numberOfExecutedCommands++;
   }
@@ -385,6 +382,13 @@ void vtkPlusCommandProcessor::PopCommandResponses(PlusCommandResponseList& respo
   responses.splice(responses.end(), this->CommandResponseQueue, this->CommandResponseQueue.begin(), this->CommandResponseQueue.end());
 }
 
+//------------------------------------------------------------------------------
+void vtkPlusCommandProcessor::QueueCommandResponses(vtkPlusCommand* cmd)
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  cmd->PopCommandResponses(this->CommandResponseQueue);
+}
+
 //------------------------------------------------------------------------------
 bool vtkPlusCommandProcessor::IsRunning()
 {
@@ -88,6 +88,13 @@ public:
   */
   virtual void PopCommandResponses(PlusCommandResponseList& responses);
 
+  /*!
+    Move the responses that a command has queued so far into the response queue, so that they are sent
+    without waiting for the completion of the command (e.g., a preview before a long computation).
+    Can be called from any thread.
+  */
+  virtual void QueueCommandResponses(vtkPlusCommand* cmd);
+
   vtkGetObjectMacro(PlusServer, vtkPlusOpenIGTLinkServer);
   vtkSetObjectMacro(PlusServer, vtkPlusOpenIGTLinkServer);
 
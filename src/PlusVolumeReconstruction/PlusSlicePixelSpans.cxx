@@ -0,0 +1,312 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusSlicePixelSpans.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  const long long ROW_BAND_WASTE_RATIO = 16; // at most 1/ROW_BAND_WASTE_RATIO of the pixels of a row band are invalid
+
+  //----------------------------------------------------------------------------
+  // Cross product of (b-a) and (c-a), positive if a, b, c is a counter-clockwise turn
+  long long Cross(const std::array<int, 2>& a, const std::array<int, 2>& b, const std::array<int, 2>& c)
+  {
+    return static_cast<long long>(b[0] - a[0]) * (c[1] - a[1]) - static_cast<long long>(b[1] - a[1]) * (c[0] - a[0]);
+  }
+
+  //----------------------------------------------------------------------------
+  // Convex hull of points sorted by (x, y) using the monotone chain algorithm
+  void GetConvexHull(const std::vector<std::array<int, 2> >& sortedPoints, std::vector<std::array<int, 2> >& hull)
+  {
+    hull.clear();
+    if (sortedPoints.size() < 3)
+    {
+      hull = sortedPoints;
+      return;
+    }
+    hull.resize(2 * sortedPoints.size());
+    size_t k = 0;
+    for (size_t i = 0; i < sortedPoints.size(); i++)
+    {
+      while (k >= 2 && Cross(hull[k - 2], hull[k - 1], sortedPoints[i]) <= 0)
+      {
+        k--;
+      }
+      hull[k++] = sortedPoints[i];
+    }
+    for (size_t i = sortedPoints.size() - 1, lowerSize = k + 1; i > 0; i--)
+    {
+      while (k >= lowerSize && Cross(hull[k - 2], hull[k - 1], sortedPoints[i - 1]) <= 0)
+      {
+        k--;
+      }
+      hull[k++] = sortedPoints[i - 1];
+    }
+    hull.resize(k - 1);
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusSlicePixelSpans::Geometry::Geometry()
+  : FanClipping(false)
+  , FanRadiusStartPixel(0.0)
+  , FanRadiusStopPixel(0.0)
+  , ImportanceMask(NULL)
+  , ImportanceMaskModifiedTime(0)
+{
+  this->FrameSize = { 0, 0, 0 };
+  for (int i = 0; i < 2; i++)
+  {
+    this->ClipRectangleOrigin[i] = 0;
+    this->ClipRectangleSize[i] = 0;
+    this->FanOrigin[i] = 0.0;
+    this->FanAnglesDeg[i] = 0.0;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool PlusSlicePixelSpans::Geometry::operator==(const Geometry& other) const
+{
+  if (this->FrameSize != other.FrameSize || this->FanClipping != other.FanClipping
+      || this->ImportanceMask != other.ImportanceMask || this->ImportanceMaskModifiedTime != other.ImportanceMaskModifiedTime)
+  {
+    return false;
+  }
+  for (int i = 0; i < 2; i++)
+  {
+    if (this->ClipRectangleOrigin[i] != other.ClipRectangleOrigin[i] || this->ClipRectangleSize[i] != other.ClipRectangleSize[i])
+    {
+      return false;
+    }
+  }
+  if (!this->FanClipping)
+  {
+    // fan parameters are not used
+    return true;
+  }
+  return this->FanOrigin[0] == other.FanOrigin[0] && this->FanOrigin[1] == other.FanOrigin[1]
+         && this->FanAnglesDeg[0] == other.FanAnglesDeg[0] && this->FanAnglesDeg[1] == other.FanAnglesDeg[1]
+         && this->FanRadiusStartPixel == other.FanRadiusStartPixel && this->FanRadiusStopPixel == other.FanRadiusStopPixel;
+}
+
+//----------------------------------------------------------------------------
+PlusSlicePixelSpans::PlusSlicePixelSpans()
+  : Computed(false)
+  , NumberOfValidPixels(0)
+{
+  this->BoundingRectangle[0] = 0;
+  this->BoundingRectangle[1] = -1;
+  this->BoundingRectangle[2] = 0;
+  this->BoundingRectangle[3] = -1;
+}
+
+//----------------------------------------------------------------------------
+void PlusSlicePixelSpans::Compute(const Geometry& geometry)
+{
+  this->ComputedGeometry = geometry;
+  this->Computed = true;
+  this->Spans.clear();
+  this->OutlinePoints.clear();
+  this->RowBands.clear();
+  this->NumberOfValidPixels = 0;
+  this->BoundingRectangle[0] = VTK_INT_MAX;
+  this->BoundingRectangle[1] = VTK_INT_MIN;
+  this->BoundingRectangle[2] = VTK_INT_MAX;
+  this->BoundingRectangle[3] = VTK_INT_MIN;
+
+  const int width = static_cast<int>(geometry.FrameSize[0]);
+  const int height = static_cast<int>(geometry.FrameSize[1]);
+  int firstColumn = 0;
+  int lastColumn = width - 1;
+  int firstRow = 0;
+  int lastRow = height - 1;
+  if (geometry.ClipRectangleSize[0] > 0 && geometry.ClipRectangleSize[1] > 0)
+  {
+    // The pixel after the last one (origin + size) is also included, so the spans contain the clip rectangle
+    // whether or not the paste algorithm includes its end
+    firstColumn = std::max(firstColumn, geometry.ClipRectangleOrigin[0]);
+    lastColumn = std::min(lastColumn, geometry.ClipRectangleOrigin[0] + geometry.ClipRectangleSize[0]);
+    firstRow = std::max(firstRow, geometry.ClipRectangleOrigin[1]);
+    lastRow = std::min(lastRow, geometry.ClipRectangleOrigin[1] + geometry.ClipRectangleSize[1]);
+  }
+  if (firstColumn > lastColumn || firstRow > lastRow)
+  {
+    return;
+  }
+
+  // Fan test of the clip rectangle and a one pixel border, dilated by one pixel, so that rounding differences
+  // in the fan test of the paste algorithm cannot make a pasted pixel invalid
+  const int maskWidth = lastColumn - firstColumn + 3;
+  const int maskHeight = lastRow - firstRow + 3;
+  std::vector<unsigned char> insideFan;
+  if (geometry.FanClipping)
+  {
+    insideFan.assign(static_cast<size_t>(maskWidth) * maskHeight, 0);
+    const double radiusStartSquared = geometry.FanRadiusStartPixel * geometry.FanRadiusStartPixel;
+    const double radiusStopSquared = geometry.FanRadiusStopPixel * geometry.FanRadiusStopPixel;
+    for (int maskRow = 0; maskRow < maskHeight; maskRow++)
+    {
+      const double dy = firstRow - 1 + maskRow - geometry.FanOrigin[1];
+      for (int maskColumn = 0; maskColumn < maskWidth; maskColumn++)
+      {
+        const double dx = firstColumn - 1 + maskColumn - geometry.FanOrigin[0];
+        const double radiusSquared = dx * dx + dy * dy;
+        if (radiusSquared < radiusStartSquared || radiusSquared > radiusStopSquared)
+        {
+          continue;
+        }
+        const double angleDeg = vtkMath::DegreesFromRadians(atan2(dx, dy));
+        if (angleDeg < geometry.FanAnglesDeg[0] || angleDeg > geometry.FanAnglesDeg[1])
+        {
+          continue;
+        }
+        insideFan[static_cast<size_t>(maskRow) * maskWidth + maskColumn] = 1;
+      }
+    }
+  }
+
+  vtkImageData* importanceMask = geometry.ImportanceMask;
+  int maskExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  if (importanceMask != NULL)
+  {
+    importanceMask->GetExtent(maskExtent);
+    if (importanceMask->GetScalarPointer() == NULL || importanceMask->GetScalarType() != VTK_UNSIGNED_CHAR
+        || maskExtent[0] > firstColumn || maskExtent[1] < lastColumn || maskExtent[2] > firstRow || maskExtent[3] < lastRow)
+    {
+      // the mask does not cover the frame, it is not used for clipping
+      importanceMask = NULL;
+    }
+  }
+
+  std::vector<std::array<int, 2> > spanEndPoints;
+  for (int row = firstRow; row <= lastRow; row++)
+  {
+    const unsigned char* importancePtr = NULL;
+    int importanceIncrement = 0;
+    if (importanceMask != NULL)
+    {
+      importancePtr = static_cast<unsigned char*>(importanceMask->GetScalarPointer(maskExtent[0], row, maskExtent[4]));
+      importanceIncrement = importanceMask->GetNumberOfScalarComponents();
+    }
+    int spanStart = -1;
+    for (int column = firstColumn; column <= lastColumn + 1; column++)
+    {
+      bool valid = (column <= lastColumn);
+      if (valid && !insideFan.empty())
+      {
+        // 3x3 neighborhood in the dilated fan mask
+        const int maskColumn = column - firstColumn + 1;
+        const int maskRow = row - firstRow + 1;
+        valid = false;
+        for (int neighborRow = maskRow - 1; neighborRow <= maskRow + 1 && !valid; neighborRow++)
+        {
+          const unsigned char* maskPtr = &insideFan[static_cast<size_t>(neighborRow) * maskWidth + maskColumn - 1];
+          valid = (maskPtr[0] != 0 || maskPtr[1] != 0 || maskPtr[2] != 0);
+        }
+      }
+      if (valid && importancePtr != NULL)
+      {
+        valid = (importancePtr[(column - maskExtent[0]) * importanceIncrement] != 0);
+      }
+
+      if (valid && spanStart < 0)
+      {
+        spanStart = column;
+      }
+      else if (!valid && spanStart >= 0)
+      {
+        Span span = { row, spanStart, column - 1 };
+        this->Spans.push_back(span);
+        this->NumberOfValidPixels += span.LastColumn - span.FirstColumn + 1;
+        this->BoundingRectangle[0] = std::min(this->BoundingRectangle[0], span.FirstColumn);
+        this->BoundingRectangle[1] = std::max(this->BoundingRectangle[1], span.LastColumn);
+        this->BoundingRectangle[2] = std::min(this->BoundingRectangle[2], row);
+        this->BoundingRectangle[3] = std::max(this->BoundingRectangle[3], row);
+        std::array<int, 2> spanFirstPoint = { { span.FirstColumn, row } };
+        std::array<int, 2> spanLastPoint = { { span.LastColumn, row } };
+        spanEndPoints.push_back(spanFirstPoint);
+        spanEndPoints.push_back(spanLastPoint);
+        spanStart = -1;
+      }
+    }
+  }
+
+  std::sort(spanEndPoints.begin(), spanEndPoints.end());
+  spanEndPoints.erase(std::unique(spanEndPoints.begin(), spanEndPoints.end()), spanEndPoints.end());
+  GetConvexHull(spanEndPoints, this->OutlinePoints);
+
+  this->ComputeRowBands();
+}
+
+//----------------------------------------------------------------------------
+void PlusSlicePixelSpans::ComputeRowBands()
+{
+  long long bandValidPixels = 0;
+  for (std::vector<Span>::const_iterator spanIt = this->Spans.begin(); spanIt != this->Spans.end();)
+  {
+    // Columns of the valid pixels of the row (a row may have more spans)
+    RowBand row = { spanIt->Row, spanIt->Row, spanIt->FirstColumn, spanIt->LastColumn };
+    long long rowValidPixels = 0;
+    for (; spanIt != this->Spans.end() && spanIt->Row == row.FirstRow; ++spanIt)
+    {
+      row.LastColumn = spanIt->LastColumn;
+      rowValidPixels += spanIt->LastColumn - spanIt->FirstColumn + 1;
+    }
+
+    if (!this->RowBands.empty())
+    {
+      RowBand merged = this->RowBands.back();
+      merged.LastRow = row.LastRow;
+      merged.FirstColumn = std::min(merged.FirstColumn, row.FirstColumn);
+      merged.LastColumn = std::max(merged.LastColumn, row.LastColumn);
+      const long long mergedPixels = static_cast<long long>(merged.LastRow - merged.FirstRow + 1) * (merged.LastColumn - merged.FirstColumn + 1);
+      const long long mergedValidPixels = bandValidPixels + rowValidPixels;
+      const bool singleRowBand = (this->RowBands.back().FirstRow == this->RowBands.back().LastRow);
+      if (singleRowBand || (row.FirstRow == this->RowBands.back().LastRow + 1 && (mergedPixels - mergedValidPixels) * ROW_BAND_WASTE_RATIO <= mergedPixels))
+      {
+        this->RowBands.back() = merged;
+        bandValidPixels = mergedValidPixels;
+        continue;
+      }
+    }
+    this->RowBands.push_back(row);
+    bandValidPixels = rowValidPixels;
+  }
+
+  if (this->RowBands.size() > 1 && this->RowBands.back().FirstRow == this->RowBands.back().LastRow)
+  {
+    // The last band has a single row, merge it into the previous one
+    RowBand lastRow = this->RowBands.back();
+    this->RowBands.pop_back();
+    this->RowBands.back().LastRow = lastRow.LastRow;
+    this->RowBands.back().FirstColumn = std::min(this->RowBands.back().FirstColumn, lastRow.FirstColumn);
+    this->RowBands.back().LastColumn = std::max(this->RowBands.back().LastColumn, lastRow.LastColumn);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool PlusSlicePixelSpans::GetBoundingRectangle(int origin[2], int size[2]) const
+{
+  if (this->Spans.empty())
+  {
+    return false;
+  }
+  origin[0] = this->BoundingRectangle[0];
+  origin[1] = this->BoundingRectangle[2];
+  size[0] = this->BoundingRectangle[1] - this->BoundingRectangle[0] + 1;
+  size[1] = this->BoundingRectangle[3] - this->BoundingRectangle[2] + 1;
+  return true;
+}
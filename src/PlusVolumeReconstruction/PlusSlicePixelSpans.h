@@ -0,0 +1,119 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusSlicePixelSpans_h
+#define __PlusSlicePixelSpans_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusVolumeReconstructionExport.h"
+
+// IGSIO includes
+#include <igsioCommon.h>
+
+// VTK includes
+#include <vtkType.h>
+
+#include <array>
+#include <vector>
+
+class vtkImageData;
+
+/*!
+  \class PlusSlicePixelSpans
+  \brief Run-length list of the pixels of a frame that slice insertion may paste into the volume
+
+  A pixel is valid if it is inside the clip rectangle, inside the fan (with a one pixel margin, so that the list
+  is never smaller than the region that the fan clipping of the paste algorithm accepts) and its importance is not zero.
+  The list only depends on the frame size and the clipping parameters, so it is computed once and reused for all frames.
+  Insertion uses it to restrict the pasted region and the modified voxel extents to the valid pixels.
+  The paste algorithm can only be restricted to a rectangle, so the rows are also grouped into row bands:
+  rectangles of consecutive rows that cover the spans of those rows with few invalid pixels.
+
+  \ingroup PlusLibVolumeReconstruction
+*/
+class vtkPlusVolumeReconstructionExport PlusSlicePixelSpans
+{
+public:
+  /*! Valid pixels from FirstColumn to LastColumn (inclusive) in a row */
+  struct Span
+  {
+    int Row;
+    int FirstColumn;
+    int LastColumn;
+  };
+
+  /*! Rows from FirstRow to LastRow and columns from FirstColumn to LastColumn (all inclusive) */
+  struct RowBand
+  {
+    int FirstRow;
+    int LastRow;
+    int FirstColumn;
+    int LastColumn;
+  };
+
+  /*! Parameters that determine the valid pixels */
+  struct Geometry
+  {
+    Geometry();
+    bool operator==(const Geometry& other) const;
+    bool operator!=(const Geometry& other) const { return !(*this == other); }
+
+    FrameSizeType FrameSize;
+    /*! Clip rectangle in pixels, the whole frame is used if the size is not positive */
+    int ClipRectangleOrigin[2];
+    int ClipRectangleSize[2];
+    bool FanClipping;
+    double FanOrigin[2];
+    double FanAnglesDeg[2];
+    double FanRadiusStartPixel;
+    double FanRadiusStopPixel;
+    /*! Optional, pixels where the first component of the mask is 0 are invalid. Not owned. */
+    vtkImageData* ImportanceMask;
+    vtkMTimeType ImportanceMaskModifiedTime;
+  };
+
+  PlusSlicePixelSpans();
+
+  /*! Compute the spans for the geometry. Rows are in increasing order, spans within a row in increasing column order. */
+  void Compute(const Geometry& geometry);
+
+  /*! Returns true if the spans are computed for the geometry */
+  bool IsComputedForGeometry(const Geometry& geometry) const { return this->Computed && this->ComputedGeometry == geometry; }
+
+  const std::vector<Span>& GetSpans() const { return this->Spans; }
+  bool IsEmpty() const { return this->Spans.empty(); }
+  long long GetNumberOfValidPixels() const { return this->NumberOfValidPixels; }
+
+  /*! Get the smallest rectangle that contains all valid pixels. Returns false if there are no valid pixels. */
+  bool GetBoundingRectangle(int origin[2], int size[2]) const;
+
+  /*!
+    Get the row bands, in increasing row order. The bands do not overlap and cover all valid pixels, consecutive rows are merged into
+    a band while at most 1/16 of its pixels are invalid. A band has at least two rows unless all valid pixels
+    are in a single row (a band may then include rows without valid pixels).
+  */
+  const std::vector<RowBand>& GetRowBands() const { return this->RowBands; }
+
+  /*!
+    Get the vertices (column, row) of the convex hull of the valid pixels. Any affine transform of the valid pixels
+    is contained in the bounding box of the transformed vertices, so extents can be computed from a few points.
+  */
+  const std::vector<std::array<int, 2> >& GetOutlinePoints() const { return this->OutlinePoints; }
+
+protected:
+  /*! Group the rows of the spans into row bands */
+  void ComputeRowBands();
+
+  bool Computed;
+  Geometry ComputedGeometry;
+  std::vector<Span> Spans;
+  long long NumberOfValidPixels;
+  int BoundingRectangle[4]; // first column, last column, first row, last row
+  std::vector<std::array<int, 2> > OutlinePoints;
+  std::vector<RowBand> RowBands;
+};
+
+#endif
@@ -0,0 +1,272 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusVolumeBrickGrid.h"
+
+// STL includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+PlusVolumeBrickGrid::PlusVolumeBrickGrid()
+  : BrickSize(DEFAULT_BRICK_SIZE)
+  , NumberOfModifiedBricks(0)
+  , NumberOfTouchedBricks(0)
+{
+  for (int i = 0; i < 3; i++)
+  {
+    this->VolumeExtent[2 * i] = 0;
+    this->VolumeExtent[2 * i + 1] = -1;
+    this->GridSize[i] = 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusVolumeBrickGrid::Initialize(const int volumeExtent[6], bool allBricksTouched, int brickSize /*= DEFAULT_BRICK_SIZE*/)
+{
+  this->BrickSize = std::max(brickSize, 1);
+  size_t numberOfBricks = 1;
+  for (int i = 0; i < 3; i++)
+  {
+    this->VolumeExtent[2 * i] = volumeExtent[2 * i];
+    this->VolumeExtent[2 * i + 1] = volumeExtent[2 * i + 1];
+    int numberOfVoxels = std::max(volumeExtent[2 * i + 1] - volumeExtent[2 * i] + 1, 0);
+    this->GridSize[i] = (numberOfVoxels + this->BrickSize - 1) / this->BrickSize;
+    numberOfBricks *= this->GridSize[i];
+  }
+  this->BrickFlags.assign(numberOfBricks, allBricksTouched ? BRICK_TOUCHED : 0);
+  this->NumberOfModifiedBricks = 0;
+  this->NumberOfTouchedBricks = allBricksTouched ? static_cast<int>(numberOfBricks) : 0;
+}
+
+//----------------------------------------------------------------------------
+bool PlusVolumeBrickGrid::IsInitializedForExtent(const int volumeExtent[6]) const
+{
+  return std::equal(volumeExtent, volumeExtent + 6, this->VolumeExtent);
+}
+
+//----------------------------------------------------------------------------
+void PlusVolumeBrickGrid::MarkModified(const int extent[6])
+{
+  int firstBrick[3] = { 0, 0, 0 };
+  int lastBrick[3] = { -1, -1, -1 };
+  for (int i = 0; i < 3; i++)
+  {
+    int first = std::max(extent[2 * i], this->VolumeExtent[2 * i]);
+    int last = std::min(extent[2 * i + 1], this->VolumeExtent[2 * i + 1]);
+    if (first > last)
+    {
+      // outside of the volume
+      return;
+    }
+    firstBrick[i] = (first - this->VolumeExtent[2 * i]) / this->BrickSize;
+    lastBrick[i] = (last - this->VolumeExtent[2 * i]) / this->BrickSize;
+  }
+  for (int z = firstBrick[2]; z <= lastBrick[2]; z++)
+  {
+    for (int y = firstBrick[1]; y <= lastBrick[1]; y++)
+    {
+      unsigned char* brickFlags = &this->BrickFlags[(static_cast<size_t>(z) * this->GridSize[1] + y) * this->GridSize[0]];
+      for (int x = firstBrick[0]; x <= lastBrick[0]; x++)
+      {
+        if (!(brickFlags[x] & BRICK_MODIFIED))
+        {
+          this->NumberOfModifiedBricks++;
+        }
+        if (!(brickFlags[x] & BRICK_TOUCHED))
+        {
+          this->NumberOfTouchedBricks++;
+        }
+        brickFlags[x] = BRICK_MODIFIED | BRICK_TOUCHED;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusVolumeBrickGrid::MarkCleared()
+{
+  for (std::vector<unsigned char>::iterator it = this->BrickFlags.begin(); it != this->BrickFlags.end(); ++it)
+  {
+    if (*it & BRICK_TOUCHED)
+    {
+      *it = BRICK_MODIFIED;
+    }
+  }
+  this->NumberOfModifiedBricks = static_cast<int>(std::count(this->BrickFlags.begin(), this->BrickFlags.end(), static_cast<unsigned char>(BRICK_MODIFIED)));
+  this->NumberOfTouchedBricks = 0;
+}
+
+//----------------------------------------------------------------------------
+void PlusVolumeBrickGrid::ClearModified()
+{
+  for (std::vector<unsigned char>::iterator it = this->BrickFlags.begin(); it != this->BrickFlags.end(); ++it)
+  {
+    *it &= ~BRICK_MODIFIED;
+  }
+  this->NumberOfModifiedBricks = 0;
+}
+
+//----------------------------------------------------------------------------
+void PlusVolumeBrickGrid::GetModifiedExtents(std::vector<ExtentType>& extents) const
+{
+  extents.clear();
+  if (this->NumberOfModifiedBricks == 0)
+  {
+    return;
+  }
+  for (int z = 0; z < this->GridSize[2]; z++)
+  {
+    for (int y = 0; y < this->GridSize[1]; y++)
+    {
+      const unsigned char* brickFlags = &this->BrickFlags[(static_cast<size_t>(z) * this->GridSize[1] + y) * this->GridSize[0]];
+      for (int x = 0; x < this->GridSize[0]; x++)
+      {
+        if (!(brickFlags[x] & BRICK_MODIFIED))
+        {
+          continue;
+        }
+        int runFirstBrick = x;
+        while (x + 1 < this->GridSize[0] && (brickFlags[x + 1] & BRICK_MODIFIED))
+        {
+          x++;
+        }
+        const ExtentType brickExtent = { { runFirstBrick, x, y, y, z, z } };
+        extents.push_back(this->GetVoxelExtent(brickExtent));
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusVolumeBrickGrid::GetModifiedRegions(std::vector<ExtentType>& regions, int maxNumberOfRegions) const
+{
+  regions.clear();
+  if (this->NumberOfModifiedBricks == 0)
+  {
+    return;
+  }
+
+  // Boxes in brick indices, the rectangles of layer z start at layerFirstBox
+  std::vector<ExtentType> boxes;
+  for (int z = 0; z < this->GridSize[2]; z++)
+  {
+    const size_t layerFirstBox = boxes.size();
+    for (int y = 0; y < this->GridSize[1]; y++)
+    {
+      const unsigned char* brickFlags = &this->BrickFlags[(static_cast<size_t>(z) * this->GridSize[1] + y) * this->GridSize[0]];
+      for (int x = 0; x < this->GridSize[0]; x++)
+      {
+        if (!(brickFlags[x] & BRICK_MODIFIED))
+        {
+          continue;
+        }
+        int runFirstBrick = x;
+        while (x + 1 < this->GridSize[0] && (brickFlags[x + 1] & BRICK_MODIFIED))
+        {
+          x++;
+        }
+        // Extend the rectangle of the previous row if it has the same x range
+        bool merged = false;
+        for (size_t boxIndex = layerFirstBox; boxIndex < boxes.size(); boxIndex++)
+        {
+          if (boxes[boxIndex][0] == runFirstBrick && boxes[boxIndex][1] == x && boxes[boxIndex][3] == y - 1)
+          {
+            boxes[boxIndex][3] = y;
+            merged = true;
+            break;
+          }
+        }
+        if (!merged)
+        {
+          const ExtentType box = { { runFirstBrick, x, y, y, z, z } };
+          boxes.push_back(box);
+        }
+      }
+      if (static_cast<int>(boxes.size()) > maxNumberOfRegions)
+      {
+        ExtentType boundingExtent;
+        this->GetModifiedBoundingExtent(boundingExtent);
+        regions.push_back(boundingExtent);
+        return;
+      }
+    }
+
+    // Extend the boxes of the previous layer with the rectangles of this layer that have the same x and y range
+    for (size_t rectangleIndex = layerFirstBox; rectangleIndex < boxes.size();)
+    {
+      bool merged = false;
+      for (size_t boxIndex = 0; boxIndex < layerFirstBox; boxIndex++)
+      {
+        ExtentType& box = boxes[boxIndex];
+        const ExtentType& rectangle = boxes[rectangleIndex];
+        if (box[5] == z - 1 && box[0] == rectangle[0] && box[1] == rectangle[1] && box[2] == rectangle[2] && box[3] == rectangle[3])
+        {
+          box[5] = z;
+          merged = true;
+          break;
+        }
+      }
+      if (merged)
+      {
+        boxes.erase(boxes.begin() + rectangleIndex);
+      }
+      else
+      {
+        rectangleIndex++;
+      }
+    }
+  }
+
+  for (std::vector<ExtentType>::const_iterator boxIt = boxes.begin(); boxIt != boxes.end(); ++boxIt)
+  {
+    regions.push_back(this->GetVoxelExtent(*boxIt));
+  }
+}
+
+//----------------------------------------------------------------------------
+bool PlusVolumeBrickGrid::GetModifiedBoundingExtent(ExtentType& extent) const
+{
+  if (this->NumberOfModifiedBricks == 0)
+  {
+    return false;
+  }
+  ExtentType brickExtent = { { this->GridSize[0], -1, this->GridSize[1], -1, this->GridSize[2], -1 } };
+  for (int z = 0; z < this->GridSize[2]; z++)
+  {
+    for (int y = 0; y < this->GridSize[1]; y++)
+    {
+      const unsigned char* brickFlags = &this->BrickFlags[(static_cast<size_t>(z) * this->GridSize[1] + y) * this->GridSize[0]];
+      for (int x = 0; x < this->GridSize[0]; x++)
+      {
+        if (brickFlags[x] & BRICK_MODIFIED)
+        {
+          const int brickIndex[3] = { x, y, z };
+          for (int i = 0; i < 3; i++)
+          {
+            brickExtent[2 * i] = std::min(brickExtent[2 * i], brickIndex[i]);
+            brickExtent[2 * i + 1] = std::max(brickExtent[2 * i + 1], brickIndex[i]);
+          }
+        }
+      }
+    }
+  }
+  extent = this->GetVoxelExtent(brickExtent);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+PlusVolumeBrickGrid::ExtentType PlusVolumeBrickGrid::GetVoxelExtent(const ExtentType& brickExtent) const
+{
+  ExtentType extent;
+  for (int i = 0; i < 3; i++)
+  {
+    extent[2 * i] = this->VolumeExtent[2 * i] + brickExtent[2 * i] * this->BrickSize;
+    extent[2 * i + 1] = std::min(this->VolumeExtent[2 * i] + (brickExtent[2 * i + 1] + 1) * this->BrickSize - 1, this->VolumeExtent[2 * i + 1]);
+  }
+  return extent;
+}
@@ -0,0 +1,94 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusVolumeBrickGrid_h
+#define __PlusVolumeBrickGrid_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusVolumeReconstructionExport.h"
+
+#include <array>
+#include <vector>
+
+/*!
+  \class PlusVolumeBrickGrid
+  \brief Divides a volume into bricks (blocks of voxels) and keeps track of which bricks were modified and which were touched
+
+  A brick is touched if any voxel in it may have been written since the volume was created or cleared.
+  A brick is modified if it may have been written since the last call of ClearModified. Consumers of a volume
+  that is being reconstructed (snapshot copy, hole filling, downsampled preview) use it to process only the bricks
+  that changed, and to process only touched bricks when the volume is cleared.
+
+  The grid only does the bookkeeping and does not reduce the memory usage of the volume: the voxels of all bricks
+  are stored in one dense vtkImageData, because the slice paster and the hole filler of IGSIO
+  (vtkIGSIOPasteSliceIntoVolume, vtkIGSIOFillHolesInVolume) write whole volumes.
+
+  \ingroup PlusLibVolumeReconstruction
+*/
+class vtkPlusVolumeReconstructionExport PlusVolumeBrickGrid
+{
+public:
+  typedef std::array<int, 6> ExtentType;
+
+  PlusVolumeBrickGrid();
+
+  /*!
+    Set the voxel extent (xMin, xMax, yMin, yMax, zMin, zMax) of the volume and the brick size.
+    No brick is modified after initialization.
+    \param allBricksTouched If true then all bricks are marked as touched (for volumes that may already contain data)
+  */
+  void Initialize(const int volumeExtent[6], bool allBricksTouched, int brickSize = DEFAULT_BRICK_SIZE);
+
+  /*! Returns true if the grid is initialized for the specified volume extent */
+  bool IsInitializedForExtent(const int volumeExtent[6]) const;
+
+  /*! Mark the bricks that intersect the voxel extent as modified and touched */
+  void MarkModified(const int extent[6]);
+
+  /*! The volume was cleared: bricks that contained data are marked as modified and no brick is touched anymore */
+  void MarkCleared();
+
+  /*! Unmark all modified bricks */
+  void ClearModified();
+
+  /*! Get voxel extents that cover all modified bricks. Consecutive modified bricks along the x axis are merged into one extent. */
+  void GetModifiedExtents(std::vector<ExtentType>& extents) const;
+
+  /*!
+    Get voxel extents of boxes that cover all modified bricks and no other bricks. Runs of modified bricks along the x axis
+    are merged along the y axis if they have the same x range, then the rectangles are merged along the z axis if they have the same x and y range.
+    If more than maxNumberOfRegions boxes would be needed then the bounding box of the modified bricks is returned.
+  */
+  void GetModifiedRegions(std::vector<ExtentType>& regions, int maxNumberOfRegions) const;
+
+  /*! Get the voxel extent of the bounding box of the modified bricks. Returns false if no brick is modified. */
+  bool GetModifiedBoundingExtent(ExtentType& extent) const;
+
+  int GetNumberOfBricks() const { return static_cast<int>(this->BrickFlags.size()); }
+  int GetNumberOfModifiedBricks() const { return this->NumberOfModifiedBricks; }
+  int GetNumberOfTouchedBricks() const { return this->NumberOfTouchedBricks; }
+
+  static const int DEFAULT_BRICK_SIZE = 16;
+
+protected:
+  /*! Convert an extent in brick indices to voxel extent */
+  ExtentType GetVoxelExtent(const ExtentType& brickExtent) const;
+
+  enum BrickFlag
+  {
+    BRICK_MODIFIED = 1,
+    BRICK_TOUCHED = 2
+  };
+
+  int VolumeExtent[6];
+  int BrickSize;
+  int GridSize[3];
+  std::vector<unsigned char> BrickFlags;
+  int NumberOfModifiedBricks;
+  int NumberOfTouchedBricks;
+};
+
+#endif
@@ -0,0 +1,493 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusSlicePixelSpansTest.cxx
+  \brief Verifies the spans, bounding rectangle, outline and row bands of PlusSlicePixelSpans for clip rectangles, fans and importance masks,
+  and that the cached spans are invalidated when any parameter of the geometry changes
+*/
+
+#include "PlusConfigure.h"
+#include "PlusSlicePixelSpans.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace
+{
+  int NumberOfFailures = 0;
+
+  //----------------------------------------------------------------------------
+  PlusSlicePixelSpans::Geometry MakeGeometry(unsigned int width, unsigned int height, int clipOriginX, int clipOriginY, int clipSizeX, int clipSizeY)
+  {
+    PlusSlicePixelSpans::Geometry geometry;
+    geometry.FrameSize = { width, height, 1 };
+    geometry.ClipRectangleOrigin[0] = clipOriginX;
+    geometry.ClipRectangleOrigin[1] = clipOriginY;
+    geometry.ClipRectangleSize[0] = clipSizeX;
+    geometry.ClipRectangleSize[1] = clipSizeY;
+    return geometry;
+  }
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkImageData> MakeImportanceMask(int firstColumn, int lastColumn, int firstRow, int lastRow, int scalarType, int zeroColumn)
+  {
+    vtkSmartPointer<vtkImageData> mask = vtkSmartPointer<vtkImageData>::New();
+    mask->SetExtent(firstColumn, lastColumn, firstRow, lastRow, 0, 0);
+    mask->AllocateScalars(scalarType, 1);
+    for (int row = firstRow; row <= lastRow; row++)
+    {
+      for (int column = firstColumn; column <= lastColumn; column++)
+      {
+        mask->SetScalarComponentFromDouble(column, row, 0, 0, column == zeroColumn ? 0.0 : 1.0);
+      }
+    }
+    return mask;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Spans in "row:first-last" format */
+  std::string SpansToString(const std::vector<PlusSlicePixelSpans::Span>& spans)
+  {
+    std::ostringstream str;
+    for (std::vector<PlusSlicePixelSpans::Span>::const_iterator spanIt = spans.begin(); spanIt != spans.end(); ++spanIt)
+    {
+      str << " " << spanIt->Row << ":" << spanIt->FirstColumn << "-" << spanIt->LastColumn;
+    }
+    return str.str();
+  }
+
+  //----------------------------------------------------------------------------
+  void CheckSpans(const PlusSlicePixelSpans& spans, const std::string& expected, const std::string& description)
+  {
+    const std::string actual = SpansToString(spans.GetSpans());
+    if (actual != expected)
+    {
+      LOG_ERROR(description << ": spans" << actual << " (expected" << expected << ")");
+      NumberOfFailures++;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void CheckBoundingRectangle(const PlusSlicePixelSpans& spans, int originX, int originY, int sizeX, int sizeY, const std::string& description)
+  {
+    int origin[2] = { 0, 0 };
+    int size[2] = { 0, 0 };
+    if (!spans.GetBoundingRectangle(origin, size) || origin[0] != originX || origin[1] != originY || size[0] != sizeX || size[1] != sizeY)
+    {
+      LOG_ERROR(description << ": bounding rectangle origin (" << origin[0] << ", " << origin[1] << ") size (" << size[0] << ", " << size[1]
+                << "), expected origin (" << originX << ", " << originY << ") size (" << sizeX << ", " << sizeY << ")");
+      NumberOfFailures++;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! The outline must be a counter-clockwise convex polygon that contains the end points of all spans */
+  void CheckOutlineContainsSpans(const PlusSlicePixelSpans& spans, const std::string& description)
+  {
+    const std::vector<std::array<int, 2> >& outline = spans.GetOutlinePoints();
+    if (outline.size() < 3)
+    {
+      LOG_ERROR(description << ": outline has only " << outline.size() << " points");
+      NumberOfFailures++;
+      return;
+    }
+    const std::vector<PlusSlicePixelSpans::Span>& spanList = spans.GetSpans();
+    for (size_t i = 0; i < outline.size(); i++)
+    {
+      const std::array<int, 2>& a = outline[i];
+      const std::array<int, 2>& b = outline[(i + 1) % outline.size()];
+      for (std::vector<PlusSlicePixelSpans::Span>::const_iterator spanIt = spanList.begin(); spanIt != spanList.end(); ++spanIt)
+      {
+        const int columns[2] = { spanIt->FirstColumn, spanIt->LastColumn };
+        for (int j = 0; j < 2; j++)
+        {
+          const long long cross = static_cast<long long>(b[0] - a[0]) * (spanIt->Row - a[1]) - static_cast<long long>(b[1] - a[1]) * (columns[j] - a[0]);
+          if (cross < 0)
+          {
+            LOG_ERROR(description << ": pixel (" << columns[j] << ", " << spanIt->Row << ") is outside the outline edge ("
+                      << a[0] << ", " << a[1] << ")-(" << b[0] << ", " << b[1] << ")");
+            NumberOfFailures++;
+            return;
+          }
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! The row bands must be in increasing row order, must not overlap, must have at least two rows and must contain all spans */
+  void CheckRowBandsContainSpans(const PlusSlicePixelSpans& spans, const std::string& description)
+  {
+    const std::vector<PlusSlicePixelSpans::RowBand>& bands = spans.GetRowBands();
+    for (size_t i = 0; i < bands.size(); i++)
+    {
+      if (bands[i].LastRow <= bands[i].FirstRow || (i > 0 && bands[i].FirstRow <= bands[i - 1].LastRow))
+      {
+        LOG_ERROR(description << ": row band " << i << " (rows " << bands[i].FirstRow << "-" << bands[i].LastRow << ") is empty, has one row or overlaps the previous band");
+        NumberOfFailures++;
+        return;
+      }
+    }
+    const std::vector<PlusSlicePixelSpans::Span>& spanList = spans.GetSpans();
+    for (std::vector<PlusSlicePixelSpans::Span>::const_iterator spanIt = spanList.begin(); spanIt != spanList.end(); ++spanIt)
+    {
+      bool contained = false;
+      for (size_t i = 0; i < bands.size() && !contained; i++)
+      {
+        contained = (spanIt->Row >= bands[i].FirstRow && spanIt->Row <= bands[i].LastRow
+                     && spanIt->FirstColumn >= bands[i].FirstColumn && spanIt->LastColumn <= bands[i].LastColumn);
+      }
+      if (!contained)
+      {
+        LOG_ERROR(description << ": span " << spanIt->Row << ":" << spanIt->FirstColumn << "-" << spanIt->LastColumn << " is not in a row band");
+        NumberOfFailures++;
+        return;
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Same fan test as in the paste algorithm */
+  bool IsInsideFan(const PlusSlicePixelSpans::Geometry& geometry, int column, int row)
+  {
+    const double dx = column - geometry.FanOrigin[0];
+    const double dy = row - geometry.FanOrigin[1];
+    const double radiusSquared = dx * dx + dy * dy;
+    if (radiusSquared < geometry.FanRadiusStartPixel * geometry.FanRadiusStartPixel || radiusSquared > geometry.FanRadiusStopPixel * geometry.FanRadiusStopPixel)
+    {
+      return false;
+    }
+    const double angleDeg = vtkMath::DegreesFromRadians(atan2(dx, dy));
+    return angleDeg >= geometry.FanAnglesDeg[0] && angleDeg <= geometry.FanAnglesDeg[1];
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Rectangle with end pixels included (the pixel after the last one is also valid), then trimmed to the frame */
+  void TestClipRectangle()
+  {
+    PlusSlicePixelSpans spans;
+    spans.Compute(MakeGeometry(10, 8, 2, 3, 4, 2));
+    CheckSpans(spans, " 3:2-6 4:2-6 5:2-6", "Clip rectangle");
+    CheckBoundingRectangle(spans, 2, 3, 5, 3, "Clip rectangle");
+    if (spans.GetNumberOfValidPixels() != 15)
+    {
+      LOG_ERROR("Clip rectangle: " << spans.GetNumberOfValidPixels() << " valid pixels (expected 15)");
+      NumberOfFailures++;
+    }
+    // The outline of a rectangle is its 4 corners, the collinear span end points are removed
+    std::vector<std::array<int, 2> > outline = spans.GetOutlinePoints();
+    std::sort(outline.begin(), outline.end());
+    const std::array<int, 2> corners[4] = { { { 2, 3 } }, { { 2, 5 } }, { { 6, 3 } }, { { 6, 5 } } };
+    if (outline.size() != 4 || !std::equal(outline.begin(), outline.end(), corners))
+    {
+      LOG_ERROR("Clip rectangle: the outline is not the 4 corners of the rectangle, it has " << outline.size() << " points");
+      NumberOfFailures++;
+    }
+
+    spans.Compute(MakeGeometry(10, 8, 7, 6, 20, 20));
+    CheckSpans(spans, " 6:7-9 7:7-9", "Clip rectangle larger than the frame");
+
+    spans.Compute(MakeGeometry(4, 3, 0, 0, 0, 0));
+    CheckSpans(spans, " 0:0-3 1:0-3 2:0-3", "No clip rectangle");
+    CheckOutlineContainsSpans(spans, "No clip rectangle");
+
+    spans.Compute(MakeGeometry(10, 8, 12, 0, 5, 5));
+    int origin[2] = { 0, 0 };
+    int size[2] = { 0, 0 };
+    if (!spans.IsEmpty() || spans.GetBoundingRectangle(origin, size) || !spans.GetOutlinePoints().empty())
+    {
+      LOG_ERROR("Clip rectangle outside the frame: the spans are not empty");
+      NumberOfFailures++;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Valid pixels must be exactly the fan dilated by one pixel (3x3 neighborhood, including the pixels around the clip rectangle) */
+  void TestFanDilation()
+  {
+    PlusSlicePixelSpans::Geometry geometry = MakeGeometry(101, 60, 20, 5, 60, 40);
+    geometry.FanClipping = true;
+    geometry.FanOrigin[0] = 50.3;
+    geometry.FanOrigin[1] = -2.0;
+    geometry.FanAnglesDeg[0] = -30.0;
+    geometry.FanAnglesDeg[1] = 25.0;
+    geometry.FanRadiusStartPixel = 12.5;
+    geometry.FanRadiusStopPixel = 52.0;
+    PlusSlicePixelSpans spans;
+    spans.Compute(geometry);
+
+    const int width = 101;
+    const int height = 60;
+    std::vector<char> valid(width * height, 0);
+    const std::vector<PlusSlicePixelSpans::Span>& spanList = spans.GetSpans();
+    for (std::vector<PlusSlicePixelSpans::Span>::const_iterator spanIt = spanList.begin(); spanIt != spanList.end(); ++spanIt)
+    {
+      for (int column = spanIt->FirstColumn; column <= spanIt->LastColumn; column++)
+      {
+        valid[spanIt->Row * width + column] = 1;
+      }
+    }
+
+    int numberOfInsideFanPixels = 0;
+    for (int row = 0; row < height; row++)
+    {
+      for (int column = 0; column < width; column++)
+      {
+        const bool insideClipRectangle = (column >= 20 && column <= 80 && row >= 5 && row <= 45);
+        bool nearFan = false;
+        for (int neighborRow = row - 1; neighborRow <= row + 1; neighborRow++)
+        {
+          for (int neighborColumn = column - 1; neighborColumn <= column + 1; neighborColumn++)
+          {
+            nearFan = nearFan || IsInsideFan(geometry, neighborColumn, neighborRow);
+          }
+        }
+        if (insideClipRectangle && IsInsideFan(geometry, column, row))
+        {
+          numberOfInsideFanPixels++;
+        }
+        if ((insideClipRectangle && nearFan) != (valid[row * width + column] != 0))
+        {
+          LOG_ERROR("Fan dilation: pixel (" << column << ", " << row << ") is " << (valid[row * width + column] ? "valid" : "invalid")
+                    << ", expected " << (insideClipRectangle && nearFan ? "valid" : "invalid"));
+          NumberOfFailures++;
+          return;
+        }
+      }
+    }
+    if (spans.GetNumberOfValidPixels() <= numberOfInsideFanPixels)
+    {
+      LOG_ERROR("Fan dilation: " << spans.GetNumberOfValidPixels() << " valid pixels, expected more than the " << numberOfInsideFanPixels << " pixels inside the fan");
+      NumberOfFailures++;
+    }
+    CheckOutlineContainsSpans(spans, "Fan dilation");
+  }
+
+  //----------------------------------------------------------------------------
+  /*! A rectangle is a single band, the bands of a fan skip its corners */
+  void TestRowBands()
+  {
+    PlusSlicePixelSpans spans;
+    spans.Compute(MakeGeometry(10, 8, 2, 3, 4, 2));
+    const std::vector<PlusSlicePixelSpans::RowBand>& rectangleBands = spans.GetRowBands();
+    if (rectangleBands.size() != 1 || rectangleBands[0].FirstRow != 3 || rectangleBands[0].LastRow != 5
+        || rectangleBands[0].FirstColumn != 2 || rectangleBands[0].LastColumn != 6)
+    {
+      LOG_ERROR("Row bands of a rectangle: " << rectangleBands.size() << " bands, expected the rectangle 2-6 x 3-5");
+      NumberOfFailures++;
+    }
+
+    // A single valid row is one band
+    spans.Compute(MakeGeometry(10, 1, 0, 0, 0, 0));
+    if (spans.GetRowBands().size() != 1)
+    {
+      LOG_ERROR("Row bands of a single row: " << spans.GetRowBands().size() << " bands, expected 1");
+      NumberOfFailures++;
+    }
+
+    PlusSlicePixelSpans::Geometry geometry = MakeGeometry(640, 480, 0, 0, 0, 0);
+    geometry.FanClipping = true;
+    geometry.FanOrigin[0] = 320.0;
+    geometry.FanOrigin[1] = 0.0;
+    geometry.FanAnglesDeg[0] = -35.0;
+    geometry.FanAnglesDeg[1] = 35.0;
+    geometry.FanRadiusStartPixel = 40.0;
+    geometry.FanRadiusStopPixel = 470.0;
+    spans.Compute(geometry);
+    CheckRowBandsContainSpans(spans, "Row bands of a fan");
+    const std::vector<PlusSlicePixelSpans::RowBand>& fanBands = spans.GetRowBands();
+    long long bandPixels = 0;
+    for (std::vector<PlusSlicePixelSpans::RowBand>::const_iterator bandIt = fanBands.begin(); bandIt != fanBands.end(); ++bandIt)
+    {
+      bandPixels += static_cast<long long>(bandIt->LastRow - bandIt->FirstRow + 1) * (bandIt->LastColumn - bandIt->FirstColumn + 1);
+    }
+    int origin[2] = { 0, 0 };
+    int size[2] = { 0, 0 };
+    spans.GetBoundingRectangle(origin, size);
+    const long long boundingRectanglePixels = static_cast<long long>(size[0]) * size[1];
+    // Bands have at most 1/16 invalid pixels, except the rows inside the start radius (the gap between their two spans is in the band)
+    if (bandPixels * 10 > spans.GetNumberOfValidPixels() * 11 || bandPixels >= boundingRectanglePixels || fanBands.size() > 64)
+    {
+      LOG_ERROR("Row bands of a fan: " << fanBands.size() << " bands with " << bandPixels << " pixels for " << spans.GetNumberOfValidPixels()
+                << " valid pixels (bounding rectangle: " << boundingRectanglePixels << " pixels)");
+      NumberOfFailures++;
+    }
+
+    // Rows that are split by the importance mask are covered by one band
+    geometry = MakeGeometry(6, 4, 0, 0, 0, 0);
+    vtkSmartPointer<vtkImageData> mask = MakeImportanceMask(0, 5, 0, 3, VTK_UNSIGNED_CHAR, 2);
+    geometry.ImportanceMask = mask;
+    geometry.ImportanceMaskModifiedTime = mask->GetMTime();
+    spans.Compute(geometry);
+    CheckRowBandsContainSpans(spans, "Row bands with importance mask");
+  }
+
+  //----------------------------------------------------------------------------
+  /*! The mask is only used if it is unsigned char and covers the clipped region of the frame */
+  void TestImportanceMask()
+  {
+    PlusSlicePixelSpans spans;
+    PlusSlicePixelSpans::Geometry geometry = MakeGeometry(6, 2, 0, 0, 0, 0);
+    vtkSmartPointer<vtkImageData> mask = MakeImportanceMask(0, 5, 0, 1, VTK_UNSIGNED_CHAR, 2);
+    geometry.ImportanceMask = mask;
+    geometry.ImportanceMaskModifiedTime = mask->GetMTime();
+    spans.Compute(geometry);
+    CheckSpans(spans, " 0:0-1 0:3-5 1:0-1 1:3-5", "Importance mask");
+    CheckBoundingRectangle(spans, 0, 0, 6, 2, "Importance mask");
+
+    // The mask only covers the clip rectangle (columns 2-5, the end pixel is included), it does not start at 0
+    geometry = MakeGeometry(6, 2, 2, 0, 3, 1);
+    mask = MakeImportanceMask(2, 5, 0, 1, VTK_UNSIGNED_CHAR, 4);
+    geometry.ImportanceMask = mask;
+    geometry.ImportanceMaskModifiedTime = mask->GetMTime();
+    spans.Compute(geometry);
+    CheckSpans(spans, " 0:2-3 0:5-5 1:2-3 1:5-5", "Importance mask covering the clip rectangle");
+
+    // Masks that do not cover the clipped region are not used
+    geometry = MakeGeometry(6, 2, 0, 0, 0, 0);
+    mask = MakeImportanceMask(0, 5, 0, 0, VTK_UNSIGNED_CHAR, 2);
+    geometry.ImportanceMask = mask;
+    geometry.ImportanceMaskModifiedTime = mask->GetMTime();
+    spans.Compute(geometry);
+    CheckSpans(spans, " 0:0-5 1:0-5", "Importance mask with fewer rows than the frame");
+
+    mask = MakeImportanceMask(1, 5, 0, 1, VTK_UNSIGNED_CHAR, 2);
+    geometry.ImportanceMask = mask;
+    geometry.ImportanceMaskModifiedTime = mask->GetMTime();
+    spans.Compute(geometry);
+    CheckSpans(spans, " 0:0-5 1:0-5", "Importance mask with fewer columns than the frame");
+
+    mask = MakeImportanceMask(0, 5, 0, 1, VTK_FLOAT, 2);
+    geometry.ImportanceMask = mask;
+    geometry.ImportanceMaskModifiedTime = mask->GetMTime();
+    spans.Compute(geometry);
+    CheckSpans(spans, " 0:0-5 1:0-5", "Importance mask with float pixels");
+  }
+
+  //----------------------------------------------------------------------------
+  void CheckComputedForGeometry(const PlusSlicePixelSpans& spans, const PlusSlicePixelSpans::Geometry& geometry, bool expected, const std::string& description)
+  {
+    if (spans.IsComputedForGeometry(geometry) != expected)
+    {
+      LOG_ERROR(description << ": the spans are " << (expected ? "not " : "") << "reported as computed for the geometry");
+      NumberOfFailures++;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Any change of a parameter that affects the valid pixels must invalidate the cached spans */
+  void TestGeometryComparison()
+  {
+    PlusSlicePixelSpans spans;
+    const PlusSlicePixelSpans::Geometry geometry = MakeGeometry(10, 8, 2, 3, 4, 2);
+    CheckComputedForGeometry(spans, geometry, false, "Not computed yet");
+    spans.Compute(geometry);
+    CheckComputedForGeometry(spans, geometry, true, "Same geometry");
+
+    PlusSlicePixelSpans::Geometry changed = geometry;
+    changed.FrameSize[0] = 11;
+    CheckComputedForGeometry(spans, changed, false, "Frame size changed");
+    changed = geometry;
+    changed.ClipRectangleOrigin[1] = 4;
+    CheckComputedForGeometry(spans, changed, false, "Clip rectangle origin changed");
+    changed = geometry;
+    changed.ClipRectangleSize[0] = 5;
+    CheckComputedForGeometry(spans, changed, false, "Clip rectangle size changed");
+
+    // Fan parameters are only compared if fan clipping is enabled
+    changed = geometry;
+    changed.FanOrigin[0] = 3.0;
+    changed.FanAnglesDeg[1] = 10.0;
+    changed.FanRadiusStopPixel = 100.0;
+    CheckComputedForGeometry(spans, changed, true, "Fan parameters changed without fan clipping");
+    changed.FanClipping = true;
+    CheckComputedForGeometry(spans, changed, false, "Fan clipping enabled");
+
+    PlusSlicePixelSpans::Geometry fanGeometry = changed;
+    spans.Compute(fanGeometry);
+    CheckComputedForGeometry(spans, geometry, false, "Recomputed for another geometry");
+    CheckComputedForGeometry(spans, fanGeometry, true, "Fan geometry");
+    const double fanDelta = 0.25;
+    for (int parameter = 0; parameter < 6; parameter++)
+    {
+      changed = fanGeometry;
+      double* values[6] = { &changed.FanOrigin[0], &changed.FanOrigin[1], &changed.FanAnglesDeg[0], &changed.FanAnglesDeg[1], &changed.FanRadiusStartPixel, &changed.FanRadiusStopPixel };
+      *values[parameter] += fanDelta;
+      std::ostringstream description;
+      description << "Fan parameter " << parameter << " changed";
+      CheckComputedForGeometry(spans, changed, false, description.str());
+    }
+
+    // The mask is compared by pointer and modification time, so a modified mask invalidates the spans
+    vtkSmartPointer<vtkImageData> mask = MakeImportanceMask(0, 9, 0, 7, VTK_UNSIGNED_CHAR, 3);
+    PlusSlicePixelSpans::Geometry maskGeometry = geometry;
+    maskGeometry.ImportanceMask = mask;
+    maskGeometry.ImportanceMaskModifiedTime = mask->GetMTime();
+    CheckComputedForGeometry(spans, maskGeometry, false, "Importance mask added");
+    spans.Compute(maskGeometry);
+    CheckComputedForGeometry(spans, maskGeometry, true, "Importance mask geometry");
+    mask->Modified();
+    changed = maskGeometry;
+    changed.ImportanceMaskModifiedTime = mask->GetMTime();
+    CheckComputedForGeometry(spans, changed, false, "Importance mask modified");
+    vtkSmartPointer<vtkImageData> otherMask = MakeImportanceMask(0, 9, 0, 7, VTK_UNSIGNED_CHAR, 3);
+    changed = maskGeometry;
+    changed.ImportanceMask = otherMask;
+    CheckComputedForGeometry(spans, changed, false, "Importance mask replaced");
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  vtksys::CommandLineArguments args;
+
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  TestClipRectangle();
+  TestFanDilation();
+  TestImportanceMask();
+  TestRowBands();
+  TestGeometryComparison();
+
+  if (NumberOfFailures > 0)
+  {
+    LOG_ERROR(NumberOfFailures << " pixel span checks failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("PlusSlicePixelSpansTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,266 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusVolumeBrickGridTest.cxx
+  \brief Verifies brick indexing, modified and touched brick bookkeeping, modified extents and regions, and clearing of PlusVolumeBrickGrid
+*/
+
+#include "PlusConfigure.h"
+#include "PlusVolumeBrickGrid.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <sstream>
+
+namespace
+{
+  int NumberOfFailures = 0;
+
+  //----------------------------------------------------------------------------
+  std::string ExtentToString(const PlusVolumeBrickGrid::ExtentType& extent)
+  {
+    std::ostringstream str;
+    str << "(" << extent[0] << ", " << extent[1] << ", " << extent[2] << ", " << extent[3] << ", " << extent[4] << ", " << extent[5] << ")";
+    return str.str();
+  }
+
+  //----------------------------------------------------------------------------
+  void CheckCounts(const PlusVolumeBrickGrid& grid, int expectedModified, int expectedTouched, const std::string& description)
+  {
+    if (grid.GetNumberOfModifiedBricks() != expectedModified || grid.GetNumberOfTouchedBricks() != expectedTouched)
+    {
+      LOG_ERROR(description << ": " << grid.GetNumberOfModifiedBricks() << " modified and " << grid.GetNumberOfTouchedBricks()
+                << " touched bricks (expected " << expectedModified << " and " << expectedTouched << ")");
+      NumberOfFailures++;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void CheckExtents(const std::vector<PlusVolumeBrickGrid::ExtentType>& actual, const std::vector<PlusVolumeBrickGrid::ExtentType>& expected, const std::string& description)
+  {
+    if (actual == expected)
+    {
+      return;
+    }
+    std::ostringstream actualStr;
+    for (std::vector<PlusVolumeBrickGrid::ExtentType>::const_iterator extentIt = actual.begin(); extentIt != actual.end(); ++extentIt)
+    {
+      actualStr << " " << ExtentToString(*extentIt);
+    }
+    std::ostringstream expectedStr;
+    for (std::vector<PlusVolumeBrickGrid::ExtentType>::const_iterator extentIt = expected.begin(); extentIt != expected.end(); ++extentIt)
+    {
+      expectedStr << " " << ExtentToString(*extentIt);
+    }
+    LOG_ERROR(description << ": extents" << actualStr.str() << " (expected" << expectedStr.str() << ")");
+    NumberOfFailures++;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusVolumeBrickGrid::ExtentType MakeExtent(int xMin, int xMax, int yMin, int yMax, int zMin, int zMax)
+  {
+    const PlusVolumeBrickGrid::ExtentType extent = { { xMin, xMax, yMin, yMax, zMin, zMax } };
+    return extent;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Volume that does not start at 0 and whose size is not a multiple of the brick size */
+  void TestBrickIndexing()
+  {
+    const int volumeExtent[6] = { -5, 44, 0, 31, 10, 10 };
+    PlusVolumeBrickGrid grid;
+    grid.Initialize(volumeExtent, false);
+    if (grid.GetNumberOfBricks() != 4 * 2 * 1 || !grid.IsInitializedForExtent(volumeExtent))
+    {
+      LOG_ERROR("Brick indexing: " << grid.GetNumberOfBricks() << " bricks (expected 8)");
+      NumberOfFailures++;
+    }
+    const int otherExtent[6] = { -5, 44, 0, 31, 10, 11 };
+    if (grid.IsInitializedForExtent(otherExtent))
+    {
+      LOG_ERROR("Brick indexing: grid is reported to be initialized for a different extent");
+      NumberOfFailures++;
+    }
+    CheckCounts(grid, 0, 0, "Brick indexing, initialized");
+
+    // Voxels -5..10 are in brick 0, 11..26 are in brick 1
+    const int extent1[6] = { 10, 20, 0, 0, 10, 10 };
+    grid.MarkModified(extent1);
+    CheckCounts(grid, 2, 2, "Brick indexing, first extent");
+    std::vector<PlusVolumeBrickGrid::ExtentType> extents;
+    grid.GetModifiedExtents(extents);
+    CheckExtents(extents, std::vector<PlusVolumeBrickGrid::ExtentType>(1, MakeExtent(-5, 26, 0, 15, 10, 10)), "Brick indexing, first extent");
+
+    // Marking an extent that is outside the volume does not change anything, partially outside extents are clipped
+    const int outsideExtent[6] = { 100, 200, 0, 31, 10, 10 };
+    grid.MarkModified(outsideExtent);
+    CheckCounts(grid, 2, 2, "Brick indexing, outside extent");
+    const int extent2[6] = { 40, 60, 16, 40, 0, 20 };
+    grid.MarkModified(extent2);
+    CheckCounts(grid, 4, 4, "Brick indexing, partially outside extent");
+
+    // Last bricks are clipped to the volume extent
+    std::vector<PlusVolumeBrickGrid::ExtentType> expectedExtents;
+    expectedExtents.push_back(MakeExtent(-5, 26, 0, 15, 10, 10));
+    expectedExtents.push_back(MakeExtent(27, 44, 16, 31, 10, 10));
+    grid.GetModifiedExtents(extents);
+    CheckExtents(extents, expectedExtents, "Brick indexing, modified extents");
+    grid.GetModifiedRegions(extents, 10);
+    CheckExtents(extents, expectedExtents, "Brick indexing, modified regions");
+
+    PlusVolumeBrickGrid::ExtentType boundingExtent;
+    if (!grid.GetModifiedBoundingExtent(boundingExtent) || boundingExtent != MakeExtent(-5, 44, 0, 31, 10, 10))
+    {
+      LOG_ERROR("Brick indexing: unexpected bounding extent of modified bricks " << ExtentToString(boundingExtent));
+      NumberOfFailures++;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void TestModifiedRegions()
+  {
+    const int volumeExtent[6] = { 0, 63, 0, 63, 0, 63 };
+    PlusVolumeBrickGrid grid;
+    grid.Initialize(volumeExtent, false);
+
+    // A block of 2x2x2 bricks is merged into one region, the x runs are reported separately
+    const int block1[6] = { 0, 31, 0, 31, 0, 31 };
+    grid.MarkModified(block1);
+    std::vector<PlusVolumeBrickGrid::ExtentType> extents;
+    grid.GetModifiedExtents(extents);
+    if (extents.size() != 4)
+    {
+      LOG_ERROR("Modified regions: " << extents.size() << " modified extents (expected 4)");
+      NumberOfFailures++;
+    }
+    grid.GetModifiedRegions(extents, 10);
+    CheckExtents(extents, std::vector<PlusVolumeBrickGrid::ExtentType>(1, MakeExtent(0, 31, 0, 31, 0, 31)), "Modified regions, one block");
+
+    // Separate blocks are separate regions
+    const int block2[6] = { 48, 63, 48, 63, 48, 63 };
+    grid.MarkModified(block2);
+    std::vector<PlusVolumeBrickGrid::ExtentType> expectedExtents;
+    expectedExtents.push_back(MakeExtent(0, 31, 0, 31, 0, 31));
+    expectedExtents.push_back(MakeExtent(48, 63, 48, 63, 48, 63));
+    grid.GetModifiedRegions(extents, 10);
+    CheckExtents(extents, expectedExtents, "Modified regions, two blocks");
+
+    // The bounding box is returned if too many regions would be needed
+    grid.GetModifiedRegions(extents, 1);
+    CheckExtents(extents, std::vector<PlusVolumeBrickGrid::ExtentType>(1, MakeExtent(0, 63, 0, 63, 0, 63)), "Modified regions, limited number of regions");
+
+    // L shape: regions cover exactly the modified bricks
+    grid.ClearModified();
+    const int lShape1[6] = { 0, 63, 0, 15, 0, 15 };
+    const int lShape2[6] = { 0, 15, 16, 63, 0, 15 };
+    grid.MarkModified(lShape1);
+    grid.MarkModified(lShape2);
+    grid.GetModifiedRegions(extents, 10);
+    long long numberOfVoxelsInRegions = 0;
+    for (std::vector<PlusVolumeBrickGrid::ExtentType>::const_iterator extentIt = extents.begin(); extentIt != extents.end(); ++extentIt)
+    {
+      numberOfVoxelsInRegions += static_cast<long long>((*extentIt)[1] - (*extentIt)[0] + 1) * ((*extentIt)[3] - (*extentIt)[2] + 1) * ((*extentIt)[5] - (*extentIt)[4] + 1);
+    }
+    const long long brickVoxels = PlusVolumeBrickGrid::DEFAULT_BRICK_SIZE * PlusVolumeBrickGrid::DEFAULT_BRICK_SIZE * PlusVolumeBrickGrid::DEFAULT_BRICK_SIZE;
+    if (extents.size() != 2 || numberOfVoxelsInRegions != grid.GetNumberOfModifiedBricks() * brickVoxels)
+    {
+      LOG_ERROR("Modified regions, L shape: " << extents.size() << " regions with " << numberOfVoxelsInRegions << " voxels (expected 2 regions with "
+                << grid.GetNumberOfModifiedBricks() * brickVoxels << " voxels)");
+      NumberOfFailures++;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void TestClearing()
+  {
+    const int volumeExtent[6] = { 0, 63, 0, 31, 0, 15 };
+    PlusVolumeBrickGrid grid;
+    grid.Initialize(volumeExtent, false);
+    const int extent[6] = { 0, 20, 0, 5, 0, 5 };
+    grid.MarkModified(extent);
+    CheckCounts(grid, 2, 2, "Clearing, marked");
+
+    // Modified flags are cleared, the bricks still contain data
+    grid.ClearModified();
+    CheckCounts(grid, 0, 2, "Clearing, modified flags cleared");
+    std::vector<PlusVolumeBrickGrid::ExtentType> extents;
+    grid.GetModifiedExtents(extents);
+    CheckExtents(extents, std::vector<PlusVolumeBrickGrid::ExtentType>(), "Clearing, modified flags cleared");
+    PlusVolumeBrickGrid::ExtentType boundingExtent;
+    if (grid.GetModifiedBoundingExtent(boundingExtent))
+    {
+      LOG_ERROR("Clearing: bounding extent is reported when no brick is modified");
+      NumberOfFailures++;
+    }
+
+    // Reset of the volume: the bricks that contained data are modified, no brick contains data
+    const int extent2[6] = { 48, 63, 16, 31, 0, 15 };
+    grid.MarkModified(extent2);
+    grid.ClearModified();
+    grid.MarkCleared();
+    CheckCounts(grid, 3, 0, "Clearing, volume reset");
+    std::vector<PlusVolumeBrickGrid::ExtentType> expectedExtents;
+    expectedExtents.push_back(MakeExtent(0, 31, 0, 15, 0, 15));
+    expectedExtents.push_back(MakeExtent(48, 63, 16, 31, 0, 15));
+    grid.GetModifiedExtents(extents);
+    CheckExtents(extents, expectedExtents, "Clearing, volume reset");
+
+    // A second reset does not modify anything new
+    grid.ClearModified();
+    grid.MarkCleared();
+    CheckCounts(grid, 0, 0, "Clearing, second reset");
+
+    // Volumes that may already contain data
+    grid.Initialize(volumeExtent, true);
+    CheckCounts(grid, 0, grid.GetNumberOfBricks(), "Clearing, initialized as touched");
+    grid.MarkCleared();
+    CheckCounts(grid, grid.GetNumberOfBricks(), 0, "Clearing, reset after initialized as touched");
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  vtksys::CommandLineArguments args;
+
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  TestBrickIndexing();
+  TestModifiedRegions();
+  TestClearing();
+
+  if (NumberOfFailures > 0)
+  {
+    LOG_ERROR(NumberOfFailures << " brick grid checks failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("PlusVolumeBrickGridTest completed successfully");
+  return EXIT_SUCCESS;
+}
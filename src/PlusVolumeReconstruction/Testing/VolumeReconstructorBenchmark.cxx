@@ -0,0 +1,607 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file VolumeReconstructorBenchmark.cxx
+Reconstructs a volume from a sequence file with each combination of the requested reconstruction settings
+(interpolation, compounding, hole filling kernel size, output spacing, number of threads, insertion batch size, clip rectangle tightening) and reports the
+throughput, whether it reaches the target frame rate, the peak process memory usage and the voxel-wise difference from a reference volume.
+Frames are inserted one by one with AddTrackedFrame (batch size 0) or in batches with AddTrackedFrames.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusVolumeReconstructor.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOAccurateTimer.h>
+#include <vtkIGSIOTrackedFrameList.h>
+#include <vtkIGSIOTransformRepository.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMetaImageReader.h>
+#include <vtkPointData.h>
+#include <vtkXMLDataElement.h>
+#include <vtksys/CommandLineArguments.hxx>
+#include <vtksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+  #include <windows.h>
+  #include <psapi.h>
+  #pragma comment(lib, "psapi.lib")
+#else
+  #include <sys/resource.h>
+#endif
+
+namespace
+{
+  const double KILOBYTES_PER_MEGABYTE = 1024.0;
+
+  /*! Reconstruction settings of one benchmark run, empty/negative values mean that the value in the configuration file is used */
+  struct BenchmarkSettings
+  {
+    std::string Interpolation;
+    std::string CompoundingMode;
+    int HoleFillingKernelSize;
+    double OutputSpacing;
+    int NumberOfThreads;
+    /*! Number of frames inserted at once with AddTrackedFrames, 0 = frames are inserted one by one with AddTrackedFrame */
+    int BatchSize;
+    /*! Paste the row bands of the valid pixels (1) or the whole clip rectangle (0), see vtkPlusVolumeReconstructor::SetClipRectangleTightening */
+    int ClipRectangleTightening;
+  };
+
+  struct BenchmarkResult
+  {
+    double InsertionTimeSec;
+    double ExtractionTimeSec;
+    int NumberOfInsertedFrames;
+    double NumberOfVoxels;
+    /*! Peak resident memory of the process during the run (on platforms other than Linux: since the process started) */
+    double PeakMemoryMb;
+    bool ReferenceCompared;
+    double RmsDifference;
+    double MaximumDifference;
+    double DifferentVoxelsPercent;
+  };
+
+  //----------------------------------------------------------------------------
+  std::string GetSettingsAsString(const BenchmarkSettings& settings)
+  {
+    std::ostringstream ss;
+    ss << "Interpolation=" << (settings.Interpolation.empty() ? "(config)" : settings.Interpolation)
+       << " CompoundingMode=" << (settings.CompoundingMode.empty() ? "(config)" : settings.CompoundingMode)
+       << " HoleFillingKernelSize=";
+    if (settings.HoleFillingKernelSize < 0)
+    {
+      ss << "(config)";
+    }
+    else
+    {
+      ss << settings.HoleFillingKernelSize;
+    }
+    ss << " OutputSpacing=";
+    if (settings.OutputSpacing <= 0)
+    {
+      ss << "(config)";
+    }
+    else
+    {
+      ss << settings.OutputSpacing;
+    }
+    ss << " NumberOfThreads=";
+    if (settings.NumberOfThreads < 0)
+    {
+      ss << "(config)";
+    }
+    else
+    {
+      ss << settings.NumberOfThreads;
+    }
+    ss << " BatchSize=" << settings.BatchSize;
+    ss << " ClipRectangleTightening=" << settings.ClipRectangleTightening;
+    return ss.str();
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Set the benchmarked settings in a copy of the device set configuration */
+  PlusStatus ApplySettings(vtkXMLDataElement* configRootElement, const BenchmarkSettings& settings)
+  {
+    vtkXMLDataElement* reconstructionElement = configRootElement->LookupElementWithName("VolumeReconstruction");
+    if (reconstructionElement == NULL)
+    {
+      LOG_ERROR("VolumeReconstruction element is not found in the configuration");
+      return PLUS_FAIL;
+    }
+    if (!settings.Interpolation.empty())
+    {
+      reconstructionElement->SetAttribute("Interpolation", settings.Interpolation.c_str());
+    }
+    if (!settings.CompoundingMode.empty())
+    {
+      reconstructionElement->SetAttribute("CompoundingMode", settings.CompoundingMode.c_str());
+    }
+    if (settings.OutputSpacing > 0)
+    {
+      double outputSpacing[3] = { settings.OutputSpacing, settings.OutputSpacing, settings.OutputSpacing };
+      reconstructionElement->SetVectorAttribute("OutputSpacing", 3, outputSpacing);
+    }
+    if (settings.NumberOfThreads >= 0)
+    {
+      reconstructionElement->SetIntAttribute("NumberOfThreads", settings.NumberOfThreads);
+    }
+    if (settings.HoleFillingKernelSize >= 0)
+    {
+      reconstructionElement->SetAttribute("FillHoles", settings.HoleFillingKernelSize > 0 ? "ON" : "OFF");
+      for (vtkXMLDataElement* holeFillingElement = reconstructionElement->FindNestedElementWithName("HoleFilling"); holeFillingElement != NULL;
+           holeFillingElement = reconstructionElement->FindNestedElementWithName("HoleFilling"))
+      {
+        reconstructionElement->RemoveNestedElement(holeFillingElement);
+      }
+      if (settings.HoleFillingKernelSize > 0)
+      {
+        vtkSmartPointer<vtkXMLDataElement> holeFillingElement = vtkSmartPointer<vtkXMLDataElement>::New();
+        holeFillingElement->SetName("HoleFilling");
+        vtkSmartPointer<vtkXMLDataElement> kernelElement = vtkSmartPointer<vtkXMLDataElement>::New();
+        kernelElement->SetName("HoleFillingElement");
+        kernelElement->SetAttribute("Type", "GAUSSIAN");
+        kernelElement->SetIntAttribute("Size", settings.HoleFillingKernelSize);
+        kernelElement->SetDoubleAttribute("Stdev", settings.HoleFillingKernelSize / 3.0);
+        kernelElement->SetDoubleAttribute("MinimumKnownVoxelsRatio", 0.1);
+        holeFillingElement->AddNestedElement(kernelElement);
+        reconstructionElement->AddNestedElement(holeFillingElement);
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Reset the peak resident memory of the process, so that GetPeakProcessMemoryMb reports the peak of the next run only.
+    Only Linux can reset the peak (by writing 5 to /proc/self/clear_refs), elsewhere the peak since the process started is reported.
+  */
+  void ResetPeakProcessMemory()
+  {
+#ifdef __linux__
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Get the peak resident memory (high-water mark) of the process */
+  double GetPeakProcessMemoryMb()
+  {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS memoryCounters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)))
+    {
+      return 0.0;
+    }
+    return memoryCounters.PeakWorkingSetSize / (KILOBYTES_PER_MEGABYTE * KILOBYTES_PER_MEGABYTE);
+#else
+#ifdef __linux__
+    // VmHWM is reset by ResetPeakProcessMemory, while ru_maxrss is not
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+      if (line.compare(0, 6, "VmHWM:") == 0)
+      {
+        return std::atof(line.c_str() + 6) / KILOBYTES_PER_MEGABYTE;
+      }
+    }
+#endif
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+      return 0.0;
+    }
+#ifdef __APPLE__
+    // bytes
+    return usage.ru_maxrss / (KILOBYTES_PER_MEGABYTE * KILOBYTES_PER_MEGABYTE);
+#else
+    // kilobytes
+    return usage.ru_maxrss / KILOBYTES_PER_MEGABYTE;
+#endif
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Compare all the voxels of two volumes of the same size, the scalar types may be different */
+  PlusStatus CompareVolumes(vtkImageData* volume, vtkImageData* referenceVolume, BenchmarkResult& result)
+  {
+    int dimensions[3] = { 0, 0, 0 };
+    volume->GetDimensions(dimensions);
+    int referenceDimensions[3] = { 0, 0, 0 };
+    referenceVolume->GetDimensions(referenceDimensions);
+    vtkDataArray* scalars = volume->GetPointData()->GetScalars();
+    vtkDataArray* referenceScalars = referenceVolume->GetPointData()->GetScalars();
+    if (scalars == NULL || referenceScalars == NULL || !std::equal(dimensions, dimensions + 3, referenceDimensions)
+        || scalars->GetNumberOfComponents() != referenceScalars->GetNumberOfComponents())
+    {
+      LOG_WARNING("Reconstructed volume (" << dimensions[0] << "x" << dimensions[1] << "x" << dimensions[2] << ") cannot be compared to the reference volume ("
+                  << referenceDimensions[0] << "x" << referenceDimensions[1] << "x" << referenceDimensions[2] << ")");
+      return PLUS_FAIL;
+    }
+    const int numberOfComponents = scalars->GetNumberOfComponents();
+    const vtkIdType numberOfValues = scalars->GetNumberOfTuples() * numberOfComponents;
+    double sumSquaredDifference = 0.0;
+    double maximumDifference = 0.0;
+    vtkIdType numberOfDifferentValues = 0;
+    for (vtkIdType tupleIndex = 0; tupleIndex < scalars->GetNumberOfTuples(); tupleIndex++)
+    {
+      for (int component = 0; component < numberOfComponents; component++)
+      {
+        double difference = std::abs(scalars->GetComponent(tupleIndex, component) - referenceScalars->GetComponent(tupleIndex, component));
+        sumSquaredDifference += difference * difference;
+        maximumDifference = std::max(maximumDifference, difference);
+        if (difference > 0)
+        {
+          numberOfDifferentValues++;
+        }
+      }
+    }
+    result.ReferenceCompared = true;
+    result.RmsDifference = (numberOfValues > 0 ? std::sqrt(sumSquaredDifference / numberOfValues) : 0.0);
+    result.MaximumDifference = maximumDifference;
+    result.DifferentVoxelsPercent = (numberOfValues > 0 ? 100.0 * numberOfDifferentValues / numberOfValues : 0.0);
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus RunBenchmark(vtkXMLDataElement* baseConfigRootElement, const BenchmarkSettings& settings, vtkIGSIOTrackedFrameList* trackedFrameList,
+                          const std::string& imageToReferenceTransformName, vtkImageData* referenceVolume, BenchmarkResult& result)
+  {
+    ResetPeakProcessMemory();
+    vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    configRootElement->DeepCopy(baseConfigRootElement);
+    if (ApplySettings(configRootElement, settings) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+
+    vtkSmartPointer<vtkPlusVolumeReconstructor> reconstructor = vtkSmartPointer<vtkPlusVolumeReconstructor>::New();
+    if (reconstructor->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read volume reconstruction configuration");
+      return PLUS_FAIL;
+    }
+    reconstructor->SetClipRectangleTightening(settings.ClipRectangleTightening != 0);
+    if (!imageToReferenceTransformName.empty())
+    {
+      igsioTransformName transformName;
+      if (transformName.SetTransformName(imageToReferenceTransformName.c_str()) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Invalid image to reference transform name: " << imageToReferenceTransformName);
+        return PLUS_FAIL;
+      }
+      reconstructor->SetImageCoordinateFrame(transformName.From());
+      reconstructor->SetReferenceCoordinateFrame(transformName.To());
+    }
+    vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+    if (configRootElement->FindNestedElementWithName("CoordinateDefinitions") != NULL && transformRepository->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read transforms from CoordinateDefinitions");
+      return PLUS_FAIL;
+    }
+
+    std::string errorDetail;
+    if (reconstructor->SetOutputExtentFromFrameList(trackedFrameList, transformRepository, errorDetail) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set output extent of volume: " << errorDetail);
+      return PLUS_FAIL;
+    }
+
+    // Frame insertion
+    const int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
+    const int skipInterval = std::max(reconstructor->GetSkipInterval(), 1);
+    result.NumberOfInsertedFrames = 0;
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (settings.BatchSize > 0)
+    {
+      // One thread per processor core is used if the number of threads is not benchmarked
+      const unsigned int numberOfThreads = (settings.NumberOfThreads >= 0 ? settings.NumberOfThreads : 0);
+      std::vector<igsioTrackedFrame*> batchFrames;
+      for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += skipInterval)
+      {
+        batchFrames.push_back(trackedFrameList->GetTrackedFrame(frameIndex));
+        if (static_cast<int>(batchFrames.size()) < settings.BatchSize && frameIndex + skipInterval < numberOfFrames)
+        {
+          continue;
+        }
+        std::vector<PlusVolumeBrickGrid::ExtentType> insertedFrameExtents;
+        if (reconstructor->AddTrackedFrames(batchFrames, transformRepository, numberOfThreads, false, &insertedFrameExtents) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to add the batch of tracked frames ending with frame #" << frameIndex << " to volume");
+        }
+        result.NumberOfInsertedFrames += static_cast<int>(insertedFrameExtents.size());
+        batchFrames.clear();
+      }
+    }
+    else
+    {
+      for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += skipInterval)
+      {
+        igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
+        if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
+          continue;
+        }
+        bool insertedIntoVolume = false;
+        if (reconstructor->AddTrackedFrame(frame, transformRepository, frameIndex == 0, frameIndex + skipInterval >= numberOfFrames, &insertedIntoVolume) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
+          continue;
+        }
+        if (insertedIntoVolume)
+        {
+          result.NumberOfInsertedFrames++;
+        }
+      }
+    }
+    result.InsertionTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+    // Gray level extraction (including hole filling)
+    vtkSmartPointer<vtkImageData> volume = vtkSmartPointer<vtkImageData>::New();
+    startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (reconstructor->ExtractGrayLevels(volume) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to extract gray levels");
+      return PLUS_FAIL;
+    }
+    result.ExtractionTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+    result.PeakMemoryMb = GetPeakProcessMemoryMb();
+
+    int dimensions[3] = { 0, 0, 0 };
+    volume->GetDimensions(dimensions);
+    result.NumberOfVoxels = static_cast<double>(dimensions[0]) * dimensions[1] * dimensions[2];
+
+    result.ReferenceCompared = false;
+    if (referenceVolume != NULL)
+    {
+      CompareVolumes(volume, referenceVolume, result);
+    }
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  vtksys::CommandLineArguments args;
+
+  std::string inputConfigFileName;
+  std::string inputSequenceFileName;
+  std::string imageToReferenceTransformName;
+  std::string referenceVolumeFileName;
+  std::string outputCsvFileName;
+  std::vector<std::string> interpolations;
+  std::vector<std::string> compoundingModes;
+  std::vector<int> holeFillingKernelSizes;
+  std::vector<double> outputSpacings;
+  std::vector<int> numbersOfThreads;
+  std::vector<int> batchSizes;
+  std::vector<int> clipRectangleTightenings;
+  double targetFrameRate = 60.0;
+  int numberOfIterations = 1;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Device set configuration file with the VolumeReconstruction element that the benchmarked settings are applied to.");
+  args.AddArgument("--source-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputSequenceFileName, "Input sequence file.");
+  args.AddArgument("--image-to-reference-transform", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &imageToReferenceTransformName, "Name of the transform that defines the image slice pose relative to the reference coordinate system (default: as defined in the configuration file).");
+  args.AddArgument("--reference-volume-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &referenceVolumeFileName, "Reconstructed volumes are compared voxel by voxel to this volume (.mha).");
+  args.AddArgument("--output-csv-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputCsvFileName, "Results are appended to this file, one line per benchmark run.");
+  args.AddArgument("--interpolations", vtksys::CommandLineArguments::MULTI_ARGUMENT, &interpolations, "Interpolation modes to benchmark (NEAREST_NEIGHBOR, LINEAR; default: as defined in the configuration file).");
+  args.AddArgument("--compounding-modes", vtksys::CommandLineArguments::MULTI_ARGUMENT, &compoundingModes, "Compounding modes to benchmark (MEAN, LATEST, MAXIMUM, IMPORTANCE_MASK; default: as defined in the configuration file).");
+  args.AddArgument("--hole-filling-kernel-sizes", vtksys::CommandLineArguments::MULTI_ARGUMENT, &holeFillingKernelSizes, "Size of the Gaussian hole filling kernels to benchmark, 0 = no hole filling (default: as defined in the configuration file).");
+  args.AddArgument("--output-spacings", vtksys::CommandLineArguments::MULTI_ARGUMENT, &outputSpacings, "Isotropic output spacings to benchmark (default: as defined in the configuration file).");
+  args.AddArgument("--numbers-of-threads", vtksys::CommandLineArguments::MULTI_ARGUMENT, &numbersOfThreads, "Numbers of threads to benchmark, 0 = one per processor core (default: as defined in the configuration file).");
+  args.AddArgument("--batch-sizes", vtksys::CommandLineArguments::MULTI_ARGUMENT, &batchSizes, "Numbers of frames inserted at once to benchmark, 0 = frames are inserted one by one (default: 0).");
+  args.AddArgument("--clip-rectangle-tightening", vtksys::CommandLineArguments::MULTI_ARGUMENT, &clipRectangleTightenings, "Clip rectangle tightening modes to benchmark, 1 = only the row bands of the valid pixels are pasted, 0 = the whole clip rectangle is pasted (default: 1).");
+  args.AddArgument("--target-frame-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &targetFrameRate, "Insertion frame rate that the reconstruction has to keep up with, in frames per second (default: 60).");
+  args.AddArgument("--iterations", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfIterations, "Number of reconstructions to average the computation time over (default: 1).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputConfigFileName.empty() || inputSequenceFileName.empty() || numberOfIterations < 1)
+  {
+    LOG_ERROR("Input config file, input sequence file and a positive number of iterations are required");
+    LOG_INFO("Help: " << args.GetHelp());
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, inputConfigFileName.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << inputConfigFileName);
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkPlusSequenceIO::Read(inputSequenceFileName, trackedFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to load input sequence file: " << inputSequenceFileName);
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkImageData> referenceVolume;
+  if (!referenceVolumeFileName.empty())
+  {
+    vtkSmartPointer<vtkMetaImageReader> reader = vtkSmartPointer<vtkMetaImageReader>::New();
+    reader->SetFileName(referenceVolumeFileName.c_str());
+    reader->Update();
+    referenceVolume = reader->GetOutput();
+    if (referenceVolume == NULL || referenceVolume->GetPointData()->GetScalars() == NULL)
+    {
+      LOG_ERROR("Unable to read reference volume: " << referenceVolumeFileName);
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::ofstream csvFile;
+  if (!outputCsvFileName.empty())
+  {
+    bool writeCsvHeader = !vtksys::SystemTools::FileExists(outputCsvFileName.c_str(), true);
+    csvFile.open(outputCsvFileName.c_str(), std::ios::out | std::ios::app);
+    if (!csvFile.is_open())
+    {
+      LOG_ERROR("Unable to open output file: " << outputCsvFileName);
+      return EXIT_FAILURE;
+    }
+    if (writeCsvHeader)
+    {
+      csvFile << "Sequence,Interpolation,CompoundingMode,HoleFillingKernelSize,OutputSpacing,NumberOfThreads,BatchSize,ClipRectangleTightening,InsertedFrames,Voxels,"
+              << "InsertionFramesPerSec,TargetFrameRateReached,ExtractionMs,VoxelsPerSec,PeakMemoryMb,RmsDifference,MaximumDifference,DifferentVoxelsPercent" << std::endl;
+    }
+  }
+
+  // Empty lists mean that the value in the configuration file is used
+  if (interpolations.empty())
+  {
+    interpolations.push_back("");
+  }
+  if (compoundingModes.empty())
+  {
+    compoundingModes.push_back("");
+  }
+  if (holeFillingKernelSizes.empty())
+  {
+    holeFillingKernelSizes.push_back(-1);
+  }
+  if (outputSpacings.empty())
+  {
+    outputSpacings.push_back(-1);
+  }
+  if (numbersOfThreads.empty())
+  {
+    numbersOfThreads.push_back(-1);
+  }
+  if (batchSizes.empty())
+  {
+    batchSizes.push_back(0);
+  }
+  if (clipRectangleTightenings.empty())
+  {
+    clipRectangleTightenings.push_back(1);
+  }
+
+  LOG_INFO("Benchmark volume reconstruction of " << inputSequenceFileName << " (" << trackedFrameList->GetNumberOfTrackedFrames() << " frames)");
+  int numberOfFailedRuns = 0;
+  BenchmarkSettings settings;
+  for (std::vector<std::string>::iterator interpolationIt = interpolations.begin(); interpolationIt != interpolations.end(); ++interpolationIt)
+  {
+    settings.Interpolation = *interpolationIt;
+    for (std::vector<std::string>::iterator compoundingIt = compoundingModes.begin(); compoundingIt != compoundingModes.end(); ++compoundingIt)
+    {
+      settings.CompoundingMode = *compoundingIt;
+      for (std::vector<int>::iterator kernelSizeIt = holeFillingKernelSizes.begin(); kernelSizeIt != holeFillingKernelSizes.end(); ++kernelSizeIt)
+      {
+        settings.HoleFillingKernelSize = *kernelSizeIt;
+        for (std::vector<double>::iterator spacingIt = outputSpacings.begin(); spacingIt != outputSpacings.end(); ++spacingIt)
+        {
+          settings.OutputSpacing = *spacingIt;
+          for (std::vector<int>::iterator threadsIt = numbersOfThreads.begin(); threadsIt != numbersOfThreads.end(); ++threadsIt)
+          {
+            settings.NumberOfThreads = *threadsIt;
+            for (std::vector<int>::iterator batchSizeIt = batchSizes.begin(); batchSizeIt != batchSizes.end(); ++batchSizeIt)
+            {
+              settings.BatchSize = *batchSizeIt;
+              for (std::vector<int>::iterator tighteningIt = clipRectangleTightenings.begin(); tighteningIt != clipRectangleTightenings.end(); ++tighteningIt)
+              {
+                settings.ClipRectangleTightening = *tighteningIt;
+                LOG_INFO(GetSettingsAsString(settings));
+
+                // Times are averaged, the memory usage and the differences are the same in all iterations
+                BenchmarkResult result;
+                double insertionTimeSec = 0;
+                double extractionTimeSec = 0;
+                bool runFailed = false;
+                for (int iteration = 0; iteration < numberOfIterations && !runFailed; iteration++)
+                {
+                  runFailed = (RunBenchmark(configRootElement, settings, trackedFrameList, imageToReferenceTransformName, referenceVolume, result) != PLUS_SUCCESS);
+                  insertionTimeSec += result.InsertionTimeSec;
+                  extractionTimeSec += result.ExtractionTimeSec;
+                }
+                if (runFailed)
+                {
+                  numberOfFailedRuns++;
+                  continue;
+                }
+                insertionTimeSec /= numberOfIterations;
+                extractionTimeSec /= numberOfIterations;
+                const double framesPerSec = (insertionTimeSec > 0 ? result.NumberOfInsertedFrames / insertionTimeSec : 0.0);
+                const bool targetFrameRateReached = (framesPerSec >= targetFrameRate);
+                const double voxelsPerSec = (insertionTimeSec + extractionTimeSec > 0 ? result.NumberOfVoxels / (insertionTimeSec + extractionTimeSec) : 0.0);
+
+                std::ostringstream report;
+                report << "  " << result.NumberOfInsertedFrames << " frames inserted: " << framesPerSec << " frames/s (target " << targetFrameRate << " frames/s "
+                       << (targetFrameRateReached ? "reached" : "not reached") << "), gray level extraction: " << extractionTimeSec * 1000.0
+                       << " ms, " << result.NumberOfVoxels / 1e6 << " Mvoxel volume: " << voxelsPerSec / 1e6 << " Mvoxel/s, peak process memory: " << result.PeakMemoryMb << " MB";
+                if (result.ReferenceCompared)
+                {
+                  report << ", difference from reference: RMS " << result.RmsDifference << ", maximum " << result.MaximumDifference << ", " << result.DifferentVoxelsPercent << "% of voxels";
+                }
+                LOG_INFO(report.str());
+
+                if (csvFile.is_open())
+                {
+                  csvFile << inputSequenceFileName << "," << settings.Interpolation << "," << settings.CompoundingMode << "," << settings.HoleFillingKernelSize << ","
+                          << settings.OutputSpacing << "," << settings.NumberOfThreads << "," << settings.BatchSize << "," << settings.ClipRectangleTightening << "," << result.NumberOfInsertedFrames << ","
+                          << result.NumberOfVoxels << "," << framesPerSec << "," << (targetFrameRateReached ? 1 : 0) << "," << extractionTimeSec * 1000.0 << "," << voxelsPerSec << "," << result.PeakMemoryMb << ",";
+                  if (result.ReferenceCompared)
+                  {
+                    csvFile << result.RmsDifference << "," << result.MaximumDifference << "," << result.DifferentVoxelsPercent;
+                  }
+                  else
+                  {
+                    csvFile << ",,";
+                  }
+                  csvFile << std::endl;
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  if (numberOfFailedRuns > 0)
+  {
+    LOG_ERROR(numberOfFailedRuns << " benchmark runs failed");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,261 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkPlusCompareVolumesTest.cxx
+Derives a testing volume and alpha volumes with holes from a reconstructed volume, writes them into uncompressed MetaImage files
+and compares them with vtkPlusCompareVolumes using a single thread and multiple threads, with volumes read into memory and
+with memory mapped volumes. All the statistics and histograms must be identical.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusCompareVolumesInput.h"
+#include "vtkPlusCompareVolumes.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMetaImageReader.h>
+#include <vtkMetaImageWriter.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  enum ComparisonVolume
+  {
+    GROUND_TRUTH,
+    GROUND_TRUTH_ALPHA,
+    TESTING,
+    TESTING_ALPHA,
+    SLICES_ALPHA,
+    NUMBER_OF_COMPARISON_VOLUMES
+  };
+
+  const char* COMPARISON_VOLUME_FILE_NAMES[NUMBER_OF_COMPARISON_VOLUMES] =
+  {
+    "vtkPlusCompareVolumesTestGroundTruth.mha",
+    "vtkPlusCompareVolumesTestGroundTruthAlpha.mha",
+    "vtkPlusCompareVolumesTestTesting.mha",
+    "vtkPlusCompareVolumesTestTestingAlpha.mha",
+    "vtkPlusCompareVolumesTestSlicesAlpha.mha"
+  };
+
+  const char* STATISTIC_NAMES[] =
+  {
+    "NumberOfHoles", "NumberOfFilledHoles", "NumberVoxelsVisible", "RMS",
+    "TrueMean", "TrueStdev", "TrueMedian", "TrueMinimum", "TrueMaximum", "True5thPercentile", "True95thPercentile",
+    "AbsoluteMean", "AbsoluteStdev", "AbsoluteMedian", "AbsoluteMinimum", "AbsoluteMaximum", "Absolute5thPercentile", "Absolute95thPercentile",
+    "AbsoluteMeanWithHoles"
+  };
+
+  struct ComparisonResult
+  {
+    std::vector<double> Statistics;
+    std::vector<int> Histograms;
+  };
+
+  //----------------------------------------------------------------------------
+  /*!
+    Derive the comparison volumes from the ground truth: every 5th visible voxel is a hole, every 10th voxel is a hole that is
+    not filled, and the testing volume differs from the ground truth by a pattern of -5..5.
+  */
+  PlusStatus WriteComparisonVolumes(vtkImageData* groundTruth)
+  {
+    if (groundTruth->GetScalarType() != VTK_UNSIGNED_CHAR || groundTruth->GetNumberOfScalarComponents() != 1)
+    {
+      LOG_ERROR("The ground truth volume must have a single unsigned char component");
+      return PLUS_FAIL;
+    }
+    vtkSmartPointer<vtkImageData> volumes[NUMBER_OF_COMPARISON_VOLUMES];
+    for (int volumeIndex = 0; volumeIndex < NUMBER_OF_COMPARISON_VOLUMES; volumeIndex++)
+    {
+      volumes[volumeIndex] = vtkSmartPointer<vtkImageData>::New();
+      volumes[volumeIndex]->DeepCopy(groundTruth);
+    }
+    const vtkIdType numberOfVoxels = groundTruth->GetNumberOfPoints();
+    const unsigned char* groundTruthPtr = static_cast<unsigned char*>(groundTruth->GetScalarPointer());
+    unsigned char* groundTruthAlphaPtr = static_cast<unsigned char*>(volumes[GROUND_TRUTH_ALPHA]->GetScalarPointer());
+    unsigned char* testingPtr = static_cast<unsigned char*>(volumes[TESTING]->GetScalarPointer());
+    unsigned char* testingAlphaPtr = static_cast<unsigned char*>(volumes[TESTING_ALPHA]->GetScalarPointer());
+    unsigned char* slicesAlphaPtr = static_cast<unsigned char*>(volumes[SLICES_ALPHA]->GetScalarPointer());
+    for (vtkIdType voxelIndex = 0; voxelIndex < numberOfVoxels; voxelIndex++)
+    {
+      const bool visible = groundTruthPtr[voxelIndex] != 0;
+      groundTruthAlphaPtr[voxelIndex] = visible ? 255 : 0;
+      slicesAlphaPtr[voxelIndex] = (visible && voxelIndex % 5 != 0) ? 255 : 0;
+      testingAlphaPtr[voxelIndex] = (visible && voxelIndex % 10 != 0) ? 255 : 0;
+      const int testingValue = groundTruthPtr[voxelIndex] + static_cast<int>(voxelIndex * 7 % 11) - 5;
+      testingPtr[voxelIndex] = static_cast<unsigned char>(std::min(std::max(testingValue, 0), 255));
+    }
+
+    for (int volumeIndex = 0; volumeIndex < NUMBER_OF_COMPARISON_VOLUMES; volumeIndex++)
+    {
+      vtkSmartPointer<vtkMetaImageWriter> writer = vtkSmartPointer<vtkMetaImageWriter>::New();
+      writer->SetFileName(COMPARISON_VOLUME_FILE_NAMES[volumeIndex]);
+      writer->SetCompression(false);
+      writer->SetInputData(volumes[volumeIndex]);
+      writer->Write();
+      if (writer->GetErrorCode() != 0)
+      {
+        LOG_ERROR("Failed to write " << COMPARISON_VOLUME_FILE_NAMES[volumeIndex]);
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus CompareVolumes(bool memoryMap, int numberOfThreads, ComparisonResult& result)
+  {
+    PlusCompareVolumesInput inputs[NUMBER_OF_COMPARISON_VOLUMES];
+    for (int volumeIndex = 0; volumeIndex < NUMBER_OF_COMPARISON_VOLUMES; volumeIndex++)
+    {
+      if (inputs[volumeIndex].Read(COMPARISON_VOLUME_FILE_NAMES[volumeIndex], memoryMap) != PLUS_SUCCESS || inputs[volumeIndex].GetImage() == NULL)
+      {
+        LOG_ERROR("Failed to read " << COMPARISON_VOLUME_FILE_NAMES[volumeIndex]);
+        return PLUS_FAIL;
+      }
+      if (inputs[volumeIndex].IsMemoryMapped() != memoryMap)
+      {
+        LOG_ERROR(COMPARISON_VOLUME_FILE_NAMES[volumeIndex] << (memoryMap ? " is not memory mapped" : " is memory mapped"));
+        return PLUS_FAIL;
+      }
+    }
+
+    vtkSmartPointer<vtkPlusCompareVolumes> comparator = vtkSmartPointer<vtkPlusCompareVolumes>::New();
+    comparator->SetInputGT(inputs[GROUND_TRUTH].GetImage());
+    comparator->SetInputGTAlpha(inputs[GROUND_TRUTH_ALPHA].GetImage());
+    comparator->SetInputTest(inputs[TESTING].GetImage());
+    comparator->SetInputTestAlpha(inputs[TESTING_ALPHA].GetImage());
+    comparator->SetInputSliceAlpha(inputs[SLICES_ALPHA].GetImage());
+    comparator->SetNumberOfThreads(numberOfThreads);
+    comparator->Update();
+
+    const double statistics[] =
+    {
+      static_cast<double>(comparator->GetNumberOfHoles()), static_cast<double>(comparator->GetNumberOfFilledHoles()),
+      static_cast<double>(comparator->GetNumberVoxelsVisible()), comparator->GetRMS(),
+      comparator->GetTrueMean(), comparator->GetTrueStdev(), comparator->GetTrueMedian(), comparator->GetTrueMinimum(),
+      comparator->GetTrueMaximum(), comparator->GetTrue5thPercentile(), comparator->GetTrue95thPercentile(),
+      comparator->GetAbsoluteMean(), comparator->GetAbsoluteStdev(), comparator->GetAbsoluteMedian(), comparator->GetAbsoluteMinimum(),
+      comparator->GetAbsoluteMaximum(), comparator->GetAbsolute5thPercentile(), comparator->GetAbsolute95thPercentile(),
+      comparator->GetAbsoluteMeanWithHoles()
+    };
+    result.Statistics.assign(statistics, statistics + sizeof(statistics) / sizeof(statistics[0]));
+    result.Histograms.assign(comparator->GetTrueHistogramPtr(), comparator->GetTrueHistogramPtr() + 511);
+    result.Histograms.insert(result.Histograms.end(), comparator->GetAbsoluteHistogramPtr(), comparator->GetAbsoluteHistogramPtr() + 256);
+    result.Histograms.insert(result.Histograms.end(), comparator->GetAbsoluteHistogramWithHolesPtr(), comparator->GetAbsoluteHistogramWithHolesPtr() + 256);
+    LOG_INFO((memoryMap ? "Memory mapped" : "Read") << " volumes, " << numberOfThreads << " thread(s): " << comparator->GetNumberOfHoles() << " holes, "
+             << comparator->GetNumberOfFilledHoles() << " filled, absolute mean error " << comparator->GetAbsoluteMean() << ", RMS " << comparator->GetRMS());
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Returns the number of statistics and histogram bins that are different */
+  int GetNumberOfDifferences(const ComparisonResult& result, const ComparisonResult& referenceResult, const std::string& description)
+  {
+    int numberOfDifferences = 0;
+    for (size_t statisticIndex = 0; statisticIndex < referenceResult.Statistics.size(); statisticIndex++)
+    {
+      if (result.Statistics[statisticIndex] != referenceResult.Statistics[statisticIndex])
+      {
+        LOG_ERROR(description << ": " << STATISTIC_NAMES[statisticIndex] << " is " << result.Statistics[statisticIndex]
+                  << " instead of " << referenceResult.Statistics[statisticIndex]);
+        numberOfDifferences++;
+      }
+    }
+    if (result.Histograms != referenceResult.Histograms)
+    {
+      LOG_ERROR(description << ": histograms are different");
+      numberOfDifferences++;
+    }
+    return numberOfDifferences;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  vtksys::CommandLineArguments args;
+
+  std::string inputVolumeFileName;
+  int numberOfThreads = 4;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--input-volume-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputVolumeFileName, "Reconstructed volume (unsigned char) that the compared volumes are derived from.");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads that the single-threaded comparison is compared to (default: 4).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputVolumeFileName.empty() || numberOfThreads < 2)
+  {
+    LOG_ERROR("Input volume file and at least 2 threads are required");
+    LOG_INFO("Help: " << args.GetHelp());
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkMetaImageReader> reader = vtkSmartPointer<vtkMetaImageReader>::New();
+  reader->SetFileName(inputVolumeFileName.c_str());
+  reader->Update();
+  if (WriteComparisonVolumes(reader->GetOutput()) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+
+  ComparisonResult referenceResult;
+  if (CompareVolumes(false, 1, referenceResult) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (referenceResult.Statistics[0] == 0 || referenceResult.Statistics[1] == 0)
+  {
+    LOG_ERROR("The compared volumes have no holes or no filled holes");
+    return EXIT_FAILURE;
+  }
+
+  int numberOfDifferences = 0;
+  const bool memoryMapModes[] = { false, true, true };
+  const int threadCounts[] = { numberOfThreads, 1, numberOfThreads };
+  for (int runIndex = 0; runIndex < 3; runIndex++)
+  {
+    ComparisonResult result;
+    if (CompareVolumes(memoryMapModes[runIndex], threadCounts[runIndex], result) != PLUS_SUCCESS)
+    {
+      return EXIT_FAILURE;
+    }
+    std::ostringstream description;
+    description << (memoryMapModes[runIndex] ? "Memory mapped" : "Read") << " volumes with " << threadCounts[runIndex] << " thread(s)";
+    numberOfDifferences += GetNumberOfDifferences(result, referenceResult, description.str());
+  }
+  if (numberOfDifferences > 0)
+  {
+    LOG_ERROR(numberOfDifferences << " statistics differ from the single-threaded comparison of the volumes read into memory");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkPlusCompareVolumesTest completed successfully");
+  return EXIT_SUCCESS;
+}
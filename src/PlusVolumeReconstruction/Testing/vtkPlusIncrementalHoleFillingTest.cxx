@@ -0,0 +1,284 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkPlusIncrementalHoleFillingTest.cxx
+Inserts the frames of a sequence file in batches and after each batch updates a hole filled volume only in the regions
+that the batch modified (the same way as the live reconstruction of vtkPlusVirtualVolumeReconstructor does).
+The incrementally updated volume must be identical to the volume that is hole filled as a whole.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusVolumeBrickGrid.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusVolumeReconstructor.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+#include <vtkIGSIOTransformRepository.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkXMLDataElement.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Enable hole filling with a Gaussian kernel, unless the configuration already specifies hole filling */
+  PlusStatus EnableHoleFilling(vtkXMLDataElement* configRootElement, int kernelSize)
+  {
+    vtkXMLDataElement* reconstructionElement = configRootElement->LookupElementWithName("VolumeReconstruction");
+    if (reconstructionElement == NULL)
+    {
+      LOG_ERROR("VolumeReconstruction element is not found in the configuration");
+      return PLUS_FAIL;
+    }
+    reconstructionElement->SetAttribute("FillHoles", "ON");
+    if (reconstructionElement->FindNestedElementWithName("HoleFilling") != NULL)
+    {
+      return PLUS_SUCCESS;
+    }
+    vtkSmartPointer<vtkXMLDataElement> holeFillingElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    holeFillingElement->SetName("HoleFilling");
+    vtkSmartPointer<vtkXMLDataElement> kernelElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    kernelElement->SetName("HoleFillingElement");
+    kernelElement->SetAttribute("Type", "GAUSSIAN");
+    kernelElement->SetIntAttribute("Size", kernelSize);
+    kernelElement->SetDoubleAttribute("Stdev", kernelSize / 3.0);
+    kernelElement->SetDoubleAttribute("MinimumKnownVoxelsRatio", 0.1);
+    holeFillingElement->AddNestedElement(kernelElement);
+    reconstructionElement->AddNestedElement(holeFillingElement);
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Returns true if the two volumes have the same extent, voxel format and voxel values */
+  bool IsIdenticalVolume(vtkImageData* volume1, vtkImageData* volume2)
+  {
+    int extent1[6] = { 0, -1, 0, -1, 0, -1 };
+    volume1->GetExtent(extent1);
+    int extent2[6] = { 0, -1, 0, -1, 0, -1 };
+    volume2->GetExtent(extent2);
+    if (!std::equal(extent1, extent1 + 6, extent2) || volume1->GetScalarType() != volume2->GetScalarType()
+        || volume1->GetNumberOfScalarComponents() != volume2->GetNumberOfScalarComponents())
+    {
+      return false;
+    }
+    const size_t numberOfBytes = static_cast<size_t>(volume1->GetNumberOfPoints()) * volume1->GetNumberOfScalarComponents() * volume1->GetScalarSize();
+    return memcmp(volume1->GetScalarPointer(), volume2->GetScalarPointer(), numberOfBytes) == 0;
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Insert the frames in batches, fill holes in the regions modified by each batch and compare the result to
+    a volume that is hole filled as a whole
+  */
+  PlusStatus RunIncrementalHoleFilling(vtkXMLDataElement* configRootElement, vtkIGSIOTrackedFrameList* trackedFrameList, const std::string& imageToReferenceTransformName,
+                                       int numberOfBatches, int maxNumberOfRegions)
+  {
+    vtkSmartPointer<vtkPlusVolumeReconstructor> reconstructor = vtkSmartPointer<vtkPlusVolumeReconstructor>::New();
+    if (reconstructor->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read volume reconstruction configuration");
+      return PLUS_FAIL;
+    }
+    if (!imageToReferenceTransformName.empty())
+    {
+      igsioTransformName transformName;
+      if (transformName.SetTransformName(imageToReferenceTransformName.c_str()) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Invalid image to reference transform name: " << imageToReferenceTransformName);
+        return PLUS_FAIL;
+      }
+      reconstructor->SetImageCoordinateFrame(transformName.From());
+      reconstructor->SetReferenceCoordinateFrame(transformName.To());
+    }
+    vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+    if (configRootElement->FindNestedElementWithName("CoordinateDefinitions") != NULL && transformRepository->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read transforms from CoordinateDefinitions");
+      return PLUS_FAIL;
+    }
+    std::string errorDetail;
+    if (reconstructor->SetOutputExtentFromFrameList(trackedFrameList, transformRepository, errorDetail) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set output extent of volume: " << errorDetail);
+      return PLUS_FAIL;
+    }
+
+    const int kernelRadius = reconstructor->GetHoleFillingKernelRadius();
+    if (kernelRadius < 0)
+    {
+      LOG_ERROR("Hole filling kernel radius is not known, incremental hole filling is not possible");
+      return PLUS_FAIL;
+    }
+    int volumeExtent[6] = { 0, -1, 0, -1, 0, -1 };
+    reconstructor->GetPastedVolumeExtent(volumeExtent);
+    PlusVolumeBrickGrid modifiedBricks;
+    modifiedBricks.Initialize(volumeExtent, false);
+
+    vtkSmartPointer<vtkPlusVolumeReconstructor> regionReconstructor = vtkSmartPointer<vtkPlusVolumeReconstructor>::New();
+    vtkSmartPointer<vtkImageData> incrementalVolume = vtkSmartPointer<vtkImageData>::New();
+    vtkSmartPointer<vtkImageData> fullVolume = vtkSmartPointer<vtkImageData>::New();
+    bool incrementalVolumeValid = false;
+
+    const int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
+    const int framesPerBatch = std::max((numberOfFrames + numberOfBatches - 1) / numberOfBatches, 1);
+    for (int batchStartIndex = 0; batchStartIndex < numberOfFrames; batchStartIndex += framesPerBatch)
+    {
+      const int batchEndIndex = std::min(batchStartIndex + framesPerBatch, numberOfFrames);
+      for (int frameIndex = batchStartIndex; frameIndex < batchEndIndex; frameIndex++)
+      {
+        igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
+        if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
+          return PLUS_FAIL;
+        }
+        int frameExtent[6] = { 0, -1, 0, -1, 0, -1 };
+        if (reconstructor->GetFrameExtentInVolume(frame, transformRepository, frameExtent) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to get the volume extent of frame #" << frameIndex);
+          return PLUS_FAIL;
+        }
+        modifiedBricks.MarkModified(frameExtent);
+        if (reconstructor->AddTrackedFrame(frame, transformRepository, frameIndex == 0, frameIndex == numberOfFrames - 1) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
+          return PLUS_FAIL;
+        }
+      }
+
+      if (!incrementalVolumeValid)
+      {
+        if (reconstructor->ExtractGrayLevels(incrementalVolume) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to extract gray levels");
+          return PLUS_FAIL;
+        }
+        incrementalVolumeValid = true;
+      }
+      else
+      {
+        std::vector<PlusVolumeBrickGrid::ExtentType> modifiedRegions;
+        modifiedBricks.GetModifiedRegions(modifiedRegions, maxNumberOfRegions);
+        for (std::vector<PlusVolumeBrickGrid::ExtentType>::const_iterator regionIt = modifiedRegions.begin(); regionIt != modifiedRegions.end(); ++regionIt)
+        {
+          // Hole filling results change within the kernel radius around the modified bricks
+          int updateExtent[6] = { 0, -1, 0, -1, 0, -1 };
+          for (int i = 0; i < 3; i++)
+          {
+            updateExtent[2 * i] = std::max((*regionIt)[2 * i] - kernelRadius, volumeExtent[2 * i]);
+            updateExtent[2 * i + 1] = std::min((*regionIt)[2 * i + 1] + kernelRadius, volumeExtent[2 * i + 1]);
+          }
+          if (reconstructor->UpdateGrayLevelsInRegion(incrementalVolume, updateExtent, kernelRadius, regionReconstructor) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to fill holes in region (" << updateExtent[0] << ", " << updateExtent[1] << ", " << updateExtent[2] << ", "
+                      << updateExtent[3] << ", " << updateExtent[4] << ", " << updateExtent[5] << ")");
+            return PLUS_FAIL;
+          }
+        }
+        LOG_DEBUG("Frames " << batchStartIndex << "-" << batchEndIndex - 1 << ": holes filled in " << modifiedRegions.size() << " regions ("
+                  << modifiedBricks.GetNumberOfModifiedBricks() << " of " << modifiedBricks.GetNumberOfBricks() << " bricks modified)");
+      }
+      modifiedBricks.ClearModified();
+
+      if (reconstructor->ExtractGrayLevels(fullVolume) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to extract gray levels");
+        return PLUS_FAIL;
+      }
+      if (!IsIdenticalVolume(incrementalVolume, fullVolume))
+      {
+        LOG_ERROR("Incrementally hole filled volume differs from the volume that is hole filled as a whole after inserting frames 0-" << batchEndIndex - 1
+                  << " (at most " << maxNumberOfRegions << " regions per update)");
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  vtksys::CommandLineArguments args;
+
+  std::string inputConfigFileName;
+  std::string inputSequenceFileName;
+  std::string imageToReferenceTransformName;
+  int numberOfBatches = 5;
+  int holeFillingKernelSize = 3;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Device set configuration file with the VolumeReconstruction element.");
+  args.AddArgument("--source-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputSequenceFileName, "Input sequence file.");
+  args.AddArgument("--image-to-reference-transform", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &imageToReferenceTransformName, "Name of the transform that defines the image slice pose relative to the reference coordinate system (default: as defined in the configuration file).");
+  args.AddArgument("--batches", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfBatches, "Number of batches that the frames are inserted in (default: 5).");
+  args.AddArgument("--hole-filling-kernel-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &holeFillingKernelSize, "Size of the Gaussian hole filling kernel if the configuration file does not specify hole filling (default: 3).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputConfigFileName.empty() || inputSequenceFileName.empty() || numberOfBatches < 2 || holeFillingKernelSize < 1)
+  {
+    LOG_ERROR("Input config file, input sequence file, at least 2 batches and a positive hole filling kernel size are required");
+    LOG_INFO("Help: " << args.GetHelp());
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, inputConfigFileName.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << inputConfigFileName);
+    return EXIT_FAILURE;
+  }
+  if (EnableHoleFilling(configRootElement, holeFillingKernelSize) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkPlusSequenceIO::Read(inputSequenceFileName, trackedFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to load input sequence file: " << inputSequenceFileName);
+    return EXIT_FAILURE;
+  }
+
+  // Separate boxes of modified bricks, then the bounding box of the modified bricks (as if there were too many boxes)
+  const int maxNumbersOfRegions[2] = { 16, 1 };
+  for (int i = 0; i < 2; i++)
+  {
+    if (RunIncrementalHoleFilling(configRootElement, trackedFrameList, imageToReferenceTransformName, numberOfBatches, maxNumbersOfRegions[i]) != PLUS_SUCCESS)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  LOG_INFO("vtkPlusIncrementalHoleFillingTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,201 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkPlusVolumeReconstructorBatchTest.cxx
+Inserts the frames of a sequence file in batches with vtkPlusVolumeReconstructor::AddTrackedFrames in reproducible mode
+using a single thread and using multiple threads. The reconstructed volumes and accumulation buffers must be identical.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusVolumeReconstructor.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+#include <vtkIGSIOTransformRepository.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkXMLDataElement.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Returns true if the two volumes have the same extent, voxel format and voxel values */
+  bool IsIdenticalVolume(vtkImageData* volume1, vtkImageData* volume2)
+  {
+    int extent1[6] = { 0, -1, 0, -1, 0, -1 };
+    volume1->GetExtent(extent1);
+    int extent2[6] = { 0, -1, 0, -1, 0, -1 };
+    volume2->GetExtent(extent2);
+    if (!std::equal(extent1, extent1 + 6, extent2) || volume1->GetScalarType() != volume2->GetScalarType()
+        || volume1->GetNumberOfScalarComponents() != volume2->GetNumberOfScalarComponents())
+    {
+      return false;
+    }
+    const size_t numberOfBytes = static_cast<size_t>(volume1->GetNumberOfPoints()) * volume1->GetNumberOfScalarComponents() * volume1->GetScalarSize();
+    return memcmp(volume1->GetScalarPointer(), volume2->GetScalarPointer(), numberOfBytes) == 0;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus ReconstructInBatches(vtkXMLDataElement* configRootElement, vtkIGSIOTrackedFrameList* trackedFrameList, const std::string& imageToReferenceTransformName,
+                                  int batchSize, unsigned int numberOfThreads, vtkImageData* grayLevels, vtkImageData* accumulation)
+  {
+    vtkSmartPointer<vtkPlusVolumeReconstructor> reconstructor = vtkSmartPointer<vtkPlusVolumeReconstructor>::New();
+    if (reconstructor->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read volume reconstruction configuration");
+      return PLUS_FAIL;
+    }
+    if (!imageToReferenceTransformName.empty())
+    {
+      igsioTransformName transformName;
+      if (transformName.SetTransformName(imageToReferenceTransformName.c_str()) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Invalid image to reference transform name: " << imageToReferenceTransformName);
+        return PLUS_FAIL;
+      }
+      reconstructor->SetImageCoordinateFrame(transformName.From());
+      reconstructor->SetReferenceCoordinateFrame(transformName.To());
+    }
+    vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+    if (configRootElement->FindNestedElementWithName("CoordinateDefinitions") != NULL && transformRepository->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read transforms from CoordinateDefinitions");
+      return PLUS_FAIL;
+    }
+    std::string errorDetail;
+    if (reconstructor->SetOutputExtentFromFrameList(trackedFrameList, transformRepository, errorDetail) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set output extent of volume: " << errorDetail);
+      return PLUS_FAIL;
+    }
+
+    // The same reconstructor is used for all the batches, so the tile reconstructors are reused
+    const int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
+    int numberOfInsertedFrames = 0;
+    for (int batchStartIndex = 0; batchStartIndex < numberOfFrames; batchStartIndex += batchSize)
+    {
+      std::vector<igsioTrackedFrame*> frames;
+      for (int frameIndex = batchStartIndex; frameIndex < std::min(batchStartIndex + batchSize, numberOfFrames); frameIndex++)
+      {
+        frames.push_back(trackedFrameList->GetTrackedFrame(frameIndex));
+      }
+      std::vector<PlusVolumeBrickGrid::ExtentType> insertedFrameExtents;
+      if (reconstructor->AddTrackedFrames(frames, transformRepository, numberOfThreads, true, &insertedFrameExtents) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frames " << batchStartIndex << "-" << batchStartIndex + frames.size() - 1 << " to the volume");
+        return PLUS_FAIL;
+      }
+      numberOfInsertedFrames += static_cast<int>(insertedFrameExtents.size());
+    }
+    if (numberOfInsertedFrames == 0)
+    {
+      LOG_ERROR("No frames were inserted into the volume");
+      return PLUS_FAIL;
+    }
+    LOG_INFO(numberOfInsertedFrames << " of " << numberOfFrames << " frames inserted in batches of " << batchSize << " using " << numberOfThreads << " threads");
+
+    if (reconstructor->ExtractGrayLevels(grayLevels) != PLUS_SUCCESS || reconstructor->ExtractAccumulation(accumulation) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to extract the reconstructed volume");
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  vtksys::CommandLineArguments args;
+
+  std::string inputConfigFileName;
+  std::string inputSequenceFileName;
+  std::string imageToReferenceTransformName;
+  int batchSize = 20;
+  int numberOfThreads = 4;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Device set configuration file with the VolumeReconstruction element.");
+  args.AddArgument("--source-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputSequenceFileName, "Input sequence file.");
+  args.AddArgument("--image-to-reference-transform", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &imageToReferenceTransformName, "Name of the transform that defines the image slice pose relative to the reference coordinate system (default: as defined in the configuration file).");
+  args.AddArgument("--batch-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &batchSize, "Number of frames that are inserted at once (default: 20).");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads that the single-threaded reconstruction is compared to (default: 4).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputConfigFileName.empty() || inputSequenceFileName.empty() || batchSize < 1 || numberOfThreads < 2)
+  {
+    LOG_ERROR("Input config file, input sequence file, a positive batch size and at least 2 threads are required");
+    LOG_INFO("Help: " << args.GetHelp());
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, inputConfigFileName.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << inputConfigFileName);
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkPlusSequenceIO::Read(inputSequenceFileName, trackedFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to load input sequence file: " << inputSequenceFileName);
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkImageData> singleThreadGrayLevels = vtkSmartPointer<vtkImageData>::New();
+  vtkSmartPointer<vtkImageData> singleThreadAccumulation = vtkSmartPointer<vtkImageData>::New();
+  if (ReconstructInBatches(configRootElement, trackedFrameList, imageToReferenceTransformName, batchSize, 1, singleThreadGrayLevels, singleThreadAccumulation) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  vtkSmartPointer<vtkImageData> multiThreadGrayLevels = vtkSmartPointer<vtkImageData>::New();
+  vtkSmartPointer<vtkImageData> multiThreadAccumulation = vtkSmartPointer<vtkImageData>::New();
+  if (ReconstructInBatches(configRootElement, trackedFrameList, imageToReferenceTransformName, batchSize, numberOfThreads, multiThreadGrayLevels, multiThreadAccumulation) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!IsIdenticalVolume(singleThreadGrayLevels, multiThreadGrayLevels))
+  {
+    LOG_ERROR("Volumes reconstructed using 1 and " << numberOfThreads << " threads are different");
+    return EXIT_FAILURE;
+  }
+  if (!IsIdenticalVolume(singleThreadAccumulation, multiThreadAccumulation))
+  {
+    LOG_ERROR("Accumulation buffers of the reconstructions using 1 and " << numberOfThreads << " threads are different");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkPlusVolumeReconstructorBatchTest completed successfully");
+  return EXIT_SUCCESS;
+}
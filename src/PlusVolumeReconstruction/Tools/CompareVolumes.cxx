@@ -11,8 +11,10 @@
 #include "PlusConfigure.h"
 #include "vtksys/CommandLineArguments.hxx"
 
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <time.h>
 
 #include "vtkDataSetReader.h"
@@ -23,8 +25,13 @@
 #include "vtkImageHistogramStatistics.h"
 #include "vtkMetaImageReader.h"
 
+#include "PlusCompareVolumesInput.h"
 #include "vtkPlusCompareVolumes.h"
 
+#include "vtkDataArray.h"
+#include "vtkPointData.h"
+#include <vtksys/SystemTools.hxx>
+
 //-----------------------------------------------------------------------------
 int SimpleCompareVolumes( vtkImageData* testVol, vtkImageData* refVol, double simpleCompareMaxError )
 {
@@ -59,9 +66,13 @@ int SimpleCompareVolumes( vtkImageData* testVol, vtkImageData* refVol, double si
     return EXIT_FAILURE;
   }
 
+  // Origins are compared with a small tolerance, as file writers may store them with different precision
   double* testOrigin = testVol->GetOrigin();
   double* refOrigin = refVol->GetOrigin();
-  if ( testOrigin[0] != refOrigin[0] || testOrigin[1] != refOrigin[1] || testOrigin[2] != refOrigin[2] )
+  const double originToleranceVoxels = 0.01;
+  if ( std::abs( testOrigin[0] - refOrigin[0] ) > originToleranceVoxels * refSpacing[0]
+       || std::abs( testOrigin[1] - refOrigin[1] ) > originToleranceVoxels * refSpacing[1]
+       || std::abs( testOrigin[2] - refOrigin[2] ) > originToleranceVoxels * refSpacing[2] )
   {
     LOG_ERROR( "Test volume origin (" << testOrigin[0] << ", " << testOrigin[1] << ", " << testOrigin[2] << ")" \
                << " does not match reference volume origin (" << refOrigin[0] << ", " << refOrigin[1] << ", " << refOrigin[2] << ")" )
@@ -114,6 +125,7 @@ int main( int argc, char** argv )
   std::vector<int> roiOriginV;
   std::vector<int> roiSizeV;
   double simpleCompareMaxError = -1;
+  bool memoryMapInputs( false );
 
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
@@ -131,6 +143,7 @@ int main( int argc, char** argv )
   args.AddArgument( "--output-diff-volume-true", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputTrueDiffFileName, "Save the true difference volume to this file" );
   args.AddArgument( "--output-diff-volume-absolute", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputAbsoluteDiffFileName, "Save the absolute difference volume to this file" );
   args.AddArgument( "--simple-compare-max-error", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &simpleCompareMaxError, "If specified, a simple comparison of the volumes is performed (no detailed statistics are computed, only the ground truth and test volumes are used) and if the stdev of pixel values of the absolute difference image is larger than the specified value then the test returns with failure" );
+  args.AddArgument( "--memory-map-inputs", vtksys::CommandLineArguments::NO_ARGUMENT, &memoryMapInputs, "Map uncompressed MetaImage input volumes from the files instead of reading them into memory. Useful for large volumes, only the voxels that are compared (e.g., in the region of interest) are loaded." );
   args.AddArgument( "--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)" );
   args.AddArgument( "--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help." );
 
@@ -159,19 +172,26 @@ int main( int argc, char** argv )
     exit( EXIT_FAILURE );
   }
 
-  // read in the volumes
+  // read in the volumes (declared before any filter that uses them, as mapped volumes must outlive the filters)
+  PlusCompareVolumesInput groundTruthVolume;
+  PlusCompareVolumesInput groundTruthAlphaVolume;
+  PlusCompareVolumesInput testingVolume;
+  PlusCompareVolumesInput testingAlphaVolume;
+  PlusCompareVolumesInput slicesAlphaVolume;
 
   LOG_INFO( "Reading input ground truth image: " << inputGTFileName );
-  vtkSmartPointer<vtkMetaImageReader> reader = vtkSmartPointer<vtkMetaImageReader>::New();
-  reader->SetFileName( inputGTFileName.c_str() );
-  reader->Update();
-  vtkImageData* groundTruth = vtkImageData::SafeDownCast( reader->GetOutput() );
+  if ( groundTruthVolume.Read( inputGTFileName, memoryMapInputs ) != PLUS_SUCCESS )
+  {
+    exit( EXIT_FAILURE );
+  }
+  vtkImageData* groundTruth = groundTruthVolume.GetImage();
 
   LOG_INFO( "Reading input testing image: " << inputTestingFileName );
-  vtkSmartPointer<vtkMetaImageReader> reader3 = vtkSmartPointer<vtkMetaImageReader>::New();
-  reader3->SetFileName( inputTestingFileName.c_str() );
-  reader3->Update();
-  vtkImageData* testingImage = vtkImageData::SafeDownCast( reader3->GetOutput() );
+  if ( testingVolume.Read( inputTestingFileName, memoryMapInputs ) != PLUS_SUCCESS )
+  {
+    exit( EXIT_FAILURE );
+  }
+  vtkImageData* testingImage = testingVolume.GetImage();
 
   /************************************************************/
   // Simple volume comparison
@@ -205,22 +225,25 @@ int main( int argc, char** argv )
   // read in the additional volumes
 
   LOG_INFO( "Reading input ground truth alpha: " << inputGTAlphaFileName );
-  vtkSmartPointer<vtkMetaImageReader> reader2 = vtkSmartPointer<vtkMetaImageReader>::New();
-  reader2->SetFileName( inputGTAlphaFileName.c_str() );
-  reader2->Update();
-  vtkImageData* groundTruthAlpha = vtkImageData::SafeDownCast( reader2->GetOutput() );
+  if ( groundTruthAlphaVolume.Read( inputGTAlphaFileName, memoryMapInputs ) != PLUS_SUCCESS )
+  {
+    exit( EXIT_FAILURE );
+  }
+  vtkImageData* groundTruthAlpha = groundTruthAlphaVolume.GetImage();
 
   LOG_INFO( "Reading input testing alpha: " << inputTestingAlphaFileName );
-  vtkSmartPointer<vtkMetaImageReader> reader4 = vtkSmartPointer<vtkMetaImageReader>::New();
-  reader4->SetFileName( inputTestingAlphaFileName.c_str() );
-  reader4->Update();
-  vtkImageData* testingAlpha = vtkImageData::SafeDownCast( reader4->GetOutput() );
+  if ( testingAlphaVolume.Read( inputTestingAlphaFileName, memoryMapInputs ) != PLUS_SUCCESS )
+  {
+    exit( EXIT_FAILURE );
+  }
+  vtkImageData* testingAlpha = testingAlphaVolume.GetImage();
 
   LOG_INFO( "Reading input slices alpha: " << inputSliceAlphaFileName );
-  vtkSmartPointer<vtkMetaImageReader> reader5 = vtkSmartPointer<vtkMetaImageReader>::New();
-  reader5->SetFileName( inputSliceAlphaFileName.c_str() );
-  reader5->Update();
-  vtkImageData* slicesAlpha = vtkImageData::SafeDownCast( reader5->GetOutput() );
+  if ( slicesAlphaVolume.Read( inputSliceAlphaFileName, memoryMapInputs ) != PLUS_SUCCESS )
+  {
+    exit( EXIT_FAILURE );
+  }
+  vtkImageData* slicesAlpha = slicesAlphaVolume.GetImage();
 
   // check to make sure extents match
   int* extentGT = groundTruth->GetExtent();
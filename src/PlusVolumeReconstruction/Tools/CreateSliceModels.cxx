@@ -17,17 +17,18 @@
 #include <algorithm>
 #include <cctype>
 #include <string>
+#include <vector>
 
 // VTK includes
-#include <vtkAppendPolyData.h>
-#include <vtkCubeSource.h>
+#include <vtkCellArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkMath.h>
 #include <vtkMatrix4x4.h>
+#include <vtkPoints.h>
 #include <vtkPolyData.h>
 #include <vtkPolyDataWriter.h>
 #include <vtkSTLWriter.h>
 #include <vtkSmartPointer.h>
-#include <vtkTransform.h>
-#include <vtkTransformPolyDataFilter.h>
 #include <vtkXMLUtilities.h>
 #include <vtksys/CommandLineArguments.hxx>
 
@@ -40,6 +41,13 @@
 // Plus includes
 #include <vtkPlusVolumeReconstructor.h>
 
+namespace
+{
+  const int MATRIX_ELEMENTS_PER_FRAME = 12;
+  const int CORNERS_PER_FRAME = 8;
+  const int FACES_PER_FRAME = 6;
+}
+
 int main( int argc, char** argv )
 {
   bool printHelp( false );
@@ -47,6 +55,7 @@ int main( int argc, char** argv )
   std::string inputConfigFileName;
   std::string outputModelFilename;
   std::string imageToReferenceTransformNameStr;
+  double minPoseChangeMm = 0;
 
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
@@ -57,6 +66,7 @@ int main( int argc, char** argv )
   args.AddArgument( "--source-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputMetaFilename, "Tracked ultrasound recorded by Plus (e.g., by the TrackedUltrasoundCapturing application) in a sequence file (.mha/.nrrd)" );
   args.AddArgument( "--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Config file used for volume reconstruction. It contains the probe calibration matrix, the ImageToTool transform (.xml) " );
   args.AddArgument( "--output-model-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputModelFilename, "A 3D model file that contains rectangles corresponding to each US image slice (.vtk)" );
+  args.AddArgument( "--min-pose-change-mm", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &minPoseChangeMm, "Decimate the slices: a frame is only added to the model if any of its corners moved by at least this distance since the last added frame (default: 0 = add all frames)" );
   args.AddArgument( "--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)" );
   args.AddArgument( "--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help." );
 
@@ -146,9 +156,6 @@ int main( int argc, char** argv )
     LOG_INFO( "Configuration file is not specified. Only those transforms are available that are defined in the sequence metafile" );
   }
 
-  // Prepare the output polydata.
-  vtkSmartPointer<vtkAppendPolyData> appender = vtkSmartPointer<vtkAppendPolyData>::New();
-
   igsioTransformName imageToReferenceTransformName;
   if ( imageToReferenceTransformName.SetTransformName( imageToReferenceTransformNameStr.c_str() ) != PLUS_SUCCESS )
   {
@@ -156,7 +163,10 @@ int main( int argc, char** argv )
     return EXIT_FAILURE;
   }
 
-  // Loop over each tracked image slice.
+  // Collect the image to reference transforms. The repository is updated frame by frame, so this part is sequential.
+  std::vector<double> imageToReferenceMatrices; // rows 0-2 of the 4x4 matrix of each valid frame
+  imageToReferenceMatrices.reserve( trackedFrameList->GetNumberOfTrackedFrames() * MATRIX_ELEMENTS_PER_FRAME );
+  vtkSmartPointer<vtkMatrix4x4> imageToReferenceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   for ( unsigned int frameIndex = 0; frameIndex < trackedFrameList->GetNumberOfTrackedFrames(); ++ frameIndex )
   {
     igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame( frameIndex );
@@ -168,7 +178,6 @@ int main( int argc, char** argv )
       continue;
     }
 
-    vtkSmartPointer<vtkMatrix4x4> imageToReferenceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
     if ( transformRepository->GetTransform( imageToReferenceTransformName, imageToReferenceTransformMatrix ) != PLUS_SUCCESS )
     {
       std::string strTransformName;
@@ -177,29 +186,97 @@ int main( int argc, char** argv )
       continue;
     }
 
-    vtkSmartPointer<vtkTransform> imageToReferenceTransform = vtkSmartPointer<vtkTransform>::New();
-    imageToReferenceTransform->SetMatrix( imageToReferenceTransformMatrix );
-
-    vtkSmartPointer<vtkTransform> tCubeToImage = vtkSmartPointer<vtkTransform>::New();
-    tCubeToImage->Translate( clipRectangleOrigin[0], clipRectangleOrigin[1], clipRectangleOrigin[2] );
-    tCubeToImage->Scale( clipRectangleSize[0], clipRectangleSize[1], clipRectangleSize[2] );
-    tCubeToImage->Translate( 0.5, 0.5, 0.5 );  // Moving the corner to the origin.
+    for ( int row = 0; row < 3; row++ )
+    {
+      for ( int column = 0; column < 4; column++ )
+      {
+        imageToReferenceMatrices.push_back( imageToReferenceTransformMatrix->GetElement( row, column ) );
+      }
+    }
+  }
+  unsigned int numberOfValidFrames = static_cast<unsigned int>( imageToReferenceMatrices.size() / MATRIX_ELEMENTS_PER_FRAME );
 
-    vtkSmartPointer<vtkTransform> tCubeToTracker = vtkSmartPointer<vtkTransform>::New();
-    tCubeToTracker->Identity();
-    tCubeToTracker->Concatenate( imageToReferenceTransform );
-    tCubeToTracker->Concatenate( tCubeToImage );
+  // Corners of the clip rectangle box in image coordinates (the box is one pixel thick for 2D frames)
+  double cornersInImage[CORNERS_PER_FRAME][3];
+  for ( int corner = 0; corner < CORNERS_PER_FRAME; corner++ )
+  {
+    cornersInImage[corner][0] = clipRectangleOrigin[0] + ( ( corner & 1 ) ? clipRectangleSize[0] : 0.0 );
+    cornersInImage[corner][1] = clipRectangleOrigin[1] + ( ( corner & 2 ) ? clipRectangleSize[1] : 0.0 );
+    cornersInImage[corner][2] = clipRectangleOrigin[2] + ( ( corner & 4 ) ? clipRectangleSize[2] : 0.0 );
+  }
 
-    vtkSmartPointer<vtkTransformPolyDataFilter> cubeToTracker = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-    cubeToTracker->SetTransform( tCubeToTracker );
-    vtkSmartPointer<vtkCubeSource> source = vtkSmartPointer<vtkCubeSource>::New();
-    source->Update();
-    cubeToTracker->SetInputConnection( source->GetOutputPort() );
-    cubeToTracker->Update();
+  // Transform the corners of all frames in one batch
+  std::vector<double> cornersInReference( static_cast<size_t>( numberOfValidFrames ) * CORNERS_PER_FRAME * 3 );
+  PlusCommon::ParallelFor( numberOfValidFrames, [&]( unsigned int frameIndex )
+  {
+    const double* m = &imageToReferenceMatrices[static_cast<size_t>( frameIndex ) * MATRIX_ELEMENTS_PER_FRAME];
+    double* frameCorners = &cornersInReference[static_cast<size_t>( frameIndex ) * CORNERS_PER_FRAME * 3];
+    for ( int corner = 0; corner < CORNERS_PER_FRAME; corner++ )
+    {
+      const double* c = cornersInImage[corner];
+      for ( int row = 0; row < 3; row++ )
+      {
+        frameCorners[corner * 3 + row] = m[row * 4] * c[0] + m[row * 4 + 1] * c[1] + m[row * 4 + 2] * c[2] + m[row * 4 + 3];
+      }
+    }
+  } );
 
-    appender->AddInputConnection( cubeToTracker->GetOutputPort() );
+  // Decimate: skip frames whose corners are all closer than the threshold to the corners of the last added frame
+  std::vector<unsigned int> modelFrameIndices;
+  modelFrameIndices.reserve( numberOfValidFrames );
+  double minPoseChangeSquared = minPoseChangeMm * minPoseChangeMm;
+  for ( unsigned int frameIndex = 0; frameIndex < numberOfValidFrames; ++frameIndex )
+  {
+    if ( minPoseChangeMm > 0 && !modelFrameIndices.empty() )
+    {
+      const double* frameCorners = &cornersInReference[static_cast<size_t>( frameIndex ) * CORNERS_PER_FRAME * 3];
+      const double* lastCorners = &cornersInReference[static_cast<size_t>( modelFrameIndices.back() ) * CORNERS_PER_FRAME * 3];
+      double maxCornerDisplacementSquared = 0;
+      for ( int corner = 0; corner < CORNERS_PER_FRAME; corner++ )
+      {
+        double displacementSquared = vtkMath::Distance2BetweenPoints( frameCorners + corner * 3, lastCorners + corner * 3 );
+        maxCornerDisplacementSquared = std::max( maxCornerDisplacementSquared, displacementSquared );
+      }
+      if ( maxCornerDisplacementSquared < minPoseChangeSquared )
+      {
+        continue;
+      }
+    }
+    modelFrameIndices.push_back( frameIndex );
   }
-  
+  LOG_INFO( "Slice model contains " << modelFrameIndices.size() << " of " << trackedFrameList->GetNumberOfTrackedFrames() << " frames" );
+
+  // Build one polydata with preallocated points and faces, a box of 8 points and 6 quads for each frame
+  static const vtkIdType BOX_FACES[FACES_PER_FRAME][4] = { {0, 4, 6, 2}, {1, 3, 7, 5}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 2, 3, 1}, {4, 5, 7, 6} };
+  vtkIdType numberOfModelFrames = static_cast<vtkIdType>( modelFrameIndices.size() );
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToDouble();
+  points->SetNumberOfPoints( numberOfModelFrames * CORNERS_PER_FRAME );
+  vtkSmartPointer<vtkIdTypeArray> faces = vtkSmartPointer<vtkIdTypeArray>::New();
+  faces->SetNumberOfValues( numberOfModelFrames * FACES_PER_FRAME * 5 );
+  double* pointData = static_cast<double*>( points->GetVoidPointer( 0 ) );
+  vtkIdType* faceData = faces->GetPointer( 0 );
+  PlusCommon::ParallelFor( static_cast<unsigned int>( numberOfModelFrames ), [&]( unsigned int modelFrameIndex )
+  {
+    const double* frameCorners = &cornersInReference[static_cast<size_t>( modelFrameIndices[modelFrameIndex] ) * CORNERS_PER_FRAME * 3];
+    std::copy( frameCorners, frameCorners + CORNERS_PER_FRAME * 3, pointData + static_cast<size_t>( modelFrameIndex ) * CORNERS_PER_FRAME * 3 );
+    vtkIdType firstPointId = static_cast<vtkIdType>( modelFrameIndex ) * CORNERS_PER_FRAME;
+    vtkIdType* frameFaces = faceData + static_cast<size_t>( modelFrameIndex ) * FACES_PER_FRAME * 5;
+    for ( int face = 0; face < FACES_PER_FRAME; face++ )
+    {
+      frameFaces[face * 5] = 4;
+      for ( int i = 0; i < 4; i++ )
+      {
+        frameFaces[face * 5 + 1 + i] = firstPointId + BOX_FACES[face][i];
+      }
+    }
+  } );
+  vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+  polys->SetCells( numberOfModelFrames * FACES_PER_FRAME, faces );
+  vtkSmartPointer<vtkPolyData> sliceModels = vtkSmartPointer<vtkPolyData>::New();
+  sliceModels->SetPoints( points );
+  sliceModels->SetPolys( polys );
+
   // Write model output.
   LOG_DEBUG( "Writing output model file (" << outputModelFilename << ")..." );
   std::string copy(outputModelFilename);
@@ -209,14 +286,14 @@ int main( int argc, char** argv )
   {
     vtkSmartPointer<vtkSTLWriter> writer = vtkSmartPointer<vtkSTLWriter>::New();
     writer->SetFileName(outputModelFilename.c_str());
-    writer->SetInputConnection(appender->GetOutputPort());
+    writer->SetInputData(sliceModels);
     writer->Update();
   }
   else
   {
     vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
     writer->SetFileName(outputModelFilename.c_str());
-    writer->SetInputConnection(appender->GetOutputPort());
+    writer->SetInputData(sliceModels);
     writer->Update();
   }
   LOG_DEBUG( "Writing model file done." );
@@ -0,0 +1,276 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusCompareVolumesInput.h"
+
+#include "vtkDataArray.h"
+#include "vtkImageData.h"
+#include "vtkMetaImageReader.h"
+#include "vtkPointData.h"
+#include <vtksys/SystemTools.hxx>
+
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------
+PlusCompareVolumesInput::PlusCompareVolumesInput()
+  : MappedData( NULL )
+  , MappedSize( 0 )
+{
+}
+
+//-----------------------------------------------------------------------------
+PlusCompareVolumesInput::~PlusCompareVolumesInput()
+{
+  this->Image = NULL;
+  this->Unmap();
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus PlusCompareVolumesInput::Read( const std::string& fileName, bool memoryMap )
+{
+  if ( memoryMap )
+  {
+    if ( this->ReadMemoryMapped( fileName ) == PLUS_SUCCESS )
+    {
+      return PLUS_SUCCESS;
+    }
+    LOG_WARNING( "Volume cannot be memory mapped, it is read into memory: " << fileName );
+  }
+  this->Reader = vtkSmartPointer<vtkMetaImageReader>::New();
+  this->Reader->SetFileName( fileName.c_str() );
+  this->Reader->Update();
+  this->Image = this->Reader->GetOutput();
+  return PLUS_SUCCESS;
+
+//-----------------------------------------------------------------------------
+PlusStatus PlusCompareVolumesInput::ReadMemoryMapped( const std::string& fileName )
+{
+  std::ifstream headerFile( fileName.c_str(), std::ios::in | std::ios::binary );
+  if ( !headerFile.is_open() )
+  {
+    LOG_ERROR( "Failed to open volume file: " << fileName );
+    return PLUS_FAIL;
+  }
+
+  int numberOfDimensions = 3;
+  int dimensions[3] = {1, 1, 1};
+  double spacing[3] = {1.0, 1.0, 1.0};
+  double origin[3] = {0.0, 0.0, 0.0};
+  int numberOfComponents = 1;
+  int scalarType = -1;
+  long long headerSize = 0;
+  bool compressed = false;
+  bool bigEndian = false;
+  std::string dataFileName;
+  long long dataOffset = 0;
+
+  std::string line;
+  while ( dataFileName.empty() && std::getline( headerFile, line ) )
+  {
+    size_t separator = line.find( '=' );
+    if ( separator == std::string::npos )
+    {
+      continue;
+    }
+    std::string key = vtksys::SystemTools::TrimWhitespace( line.substr( 0, separator ) );
+    std::string value = vtksys::SystemTools::TrimWhitespace( line.substr( separator + 1 ) );
+    std::istringstream valueStream( value );
+    if ( key == "NDims" )
+    {
+      valueStream >> numberOfDimensions;
+    }
+    else if ( key == "DimSize" )
+    {
+      valueStream >> dimensions[0] >> dimensions[1] >> dimensions[2];
+    }
+    else if ( key == "ElementSpacing" )
+    {
+      valueStream >> spacing[0] >> spacing[1] >> spacing[2];
+    }
+    else if ( key == "Offset" || key == "Origin" || key == "Position" )
+    {
+      valueStream >> origin[0] >> origin[1] >> origin[2];
+    }
+    else if ( key == "ElementNumberOfChannels" )
+    {
+      valueStream >> numberOfComponents;
+    }
+    else if ( key == "HeaderSize" )
+    {
+      valueStream >> headerSize;
+    }
+    else if ( key == "CompressedData" )
+    {
+      compressed = ( vtksys::SystemTools::LowerCase( value ) == "true" );
+    }
+    else if ( key == "BinaryDataByteOrderMSB" || key == "ElementByteOrderMSB" )
+    {
+      bigEndian = ( vtksys::SystemTools::LowerCase( value ) == "true" );
+    }
+    else if ( key == "ElementType" )
+    {
+      scalarType = GetScalarTypeFromMetaElementType( value );
+    }
+    else if ( key == "ElementDataFile" )
+    {
+      dataFileName = value;
+      dataOffset = static_cast<long long>( headerFile.tellg() );
+    }
+  }
+  headerFile.close();
+
+  if ( numberOfDimensions < 2 || numberOfDimensions > 3 || scalarType < 0 || compressed || dataFileName.empty()
+       || dataFileName == "LIST" || dataFileName.find( ' ' ) != std::string::npos )
+  {
+    LOG_DEBUG( "Only uncompressed 2D or 3D MetaImage volumes stored in a single data file can be memory mapped" );
+    return PLUS_FAIL;
+  }
+  if ( numberOfDimensions == 2 )
+  {
+    dimensions[2] = 1;
+  }
+
+  vtkSmartPointer<vtkDataArray> scalars = vtkSmartPointer<vtkDataArray>::Take( vtkDataArray::CreateDataArray( scalarType ) );
+  int elementSize = scalars->GetDataTypeSize();
+  if ( bigEndian && elementSize > 1 )
+  {
+    LOG_DEBUG( "Big endian volumes cannot be memory mapped" );
+    return PLUS_FAIL;
+  }
+
+  if ( dataFileName == "LOCAL" )
+  {
+    dataFileName = fileName;
+  }
+  else
+  {
+    dataFileName = vtksys::SystemTools::CollapseFullPath( dataFileName, vtksys::SystemTools::GetFilenamePath( fileName ) );
+    dataOffset = 0;
+  }
+
+  vtkIdType numberOfValues = static_cast<vtkIdType>( dimensions[0] ) * dimensions[1] * dimensions[2] * numberOfComponents;
+  long long dataSize = static_cast<long long>( numberOfValues ) * elementSize;
+  if ( this->Map( dataFileName ) != PLUS_SUCCESS )
+  {
+    return PLUS_FAIL;
+  }
+  if ( headerSize == -1 )
+  {
+    // data is at the end of the file
+    dataOffset = static_cast<long long>( this->MappedSize ) - dataSize;
+  }
+  else
+  {
+    dataOffset += headerSize;
+  }
+  if ( dataOffset < 0 || dataOffset + dataSize > static_cast<long long>( this->MappedSize ) )
+  {
+    LOG_ERROR( "Volume data file is shorter than the size specified in the header: " << dataFileName );
+    this->Unmap();
+    return PLUS_FAIL;
+  }
+
+  // The array does not own the mapped memory, it is released when this object is destroyed
+  scalars->SetNumberOfComponents( numberOfComponents );
+  scalars->SetVoidArray( static_cast<char*>( this->MappedData ) + dataOffset, numberOfValues, 1 );
+  this->Image = vtkSmartPointer<vtkImageData>::New();
+  this->Image->SetDimensions( dimensions );
+  this->Image->SetSpacing( spacing );
+  this->Image->SetOrigin( origin );
+  this->Image->GetPointData()->SetScalars( scalars );
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int PlusCompareVolumesInput::GetScalarTypeFromMetaElementType( const std::string& elementType )
+{
+  if ( elementType == "MET_UCHAR" ) { return VTK_UNSIGNED_CHAR; }
+  if ( elementType == "MET_CHAR" ) { return VTK_SIGNED_CHAR; }
+  if ( elementType == "MET_USHORT" ) { return VTK_UNSIGNED_SHORT; }
+  if ( elementType == "MET_SHORT" ) { return VTK_SHORT; }
+  if ( elementType == "MET_UINT" ) { return VTK_UNSIGNED_INT; }
+  if ( elementType == "MET_INT" ) { return VTK_INT; }
+  if ( elementType == "MET_FLOAT" ) { return VTK_FLOAT; }
+  if ( elementType == "MET_DOUBLE" ) { return VTK_DOUBLE; }
+  return -1;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus PlusCompareVolumesInput::Map( const std::string& dataFileName )
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileA( dataFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL );
+  if ( file == INVALID_HANDLE_VALUE )
+  {
+    LOG_ERROR( "Failed to open volume data file: " << dataFileName );
+    return PLUS_FAIL;
+  }
+  LARGE_INTEGER fileSize;
+  HANDLE mapping = NULL;
+  if ( GetFileSizeEx( file, &fileSize ) && fileSize.QuadPart > 0 )
+  {
+    mapping = CreateFileMappingA( file, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+  }
+  if ( mapping != NULL )
+  {
+    this->MappedData = MapViewOfFile( mapping, FILE_MAP_COPY, 0, 0, 0 );
+    this->MappedSize = static_cast<size_t>( fileSize.QuadPart );
+    CloseHandle( mapping ); // the view keeps the mapping alive
+  }
+  CloseHandle( file );
+#else
+  int fileDescriptor = open( dataFileName.c_str(), O_RDONLY );
+  if ( fileDescriptor < 0 )
+  {
+    LOG_ERROR( "Failed to open volume data file: " << dataFileName );
+    return PLUS_FAIL;
+  }
+  struct stat fileStatus;
+  if ( fstat( fileDescriptor, &fileStatus ) == 0 && fileStatus.st_size > 0 )
+  {
+    void* data = mmap( NULL, static_cast<size_t>( fileStatus.st_size ), PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDescriptor, 0 );
+    if ( data != MAP_FAILED )
+    {
+      this->MappedData = data;
+      this->MappedSize = static_cast<size_t>( fileStatus.st_size );
+    }
+  }
+  close( fileDescriptor ); // the mapping stays valid after the file is closed
+#endif
+  if ( this->MappedData == NULL )
+  {
+    LOG_ERROR( "Failed to memory map volume data file: " << dataFileName );
+    this->MappedSize = 0;
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+void PlusCompareVolumesInput::Unmap()
+{
+  if ( this->MappedData == NULL )
+  {
+    return;
+  }
+#ifdef _WIN32
+  UnmapViewOfFile( this->MappedData );
+#else
+  munmap( this->MappedData, this->MappedSize );
+#endif
+  this->MappedData = NULL;
+  this->MappedSize = 0;
+}
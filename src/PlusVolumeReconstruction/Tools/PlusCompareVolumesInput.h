@@ -0,0 +1,56 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusCompareVolumesInput_h
+#define __PlusCompareVolumesInput_h
+
+#include "PlusConfigure.h"
+
+#include <string>
+
+class vtkImageData;
+class vtkMetaImageReader;
+
+/*!
+  \class PlusCompareVolumesInput
+  \brief Input volume of the CompareVolumes tool
+
+  If memory mapping is requested and the file is an uncompressed MetaImage then the voxels are mapped from the file
+  (pages are only read when the comparison accesses them), otherwise the whole volume is read into memory.
+  The mapped memory is released when the object is destroyed, so it must outlive all the filters that use the image.
+*/
+class PlusCompareVolumesInput
+{
+public:
+  PlusCompareVolumesInput();
+  ~PlusCompareVolumesInput();
+
+  vtkImageData* GetImage() { return this->Image; }
+
+  /*! Returns true if the voxels of the image are mapped from the file */
+  bool IsMemoryMapped() const { return this->MappedData != NULL; }
+
+  PlusStatus Read( const std::string& fileName, bool memoryMap );
+
+protected:
+  PlusStatus ReadMemoryMapped( const std::string& fileName );
+  static int GetScalarTypeFromMetaElementType( const std::string& elementType );
+
+  /*! Maps the whole file copy-on-write, so that filters can never modify the file */
+  PlusStatus Map( const std::string& dataFileName );
+  void Unmap();
+
+  vtkSmartPointer<vtkMetaImageReader> Reader;
+  vtkSmartPointer<vtkImageData> Image;
+  void* MappedData;
+  size_t MappedSize;
+
+private:
+  PlusCompareVolumesInput( const PlusCompareVolumesInput& );
+  void operator=( const PlusCompareVolumesInput& );
+};
+
+#endif
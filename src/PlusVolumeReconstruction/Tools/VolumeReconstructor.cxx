@@ -6,14 +6,515 @@
 
 #include "PlusConfigure.h"
 #include "igsioTrackedFrame.h"
+#include "vtkDataArray.h"
 #include "vtkImageData.h"
 #include "vtkMatrix4x4.h"
-#include "vtkIGSIOSequenceIO.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusSequenceManifest.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkIGSIOTransformRepository.h"
 #include "vtkPlusVolumeReconstructor.h"
 #include "vtkXMLUtilities.h"
 #include "vtksys/CommandLineArguments.hxx"
+#include "vtksys/SystemTools.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+  const double BYTES_PER_MEGABYTE = 1024.0 * 1024.0;
+
+  /*! Part of the input sequence that is read into memory at once (a segment of a segmented recording or the whole file) */
+  struct InputSegment
+  {
+    std::string Path;
+    int FirstFrameIndex;
+    int NumberOfFrames;
+    /*! Bounds of the frames in the Reference coordinate system */
+    double ReferenceBounds[6];
+    double MemorySizeBytes;
+    /*! Frames of the segment if the whole input is kept in memory, otherwise NULL and the segment is read again for each slab */
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> FrameList;
+  };
+
+  //----------------------------------------------------------------------------
+  void InitializeBounds(double bounds[6])
+  {
+    for (int axis = 0; axis < 3; axis++)
+    {
+      bounds[2 * axis] = VTK_DOUBLE_MAX;
+      bounds[2 * axis + 1] = VTK_DOUBLE_MIN;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  std::string GetMetaImageElementType(int scalarType)
+  {
+    switch (scalarType)
+    {
+      case VTK_CHAR:
+      case VTK_SIGNED_CHAR: return "MET_CHAR";
+      case VTK_UNSIGNED_CHAR: return "MET_UCHAR";
+      case VTK_SHORT: return "MET_SHORT";
+      case VTK_UNSIGNED_SHORT: return "MET_USHORT";
+      case VTK_INT: return "MET_INT";
+      case VTK_UNSIGNED_INT: return "MET_UINT";
+      case VTK_FLOAT: return "MET_FLOAT";
+      case VTK_DOUBLE: return "MET_DOUBLE";
+      default: return "";
+    }
+  }
+
+  /*!
+    Writes a MetaImage volume (.mha or .mhd with .raw) plane by plane, so the whole volume does not have to be in memory.
+    Planes must be written in increasing z order.
+  */
+  class MetaImageVolumeWriter
+  {
+  public:
+    MetaImageVolumeWriter() : ScalarType(VTK_VOID), NumberOfComponents(0), NumberOfWrittenPlanes(0)
+    {
+      std::fill(this->Dimensions, this->Dimensions + 3, 0);
+    }
+
+    bool IsOpen() const { return this->DataFile.is_open(); }
+
+    //----------------------------------------------------------------------------
+    PlusStatus Open(const std::string& filename, const int dimensions[3], const double spacing[3], const double origin[3], int scalarType, int numberOfComponents,
+                    const std::vector<std::string>& customFields, const std::vector<std::string>& customValues)
+    {
+      std::string elementType = GetMetaImageElementType(scalarType);
+      if (elementType.empty())
+      {
+        LOG_ERROR("Unsupported scalar type for writing " << filename << ": " << scalarType);
+        return PLUS_FAIL;
+      }
+      std::string extension = vtksys::SystemTools::LowerCase(vtksys::SystemTools::GetFilenameLastExtension(filename));
+      std::string dataFileName = "LOCAL";
+      std::string dataFilePath = filename;
+      if (extension == ".mhd")
+      {
+        dataFileName = vtksys::SystemTools::GetFilenameWithoutLastExtension(filename) + ".raw";
+        std::string directory = vtksys::SystemTools::GetFilenamePath(filename);
+        dataFilePath = directory.empty() ? dataFileName : directory + "/" + dataFileName;
+      }
+      else if (extension != ".mha")
+      {
+        LOG_ERROR("Out-of-core reconstruction can only write .mha or .mhd files: " << filename);
+        return PLUS_FAIL;
+      }
+
+      std::ostringstream header;
+      header << std::setprecision(std::numeric_limits<double>::max_digits10);
+      header << "ObjectType = Image\n";
+      header << "NDims = 3\n";
+      header << "BinaryData = True\n";
+#ifdef VTK_WORDS_BIGENDIAN
+      header << "BinaryDataByteOrderMSB = True\n";
+#else
+      header << "BinaryDataByteOrderMSB = False\n";
+#endif
+      header << "CompressedData = False\n";
+      header << "TransformMatrix = 1 0 0 0 1 0 0 0 1\n";
+      header << "Offset = " << origin[0] << " " << origin[1] << " " << origin[2] << "\n";
+      header << "CenterOfRotation = 0 0 0\n";
+      header << "ElementSpacing = " << spacing[0] << " " << spacing[1] << " " << spacing[2] << "\n";
+      header << "DimSize = " << dimensions[0] << " " << dimensions[1] << " " << dimensions[2] << "\n";
+      if (numberOfComponents > 1)
+      {
+        header << "ElementNumberOfChannels = " << numberOfComponents << "\n";
+      }
+      for (size_t i = 0; i < customFields.size() && i < customValues.size(); ++i)
+      {
+        header << customFields[i] << " = " << customValues[i] << "\n";
+      }
+      header << "ElementType = " << elementType << "\n";
+      header << "ElementDataFile = " << dataFileName << "\n";
+
+      // The header is followed by the voxel data in .mha files
+      std::ofstream headerOutput(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      headerOutput << header.str();
+      if (!headerOutput.good())
+      {
+        LOG_ERROR("Failed to write " << filename);
+        return PLUS_FAIL;
+      }
+      headerOutput.close();
+      this->DataFile.open(dataFilePath.c_str(), std::ios::out | std::ios::binary | (dataFilePath == filename ? std::ios::app : std::ios::trunc));
+      if (!this->DataFile.is_open())
+      {
+        LOG_ERROR("Failed to open " << dataFilePath << " for writing");
+        return PLUS_FAIL;
+      }
+
+      this->Filename = filename;
+      this->ScalarType = scalarType;
+      this->NumberOfComponents = numberOfComponents;
+      std::copy(dimensions, dimensions + 3, this->Dimensions);
+      this->NumberOfWrittenPlanes = 0;
+      return PLUS_SUCCESS;
+    }
+
+    //----------------------------------------------------------------------------
+    /*! Append the planes firstPlane..lastPlane (counted from the first plane of the image) to the file */
+    PlusStatus WritePlanes(vtkImageData* image, int firstPlane, int lastPlane)
+    {
+      int extent[6] = { 0, -1, 0, -1, 0, -1 };
+      image->GetExtent(extent);
+      if (extent[1] - extent[0] + 1 != this->Dimensions[0] || extent[3] - extent[2] + 1 != this->Dimensions[1] || firstPlane < 0 || lastPlane > extent[5] - extent[4]
+          || image->GetScalarType() != this->ScalarType || image->GetNumberOfScalarComponents() != this->NumberOfComponents)
+      {
+        LOG_ERROR("Reconstructed slab does not match the output volume " << this->Filename);
+        return PLUS_FAIL;
+      }
+      if (this->NumberOfWrittenPlanes + lastPlane - firstPlane + 1 > this->Dimensions[2])
+      {
+        LOG_ERROR("Too many planes are written into " << this->Filename);
+        return PLUS_FAIL;
+      }
+      const std::streamsize planeSizeBytes = static_cast<std::streamsize>(this->Dimensions[0]) * this->Dimensions[1] * image->GetScalarSize() * this->NumberOfComponents;
+      for (int plane = firstPlane; plane <= lastPlane; plane++)
+      {
+        this->DataFile.write(static_cast<const char*>(image->GetScalarPointer(extent[0], extent[2], extent[4] + plane)), planeSizeBytes);
+      }
+      this->NumberOfWrittenPlanes += lastPlane - firstPlane + 1;
+      if (!this->DataFile.good())
+      {
+        LOG_ERROR("Failed to write " << this->Filename);
+        return PLUS_FAIL;
+      }
+      return PLUS_SUCCESS;
+    }
+
+    //----------------------------------------------------------------------------
+    PlusStatus Close()
+    {
+      this->DataFile.close();
+      if (this->NumberOfWrittenPlanes != this->Dimensions[2])
+      {
+        LOG_ERROR("Incomplete volume is written into " << this->Filename << ": " << this->NumberOfWrittenPlanes << " of " << this->Dimensions[2] << " planes");
+        return PLUS_FAIL;
+      }
+      return PLUS_SUCCESS;
+    }
+
+  protected:
+    std::ofstream DataFile;
+    std::string Filename;
+    int ScalarType;
+    int NumberOfComponents;
+    int Dimensions[3];
+    int NumberOfWrittenPlanes;
+  };
+
+  //----------------------------------------------------------------------------
+  /*! Write planes firstZ..lastZ of the reconstructed slab that starts at plane slabFirstZ */
+  PlusStatus WriteSlab(vtkPlusVolumeReconstructor* reconstructor, bool accumulation, MetaImageVolumeWriter& writer, const std::string& filename,
+                       const int dimensions[3], const double spacing[3], const double origin[3], int slabFirstZ, int firstZ, int lastZ,
+                       const std::vector<std::string>& customFields, const std::vector<std::string>& customValues)
+  {
+    vtkSmartPointer<vtkImageData> slab = vtkSmartPointer<vtkImageData>::New();
+    PlusStatus extractStatus = accumulation ? reconstructor->ExtractAccumulation(slab) : reconstructor->ExtractGrayLevels(slab);
+    if (extractStatus != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to extract " << (accumulation ? "accumulation buffer" : "gray levels") << " of planes " << firstZ << "-" << lastZ);
+      return PLUS_FAIL;
+    }
+    if (!writer.IsOpen() && writer.Open(filename, dimensions, spacing, origin, slab->GetScalarType(), slab->GetNumberOfScalarComponents(), customFields, customValues) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    return writer.WritePlanes(slab, firstZ - slabFirstZ, lastZ - slabFirstZ);
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Reconstruct the volume in slabs (ranges of z planes) that fit into the memory budget.
+    The input is read one segment at a time to compute the output geometry. If the whole input fits into the memory budget
+    together with a slab then it is kept in memory, otherwise the segments that intersect a slab are read again for each slab,
+    which requires a segmented recording (.igs.manifest). Completed slabs are appended to the output file.
+    If the input and the whole volume fit into the memory budget and the number of planes per slab is not limited
+    then nothing is done and volumeFitsInMemory is set to true.
+    \param maxPlanesPerSlab Maximum number of planes in a slab (0 = limited by the memory budget only)
+  */
+  PlusStatus ReconstructOutOfCore(vtkPlusVolumeReconstructor* reconstructor, vtkIGSIOTransformRepository* transformRepository, const std::string& inputFileName,
+                                  const std::string& outputVolumeFileName, const std::string& outputVolumeAccumulationFileName, double maxMemoryMb, int maxPlanesPerSlab,
+                                  const std::vector<std::string>& customHeaderFields, bool& volumeFitsInMemory)
+  {
+    volumeFitsInMemory = false;
+    const double memoryBudgetBytes = maxMemoryMb * BYTES_PER_MEGABYTE;
+
+    std::vector<std::string> segmentPaths;
+    bool segmentedInput = false;
+    if (vtkPlusSequenceManifest::CanReadFile(inputFileName))
+    {
+      if (vtkPlusSequenceManifest::GetReadableSegments(inputFileName, segmentPaths) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to read input sequence manifest: " << inputFileName);
+        return PLUS_FAIL;
+      }
+      segmentedInput = true;
+    }
+    else
+    {
+      // A single sequence file cannot be read partially, so it is one segment. The image data is at least as large as the
+      // file (unless compressed), so a file that is larger than the memory budget is rejected without reading it.
+      const double fileSizeBytes = static_cast<double>(vtksys::SystemTools::FileLength(inputFileName));
+      if (fileSizeBytes > memoryBudgetBytes)
+      {
+        LOG_ERROR("Input sequence " << inputFileName << " (" << std::ceil(fileSizeBytes / BYTES_PER_MEGABYTE) << " MB) does not fit into " << maxMemoryMb
+                  << " MB. Increase --max-memory-mb or record the sequence in segments (.igs.manifest) so that it can be read one segment at a time.");
+        return PLUS_FAIL;
+      }
+      segmentPaths.push_back(inputFileName);
+    }
+
+    // Compute the output volume geometry from all the frames, the same way as SetOutputExtentFromFrameList does for in-memory reconstruction
+    LOG_INFO("Compute volume output extent from " << segmentPaths.size() << " input segment(s)...");
+    std::vector<InputSegment> segments;
+    double bounds[6] = { 0 };
+    InitializeBounds(bounds);
+    int scalarType = VTK_VOID;
+    int numberOfFrames = 0;
+    double inputMemorySizeBytes = 0.0;
+    double maxSegmentMemorySizeBytes = 0.0;
+    bool keepInputInMemory = true;
+    std::vector<std::string> customHeaderValues;
+    for (size_t segmentIndex = 0; segmentIndex < segmentPaths.size(); ++segmentIndex)
+    {
+      vtkSmartPointer<vtkIGSIOTrackedFrameList> segmentFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+      if (vtkPlusSequenceIO::Read(segmentPaths[segmentIndex], segmentFrameList) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to load input sequence file: " << segmentPaths[segmentIndex]);
+        return PLUS_FAIL;
+      }
+      InputSegment segment;
+      segment.Path = segmentPaths[segmentIndex];
+      segment.FirstFrameIndex = numberOfFrames;
+      segment.NumberOfFrames = segmentFrameList->GetNumberOfTrackedFrames();
+      segment.MemorySizeBytes = 0.0;
+      InitializeBounds(segment.ReferenceBounds);
+      for (int frameIndex = 0; frameIndex < segment.NumberOfFrames; ++frameIndex)
+      {
+        igsioTrackedFrame* frame = segmentFrameList->GetTrackedFrame(frameIndex);
+        vtkImageData* frameImage = frame->GetImageData()->GetImage();
+        if (frameImage == NULL || frameImage->GetScalarPointer() == NULL)
+        {
+          continue;
+        }
+        segment.MemorySizeBytes += frameImage->GetActualMemorySize() * 1024.0;
+        if (scalarType == VTK_VOID)
+        {
+          scalarType = frameImage->GetScalarType();
+        }
+        if (reconstructor->ExpandOutputBoundsWithFrame(frame, transformRepository, segment.ReferenceBounds) != PLUS_SUCCESS)
+        {
+          LOG_WARNING("Frame #" << segment.FirstFrameIndex + frameIndex << " is not used for computing the output extent");
+        }
+      }
+      for (int axis = 0; axis < 3; axis++)
+      {
+        bounds[2 * axis] = std::min(bounds[2 * axis], segment.ReferenceBounds[2 * axis]);
+        bounds[2 * axis + 1] = std::max(bounds[2 * axis + 1], segment.ReferenceBounds[2 * axis + 1]);
+      }
+      if (segmentIndex == 0)
+      {
+        for (size_t i = 0; i < customHeaderFields.size(); ++i)
+        {
+          const char* fieldValue = segmentFrameList->GetCustomString(customHeaderFields[i]);
+          customHeaderValues.push_back(fieldValue != NULL ? fieldValue : "");
+        }
+      }
+      numberOfFrames += segment.NumberOfFrames;
+      inputMemorySizeBytes += segment.MemorySizeBytes;
+      maxSegmentMemorySizeBytes = std::max(maxSegmentMemorySizeBytes, segment.MemorySizeBytes);
+      if (keepInputInMemory && inputMemorySizeBytes > memoryBudgetBytes)
+      {
+        // The input does not fit into memory, segments are read again for each slab
+        keepInputInMemory = false;
+        for (std::vector<InputSegment>::iterator segmentIt = segments.begin(); segmentIt != segments.end(); ++segmentIt)
+        {
+          segmentIt->FrameList = NULL;
+        }
+      }
+      if (keepInputInMemory)
+      {
+        segment.FrameList = segmentFrameList;
+      }
+      segments.push_back(segment);
+    }
+    if (bounds[0] > bounds[1] || scalarType == VTK_VOID)
+    {
+      LOG_ERROR("Failed to set output extent of volume: no frames with valid image to reference transform");
+      return PLUS_FAIL;
+    }
+
+    double origin[3] = { 0, 0, 0 };
+    double spacing[3] = { 1, 1, 1 };
+    int extent[6] = { 0, -1, 0, -1, 0, -1 };
+    reconstructor->GetOutputGeometryFromBounds(bounds, origin, spacing, extent);
+    const int dimensions[3] = { extent[1] - extent[0] + 1, extent[3] - extent[2] + 1, extent[5] - extent[4] + 1 };
+
+    // Pasted volume (value and alpha), accumulation buffer, extracted gray levels and hole filling output, extracted accumulation
+    const int scalarSize = vtkDataArray::GetDataTypeSize(scalarType);
+    const double bytesPerVoxel = 4.0 * scalarSize + sizeof(unsigned short) + (outputVolumeAccumulationFileName.empty() ? 0 : sizeof(unsigned short));
+    const double planeMemorySizeBytes = bytesPerVoxel * dimensions[0] * dimensions[1];
+    if (maxPlanesPerSlab <= 0 && inputMemorySizeBytes + planeMemorySizeBytes * dimensions[2] <= memoryBudgetBytes)
+    {
+      volumeFitsInMemory = true;
+      return PLUS_SUCCESS;
+    }
+
+    // Slabs are reconstructed with a margin that is cropped when the slab is written, as interpolation distributes a pixel
+    // to the neighbor planes and hole filling reads the neighborhood of a voxel
+    int slabMargin = 1;
+    if (reconstructor->GetFillHoles())
+    {
+      // The kernel radius includes one more voxel for rounding
+      slabMargin = reconstructor->GetHoleFillingKernelRadius();
+      if (slabMargin < 0)
+      {
+        LOG_ERROR("Out-of-core reconstruction with hole filling requires hole filling elements with Size or StickLengthLimit attribute");
+        return PLUS_FAIL;
+      }
+      slabMargin = std::max(slabMargin, 1);
+    }
+    const double minimumSlabMemorySizeBytes = planeMemorySizeBytes * (1 + 2 * slabMargin);
+    if (keepInputInMemory && inputMemorySizeBytes + minimumSlabMemorySizeBytes > memoryBudgetBytes)
+    {
+      keepInputInMemory = false;
+      for (std::vector<InputSegment>::iterator segmentIt = segments.begin(); segmentIt != segments.end(); ++segmentIt)
+      {
+        segmentIt->FrameList = NULL;
+      }
+    }
+    if (!keepInputInMemory && !segmentedInput)
+    {
+      LOG_ERROR("Input sequence " << inputFileName << " (" << std::ceil(inputMemorySizeBytes / BYTES_PER_MEGABYTE) << " MB) and a slab of the volume do not fit into "
+                << maxMemoryMb << " MB. At least " << std::ceil((inputMemorySizeBytes + minimumSlabMemorySizeBytes) / BYTES_PER_MEGABYTE)
+                << " MB is needed, or record the sequence in segments (.igs.manifest) so that it can be read one segment at a time.");
+      return PLUS_FAIL;
+    }
+    const double inputInMemorySizeBytes = keepInputInMemory ? inputMemorySizeBytes : maxSegmentMemorySizeBytes;
+    int planesPerSlab = std::min(static_cast<int>((memoryBudgetBytes - inputInMemorySizeBytes) / planeMemorySizeBytes) - 2 * slabMargin, dimensions[2]);
+    if (maxPlanesPerSlab > 0)
+    {
+      planesPerSlab = std::min(planesPerSlab, maxPlanesPerSlab);
+    }
+    if (planesPerSlab < 1)
+    {
+      LOG_ERROR("Memory budget of " << maxMemoryMb << " MB is too small for out-of-core reconstruction, at least "
+                << std::ceil((inputInMemorySizeBytes + minimumSlabMemorySizeBytes) / BYTES_PER_MEGABYTE) << " MB is needed");
+      return PLUS_FAIL;
+    }
+    const int numberOfSlabs = (dimensions[2] + planesPerSlab - 1) / planesPerSlab;
+    LOG_INFO("Reconstruct " << dimensions[0] << "x" << dimensions[1] << "x" << dimensions[2] << " volume out-of-core in " << numberOfSlabs << " slabs of " << planesPerSlab << " planes"
+             << (keepInputInMemory ? "..." : ", reading the input segments for each slab..."));
+
+    // Automatically detected fan angles may depend on the previously inserted frames, so then every frame is inserted into
+    // each slab in the same order as in memory (frames outside the slab do not modify any voxel)
+    const bool insertAllFrames = reconstructor->GetEnableFanAnglesAutoDetect();
+    if (insertAllFrames)
+    {
+      LOG_INFO("Fan angles are detected automatically, all frames are inserted into each slab");
+    }
+
+    MetaImageVolumeWriter volumeWriter;
+    MetaImageVolumeWriter accumulationWriter;
+    const int skipInterval = std::max(reconstructor->GetSkipInterval(), 1);
+    std::vector<char> frameInserted(numberOfFrames, 0);
+    for (int slabIndex = 0; slabIndex < numberOfSlabs; ++slabIndex)
+    {
+      vtkPlusLogger::PrintProgressbar((100.0 * slabIndex) / numberOfSlabs);
+      const int firstZ = extent[4] + slabIndex * planesPerSlab;
+      const int lastZ = std::min(firstZ + planesPerSlab - 1, extent[5]);
+      const int slabExtent[6] = { extent[0], extent[1], extent[2], extent[3], std::max(firstZ - slabMargin, extent[4]), std::min(lastZ + slabMargin, extent[5]) };
+      if (reconstructor->AllocateOutput(origin, slabExtent, scalarType) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+
+      for (std::vector<InputSegment>::const_iterator segmentIt = segments.begin(); segmentIt != segments.end(); ++segmentIt)
+      {
+        // One voxel margin, as interpolation distributes a pixel to the neighbor voxels
+        if (!insertAllFrames
+            && (segmentIt->ReferenceBounds[4] > segmentIt->ReferenceBounds[5]
+                || std::floor((segmentIt->ReferenceBounds[4] - origin[2]) / spacing[2]) - 1 > slabExtent[5]
+                || std::ceil((segmentIt->ReferenceBounds[5] - origin[2]) / spacing[2]) + 1 < slabExtent[4]))
+        {
+          continue;
+        }
+        vtkSmartPointer<vtkIGSIOTrackedFrameList> segmentFrameList = segmentIt->FrameList;
+        if (segmentFrameList == NULL)
+        {
+          segmentFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+          if (vtkPlusSequenceIO::Read(segmentIt->Path, segmentFrameList) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Unable to load input sequence file: " << segmentIt->Path);
+            return PLUS_FAIL;
+          }
+        }
+        // Frame indices are counted from the beginning of the whole sequence, so the same frames are skipped as in memory
+        int firstFrameIndexInSegment = (skipInterval - segmentIt->FirstFrameIndex % skipInterval) % skipInterval;
+        for (int frameIndexInSegment = firstFrameIndexInSegment; frameIndexInSegment < segmentFrameList->GetNumberOfTrackedFrames(); frameIndexInSegment += skipInterval)
+        {
+          const int frameIndex = segmentIt->FirstFrameIndex + frameIndexInSegment;
+          igsioTrackedFrame* frame = segmentFrameList->GetTrackedFrame(frameIndexInSegment);
+          if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
+            continue;
+          }
+          if (!insertAllFrames)
+          {
+            // Frames that do not intersect the slab would not modify any voxel
+            int frameExtent[6] = { 0, -1, 0, -1, 0, -1 };
+            if (reconstructor->GetFrameExtentInVolume(frame, transformRepository, frameExtent) != PLUS_SUCCESS
+                || frameExtent[0] > frameExtent[1] || frameExtent[2] > frameExtent[3] || frameExtent[4] > frameExtent[5])
+            {
+              continue;
+            }
+          }
+          bool insertedIntoVolume = false;
+          bool isFirst = frameIndex == 0;
+          bool isLast = frameIndex + skipInterval >= numberOfFrames;
+          if (reconstructor->AddTrackedFrame(frame, transformRepository, isFirst, isLast, &insertedIntoVolume) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
+            continue;
+          }
+          if (insertedIntoVolume)
+          {
+            frameInserted[frameIndex] = 1;
+          }
+        }
+      }
+
+      if (WriteSlab(reconstructor, false, volumeWriter, outputVolumeFileName, dimensions, spacing, origin, slabExtent[4], firstZ, lastZ, customHeaderFields, customHeaderValues) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      if (!outputVolumeAccumulationFileName.empty()
+          && WriteSlab(reconstructor, true, accumulationWriter, outputVolumeAccumulationFileName, dimensions, spacing, origin, slabExtent[4], firstZ, lastZ, customHeaderFields, customHeaderValues) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+    }
+    vtkPlusLogger::PrintProgressbar(100);
+
+    if (volumeWriter.Close() != PLUS_SUCCESS || (!outputVolumeAccumulationFileName.empty() && accumulationWriter.Close() != PLUS_SUCCESS))
+    {
+      return PLUS_FAIL;
+    }
+    LOG_INFO("Number of frames added to the volume: " << std::count(frameInserted.begin(), frameInserted.end(), 1) << " out of " << numberOfFrames);
+    return PLUS_SUCCESS;
+  }
+}
 
 int main(int argc, char* argv[])
 {
@@ -36,6 +537,8 @@ int main(int argc, char* argv[])
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   bool disableCompression = false;
+  int maxMemoryMb = 0;
+  int maxSlabPlanes = 0;
 
   std::vector<std::string> customHeaderFieldsToSave;
   std::vector<std::string> customHeaderValuesToSave;
@@ -54,6 +557,8 @@ int main(int argc, char* argv[])
   cmdargs.AddArgument("--save-custom-headers", vtksys::CommandLineArguments::MULTI_ARGUMENT, &customHeaderFieldsToSave, "List of custom header fields to pass into the output file.");
   cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
   cmdargs.AddArgument("--importance-mask-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &importanceMaskFileName, "The file to use as the importance mask.");
+  cmdargs.AddArgument("--max-memory-mb", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxMemoryMb, "Out-of-core mode: if the input frames and the output volume do not fit into this many megabytes of memory then the input is read one segment (.igs.manifest) or file at a time and the volume is reconstructed and written slab by slab into an uncompressed .mha/.mhd file (default: 0 = disabled).");
+  cmdargs.AddArgument("--max-slab-planes", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxSlabPlanes, "Out-of-core mode: maximum number of z planes in a slab. If specified then the volume is reconstructed slab by slab even if it fits into --max-memory-mb (default: 0 = limited by the memory budget only).");
 
   // Deprecated arguments (2013-07-29, #800)
   cmdargs.AddArgument("--transform", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputImageToReferenceTransformNameDeprecated, "Image to reference transform name used for the reconstruction. DEPRECATED, use --image-to-reference-transform argument instead");
@@ -151,16 +656,6 @@ int main(int argc, char* argv[])
   transformRepository->Print(osTransformRepo);
   LOG_DEBUG("Transform repository: \n" << osTransformRepo.str());
 
-  // Read image sequence
-  LOG_INFO("Reading image sequence " << inputImgSeqFileName);
-  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-  if (vtkIGSIOSequenceIO::Read(inputImgSeqFileName, trackedFrameList) != PLUS_SUCCESS)
-  {
-    LOG_ERROR("Unable to load input sequences file.");
-    exit(EXIT_FAILURE);
-  }
-
-  // Reconstruct volume
   igsioTransformName imageToReferenceTransformName;
   if (!inputImageToReferenceTransformName.empty())
   {
@@ -174,6 +669,37 @@ int main(int argc, char* argv[])
     reconstructor->SetReferenceCoordinateFrame(imageToReferenceTransformName.To());
   }
 
+  if (maxMemoryMb > 0)
+  {
+    bool volumeFitsInMemory = false;
+    if (ReconstructOutOfCore(reconstructor, transformRepository, inputImgSeqFileName, outputVolumeFileName, outputVolumeAccumulationFileName, maxMemoryMb, maxSlabPlanes,
+                             customHeaderFieldsToSave, volumeFitsInMemory) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Out-of-core volume reconstruction failed");
+      return EXIT_FAILURE;
+    }
+    if (!volumeFitsInMemory)
+    {
+      if (!outputFrameFileName.empty())
+      {
+        LOG_WARNING("The --output-frame-file argument is ignored in out-of-core reconstruction");
+      }
+      return EXIT_SUCCESS;
+    }
+    LOG_INFO("Input sequence and reconstructed volume fit into " << maxMemoryMb << " MB, reconstruct volume in memory");
+  }
+
+  // Read image sequence
+  LOG_INFO("Reading image sequence " << inputImgSeqFileName);
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkPlusSequenceIO::Read(inputImgSeqFileName, trackedFrameList, [](double fraction) { vtkPlusLogger::PrintProgressbar(100.0 * fraction); }) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to load input sequences file.");
+    exit(EXIT_FAILURE);
+  }
+
+  // Reconstruct volume
+
   LOG_INFO("Set volume output extent...");
   std::string errorDetail;
   if (reconstructor->SetOutputExtentFromFrameList(trackedFrameList, transformRepository, errorDetail) != PLUS_SUCCESS)
@@ -17,16 +17,29 @@
 
 #include "vtkPlusCompareVolumes.h"
 
+#include "PixelCodec.h"
 #include "igsioMath.h"
 
 #include "vtkImageData.h"
-#include "vtkImageProgressIterator.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkIGSIORecursiveCriticalSection.h"
+#include <algorithm>
+#include <limits>
 #include <vector>
-#include <list>
+
+// The SSE2 kernel is compiled for x86 regardless of the compiler flags and only used if PixelCodec reports SIMD support
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #include <emmintrin.h>
+  #define COMPAREVOLUMES_X86_SIMD
+  #define COMPAREVOLUMES_TARGET_SSE2
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #include <emmintrin.h>
+  #define COMPAREVOLUMES_X86_SIMD
+  #define COMPAREVOLUMES_TARGET_SSE2 __attribute__((target("sse2")))
+#endif
 
 static const int INPUT_GROUND_TRUTH_VOLUME = 0;
 static const int INPUT_GROUND_TRUTH_VOLUME_ALPHA = 1;
@@ -34,8 +47,243 @@ static const int INPUT_TEST_VOLUME = 2;
 static const int INPUT_TEST_VOLUME_ALPHA = 3;
 static const int INPUT_SLICES_VOLUME_ALPHA = 4;
 
+static const int OUTPUT_TRUE_DIFF_VOLUME = 0;
 static const int OUTPUT_ABS_DIFF_VOLUME = 1;
 
+// Bin of the true histogram that counts zero differences (bins cover -255..255)
+static const int TRUE_HISTOGRAM_OFFSET = 255;
+static const int TRUE_HISTOGRAM_SIZE = 511;
+static const int ABSOLUTE_HISTOGRAM_SIZE = 256;
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Counts and histograms of one piece of the volume, merged into the filter after the piece is processed */
+  struct DifferenceAccumulator
+  {
+    DifferenceAccumulator( bool collectDifferences )
+      : CollectDifferences( collectDifferences )
+      , NumberOfVisibleVoxels( 0 )
+      , NumberOfHoles( 0 )
+      , NumberOfFilledHoles( 0 )
+      , SumOfAbsoluteDifferencesInHoles( 0.0 )
+    {
+      std::fill( TrueHistogram, TrueHistogram + TRUE_HISTOGRAM_SIZE, 0 );
+      std::fill( AbsoluteHistogram, AbsoluteHistogram + ABSOLUTE_HISTOGRAM_SIZE, 0 );
+      std::fill( AbsoluteHistogramWithHoles, AbsoluteHistogramWithHoles + ABSOLUTE_HISTOGRAM_SIZE, 0 );
+    }
+
+    void AddHole( double difference, bool filled )
+    {
+      double absoluteDifference = fabs( difference );
+      NumberOfHoles++;
+      SumOfAbsoluteDifferencesInHoles += absoluteDifference;
+      AbsoluteHistogramWithHoles[GetBin( absoluteDifference, 0, ABSOLUTE_HISTOGRAM_SIZE )]++;
+      if ( !filled )
+      {
+        return;
+      }
+      NumberOfFilledHoles++;
+      TrueHistogram[GetBin( difference, TRUE_HISTOGRAM_OFFSET, TRUE_HISTOGRAM_SIZE )]++;
+      AbsoluteHistogram[GetBin( absoluteDifference, 0, ABSOLUTE_HISTOGRAM_SIZE )]++;
+      if ( CollectDifferences )
+      {
+        FilledHoleDifferences.push_back( difference );
+      }
+    }
+
+    // Differences of non 8-bit volumes may not fit in the histograms, they are counted in the first or last bin
+    static int GetBin( double value, int offset, int numberOfBins )
+    {
+      return std::min( std::max( igsioMath::Round( value ) + offset, 0 ), numberOfBins - 1 );
+    }
+
+    /*! Differences of 8-bit volumes are integers that fit in the histograms, all statistics are computed from those */
+    bool CollectDifferences;
+    vtkIdType NumberOfVisibleVoxels;
+    vtkIdType NumberOfHoles;
+    vtkIdType NumberOfFilledHoles;
+    double SumOfAbsoluteDifferencesInHoles;
+    int TrueHistogram[TRUE_HISTOGRAM_SIZE];
+    int AbsoluteHistogram[ABSOLUTE_HISTOGRAM_SIZE];
+    int AbsoluteHistogramWithHoles[ABSOLUTE_HISTOGRAM_SIZE];
+    std::vector<double> FilledHoleDifferences;
+  };
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  inline void CompareVoxel( T gt, T gtAlpha, T test, T testAlpha, T slicesAlpha, double& outTru, double& outAbs, DifferenceAccumulator& accumulator )
+  {
+    outTru = 0.0;
+    outAbs = 0.0;
+    if ( gtAlpha == 0 )
+    {
+      return;
+    }
+    accumulator.NumberOfVisibleVoxels++;
+    if ( slicesAlpha != 0 )
+    {
+      // not a hole, these voxels are not part of the comparison
+      return;
+    }
+    double difference = static_cast<double>( gt ) - test; // cast to double to minimize precision loss
+    bool filled = ( testAlpha != 0 );
+    accumulator.AddHole( difference, filled );
+    if ( filled )
+    {
+      outTru = difference;
+      outAbs = fabs( difference );
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  void CompareRowScalar( const T* gt, const T* gtAlpha, const T* test, const T* testAlpha, const T* slicesAlpha,
+                         double* outTru, double* outAbs, int firstVoxel, int lastVoxel, DifferenceAccumulator& accumulator )
+  {
+    for ( int x = firstVoxel; x < lastVoxel; x++ )
+    {
+      CompareVoxel( gt[x], gtAlpha[x], test[x], testAlpha[x], slicesAlpha[x], outTru[x], outAbs[x], accumulator );
+    }
+  }
+
+#ifdef COMPAREVOLUMES_X86_SIMD
+  //----------------------------------------------------------------------------
+  inline int CountBits( int mask )
+  {
+    int count = 0;
+    for ( ; mask != 0; mask &= mask - 1 )
+    {
+      count++;
+    }
+    return count;
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Compares 16 voxels at a time. Most voxels are either outside the ground truth or covered by a slice,
+    those blocks are only counted. In blocks that contain holes the differences are computed in SIMD
+    registers and only the histogram updates are done per voxel.
+  */
+  COMPAREVOLUMES_TARGET_SSE2 int CompareRow_SSE2( const unsigned char* gt, const unsigned char* gtAlpha, const unsigned char* test, const unsigned char* testAlpha, const unsigned char* slicesAlpha,
+      double* outTru, double* outAbs, int rowLength, DifferenceAccumulator& accumulator )
+  {
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for ( ; x + 16 <= rowLength; x += 16 )
+    {
+      std::fill( outTru + x, outTru + x + 16, 0.0 );
+      std::fill( outAbs + x, outAbs + x + 16, 0.0 );
+
+      __m128i hidden = _mm_cmpeq_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( gtAlpha + x ) ), zero );
+      __m128i notPasted = _mm_cmpeq_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( slicesAlpha + x ) ), zero );
+      accumulator.NumberOfVisibleVoxels += CountBits( ~_mm_movemask_epi8( hidden ) & 0xFFFF );
+      int holeMask = _mm_movemask_epi8( _mm_andnot_si128( hidden, notPasted ) );
+      if ( holeMask == 0 )
+      {
+        continue;
+      }
+
+      __m128i gtValues = _mm_loadu_si128( reinterpret_cast<const __m128i*>( gt + x ) );
+      __m128i testValues = _mm_loadu_si128( reinterpret_cast<const __m128i*>( test + x ) );
+      __m128i testAboveGt = _mm_subs_epu8( testValues, gtValues );
+      __m128i absoluteDifferences = _mm_or_si128( _mm_subs_epu8( gtValues, testValues ), testAboveGt );
+      int negativeMask = ~_mm_movemask_epi8( _mm_cmpeq_epi8( testAboveGt, zero ) ) & 0xFFFF;
+      int filledMask = ~_mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( testAlpha + x ) ), zero ) ) & holeMask;
+      unsigned char absoluteDifferenceValues[16];
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( absoluteDifferenceValues ), absoluteDifferences );
+
+      for ( int i = 0; i < 16; i++ )
+      {
+        if ( ( holeMask & ( 1 << i ) ) == 0 )
+        {
+          continue;
+        }
+        double absoluteDifference = absoluteDifferenceValues[i];
+        double difference = ( negativeMask & ( 1 << i ) ) ? -absoluteDifference : absoluteDifference;
+        bool filled = ( filledMask & ( 1 << i ) ) != 0;
+        accumulator.AddHole( difference, filled );
+        if ( filled )
+        {
+          outTru[x + i] = difference;
+          outAbs[x + i] = absoluteDifference;
+        }
+      }
+    }
+    return x;
+  }
+#endif
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  void CompareRow( const T* gt, const T* gtAlpha, const T* test, const T* testAlpha, const T* slicesAlpha,
+                   double* outTru, double* outAbs, int rowLength, DifferenceAccumulator& accumulator )
+  {
+    CompareRowScalar( gt, gtAlpha, test, testAlpha, slicesAlpha, outTru, outAbs, 0, rowLength, accumulator );
+  }
+
+  //----------------------------------------------------------------------------
+  void CompareRow( const unsigned char* gt, const unsigned char* gtAlpha, const unsigned char* test, const unsigned char* testAlpha, const unsigned char* slicesAlpha,
+                   double* outTru, double* outAbs, int rowLength, DifferenceAccumulator& accumulator )
+  {
+    int firstScalarVoxel = 0;
+#ifdef COMPAREVOLUMES_X86_SIMD
+    // Any SIMD instruction set reported by PixelCodec implies SSE2 support
+    if ( PixelCodec::GetInstructionSet() != PixelCodec::InstructionSet_Scalar )
+    {
+      firstScalarVoxel = CompareRow_SSE2( gt, gtAlpha, test, testAlpha, slicesAlpha, outTru, outAbs, rowLength, accumulator );
+    }
+#endif
+    CompareRowScalar( gt, gtAlpha, test, testAlpha, slicesAlpha, outTru, outAbs, firstScalarVoxel, rowLength, accumulator );
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Value at a fractional rank, linearly interpolated between the two closest ranks */
+  template <class ValueAtRankFunction>
+  double GetPercentile( int count, double percentile, ValueAtRankFunction valueAtRank )
+  {
+    double rank = ( count - 1 ) * percentile;
+    int floorRank = std::max( static_cast<int>( floor( rank ) ), 0 );
+    int ceilRank = std::min( static_cast<int>( ceil( rank ) ), count - 1 );
+    double fraction = rank - floor( rank );
+    return valueAtRank( floorRank ) * ( 1 - fraction ) + valueAtRank( ceilRank ) * fraction;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Value of the voxel at the given rank when the voxels are sorted by the value of their histogram bin */
+  double GetHistogramValueAtRank( const int* histogram, int numberOfBins, int offset, int rank )
+  {
+    int cumulativeCount = 0;
+    for ( int bin = 0; bin < numberOfBins; bin++ )
+    {
+      cumulativeCount += histogram[bin];
+      if ( rank < cumulativeCount )
+      {
+        return bin - offset;
+      }
+    }
+    return numberOfBins - 1 - offset;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Mean and standard deviation of the values of the histogram bins */
+  void GetHistogramMeanAndStdev( const int* histogram, int numberOfBins, int offset, int count, double& mean, double& stdev )
+  {
+    mean = 0.0;
+    for ( int bin = 0; bin < numberOfBins; bin++ )
+    {
+      mean += histogram[bin] * static_cast<double>( bin - offset );
+    }
+    mean /= count;
+    stdev = 0.0;
+    for ( int bin = 0; bin < numberOfBins; bin++ )
+    {
+      stdev += histogram[bin] * pow( bin - offset - mean, 2 );
+    }
+    stdev = sqrt( stdev / count );
+  }
+}
+
 vtkStandardNewMacro( vtkPlusCompareVolumes );
 
 //----------------------------------------------------------------------------
@@ -101,7 +349,7 @@ int* vtkPlusCompareVolumes::GetAbsoluteHistogramWithHolesPtr()
 //----------------------------------------------------------------------------
 void vtkPlusCompareVolumes::incTrueHistogramAtIndex( int value )
 {
-  int index = value + 256;
+  int index = value + TRUE_HISTOGRAM_OFFSET;
   TrueHistogram[index]++;
 }
 
@@ -122,7 +370,7 @@ void vtkPlusCompareVolumes::incAbsoluteHistogramWithHolesAtIndex( int value )
 //----------------------------------------------------------------------------
 void vtkPlusCompareVolumes::resetTrueHistogram()
 {
-  for ( int i = 0; i < 511; i++ )
+  for ( int i = 0; i < TRUE_HISTOGRAM_SIZE; i++ )
   {
     TrueHistogram[i] = 0;
   }
@@ -131,7 +379,7 @@ void vtkPlusCompareVolumes::resetTrueHistogram()
 //----------------------------------------------------------------------------
 void vtkPlusCompareVolumes::resetAbsoluteHistogram()
 {
-  for ( int i = 0; i < 256; i++ )
+  for ( int i = 0; i < ABSOLUTE_HISTOGRAM_SIZE; i++ )
   {
     AbsoluteHistogram[i] = 0;
   }
@@ -140,17 +388,26 @@ void vtkPlusCompareVolumes::resetAbsoluteHistogram()
 //----------------------------------------------------------------------------
 void vtkPlusCompareVolumes::resetAbsoluteHistogramWithHoles()
 {
-  for ( int i = 0; i < 256; i++ )
+  for ( int i = 0; i < ABSOLUTE_HISTOGRAM_SIZE; i++ )
   {
     AbsoluteHistogramWithHoles[i] = 0;
   }
 }
 
+//----------------------------------------------------------------------------
 vtkPlusCompareVolumes::vtkPlusCompareVolumes()
+  : FilledHoleDifferencesCollected( false )
+  , SumOfAbsoluteDifferencesInHoles( 0.0 )
+  , Mutex( vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New() )
 {
   this->SetNumberOfInputPorts( 5 );
   this->SetNumberOfOutputPorts( 2 );
-  this->SetNumberOfThreads( 1 ); // TODO: Remove when vtkPlusCompareVolumesExecute is made thread-safe (e.g., simultaneous access to member variables are protected by locking)
+  this->ResetStatistics();
+}
+
+//----------------------------------------------------------------------------
+vtkPlusCompareVolumes::~vtkPlusCompareVolumes()
+{
 }
 
 int vtkPlusCompareVolumes::RequestInformation (
@@ -167,9 +424,9 @@ int vtkPlusCompareVolumes::RequestInformation (
 }
 
 
+//----------------------------------------------------------------------------
 template <class T>
-void vtkPlusCompareVolumesExecute( vtkPlusCompareVolumes* self,
-                                   vtkImageData* inData,
+void vtkPlusCompareVolumesExecute( vtkImageData* inData,
                                    vtkImageData* outData,
                                    T* gtPtr,
                                    T* gtAlphaPtr,
@@ -179,259 +436,49 @@ void vtkPlusCompareVolumesExecute( vtkPlusCompareVolumes* self,
                                    double* outPtrTru,
                                    double* outPtrAbs,
                                    int outExt[6],
-                                   int id )
+                                   DifferenceAccumulator& accumulator )
 {
-
-  vtkIdType inOffsets[3] = {0}; //x,y,z
-  inData->GetIncrements( inOffsets[0], inOffsets[1], inOffsets[2] );
-
-  vtkIdType outOffsets[3] = {0}; //x,y,z
-  outData->GetIncrements( outOffsets[0], outOffsets[1], outOffsets[2] );
-
-  int xtemp( 0 ), ytemp( 0 ), ztemp( 0 ); // indices for each of the axes
-  self->resetTrueHistogram(); // count inside the class variables
-  self->resetAbsoluteHistogramWithHoles();
-  self->resetAbsoluteHistogram();
-  std::vector<double> trueDifferences; // store all differences here
-  std::vector<double> absoluteDifferences;
-
-  // same as absolute difference, but in hole voxels -
-  // this can be added to find the absolute error when
-  // we consider holes to be part of the image (and
-  // choose to not ignore them in the error computation)
-  // note these are not put into the histogram
-  std::vector<double> absoluteDifferencesInAllHoles;
-
-  int countVisibleVoxels( 0 );
-  int countFilledHoles( 0 );
-  int countHoles( 0 );
-
-  // iterate through all voxels
-  for ( ztemp = 0; ztemp <= outExt[5] - outExt[4]; ztemp++ )
-  {
-    for ( ytemp = 0; ytemp <= outExt[3] - outExt[2]; ytemp++ )
-    {
-      for ( xtemp = 0; xtemp <= outExt[1] - outExt[0]; xtemp++ )
-      {
-        int inIndex  =  inOffsets[0] * xtemp + inOffsets[1] * ytemp + inOffsets[2] * ztemp;
-        int outIndex = outOffsets[0] * xtemp + outOffsets[1] * ytemp + outOffsets[2] * ztemp;
-        if ( gtAlphaPtr[inIndex] != 0 )
-        {
-          countVisibleVoxels++;
-          if ( slicesAlphaPtr[inIndex] == 0 )
-          {
-            countHoles++;
-            double difference = ( double )gtPtr[inIndex] - testPtr[inIndex];
-            self->incAbsoluteHistogramWithHolesAtIndex( igsioMath::Round( fabs( difference ) ) );
-            absoluteDifferencesInAllHoles.push_back( fabs( difference ) );
-            if ( testAlphaPtr[inIndex] != 0 )
-            {
-              countFilledHoles++;
-              trueDifferences.push_back( difference );
-              self->incTrueHistogramAtIndex( igsioMath::Round( difference ) );
-              outPtrTru[outIndex] = difference; // cast to double to minimize precision loss
-              absoluteDifferences.push_back( fabs( difference ) );
-              self->incAbsoluteHistogramAtIndex( igsioMath::Round( fabs( difference ) ) );
-              outPtrAbs[outIndex] = fabs( difference );
-            }
-          }
-          else // not a hole, but these may still be different
-          {
-            //double difference = (double)gtPtr[inIndex] - testPtr[inIndex]; // cast to double to minimize precision loss
-            outPtrTru[outIndex] = 0.0; //difference;
-            outPtrAbs[outIndex] = 0.0; //abs(difference);
-          } // end slicesAlphaPtr check
-        }
-        else
-        {
-          outPtrTru[outIndex] = 0.0;
-          outPtrAbs[outIndex] = 0.0;
-        } // end gtAlphaPtr check
-      } // end x loop
-    } // end y loop
-  } // end z loop
-
-  double absoluteMeanWithHoles( 0.0 ); // include holes in this computation
-  // on this iteration, add only holes
-  for ( unsigned int i = 0; i < absoluteDifferencesInAllHoles.size(); i++ )
-  {
-    absoluteMeanWithHoles += absoluteDifferencesInAllHoles[i];
-  }
-
-  // mean calculations
-  double trueMean( 0.0 );
-  double absoluteMean( 0.0 ); // do not include holes in this computation
-  double rms( 0.0 );
-  for ( int i = 0; i < countFilledHoles; i++ )
-  {
-    trueMean += trueDifferences[i];
-    absoluteMean += absoluteDifferences[i];
-    rms += trueDifferences[i] * trueDifferences[i];
-  }
-
-  // divide by the number of filled holes
-  if ( countFilledHoles != 0 )
-  {
-    trueMean /= countFilledHoles;
-    absoluteMean /= countFilledHoles;
-    rms = sqrt( rms / countFilledHoles );
-  }
-  else
-  {
-    trueMean = 0;
-    absoluteMean = 0;
-    rms = 0;
-  }
-
-  // divide by the total number of holes
-  if ( countHoles != 0 )
-  {
-    absoluteMeanWithHoles /= countHoles;
-  }
-  else
-  {
-    absoluteMeanWithHoles = 0;
-  }
-
-  // stdev calculations
-  double trueStdev = 0.0;
-  double absoluteStdev = 0.0;
-  for ( int i = 0; i < countFilledHoles; i++ )
-  {
-    trueStdev += pow( ( trueDifferences[i] - trueMean ), 2 );
-    absoluteStdev += pow( ( absoluteDifferences[i] - absoluteMean ), 2 );
-  }
-  if ( countFilledHoles != 0 )
-  {
-    trueStdev = sqrt( trueStdev / countFilledHoles );
-    absoluteStdev = sqrt( absoluteStdev / countFilledHoles );
-  }
-  else
-  {
-    trueStdev = 0;
-    absoluteStdev = 0;
-  }
-
-  // need to sort, temporarily store in a list, sort, then assign back to vector <== THIS IS SLOW SLOW SLOW, as in about half a minute for this alone, so TODO: Make this faster
-  std::list<double> trueDifferencesList;
-  std::list<double> absoluteDifferencesList;
-  for ( int i = 0; i < countFilledHoles; i++ )
-  {
-    trueDifferencesList.push_front( trueDifferences.back() );
-    trueDifferences.pop_back();
-    absoluteDifferencesList.push_front( absoluteDifferences.back() );
-    absoluteDifferences.pop_back();
-  }
-  trueDifferencesList.sort();
-  absoluteDifferencesList.sort();
-  for ( int i = 0; i < countFilledHoles; i++ )
-  {
-    trueDifferences.push_back( trueDifferencesList.front() );
-    trueDifferencesList.pop_front();
-    absoluteDifferences.push_back( absoluteDifferencesList.front() );
-    absoluteDifferencesList.pop_front();
-  }
-
-  double true5thPercentile( 0.0 );
-  double true95thPercentile( 0.0 );
-  double absolute5thPercentile( 0.0 );
-  double absolute95thPercentile( 0.0 );
-  double absoluteMedian( 0.0 );
-  double trueMedian( 0.0 );
-  double trueMinimum( 0.0 );
-  double trueMaximum( 0.0 );
-  double absoluteMinimum( 0.0 );
-  double absoluteMaximum( 0.0 );
-
-  if ( countFilledHoles != 0 )
+  // all inputs have the same extent and a single component, so they share the increments
+  vtkIdType inIncX( 0 ), inIncY( 0 ), inIncZ( 0 );
+  inData->GetContinuousIncrements( outExt, inIncX, inIncY, inIncZ );
+  vtkIdType outIncX( 0 ), outIncY( 0 ), outIncZ( 0 );
+  outData->GetContinuousIncrements( outExt, outIncX, outIncY, outIncZ );
+
+  int rowLength = outExt[1] - outExt[0] + 1;
+  vtkIdType inOffset = 0;
+  vtkIdType outOffset = 0;
+  for ( int z = outExt[4]; z <= outExt[5]; z++ )
   {
-    trueMinimum = trueDifferences[0];
-    trueMaximum = trueDifferences[countFilledHoles - 1];
-    absoluteMinimum = absoluteDifferences[0];
-    absoluteMaximum = absoluteDifferences[countFilledHoles - 1];
-
-    // old median calculation
-    //double trueMedian = (countFilledHoles%2==0)?(trueDifferences[countFilledHoles/2]+trueDifferences[(countFilledHoles/2)-1])/2.0:trueDifferences[(countFilledHoles-1)/2];
-    //double absoluteMedian = (countFilledHoles%2==0)?(absoluteDifferences[countFilledHoles/2]+absoluteDifferences[(countFilledHoles/2)-1])/2.0:absoluteDifferences[(countFilledHoles-1)/2];
-
-    double medianRank = ( countFilledHoles - 1 ) * 0.5;
-    double medianFraction = fmod( medianRank, 1.0 );
-    int medianFloor = ( int )floor( medianRank );
-    if ( medianFloor < 0 )
-    {
-      medianFloor = 0;
-    }
-    int medianCeil = ( int )ceil( medianRank );
-    if ( medianCeil > ( countFilledHoles - 1 ) )
-    {
-      medianCeil = ( countFilledHoles - 1 );
-    }
-    trueMedian = trueDifferences[medianFloor] * ( 1 - medianFraction ) + trueDifferences[medianCeil] * medianFraction;
-    absoluteMedian = absoluteDifferences[medianFloor] * ( 1 - medianFraction ) + absoluteDifferences[medianCeil] * medianFraction;
-
-    double percentile5rank = ( countFilledHoles - 1 ) * 0.05;
-    double percentile5fraction = fmod( percentile5rank, 1.0 );
-    int percentile5floor = ( int )floor( percentile5rank );
-    if ( percentile5floor < 0 )
-    {
-      percentile5floor = 0;
-    }
-    int percentile5ceil = ( int )ceil( percentile5rank );
-    if ( percentile5ceil > ( countFilledHoles - 1 ) )
-    {
-      percentile5ceil = ( countFilledHoles - 1 );
-    }
-    true5thPercentile = trueDifferences[percentile5floor] * ( 1 - percentile5fraction ) + trueDifferences[percentile5ceil] * percentile5fraction;
-    absolute5thPercentile = absoluteDifferences[percentile5floor] * ( 1 - percentile5fraction ) + absoluteDifferences[percentile5ceil] * percentile5fraction;
-
-    double percentile95rank = ( countFilledHoles - 1 ) * 0.95;
-    double percentile95fraction = fmod( percentile95rank, 1.0 );
-    int percentile95floor = ( int )floor( percentile95rank );
-    if ( percentile95floor < 0 )
+    for ( int y = outExt[2]; y <= outExt[3]; y++ )
     {
-      percentile95floor = 0;
+      CompareRow( gtPtr + inOffset, gtAlphaPtr + inOffset, testPtr + inOffset, testAlphaPtr + inOffset, slicesAlphaPtr + inOffset,
+                  outPtrTru + outOffset, outPtrAbs + outOffset, rowLength, accumulator );
+      inOffset += rowLength + inIncY;
+      outOffset += rowLength + outIncY;
     }
-    int percentile95ceil = ( int )ceil( percentile95rank );
-    if ( percentile95ceil > ( countFilledHoles - 1 ) )
-    {
-      percentile95ceil = ( countFilledHoles - 1 );
-    }
-    true95thPercentile = trueDifferences[percentile95floor] * ( 1 - percentile95fraction ) + trueDifferences[percentile95ceil] * percentile95fraction;
-    absolute95thPercentile = absoluteDifferences[percentile95floor] * ( 1 - percentile95fraction ) + absoluteDifferences[percentile95ceil] * percentile95fraction;
+    inOffset += inIncZ;
+    outOffset += outIncZ;
   }
+}
 
-  self->SetNumberOfHoles( countHoles );
-  self->SetNumberVoxelsVisible( countVisibleVoxels );
-  self->SetNumberOfFilledHoles( countFilledHoles );
-
-  self->SetTrue95thPercentile( true95thPercentile );
-  self->SetTrue5thPercentile( true5thPercentile );
-  self->SetTrueMaximum( trueMaximum );
-  self->SetTrueMinimum( trueMinimum );
-  self->SetTrueMedian( trueMedian );
-  self->SetTrueStdev( trueStdev );
-  self->SetTrueMean( trueMean );
-
-  self->SetAbsolute95thPercentile( absolute95thPercentile );
-  self->SetAbsolute5thPercentile( absolute5thPercentile );
-  self->SetAbsoluteMaximum( absoluteMaximum );
-  self->SetAbsoluteMinimum( absoluteMinimum );
-  self->SetAbsoluteMedian( absoluteMedian );
-  self->SetAbsoluteStdev( absoluteStdev );
-  self->SetAbsoluteMean( absoluteMean );
-
-  self->SetAbsoluteMeanWithHoles( absoluteMeanWithHoles );
-
-  self->SetRMS( rms );
+//----------------------------------------------------------------------------
+int vtkPlusCompareVolumes::RequestData( vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector )
+{
+  // Pieces of the volume are compared in parallel, their results are merged in ThreadedRequestData
+  this->ResetStatistics();
+  int result = this->Superclass::RequestData( request, inputVector, outputVector );
+  this->ComputeStatistics();
+  return result;
 }
 
+//----------------------------------------------------------------------------
 void vtkPlusCompareVolumes::ThreadedRequestData (
   vtkInformation* vtkNotUsed( request ),
   vtkInformationVector** vtkNotUsed( inputVector ),
   vtkInformationVector* vtkNotUsed( outputVector ),
   vtkImageData** *inData,
   vtkImageData** outData,
-  int outExt[6], int threadId )
+  int outExt[6], int vtkNotUsed( threadId ) )
 {
   if ( inData[INPUT_GROUND_TRUTH_VOLUME][0] == NULL
        || inData[INPUT_GROUND_TRUTH_VOLUME_ALPHA][0] == NULL
@@ -454,30 +501,167 @@ void vtkPlusCompareVolumes::ThreadedRequestData (
     return;
   }
 
-  vtkImageData* gtVolData = inData[INPUT_GROUND_TRUTH_VOLUME][0];
-  void* gtPtr = gtVolData->GetScalarPointer();
-  void* gtAlphaPtr = inData[INPUT_GROUND_TRUTH_VOLUME_ALPHA][0]->GetScalarPointer();
-  void* testPtr = inData[INPUT_TEST_VOLUME][0]->GetScalarPointer();
-  void* testAlphaPtr = inData[INPUT_TEST_VOLUME_ALPHA][0]->GetScalarPointer();
-  void* slicesAlphaPtr = inData[INPUT_SLICES_VOLUME_ALPHA][0]->GetScalarPointer();
-
-  vtkImageData* outVolDataTru = inData[INPUT_GROUND_TRUTH_VOLUME][0];
-  double* outPtrTru = static_cast< double* >( outVolDataTru->GetScalarPointer() );
-  double* outPtrAbs = static_cast< double* >( outData[OUTPUT_ABS_DIFF_VOLUME]->GetScalarPointer() );
+  for ( int input = INPUT_GROUND_TRUTH_VOLUME; input <= INPUT_SLICES_VOLUME_ALPHA; input++ )
+  {
+    int* inExt = inData[input][0]->GetExtent();
+    int* gtExt = inData[INPUT_GROUND_TRUTH_VOLUME][0]->GetExtent();
+    if ( inData[input][0]->GetNumberOfScalarComponents() != 1
+         || inExt[0] != gtExt[0] || inExt[1] != gtExt[1] || inExt[2] != gtExt[2] || inExt[3] != gtExt[3] || inExt[4] != gtExt[4] || inExt[5] != gtExt[5] )
+    {
+      vtkErrorMacro( << "Execute: all inputs must have a single scalar component and the same extent" );
+      return;
+    }
+  }
 
-  switch ( gtVolData->GetScalarType() )
+  vtkImageData* gtVolData = inData[INPUT_GROUND_TRUTH_VOLUME][0];
+  void* gtPtr = gtVolData->GetScalarPointerForExtent( outExt );
+  void* gtAlphaPtr = inData[INPUT_GROUND_TRUTH_VOLUME_ALPHA][0]->GetScalarPointerForExtent( outExt );
+  void* testPtr = inData[INPUT_TEST_VOLUME][0]->GetScalarPointerForExtent( outExt );
+  void* testAlphaPtr = inData[INPUT_TEST_VOLUME_ALPHA][0]->GetScalarPointerForExtent( outExt );
+  void* slicesAlphaPtr = inData[INPUT_SLICES_VOLUME_ALPHA][0]->GetScalarPointerForExtent( outExt );
+
+  vtkImageData* outVolDataTru = outData[OUTPUT_TRUE_DIFF_VOLUME];
+  double* outPtrTru = static_cast< double* >( outVolDataTru->GetScalarPointerForExtent( outExt ) );
+  double* outPtrAbs = static_cast< double* >( outData[OUTPUT_ABS_DIFF_VOLUME]->GetScalarPointerForExtent( outExt ) );
+
+  int scalarType = gtVolData->GetScalarType();
+  bool histogramsAreExact = ( scalarType == VTK_UNSIGNED_CHAR || scalarType == VTK_CHAR || scalarType == VTK_SIGNED_CHAR );
+  DifferenceAccumulator accumulator( !histogramsAreExact );
+  switch ( scalarType )
   {
     vtkTemplateMacro(
-      vtkPlusCompareVolumesExecute( this, gtVolData, outVolDataTru,
+      vtkPlusCompareVolumesExecute( gtVolData, outVolDataTru,
                                     static_cast<VTK_TT*>( gtPtr ),   static_cast<VTK_TT*>( gtAlphaPtr ),
                                     static_cast<VTK_TT*>( testPtr ), static_cast<VTK_TT*>( testAlphaPtr ),
                                     static_cast<VTK_TT*>( slicesAlphaPtr ),
-                                    outPtrTru, outPtrAbs, outExt, threadId )
+                                    outPtrTru, outPtrAbs, outExt, accumulator )
     );
   default:
     vtkErrorMacro( << "Execute: Unknown ScalarType" );
     return;
   }
+
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> mergeGuardedLock( this->Mutex );
+  this->NumberVoxelsVisible += static_cast<int>( accumulator.NumberOfVisibleVoxels );
+  this->NumberOfHoles += static_cast<int>( accumulator.NumberOfHoles );
+  this->NumberOfFilledHoles += static_cast<int>( accumulator.NumberOfFilledHoles );
+  this->SumOfAbsoluteDifferencesInHoles += accumulator.SumOfAbsoluteDifferencesInHoles;
+  for ( int i = 0; i < TRUE_HISTOGRAM_SIZE; i++ )
+  {
+    this->TrueHistogram[i] += accumulator.TrueHistogram[i];
+  }
+  for ( int i = 0; i < ABSOLUTE_HISTOGRAM_SIZE; i++ )
+  {
+    this->AbsoluteHistogram[i] += accumulator.AbsoluteHistogram[i];
+    this->AbsoluteHistogramWithHoles[i] += accumulator.AbsoluteHistogramWithHoles[i];
+  }
+  this->FilledHoleDifferencesCollected = accumulator.CollectDifferences;
+  this->FilledHoleDifferences.insert( this->FilledHoleDifferences.end(), accumulator.FilledHoleDifferences.begin(), accumulator.FilledHoleDifferences.end() );
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCompareVolumes::ResetStatistics()
+{
+  this->resetTrueHistogram();
+  this->resetAbsoluteHistogram();
+  this->resetAbsoluteHistogramWithHoles();
+  this->NumberVoxelsVisible = 0;
+  this->NumberOfHoles = 0;
+  this->NumberOfFilledHoles = 0;
+  this->SumOfAbsoluteDifferencesInHoles = 0.0;
+  this->FilledHoleDifferencesCollected = false;
+  this->FilledHoleDifferences.clear();
+
+  this->RMS = 0.0;
+  this->TrueMean = this->TrueStdev = this->TrueMedian = this->TrueMinimum = this->TrueMaximum = this->True95thPercentile = this->True5thPercentile = 0.0;
+  this->AbsoluteMean = this->AbsoluteStdev = this->AbsoluteMedian = this->AbsoluteMinimum = this->AbsoluteMaximum = this->Absolute95thPercentile = this->Absolute5thPercentile = 0.0;
+  this->AbsoluteMeanWithHoles = 0.0;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCompareVolumes::ComputeStatistics()
+{
+  // include holes that were not filled in this computation
+  this->AbsoluteMeanWithHoles = ( this->NumberOfHoles != 0 ) ? this->SumOfAbsoluteDifferencesInHoles / this->NumberOfHoles : 0.0;
+
+  int count = this->NumberOfFilledHoles;
+  if ( count == 0 )
+  {
+    return;
+  }
+
+  if ( !this->FilledHoleDifferencesCollected )
+  {
+    // 8-bit volumes: the histograms hold the exact differences, no need to sort the voxels
+    const int* trueHistogram = this->TrueHistogram;
+    const int* absoluteHistogram = this->AbsoluteHistogram;
+    GetHistogramMeanAndStdev( trueHistogram, TRUE_HISTOGRAM_SIZE, TRUE_HISTOGRAM_OFFSET, count, this->TrueMean, this->TrueStdev );
+    GetHistogramMeanAndStdev( absoluteHistogram, ABSOLUTE_HISTOGRAM_SIZE, 0, count, this->AbsoluteMean, this->AbsoluteStdev );
+    double sumOfSquares = 0.0;
+    for ( int bin = 0; bin < TRUE_HISTOGRAM_SIZE; bin++ )
+    {
+      sumOfSquares += trueHistogram[bin] * pow( static_cast<double>( bin - TRUE_HISTOGRAM_OFFSET ), 2 );
+    }
+    this->RMS = sqrt( sumOfSquares / count );
+
+    auto trueValueAtRank = [trueHistogram]( int rank ) { return GetHistogramValueAtRank( trueHistogram, TRUE_HISTOGRAM_SIZE, TRUE_HISTOGRAM_OFFSET, rank ); };
+    auto absoluteValueAtRank = [absoluteHistogram]( int rank ) { return GetHistogramValueAtRank( absoluteHistogram, ABSOLUTE_HISTOGRAM_SIZE, 0, rank ); };
+    this->TrueMinimum = trueValueAtRank( 0 );
+    this->TrueMaximum = trueValueAtRank( count - 1 );
+    this->TrueMedian = GetPercentile( count, 0.5, trueValueAtRank );
+    this->True5thPercentile = GetPercentile( count, 0.05, trueValueAtRank );
+    this->True95thPercentile = GetPercentile( count, 0.95, trueValueAtRank );
+    this->AbsoluteMinimum = absoluteValueAtRank( 0 );
+    this->AbsoluteMaximum = absoluteValueAtRank( count - 1 );
+    this->AbsoluteMedian = GetPercentile( count, 0.5, absoluteValueAtRank );
+    this->Absolute5thPercentile = GetPercentile( count, 0.05, absoluteValueAtRank );
+    this->Absolute95thPercentile = GetPercentile( count, 0.95, absoluteValueAtRank );
+    return;
+  }
+
+  std::vector<double>& trueDifferences = this->FilledHoleDifferences;
+  std::vector<double> absoluteDifferences( trueDifferences.size() );
+  double sumOfSquares = 0.0;
+  this->TrueMean = 0.0;
+  this->AbsoluteMean = 0.0;
+  for ( size_t i = 0; i < trueDifferences.size(); i++ )
+  {
+    absoluteDifferences[i] = fabs( trueDifferences[i] );
+    this->TrueMean += trueDifferences[i];
+    this->AbsoluteMean += absoluteDifferences[i];
+    sumOfSquares += trueDifferences[i] * trueDifferences[i];
+  }
+  this->TrueMean /= count;
+  this->AbsoluteMean /= count;
+  this->RMS = sqrt( sumOfSquares / count );
+
+  this->TrueStdev = 0.0;
+  this->AbsoluteStdev = 0.0;
+  for ( size_t i = 0; i < trueDifferences.size(); i++ )
+  {
+    this->TrueStdev += pow( trueDifferences[i] - this->TrueMean, 2 );
+    this->AbsoluteStdev += pow( absoluteDifferences[i] - this->AbsoluteMean, 2 );
+  }
+  this->TrueStdev = sqrt( this->TrueStdev / count );
+  this->AbsoluteStdev = sqrt( this->AbsoluteStdev / count );
+
+  std::sort( trueDifferences.begin(), trueDifferences.end() );
+  std::sort( absoluteDifferences.begin(), absoluteDifferences.end() );
+  auto trueValueAtRank = [&trueDifferences]( int rank ) { return trueDifferences[rank]; };
+  auto absoluteValueAtRank = [&absoluteDifferences]( int rank ) { return absoluteDifferences[rank]; };
+  this->TrueMinimum = trueDifferences.front();
+  this->TrueMaximum = trueDifferences.back();
+  this->TrueMedian = GetPercentile( count, 0.5, trueValueAtRank );
+  this->True5thPercentile = GetPercentile( count, 0.05, trueValueAtRank );
+  this->True95thPercentile = GetPercentile( count, 0.95, trueValueAtRank );
+  this->AbsoluteMinimum = absoluteDifferences.front();
+  this->AbsoluteMaximum = absoluteDifferences.back();
+  this->AbsoluteMedian = GetPercentile( count, 0.5, absoluteValueAtRank );
+  this->Absolute5thPercentile = GetPercentile( count, 0.05, absoluteValueAtRank );
+  this->Absolute95thPercentile = GetPercentile( count, 0.95, absoluteValueAtRank );
+
+  // the sorted differences are not needed anymore
+  std::vector<double>().swap( this->FilledHoleDifferences );
 }
 
 int vtkPlusCompareVolumes::FillInputPortInformation( int port, vtkInformation* info )
@@ -19,6 +19,8 @@
 //   - A ground truth alpha image: This is used together with the slices alpha image to identify hole voxels
 //   - A reconstructed "test" image
 //   - A slices alpha image: The alpha channel if the slices are only pasted into the volume without hole filling
+// The volume is split into pieces that are compared on multiple threads, the per-piece histograms and counts are merged
+// at the end. Statistics of 8-bit volumes are computed from the histograms, other types keep the filled hole differences.
 
 #ifndef __vtkPlusCompareVolumes_h
 #define __vtkPlusCompareVolumes_h
@@ -27,6 +29,8 @@
 #include "vtkThreadedImageAlgorithm.h"
 #include <vector>
 
+class vtkIGSIORecursiveCriticalSection;
+
 class vtkPlusCompareVolumes : public vtkThreadedImageAlgorithm
 {
 public:
@@ -112,7 +116,7 @@ public:
 
 protected:
   vtkPlusCompareVolumes();
-  ~vtkPlusCompareVolumes() {};
+  ~vtkPlusCompareVolumes();
 
   double RMS;
   double TrueMean,     TrueStdev,     TrueMedian,     TrueMinimum,     TrueMaximum,     True95thPercentile,     True5thPercentile;
@@ -125,8 +129,22 @@ protected:
   int NumberOfFilledHoles;
   int NumberVoxelsVisible;
 
+  // Description:
+  // Differences at the filled holes, only kept for volumes that are not 8-bit (their differences do not fit in the histograms)
+  bool FilledHoleDifferencesCollected;
+  std::vector<double> FilledHoleDifferences;
+  double SumOfAbsoluteDifferencesInHoles;
+
+  // Description:
+  // Protects the merging of the per-piece results
+  vtkSmartPointer<vtkIGSIORecursiveCriticalSection> Mutex;
+
   virtual int RequestInformation (vtkInformation *, vtkInformationVector**, vtkInformationVector *);
 
+  // Description:
+  // Resets the statistics, runs the threaded comparison, then computes the statistics from the merged results
+  virtual int RequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector);
+
   void ThreadedRequestData (vtkInformation* request,
                             vtkInformationVector** inputVector,
                             vtkInformationVector* outputVector,
@@ -135,6 +153,9 @@ protected:
 
   virtual int FillInputPortInformation(int port, vtkInformation* info);
 
+  void ResetStatistics();
+  void ComputeStatistics();
+
 
 private:
   vtkPlusCompareVolumes(const vtkPlusCompareVolumes&);  // Not implemented.
@@ -9,16 +9,296 @@
 #include "vtkPlusSequenceIO.h"
 #include "vtkPlusVolumeReconstructor.h"
 
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOPasteSliceIntoVolume.h>
+#include <vtkIGSIOTrackedFrameList.h>
+#include <vtkIGSIOTransformRepository.h>
+
 // VTK includes
+#include <vtkImageData.h>
 #include <vtkImageFlip.h>
+#include <vtkMatrix4x4.h>
 #include <vtkObjectFactory.h>
 #include <vtkPNGReader.h>
+#include <vtkXMLDataElement.h>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <new>
+
+namespace
+{
+  const unsigned int REPRODUCIBLE_FRAMES_PER_TILE = 8; // frames in a tile if the result must not depend on the number of threads
+  const unsigned int MAX_FRAMES_PER_TILE = 32; // limits the size of the tiles (and so the memory usage) for large batches
+  const double MAX_TILE_VOXELS = 16.0 * 1024 * 1024; // a tile is closed before its extent would exceed this many voxels
+  const unsigned int ACCUMULATION_MAXIMUM = 65535;
+
+  enum TileCompoundingMode
+  {
+    TILE_COMPOUNDING_MEAN,
+    TILE_COMPOUNDING_LATEST,
+    TILE_COMPOUNDING_MAXIMUM
+  };
+
+  //----------------------------------------------------------------------------
+  TileCompoundingMode GetTileCompoundingMode(vtkXMLDataElement* configElement)
+  {
+    vtkXMLDataElement* reconstructionElement = configElement->LookupElementWithName("VolumeReconstruction");
+    const char* compoundingMode = (reconstructionElement != NULL ? reconstructionElement : configElement)->GetAttribute("CompoundingMode");
+    if (compoundingMode != NULL && STRCASECMP(compoundingMode, "LATEST") == 0)
+    {
+      return TILE_COMPOUNDING_LATEST;
+    }
+    if (compoundingMode != NULL && STRCASECMP(compoundingMode, "MAXIMUM") == 0)
+    {
+      return TILE_COMPOUNDING_MAXIMUM;
+    }
+    // MEAN (default) and IMPORTANCE_MASK: voxel values are weighted averages, the accumulation buffer contains the sum of weights
+    return TILE_COMPOUNDING_MEAN;
+  }
+
+  //----------------------------------------------------------------------------
+  // Merge a row of voxels of a tile into the volume. The last component is alpha (non-zero where pixels were pasted).
+  template<class T>
+  void MergeTileRow(const T* tilePtr, const unsigned short* tileAccumulationPtr, T* volumePtr, unsigned short* volumeAccumulationPtr,
+                    int numberOfVoxels, int numberOfComponents, TileCompoundingMode compoundingMode)
+  {
+    const int alphaComponent = numberOfComponents - 1;
+    const int numberOfValueComponents = std::max(alphaComponent, 1);
+    for (int x = 0; x < numberOfVoxels; x++, tilePtr += numberOfComponents, volumePtr += numberOfComponents, tileAccumulationPtr++, volumeAccumulationPtr++)
+    {
+      const bool tileHasData = (*tileAccumulationPtr > 0) || (alphaComponent > 0 && tilePtr[alphaComponent] != 0);
+      if (!tileHasData)
+      {
+        continue;
+      }
+      const bool volumeHasData = (*volumeAccumulationPtr > 0) || (alphaComponent > 0 && volumePtr[alphaComponent] != 0);
+      if (!volumeHasData || compoundingMode == TILE_COMPOUNDING_LATEST || (compoundingMode == TILE_COMPOUNDING_MAXIMUM && tilePtr[0] > volumePtr[0]))
+      {
+        std::copy(tilePtr, tilePtr + numberOfComponents, volumePtr);
+      }
+      else if (compoundingMode == TILE_COMPOUNDING_MEAN && *tileAccumulationPtr > 0 && *volumeAccumulationPtr > 0)
+      {
+        const double volumeWeight = *volumeAccumulationPtr;
+        const double tileWeight = *tileAccumulationPtr;
+        for (int c = 0; c < numberOfValueComponents; c++)
+        {
+          double mean = (volumePtr[c] * volumeWeight + tilePtr[c] * tileWeight) / (volumeWeight + tileWeight);
+          volumePtr[c] = static_cast<T>(std::numeric_limits<T>::is_integer ? std::floor(mean + 0.5) : mean);
+        }
+        if (alphaComponent > 0)
+        {
+          volumePtr[alphaComponent] = std::max(volumePtr[alphaComponent], tilePtr[alphaComponent]);
+        }
+      }
+      *volumeAccumulationPtr = static_cast<unsigned short>(std::min<unsigned int>(static_cast<unsigned int>(*volumeAccumulationPtr) + *tileAccumulationPtr, ACCUMULATION_MAXIMUM));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Merge a tile into regionExtent of the volume, the tile has the same size as the region. Planes are merged in parallel.
+  template<class T>
+  void MergeTile(vtkImageData* tileVolume, vtkImageData* tileAccumulationBuffer, vtkImageData* volume, vtkImageData* accumulationBuffer,
+                 const int regionExtent[6], TileCompoundingMode compoundingMode, unsigned int numberOfThreads)
+  {
+    int volumeExtent[6] = { 0, -1, 0, -1, 0, -1 };
+    volume->GetExtent(volumeExtent);
+    int volumeDimensions[3] = { 0, 0, 0 };
+    volume->GetDimensions(volumeDimensions);
+    int tileDimensions[3] = { 0, 0, 0 };
+    tileVolume->GetDimensions(tileDimensions);
+    const int numberOfComponents = volume->GetNumberOfScalarComponents();
+    const T* tileBasePtr = static_cast<const T*>(tileVolume->GetScalarPointer());
+    const unsigned short* tileAccumulationBasePtr = static_cast<const unsigned short*>(tileAccumulationBuffer->GetScalarPointer());
+    T* volumeBasePtr = static_cast<T*>(volume->GetScalarPointer());
+    unsigned short* volumeAccumulationBasePtr = static_cast<unsigned short*>(accumulationBuffer->GetScalarPointer());
+    PlusCommon::ParallelFor(static_cast<unsigned int>(tileDimensions[2]), [&](unsigned int tileZ)
+    {
+      for (int tileY = 0; tileY < tileDimensions[1]; tileY++)
+      {
+        const size_t tileIndex = (static_cast<size_t>(tileZ) * tileDimensions[1] + tileY) * tileDimensions[0];
+        const size_t volumeIndex = (static_cast<size_t>(regionExtent[4] - volumeExtent[4] + tileZ) * volumeDimensions[1] + (regionExtent[2] - volumeExtent[2] + tileY)) * volumeDimensions[0]
+                                   + (regionExtent[0] - volumeExtent[0]);
+        MergeTileRow(tileBasePtr + tileIndex * numberOfComponents, tileAccumulationBasePtr + tileIndex,
+                     volumeBasePtr + volumeIndex * numberOfComponents, volumeAccumulationBasePtr + volumeIndex,
+                     tileDimensions[0], numberOfComponents, compoundingMode);
+      }
+    }, numberOfThreads);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Consecutive frames of a batch that are pasted together, Extent is the voxel extent that they may modify */
+  struct FrameTile
+  {
+    explicit FrameTile(unsigned int frameIndex)
+      : FirstFrameIndex(frameIndex)
+      , LastFrameIndex(frameIndex)
+    {
+      Extent = { { VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN } };
+    }
+    unsigned int FirstFrameIndex;
+    unsigned int LastFrameIndex;
+    PlusVolumeBrickGrid::ExtentType Extent;
+  };
+
+  //----------------------------------------------------------------------------
+  bool IsEmptyExtent(const PlusVolumeBrickGrid::ExtentType& extent)
+  {
+    return extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5];
+  }
+
+  //----------------------------------------------------------------------------
+  void ExpandExtent(PlusVolumeBrickGrid::ExtentType& extent, const PlusVolumeBrickGrid::ExtentType& otherExtent)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      extent[2 * i] = std::min(extent[2 * i], otherExtent[2 * i]);
+      extent[2 * i + 1] = std::max(extent[2 * i + 1], otherExtent[2 * i + 1]);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  double GetNumberOfVoxels(const PlusVolumeBrickGrid::ExtentType& extent)
+  {
+    return static_cast<double>(extent[1] - extent[0] + 1) * (extent[3] - extent[2] + 1) * (extent[5] - extent[4] + 1);
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsSameVoxelFormat(vtkImageData* volume1, vtkImageData* volume2)
+  {
+    return volume1->GetScalarType() == volume2->GetScalarType()
+           && volume1->GetNumberOfScalarComponents() == volume2->GetNumberOfScalarComponents()
+           && volume1->GetScalarPointer() != NULL && volume2->GetScalarPointer() != NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  bool HasDimensions(vtkImageData* volume, const int dimensions[3])
+  {
+    int volumeDimensions[3] = { 0, 0, 0 };
+    volume->GetDimensions(volumeDimensions);
+    return std::equal(dimensions, dimensions + 3, volumeDimensions);
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsSameVolumeGeometry(vtkImageData* volume1, vtkImageData* volume2)
+  {
+    int extent1[6] = { 0, -1, 0, -1, 0, -1 };
+    int extent2[6] = { 0, -1, 0, -1, 0, -1 };
+    volume1->GetExtent(extent1);
+    volume2->GetExtent(extent2);
+    double* spacing1 = volume1->GetSpacing();
+    double* spacing2 = volume2->GetSpacing();
+    double* origin1 = volume1->GetOrigin();
+    double* origin2 = volume2->GetOrigin();
+    for (int i = 0; i < 3; i++)
+    {
+      if (extent1[2 * i] != extent2[2 * i] || extent1[2 * i + 1] != extent2[2 * i + 1] || spacing1[i] != spacing2[i] || origin1[i] != origin2[i])
+      {
+        return false;
+      }
+    }
+    return IsSameVoxelFormat(volume1, volume2);
+  }
+
+  //----------------------------------------------------------------------------
+  // Copy the voxels of regionExtent (clamped to the source volume extent), source voxel (i,j,k) is copied to target voxel (i,j,k)+targetOffset.
+  // The two volumes must have the same scalar type and number of components and the target must contain the shifted region.
+  void CopyVolumeRegion(vtkImageData* source, vtkImageData* target, const PlusVolumeBrickGrid::ExtentType& regionExtent, const int targetOffset[3])
+  {
+    int extent[6] = { 0, -1, 0, -1, 0, -1 };
+    source->GetExtent(extent);
+    int copyExtent[6] = { 0, -1, 0, -1, 0, -1 };
+    for (int i = 0; i < 3; i++)
+    {
+      copyExtent[2 * i] = std::max(regionExtent[2 * i], extent[2 * i]);
+      copyExtent[2 * i + 1] = std::min(regionExtent[2 * i + 1], extent[2 * i + 1]);
+      if (copyExtent[2 * i] > copyExtent[2 * i + 1])
+      {
+        // empty region
+        return;
+      }
+    }
+    const size_t rowSizeInBytes = static_cast<size_t>(copyExtent[1] - copyExtent[0] + 1) * source->GetScalarSize() * source->GetNumberOfScalarComponents();
+    for (int z = copyExtent[4]; z <= copyExtent[5]; z++)
+    {
+      for (int y = copyExtent[2]; y <= copyExtent[3]; y++)
+      {
+        memcpy(target->GetScalarPointer(copyExtent[0] + targetOffset[0], y + targetOffset[1], z + targetOffset[2]), source->GetScalarPointer(copyExtent[0], y, z), rowSizeInBytes);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Compute the voxels of blockExtent of the downsampled volume. A downsampled voxel is the mean of the voxels with data in the
+  // corresponding factor x factor x factor block of the volume (0 if none of them has data). The last volume component is alpha.
+  template<class T>
+  void DownsampleVolumeBlocks(vtkImageData* volume, vtkImageData* accumulationBuffer, vtkImageData* downsampledVolume, const int blockExtent[6], int factor)
+  {
+    int volumeDimensions[3] = { 0, 0, 0 };
+    volume->GetDimensions(volumeDimensions);
+    const int numberOfComponents = volume->GetNumberOfScalarComponents();
+    const int alphaComponent = numberOfComponents - 1;
+    const int numberOfValueComponents = downsampledVolume->GetNumberOfScalarComponents();
+    int downsampledDimensions[3] = { 0, 0, 0 };
+    downsampledVolume->GetDimensions(downsampledDimensions);
+    const T* volumeBasePtr = static_cast<const T*>(volume->GetScalarPointer());
+    const unsigned short* accumulationBasePtr = (accumulationBuffer != NULL ? static_cast<const unsigned short*>(accumulationBuffer->GetScalarPointer()) : NULL);
+    T* downsampledBasePtr = static_cast<T*>(downsampledVolume->GetScalarPointer());
+    PlusCommon::ParallelFor(static_cast<unsigned int>(blockExtent[5] - blockExtent[4] + 1), [&](unsigned int planeIndex)
+    {
+      const int blockZ = blockExtent[4] + static_cast<int>(planeIndex);
+      std::vector<double> sums(numberOfValueComponents);
+      for (int blockY = blockExtent[2]; blockY <= blockExtent[3]; blockY++)
+      {
+        for (int blockX = blockExtent[0]; blockX <= blockExtent[1]; blockX++)
+        {
+          std::fill(sums.begin(), sums.end(), 0.0);
+          int numberOfVoxelsWithData = 0;
+          for (int z = blockZ * factor; z < std::min((blockZ + 1) * factor, volumeDimensions[2]); z++)
+          {
+            for (int y = blockY * factor; y < std::min((blockY + 1) * factor, volumeDimensions[1]); y++)
+            {
+              size_t index = (static_cast<size_t>(z) * volumeDimensions[1] + y) * volumeDimensions[0] + blockX * factor;
+              for (int x = blockX * factor; x < std::min((blockX + 1) * factor, volumeDimensions[0]); x++, index++)
+              {
+                const T* voxelPtr = volumeBasePtr + index * numberOfComponents;
+                if ((accumulationBasePtr == NULL || accumulationBasePtr[index] == 0) && (alphaComponent == 0 || voxelPtr[alphaComponent] == 0))
+                {
+                  continue;
+                }
+                for (int c = 0; c < numberOfValueComponents; c++)
+                {
+                  sums[c] += voxelPtr[c];
+                }
+                numberOfVoxelsWithData++;
+              }
+            }
+          }
+          T* downsampledPtr = downsampledBasePtr + ((static_cast<size_t>(blockZ) * downsampledDimensions[1] + blockY) * downsampledDimensions[0] + blockX) * numberOfValueComponents;
+          for (int c = 0; c < numberOfValueComponents; c++)
+          {
+            double mean = (numberOfVoxelsWithData > 0 ? sums[c] / numberOfVoxelsWithData : 0.0);
+            downsampledPtr[c] = static_cast<T>(std::numeric_limits<T>::is_integer ? std::floor(mean + 0.5) : mean);
+          }
+        }
+      }
+    });
+  }
+}
 
 vtkStandardNewMacro(vtkPlusVolumeReconstructor);
 
 //----------------------------------------------------------------------------
 vtkPlusVolumeReconstructor::vtkPlusVolumeReconstructor()
+  : TileConfigMTime(0)
+  , NumberOfConfiguredTileReconstructors(0)
+  , ClipRectangleTightening(true)
 {
+  this->TileConfigFrameSize = { { 0, 0, 0 } };
 }
 
 //----------------------------------------------------------------------------
@@ -99,6 +379,943 @@ PlusStatus vtkPlusVolumeReconstructor::SaveReconstructedVolumeToFile(vtkImageDat
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVolumeReconstructor::GetFrameExtentInVolume(igsioTrackedFrame* frame, vtkIGSIOTransformRepository* transformRepository, int frameExtent[6])
+{
+  if (frame == NULL || transformRepository == NULL)
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::GetFrameExtentInVolume: invalid frame or transform repository");
+    return PLUS_FAIL;
+  }
+
+  igsioTransformName imageToReferenceTransformName(this->GetImageCoordinateFrame(), this->GetReferenceCoordinateFrame());
+  vtkSmartPointer<vtkMatrix4x4> imageToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  if (transformRepository->GetTransform(imageToReferenceTransformName, imageToReferenceMatrix) != PLUS_SUCCESS)
+  {
+    std::string strTransformName;
+    imageToReferenceTransformName.GetTransformName(strTransformName);
+    LOG_ERROR("Failed to get transform from repository: " << strTransformName);
+    return PLUS_FAIL;
+  }
+
+  vtkImageData* volume = this->Reconstructor->GetReconstructedVolume();
+  int volumeExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  volume->GetExtent(volumeExtent);
+  double* volumeOrigin = volume->GetOrigin();
+  double* volumeSpacing = volume->GetSpacing();
+
+  // Bounding box of the outline of the valid pixels in voxel coordinates
+  FrameSizeType frameSize = frame->GetFrameSize();
+  const PlusSlicePixelSpans& validPixelSpans = this->GetValidPixelSpans(frameSize);
+  if (validPixelSpans.IsEmpty())
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      frameExtent[2 * i] = 0;
+      frameExtent[2 * i + 1] = -1;
+    }
+    return PLUS_SUCCESS;
+  }
+  const std::vector<std::array<int, 2> >& outlinePoints = validPixelSpans.GetOutlinePoints();
+  const double lastSliceIndex = static_cast<double>(std::max<unsigned int>(frameSize[2], 1)) - 1.0;
+  double minVoxel[3] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX };
+  double maxVoxel[3] = { VTK_DOUBLE_MIN, VTK_DOUBLE_MIN, VTK_DOUBLE_MIN };
+  for (std::vector<std::array<int, 2> >::const_iterator pointIt = outlinePoints.begin(); pointIt != outlinePoints.end(); ++pointIt)
+  {
+    for (int slice = 0; slice < 2; slice++)
+    {
+      double pointImage[4] = { static_cast<double>((*pointIt)[0]), static_cast<double>((*pointIt)[1]), slice ? lastSliceIndex : 0.0, 1.0 };
+      double pointReference[4] = { 0, 0, 0, 1 };
+      imageToReferenceMatrix->MultiplyPoint(pointImage, pointReference);
+      for (int i = 0; i < 3; i++)
+      {
+        double voxel = (pointReference[i] - volumeOrigin[i]) / volumeSpacing[i];
+        minVoxel[i] = std::min(minVoxel[i], voxel);
+        maxVoxel[i] = std::max(maxVoxel[i], voxel);
+      }
+    }
+  }
+
+  for (int i = 0; i < 3; i++)
+  {
+    // One voxel margin: interpolation distributes a pixel to the neighbor voxels
+    frameExtent[2 * i] = std::max(static_cast<int>(std::floor(std::max(minVoxel[i], static_cast<double>(VTK_INT_MIN / 2)))) - 1, volumeExtent[2 * i]);
+    frameExtent[2 * i + 1] = std::min(static_cast<int>(std::ceil(std::min(maxVoxel[i], static_cast<double>(VTK_INT_MAX / 2)))) + 1, volumeExtent[2 * i + 1]);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+const PlusSlicePixelSpans& vtkPlusVolumeReconstructor::GetValidPixelSpans(const FrameSizeType& frameSize)
+{
+  PlusSlicePixelSpans::Geometry geometry;
+  geometry.FrameSize = frameSize;
+  const int* clipRectangleOrigin = this->GetClipRectangleOrigin();
+  const int* clipRectangleSize = this->GetClipRectangleSize();
+  for (int i = 0; i < 2; i++)
+  {
+    geometry.ClipRectangleOrigin[i] = clipRectangleOrigin[i];
+    geometry.ClipRectangleSize[i] = clipRectangleSize[i];
+  }
+  geometry.FanClipping = this->FanClippingApplied();
+  if (geometry.FanClipping)
+  {
+    // With automatic fan angle detection the maximum angles bound the detected fan
+    const double* fanOrigin = this->GetFanOrigin();
+    const double* fanAnglesDeg = this->GetFanAnglesDeg();
+    for (int i = 0; i < 2; i++)
+    {
+      geometry.FanOrigin[i] = fanOrigin[i];
+      geometry.FanAnglesDeg[i] = fanAnglesDeg[i];
+    }
+    geometry.FanRadiusStartPixel = this->GetFanRadiusStartPixel();
+    geometry.FanRadiusStopPixel = this->GetFanRadiusStopPixel();
+  }
+  geometry.ImportanceMask = this->ImportanceMaskImage;
+  geometry.ImportanceMaskModifiedTime = (this->ImportanceMaskImage != NULL ? this->ImportanceMaskImage->GetMTime() : 0);
+
+  if (!this->ValidPixelSpans.IsComputedForGeometry(geometry))
+  {
+    this->ValidPixelSpans.Compute(geometry);
+    LOG_DEBUG("Valid pixels of " << frameSize[0] << "x" << frameSize[1] << " frames: " << this->ValidPixelSpans.GetNumberOfValidPixels()
+              << " in " << this->ValidPixelSpans.GetSpans().size() << " spans");
+  }
+  return this->ValidPixelSpans;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVolumeReconstructor::GetPastedVolumeExtent(int extent[6])
+{
+  this->Reconstructor->GetReconstructedVolume()->GetExtent(extent);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVolumeReconstructor::CopyPastedVolume(vtkPlusVolumeReconstructor* source, const std::vector<PlusVolumeBrickGrid::ExtentType>& regionExtents, bool* fullCopyPerformed /*= NULL*/)
+{
+  if (source == NULL)
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::CopyPastedVolume: invalid source reconstructor");
+    return PLUS_FAIL;
+  }
+
+  vtkImageData* sourceVolume = source->Reconstructor->GetReconstructedVolume();
+  vtkImageData* sourceAccumulationBuffer = source->Reconstructor->GetAccumulationBuffer();
+  vtkImageData* targetVolume = this->Reconstructor->GetReconstructedVolume();
+  vtkImageData* targetAccumulationBuffer = this->Reconstructor->GetAccumulationBuffer();
+
+  bool fullCopy = !IsSameVolumeGeometry(sourceVolume, targetVolume) || !IsSameVolumeGeometry(sourceAccumulationBuffer, targetAccumulationBuffer);
+  if (fullCopy)
+  {
+    targetVolume->DeepCopy(sourceVolume);
+    targetAccumulationBuffer->DeepCopy(sourceAccumulationBuffer);
+  }
+  else
+  {
+    const int noOffset[3] = { 0, 0, 0 };
+    for (std::vector<PlusVolumeBrickGrid::ExtentType>::const_iterator regionIt = regionExtents.begin(); regionIt != regionExtents.end(); ++regionIt)
+    {
+      CopyVolumeRegion(sourceVolume, targetVolume, *regionIt, noOffset);
+      CopyVolumeRegion(sourceAccumulationBuffer, targetAccumulationBuffer, *regionIt, noOffset);
+    }
+    targetVolume->Modified();
+    targetAccumulationBuffer->Modified();
+  }
+
+  if (fullCopyPerformed != NULL)
+  {
+    *fullCopyPerformed = fullCopy;
+  }
+
+  // Make sure the gray levels are extracted again from the updated voxels
+  this->Modified();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusVolumeReconstructor::GetHoleFillingKernelRadius()
+{
+  vtkSmartPointer<vtkXMLDataElement> configElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  configElement->SetName("Device");
+  this->WriteConfiguration(configElement);
+  vtkXMLDataElement* holeFillingElement = configElement->LookupElementWithName("HoleFilling");
+  if (holeFillingElement == NULL)
+  {
+    return -1;
+  }
+
+  int kernelRadius = -1;
+  for (int i = 0; i < holeFillingElement->GetNumberOfNestedElements(); i++)
+  {
+    vtkXMLDataElement* element = holeFillingElement->GetNestedElement(i);
+    if (element == NULL || STRCASECMP(element->GetName(), "HoleFillingElement") != 0)
+    {
+      continue;
+    }
+    bool neighborhoodKnown = false;
+    int size = 0;
+    if (element->GetScalarAttribute("Size", size))
+    {
+      kernelRadius = std::max(kernelRadius, size / 2);
+      neighborhoodKnown = true;
+    }
+    int stickLengthLimit = 0;
+    if (element->GetScalarAttribute("StickLengthLimit", stickLengthLimit))
+    {
+      kernelRadius = std::max(kernelRadius, stickLengthLimit);
+      neighborhoodKnown = true;
+    }
+    if (!neighborhoodKnown)
+    {
+      LOG_DEBUG("Neighborhood of hole filling element " << (element->GetAttribute("Type") ? element->GetAttribute("Type") : "") << " is not known");
+      return -1;
+    }
+  }
+  // One more voxel for rounding in the kernels
+  return kernelRadius < 0 ? -1 : kernelRadius + 1;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVolumeReconstructor::SetUpRegionReconstructor(vtkPlusVolumeReconstructor* regionReconstructor, vtkXMLDataElement* configElement, const int regionExtent[6])
+{
+  // Same parameters as this reconstructor but with the geometry of the region
+  if (configElement != NULL && regionReconstructor->ReadConfiguration(configElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::SetUpRegionReconstructor: failed to configure region reconstructor");
+    return PLUS_FAIL;
+  }
+  vtkImageData* volume = this->Reconstructor->GetReconstructedVolume();
+  double* volumeOrigin = volume->GetOrigin();
+  double* volumeSpacing = volume->GetSpacing();
+  int regionDimensions[3] = { 0, 0, 0 };
+  int regionReconstructorExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  double regionOrigin[3] = { 0, 0, 0 };
+  for (int i = 0; i < 3; i++)
+  {
+    regionDimensions[i] = regionExtent[2 * i + 1] - regionExtent[2 * i] + 1;
+    regionReconstructorExtent[2 * i + 1] = regionDimensions[i] - 1;
+    regionOrigin[i] = volumeOrigin[i] + regionExtent[2 * i] * volumeSpacing[i];
+  }
+  regionReconstructor->SetOutputSpacing(volumeSpacing);
+  regionReconstructor->SetOutputOrigin(regionOrigin);
+  regionReconstructor->SetOutputExtent(regionReconstructorExtent);
+  regionReconstructor->Reset();
+
+  vtkImageData* regionVolume = regionReconstructor->Reconstructor->GetReconstructedVolume();
+  vtkImageData* regionAccumulationBuffer = regionReconstructor->Reconstructor->GetAccumulationBuffer();
+  if (!HasDimensions(regionVolume, regionDimensions) || !IsSameVoxelFormat(volume, regionVolume)
+      || !HasDimensions(regionAccumulationBuffer, regionDimensions) || !IsSameVoxelFormat(this->Reconstructor->GetAccumulationBuffer(), regionAccumulationBuffer))
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::SetUpRegionReconstructor: failed to allocate region volume");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVolumeReconstructor::UpdateGrayLevelsInRegion(vtkImageData* grayLevels, const int updateExtent[6], int kernelRadius, vtkPlusVolumeReconstructor* regionReconstructor)
+{
+  if (grayLevels == NULL || regionReconstructor == NULL || regionReconstructor == this || kernelRadius < 0)
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::UpdateGrayLevelsInRegion: invalid input");
+    return PLUS_FAIL;
+  }
+
+  vtkImageData* volume = this->Reconstructor->GetReconstructedVolume();
+  int volumeExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  volume->GetExtent(volumeExtent);
+  int grayLevelsExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  grayLevels->GetExtent(grayLevelsExtent);
+  if (!std::equal(volumeExtent, volumeExtent + 6, grayLevelsExtent))
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::UpdateGrayLevelsInRegion: gray level volume extent does not match the reconstructed volume extent");
+    return PLUS_FAIL;
+  }
+
+  // Hole filling of a voxel only reads voxels within the kernel radius, so gray levels are extracted from the region plus a margin
+  PlusVolumeBrickGrid::ExtentType clampedUpdateExtent = { { 0, -1, 0, -1, 0, -1 } };
+  int regionExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  int regionDimensions[3] = { 0, 0, 0 };
+  for (int i = 0; i < 3; i++)
+  {
+    clampedUpdateExtent[2 * i] = std::max(updateExtent[2 * i], volumeExtent[2 * i]);
+    clampedUpdateExtent[2 * i + 1] = std::min(updateExtent[2 * i + 1], volumeExtent[2 * i + 1]);
+    if (clampedUpdateExtent[2 * i] > clampedUpdateExtent[2 * i + 1])
+    {
+      // empty region, nothing to update
+      return PLUS_SUCCESS;
+    }
+    regionExtent[2 * i] = std::max(clampedUpdateExtent[2 * i] - kernelRadius, volumeExtent[2 * i]);
+    regionExtent[2 * i + 1] = std::min(clampedUpdateExtent[2 * i + 1] + kernelRadius, volumeExtent[2 * i + 1]);
+    regionDimensions[i] = regionExtent[2 * i + 1] - regionExtent[2 * i] + 1;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  configElement->SetName("Device");
+  this->WriteConfiguration(configElement);
+  if (this->SetUpRegionReconstructor(regionReconstructor, configElement, regionExtent) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  vtkImageData* accumulationBuffer = this->Reconstructor->GetAccumulationBuffer();
+  vtkImageData* regionVolume = regionReconstructor->Reconstructor->GetReconstructedVolume();
+  vtkImageData* regionAccumulationBuffer = regionReconstructor->Reconstructor->GetAccumulationBuffer();
+  int regionVolumeExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  regionVolume->GetExtent(regionVolumeExtent);
+  const int toRegionOffset[3] = { regionVolumeExtent[0] - regionExtent[0], regionVolumeExtent[2] - regionExtent[2], regionVolumeExtent[4] - regionExtent[4] };
+  const PlusVolumeBrickGrid::ExtentType sourceRegionExtent = { { regionExtent[0], regionExtent[1], regionExtent[2], regionExtent[3], regionExtent[4], regionExtent[5] } };
+  CopyVolumeRegion(volume, regionVolume, sourceRegionExtent, toRegionOffset);
+  CopyVolumeRegion(accumulationBuffer, regionAccumulationBuffer, sourceRegionExtent, toRegionOffset);
+  regionVolume->Modified();
+  regionAccumulationBuffer->Modified();
+  regionReconstructor->Modified();
+
+  vtkSmartPointer<vtkImageData> regionGrayLevels = vtkSmartPointer<vtkImageData>::New();
+  if (regionReconstructor->ExtractGrayLevels(regionGrayLevels) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::UpdateGrayLevelsInRegion: extracting gray levels of the region failed");
+    return PLUS_FAIL;
+  }
+  if (!HasDimensions(regionGrayLevels, regionDimensions) || !IsSameVoxelFormat(regionGrayLevels, grayLevels))
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::UpdateGrayLevelsInRegion: gray levels of the region do not match the gray level volume");
+    return PLUS_FAIL;
+  }
+
+  // Only the update extent is copied back, the margin is not complete for hole filling
+  int regionGrayLevelsExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  regionGrayLevels->GetExtent(regionGrayLevelsExtent);
+  PlusVolumeBrickGrid::ExtentType updateExtentInRegion = clampedUpdateExtent;
+  int fromRegionOffset[3] = { 0, 0, 0 };
+  for (int i = 0; i < 3; i++)
+  {
+    fromRegionOffset[i] = regionExtent[2 * i] - regionGrayLevelsExtent[2 * i];
+    updateExtentInRegion[2 * i] -= fromRegionOffset[i];
+    updateExtentInRegion[2 * i + 1] -= fromRegionOffset[i];
+  }
+  CopyVolumeRegion(regionGrayLevels, grayLevels, updateExtentInRegion, fromRegionOffset);
+  grayLevels->Modified();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVolumeReconstructor::UpdateDownsampledVolume(vtkImageData* downsampledVolume, int downsamplingFactor, const std::vector<PlusVolumeBrickGrid::ExtentType>* updateExtents /*= NULL*/)
+{
+  if (downsampledVolume == NULL || downsamplingFactor < 1)
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::UpdateDownsampledVolume: invalid input");
+    return PLUS_FAIL;
+  }
+
+  vtkImageData* volume = this->Reconstructor->GetReconstructedVolume();
+  if (volume->GetScalarPointer() == NULL)
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::UpdateDownsampledVolume: reconstructed volume is not allocated");
+    return PLUS_FAIL;
+  }
+  int volumeExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  volume->GetExtent(volumeExtent);
+  double* volumeSpacing = volume->GetSpacing();
+  double* volumeOrigin = volume->GetOrigin();
+
+  // Downsampled voxels are at the center of the blocks of voxels that they represent
+  int downsampledDimensions[3] = { 0, 0, 0 };
+  double downsampledSpacing[3] = { 0, 0, 0 };
+  double downsampledOrigin[3] = { 0, 0, 0 };
+  for (int i = 0; i < 3; i++)
+  {
+    downsampledDimensions[i] = (volumeExtent[2 * i + 1] - volumeExtent[2 * i] + downsamplingFactor) / downsamplingFactor;
+    downsampledSpacing[i] = volumeSpacing[i] * downsamplingFactor;
+    downsampledOrigin[i] = volumeOrigin[i] + (volumeExtent[2 * i] + 0.5 * (downsamplingFactor - 1)) * volumeSpacing[i];
+  }
+  const int numberOfValueComponents = std::max(volume->GetNumberOfScalarComponents() - 1, 1);
+
+  bool updateWholeVolume = (updateExtents == NULL || !HasDimensions(downsampledVolume, downsampledDimensions)
+                            || downsampledVolume->GetScalarType() != volume->GetScalarType() || downsampledVolume->GetNumberOfScalarComponents() != numberOfValueComponents
+                            || downsampledVolume->GetScalarPointer() == NULL);
+  if (updateWholeVolume)
+  {
+    downsampledVolume->SetExtent(0, downsampledDimensions[0] - 1, 0, downsampledDimensions[1] - 1, 0, downsampledDimensions[2] - 1);
+    try
+    {
+      downsampledVolume->AllocateScalars(volume->GetScalarType(), numberOfValueComponents);
+    }
+    catch (std::bad_alloc&)
+    {
+      LOG_ERROR("vtkPlusVolumeReconstructor::UpdateDownsampledVolume: failed to allocate downsampled volume");
+      return PLUS_FAIL;
+    }
+  }
+  downsampledVolume->SetSpacing(downsampledSpacing);
+  downsampledVolume->SetOrigin(downsampledOrigin);
+
+  // The accumulation buffer is not used by all compounding modes, then only the alpha component tells which voxels have data
+  vtkImageData* accumulationBuffer = this->Reconstructor->GetAccumulationBuffer();
+  int volumeDimensions[3] = { 0, 0, 0 };
+  volume->GetDimensions(volumeDimensions);
+  if (accumulationBuffer != NULL && (!HasDimensions(accumulationBuffer, volumeDimensions) || accumulationBuffer->GetScalarType() != VTK_UNSIGNED_SHORT
+                                     || accumulationBuffer->GetNumberOfScalarComponents() != 1 || accumulationBuffer->GetScalarPointer() == NULL))
+  {
+    accumulationBuffer = NULL;
+  }
+
+  std::vector<PlusVolumeBrickGrid::ExtentType> blockExtents;
+  if (updateWholeVolume)
+  {
+    PlusVolumeBrickGrid::ExtentType wholeExtent = { { 0, downsampledDimensions[0] - 1, 0, downsampledDimensions[1] - 1, 0, downsampledDimensions[2] - 1 } };
+    blockExtents.push_back(wholeExtent);
+  }
+  else
+  {
+    for (std::vector<PlusVolumeBrickGrid::ExtentType>::const_iterator extentIt = updateExtents->begin(); extentIt != updateExtents->end(); ++extentIt)
+    {
+      PlusVolumeBrickGrid::ExtentType blockExtent = { { 0, -1, 0, -1, 0, -1 } };
+      bool emptyExtent = false;
+      for (int i = 0; i < 3; i++)
+      {
+        blockExtent[2 * i] = (std::max((*extentIt)[2 * i], volumeExtent[2 * i]) - volumeExtent[2 * i]) / downsamplingFactor;
+        blockExtent[2 * i + 1] = (std::min((*extentIt)[2 * i + 1], volumeExtent[2 * i + 1]) - volumeExtent[2 * i]) / downsamplingFactor;
+        emptyExtent = emptyExtent || (*extentIt)[2 * i] > volumeExtent[2 * i + 1] || (*extentIt)[2 * i + 1] < volumeExtent[2 * i];
+      }
+      if (!emptyExtent)
+      {
+        blockExtents.push_back(blockExtent);
+      }
+    }
+  }
+
+  for (std::vector<PlusVolumeBrickGrid::ExtentType>::const_iterator blockExtentIt = blockExtents.begin(); blockExtentIt != blockExtents.end(); ++blockExtentIt)
+  {
+    switch (volume->GetScalarType())
+    {
+      vtkTemplateMacro(DownsampleVolumeBlocks<VTK_TT>(volume, accumulationBuffer, downsampledVolume, blockExtentIt->data(), downsamplingFactor));
+      default:
+        LOG_ERROR("vtkPlusVolumeReconstructor::UpdateDownsampledVolume: unsupported scalar type " << volume->GetScalarType());
+        return PLUS_FAIL;
+    }
+  }
+  downsampledVolume->Modified();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVolumeReconstructor::ExpandOutputBoundsWithFrame(igsioTrackedFrame* frame, vtkIGSIOTransformRepository* transformRepository, double bounds[6], bool* frameIncluded /*= NULL*/)
+{
+  if (frameIncluded != NULL)
+  {
+    *frameIncluded = false;
+  }
+  if (frame == NULL || transformRepository == NULL || frame->GetImageData()->GetImage() == NULL)
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::ExpandOutputBoundsWithFrame: invalid frame or transform repository");
+    return PLUS_FAIL;
+  }
+  if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::ExpandOutputBoundsWithFrame: failed to update transform repository with the frame");
+    return PLUS_FAIL;
+  }
+  igsioTransformName imageToReferenceTransformName(this->GetImageCoordinateFrame(), this->GetReferenceCoordinateFrame());
+  vtkSmartPointer<vtkMatrix4x4> imageToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  ToolStatus imageToReferenceStatus(TOOL_INVALID);
+  if (transformRepository->GetTransform(imageToReferenceTransformName, imageToReferenceMatrix, &imageToReferenceStatus) != PLUS_SUCCESS)
+  {
+    std::string strTransformName;
+    imageToReferenceTransformName.GetTransformName(strTransformName);
+    LOG_ERROR("Failed to get transform from repository: " << strTransformName);
+    return PLUS_FAIL;
+  }
+  if (imageToReferenceStatus != TOOL_OK)
+  {
+    // the frame is not pasted into the volume
+    return PLUS_SUCCESS;
+  }
+
+  // Corners of the frame, clipped by the clip rectangle
+  int* frameExtent = frame->GetImageData()->GetImage()->GetExtent();
+  double minX = frameExtent[0];
+  double maxX = frameExtent[1];
+  double minY = frameExtent[2];
+  double maxY = frameExtent[3];
+  const int* clipRectangleOrigin = this->GetClipRectangleOrigin();
+  const int* clipRectangleSize = this->GetClipRectangleSize();
+  if (clipRectangleSize[0] > 0 && clipRectangleSize[1] > 0)
+  {
+    minX = std::max<double>(minX, clipRectangleOrigin[0]);
+    maxX = std::min<double>(maxX, clipRectangleOrigin[0] + clipRectangleSize[0]);
+    minY = std::max<double>(minY, clipRectangleOrigin[1]);
+    maxY = std::min<double>(maxY, clipRectangleOrigin[1] + clipRectangleSize[1]);
+  }
+  for (int corner = 0; corner < 8; corner++)
+  {
+    double cornerImage[4] =
+    {
+      (corner & 1) ? maxX : minX,
+      (corner & 2) ? maxY : minY,
+      static_cast<double>((corner & 4) ? frameExtent[5] : frameExtent[4]),
+      1.0
+    };
+    double cornerReference[4] = { 0, 0, 0, 1 };
+    imageToReferenceMatrix->MultiplyPoint(cornerImage, cornerReference);
+    for (int axis = 0; axis < 3; axis++)
+    {
+      bounds[2 * axis] = std::min(bounds[2 * axis], cornerReference[axis]);
+      bounds[2 * axis + 1] = std::max(bounds[2 * axis + 1], cornerReference[axis]);
+    }
+  }
+  if (frameIncluded != NULL)
+  {
+    *frameIncluded = true;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVolumeReconstructor::GetOutputGeometryFromBounds(const double bounds[6], double origin[3], double spacing[3], int extent[6])
+{
+  double* outputSpacing = this->Reconstructor->GetOutputSpacing();
+  for (int axis = 0; axis < 3; axis++)
+  {
+    origin[axis] = bounds[2 * axis];
+    spacing[axis] = outputSpacing[axis];
+    extent[2 * axis] = 0;
+    extent[2 * axis + 1] = static_cast<int>((bounds[2 * axis + 1] - bounds[2 * axis]) / outputSpacing[axis]);
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVolumeReconstructor::AllocateOutput(const double origin[3], const int extent[6], int scalarType)
+{
+  double outputOrigin[3] = { origin[0], origin[1], origin[2] };
+  int outputExtent[6] = { extent[0], extent[1], extent[2], extent[3], extent[4], extent[5] };
+  this->SetOutputOrigin(outputOrigin);
+  this->SetOutputExtent(outputExtent);
+  this->Reconstructor->SetOutputScalarMode(scalarType);
+  try
+  {
+    this->Reset();
+  }
+  catch (std::bad_alloc&)
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::AllocateOutput: not enough memory for the output volume");
+    return PLUS_FAIL;
+  }
+  if (this->Reconstructor->GetReconstructedVolume()->GetScalarPointer() == NULL)
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::AllocateOutput: failed to allocate the output volume");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusVolumeReconstructor::GetTightenedClipRectangle(const FrameSizeType& frameSize, int origin[2], int size[2])
+{
+  int validOrigin[2] = { 0, 0 };
+  int validSize[2] = { 0, 0 };
+  if (!this->ClipRectangleTightening || frameSize[0] == 0 || frameSize[1] == 0
+      || !this->GetValidPixelSpans(frameSize).GetBoundingRectangle(validOrigin, validSize))
+  {
+    // disabled, or no valid pixels (the frames are not pasted anyway)
+    return false;
+  }
+
+  const int* clipRectangleOrigin = this->GetClipRectangleOrigin();
+  const int* clipRectangleSize = this->GetClipRectangleSize();
+  const bool clipRectangleApplied = (clipRectangleSize[0] > 0 && clipRectangleSize[1] > 0);
+  for (int i = 0; i < 2; i++)
+  {
+    // Only shrink the original rectangle, so the pixels that are pasted remain the same
+    int clipStart = clipRectangleApplied ? clipRectangleOrigin[i] : 0;
+    int clipEnd = clipRectangleApplied ? clipRectangleOrigin[i] + clipRectangleSize[i] : static_cast<int>(frameSize[i]);
+    origin[i] = std::max(clipStart, validOrigin[i]);
+    size[i] = std::min(clipEnd, validOrigin[i] + validSize[i]) - origin[i];
+    if (size[i] <= 0)
+    {
+      return false;
+    }
+  }
+  return !(clipRectangleApplied && origin[0] == clipRectangleOrigin[0] && origin[1] == clipRectangleOrigin[1]
+           && size[0] == clipRectangleSize[0] && size[1] == clipRectangleSize[1]);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVolumeReconstructor::TightenTileClipRectangle(const FrameSizeType& frameSize, vtkXMLDataElement* reconstructionElement)
+{
+  int tileClipRectangleOrigin[2] = { 0, 0 };
+  int tileClipRectangleSize[2] = { 0, 0 };
+  if (this->GetTightenedClipRectangle(frameSize, tileClipRectangleOrigin, tileClipRectangleSize))
+  {
+    reconstructionElement->SetVectorAttribute("ClipRectangleOrigin", 2, tileClipRectangleOrigin);
+    reconstructionElement->SetVectorAttribute("ClipRectangleSize", 2, tileClipRectangleSize);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusVolumeReconstructor::GetPasteRectangles(const FrameSizeType& frameSize, std::vector<std::array<int, 4> >& rectangles)
+{
+  rectangles.clear();
+  if (!this->ClipRectangleTightening || frameSize[0] == 0 || frameSize[1] == 0)
+  {
+    return false;
+  }
+
+  int tightenedOrigin[2] = { 0, 0 };
+  int tightenedSize[2] = { 0, 0 };
+  const std::vector<PlusSlicePixelSpans::RowBand>& rowBands = this->GetValidPixelSpans(frameSize).GetRowBands();
+  if (!this->GetEnableFanAnglesAutoDetect() && rowBands.size() > 1)
+  {
+    // The paster visits the pixels from origin to origin + size (inclusive) and ignores a rectangle with zero size,
+    // so the rectangle of a band is one pixel smaller than the band. A band of one column is widened to two columns
+    // inside the configured rectangle, the bands have at least two rows.
+    const int* clipRectangleOrigin = this->GetClipRectangleOrigin();
+    const int* clipRectangleSize = this->GetClipRectangleSize();
+    const bool clipRectangleApplied = (clipRectangleSize[0] > 0 && clipRectangleSize[1] > 0);
+    const int firstValidColumn = clipRectangleApplied ? std::max(clipRectangleOrigin[0], 0) : 0;
+    const int lastValidColumn = clipRectangleApplied ? std::min(clipRectangleOrigin[0] + clipRectangleSize[0], static_cast<int>(frameSize[0]) - 1)
+                                : static_cast<int>(frameSize[0]) - 1;
+    for (std::vector<PlusSlicePixelSpans::RowBand>::const_iterator bandIt = rowBands.begin(); bandIt != rowBands.end(); ++bandIt)
+    {
+      int firstColumn = bandIt->FirstColumn;
+      if (bandIt->LastColumn == firstColumn && firstColumn == lastValidColumn)
+      {
+        firstColumn--;
+      }
+      if (firstColumn < firstValidColumn)
+      {
+        // the configured rectangle is a single column, it cannot be split
+        rectangles.clear();
+        break;
+      }
+      std::array<int, 4> rectangle = { { firstColumn, bandIt->FirstRow, std::max(bandIt->LastColumn - firstColumn, 1), bandIt->LastRow - bandIt->FirstRow } };
+      rectangles.push_back(rectangle);
+    }
+    if (!rectangles.empty())
+    {
+      return true;
+    }
+  }
+
+  // Bounding rectangle if there is only one band, or with automatic fan angle detection (the fan angles are detected in each paste)
+  if (!this->GetTightenedClipRectangle(frameSize, tightenedOrigin, tightenedSize))
+  {
+    return false;
+  }
+  std::array<int, 4> rectangle = { { tightenedOrigin[0], tightenedOrigin[1], tightenedSize[0], tightenedSize[1] } };
+  rectangles.push_back(rectangle);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVolumeReconstructor::AddTrackedFrame(igsioTrackedFrame* frame, vtkIGSIOTransformRepository* transformRepository, bool isFirst /*= true*/, bool isLast /*= true*/,
+    bool* insertedIntoVolume /*= NULL*/)
+{
+  std::vector<std::array<int, 4> > pasteRectangles;
+  if (frame == NULL || !this->GetPasteRectangles(frame->GetFrameSize(), pasteRectangles))
+  {
+    return this->Superclass::AddTrackedFrame(frame, transformRepository, isFirst, isLast, insertedIntoVolume);
+  }
+
+  // The paste rectangles are only set in the paster while the frame is pasted, so the output geometry,
+  // the written configuration and the valid pixel spans are computed from the configured rectangle
+  const bool tileConfigUpToDate = (this->TileConfigElement != NULL && this->TileConfigMTime == this->GetTileConfigurationMTime());
+  int clipRectangleOrigin[2] = { this->GetClipRectangleOrigin()[0], this->GetClipRectangleOrigin()[1] };
+  int clipRectangleSize[2] = { this->GetClipRectangleSize()[0], this->GetClipRectangleSize()[1] };
+  PlusStatus status = PLUS_SUCCESS;
+  bool parametersUnchanged = true;
+  bool frameInserted = false;
+  for (size_t rectangleIndex = 0; rectangleIndex < pasteRectangles.size(); rectangleIndex++)
+  {
+    int pasteOrigin[2] = { pasteRectangles[rectangleIndex][0], pasteRectangles[rectangleIndex][1] };
+    int pasteSize[2] = { pasteRectangles[rectangleIndex][2], pasteRectangles[rectangleIndex][3] };
+    this->SetClipRectangleOrigin(pasteOrigin);
+    this->SetClipRectangleSize(pasteSize);
+    const vtkMTimeType pasteMTime = this->GetTileConfigurationMTime();
+    bool rectangleInserted = false;
+    status = this->Superclass::AddTrackedFrame(frame, transformRepository, isFirst && rectangleIndex == 0, isLast && rectangleIndex + 1 == pasteRectangles.size(), &rectangleInserted);
+    parametersUnchanged = parametersUnchanged && (this->GetTileConfigurationMTime() == pasteMTime);
+    if (status != PLUS_SUCCESS || !rectangleInserted)
+    {
+      // the transform of the frame is invalid, none of the rectangles is pasted
+      break;
+    }
+    frameInserted = true;
+  }
+  this->SetClipRectangleOrigin(clipRectangleOrigin);
+  this->SetClipRectangleSize(clipRectangleSize);
+  if (insertedIntoVolume != NULL)
+  {
+    *insertedIntoVolume = frameInserted;
+  }
+  if (tileConfigUpToDate && parametersUnchanged)
+  {
+    // Only the clip rectangle was changed and it is restored, the tile reconstructors do not have to be reconfigured
+    this->TileConfigMTime = this->GetTileConfigurationMTime();
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+vtkMTimeType vtkPlusVolumeReconstructor::GetTileConfigurationMTime()
+{
+  // Parameters are stored in this object and in the paster (clipping, interpolation, compounding, etc.)
+  vtkMTimeType mtime = std::max(this->GetMTime(), this->Reconstructor->GetMTime());
+  if (this->ImportanceMaskImage != NULL)
+  {
+    mtime = std::max(mtime, this->ImportanceMaskImage->GetMTime());
+  }
+  return mtime;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVolumeReconstructor::AddTrackedFrames(const std::vector<igsioTrackedFrame*>& frames, vtkIGSIOTransformRepository* transformRepository, unsigned int numberOfThreads, bool reproducible,
+    std::vector<PlusVolumeBrickGrid::ExtentType>* insertedFrameExtents /*= NULL*/)
+{
+  if (transformRepository == NULL)
+  {
+    LOG_ERROR("vtkPlusVolumeReconstructor::AddTrackedFrames: invalid transform repository");
+    return PLUS_FAIL;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  const unsigned int numberOfFrames = static_cast<unsigned int>(frames.size());
+  vtkImageData* volume = this->Reconstructor->GetReconstructedVolume();
+  vtkImageData* accumulationBuffer = this->Reconstructor->GetAccumulationBuffer();
+  if (volume->GetScalarPointer() == NULL || accumulationBuffer->GetScalarPointer() == NULL
+      || accumulationBuffer->GetScalarType() != VTK_UNSIGNED_SHORT || accumulationBuffer->GetNumberOfScalarComponents() != 1)
+  {
+    // The volume is not allocated yet, so the frames cannot be pasted into tiles
+    for (unsigned int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
+    {
+      bool insertedIntoVolume = false;
+      if (transformRepository->SetTransforms(*frames[frameIndex]) != PLUS_SUCCESS
+          || this->AddTrackedFrame(frames[frameIndex], transformRepository, frameIndex == 0, frameIndex + 1 == numberOfFrames, &insertedIntoVolume) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
+        status = PLUS_FAIL;
+        continue;
+      }
+      PlusVolumeBrickGrid::ExtentType frameExtent = { { 0, -1, 0, -1, 0, -1 } };
+      if (insertedIntoVolume && insertedFrameExtents != NULL && this->GetFrameExtentInVolume(frames[frameIndex], transformRepository, frameExtent.data()) == PLUS_SUCCESS)
+      {
+        insertedFrameExtents->push_back(frameExtent);
+      }
+    }
+    return status;
+  }
+
+  // Compute all the transforms and modified extents up front, the transform repository is not used by the threads
+  igsioTransformName imageToReferenceTransformName(this->GetImageCoordinateFrame(), this->GetReferenceCoordinateFrame());
+  std::vector<vtkSmartPointer<vtkMatrix4x4> > imageToReferenceMatrices(numberOfFrames);
+  std::vector<ToolStatus> imageToReferenceStatuses(numberOfFrames, TOOL_INVALID);
+  std::vector<PlusVolumeBrickGrid::ExtentType> frameExtents(numberOfFrames);
+  std::vector<char> frameValid(numberOfFrames, 0);
+  for (unsigned int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
+  {
+    imageToReferenceMatrices[frameIndex] = vtkSmartPointer<vtkMatrix4x4>::New();
+    if (transformRepository->SetTransforms(*frames[frameIndex]) != PLUS_SUCCESS
+        || transformRepository->GetTransform(imageToReferenceTransformName, imageToReferenceMatrices[frameIndex], &imageToReferenceStatuses[frameIndex]) != PLUS_SUCCESS
+        || this->GetFrameExtentInVolume(frames[frameIndex], transformRepository, frameExtents[frameIndex].data()) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get the transforms of frame #" << frameIndex);
+      status = PLUS_FAIL;
+      continue;
+    }
+    frameValid[frameIndex] = 1;
+  }
+
+  // The clip rectangle of the tiles is tightened if all the frames have the same size
+  FrameSizeType frameSize = { { 0, 0, 0 } };
+  bool frameSizeFound = false;
+  for (unsigned int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
+  {
+    if (!frameValid[frameIndex])
+    {
+      continue;
+    }
+    if (!frameSizeFound)
+    {
+      frameSize = frames[frameIndex]->GetFrameSize();
+      frameSizeFound = true;
+    }
+    else if (frames[frameIndex]->GetFrameSize() != frameSize)
+    {
+      frameSize = { { 0, 0, 0 } };
+      break;
+    }
+  }
+
+  // The tiles only use one thread each, the parallelization is between the tiles.
+  // The tile configuration is only rebuilt (and the tile reconstructors reconfigured) if the parameters or the frame size changed.
+  const vtkMTimeType tileConfigMTime = this->GetTileConfigurationMTime();
+  if (this->TileConfigElement == NULL || this->TileConfigMTime != tileConfigMTime || this->TileConfigFrameSize != frameSize)
+  {
+    this->TileConfigElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    this->TileConfigElement->SetName("Device");
+    this->WriteConfiguration(this->TileConfigElement);
+    vtkXMLDataElement* tileReconstructionElement = this->TileConfigElement->LookupElementWithName("VolumeReconstruction");
+    if (tileReconstructionElement == NULL)
+    {
+      tileReconstructionElement = this->TileConfigElement;
+    }
+    tileReconstructionElement->SetIntAttribute("NumberOfThreads", 1);
+    if (frameSize[0] > 0 && frameSize[1] > 0)
+    {
+      this->TightenTileClipRectangle(frameSize, tileReconstructionElement);
+    }
+    this->TileConfigMTime = tileConfigMTime;
+    this->TileConfigFrameSize = frameSize;
+    this->NumberOfConfiguredTileReconstructors = 0;
+  }
+  const TileCompoundingMode compoundingMode = GetTileCompoundingMode(this->TileConfigElement);
+
+  // Consecutive frames are grouped into tiles. A tile is closed when it has framesPerTile frames or when the next frame
+  // would make its extent larger than MAX_TILE_VOXELS, so the memory usage of the tiles is limited. The grouping does not depend
+  // on the number of threads in reproducible mode.
+  const unsigned int numberOfWorkers = PlusCommon::GetNumberOfWorkerThreads(numberOfThreads);
+  unsigned int framesPerTile = REPRODUCIBLE_FRAMES_PER_TILE;
+  if (!reproducible)
+  {
+    framesPerTile = std::max(1u, std::min((numberOfFrames + numberOfWorkers - 1) / numberOfWorkers, MAX_FRAMES_PER_TILE));
+  }
+  std::vector<FrameTile> tiles;
+  for (unsigned int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
+  {
+    const PlusVolumeBrickGrid::ExtentType& frameExtent = frameExtents[frameIndex];
+    const bool frameInVolume = frameValid[frameIndex] && !IsEmptyExtent(frameExtent);
+    bool newTile = tiles.empty() || tiles.back().LastFrameIndex - tiles.back().FirstFrameIndex + 1 >= framesPerTile;
+    if (!newTile && frameInVolume && !IsEmptyExtent(tiles.back().Extent))
+    {
+      PlusVolumeBrickGrid::ExtentType mergedExtent = tiles.back().Extent;
+      ExpandExtent(mergedExtent, frameExtent);
+      newTile = (GetNumberOfVoxels(mergedExtent) > MAX_TILE_VOXELS);
+    }
+    if (newTile)
+    {
+      tiles.push_back(FrameTile(frameIndex));
+    }
+    tiles.back().LastFrameIndex = frameIndex;
+    if (frameInVolume)
+    {
+      ExpandExtent(tiles.back().Extent, frameExtent);
+    }
+  }
+  const unsigned int numberOfTiles = static_cast<unsigned int>(tiles.size());
+
+  const unsigned int numberOfTileReconstructors = std::min(numberOfWorkers, numberOfTiles);
+  while (this->TileReconstructors.size() < numberOfTileReconstructors)
+  {
+    this->TileReconstructors.push_back(vtkSmartPointer<vtkPlusVolumeReconstructor>::New());
+  }
+  if (this->NumberOfConfiguredTileReconstructors < numberOfTileReconstructors)
+  {
+    const unsigned int firstReconstructorIndex = this->NumberOfConfiguredTileReconstructors;
+    std::vector<PlusStatus> configStatuses(numberOfTileReconstructors - firstReconstructorIndex, PLUS_SUCCESS);
+    PlusCommon::ParallelFor(numberOfTileReconstructors - firstReconstructorIndex, [&](unsigned int index)
+    {
+      configStatuses[index] = this->TileReconstructors[firstReconstructorIndex + index]->ReadConfiguration(this->TileConfigElement);
+      this->TileReconstructors[firstReconstructorIndex + index]->SetClipRectangleTightening(this->ClipRectangleTightening);
+    }, numberOfWorkers);
+    if (std::find(configStatuses.begin(), configStatuses.end(), PLUS_FAIL) != configStatuses.end())
+    {
+      LOG_ERROR("vtkPlusVolumeReconstructor::AddTrackedFrames: failed to configure tile reconstructors");
+      return PLUS_FAIL;
+    }
+    this->NumberOfConfiguredTileReconstructors = numberOfTileReconstructors;
+  }
+
+  // Tiles are pasted in waves of one tile per thread, so that the memory usage is limited
+  std::vector<char> frameInserted(numberOfFrames, 0);
+  for (unsigned int firstTileIndex = 0; firstTileIndex < numberOfTiles; firstTileIndex += numberOfWorkers)
+  {
+    const unsigned int numberOfWaveTiles = std::min(numberOfWorkers, numberOfTiles - firstTileIndex);
+    std::vector<PlusStatus> tileStatuses(numberOfWaveTiles, PLUS_SUCCESS);
+    PlusCommon::ParallelFor(numberOfWaveTiles, [&](unsigned int waveTileIndex)
+    {
+      const FrameTile& tile = tiles[firstTileIndex + waveTileIndex];
+      const unsigned int firstFrameIndex = tile.FirstFrameIndex;
+      const unsigned int lastFrameIndex = tile.LastFrameIndex;
+      if (IsEmptyExtent(tile.Extent))
+      {
+        // no frame intersects the volume
+        return;
+      }
+
+      // Only the volume of the tile reconstructor is reallocated, it is already configured
+      vtkPlusVolumeReconstructor* tileReconstructor = this->TileReconstructors[waveTileIndex];
+      if (this->SetUpRegionReconstructor(tileReconstructor, NULL, tile.Extent.data()) != PLUS_SUCCESS)
+      {
+        tileStatuses[waveTileIndex] = PLUS_FAIL;
+        return;
+      }
+      vtkSmartPointer<vtkIGSIOTransformRepository> tileTransformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+      for (unsigned int frameIndex = firstFrameIndex; frameIndex <= lastFrameIndex; frameIndex++)
+      {
+        if (!frameValid[frameIndex])
+        {
+          continue;
+        }
+        bool insertedIntoVolume = false;
+        tileTransformRepository->SetTransform(imageToReferenceTransformName, imageToReferenceMatrices[frameIndex], imageToReferenceStatuses[frameIndex]);
+        if (tileReconstructor->AddTrackedFrame(frames[frameIndex], tileTransformRepository, frameIndex == firstFrameIndex, frameIndex == lastFrameIndex, &insertedIntoVolume) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
+          tileStatuses[waveTileIndex] = PLUS_FAIL;
+          continue;
+        }
+        frameInserted[frameIndex] = insertedIntoVolume ? 1 : 0;
+      }
+    }, numberOfWorkers);
+
+    // Merge in frame order, so the result does not depend on which thread finished first
+    for (unsigned int waveTileIndex = 0; waveTileIndex < numberOfWaveTiles; waveTileIndex++)
+    {
+      if (tileStatuses[waveTileIndex] != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+      const PlusVolumeBrickGrid::ExtentType& tileExtent = tiles[firstTileIndex + waveTileIndex].Extent;
+      if (IsEmptyExtent(tileExtent))
+      {
+        continue;
+      }
+      vtkIGSIOPasteSliceIntoVolume* tilePaster = this->TileReconstructors[waveTileIndex]->Reconstructor;
+      switch (volume->GetScalarType())
+      {
+        vtkTemplateMacro(MergeTile<VTK_TT>(tilePaster->GetReconstructedVolume(), tilePaster->GetAccumulationBuffer(), volume, accumulationBuffer, tileExtent.data(), compoundingMode, numberOfWorkers));
+        default:
+          LOG_ERROR("vtkPlusVolumeReconstructor::AddTrackedFrames: unsupported volume scalar type: " << volume->GetScalarType());
+          return PLUS_FAIL;
+      }
+    }
+  }
+
+  int numberOfInsertedFrames = 0;
+  for (unsigned int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
+  {
+    if (frameInserted[frameIndex])
+    {
+      numberOfInsertedFrames++;
+      if (insertedFrameExtents != NULL)
+      {
+        insertedFrameExtents->push_back(frameExtents[frameIndex]);
+      }
+    }
+  }
+  LOG_DEBUG("Inserted " << numberOfInsertedFrames << " of " << numberOfFrames << " frames in " << numberOfTiles << " tiles using " << numberOfWorkers << " threads");
+
+  volume->Modified();
+  accumulationBuffer->Modified();
+  this->Modified();
+  // The parameters did not change, the tile configuration remains valid
+  if (this->TileConfigMTime == tileConfigMTime)
+  {
+    this->TileConfigMTime = this->GetTileConfigurationMTime();
+  }
+  return status;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVolumeReconstructor::UpdateImportanceMask()
 {
@@ -129,10 +1346,12 @@ PlusStatus vtkPlusVolumeReconstructor::UpdateImportanceMask()
     flipYFilter->SetFilteredAxis(1); // flip y axis
     flipYFilter->SetInputConnection(reader->GetOutputPort());
     flipYFilter->Update();
-    this->Reconstructor->SetImportanceMask(flipYFilter->GetOutput());
+    this->ImportanceMaskImage = flipYFilter->GetOutput();
+    this->Reconstructor->SetImportanceMask(this->ImportanceMaskImage);
   }
   else
   {
+    this->ImportanceMaskImage = NULL;
     this->Reconstructor->SetImportanceMask(NULL);
   }
   return PLUS_SUCCESS;
@@ -8,12 +8,18 @@
 #define __vtkPlusVolumeReconstructor_h
 
 #include "PlusConfigure.h"
+#include "PlusSlicePixelSpans.h"
+#include "PlusVolumeBrickGrid.h"
 #include "vtkPlusVolumeReconstructionExport.h"
 
 // IGSIO includes
 #include <igsioCommon.h>
 #include <vtkIGSIOVolumeReconstructor.h>
 
+class igsioTrackedFrame;
+class vtkIGSIOTransformRepository;
+class vtkXMLDataElement;
+
 /*!
   \class vtkPlusVolumeReconstructor
   \brief Reconstructs a volume from tracked frames
@@ -72,10 +78,166 @@ public:
   static PlusStatus SaveReconstructedVolumeToFile(vtkImageData* volumeToSave, const std::string& filename, bool useCompression = true, std::vector<std::string>* customFields = nullptr, std::vector<std::string>* customValues = nullptr);
   static PlusStatus SaveReconstructedVolumeToMetafile(vtkImageData* volumeToSave, const std::string& filename, bool useCompression = true, std::vector<std::string>* customFields = nullptr, std::vector<std::string>* customValues = nullptr) { return vtkPlusVolumeReconstructor::SaveReconstructedVolumeToFile(volumeToSave, filename, useCompression, customFields, customValues); }
 
+  /*!
+    Get the voxel extent (xMin, xMax, yMin, yMax, zMin, zMax) of the output volume that inserting a frame may modify.
+    Computed from the outline of the valid pixels of the frame (see GetValidPixelSpans) transformed by the ImageToReference transform
+    of the repository, with a one voxel margin for interpolation.
+    The extent is empty (min > max along an axis) if the frame is completely outside the volume or has no valid pixels.
+    \param frame The frame that is inserted, only its size is used
+    \param transformRepository Transform repository that is already updated with the transforms of the frame
+  */
+  PlusStatus GetFrameExtentInVolume(igsioTrackedFrame* frame, vtkIGSIOTransformRepository* transformRepository, int frameExtent[6]);
+
+  /*!
+    Get the pixels of a frame that may be pasted into the volume, as run-length encoded spans per row.
+    Pixels outside the clip rectangle, outside the fan or where the importance mask is 0 are excluded.
+    The spans are cached and only recomputed when the frame size or the clipping parameters change.
+  */
+  const PlusSlicePixelSpans& GetValidPixelSpans(const FrameSizeType& frameSize);
+
+  /*! Get the voxel extent of the volume that the frames are pasted into */
+  void GetPastedVolumeExtent(int extent[6]);
+
+  /*!
+    Copy the pasted voxels and the accumulation buffer from another reconstructor.
+    If the volume geometry of the two reconstructors is the same then only the voxels within the region extents are copied,
+    otherwise the whole volume is copied. Hole filling and gray level extraction can then run on the copy while frames are inserted into the source.
+    \param regionExtents Voxel extents to copy (e.g., modified bricks), they are ignored if the whole volume has to be copied
+    \param fullCopyPerformed Optional output, set to true if the whole volume was copied
+  */
+  PlusStatus CopyPastedVolume(vtkPlusVolumeReconstructor* source, const std::vector<PlusVolumeBrickGrid::ExtentType>& regionExtents, bool* fullCopyPerformed = NULL);
+
+  /*!
+    Get the radius (in voxels) of the neighborhood that hole filling reads around a voxel, computed from the largest
+    Size and StickLengthLimit of the hole filling elements. Returns -1 if the neighborhood is not known.
+  */
+  int GetHoleFillingKernelRadius();
+
+  /*!
+    Update the gray levels (with hole filling, if enabled) of a region in a volume previously extracted from this reconstructor.
+    The pasted voxels of the region and a margin of kernelRadius voxels around it are copied into regionReconstructor and
+    the gray levels are extracted there, so the cost is proportional to the size of the region instead of the whole volume.
+    \param grayLevels Gray level volume extracted from this reconstructor, only voxels within updateExtent are modified
+    \param updateExtent Voxel extent to update
+    \param kernelRadius Radius of the hole filling neighborhood, see GetHoleFillingKernelRadius
+    \param regionReconstructor Reconstructor that is reconfigured for the region, it can be reused between calls
+  */
+  PlusStatus UpdateGrayLevelsInRegion(vtkImageData* grayLevels, const int updateExtent[6], int kernelRadius, vtkPlusVolumeReconstructor* regionReconstructor);
+
+  /*!
+    Update a downsampled copy (coarse level of detail) of the pasted volume, without hole filling. Each downsampled voxel is the mean
+    of the voxels that contain data in a block of downsamplingFactor^3 voxels, so it can be sent as a quick preview of the volume.
+    \param downsampledVolume Downsampled volume, it is reallocated if its size or voxel format does not match the pasted volume
+    \param downsamplingFactor Number of voxels along each axis that are merged into one downsampled voxel
+    \param updateExtents Voxel extents of the pasted volume that changed since the previous update (e.g., modified bricks).
+      If NULL or if the downsampled volume has to be reallocated then the whole downsampled volume is computed.
+  */
+  PlusStatus UpdateDownsampledVolume(vtkImageData* downsampledVolume, int downsamplingFactor, const std::vector<PlusVolumeBrickGrid::ExtentType>* updateExtents = NULL);
+
+  /*!
+    Expand bounds (xMin, xMax, yMin, yMax, zMin, zMax in the Reference coordinate system) to contain the clipped frame.
+    The corners of the clip rectangle are used the same way as in SetOutputExtentFromFrameList, so the output volume
+    geometry can be computed without keeping all the frames in memory (out-of-core reconstruction).
+    Frames without valid ImageToReference transform are ignored.
+    \param frameIncluded Optional output, true if the frame expanded the bounds
+  */
+  PlusStatus ExpandOutputBoundsWithFrame(igsioTrackedFrame* frame, vtkIGSIOTransformRepository* transformRepository, double bounds[6], bool* frameIncluded = NULL);
+
+  /*! Get the origin, spacing and extent of the output volume that contains the bounds computed by ExpandOutputBoundsWithFrame */
+  void GetOutputGeometryFromBounds(const double bounds[6], double origin[3], double spacing[3], int extent[6]);
+
+  /*!
+    Set the output origin and extent and allocate an empty volume. The extent does not have to start at 0, so a part
+    (e.g., a slab) of a larger volume can be reconstructed with the same voxel coordinates as the whole volume.
+    \param scalarType Scalar type of the frame images
+  */
+  PlusStatus AllocateOutput(const double origin[3], const int extent[6], int scalarType);
+
+  /*!
+    Insert a batch of frames into the volume using multiple threads.
+    The ImageToReference transforms and the modified voxel extents of all the frames are computed first. Then consecutive frames
+    are grouped into tiles, the frames of each tile are pasted in a separate thread into a volume that only covers the voxels
+    that they may modify, and the tiles are merged into the volume in frame order according to the compounding mode.
+    A tile is limited in the number of frames and in the number of voxels (a single frame that modifies more voxels gets its own tile).
+    The tile reconstructors are kept between calls and only reconfigured when the reconstruction parameters or the frame size change.
+    \param frames Frames to insert, in insertion order
+    \param transformRepository Transform repository that the transforms of the frames are set in
+    \param numberOfThreads Number of threads (0 = one per processor core)
+    \param reproducible If true then the number of frames in a tile does not depend on the number of threads, so the result is
+      bit-identical on any computer. Otherwise the frames are distributed evenly between the threads, which requires less merging,
+      but with MEAN compounding the rounding of voxel values depends on the number of threads.
+    \param insertedFrameExtents Optional output, voxel extents that the inserted frames may have modified
+  */
+  PlusStatus AddTrackedFrames(const std::vector<igsioTrackedFrame*>& frames, vtkIGSIOTransformRepository* transformRepository, unsigned int numberOfThreads, bool reproducible,
+                              std::vector<PlusVolumeBrickGrid::ExtentType>* insertedFrameExtents = NULL);
+
+  /*!
+    Insert a frame into the volume. If clip rectangle tightening is enabled then the frame is pasted in row bands (see
+    PlusSlicePixelSpans::GetRowBands) with the clip rectangle of the paster set to each band in turn, so the pixels outside the
+    valid pixel spans (e.g., the corners of a fan) are not visited. The pasted pixels are the same as with the configured clip rectangle.
+    With automatic fan angle detection the frame is pasted at once, in the bounding rectangle of the valid pixels.
+  */
+  virtual PlusStatus AddTrackedFrame(igsioTrackedFrame* frame, vtkIGSIOTransformRepository* transformRepository, bool isFirst = true, bool isLast = true, bool* insertedIntoVolume = NULL) override;
+
+  /*!
+    If enabled (default) then frames are pasted in row bands of the valid pixels instead of the whole configured clip rectangle.
+    The reconstructed volume is the same either way, disabling it is only useful for measuring the saving.
+  */
+  vtkSetMacro(ClipRectangleTightening, bool);
+  vtkGetMacro(ClipRectangleTightening, bool);
+  vtkBooleanMacro(ClipRectangleTightening, bool);
+
 protected:
   vtkPlusVolumeReconstructor();
   virtual ~vtkPlusVolumeReconstructor();
 
+  /*!
+    Configure regionReconstructor with the parameters in configElement and allocate an empty volume in it
+    that covers regionExtent of the volume of this reconstructor (the region origin is shifted, the spacing is the same).
+    If configElement is NULL then regionReconstructor is assumed to be configured already and only its volume is allocated.
+  */
+  PlusStatus SetUpRegionReconstructor(vtkPlusVolumeReconstructor* regionReconstructor, vtkXMLDataElement* configElement, const int regionExtent[6]);
+
+  /*!
+    Get the configured clip rectangle shrunk to the bounding rectangle of the valid pixels of frames of frameSize.
+    Returns false if clip rectangle tightening is disabled or the rectangle cannot be made smaller.
+  */
+  bool GetTightenedClipRectangle(const FrameSizeType& frameSize, int origin[2], int size[2]);
+
+  /*!
+    Get the clip rectangles (origin x, origin y, size x, size y) that frames of frameSize are pasted with, one for each row band of
+    the valid pixels. Returns false if clip rectangle tightening is disabled or the configured rectangle should be used.
+  */
+  bool GetPasteRectangles(const FrameSizeType& frameSize, std::vector<std::array<int, 4> >& rectangles);
+
+  /*!
+    Shrink the clip rectangle in the tile reconstructor configuration to the bounding rectangle of the valid pixels of frames of frameSize,
+    so that the tiles do not visit pixels outside the fan or the importance mask.
+  */
+  void TightenTileClipRectangle(const FrameSizeType& frameSize, vtkXMLDataElement* reconstructionElement);
+
+  /*! Modification time of the reconstruction parameters that the tile configuration is built from */
+  vtkMTimeType GetTileConfigurationMTime();
+
+  /*! Reconstructors that the tiles of frame batches are pasted into, one for each thread */
+  std::vector<vtkSmartPointer<vtkPlusVolumeReconstructor> > TileReconstructors;
+
+  /*! Configuration of the tile reconstructors: the parameters of this reconstructor with one thread and a tightened clip rectangle */
+  vtkSmartPointer<vtkXMLDataElement> TileConfigElement;
+  /*! Parameter modification time and frame size that TileConfigElement was built for (frame size is 0 if the frames had different sizes) */
+  vtkMTimeType TileConfigMTime;
+  FrameSizeType TileConfigFrameSize;
+  /*! Number of reconstructors at the beginning of TileReconstructors that are configured with TileConfigElement */
+  unsigned int NumberOfConfiguredTileReconstructors;
+
+  /*! Valid pixels of the frames for the current clipping parameters */
+  PlusSlicePixelSpans ValidPixelSpans;
+
+  /*! Importance mask that is set in the paster, NULL if no mask is used */
+  vtkSmartPointer<vtkImageData> ImportanceMaskImage;
+
+  bool ClipRectangleTightening;
+
 private:
   vtkPlusVolumeReconstructor(const vtkPlusVolumeReconstructor&);  // Not implemented.
   void operator=(const vtkPlusVolumeReconstructor&);  // Not implemented.